@@ -30,6 +30,12 @@ Texture2D<float> CascadedShadowMaps[NUM_OF_SHADOW_CASCADES] : register(t2);
 
 RWTexture3D<float4> OutputVoxelGITexture : register(u0);
 
+struct FoliageInstance
+{
+    row_major float4x4 World;
+};
+StructuredBuffer<FoliageInstance> IndirectInstanceData : register(t4); // compacted by FoliageCulling.hlsl
+
 struct VS_INPUT
 {
     float4 Position : POSITION;
@@ -39,6 +45,15 @@ struct VS_INPUT
     row_major float4x4 World : WORLD;
 };
 
+struct VS_INPUT_INDIRECT
+{
+    float4 Position : POSITION;
+    float2 TextureCoordinates : TEXCOORD0;
+    float3 Normal : NORMAL;
+    
+    uint InstanceID : SV_InstanceID;
+};
+
 struct VS_OUTPUT
 {
     float4 Position : SV_Position;
@@ -182,6 +197,16 @@ VS_OUTPUT VSMain(VS_INPUT IN)
     return OUT;
 }
 
+VS_OUTPUT VSMain_indirect(VS_INPUT_INDIRECT IN)
+{
+    VS_INPUT input;
+    input.Position = IN.Position;
+    input.TextureCoordinates = IN.TextureCoordinates;
+    input.Normal = IN.Normal;
+    input.World = IndirectInstanceData[IN.InstanceID].World;
+    return VSMain(input);
+}
+
 float CalculateShadow(float3 ShadowCoord, int index)
 {
     const float Dilation = 2.0;
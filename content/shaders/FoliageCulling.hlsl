@@ -0,0 +1,109 @@
+// ================================================================================================
+// Compute shader for per-cell culling and LOD of foliage patches.
+// GPU version of ER_FoliageCells::Select() for a whole ER_FoliageBatch: one thread group per cell
+// (of all the zones of the batch), visible cells write their first GetLODPatchesCount() patches
+// to a compacted instance buffer for one indirect draw of the batch.
+// ================================================================================================
+
+#define FOLIAGE_CULLING_THREADS 64
+
+struct FoliageInstance
+{
+    row_major float4x4 World;
+};
+
+// Same layout as FoliageBatchCellGPU in ER_FoliageManager.h
+struct FoliageCell
+{
+    float3 AABBMin;
+    uint FirstPatch; // in the instance pool of the batch
+    float3 AABBMax;
+    uint PatchesCount;
+    uint ZoneIndex;
+    uint3 pad;
+};
+
+// Same layout as FoliageBatchZoneGPU in ER_FoliageManager.h
+struct FoliageZone
+{
+    float4 LODParams; // x - start distance, y - max distance, z - quality factor, w - visible (the zone passed the CPU culling)
+};
+
+cbuffer FoliageCullingCBuffer : register(b0)
+{
+    float4 FrustumPlanes[6];
+    float4 CameraPos; // .w - skip frustum culling
+    uint IndexCountPerInstance;
+    uint CellsCount;
+    uint DispatchGroupsX; // big batches are dispatched as a 2D grid of cells
+    uint pad;
+};
+
+StructuredBuffer<FoliageInstance> InstanceData : register(t0);
+StructuredBuffer<FoliageCell> Cells : register(t1);
+StructuredBuffer<FoliageZone> Zones : register(t2);
+RWStructuredBuffer<FoliageInstance> OutputInstanceData : register(u0);
+RWBuffer<uint> ArgsBuffer : register(u1); // DrawIndexedInstanced() args
+
+groupshared uint CellOutputCount;
+groupshared uint CellOutputOffset;
+
+bool IsCulled(float3 aabbMin, float3 aabbMax)
+{
+    [unroll]
+    for (int planeID = 0; planeID < 6; planeID++)
+    {
+        // the most "inner" vertex of the box along the (outward) plane normal
+        float3 axisVert = float3(
+            FrustumPlanes[planeID].x > 0.0f ? aabbMin.x : aabbMax.x,
+            FrustumPlanes[planeID].y > 0.0f ? aabbMin.y : aabbMax.y,
+            FrustumPlanes[planeID].z > 0.0f ? aabbMin.z : aabbMax.z);
+        if (dot(FrustumPlanes[planeID].xyz, axisVert) + FrustumPlanes[planeID].w > 0.0f)
+            return true;
+    }
+    return false;
+}
+
+uint GetLODPatchesCount(FoliageCell cell, float4 LODParams)
+{
+    float3 toCell = max(max(cell.AABBMin - CameraPos.xyz, CameraPos.xyz - cell.AABBMax), 0.0f);
+    float factor = saturate((length(toCell) - LODParams.x) / max(LODParams.y, 0.0001f));
+    float density = (1.0f - factor) * LODParams.z;
+    return min(cell.PatchesCount, (uint)ceil((float)cell.PatchesCount * density));
+}
+
+[numthreads(FOLIAGE_CULLING_THREADS, 1, 1)]
+void CSMain(uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex)
+{
+    uint cellIndex = Gid.y * DispatchGroupsX + Gid.x;
+    if (cellIndex >= CellsCount)
+        return;
+
+    FoliageCell cell = Cells[cellIndex];
+    if (GI == 0)
+    {
+        FoliageZone zone = Zones[cell.ZoneIndex];
+        uint count = 0;
+        if (zone.LODParams.w > 0.0f && (CameraPos.w > 0.0f || !IsCulled(cell.AABBMin, cell.AABBMax)))
+            count = GetLODPatchesCount(cell, zone.LODParams);
+        uint offset = 0;
+        if (count > 0)
+            InterlockedAdd(ArgsBuffer[1], count, offset);
+        CellOutputCount = count;
+        CellOutputOffset = offset;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint i = GI; i < CellOutputCount; i += FOLIAGE_CULLING_THREADS)
+        OutputInstanceData[CellOutputOffset + i] = InstanceData[cell.FirstPatch + i];
+}
+
+[numthreads(1, 1, 1)]
+void CSClearArgs(uint3 DTid : SV_DispatchThreadID)
+{
+    ArgsBuffer[0] = IndexCountPerInstance;
+    ArgsBuffer[1] = 0;
+    ArgsBuffer[2] = 0;
+    ArgsBuffer[3] = 0;
+    ArgsBuffer[4] = 0;
+}
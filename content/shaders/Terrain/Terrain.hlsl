@@ -19,11 +19,14 @@
 #include "..\Lighting.hlsli"
 
 static const int DETAIL_TEXTURE_REPEAT = 32;
-#define MAX_TERRAIN_TILE_COUNT 64 // dont forget to change in ER_Terrain.h
+static const float MAX_TESSELLATION_FACTOR = 64.0;
+
+// edge flags of a patch (same as TerrainPatchEdgeFlags in ER_Terrain.h), edges are in the quad domain order: (u = 0), (v = 0), (u = 1), (v = 1)
+#define PATCH_EDGE_COARSER_NEIGHBOUR_SHIFT 0
+#define PATCH_EDGE_FINER_NEIGHBOUR_SHIFT 4
 
 cbuffer TerrainDataCBuffer : register(b0)
 {
-    float4x4 TerrainTileWorld[MAX_TERRAIN_TILE_COUNT];
     float4x4 ShadowMatrices[NUM_OF_SHADOW_CASCADES];
     float4x4 View;
     float4x4 Projection;
@@ -47,14 +50,14 @@ cbuffer TerrainShadowDataCBuffer : register(b1)
 
 struct VS_INPUT_TS
 {
-    float4 PatchInfo : PATCH_INFO;
-    float TileIndex : TILE_INDEX;
+    float4 PatchInfo : PATCH_INFO; // xy - origin in the tile, zw - size (quadtree node)
+    float4 TileInfo : TILE_INFO; // x - tile index, y - edge flags, zw - world offset of the tile (XZ)
 };
 
 struct HS_INPUT
 {
     float4 PatchInfo : PATCH_INFO;
-    float4 TileIndex : TILE_INDEX; //this fixes a dx compiler bug (error X8000)
+    float4 TileInfo : TILE_INFO;
 };
 
 struct HS_OUTPUT
@@ -80,7 +83,7 @@ struct PatchData
     float Inside[2] : SV_InsideTessFactor;
     float2 origin : ORIGIN;
     float2 size : SIZE;
-    float TileIndex : TILE_INDEX;
+    float2 tileOffset : TILE_OFFSET;
 };
 
 Texture2D<float4> SplatTexture : register(t0);
@@ -98,7 +101,7 @@ HS_INPUT VSMain(VS_INPUT_TS IN)
     HS_INPUT OUT = (HS_INPUT) 0;
 	
     OUT.PatchInfo = IN.PatchInfo;
-    OUT.TileIndex = float4(IN.TileIndex, 0.0f, 0.0f, 0.0f);
+    OUT.TileInfo = IN.TileInfo;
     return OUT;
 }
 
@@ -125,52 +128,60 @@ float3 GetNormalFromHeightmap(float2 uv, float texelSize, float maxHeight)
     return normalize(n);
 }
 
+// Neighbouring quadtree nodes differ by one LOD level at most. To avoid cracks, the shared edge of a coarser node is tessellated with a multiple of 4
+// and the two edges of the finer nodes along it get half of that factor each (same vertices with "fractional_even" partitioning).
+float GetEdgeTessellationFactor(float2 origin, float2 size, float2 tileOffset, int edge, uint edgeFlags)
+{
+    static const float2 edgeMidpoints[4] = { float2(0.0, 0.5), float2(0.5, 0.0), float2(1.0, 0.5), float2(0.5, 1.0) };
+    
+    bool hasCoarserNeighbour = (edgeFlags & (1u << (PATCH_EDGE_COARSER_NEIGHBOUR_SHIFT + edge))) != 0;
+    bool hasFinerNeighbour = (edgeFlags & (1u << (PATCH_EDGE_FINER_NEIGHBOUR_SHIFT + edge))) != 0;
+    
+    float2 midpoint = origin + edgeMidpoints[edge] * size;
+    if (hasCoarserNeighbour)
+    {
+        // midpoint of the neighbour's edge (it is twice as long and aligned to its size)
+        int axis = (edge % 2 == 0) ? 1 : 0;
+        float coarserSize = 2.0 * size[axis];
+        midpoint[axis] = (floor(origin[axis] / coarserSize) + 0.5) * coarserSize;
+    }
+    
+    float factor = GetTessellationFactorFromCamera(length(CameraPosition.xz - tileOffset - midpoint));
+    if (hasCoarserNeighbour || hasFinerNeighbour)
+    {
+        factor = ceil(min(factor, MAX_TESSELLATION_FACTOR) * 0.25) * 4.0;
+        if (hasCoarserNeighbour)
+            factor *= 0.5;
+    }
+    return factor;
+}
+
 PatchData hull_constant_function(InputPatch<HS_INPUT, 1> inputPatch)
 {
     PatchData output;
 
-    float distance_to_camera = 0.0f;
-    float tesselation_factor = 0.0f;
-    float inside_tessellation_factor = 0.0f;
-    //float in_frustum = 0;
-
     float2 origin = inputPatch[0].PatchInfo.xy;
     float2 size = inputPatch[0].PatchInfo.zw;
+    uint edgeFlags = (uint)inputPatch[0].TileInfo.y;
     
     output.origin = origin;
     output.size = size;
-    output.TileIndex = inputPatch[0].TileIndex;
+    output.tileOffset = inputPatch[0].TileInfo.zw;
     
-    float4 pos = float4(origin.x, 0.0f, origin.y, 1.0f);
-    pos = mul(pos, TerrainTileWorld[(int)(output.TileIndex)]);
-
-    distance_to_camera = length(CameraPosition.xz - pos.xz - float2(0, size.y * 0.5));
-    tesselation_factor = GetTessellationFactorFromCamera(distance_to_camera);
-    output.Edges[0] = tesselation_factor;
-    inside_tessellation_factor += tesselation_factor;
-
-    distance_to_camera = length(CameraPosition.xz - pos.xz - float2(size.x * 0.5, 0));
-    tesselation_factor = GetTessellationFactorFromCamera(distance_to_camera);
-    output.Edges[1] = tesselation_factor;
-    inside_tessellation_factor += tesselation_factor;
-
-    distance_to_camera = length(CameraPosition.xz - pos.xz - float2(size.x, size.y * 0.5));
-    tesselation_factor = GetTessellationFactorFromCamera(distance_to_camera);
-    output.Edges[2] = tesselation_factor;
-    inside_tessellation_factor += tesselation_factor;
-
-    distance_to_camera = length(CameraPosition.xz - pos.xz - float2(size.x * 0.5, size.y));
-    tesselation_factor = GetTessellationFactorFromCamera(distance_to_camera);
-    output.Edges[3] = tesselation_factor;
-    inside_tessellation_factor += tesselation_factor;
-
+    float inside_tessellation_factor = 0.0f;
+    [unroll]
+    for (int edge = 0; edge < 4; edge++)
+    {
+        output.Edges[edge] = GetEdgeTessellationFactor(origin, size, output.tileOffset, edge, edgeFlags);
+        inside_tessellation_factor += output.Edges[edge];
+    }
     output.Inside[0] = output.Inside[1] = inside_tessellation_factor * 0.25;
 
     return output;
 }
 
 [domain("quad")]
-[partitioning("fractional_odd")]
+[partitioning("fractional_even")]
 [outputtopology("triangle_cw")]
 [outputcontrolpoints(1)]
 [patchconstantfunc("hull_constant_function")]
@@ -203,16 +214,16 @@ DS_OUTPUT DSMain(PatchData input, float2 uv : SV_DomainLocation, OutputPatch<HS_
     //float3 normalRot = mul(normal, normal_rotation_matrix);
     
 	// writing output params
-    float4x4 worldMat = TerrainTileWorld[(int)input.TileIndex];
-    output.position = mul(float4(vertexPosition, 1.0), worldMat);
+    float4 worldPos = float4(vertexPosition.x + input.tileOffset.x, vertexPosition.y, vertexPosition.z + input.tileOffset.y, 1.0);
+    output.position = worldPos;
     output.worldPos = output.position;
     output.position = mul(output.position, View);
     output.position = mul(output.position, Projection);
     output.texcoord = texcoord01;
     output.normal = float3(0, 0, 0);
-    output.shadowCoord0 = mul(float4(vertexPosition, 1.0), mul(worldMat, ShadowMatrices[0])).xyz;
-    output.shadowCoord1 = mul(float4(vertexPosition, 1.0), mul(worldMat, ShadowMatrices[1])).xyz;
-    output.shadowCoord2 = mul(float4(vertexPosition, 1.0), mul(worldMat, ShadowMatrices[2])).xyz;
+    output.shadowCoord0 = mul(worldPos, ShadowMatrices[0]).xyz;
+    output.shadowCoord1 = mul(worldPos, ShadowMatrices[1]).xyz;
+    output.shadowCoord2 = mul(worldPos, ShadowMatrices[2]).xyz;
     return output;
 }
 
@@ -229,7 +240,8 @@ DS_OUTPUT DSShadowMap(PatchData input, float2 uv : SV_DomainLocation, OutputPatc
     vertexPosition.y = TerrainHeightScale * height;
     
 	// writing output params
-    output.position = mul(float4(vertexPosition, 1.0), mul(TerrainTileWorld[(int)input.TileIndex], LightViewProjection));
+    float4 worldPos = float4(vertexPosition.x + input.tileOffset.x, vertexPosition.y, vertexPosition.z + input.tileOffset.y, 1.0);
+    output.position = mul(worldPos, LightViewProjection);
     output.Depth = output.position.zw;
  
     return output;
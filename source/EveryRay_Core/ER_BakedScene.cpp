@@ -0,0 +1,696 @@
+#include "ER_BakedScene.h"
+#include "ER_Utility.h"
+
+#include "..\JsonCpp\include\json\json.h"
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		class ER_BakedSceneWriter
+		{
+		public:
+			UINT AddString(const Json::Value& aParent, const char* aName)
+			{
+				if (!aParent.isMember(aName))
+					return ER_BAKED_SCENE_INVALID_STRING;
+				return AddString(aParent[aName].asString());
+			}
+
+			UINT AddString(const std::string& aString)
+			{
+				auto it = mStringsLookup.find(aString);
+				if (it != mStringsLookup.end())
+					return it->second;
+
+				UINT offset = static_cast<UINT>(mStrings.size());
+				mStrings.insert(mStrings.end(), aString.begin(), aString.end());
+				mStrings.push_back('\0');
+				mStringsLookup.emplace(aString, offset);
+				return offset;
+			}
+
+			std::vector<ER_BakedSceneObject> mObjects;
+			std::vector<ER_BakedSceneMaterial> mMaterials;
+			std::vector<ER_BakedSceneMeshTextures> mMeshTextures;
+			std::vector<UINT> mLODs;
+			std::vector<XMFLOAT4X4> mInstanceTransforms;
+			std::vector<char> mStrings;
+		private:
+			std::unordered_map<std::string, UINT> mStringsLookup;
+		};
+
+		void ReadFloatArray(const Json::Value& aArray, float* aOut, UINT aMaxCount)
+		{
+			for (Json::Value::ArrayIndex i = 0; i != aArray.size() && i < aMaxCount; i++)
+				aOut[i] = aArray[i].asFloat();
+		}
+
+		template<typename T>
+		UINT AppendSection(std::vector<char>& aData, const std::vector<T>& aSection, UINT aAlignment = 4)
+		{
+			aData.resize(ER_BitmaskAlign(static_cast<UINT>(aData.size()), aAlignment), 0);
+			UINT offset = static_cast<UINT>(aData.size());
+			if (!aSection.empty())
+			{
+				const char* begin = reinterpret_cast<const char*>(aSection.data());
+				aData.insert(aData.end(), begin, begin + aSection.size() * sizeof(T));
+			}
+			return offset;
+		}
+	}
+
+	ER_BakedScene::ER_BakedScene()
+	{
+	}
+
+	ER_BakedScene::~ER_BakedScene()
+	{
+		Close();
+	}
+
+	std::string ER_BakedScene::GetBakedPath(const std::string& aSourcePath)
+	{
+		std::string::size_type extensionIndex = aSourcePath.find_last_of('.');
+		return (extensionIndex == std::string::npos ? aSourcePath : aSourcePath.substr(0, extensionIndex)) + ER_BAKED_SCENE_EXTENSION;
+	}
+
+	bool ER_BakedScene::GetSourceFileStamp(const std::string& aSourcePath, UINT64& aSize, UINT64& aWriteTime)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA(aSourcePath.c_str(), GetFileExInfoStandard, &attributes))
+			return false;
+
+		aSize = (static_cast<UINT64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		aWriteTime = (static_cast<UINT64>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
+
+	bool ER_BakedScene::Bake(const Json::Value& aSceneRoot, const std::string& aSourcePath, std::vector<char>& aOutData)
+	{
+		ER_BakedSceneWriter writer;
+
+		const Json::Value& objects = aSceneRoot["rendering_objects"];
+		writer.mObjects.reserve(objects.size());
+		for (Json::Value::ArrayIndex i = 0; i != objects.size(); i++)
+		{
+			const Json::Value& object = objects[i];
+
+			ER_BakedSceneObject record = {};
+			record.name = writer.AddString(object["name"].asString());
+			record.modelPath = writer.AddString(object["model_path"].asString());
+			record.snowAlbedo = writer.AddString(object, "snow_albedo");
+			record.snowNormal = writer.AddString(object, "snow_normal");
+			record.snowRoughness = writer.AddString(object, "snow_roughness");
+			record.furHeight = writer.AddString(object, "fur_height");
+
+			auto storeBool = [&](const char* aName, ER_BakedSceneObjectField aField)
+			{
+				if (!object.isMember(aName))
+					return;
+				record.presentFields |= aField;
+				if (object[aName].asBool())
+					record.boolValues |= aField;
+			};
+			auto storeFloat = [&](const char* aName, ER_BakedSceneObjectField aField, float& aOut)
+			{
+				if (!object.isMember(aName))
+					return;
+				record.presentFields |= aField;
+				aOut = object[aName].asFloat();
+			};
+			auto storeInt = [&](const char* aName, ER_BakedSceneObjectField aField, int& aOut)
+			{
+				if (!object.isMember(aName))
+					return;
+				record.presentFields |= aField;
+				aOut = object[aName].asInt();
+			};
+			auto storeUInt = [&](const char* aName, ER_BakedSceneObjectField aField, UINT& aOut)
+			{
+				if (!object.isMember(aName))
+					return;
+				record.presentFields |= aField;
+				aOut = object[aName].asUInt();
+			};
+			auto storeFloatArray = [&](const char* aName, ER_BakedSceneObjectField aField, float* aOut, UINT aCount)
+			{
+				if (!object.isMember(aName))
+					return;
+				record.presentFields |= aField;
+				ReadFloatArray(object[aName], aOut, aCount);
+			};
+			auto storeMinMax = [&](const char* aMinName, const char* aMaxName, ER_BakedSceneObjectField aField, float* aOut)
+			{
+				if (!object.isMember(aMinName) || !object.isMember(aMaxName))
+					return;
+				record.presentFields |= aField;
+				aOut[0] = object[aMinName].asFloat();
+				aOut[1] = object[aMaxName].asFloat();
+			};
+
+			// "instanced" is not optional (defaults to false)
+			record.presentFields |= BAKED_FIELD_INSTANCED;
+			if (object["instanced"].asBool())
+				record.boolValues |= BAKED_FIELD_INSTANCED;
+
+			// flags
+			{
+				storeBool("foliageMask", BAKED_FIELD_FOLIAGE_MASK);
+				storeBool("use_indirect_global_lightprobe", BAKED_FIELD_USE_INDIRECT_GLOBAL_LIGHTPROBE);
+				storeBool("use_in_global_lightprobe_rendering", BAKED_FIELD_USE_IN_GLOBAL_LIGHTPROBE_RENDERING);
+				storeBool("use_parallax_occlusion_mapping", BAKED_FIELD_USE_PARALLAX_OCCLUSION_MAPPING);
+				storeBool("use_forward_shading", BAKED_FIELD_USE_FORWARD_SHADING);
+				storeBool("use_reflection", BAKED_FIELD_USE_REFLECTION);
+				storeBool("use_sss", BAKED_FIELD_USE_SSS);
+				storeFloat("use_custom_alpha_discard", BAKED_FIELD_USE_CUSTOM_ALPHA_DISCARD, record.customAlphaDiscard);
+				storeBool("use_transparency", BAKED_FIELD_USE_TRANSPARENCY);
+				storeBool("use_gpu_indirect_rendering", BAKED_FIELD_USE_GPU_INDIRECT_RENDERING);
+				storeBool("skip_indirect_specular", BAKED_FIELD_SKIP_INDIRECT_SPECULAR);
+				storeFloat("index_of_refraction", BAKED_FIELD_INDEX_OF_REFRACTION, record.indexOfRefraction);
+				storeFloat("custom_roughness", BAKED_FIELD_CUSTOM_ROUGHNESS, record.customRoughness);
+				storeFloat("custom_metalness", BAKED_FIELD_CUSTOM_METALNESS, record.customMetalness);
+				storeBool("use_triplanar_mapping", BAKED_FIELD_USE_TRIPLANAR_MAPPING);
+
+				//fur
+				storeInt("fur_layers_count", BAKED_FIELD_FUR_LAYERS_COUNT, record.furLayersCount);
+				storeFloatArray("fur_color", BAKED_FIELD_FUR_COLOR, record.furColor, 3);
+				storeFloat("fur_color_interpolation", BAKED_FIELD_FUR_COLOR_INTERPOLATION, record.furColorInterpolation);
+				storeFloat("fur_length", BAKED_FIELD_FUR_LENGTH, record.furLength);
+				storeFloat("fur_cutoff", BAKED_FIELD_FUR_CUTOFF, record.furCutoff);
+				storeFloat("fur_cutoff_end", BAKED_FIELD_FUR_CUTOFF_END, record.furCutoffEnd);
+				storeFloat("fur_wind_frequency", BAKED_FIELD_FUR_WIND_FREQUENCY, record.furWindFrequency);
+				storeFloat("fur_gravity_strength", BAKED_FIELD_FUR_GRAVITY_STRENGTH, record.furGravityStrength);
+				storeFloat("fur_uv_scale", BAKED_FIELD_FUR_UV_SCALE, record.furUVScale);
+
+				//terrain
+				storeBool("terrain_placement", BAKED_FIELD_TERRAIN_PLACEMENT);
+				storeInt("terrain_splat_channel", BAKED_FIELD_TERRAIN_SPLAT_CHANNEL, record.terrainSplatChannel);
+				storeFloat("terrain_height_delta", BAKED_FIELD_TERRAIN_HEIGHT_DELTA, record.terrainHeightDelta);
+				storeMinMax("terrain_procedural_instance_scale_min", "terrain_procedural_instance_scale_max", BAKED_FIELD_TERRAIN_PROCEDURAL_SCALE, record.terrainProceduralScale);
+				storeMinMax("terrain_procedural_instance_pitch_min", "terrain_procedural_instance_pitch_max", BAKED_FIELD_TERRAIN_PROCEDURAL_PITCH, record.terrainProceduralPitch);
+				storeMinMax("terrain_procedural_instance_roll_min", "terrain_procedural_instance_roll_max", BAKED_FIELD_TERRAIN_PROCEDURAL_ROLL, record.terrainProceduralRoll);
+				storeMinMax("terrain_procedural_instance_yaw_min", "terrain_procedural_instance_yaw_max", BAKED_FIELD_TERRAIN_PROCEDURAL_YAW, record.terrainProceduralYaw);
+				storeInt("terrain_procedural_instance_count", BAKED_FIELD_TERRAIN_PROCEDURAL_INSTANCE_COUNT, record.terrainProceduralInstanceCount);
+				storeFloatArray("terrain_procedural_zone_center_pos", BAKED_FIELD_TERRAIN_PROCEDURAL_ZONE_CENTER_POS, record.terrainProceduralZoneCenterPos, 3);
+				storeFloat("terrain_procedural_zone_radius", BAKED_FIELD_TERRAIN_PROCEDURAL_ZONE_RADIUS, record.terrainProceduralZoneRadius);
+				storeUInt("terrain_procedural_seed", BAKED_FIELD_TERRAIN_PROCEDURAL_SEED, record.terrainProceduralSeed);
+
+				storeFloat("min_scale", BAKED_FIELD_MIN_SCALE, record.minScale);
+				storeFloat("max_scale", BAKED_FIELD_MAX_SCALE, record.maxScale);
+				storeFloatArray("fresnel_outline_color", BAKED_FIELD_FRESNEL_OUTLINE_COLOR, record.fresnelOutlineColor, 3);
+			}
+
+			// materials
+			record.firstMaterial = static_cast<UINT>(writer.mMaterials.size());
+			if (object.isMember("new_materials"))
+			{
+				const Json::Value& materials = object["new_materials"];
+				for (Json::Value::ArrayIndex matIndex = 0; matIndex != materials.size(); matIndex++)
+				{
+					ER_BakedSceneMaterial material;
+					material.name = writer.AddString(materials[matIndex]["name"].asString());
+					material.vertexEntry = writer.AddString(materials[matIndex], "vertexEntry");
+					material.geometryEntry = writer.AddString(materials[matIndex], "geometryEntry");
+					material.hullEntry = writer.AddString(materials[matIndex], "hullEntry");
+					material.domainEntry = writer.AddString(materials[matIndex], "domainEntry");
+					material.pixelEntry = writer.AddString(materials[matIndex], "pixelEntry");
+					writer.mMaterials.push_back(material);
+				}
+			}
+			record.materialCount = static_cast<UINT>(writer.mMaterials.size()) - record.firstMaterial;
+
+			// custom textures (per mesh)
+			record.firstMeshTextures = static_cast<UINT>(writer.mMeshTextures.size());
+			if (object.isMember("textures"))
+			{
+				record.presentFields |= BAKED_FIELD_TEXTURES;
+				const Json::Value& textures = object["textures"];
+				for (Json::Value::ArrayIndex meshIndex = 0; meshIndex != textures.size(); meshIndex++)
+				{
+					ER_BakedSceneMeshTextures meshTextures;
+					meshTextures.albedo = writer.AddString(textures[meshIndex], "albedo");
+					meshTextures.normal = writer.AddString(textures[meshIndex], "normal");
+					meshTextures.roughness = writer.AddString(textures[meshIndex], "roughness");
+					meshTextures.metalness = writer.AddString(textures[meshIndex], "metalness");
+					meshTextures.height = writer.AddString(textures[meshIndex], "height");
+					meshTextures.reflectionMask = writer.AddString(textures[meshIndex], "reflection_mask");
+					writer.mMeshTextures.push_back(meshTextures);
+				}
+			}
+			record.meshTexturesCount = static_cast<UINT>(writer.mMeshTextures.size()) - record.firstMeshTextures;
+
+			// world transform (identity is used if it is missing or malformed)
+			if (object.isMember("transform") && object["transform"].size() == 16)
+			{
+				record.presentFields |= BAKED_FIELD_TRANSFORM;
+				ReadFloatArray(object["transform"], record.transform, 16);
+			}
+
+			// lods
+			record.firstLOD = static_cast<UINT>(writer.mLODs.size());
+			if (object.isMember("model_lods"))
+			{
+				record.presentFields |= BAKED_FIELD_MODEL_LODS;
+				const Json::Value& lods = object["model_lods"];
+				for (Json::Value::ArrayIndex lod = 0; lod != lods.size(); lod++)
+					writer.mLODs.push_back(writer.AddString(lods[lod], "path"));
+			}
+			record.lodCount = static_cast<UINT>(writer.mLODs.size()) - record.firstLOD;
+
+			// instances' transforms (packed as float4x4 arrays)
+			record.firstInstanceTransform = static_cast<UINT>(writer.mInstanceTransforms.size());
+			if (object.isMember("instances_transforms"))
+			{
+				record.presentFields |= BAKED_FIELD_INSTANCES_TRANSFORMS;
+				const Json::Value& instances = object["instances_transforms"];
+				writer.mInstanceTransforms.reserve(writer.mInstanceTransforms.size() + instances.size());
+				for (Json::Value::ArrayIndex instance = 0; instance != instances.size(); instance++)
+				{
+					XMFLOAT4X4 transform;
+					XMStoreFloat4x4(&transform, XMMatrixIdentity());
+					ReadFloatArray(instances[instance]["transform"], &transform._11, 16);
+					writer.mInstanceTransforms.push_back(transform);
+				}
+			}
+			record.instanceTransformCount = static_cast<UINT>(writer.mInstanceTransforms.size()) - record.firstInstanceTransform;
+
+			writer.mObjects.push_back(record);
+		}
+
+		// the rest of the scene root (used by other systems via ER_Scene::GetValueFromSceneRoot) is stored as compact json
+		std::string sceneRootText;
+		{
+			Json::Value sceneRootRemainder = aSceneRoot;
+			sceneRootRemainder.removeMember("rendering_objects");
+
+			Json::StreamWriterBuilder builder;
+			builder["indentation"] = "";
+			sceneRootText = Json::writeString(builder, sceneRootRemainder);
+		}
+
+		ER_BakedSceneHeader header = {};
+		header.magic = ER_BAKED_SCENE_MAGIC;
+		header.version = ER_BAKED_SCENE_VERSION;
+		if (!GetSourceFileStamp(aSourcePath, header.sourceFileSize, header.sourceWriteTime))
+			return false;
+
+		header.objectCount = static_cast<UINT>(writer.mObjects.size());
+		header.materialCount = static_cast<UINT>(writer.mMaterials.size());
+		header.meshTexturesCount = static_cast<UINT>(writer.mMeshTextures.size());
+		header.lodCount = static_cast<UINT>(writer.mLODs.size());
+		header.instanceTransformCount = static_cast<UINT>(writer.mInstanceTransforms.size());
+
+		aOutData.clear();
+		aOutData.resize(sizeof(ER_BakedSceneHeader), 0);
+		header.objectsOffset = AppendSection(aOutData, writer.mObjects, 8);
+		header.materialsOffset = AppendSection(aOutData, writer.mMaterials);
+		header.meshTexturesOffset = AppendSection(aOutData, writer.mMeshTextures);
+		header.lodsOffset = AppendSection(aOutData, writer.mLODs);
+		header.instanceTransformsOffset = AppendSection(aOutData, writer.mInstanceTransforms, 16);
+		header.stringsOffset = AppendSection(aOutData, writer.mStrings);
+		header.stringsSize = static_cast<UINT>(writer.mStrings.size());
+		header.sceneRootOffset = static_cast<UINT>(aOutData.size());
+		header.sceneRootSize = static_cast<UINT>(sceneRootText.size());
+		aOutData.insert(aOutData.end(), sceneRootText.begin(), sceneRootText.end());
+
+		memcpy(aOutData.data(), &header, sizeof(ER_BakedSceneHeader));
+		return true;
+	}
+
+	bool ER_BakedScene::WriteToDisk(const std::vector<char>& aData, const std::string& aBakedPath)
+	{
+		std::ofstream file(aBakedPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(aData.data(), aData.size());
+		return file.good();
+	}
+
+	bool ER_BakedScene::Open(const std::string& aBakedPath, const std::string& aSourcePath)
+	{
+		Close();
+
+		UINT64 sourceSize = 0, sourceWriteTime = 0;
+		if (!GetSourceFileStamp(aSourcePath, sourceSize, sourceWriteTime))
+			return false;
+
+		mFile = CreateFileA(aBakedPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ER_BakedSceneHeader)))
+		{
+			Close();
+			return false;
+		}
+
+		mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMapping)
+		{
+			Close();
+			return false;
+		}
+
+		mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!mData || !Validate(static_cast<UINT64>(fileSize.QuadPart)) ||
+			mHeader->sourceFileSize != sourceSize || mHeader->sourceWriteTime != sourceWriteTime)
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ER_BakedScene::OpenFromMemory(std::vector<char>&& aData)
+	{
+		Close();
+
+		mMemoryData = std::move(aData);
+		mData = mMemoryData.data();
+		if (mMemoryData.size() < sizeof(ER_BakedSceneHeader) || !Validate(mMemoryData.size()))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	bool ER_BakedScene::Validate(UINT64 aSize)
+	{
+		mHeader = reinterpret_cast<const ER_BakedSceneHeader*>(mData);
+		if (mHeader->magic != ER_BAKED_SCENE_MAGIC || mHeader->version != ER_BAKED_SCENE_VERSION)
+			return false;
+
+		if (static_cast<UINT64>(mHeader->objectsOffset) + mHeader->objectCount * sizeof(ER_BakedSceneObject) > aSize ||
+			static_cast<UINT64>(mHeader->materialsOffset) + mHeader->materialCount * sizeof(ER_BakedSceneMaterial) > aSize ||
+			static_cast<UINT64>(mHeader->meshTexturesOffset) + mHeader->meshTexturesCount * sizeof(ER_BakedSceneMeshTextures) > aSize ||
+			static_cast<UINT64>(mHeader->lodsOffset) + mHeader->lodCount * sizeof(UINT) > aSize ||
+			static_cast<UINT64>(mHeader->instanceTransformsOffset) + mHeader->instanceTransformCount * sizeof(XMFLOAT4X4) > aSize ||
+			static_cast<UINT64>(mHeader->stringsOffset) + mHeader->stringsSize > aSize ||
+			static_cast<UINT64>(mHeader->sceneRootOffset) + mHeader->sceneRootSize > aSize)
+			return false;
+
+		// records are read in place
+		if (mHeader->objectsOffset % alignof(ER_BakedSceneObject) != 0 || mHeader->materialsOffset % alignof(ER_BakedSceneMaterial) != 0 ||
+			mHeader->meshTexturesOffset % alignof(ER_BakedSceneMeshTextures) != 0 || mHeader->lodsOffset % alignof(UINT) != 0 ||
+			mHeader->instanceTransformsOffset % 16 != 0)
+			return false;
+
+		// strings are read with strlen()
+		const char* strings = mData + mHeader->stringsOffset;
+		if (mHeader->stringsSize > 0 && strings[mHeader->stringsSize - 1] != '\0')
+			return false;
+		auto isValidString = [&](UINT aOffset) { return aOffset == ER_BAKED_SCENE_INVALID_STRING || aOffset < mHeader->stringsSize; };
+		auto isValidRange = [](UINT aFirst, UINT aCount, UINT aSectionCount) { return static_cast<UINT64>(aFirst) + aCount <= aSectionCount; };
+
+		const ER_BakedSceneObject* objects = reinterpret_cast<const ER_BakedSceneObject*>(mData + mHeader->objectsOffset);
+		for (UINT i = 0; i < mHeader->objectCount; i++)
+		{
+			const ER_BakedSceneObject& object = objects[i];
+			if (!isValidRange(object.firstMaterial, object.materialCount, mHeader->materialCount) ||
+				!isValidRange(object.firstMeshTextures, object.meshTexturesCount, mHeader->meshTexturesCount) ||
+				!isValidRange(object.firstLOD, object.lodCount, mHeader->lodCount) ||
+				!isValidRange(object.firstInstanceTransform, object.instanceTransformCount, mHeader->instanceTransformCount))
+				return false;
+
+			if (!isValidString(object.name) || !isValidString(object.modelPath) || !isValidString(object.snowAlbedo) ||
+				!isValidString(object.snowNormal) || !isValidString(object.snowRoughness) || !isValidString(object.furHeight))
+				return false;
+		}
+
+		const ER_BakedSceneMaterial* materials = reinterpret_cast<const ER_BakedSceneMaterial*>(mData + mHeader->materialsOffset);
+		for (UINT i = 0; i < mHeader->materialCount; i++)
+		{
+			const ER_BakedSceneMaterial& material = materials[i];
+			if (!isValidString(material.name) || !isValidString(material.vertexEntry) || !isValidString(material.geometryEntry) ||
+				!isValidString(material.hullEntry) || !isValidString(material.domainEntry) || !isValidString(material.pixelEntry))
+				return false;
+		}
+
+		const ER_BakedSceneMeshTextures* meshTextures = reinterpret_cast<const ER_BakedSceneMeshTextures*>(mData + mHeader->meshTexturesOffset);
+		for (UINT i = 0; i < mHeader->meshTexturesCount; i++)
+		{
+			const ER_BakedSceneMeshTextures& textures = meshTextures[i];
+			if (!isValidString(textures.albedo) || !isValidString(textures.normal) || !isValidString(textures.roughness) ||
+				!isValidString(textures.metalness) || !isValidString(textures.height) || !isValidString(textures.reflectionMask))
+				return false;
+		}
+
+		const UINT* lods = reinterpret_cast<const UINT*>(mData + mHeader->lodsOffset);
+		for (UINT i = 0; i < mHeader->lodCount; i++)
+		{
+			if (!isValidString(lods[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	void ER_BakedScene::Close()
+	{
+		if (mMapping && mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = nullptr;
+		mData = nullptr;
+		mHeader = nullptr;
+		mMemoryData.clear();
+		mMemoryData.shrink_to_fit();
+	}
+
+	const ER_BakedSceneObject& ER_BakedScene::GetObjectRecord(UINT aIndex) const
+	{
+		assert(mHeader && aIndex < mHeader->objectCount);
+		return reinterpret_cast<const ER_BakedSceneObject*>(mData + mHeader->objectsOffset)[aIndex];
+	}
+
+	const ER_BakedSceneMaterial& ER_BakedScene::GetMaterial(UINT aIndex) const
+	{
+		assert(mHeader && aIndex < mHeader->materialCount);
+		return reinterpret_cast<const ER_BakedSceneMaterial*>(mData + mHeader->materialsOffset)[aIndex];
+	}
+
+	const ER_BakedSceneMeshTextures& ER_BakedScene::GetMeshTextures(UINT aIndex) const
+	{
+		assert(mHeader && aIndex < mHeader->meshTexturesCount);
+		return reinterpret_cast<const ER_BakedSceneMeshTextures*>(mData + mHeader->meshTexturesOffset)[aIndex];
+	}
+
+	const char* ER_BakedScene::GetLODPath(UINT aIndex) const
+	{
+		assert(mHeader && aIndex < mHeader->lodCount);
+		return GetString(reinterpret_cast<const UINT*>(mData + mHeader->lodsOffset)[aIndex]);
+	}
+
+	const XMFLOAT4X4* ER_BakedScene::GetInstanceTransforms(UINT aFirst) const
+	{
+		assert(mHeader && aFirst <= mHeader->instanceTransformCount);
+		return reinterpret_cast<const XMFLOAT4X4*>(mData + mHeader->instanceTransformsOffset) + aFirst;
+	}
+
+	const char* ER_BakedScene::GetString(UINT aOffset) const
+	{
+		assert(mHeader);
+		if (aOffset == ER_BAKED_SCENE_INVALID_STRING || aOffset >= mHeader->stringsSize)
+			return "";
+		return mData + mHeader->stringsOffset + aOffset;
+	}
+
+	const char* ER_BakedScene::GetSceneRootText(UINT& aSize) const
+	{
+		assert(mHeader);
+		aSize = mHeader->sceneRootSize;
+		return mData + mHeader->sceneRootOffset;
+	}
+
+	bool ER_BakedScene::RunTests()
+	{
+		bool isPassed = true;
+
+		char tempDirectory[MAX_PATH];
+		if (!GetTempPathA(MAX_PATH, tempDirectory))
+			return false;
+		const std::string sourcePath = std::string(tempDirectory) + "ER_BakedSceneTests.json";
+		const std::string bakedPath = GetBakedPath(sourcePath);
+
+		auto makeTransform = [](float aOffset)
+		{
+			Json::Value transform(Json::arrayValue);
+			for (int i = 0; i < 16; i++)
+				transform.append(aOffset + static_cast<float>(i));
+			return transform;
+		};
+
+		// small scene: a regular object with optional fields and two materials, an instanced one with three instances
+		Json::Value root;
+		{
+			root["camera_position"].append(1.0f);
+			root["camera_position"].append(2.0f);
+			root["camera_position"].append(3.0f);
+
+			Json::Value statue;
+			statue["name"] = "Statue";
+			statue["model_path"] = "content\\models\\statue.fbx";
+			statue["instanced"] = false;
+			statue["use_sss"] = true;
+			statue["use_reflection"] = false;
+			statue["index_of_refraction"] = 1.5f;
+			statue["snow_albedo"] = "snow_albedo.png";
+			statue["transform"] = makeTransform(100.0f);
+			Json::Value basicMaterial;
+			basicMaterial["name"] = "BasicColorMaterial";
+			Json::Value gbufferMaterial;
+			gbufferMaterial["name"] = "GBufferMaterial";
+			gbufferMaterial["vertexEntry"] = "VSMain";
+			gbufferMaterial["pixelEntry"] = "PSMain";
+			statue["new_materials"].append(basicMaterial);
+			statue["new_materials"].append(gbufferMaterial);
+
+			Json::Value trees;
+			trees["name"] = "Trees";
+			trees["model_path"] = "content\\models\\tree.fbx";
+			trees["instanced"] = true;
+			trees["foliageMask"] = true;
+			Json::Value shadowMaterial;
+			shadowMaterial["name"] = "ShadowMapMaterial";
+			trees["new_materials"].append(shadowMaterial);
+			for (int instance = 0; instance < 3; instance++)
+			{
+				Json::Value instanceValue;
+				instanceValue["transform"] = makeTransform(static_cast<float>(instance * 16));
+				trees["instances_transforms"].append(instanceValue);
+			}
+
+			root["rendering_objects"].append(statue);
+			root["rendering_objects"].append(trees);
+
+			std::ofstream file(sourcePath.c_str(), std::ios::binary | std::ios::trunc);
+			file << Json::writeString(Json::StreamWriterBuilder(), root);
+			if (!file.good())
+				return false;
+		}
+
+		std::vector<char> data;
+		isPassed &= Bake(root, sourcePath, data) && WriteToDisk(data, bakedPath);
+
+		// round trip through the mapped file
+		{
+			ER_BakedScene bakedScene;
+			isPassed &= bakedScene.Open(bakedPath, sourcePath);
+			isPassed &= bakedScene.GetObjectCount() == 2;
+			if (isPassed)
+			{
+				const ER_BakedSceneObject& statue = bakedScene.GetObjectRecord(0);
+				isPassed &= strcmp(bakedScene.GetString(statue.name), "Statue") == 0;
+				isPassed &= strcmp(bakedScene.GetString(statue.modelPath), "content\\models\\statue.fbx") == 0;
+				isPassed &= statue.Has(BAKED_FIELD_INSTANCED) && !statue.GetBool(BAKED_FIELD_INSTANCED);
+				isPassed &= statue.Has(BAKED_FIELD_USE_SSS) && statue.GetBool(BAKED_FIELD_USE_SSS);
+				isPassed &= statue.Has(BAKED_FIELD_USE_REFLECTION) && !statue.GetBool(BAKED_FIELD_USE_REFLECTION);
+				isPassed &= !statue.Has(BAKED_FIELD_FOLIAGE_MASK) && !statue.Has(BAKED_FIELD_CUSTOM_ROUGHNESS);
+				isPassed &= statue.Has(BAKED_FIELD_INDEX_OF_REFRACTION) && statue.indexOfRefraction == 1.5f;
+				isPassed &= bakedScene.HasString(statue.snowAlbedo) && strcmp(bakedScene.GetString(statue.snowAlbedo), "snow_albedo.png") == 0;
+				isPassed &= !bakedScene.HasString(statue.snowNormal);
+				isPassed &= statue.Has(BAKED_FIELD_TRANSFORM);
+				for (int i = 0; i < 16; i++)
+					isPassed &= statue.transform[i] == 100.0f + static_cast<float>(i);
+				isPassed &= !statue.Has(BAKED_FIELD_INSTANCES_TRANSFORMS) && statue.instanceTransformCount == 0;
+
+				isPassed &= statue.materialCount == 2;
+				if (statue.materialCount == 2)
+				{
+					const ER_BakedSceneMaterial& basicMaterial = bakedScene.GetMaterial(statue.firstMaterial);
+					const ER_BakedSceneMaterial& gbufferMaterial = bakedScene.GetMaterial(statue.firstMaterial + 1);
+					isPassed &= strcmp(bakedScene.GetString(basicMaterial.name), "BasicColorMaterial") == 0;
+					isPassed &= !bakedScene.HasString(basicMaterial.vertexEntry) && !bakedScene.HasString(basicMaterial.pixelEntry);
+					isPassed &= strcmp(bakedScene.GetString(gbufferMaterial.name), "GBufferMaterial") == 0;
+					isPassed &= strcmp(bakedScene.GetString(gbufferMaterial.vertexEntry), "VSMain") == 0;
+					isPassed &= strcmp(bakedScene.GetString(gbufferMaterial.pixelEntry), "PSMain") == 0;
+					isPassed &= !bakedScene.HasString(gbufferMaterial.geometryEntry);
+				}
+
+				const ER_BakedSceneObject& trees = bakedScene.GetObjectRecord(1);
+				isPassed &= strcmp(bakedScene.GetString(trees.name), "Trees") == 0;
+				isPassed &= trees.GetBool(BAKED_FIELD_INSTANCED) && trees.Has(BAKED_FIELD_FOLIAGE_MASK) && trees.GetBool(BAKED_FIELD_FOLIAGE_MASK);
+				isPassed &= !trees.Has(BAKED_FIELD_TRANSFORM);
+				isPassed &= trees.materialCount == 1 && trees.firstMaterial == 2;
+				if (trees.materialCount == 1)
+					isPassed &= strcmp(bakedScene.GetString(bakedScene.GetMaterial(trees.firstMaterial).name), "ShadowMapMaterial") == 0;
+
+				// packed, 16-byte aligned instance matrices (as in json)
+				isPassed &= trees.Has(BAKED_FIELD_INSTANCES_TRANSFORMS) && trees.instanceTransformCount == 3;
+				if (trees.instanceTransformCount == 3)
+				{
+					const XMFLOAT4X4* transforms = bakedScene.GetInstanceTransforms(trees.firstInstanceTransform);
+					isPassed &= reinterpret_cast<uintptr_t>(transforms) % 16 == 0;
+					for (int instance = 0; instance < 3; instance++)
+						for (int i = 0; i < 16; i++)
+							isPassed &= (&transforms[instance]._11)[i] == static_cast<float>(instance * 16 + i);
+				}
+
+				// the rest of the scene root
+				UINT sceneRootSize = 0;
+				const char* sceneRootText = bakedScene.GetSceneRootText(sceneRootSize);
+				Json::Reader reader;
+				Json::Value sceneRoot;
+				isPassed &= reader.parse(sceneRootText, sceneRootText + sceneRootSize, sceneRoot);
+				isPassed &= sceneRoot.isMember("camera_position") && sceneRoot["camera_position"].size() == 3 && !sceneRoot.isMember("rendering_objects");
+			}
+		}
+
+		// corrupt copies are rejected (the unchanged copy is not)
+		{
+			ER_BakedSceneHeader header;
+			memcpy(&header, data.data(), sizeof(ER_BakedSceneHeader));
+
+			auto isAccepted = [&data](const std::function<void(std::vector<char>&)>& aCorrupt)
+			{
+				std::vector<char> copy = data;
+				aCorrupt(copy);
+				ER_BakedScene bakedScene;
+				return bakedScene.OpenFromMemory(std::move(copy));
+			};
+			auto getObject = [&header](std::vector<char>& aData, UINT aIndex)
+			{
+				return reinterpret_cast<ER_BakedSceneObject*>(aData.data() + header.objectsOffset) + aIndex;
+			};
+
+			isPassed &= isAccepted([](std::vector<char>&) {});
+			isPassed &= !isAccepted([](std::vector<char>& aData) { reinterpret_cast<ER_BakedSceneHeader*>(aData.data())->magic++; });
+			isPassed &= !isAccepted([](std::vector<char>& aData) { reinterpret_cast<ER_BakedSceneHeader*>(aData.data())->version++; });
+			isPassed &= !isAccepted([](std::vector<char>& aData) { aData.resize(aData.size() - 1); });
+			isPassed &= !isAccepted([](std::vector<char>& aData) { aData.resize(sizeof(ER_BakedSceneHeader) - 1); });
+			isPassed &= !isAccepted([&](std::vector<char>& aData) { getObject(aData, 1)->firstMaterial = header.materialCount; });
+			isPassed &= !isAccepted([&](std::vector<char>& aData) { getObject(aData, 0)->materialCount = header.materialCount + 1; });
+			isPassed &= !isAccepted([&](std::vector<char>& aData) { getObject(aData, 1)->firstInstanceTransform = 1; });
+			isPassed &= !isAccepted([&](std::vector<char>& aData) { getObject(aData, 0)->name = header.stringsSize; });
+			isPassed &= !isAccepted([&](std::vector<char>& aData) { reinterpret_cast<ER_BakedSceneHeader*>(aData.data())->objectCount = static_cast<UINT>(aData.size()); });
+		}
+
+		// a changed json file makes the baked file stale
+		{
+			std::ofstream file(sourcePath.c_str(), std::ios::binary | std::ios::app);
+			file << '\n';
+			file.close();
+
+			ER_BakedScene bakedScene;
+			isPassed &= !bakedScene.Open(bakedPath, sourcePath);
+		}
+
+		DeleteFileA(bakedPath.c_str());
+		DeleteFileA(sourcePath.c_str());
+
+		std::wstring msg = L"[ER Logger][ER_BakedScene] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+}
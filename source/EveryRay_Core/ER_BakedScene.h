@@ -0,0 +1,210 @@
+#pragma once
+#include "Common.h"
+
+#define ER_BAKED_SCENE_MAGIC 0x42535245 // "ERSB"
+#define ER_BAKED_SCENE_VERSION 2
+#define ER_BAKED_SCENE_INVALID_STRING 0xFFFFFFFF
+#define ER_BAKED_SCENE_EXTENSION ".erscene"
+
+namespace Json
+{
+	class Value;
+}
+
+namespace EveryRay_Core
+{
+	// Optional fields of a rendering object in the scene json (i.e., the ones checked with "isMember()").
+	// Presence is stored in ER_BakedSceneObject::presentFields; bools are stored in ER_BakedSceneObject::boolValues with the same bit.
+	enum ER_BakedSceneObjectField : UINT64
+	{
+		BAKED_FIELD_INSTANCED								= 1ull << 0,
+		BAKED_FIELD_FOLIAGE_MASK							= 1ull << 1,
+		BAKED_FIELD_USE_INDIRECT_GLOBAL_LIGHTPROBE			= 1ull << 2,
+		BAKED_FIELD_USE_IN_GLOBAL_LIGHTPROBE_RENDERING		= 1ull << 3,
+		BAKED_FIELD_USE_PARALLAX_OCCLUSION_MAPPING			= 1ull << 4,
+		BAKED_FIELD_USE_FORWARD_SHADING						= 1ull << 5,
+		BAKED_FIELD_USE_REFLECTION							= 1ull << 6,
+		BAKED_FIELD_USE_SSS									= 1ull << 7,
+		BAKED_FIELD_USE_CUSTOM_ALPHA_DISCARD				= 1ull << 8,
+		BAKED_FIELD_USE_TRANSPARENCY						= 1ull << 9,
+		BAKED_FIELD_USE_GPU_INDIRECT_RENDERING				= 1ull << 10,
+		BAKED_FIELD_SKIP_INDIRECT_SPECULAR					= 1ull << 11,
+		BAKED_FIELD_INDEX_OF_REFRACTION						= 1ull << 12,
+		BAKED_FIELD_CUSTOM_ROUGHNESS						= 1ull << 13,
+		BAKED_FIELD_CUSTOM_METALNESS						= 1ull << 14,
+		BAKED_FIELD_USE_TRIPLANAR_MAPPING					= 1ull << 15,
+		BAKED_FIELD_FUR_LAYERS_COUNT						= 1ull << 16,
+		BAKED_FIELD_FUR_COLOR								= 1ull << 17,
+		BAKED_FIELD_FUR_COLOR_INTERPOLATION					= 1ull << 18,
+		BAKED_FIELD_FUR_LENGTH								= 1ull << 19,
+		BAKED_FIELD_FUR_CUTOFF								= 1ull << 20,
+		BAKED_FIELD_FUR_CUTOFF_END							= 1ull << 21,
+		BAKED_FIELD_FUR_WIND_FREQUENCY						= 1ull << 22,
+		BAKED_FIELD_FUR_GRAVITY_STRENGTH					= 1ull << 23,
+		BAKED_FIELD_FUR_UV_SCALE							= 1ull << 24,
+		BAKED_FIELD_TERRAIN_PLACEMENT						= 1ull << 25,
+		BAKED_FIELD_TERRAIN_SPLAT_CHANNEL					= 1ull << 26,
+		BAKED_FIELD_TERRAIN_HEIGHT_DELTA					= 1ull << 27,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_SCALE				= 1ull << 28,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_PITCH				= 1ull << 29,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_ROLL					= 1ull << 30,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_YAW					= 1ull << 31,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_INSTANCE_COUNT		= 1ull << 32,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_ZONE_CENTER_POS		= 1ull << 33,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_ZONE_RADIUS			= 1ull << 34,
+		BAKED_FIELD_MIN_SCALE								= 1ull << 35,
+		BAKED_FIELD_MAX_SCALE								= 1ull << 36,
+		BAKED_FIELD_FRESNEL_OUTLINE_COLOR					= 1ull << 37,
+		BAKED_FIELD_TRANSFORM								= 1ull << 38,
+		BAKED_FIELD_MODEL_LODS								= 1ull << 39,
+		BAKED_FIELD_INSTANCES_TRANSFORMS					= 1ull << 40,
+		BAKED_FIELD_TEXTURES								= 1ull << 41,
+		BAKED_FIELD_TERRAIN_PROCEDURAL_SEED					= 1ull << 42
+	};
+
+	// All structs below are stored in the file as is (POD, fixed size); strings are offsets into the string table.
+	struct ER_BakedSceneHeader
+	{
+		UINT magic;
+		UINT version;
+		UINT64 sourceFileSize; // json source file stamp (to detect stale bakes)
+		UINT64 sourceWriteTime;
+
+		UINT objectCount;
+		UINT materialCount;
+		UINT meshTexturesCount;
+		UINT lodCount;
+		UINT instanceTransformCount;
+
+		UINT objectsOffset;
+		UINT materialsOffset;
+		UINT meshTexturesOffset;
+		UINT lodsOffset;
+		UINT instanceTransformsOffset; // 16-byte aligned
+		UINT stringsOffset;
+		UINT stringsSize;
+		UINT sceneRootOffset; // the rest of the scene json (without "rendering_objects"), stored as compact json text
+		UINT sceneRootSize;
+	};
+
+	struct ER_BakedSceneObject
+	{
+		UINT64 presentFields;
+		UINT64 boolValues;
+
+		UINT name;
+		UINT modelPath;
+		UINT snowAlbedo;
+		UINT snowNormal;
+		UINT snowRoughness;
+		UINT furHeight;
+
+		UINT firstMaterial;
+		UINT materialCount;
+		UINT firstMeshTextures;
+		UINT meshTexturesCount;
+		UINT firstLOD;
+		UINT lodCount;
+		UINT firstInstanceTransform;
+		UINT instanceTransformCount;
+
+		int furLayersCount;
+		int terrainSplatChannel;
+		int terrainProceduralInstanceCount;
+		UINT terrainProceduralSeed;
+
+		float customAlphaDiscard;
+		float indexOfRefraction;
+		float customRoughness;
+		float customMetalness;
+
+		float furColor[3];
+		float furColorInterpolation;
+		float furLength;
+		float furCutoff;
+		float furCutoffEnd;
+		float furWindFrequency;
+		float furGravityStrength;
+		float furUVScale;
+
+		float terrainHeightDelta;
+		float terrainProceduralScale[2];
+		float terrainProceduralPitch[2];
+		float terrainProceduralRoll[2];
+		float terrainProceduralYaw[2];
+		float terrainProceduralZoneCenterPos[3];
+		float terrainProceduralZoneRadius;
+		float minScale;
+		float maxScale;
+		float fresnelOutlineColor[3];
+
+		float transform[16]; // as in json (row-major, not transposed)
+
+		bool Has(ER_BakedSceneObjectField aField) const { return (presentFields & aField) != 0; }
+		bool GetBool(ER_BakedSceneObjectField aField) const { return (boolValues & aField) != 0; }
+	};
+
+	struct ER_BakedSceneMaterial
+	{
+		UINT name;
+		UINT vertexEntry;
+		UINT geometryEntry;
+		UINT hullEntry;
+		UINT domainEntry;
+		UINT pixelEntry;
+	};
+
+	struct ER_BakedSceneMeshTextures
+	{
+		UINT albedo;
+		UINT normal;
+		UINT roughness;
+		UINT metalness;
+		UINT height;
+		UINT reflectionMask;
+	};
+
+	// Compact, versioned binary form of a level (rendering objects only; the rest of the scene is kept as json text).
+	// Json file stays the editable source: the baked file is (re)generated from it when it is missing or stale.
+	// At runtime the baked file is memory-mapped and read in place.
+	class ER_BakedScene
+	{
+	public:
+		ER_BakedScene();
+		~ER_BakedScene();
+
+		static bool Bake(const Json::Value& aSceneRoot, const std::string& aSourcePath, std::vector<char>& aOutData);
+		static bool WriteToDisk(const std::vector<char>& aData, const std::string& aBakedPath);
+		static std::string GetBakedPath(const std::string& aSourcePath);
+
+		// Maps the baked file; fails if it does not exist, has a different version or was baked from a different json file state.
+		bool Open(const std::string& aBakedPath, const std::string& aSourcePath);
+		// Uses an in-memory bake (i.e., when the file could not be written)
+		bool OpenFromMemory(std::vector<char>&& aData);
+		void Close();
+		bool IsOpen() const { return mData != nullptr; }
+
+		UINT GetObjectCount() const { return mHeader ? mHeader->objectCount : 0; }
+		const ER_BakedSceneObject& GetObjectRecord(UINT aIndex) const;
+		const ER_BakedSceneMaterial& GetMaterial(UINT aIndex) const;
+		const ER_BakedSceneMeshTextures& GetMeshTextures(UINT aIndex) const;
+		const char* GetLODPath(UINT aIndex) const;
+		const XMFLOAT4X4* GetInstanceTransforms(UINT aFirst) const;
+		const char* GetString(UINT aOffset) const;
+		bool HasString(UINT aOffset) const { return aOffset != ER_BAKED_SCENE_INVALID_STRING; }
+		const char* GetSceneRootText(UINT& aSize) const;
+
+		// Bake -> Open round trip of a small generated scene and rejection of corrupt or stale bakes (see ER_Tests)
+		static bool RunTests();
+	private:
+		static bool GetSourceFileStamp(const std::string& aSourcePath, UINT64& aSize, UINT64& aWriteTime);
+		bool Validate(UINT64 aSize);
+
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+		std::vector<char> mMemoryData;
+
+		const char* mData = nullptr;
+		const ER_BakedSceneHeader* mHeader = nullptr;
+	};
+}
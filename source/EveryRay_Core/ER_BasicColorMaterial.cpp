@@ -16,6 +16,8 @@ namespace EveryRay_Core
 	ER_BasicColorMaterial::ER_BasicColorMaterial(ER_Core& game, const MaterialShaderEntries& entries, unsigned int shaderFlags, bool instanced)
 		: ER_Material(game, entries, shaderFlags)
 	{
+		mPSONonInstanced = ER_Material::GetCore()->GetRHI()->GetPSOHandle(psoNameNonInstanced);
+		mPSOInstanced = ER_Material::GetCore()->GetRHI()->GetPSOHandle(psoNameInstanced);
 		//TODO instanced support
 		if (shaderFlags & HAS_VERTEX_SHADER)
 		{
@@ -56,20 +58,20 @@ namespace EveryRay_Core
 		rhi->SetRootSignature(rs);
 		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		const std::string& psoName = psoNameNonInstanced; //TODO add instancing support
-		if (!rhi->IsPSOReady(psoName))
+		const ER_RHI_PSO_HANDLE pso = mPSONonInstanced; //TODO add instancing support
+		if (!rhi->IsPSOReady(pso))
 		{
-			rhi->InitializePSO(psoName);
+			rhi->InitializePSO(pso);
 			PrepareShaders();
 			rhi->SetRenderTargetFormats({ neededSystems.mIllumination->GetLocalIlluminationRT() }, neededSystems.mIllumination->GetGBufferDepth()); // we assume that we render in local RT (don't like it but idk how to properly pass RT atm)
 			rhi->SetRasterizerState(ER_NO_CULLING);
 			rhi->SetBlendState(ER_NO_BLEND);
 			rhi->SetDepthStencilState(ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
-			rhi->SetRootSignatureToPSO(psoName, rs);
-			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			rhi->FinalizePSO(psoName);
+			rhi->SetRootSignatureToPSO(pso, rs);
+			rhi->SetTopologyTypeToPSO(pso, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			rhi->FinalizePSO(pso);
 		}
-		rhi->SetPSO(psoName);
+		rhi->SetPSO(pso);
 		rhi->SetConstantBuffers(ER_VERTEX, { mConstantBuffer.Buffer() }, 0, rs, BASICCOLOR_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 		rhi->SetConstantBuffers(ER_PIXEL,  { mConstantBuffer.Buffer() }, 0, rs, BASICCOLOR_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 	}
@@ -1,11 +1,92 @@
 #include "ER_CPUProfiler.h"
 #include "ER_Utility.h"
 
+#include <algorithm>
+
+#include "..\JsonCpp\include\json\json.h"
+
 namespace EveryRay_Core {
-	
-	ER_CPUProfiler::ER_CPUProfiler()
+
+	namespace
 	{
+		struct ER_CPUProfilerThreadBuffer
+		{
+			ER_CPUProfilerEvent Events[ER_CPUProfiler::ThreadBufferSize];
+			std::atomic<UINT64> WriteIndex{ 0 }; // only written by the owner thread
+			UINT64 ReadIndex = 0; // only used by the thread that calls EndFrame()
+			int ThreadIndex = 0;
+			std::string Name; // guarded by the registry mutex
+		};
+
+		// Buffers live until the end of the process, so zones of finished threads can still be collected
+		std::mutex& GetRegistryMutex()
+		{
+			static std::mutex registryMutex;
+			return registryMutex;
+		}
 
+		std::vector<std::unique_ptr<ER_CPUProfilerThreadBuffer>>& GetRegistry()
+		{
+			static std::vector<std::unique_ptr<ER_CPUProfilerThreadBuffer>> registry;
+			return registry;
+		}
+
+		thread_local ER_CPUProfilerThreadBuffer* sThreadBuffer = nullptr;
+		thread_local UINT sThreadDepth = 0;
+
+		ER_CPUProfilerThreadBuffer* GetThreadBuffer()
+		{
+			if (!sThreadBuffer)
+			{
+				std::lock_guard<std::mutex> lock(GetRegistryMutex());
+				auto& registry = GetRegistry();
+				registry.push_back(std::unique_ptr<ER_CPUProfilerThreadBuffer>(new ER_CPUProfilerThreadBuffer()));
+				sThreadBuffer = registry.back().get();
+				sThreadBuffer->ThreadIndex = static_cast<int>(registry.size()) - 1;
+				sThreadBuffer->Name = "Thread " + std::to_string(sThreadBuffer->ThreadIndex);
+			}
+			return sThreadBuffer;
+		}
+
+		// tree nodes are looked up by their parent and name: the same name can have different pointers (i.e., literals in different translation units)
+		struct ER_CPUProfilerNodeKeyLess
+		{
+			bool operator()(const std::pair<int, const char*>& a, const std::pair<int, const char*>& b) const
+			{
+				return (a.first != b.first) ? a.first < b.first : strcmp(a.second, b.second) < 0;
+			}
+		};
+
+		void WriteJsonString(std::ofstream& aFile, const char* aString)
+		{
+			aFile << '"';
+			for (const char* c = aString; *c; c++)
+			{
+				if (*c == '"' || *c == '\\')
+					aFile << '\\';
+				aFile << *c;
+			}
+			aFile << '"';
+		}
+	}
+
+	ER_CPUProfilerScope::ER_CPUProfilerScope(const char* aName)
+		: mName(aName)
+		, mBeginNs(ER_CPUProfiler::GetTimeNs())
+		, mDepth(ER_CPUProfiler::PushDepth())
+	{
+	}
+
+	ER_CPUProfilerScope::~ER_CPUProfilerScope()
+	{
+		ER_CPUProfiler::RecordEvent(mName, mBeginNs, ER_CPUProfiler::GetTimeNs(), mDepth);
+		ER_CPUProfiler::PopDepth();
+	}
+
+	ER_CPUProfiler::ER_CPUProfiler()
+	{
+		SetThreadName("Main thread");
+		mLastFrameEndNs = GetTimeNs();
 	}
 
 	ER_CPUProfiler::~ER_CPUProfiler()
@@ -37,4 +118,393 @@ namespace EveryRay_Core {
 		}
 	}
 
-}
\ No newline at end of file
+	UINT64 ER_CPUProfiler::GetTimeNs()
+	{
+		static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		return static_cast<UINT64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+	}
+
+	UINT ER_CPUProfiler::PushDepth()
+	{
+		return sThreadDepth++;
+	}
+
+	void ER_CPUProfiler::PopDepth()
+	{
+		assert(sThreadDepth > 0);
+		sThreadDepth--;
+	}
+
+	void ER_CPUProfiler::SetThreadName(const std::string& aName)
+	{
+		ER_CPUProfilerThreadBuffer* buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(GetRegistryMutex());
+		buffer->Name = aName;
+	}
+
+	void ER_CPUProfiler::RecordEvent(const char* aName, UINT64 aBeginNs, UINT64 aEndNs, UINT aDepth)
+	{
+		ER_CPUProfilerThreadBuffer* buffer = GetThreadBuffer();
+
+		// single producer: nobody else writes this buffer, the reader only needs to see the event before the new index
+		const UINT64 writeIndex = buffer->WriteIndex.load(std::memory_order_relaxed);
+		ER_CPUProfilerEvent& event = buffer->Events[writeIndex % ThreadBufferSize];
+		event.Name = aName;
+		event.BeginNs = aBeginNs;
+		event.EndNs = aEndNs;
+		event.Depth = aDepth;
+		buffer->WriteIndex.store(writeIndex + 1, std::memory_order_release);
+	}
+
+	void ER_CPUProfiler::EndFrame(UINT64 aFrameIndex)
+	{
+		ER_CPUProfilerFrame frame;
+		frame.FrameIndex = aFrameIndex;
+		frame.BeginNs = mLastFrameEndNs;
+		frame.EndNs = GetTimeNs();
+		mLastFrameEndNs = frame.EndNs;
+
+		{
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+			for (auto& buffer : GetRegistry())
+			{
+				UINT64 writeIndex = buffer->WriteIndex.load(std::memory_order_acquire);
+				if (writeIndex == buffer->ReadIndex)
+					continue;
+
+				UINT64 readIndex = std::max(buffer->ReadIndex, writeIndex > ThreadBufferSize ? writeIndex - ThreadBufferSize : 0);
+				ER_CPUProfilerThreadFrame threadFrame;
+				threadFrame.ThreadIndex = buffer->ThreadIndex;
+				threadFrame.ThreadName = buffer->Name;
+				threadFrame.Events.reserve(static_cast<size_t>(writeIndex - readIndex));
+				for (UINT64 i = readIndex; i < writeIndex; i++)
+					threadFrame.Events.push_back(buffer->Events[i % ThreadBufferSize]);
+
+				// the owner could have wrapped around while we were copying, so the oldest copied events may be torn
+				const UINT64 newWriteIndex = buffer->WriteIndex.load(std::memory_order_acquire);
+				if (newWriteIndex - readIndex > ThreadBufferSize)
+				{
+					const size_t tornCount = static_cast<size_t>(std::min<UINT64>(newWriteIndex - readIndex - ThreadBufferSize, threadFrame.Events.size()));
+					threadFrame.Events.erase(threadFrame.Events.begin(), threadFrame.Events.begin() + tornCount);
+				}
+				buffer->ReadIndex = writeIndex;
+
+				std::sort(threadFrame.Events.begin(), threadFrame.Events.end(), [](const ER_CPUProfilerEvent& a, const ER_CPUProfilerEvent& b)
+				{
+					return (a.BeginNs != b.BeginNs) ? a.BeginNs < b.BeginNs : a.Depth < b.Depth;
+				});
+				frame.Threads.push_back(std::move(threadFrame));
+			}
+		}
+
+		// build trees: zones are sorted by their begin time, so a zone's parent is the last open zone on the previous depth
+		for (auto& thread : frame.Threads)
+		{
+			std::vector<int> openNodes;
+			std::map<std::pair<int, const char*>, int, ER_CPUProfilerNodeKeyLess> nodesLookup;
+			for (const auto& event : thread.Events)
+			{
+				openNodes.resize(std::min<size_t>(event.Depth, openNodes.size())); // parents can be missing if they are still open or were dropped
+				const int parent = openNodes.empty() ? -1 : openNodes.back();
+
+				auto it = nodesLookup.find(std::make_pair(parent, event.Name));
+				int nodeIndex;
+				if (it == nodesLookup.end())
+				{
+					nodeIndex = static_cast<int>(thread.Tree.size());
+					thread.Tree.push_back({ event.Name, parent, static_cast<UINT>(openNodes.size()), 0, 0.0 });
+					nodesLookup.emplace(std::make_pair(parent, event.Name), nodeIndex);
+				}
+				else
+					nodeIndex = it->second;
+
+				thread.Tree[nodeIndex].CallsCount++;
+				thread.Tree[nodeIndex].TotalMs += static_cast<double>(event.EndNs - event.BeginNs) / 1000000.0;
+				openNodes.push_back(nodeIndex);
+			}
+		}
+
+		mFrames.push_back(std::move(frame));
+		if (mFrames.size() > FrameHistorySize)
+			mFrames.pop_front();
+
+		if (mIsStartupCaptureRequested)
+		{
+			mIsStartupCaptureRequested = false;
+			ExportChromeTrace(ER_Utility::GetFilePath("cpu_profile_startup.json"), static_cast<UINT>(mFrames.size()) - 1, 1);
+		}
+
+		if (mCaptureFramesLeft > 0 && --mCaptureFramesLeft == 0)
+		{
+			const UINT framesCount = std::min(mCaptureFramesCount, static_cast<UINT>(mFrames.size()));
+			mLastCapturePath = ER_Utility::GetFilePath("cpu_profile_frame_" + std::to_string(aFrameIndex) + ".json");
+			ExportChromeTrace(mLastCapturePath, static_cast<UINT>(mFrames.size()) - framesCount, framesCount);
+		}
+	}
+
+	void ER_CPUProfiler::RequestCapture(UINT aFramesCount)
+	{
+		mCaptureFramesCount = std::min(std::max(aFramesCount, 1u), static_cast<UINT>(FrameHistorySize));
+		mCaptureFramesLeft = mCaptureFramesCount;
+	}
+
+	bool ER_CPUProfiler::ExportChromeTrace(const std::string& aPath, UINT aFirstFrame, UINT aFramesCount) const
+	{
+		if (aFirstFrame + aFramesCount > mFrames.size())
+			return false;
+
+		std::ofstream file(aPath, std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::string message = "[ER Logger][ER_CPUProfiler] Could not open the file for the trace: " + aPath + '\n';
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			return false;
+		}
+
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"build\":\"" << __DATE__ << " " << __TIME__ << "\"},\"traceEvents\":[\n";
+
+		// thread names (metadata events)
+		bool isFirst = true;
+		{
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+			for (const auto& buffer : GetRegistry())
+			{
+				file << (isFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->ThreadIndex << ",\"args\":{\"name\":";
+				WriteJsonString(file, buffer->Name.c_str());
+				file << "}}";
+				isFirst = false;
+			}
+		}
+
+		// complete events (timestamps and durations are in microseconds)
+		for (UINT frameI = aFirstFrame; frameI < aFirstFrame + aFramesCount; frameI++)
+		{
+			const ER_CPUProfilerFrame& frame = mFrames[frameI];
+			file << (isFirst ? "" : ",\n") << "{\"name\":\"Frame " << frame.FrameIndex << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":-1,\"ts\":" <<
+				frame.BeginNs / 1000.0 << ",\"dur\":" << (frame.EndNs - frame.BeginNs) / 1000.0 << "}";
+			isFirst = false;
+
+			for (const auto& thread : frame.Threads)
+			{
+				for (const auto& event : thread.Events)
+				{
+					file << ",\n{\"name\":";
+					WriteJsonString(file, event.Name);
+					file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread.ThreadIndex << ",\"ts\":" << event.BeginNs / 1000.0 <<
+						",\"dur\":" << (event.EndNs - event.BeginNs) / 1000.0 << ",\"args\":{\"frame\":" << frame.FrameIndex << "}}";
+				}
+			}
+		}
+		file << "\n]}\n";
+		file.close();
+
+		std::string message = "[ER Logger][ER_CPUProfiler] Exported " + std::to_string(aFramesCount) + " frame(s) to the Chrome trace: " + aPath + '\n';
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return true;
+	}
+
+	void ER_CPUProfiler::ShowImGui()
+	{
+		if (ImGui::Button("Capture 60 frames (Chrome trace)"))
+			RequestCapture(60);
+		if (mCaptureFramesLeft > 0)
+			ImGui::Text("Capturing... %u frames left", mCaptureFramesLeft);
+		else if (!mLastCapturePath.empty())
+			ImGui::TextWrapped("Last capture: %s", mLastCapturePath.c_str());
+
+		if (mFrames.empty())
+			return;
+
+		const ER_CPUProfilerFrame& frame = mFrames.back();
+		if (ImGui::TreeNode("Zones of the last frame"))
+		{
+			for (const auto& thread : frame.Threads)
+			{
+				if (ImGui::TreeNode(reinterpret_cast<void*>(static_cast<intptr_t>(thread.ThreadIndex)), "%s", thread.ThreadName.c_str()))
+				{
+					for (int nodeI = 0; nodeI < static_cast<int>(thread.Tree.size()); nodeI++)
+					{
+						if (thread.Tree[nodeI].Parent == -1)
+							ShowImGuiNode(thread, nodeI);
+					}
+					ImGui::TreePop();
+				}
+			}
+			ImGui::TreePop();
+		}
+	}
+
+	void ER_CPUProfiler::ShowImGuiNode(const ER_CPUProfilerThreadFrame& aThread, int aNodeIndex)
+	{
+		const ER_CPUProfilerNode& node = aThread.Tree[aNodeIndex];
+		if (ImGui::TreeNode(reinterpret_cast<void*>(static_cast<intptr_t>(aNodeIndex)), "%s: %.3f ms (%u calls)", node.Name, node.TotalMs, node.CallsCount))
+		{
+			// children are always stored after their parent
+			for (int nodeI = aNodeIndex + 1; nodeI < static_cast<int>(aThread.Tree.size()); nodeI++)
+			{
+				if (aThread.Tree[nodeI].Parent == aNodeIndex)
+					ShowImGuiNode(aThread, nodeI);
+			}
+			ImGui::TreePop();
+		}
+	}
+
+	bool ER_CPUProfiler::RunTests()
+	{
+		bool isPassed = true;
+
+		ER_CPUProfiler profiler;
+		profiler.EndFrame(0); // zones recorded before the test
+
+		// nesting on the main thread; the last inner zone has the same name at a different address, so it is merged with the others
+		char innerNameCopy[] = "ER_CPUProfiler test inner";
+		{
+			ER_CPUProfilerScope outer("ER_CPUProfiler test outer");
+			{
+				ER_CPUProfilerScope inner("ER_CPUProfiler test inner");
+			}
+			{
+				ER_CPUProfilerScope inner("ER_CPUProfiler test inner");
+			}
+			{
+				ER_CPUProfilerScope inner(innerNameCopy);
+			}
+		}
+
+		// zones of other threads are attributed to them
+		auto recordOnThread = [](const std::string& aThreadName, int aZonesCount)
+		{
+			std::thread thread([&aThreadName, aZonesCount]()
+			{
+				SetThreadName(aThreadName);
+				for (int i = 0; i < aZonesCount; i++)
+					ER_CPUProfilerScope zone("ER_CPUProfiler test thread zone");
+			});
+			thread.join();
+		};
+		recordOnThread("ER_CPUProfiler test thread A", 2);
+		recordOnThread("ER_CPUProfiler test thread B", 3);
+		profiler.EndFrame(1);
+
+		auto findThread = [&profiler](const char* aZoneName) -> const ER_CPUProfilerThreadFrame*
+		{
+			for (const auto& thread : profiler.GetFrames().back().Threads)
+			{
+				for (const auto& event : thread.Events)
+				{
+					if (strcmp(event.Name, aZoneName) == 0)
+						return &thread;
+				}
+			}
+			return nullptr;
+		};
+		auto countZones = [](const ER_CPUProfilerThreadFrame& aThread, const char* aZoneName)
+		{
+			return std::count_if(aThread.Events.begin(), aThread.Events.end(), [aZoneName](const ER_CPUProfilerEvent& aEvent) { return strcmp(aEvent.Name, aZoneName) == 0; });
+		};
+
+		int mainThreadIndex = -1;
+		const ER_CPUProfilerThreadFrame* mainThread = findThread("ER_CPUProfiler test outer");
+		isPassed &= mainThread != nullptr;
+		if (mainThread)
+		{
+			mainThreadIndex = mainThread->ThreadIndex;
+			isPassed &= countZones(*mainThread, "ER_CPUProfiler test outer") == 1 && countZones(*mainThread, "ER_CPUProfiler test inner") == 3;
+			isPassed &= countZones(*mainThread, "ER_CPUProfiler test thread zone") == 0;
+
+			const ER_CPUProfilerEvent* outerEvent = nullptr;
+			for (const auto& event : mainThread->Events)
+			{
+				if (strcmp(event.Name, "ER_CPUProfiler test outer") == 0)
+					outerEvent = &event;
+				else if (strcmp(event.Name, "ER_CPUProfiler test inner") == 0)
+					isPassed &= outerEvent && event.Depth == outerEvent->Depth + 1 && event.BeginNs >= outerEvent->BeginNs && event.EndNs <= outerEvent->EndNs;
+			}
+
+			int outerNode = -1, innerNodesCount = 0;
+			for (int nodeI = 0; nodeI < static_cast<int>(mainThread->Tree.size()); nodeI++)
+			{
+				const ER_CPUProfilerNode& node = mainThread->Tree[nodeI];
+				if (strcmp(node.Name, "ER_CPUProfiler test outer") == 0)
+				{
+					outerNode = nodeI;
+					isPassed &= node.CallsCount == 1;
+				}
+				else if (strcmp(node.Name, "ER_CPUProfiler test inner") == 0)
+				{
+					innerNodesCount++;
+					isPassed &= outerNode != -1 && node.Parent == outerNode && node.Depth == mainThread->Tree[outerNode].Depth + 1 && node.CallsCount == 3;
+					isPassed &= node.TotalMs <= mainThread->Tree[outerNode].TotalMs;
+				}
+			}
+			isPassed &= outerNode != -1 && innerNodesCount == 1;
+		}
+
+		std::map<std::string, int> threadIndices;
+		for (const auto& thread : profiler.GetFrames().back().Threads)
+		{
+			const long long zonesCount = countZones(thread, "ER_CPUProfiler test thread zone");
+			if (zonesCount == 0)
+				continue;
+			threadIndices[thread.ThreadName] = thread.ThreadIndex;
+			isPassed &= (thread.ThreadName == "ER_CPUProfiler test thread A" && zonesCount == 2) || (thread.ThreadName == "ER_CPUProfiler test thread B" && zonesCount == 3);
+			isPassed &= thread.ThreadIndex != mainThreadIndex && thread.Tree.size() == 1 && thread.Tree[0].CallsCount == static_cast<UINT>(zonesCount);
+		}
+		isPassed &= threadIndices.size() == 2;
+
+		// Chrome trace of the last frame: thread names, complete events with their threads and nesting in time
+		char tempDirectory[MAX_PATH];
+		const std::string tracePath = std::string(GetTempPathA(MAX_PATH, tempDirectory) ? tempDirectory : "") + "ER_CPUProfilerTests.json";
+		isPassed &= profiler.ExportChromeTrace(tracePath, static_cast<UINT>(profiler.GetFrames().size()) - 1, 1);
+		isPassed &= !profiler.ExportChromeTrace(tracePath, static_cast<UINT>(profiler.GetFrames().size()), 1);
+		{
+			Json::Reader reader;
+			Json::Value root;
+			std::ifstream trace(tracePath.c_str(), std::ifstream::binary);
+			isPassed &= reader.parse(trace, root) && root["traceEvents"].isArray();
+
+			const Json::Value& events = root["traceEvents"];
+			int frameEventsCount = 0, innerEventsCount = 0, threadZoneEventsCount = 0;
+			double outerBegin = -1.0, outerEnd = -1.0;
+			std::map<std::string, int> namedThreads;
+			for (Json::Value::ArrayIndex i = 0; i != events.size(); i++)
+			{
+				const Json::Value& event = events[i];
+				const std::string name = event["name"].asString();
+				const std::string phase = event["ph"].asString();
+				if (phase == "M" && name == "thread_name")
+					namedThreads[event["args"]["name"].asString()] = event["tid"].asInt();
+				else if (phase == "X" && event["cat"].asString() == "frame")
+					frameEventsCount++;
+				else if (phase == "X" && name == "ER_CPUProfiler test outer")
+				{
+					isPassed &= event["tid"].asInt() == mainThreadIndex && event["args"]["frame"].asInt() == 1;
+					outerBegin = event["ts"].asDouble();
+					outerEnd = outerBegin + event["dur"].asDouble();
+				}
+				else if (phase == "X" && name == "ER_CPUProfiler test inner")
+				{
+					innerEventsCount++;
+					isPassed &= event["tid"].asInt() == mainThreadIndex;
+					isPassed &= outerBegin >= 0.0 && event["ts"].asDouble() >= outerBegin && event["ts"].asDouble() + event["dur"].asDouble() <= outerEnd + 0.001; // rounded to ns
+				}
+				else if (phase == "X" && name == "ER_CPUProfiler test thread zone")
+				{
+					threadZoneEventsCount++;
+					isPassed &= event["tid"].asInt() == threadIndices["ER_CPUProfiler test thread A"] || event["tid"].asInt() == threadIndices["ER_CPUProfiler test thread B"];
+				}
+			}
+			isPassed &= frameEventsCount == 1 && innerEventsCount == 3 && threadZoneEventsCount == 5;
+			for (const auto& thread : threadIndices)
+				isPassed &= namedThreads.find(thread.first) != namedThreads.end() && namedThreads[thread.first] == thread.second;
+		}
+		DeleteFileA(tracePath.c_str());
+
+		std::wstring msg = L"[ER Logger][ER_CPUProfiler] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+}
@@ -1,21 +1,114 @@
 #pragma once
 #include "Common.h"
 #include <chrono>
+#include <atomic>
+#include <deque>
+
+#define ER_CPU_PROFILER_ENABLED 1 // set to 0 to compile out all ER_PROFILE_SCOPE() zones
+
+#define ER_PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define ER_PROFILE_CONCAT(a, b) ER_PROFILE_CONCAT_INTERNAL(a, b)
+#if ER_CPU_PROFILER_ENABLED
+// Profiles the enclosing scope on any thread; aName must be a string literal (pointer is stored, not the string)
+#define ER_PROFILE_SCOPE(aName) EveryRay_Core::ER_CPUProfilerScope ER_PROFILE_CONCAT(profilerScope, __LINE__)(aName)
+#else
+#define ER_PROFILE_SCOPE(aName)
+#endif
 
 namespace EveryRay_Core
 {
 	typedef std::chrono::high_resolution_clock::time_point TimePoint;
 
+	// Closed zone (time is in nanoseconds since the start of the profiler)
+	struct ER_CPUProfilerEvent
+	{
+		const char* Name;
+		UINT64 BeginNs;
+		UINT64 EndNs;
+		UINT Depth;
+	};
+
+	// Zones of one thread in a frame aggregated by their path in the tree (i.e., calls with the same name and parent are merged; names are compared by contents)
+	struct ER_CPUProfilerNode
+	{
+		const char* Name;
+		int Parent; // -1 for roots
+		UINT Depth;
+		UINT CallsCount;
+		double TotalMs;
+	};
+
+	struct ER_CPUProfilerThreadFrame
+	{
+		int ThreadIndex;
+		std::string ThreadName;
+		std::vector<ER_CPUProfilerEvent> Events; // sorted by begin time
+		std::vector<ER_CPUProfilerNode> Tree; // parents always come before their children
+	};
+
+	struct ER_CPUProfilerFrame
+	{
+		UINT64 FrameIndex;
+		UINT64 BeginNs;
+		UINT64 EndNs;
+		std::vector<ER_CPUProfilerThreadFrame> Threads;
+	};
+
+	// RAII zone, use with ER_PROFILE_SCOPE()
+	class ER_CPUProfilerScope
+	{
+	public:
+		explicit ER_CPUProfilerScope(const char* aName);
+		~ER_CPUProfilerScope();
+	private:
+		const char* mName;
+		UINT64 mBeginNs;
+		UINT mDepth;
+	};
+
+	// Every thread writes its zones to its own ring buffer (single producer, no locks); the main thread collects them once per frame in EndFrame().
+	// Old BeginCPUTime()/EndCPUTime() are kept for one-off logged timings.
 	class ER_CPUProfiler
 	{
 	public:
+		static const UINT ThreadBufferSize = 16384; // max zones per thread between two EndFrame() calls (oldest are dropped on overflow)
+		static const UINT FrameHistorySize = 120;
+
 		ER_CPUProfiler();
 		~ER_CPUProfiler();
 
 		void BeginCPUTime(const std::string& aEventName, bool toLog = true);
 		void EndCPUTime(const std::string& aEventName);
 
+		// Main thread only: moves the zones closed since the previous call into a new frame of the history
+		void EndFrame(UINT64 aFrameIndex);
+		// Exports the next aFramesCount frames to a Chrome trace file (open it in chrome://tracing or ui.perfetto.dev)
+		void RequestCapture(UINT aFramesCount);
+		// Exports the first frame (with all the initialization before it) to a Chrome trace file; must be called before the first EndFrame() ("-profilestartup" of the runtime)
+		void RequestStartupCapture() { mIsStartupCaptureRequested = true; }
+		bool ExportChromeTrace(const std::string& aPath, UINT aFirstFrame, UINT aFramesCount) const; // frames are indices in GetFrames()
+
+		const std::deque<ER_CPUProfilerFrame>& GetFrames() const { return mFrames; }
+		void ShowImGui();
+
+		static void SetThreadName(const std::string& aName); // name of the calling thread in the traces
+		static void RecordEvent(const char* aName, UINT64 aBeginNs, UINT64 aEndNs, UINT aDepth);
+		static UINT64 GetTimeNs();
+		static UINT PushDepth();
+		static void PopDepth();
+
+		// Nesting, merging of zones, attribution to threads and Chrome trace output (see ER_Tests)
+		static bool RunTests();
 	private:
+		void ShowImGuiNode(const ER_CPUProfilerThreadFrame& aThread, int aNodeIndex);
+
 		std::map<std::string, TimePoint> mEventsCPUTime;
+
+		std::deque<ER_CPUProfilerFrame> mFrames;
+		UINT64 mLastFrameEndNs = 0;
+		UINT mCaptureFramesLeft = 0;
+		UINT mCaptureFramesCount = 0;
+		std::string mLastCapturePath;
+		bool mIsStartupCaptureRequested = false;
 	};
-}
\ No newline at end of file
+}
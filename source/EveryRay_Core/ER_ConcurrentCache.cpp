@@ -0,0 +1,307 @@
+#include "ER_ConcurrentCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		// Runs aTask on aThreadsCount threads at the same time and returns the wall time in ms
+		double RunOnThreads(int aThreadsCount, const std::function<void(int)>& aTask)
+		{
+			std::vector<std::thread> threads;
+			auto startTime = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < aThreadsCount; i++)
+				threads.push_back(std::thread(aTask, i));
+			for (auto& thread : threads)
+				thread.join();
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+
+		// Busy "import" (parsing, decompression, etc.) that takes roughly aMicroseconds
+		int* ImportAsset(int aIndex, int aMicroseconds, std::atomic<int>& aImportsCount)
+		{
+			auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(aMicroseconds);
+			while (std::chrono::high_resolution_clock::now() < endTime) {}
+			aImportsCount.fetch_add(1, std::memory_order_relaxed);
+			return new int(aIndex);
+		}
+	}
+
+	bool ER_ConcurrentCacheTests::RunTests(ER_JobSystem* aJobSystem)
+	{
+		bool isPassed = true;
+		const int threadsCount = std::max(static_cast<int>(std::thread::hardware_concurrency()), 4);
+
+		// concurrent requests for one key: the value is created exactly once and everyone gets it
+		for (ER_JobSystem* jobSystem : { static_cast<ER_JobSystem*>(nullptr), aJobSystem })
+		{
+			ER_ConcurrentCache<std::string, int*> cache(jobSystem);
+			std::atomic<int> createCount(0), createdHereCount(0), errorsCount(0);
+			auto request = [&]()
+			{
+				bool didExist = true;
+				int* value = cache.GetOrAdd("key", [&]() { return ImportAsset(7, 2000, createCount); }, &didExist);
+				if (!value || *value != 7)
+					errorsCount++;
+				if (!didExist)
+					createdHereCount++;
+			};
+
+			if (jobSystem)
+			{
+				ER_JobCounter counter;
+				for (int i = 0; i < threadsCount * 4; i++)
+					jobSystem->Submit(request, &counter);
+				jobSystem->Wait(counter);
+			}
+			else
+				RunOnThreads(threadsCount, [&](int) { request(); });
+
+			isPassed &= createCount.load() == 1 && createdHereCount.load() == 1 && errorsCount.load() == 0 && cache.GetSize() == 1;
+			cache.ForEach([](const std::string& aKey, int*& aValue) { delete aValue; });
+		}
+
+		// the first creator fails (returns nullptr or throws) while the others wait: they retry and one of them creates the value
+		for (bool isThrowing : { false, true })
+		{
+			ER_ConcurrentCache<std::string, int*> cache;
+			std::atomic<bool> isCreating(false);
+			std::atomic<int> createCount(0), errorsCount(0);
+			bool didThrow = false;
+
+			std::thread failingThread([&]()
+			{
+				try
+				{
+					int* value = cache.GetOrAdd("key", [&]() -> int*
+					{
+						isCreating = true;
+						std::this_thread::sleep_for(std::chrono::milliseconds(20));
+						if (isThrowing)
+							throw std::runtime_error("creation failed");
+						return nullptr;
+					});
+					if (value)
+						errorsCount++;
+				}
+				catch (const std::runtime_error&)
+				{
+					didThrow = true;
+				}
+			});
+			while (!isCreating) {}
+
+			RunOnThreads(threadsCount, [&](int)
+			{
+				int* value = cache.GetOrAdd("key", [&]() { return ImportAsset(3, 0, createCount); });
+				if (!value || *value != 3)
+					errorsCount++;
+			});
+			failingThread.join();
+
+			int* value = nullptr;
+			isPassed &= didThrow == isThrowing && createCount.load() == 1 && errorsCount.load() == 0;
+			isPassed &= cache.Find("key", &value) && value && *value == 3;
+			cache.ForEach([](const std::string& aKey, int*& aValue) { delete aValue; });
+		}
+
+		// entries that are still being created are not reported by Find(), cleared values are missing and get created again
+		{
+			ER_ConcurrentCache<std::string, int*> cache;
+			std::atomic<bool> isCreating(false), canFinish(false);
+			std::atomic<int> createCount(0);
+
+			std::thread creatorThread([&]()
+			{
+				cache.GetOrAdd("key", [&]()
+				{
+					isCreating = true;
+					while (!canFinish) {}
+					return ImportAsset(5, 0, createCount);
+				});
+			});
+			while (!isCreating) {}
+
+			isPassed &= !cache.Find("key") && !cache.Replace("key", nullptr) && !cache.Remove("key") && !cache.Add("key", nullptr);
+			canFinish = true;
+			creatorThread.join();
+
+			int* value = nullptr;
+			isPassed &= cache.Find("key", &value) && value && *value == 5;
+			delete value;
+
+			isPassed &= cache.Replace("key", nullptr) && !cache.Find("key");
+			bool didExist = true;
+			value = cache.GetOrAdd("key", [&]() { return ImportAsset(6, 0, createCount); }, &didExist);
+			isPassed &= !didExist && value && *value == 6 && createCount.load() == 2;
+			delete value;
+
+			int addedValue = 9;
+			isPassed &= cache.Replace("key", nullptr) && cache.Add("key", &addedValue) && cache.Find("key", &value) && value == &addedValue;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_ConcurrentCache] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_ConcurrentCacheTests::Benchmark()
+	{
+		const int threadsCount = std::max(static_cast<int>(std::thread::hardware_concurrency()), 4);
+		const int assetsCount = 256;
+		const int importMicroseconds = 500;
+		const int lookupsPerThread = 200000;
+
+		std::vector<std::string> keys(assetsCount);
+		for (int i = 0; i < assetsCount; i++)
+			keys[i] = "content\\models\\benchmark\\asset_" + std::to_string(i) + ".fbx";
+
+		// every thread requests all assets in its own order (i.e., many objects sharing the same models during scene loading)
+		std::vector<std::vector<int>> requestOrders(threadsCount);
+		for (int i = 0; i < threadsCount; i++)
+		{
+			requestOrders[i].resize(assetsCount);
+			for (int j = 0; j < assetsCount; j++)
+				requestOrders[i][j] = j;
+			std::shuffle(requestOrders[i].begin(), requestOrders[i].end(), std::mt19937(1234 + i));
+		}
+
+		bool isPassed = true;
+		auto checkResult = [&isPassed, assetsCount](const std::atomic<int>& aImportsCount, int aMaxImportsCount, const std::atomic<int>& aErrorsCount)
+		{
+			isPassed &= aImportsCount.load() >= assetsCount && aImportsCount.load() <= aMaxImportsCount && aErrorsCount.load() == 0;
+		};
+
+		// 1. one lock held for the whole import (cache before the job system)
+		double globalLockMs = 0.0;
+		double globalLockLookupsMs = 0.0;
+		{
+			std::mutex mutex;
+			std::map<std::string, int*> cache;
+			std::atomic<int> importsCount(0), errorsCount(0);
+			globalLockMs = RunOnThreads(threadsCount, [&](int aThreadIndex)
+			{
+				for (int assetIndex : requestOrders[aThreadIndex])
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					auto it = cache.find(keys[assetIndex]);
+					if (it == cache.end())
+						it = cache.emplace(keys[assetIndex], ImportAsset(assetIndex, importMicroseconds, importsCount)).first;
+					if (*it->second != assetIndex)
+						errorsCount++;
+				}
+			});
+			checkResult(importsCount, assetsCount, errorsCount);
+
+			globalLockLookupsMs = RunOnThreads(threadsCount, [&](int aThreadIndex)
+			{
+				std::mt19937 generator(aThreadIndex);
+				for (int i = 0; i < lookupsPerThread; i++)
+				{
+					const int assetIndex = generator() % assetsCount;
+					std::lock_guard<std::mutex> lock(mutex);
+					if (*cache.find(keys[assetIndex])->second != assetIndex)
+						errorsCount++;
+				}
+			});
+			isPassed &= errorsCount.load() == 0;
+
+			for (auto& asset : cache)
+				delete asset.second;
+		}
+
+		// 2. one lock with a set of in-flight imports and one condition variable for all the waiting threads
+		double inFlightSetMs = 0.0;
+		{
+			std::mutex mutex;
+			std::condition_variable condition;
+			std::set<std::string> inFlight;
+			std::map<std::string, int*> cache;
+			std::atomic<int> importsCount(0), errorsCount(0);
+			inFlightSetMs = RunOnThreads(threadsCount, [&](int aThreadIndex)
+			{
+				for (int assetIndex : requestOrders[aThreadIndex])
+				{
+					const std::string& key = keys[assetIndex];
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait(lock, [&]() { return inFlight.find(key) == inFlight.end(); });
+					auto it = cache.find(key);
+					if (it == cache.end())
+					{
+						inFlight.insert(key);
+						lock.unlock();
+						int* asset = ImportAsset(assetIndex, importMicroseconds, importsCount);
+						lock.lock();
+						inFlight.erase(key);
+						it = cache.emplace(key, asset).first;
+						condition.notify_all();
+					}
+					if (*it->second != assetIndex)
+						errorsCount++;
+				}
+			});
+			checkResult(importsCount, assetsCount, errorsCount);
+
+			for (auto& asset : cache)
+				delete asset.second;
+		}
+
+		// 3. sharded cache with future entries
+		double shardedMs = 0.0;
+		double shardedLookupsMs = 0.0;
+		{
+			ER_ConcurrentCache<std::string, int*> cache;
+			std::atomic<int> importsCount(0), errorsCount(0);
+			shardedMs = RunOnThreads(threadsCount, [&](int aThreadIndex)
+			{
+				for (int assetIndex : requestOrders[aThreadIndex])
+				{
+					int* asset = cache.GetOrAdd(keys[assetIndex], [&]() { return ImportAsset(assetIndex, importMicroseconds, importsCount); });
+					if (!asset || *asset != assetIndex)
+						errorsCount++;
+				}
+			});
+			checkResult(importsCount, assetsCount, errorsCount);
+
+			shardedLookupsMs = RunOnThreads(threadsCount, [&](int aThreadIndex)
+			{
+				std::mt19937 generator(aThreadIndex);
+				for (int i = 0; i < lookupsPerThread; i++)
+				{
+					const int assetIndex = generator() % assetsCount;
+					int* asset = nullptr;
+					if (!cache.Find(keys[assetIndex], &asset) || *asset != assetIndex)
+						errorsCount++;
+				}
+			});
+			isPassed &= errorsCount.load() == 0 && cache.GetSize() == static_cast<size_t>(assetsCount);
+
+			// failed creations are not cached and waiting threads retry
+			std::atomic<int> attemptsCount(0);
+			RunOnThreads(threadsCount, [&](int aThreadIndex)
+			{
+				cache.GetOrAdd("missing", [&]() -> int* { attemptsCount++; return nullptr; });
+			});
+			isPassed &= attemptsCount.load() >= 1 && !cache.Find("missing");
+
+			cache.ForEach([](const std::string& aKey, int*& aAsset) { delete aAsset; });
+			cache.Clear();
+		}
+
+		std::wstring msg = L"[ER Logger][ER_ConcurrentCache] Benchmark " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L" (" +
+			std::to_wstring(threadsCount) + L" threads, " + std::to_wstring(assetsCount) + L" assets, " + std::to_wstring(importMicroseconds) + L" us per import):\n" +
+			L"    loading - global lock: " + std::to_wstring(globalLockMs) + L" ms, global lock + in-flight set: " + std::to_wstring(inFlightSetMs) +
+			L" ms, sharded cache: " + std::to_wstring(shardedMs) + L" ms\n" +
+			L"    " + std::to_wstring(lookupsPerThread) + L" lookups per thread - global lock + map: " + std::to_wstring(globalLockLookupsMs) +
+			L" ms, sharded cache: " + std::to_wstring(shardedLookupsMs) + L" ms\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+	}
+}
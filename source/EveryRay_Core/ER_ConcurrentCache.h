@@ -0,0 +1,226 @@
+#pragma once
+#include "Common.h"
+#include "ER_JobSystem.h"
+#include <future>
+#include <functional>
+
+namespace EveryRay_Core
+{
+	// Thread-safe cache of pointers (i.e., imported models or loaded textures) with hashed keys split into independently locked shards.
+	// A missing value is created by the first thread that asks for it, outside of any lock: other threads asking for the same key
+	// wait on its "future" entry, while requests for other keys (even in the same shard) are not blocked.
+	// With a job system, waiting threads execute jobs until the value is ready (they can be workers, which must not block the pool).
+	template <typename Key, typename Value, UINT ShardsCount = 16>
+	class ER_ConcurrentCache
+	{
+	public:
+		ER_ConcurrentCache(ER_JobSystem* aJobSystem = nullptr) : mJobSystem(aJobSystem) {}
+		ER_ConcurrentCache(const ER_ConcurrentCache&) = delete;
+		ER_ConcurrentCache& operator=(const ER_ConcurrentCache&) = delete;
+
+		// Returns the cached value or the one created by aCreate(). If aCreate() returns nullptr (or throws), nothing is cached
+		// and the threads that were waiting for it try to create it themselves (same as if they came first).
+		// aCreate() must not wait for jobs: the waiting thread could run a job that asks for the same key and would wait for itself.
+		// A value cleared with Replace(aKey, nullptr) is a miss too, so it gets created again.
+		Value GetOrAdd(const Key& aKey, const std::function<Value()>& aCreate, bool* aDidExist = nullptr)
+		{
+			Shard& shard = GetShard(aKey);
+			std::shared_ptr<Entry> entry;
+			while (true)
+			{
+				bool isCreator = false;
+				{
+					std::lock_guard<std::mutex> lock(shard.Mutex);
+					auto it = shard.Entries.find(aKey);
+					if (it != shard.Entries.end() && !IsCleared(*it->second))
+						entry = it->second;
+					else
+					{
+						entry = std::make_shared<Entry>();
+						entry->Ready = entry->ReadyPromise.get_future().share();
+						entry->CreatorThread = std::this_thread::get_id();
+						shard.Entries[aKey] = entry;
+						isCreator = true;
+					}
+				}
+				if (isCreator)
+					break;
+
+				const std::shared_future<void> ready = entry->Ready;
+				auto isReady = [&ready]() { return ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+				assert(isReady() || entry->CreatorThread != std::this_thread::get_id());
+				if (mJobSystem)
+					mJobSystem->WaitUntil(isReady);
+				else
+					ready.wait();
+
+				std::lock_guard<std::mutex> lock(shard.Mutex);
+				if (!entry->IsFailed)
+				{
+					if (aDidExist)
+						*aDidExist = true;
+					return entry->Data;
+				}
+				// the creator failed, so we try again ourselves
+			}
+
+			if (aDidExist)
+				*aDidExist = false;
+
+			Value value = nullptr;
+			try
+			{
+				value = aCreate();
+			}
+			catch (...)
+			{
+				FinishEntry(shard, aKey, *entry, nullptr);
+				throw;
+			}
+			FinishEntry(shard, aKey, *entry, value);
+			return value;
+		}
+
+		// Adds an already created value; returns false if the key is already present (and not cleared)
+		bool Add(const Key& aKey, Value aValue)
+		{
+			Shard& shard = GetShard(aKey);
+			std::lock_guard<std::mutex> lock(shard.Mutex);
+			auto it = shard.Entries.find(aKey);
+			if (it != shard.Entries.end() && !IsCleared(*it->second))
+				return false;
+
+			std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+			entry->Ready = entry->ReadyPromise.get_future().share();
+			entry->Data = aValue;
+			entry->IsCreated = true;
+			entry->ReadyPromise.set_value();
+			shard.Entries[aKey] = entry;
+			return true;
+		}
+
+		// Does not wait: values that are still being created (or were cleared) are reported as missing
+		bool Find(const Key& aKey, Value* aOutValue = nullptr) const
+		{
+			const Shard& shard = GetShard(aKey);
+			std::lock_guard<std::mutex> lock(shard.Mutex);
+			auto it = shard.Entries.find(aKey);
+			if (it == shard.Entries.end() || !IsReady(*it->second) || IsCleared(*it->second))
+				return false;
+
+			if (aOutValue)
+				*aOutValue = it->second->Data;
+			return true;
+		}
+
+		// Replacing with nullptr clears the value but keeps the key, so that a new value can be put in with Replace() later (i.e., texture replacement)
+		bool Replace(const Key& aKey, Value aValue)
+		{
+			Shard& shard = GetShard(aKey);
+			std::lock_guard<std::mutex> lock(shard.Mutex);
+			auto it = shard.Entries.find(aKey);
+			if (it == shard.Entries.end() || !IsReady(*it->second))
+				return false;
+
+			it->second->Data = aValue;
+			return true;
+		}
+
+		bool Remove(const Key& aKey)
+		{
+			Shard& shard = GetShard(aKey);
+			std::lock_guard<std::mutex> lock(shard.Mutex);
+			auto it = shard.Entries.find(aKey);
+			if (it == shard.Entries.end() || !IsReady(*it->second))
+				return false;
+
+			shard.Entries.erase(it);
+			return true;
+		}
+
+		// Calls aFunc for every created value (i.e., to delete them before Clear()); must not run concurrently with GetOrAdd()
+		void ForEach(const std::function<void(const Key&, Value&)>& aFunc)
+		{
+			for (auto& shard : mShards)
+			{
+				std::lock_guard<std::mutex> lock(shard.Mutex);
+				for (auto& entry : shard.Entries)
+				{
+					if (IsReady(*entry.second))
+						aFunc(entry.first, entry.second->Data);
+				}
+			}
+		}
+
+		void Clear()
+		{
+			for (auto& shard : mShards)
+			{
+				std::lock_guard<std::mutex> lock(shard.Mutex);
+				shard.Entries.clear();
+			}
+		}
+
+		size_t GetSize() const
+		{
+			size_t size = 0;
+			for (const auto& shard : mShards)
+			{
+				std::lock_guard<std::mutex> lock(shard.Mutex);
+				size += shard.Entries.size();
+			}
+			return size;
+		}
+	private:
+		struct Entry
+		{
+			Value Data = nullptr;
+			bool IsCreated = false;
+			bool IsFailed = false;
+			std::promise<void> ReadyPromise; // only set by the creator
+			std::shared_future<void> Ready;
+			std::thread::id CreatorThread;
+		};
+
+		struct Shard
+		{
+			mutable std::mutex Mutex;
+			std::unordered_map<Key, std::shared_ptr<Entry>> Entries;
+		};
+
+		static bool IsReady(const Entry& aEntry) { return aEntry.IsCreated; } // under the shard's lock
+		static bool IsCleared(const Entry& aEntry) { return aEntry.IsCreated && !aEntry.Data; } // under the shard's lock
+
+		Shard& GetShard(const Key& aKey) { return mShards[std::hash<Key>()(aKey) % ShardsCount]; }
+		const Shard& GetShard(const Key& aKey) const { return mShards[std::hash<Key>()(aKey) % ShardsCount]; }
+
+		void FinishEntry(Shard& aShard, const Key& aKey, Entry& aEntry, Value aValue)
+		{
+			{
+				std::lock_guard<std::mutex> lock(aShard.Mutex);
+				aEntry.Data = aValue;
+				aEntry.IsCreated = true;
+				if (!aValue)
+				{
+					aEntry.IsFailed = true;
+					aShard.Entries.erase(aKey); // failed values are not cached
+				}
+			}
+			aEntry.ReadyPromise.set_value();
+		}
+
+		Shard mShards[ShardsCount];
+		ER_JobSystem* mJobSystem = nullptr;
+	};
+
+	class ER_ConcurrentCacheTests
+	{
+	public:
+		// Values are created once under contention (with and without a job system), failed or throwing creations are retried by the waiting threads,
+		// entries that are being created are not found, and cleared values are created again.
+		static bool RunTests(ER_JobSystem* aJobSystem);
+		// Simulates parallel scene loading (many threads requesting overlapping assets with an expensive "import" on a miss) and warm lookups,
+		// and compares one global lock (held during imports and not), the global lock with an in-flight set and the sharded cache.
+		static void Benchmark();
+	};
+}
@@ -159,7 +159,7 @@ namespace EveryRay_Core
 		mMaterial->CreateVertexBuffer(meshes[0], mVertexBuffer);
 		mIndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Debug Proxy Object - Index Buffer");
 		meshes[0].CreateIndexBuffer(mIndexBuffer);
-		mIndexCount = static_cast<UINT>(meshes[0].Indices().size());
+		mIndexCount = meshes[0].IndexCount();
 	}
 
 	void ER_DebugProxyObject::Update(const ER_CoreTime& gameTime)
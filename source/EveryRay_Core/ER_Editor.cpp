@@ -94,6 +94,17 @@ namespace EveryRay_Core
 				ImGui::SliderFloat("Far Plane", &farPlaneDist, 150.0f, 200000.0f);
 				mCamera->SetFarPlaneDistance(farPlaneDist);
 				ImGui::Checkbox("CPU frustum culling", &ER_Utility::IsMainCameraCPUCulling);
+				if (ER_Utility::IsMainCameraCPUCulling)
+				{
+					static const char* cullingModeNames[ER_FRUSTUM_CULLING_MODE_COUNT] = {
+						ER_FrustumCulling::GetModeName(ER_FRUSTUM_CULLING_SCALAR),
+						ER_FrustumCulling::GetModeName(ER_FRUSTUM_CULLING_SSE),
+						ER_FrustumCulling::GetModeName(ER_FRUSTUM_CULLING_AVX)
+					};
+					int cullingMode = static_cast<int>(ER_Utility::MainCameraCPUCullingMode);
+					ImGui::Combo("CPU frustum culling path", &cullingMode, cullingModeNames, ER_FRUSTUM_CULLING_MODE_COUNT);
+					ER_Utility::MainCameraCPUCullingMode = static_cast<ER_FrustumCullingMode>(cullingMode);
+				}
 				ImGui::Checkbox("GPU frustum culling", &ER_Utility::IsMainCameraGPUCulling);
 			}
 
@@ -0,0 +1,212 @@
+#include "ER_FoliageCells.h"
+#include "ER_Frustum.h"
+#include "ER_FrustumCulling.h"
+
+#include <random>
+
+namespace EveryRay_Core
+{
+	void ER_FoliageCells::Build(const XMFLOAT4* aPositions, UINT aPatchesCount, const XMFLOAT3& aCenter, float aSize, const XMFLOAT3& aPatchExtents)
+	{
+		const int cellsPerSide = FOLIAGE_CELLS_PER_SIDE;
+		const float cellSize = std::max(aSize / cellsPerSide, 0.0001f);
+		const float minX = aCenter.x - aSize * 0.5f;
+		const float minZ = aCenter.z - aSize * 0.5f;
+
+		// counting sort of the patches by their cells (stable, so the result only depends on the input)
+		std::vector<UINT> patchCells(aPatchesCount);
+		std::vector<UINT> cellOffsets(cellsPerSide * cellsPerSide + 1, 0);
+		for (UINT i = 0; i < aPatchesCount; i++)
+		{
+			const int x = std::min(std::max(static_cast<int>(floorf((aPositions[i].x - minX) / cellSize)), 0), cellsPerSide - 1);
+			const int z = std::min(std::max(static_cast<int>(floorf((aPositions[i].z - minZ) / cellSize)), 0), cellsPerSide - 1);
+			patchCells[i] = z * cellsPerSide + x;
+			cellOffsets[patchCells[i] + 1]++;
+		}
+		for (int cell = 0; cell < cellsPerSide * cellsPerSide; cell++)
+			cellOffsets[cell + 1] += cellOffsets[cell];
+
+		mPatchOrder.resize(aPatchesCount);
+		{
+			std::vector<UINT> writeOffsets(cellOffsets.begin(), cellOffsets.end() - 1);
+			for (UINT i = 0; i < aPatchesCount; i++)
+				mPatchOrder[writeOffsets[patchCells[i]]++] = i;
+		}
+
+		mCells.clear();
+		for (int cell = 0; cell < cellsPerSide * cellsPerSide; cell++)
+		{
+			const UINT first = cellOffsets[cell];
+			const UINT count = cellOffsets[cell + 1] - first;
+			if (count == 0)
+				continue;
+
+			std::shuffle(mPatchOrder.begin() + first, mPatchOrder.begin() + first + count, std::mt19937(cell));
+
+			XMFLOAT3 minP(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 maxP(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (UINT i = first; i < first + count; i++)
+			{
+				const XMFLOAT4& position = aPositions[mPatchOrder[i]];
+				minP = XMFLOAT3(std::min(minP.x, position.x), std::min(minP.y, position.y), std::min(minP.z, position.z));
+				maxP = XMFLOAT3(std::max(maxP.x, position.x), std::max(maxP.y, position.y), std::max(maxP.z, position.z));
+			}
+
+			FoliageCellGPU cellData;
+			cellData.AABBMin = XMFLOAT3(minP.x - aPatchExtents.x, minP.y - aPatchExtents.y, minP.z - aPatchExtents.z);
+			cellData.AABBMax = XMFLOAT3(maxP.x + aPatchExtents.x, maxP.y + aPatchExtents.y, maxP.z + aPatchExtents.z);
+			cellData.FirstPatch = first;
+			cellData.PatchesCount = count;
+			mCells.push_back(cellData);
+		}
+	}
+
+	UINT ER_FoliageCells::Select(const ER_Frustum* aFrustum, const XMFLOAT3& aCameraPosition, const FoliageLODParams& aLODParams, std::vector<FoliagePatchRange>& aOutRanges) const
+	{
+		aOutRanges.clear();
+
+		UINT patchesCount = 0;
+		for (const auto& cell : mCells)
+		{
+			if (aFrustum && ER_FrustumCulling::IsCulled(*aFrustum, ER_AABB(cell.AABBMin, cell.AABBMax)))
+				continue;
+
+			const UINT count = GetLODPatchesCount(cell, aCameraPosition, aLODParams);
+			if (count == 0)
+				continue;
+
+			if (!aOutRanges.empty() && aOutRanges.back().FirstPatch + aOutRanges.back().PatchesCount == cell.FirstPatch)
+				aOutRanges.back().PatchesCount += count;
+			else
+				aOutRanges.push_back({ cell.FirstPatch, count });
+			patchesCount += count;
+		}
+		return patchesCount;
+	}
+
+	UINT ER_FoliageCells::GetLODPatchesCount(const FoliageCellGPU& aCell, const XMFLOAT3& aCameraPosition, const FoliageLODParams& aLODParams)
+	{
+		// distance to the closest point of the cell (0 inside of it)
+		const float dx = std::max(std::max(aCell.AABBMin.x - aCameraPosition.x, aCameraPosition.x - aCell.AABBMax.x), 0.0f);
+		const float dy = std::max(std::max(aCell.AABBMin.y - aCameraPosition.y, aCameraPosition.y - aCell.AABBMax.y), 0.0f);
+		const float dz = std::max(std::max(aCell.AABBMin.z - aCameraPosition.z, aCameraPosition.z - aCell.AABBMax.z), 0.0f);
+		const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+		const float factor = std::min(std::max((distance - aLODParams.StartDistance) / std::max(aLODParams.MaxDistance, 0.0001f), 0.0f), 1.0f);
+		const float density = (1.0f - factor) * aLODParams.QualityFactor;
+		return std::min(aCell.PatchesCount, static_cast<UINT>(ceilf(static_cast<float>(aCell.PatchesCount) * density)));
+	}
+
+	bool ER_FoliageCells::RunTests()
+	{
+		const UINT patchesCount = 100000;
+		const float zoneSize = 200.0f;
+		const XMFLOAT3 zoneCenter(50.0f, 10.0f, -30.0f);
+		const XMFLOAT3 patchExtents(1.0f, 2.0f, 1.0f);
+
+		std::mt19937 generator(12345);
+		std::uniform_real_distribution<float> unitDistribution(-0.5f, 0.5f);
+		std::vector<XMFLOAT4> positions(patchesCount);
+		for (auto& position : positions)
+			position = XMFLOAT4(zoneCenter.x + unitDistribution(generator) * zoneSize, zoneCenter.y + unitDistribution(generator) * 4.0f, zoneCenter.z + unitDistribution(generator) * zoneSize, 1.0f);
+
+		bool isPassed = true;
+
+		// bucketing: every patch is stored once, inside of the bounds of its cell, and rebuilding gives the same order
+		ER_FoliageCells cells;
+		cells.Build(positions.data(), patchesCount, zoneCenter, zoneSize, patchExtents);
+		{
+			std::vector<bool> isStored(patchesCount, false);
+			UINT nextPatch = 0;
+			for (const auto& cell : cells.GetCells())
+			{
+				isPassed &= cell.FirstPatch == nextPatch && cell.PatchesCount > 0;
+				nextPatch = cell.FirstPatch + cell.PatchesCount;
+				for (UINT i = cell.FirstPatch; i < cell.FirstPatch + cell.PatchesCount; i++)
+				{
+					const UINT patch = cells.GetPatchOrder()[i];
+					isPassed &= !isStored[patch];
+					isStored[patch] = true;
+					const XMFLOAT4& p = positions[patch];
+					isPassed &= p.x >= cell.AABBMin.x && p.y >= cell.AABBMin.y && p.z >= cell.AABBMin.z && p.x <= cell.AABBMax.x && p.y <= cell.AABBMax.y && p.z <= cell.AABBMax.z;
+				}
+			}
+			isPassed &= nextPatch == patchesCount && cells.GetCells().size() == FOLIAGE_CELLS_PER_SIDE * FOLIAGE_CELLS_PER_SIDE;
+
+			ER_FoliageCells cellsRebuilt;
+			cellsRebuilt.Build(positions.data(), patchesCount, zoneCenter, zoneSize, patchExtents);
+			isPassed &= cellsRebuilt.GetPatchOrder() == cells.GetPatchOrder();
+		}
+
+		std::vector<FoliagePatchRange> ranges;
+		FoliageLODParams lodParams;
+		lodParams.StartDistance = 30.0f;
+		lodParams.MaxDistance = 300.0f;
+
+		// LOD: everything from the inside, nothing from far away, and the density goes down with the distance
+		isPassed &= cells.Select(nullptr, zoneCenter, { zoneSize * 2.0f, 1.0f, 1.0f }, ranges) == patchesCount && ranges.size() == 1;
+		isPassed &= cells.Select(nullptr, XMFLOAT3(zoneCenter.x + 1000.0f, zoneCenter.y, zoneCenter.z), lodParams, ranges) == 0 && ranges.empty();
+		UINT lodPatchesCount = 0;
+		{
+			const XMFLOAT3 cameraPosition(zoneCenter.x - zoneSize * 0.5f, zoneCenter.y, zoneCenter.z);
+			lodPatchesCount = cells.Select(nullptr, cameraPosition, lodParams, ranges);
+			isPassed &= lodPatchesCount > 0 && lodPatchesCount < patchesCount;
+
+			auto getDistance = [&cameraPosition](const FoliageCellGPU& aCell)
+			{
+				const float dx = std::max(std::max(aCell.AABBMin.x - cameraPosition.x, cameraPosition.x - aCell.AABBMax.x), 0.0f);
+				const float dy = std::max(std::max(aCell.AABBMin.y - cameraPosition.y, cameraPosition.y - aCell.AABBMax.y), 0.0f);
+				const float dz = std::max(std::max(aCell.AABBMin.z - cameraPosition.z, cameraPosition.z - aCell.AABBMax.z), 0.0f);
+				return sqrtf(dx * dx + dy * dy + dz * dz);
+			};
+			for (const auto& cellA : cells.GetCells())
+			{
+				for (const auto& cellB : cells.GetCells())
+				{
+					if (getDistance(cellA) > getDistance(cellB))
+						continue;
+
+					// B is further from the camera (+ rounding of the counts)
+					const float densityA = static_cast<float>(GetLODPatchesCount(cellA, cameraPosition, lodParams)) / cellA.PatchesCount;
+					const float densityB = static_cast<float>(GetLODPatchesCount(cellB, cameraPosition, lodParams)) / cellB.PatchesCount;
+					isPassed &= densityB <= densityA + 1.0f / cellB.PatchesCount;
+				}
+			}
+
+			FoliageLODParams halfQualityParams = lodParams;
+			halfQualityParams.QualityFactor = 0.5f;
+			const UINT halfQualityCount = cells.Select(nullptr, cameraPosition, halfQualityParams, ranges);
+			isPassed &= halfQualityCount <= lodPatchesCount / 2 + static_cast<UINT>(cells.GetCells().size());
+		}
+
+		// culling: no visible patch is lost (brute force over the positions) and the culled cells are really outside of the frustum
+		UINT visiblePatchesCount = 0;
+		{
+			const XMMATRIX view = XMMatrixLookToRH(XMVectorSet(zoneCenter.x, zoneCenter.y + 5.0f, zoneCenter.z, 1.0f), XMVectorSet(1.0f, -0.2f, 0.3f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			const XMMATRIX projection = XMMatrixPerspectiveFovRH(XM_PIDIV4, 16.0f / 9.0f, 0.5f, 1000.0f);
+			ER_Frustum frustum(XMMatrixMultiply(view, projection));
+
+			visiblePatchesCount = cells.Select(&frustum, zoneCenter, { zoneSize * 2.0f, 1.0f, 1.0f }, ranges);
+			std::vector<bool> isSelected(patchesCount, false);
+			for (const auto& range : ranges)
+				for (UINT i = range.FirstPatch; i < range.FirstPatch + range.PatchesCount; i++)
+					isSelected[cells.GetPatchOrder()[i]] = true;
+
+			for (UINT i = 0; i < patchesCount; i++)
+			{
+				const XMFLOAT3 minP(positions[i].x - patchExtents.x, positions[i].y - patchExtents.y, positions[i].z - patchExtents.z);
+				const XMFLOAT3 maxP(positions[i].x + patchExtents.x, positions[i].y + patchExtents.y, positions[i].z + patchExtents.z);
+				if (!ER_FrustumCulling::IsCulled(frustum, ER_AABB(minP, maxP)))
+					isPassed &= isSelected[i];
+			}
+			isPassed &= visiblePatchesCount > 0 && visiblePatchesCount < patchesCount;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_FoliageCells] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L": " +
+			std::to_wstring(patchesCount) + L" patches in " + std::to_wstring(cells.GetCells().size()) + L" cells, " +
+			std::to_wstring(lodPatchesCount) + L" patches after LOD from the zone border, " + std::to_wstring(visiblePatchesCount) + L" patches after culling\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "Common.h"
+
+#define FOLIAGE_CELLS_PER_SIDE 8 // every foliage zone is split into FOLIAGE_CELLS_PER_SIDE x FOLIAGE_CELLS_PER_SIDE cells (in XZ)
+
+namespace EveryRay_Core
+{
+	class ER_Frustum;
+
+	// Same layout as FoliageCell in FoliageCulling.hlsl
+	struct FoliageCellGPU
+	{
+		XMFLOAT3 AABBMin;
+		UINT FirstPatch;
+		XMFLOAT3 AABBMax;
+		UINT PatchesCount;
+	};
+
+	struct FoliagePatchRange
+	{
+		UINT FirstPatch;
+		UINT PatchesCount;
+	};
+
+	// Density of the patches in a cell: all patches up to StartDistance, then linearly down to none at StartDistance + MaxDistance
+	struct FoliageLODParams
+	{
+		float StartDistance = 0.0f;
+		float MaxDistance = 0.0f;
+		float QualityFactor = 1.0f;
+	};
+
+	// Spatial bucketing of the patches of a foliage zone into a uniform grid of cells with their own bounds.
+	// Patches of one cell are contiguous in the instance buffer and shuffled (deterministically) inside the cell,
+	// so that drawing only the first N patches of a cell thins it out evenly instead of dropping one corner of it.
+	// This is the CPU reference of FoliageCulling.hlsl: both cull whole cells and keep GetLODPatchesCount() patches of the visible ones.
+	class ER_FoliageCells
+	{
+	public:
+		// aCenter/aSize describe the XZ square of the zone (patches outside of it are clamped to the border cells),
+		// aPatchExtents is added around the positions (i.e., half size of the biggest billboard)
+		void Build(const XMFLOAT4* aPositions, UINT aPatchesCount, const XMFLOAT3& aCenter, float aSize, const XMFLOAT3& aPatchExtents);
+
+		// Writes the instance ranges to draw (neighbouring full ranges are merged) and returns the total patches count; aFrustum can be nullptr (no culling)
+		UINT Select(const ER_Frustum* aFrustum, const XMFLOAT3& aCameraPosition, const FoliageLODParams& aLODParams, std::vector<FoliagePatchRange>& aOutRanges) const;
+
+		static UINT GetLODPatchesCount(const FoliageCellGPU& aCell, const XMFLOAT3& aCameraPosition, const FoliageLODParams& aLODParams);
+
+		// Patch index (in the original order) for every instance
+		const std::vector<UINT>& GetPatchOrder() const { return mPatchOrder; }
+		// Only non-empty cells are kept
+		const std::vector<FoliageCellGPU>& GetCells() const { return mCells; }
+
+		// Bucketing, culling and LOD of the CPU reference path (see ER_Tests)
+		static bool RunTests();
+	private:
+		std::vector<UINT> mPatchOrder;
+		std::vector<FoliageCellGPU> mCells;
+	};
+}
@@ -16,9 +16,19 @@
 #include "ER_Terrain.h"
 #include "ER_GBuffer.h"
 #include "ER_Wind.h"
+#include "ER_Frustum.h"
+#include "ER_FrustumCulling.h"
+#include "ER_JobSystem.h"
+
+#include <algorithm>
 
 #define FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX 0
 #define FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX 1
+#define FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_VERTEX_SRV_INDEX 2
+
+#define FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX 0
+#define FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_UAV_INDEX 1
+#define FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX 2
 
 namespace EveryRay_Core
 {
@@ -26,7 +36,7 @@ namespace EveryRay_Core
 	static const float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
 	ER_FoliageManager::ER_FoliageManager(ER_Core& pCore, ER_Scene* aScene, ER_DirectionalLight& light, FoliageQuality aQuality)
-		: ER_CoreComponent(pCore), mScene(aScene), mCurrentFoliageQuality(aQuality)
+		: ER_CoreComponent(pCore), mScene(aScene), mDirectionalLight(light), mCurrentFoliageQuality(aQuality)
 	{
 		assert(aScene);
 		if (aScene->IsValueInSceneRoot("foliage_zones"))
@@ -38,16 +48,48 @@ namespace EveryRay_Core
 			mHasFoliage = false;
 
 		ER_RHI* rhi = pCore.GetRHI();
-		mRootSignature = rhi->CreateRootSignature(2, 2);
+		mRootSignature = rhi->CreateRootSignature(3, 2);
 		if (mRootSignature)
 		{
 			mRootSignature->InitStaticSampler(rhi, 0, ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP);
 			mRootSignature->InitStaticSampler(rhi, 1, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS);
 			mRootSignature->InitDescriptorTable(rhi, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 4 }, ER_RHI_SHADER_VISIBILITY_ALL);
 			mRootSignature->InitDescriptorTable(rhi, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV }, { 0 }, { 1 }, ER_RHI_SHADER_VISIBILITY_ALL);
+			mRootSignature->InitDescriptorTable(rhi, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_VERTEX_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 4 }, { 1 }, ER_RHI_SHADER_VISIBILITY_VERTEX);
 			mRootSignature->Finalize(rhi, "ER_RHI_GPURootSignature: Foliage", true);
 		}
 
+		//shaders (shared by all the batches)
+		{
+			ER_RHI_INPUT_ELEMENT_DESC inputElementDescriptions[] =
+			{
+				{ "POSITION", 0, ER_FORMAT_R32G32B32A32_FLOAT, 0, 0, true, 0 },
+				{ "TEXCOORD", 0, ER_FORMAT_R32G32_FLOAT, 0, 0xffffffff, true, 0 },
+				{ "NORMAL", 0, ER_FORMAT_R32G32B32_FLOAT, 0, 0xffffffff, true, 0 },
+				{ "WORLD", 0, ER_FORMAT_R32G32B32A32_FLOAT, 1, 0,  false, 1 },
+				{ "WORLD", 1, ER_FORMAT_R32G32B32A32_FLOAT, 1, 16, false, 1 },
+				{ "WORLD", 2, ER_FORMAT_R32G32B32A32_FLOAT, 1, 32, false, 1 },
+				{ "WORLD", 3, ER_FORMAT_R32G32B32A32_FLOAT, 1, 48, false, 1 }
+			};
+			mInputLayout = rhi->CreateInputLayout(inputElementDescriptions, ARRAYSIZE(inputElementDescriptions));
+			mInputLayoutIndirect = rhi->CreateInputLayout(inputElementDescriptions, 3 /* no instance buffer */);
+
+			mVS = rhi->CreateGPUShader();
+			mVS->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "VSMain", ER_VERTEX, mInputLayout);
+
+			mVS_Indirect = rhi->CreateGPUShader();
+			mVS_Indirect->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "VSMain_indirect", ER_VERTEX, mInputLayoutIndirect);
+
+			mGS = rhi->CreateGPUShader();
+			mGS->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "GSMain", ER_GEOMETRY);
+
+			mPS_GBuffer = rhi->CreateGPUShader();
+			mPS_GBuffer->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "PSMain_gbuffer", ER_PIXEL);
+
+			mPS_Voxelization = rhi->CreateGPUShader();
+			mPS_Voxelization->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "PSMain_voxelization", ER_PIXEL);
+		}
+
 		switch (mCurrentFoliageQuality)
 		{
 		case FoliageQuality::FOLIAGE_ULTRA_LOW:
@@ -67,13 +109,40 @@ namespace EveryRay_Core
 
 	ER_FoliageManager::~ER_FoliageManager()
 	{
+		DeletePointerCollection(mBatches);
 		DeletePointerCollection(mFoliageCollection);
 		DeleteObject(FoliageSystemInitializedEvent);
 		DeleteObject(mRootSignature);
+		DeleteObject(mInputLayout);
+		DeleteObject(mInputLayoutIndirect);
+		DeleteObject(mVS);
+		DeleteObject(mVS_Indirect);
+		DeleteObject(mGS);
+		DeleteObject(mPS_GBuffer);
+		DeleteObject(mPS_Voxelization);
+		DeleteObject(mCullingCS);
+		DeleteObject(mCullingClearArgsCS);
+		DeleteObject(mCullingRootSignature);
 	}
 
 	void ER_FoliageManager::Initialize()
 	{
+		ER_RHI* rhi = GetCore()->GetRHI();
+
+		mCullingCS = rhi->CreateGPUShader();
+		mCullingCS->CompileShader(rhi, "content\\shaders\\FoliageCulling.hlsl", "CSMain", ER_COMPUTE);
+		mCullingClearArgsCS = rhi->CreateGPUShader();
+		mCullingClearArgsCS->CompileShader(rhi, "content\\shaders\\FoliageCulling.hlsl", "CSClearArgs", ER_COMPUTE);
+
+		mCullingRootSignature = rhi->CreateRootSignature(3, 0);
+		if (mCullingRootSignature)
+		{
+			mCullingRootSignature->InitDescriptorTable(rhi, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 3 });
+			mCullingRootSignature->InitDescriptorTable(rhi, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_UAV }, { 0 }, { 2 });
+			mCullingRootSignature->InitDescriptorTable(rhi, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV }, { 0 }, { 1 });
+			mCullingRootSignature->Finalize(rhi, "ER_RHI_GPURootSignature: Foliage Culling");
+		}
+
 		int zoneIndex = 0;
 		std::string name;
 		for (auto& foliage : mFoliageCollection)
@@ -86,40 +155,220 @@ namespace EveryRay_Core
 			//name += "\n";
 			//ER_OUTPUT_LOG(ER_Utility::ToWideString(name).c_str());
 		}
+		CreateBatches();
 
 		for (auto listener : FoliageSystemInitializedEvent->GetListeners())
 			listener();
 	}
 
+	// Zones with the same billboard type and texture go to the same batch (in the order of the zones)
+	void ER_FoliageManager::CreateBatches()
+	{
+		DeletePointerCollection(mBatches);
+		mBatches.clear();
+
+		for (auto& foliage : mFoliageCollection)
+		{
+			auto batchIt = std::find_if(mBatches.begin(), mBatches.end(),
+				[foliage](const ER_FoliageBatch* aBatch) { return aBatch->IsMatching(foliage->GetBillboardType(), foliage->GetTextureName()); });
+			if (batchIt == mBatches.end())
+			{
+				mBatches.push_back(new ER_FoliageBatch(*GetCore(), foliage->GetBillboardType(), foliage->GetTextureName()));
+				batchIt = mBatches.end() - 1;
+			}
+			(*batchIt)->AddZone(foliage);
+		}
+
+		for (auto& batch : mBatches)
+			batch->Initialize();
+
+		if (mFoliageCollection.size() > 0)
+		{
+			std::wstring msg = L"[ER Logger][ER_FoliageManager] Foliage zones: " + std::to_wstring(mFoliageCollection.size()) + L", batches: " + std::to_wstring(mBatches.size()) + L"\n";
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+	}
+
 	void ER_FoliageManager::Update(const ER_CoreTime& gameTime)
 	{
 		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
 
+		mLastFrameDrawStats = mDrawStats;
+		mDrawStats = FoliageDrawStats();
+
 		if (mEnabled)
 		{
+			ER_PROFILE_SCOPE("ER_FoliageManager::Update");
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			// editor and gizmos (not thread-safe)
 			for (auto& foliage : mFoliageCollection)
+				foliage->Update(gameTime);
+
+			// culling and LOD of the zones and their cells
+			const bool isFrustumCulling = IsFrustumCulling() && camera;
+			const ER_Frustum frustum = isFrustumCulling ? camera->GetFrustum() : ER_Frustum(XMMatrixIdentity());
+			auto updateZone = [&](UINT aZoneIndex)
 			{
+				ER_Foliage* foliage = mFoliageCollection[aZoneIndex];
 				foliage->SetDynamicDeltaDistanceToCamera(mDeltaDistanceToCamera);
 				foliage->SetDynamicLODMaxDistance(mMaxDistanceToCamera);
+				foliage->UpdateVisiblePatches(isFrustumCulling ? &frustum : nullptr);
+			};
 
-				foliage->Update(gameTime);
-				foliage->PerformCPUFrustumCulling((ER_Utility::IsMainCameraCPUCulling && mEnableCulling) ? camera : nullptr);
+			const UINT zonesCount = static_cast<UINT>(mFoliageCollection.size());
+			ER_JobSystem* jobSystem = GetCore()->GetJobSystem();
+			if (jobSystem && zonesCount > FOLIAGE_ZONES_PER_JOB)
+			{
+				ER_JobCounter counter;
+				jobSystem->ParallelFor(zonesCount, FOLIAGE_ZONES_PER_JOB, updateZone, &counter);
+				jobSystem->Wait(counter);
+			}
+			else
+			{
+				for (UINT zoneIndex = 0; zoneIndex < zonesCount; zoneIndex++)
+					updateZone(zoneIndex);
+			}
+
+			for (auto& batch : mBatches)
+			{
+				batch->Update(mEnableGPUCulling);
+				mDrawStats.VisibleZones += batch->GetVisibleZonesCount();
 			}
+
+			std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - startTime;
+			mDrawStats.UpdateTimeMs = time.count();
 		}
-		UpdateImGui();
+		UpdateImGui(gameTime);
 	}
 
 	void ER_FoliageManager::Draw(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, FoliageRenderingPass renderPass,
-		const std::vector<ER_RHI_GPUTexture*>& aGbufferTextures, ER_RHI_GPUTexture* aDepthTarget)
+		ER_RHI_Span<ER_RHI_GPUTexture*> aGbufferTextures, ER_RHI_GPUTexture* aDepthTarget)
 	{
-		if (!mEnabled)
+		if (!mEnabled || mBatches.size() == 0)
+			return;
+
+		if (renderPass == FOLIAGE_GBUFFER && !(GetCore()->GetLevel()->mGBuffer->IsEnabled()))
 			return;
 
+		if (renderPass == FOLIAGE_VOXELIZATION)
+			assert(worldShadowMapper);
+
+		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
+		assert(camera);
+
 		ER_RHI* rhi = GetCore()->GetRHI();
 		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		rhi->SetRootSignature(mRootSignature);
-		for (auto& object : mFoliageCollection)
-			object->Draw(gameTime, worldShadowMapper, renderPass, aGbufferTextures, aDepthTarget, mRootSignature);
+
+		// one PSO for all the batches
+		bool isVoxelizationRenderPass = renderPass == FOLIAGE_VOXELIZATION;
+		std::string psoName = ER_Utility::IsWireframe ? mFoliageGBufferPassWireframePSOName : mFoliageGBufferPassPSOName;
+		if (isVoxelizationRenderPass)
+			psoName = mFoliageVoxelizationPassPSOName;
+		if (mEnableGPUCulling)
+			psoName += " (Indirect)";
+
+		if (!rhi->IsPSOReady(psoName))
+		{
+			rhi->InitializePSO(psoName);
+			rhi->SetBlendState(ER_ALPHA_TO_COVERAGE_4_TARGETS, blendFactor, 0xffffffff);
+			rhi->SetRasterizerState((ER_Utility::IsWireframe && !isVoxelizationRenderPass) ? ER_RHI_RASTERIZER_STATE::ER_WIREFRAME : ER_RHI_RASTERIZER_STATE::ER_NO_CULLING);
+			rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
+			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			rhi->SetRootSignatureToPSO(psoName, mRootSignature);
+			rhi->SetInputLayout(mEnableGPUCulling ? mInputLayoutIndirect : mInputLayout);
+			rhi->SetShader(mEnableGPUCulling ? mVS_Indirect : mVS);
+			if (isVoxelizationRenderPass)
+			{
+				rhi->SetShader(mGS);
+				rhi->SetShader(mPS_Voxelization);
+			}
+			else
+			{
+				assert(aGbufferTextures.size() > 0);
+				rhi->SetShader(mPS_GBuffer);
+				rhi->SetRenderTargetFormats(aGbufferTextures, aDepthTarget);
+			}
+			rhi->FinalizePSO(psoName);
+		}
+		rhi->SetPSO(psoName);
+		for (auto& batch : mBatches)
+		{
+			if (batch->GetPatchesCountToRender() == 0)
+				continue;
+
+			const UINT drawsCount = batch->Draw(gameTime, worldShadowMapper, *camera, mDirectionalLight, mRootSignature, mEnableGPUCulling);
+			if (drawsCount > 0)
+			{
+				mDrawStats.Draws += drawsCount;
+				mDrawStats.Instances += batch->GetPatchesCountToRender();
+				mDrawStats.Triangles += batch->GetPatchesCountToRender() * batch->GetIndicesCountPerPatch() / 3;
+			}
+		}
+		rhi->UnsetPSO();
+
+		rhi->SetBlendState(ER_NO_BLEND);
+		rhi->UnbindResourcesFromShader(ER_VERTEX);
+		rhi->UnbindResourcesFromShader(ER_GEOMETRY);
+		rhi->UnbindResourcesFromShader(ER_PIXEL);
+	}
+
+	// Culls and compacts the patches of all batches into their indirect draws (the zones themselves were culled in Update())
+	void ER_FoliageManager::PerformGPUCulling(ER_Camera* aCamera)
+	{
+		if (!mEnabled || !mEnableGPUCulling || mBatches.size() == 0)
+			return;
+
+		assert(aCamera);
+		ER_RHI* rhi = GetCore()->GetRHI();
+		const ER_Frustum frustum = aCamera->GetFrustum();
+
+		rhi->SetRootSignature(mCullingRootSignature, true);
+		if (!rhi->IsPSOReady(mCullingClearArgsPSOName, true))
+		{
+			rhi->InitializePSO(mCullingClearArgsPSOName, true);
+			rhi->SetShader(mCullingClearArgsCS);
+			rhi->SetRootSignatureToPSO(mCullingClearArgsPSOName, mCullingRootSignature, true);
+			rhi->FinalizePSO(mCullingClearArgsPSOName, true);
+		}
+		rhi->SetPSO(mCullingClearArgsPSOName, true);
+		for (auto& batch : mBatches)
+		{
+			if (batch->GetPatchesCountToRender() == 0)
+				continue;
+
+			batch->UpdateGPUCullingConstants(frustum, aCamera->Position(), !IsFrustumCulling());
+			rhi->SetUnorderedAccessResources(ER_COMPUTE, { batch->GetCullingOutputInstanceBuffer(), batch->GetIndirectArgsBuffer() }, 0,
+				mCullingRootSignature, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, true);
+			rhi->SetConstantBuffers(ER_COMPUTE, { batch->GetCullingConstantBuffer() }, 0, mCullingRootSignature, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, true);
+			rhi->Dispatch(1u, 1u, 1u);
+		}
+		rhi->UnsetPSO();
+
+		if (!rhi->IsPSOReady(mCullingPSOName, true))
+		{
+			rhi->InitializePSO(mCullingPSOName, true);
+			rhi->SetShader(mCullingCS);
+			rhi->SetRootSignatureToPSO(mCullingPSOName, mCullingRootSignature, true);
+			rhi->FinalizePSO(mCullingPSOName, true);
+		}
+		rhi->SetPSO(mCullingPSOName, true);
+		for (auto& batch : mBatches)
+		{
+			if (batch->GetPatchesCountToRender() == 0)
+				continue;
+
+			rhi->SetShaderResources(ER_COMPUTE, { batch->GetCullingInputInstanceBuffer(), batch->GetCellsBuffer(), batch->GetZonesBuffer() }, 0,
+				mCullingRootSignature, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, true);
+			rhi->SetUnorderedAccessResources(ER_COMPUTE, { batch->GetCullingOutputInstanceBuffer(), batch->GetIndirectArgsBuffer() }, 0,
+				mCullingRootSignature, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, true);
+			rhi->SetConstantBuffers(ER_COMPUTE, { batch->GetCullingConstantBuffer() }, 0, mCullingRootSignature, FOLIAGE_CULLING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, true);
+			rhi->Dispatch(batch->GetDispatchGroupsX(), batch->GetDispatchGroupsY(), 1u);
+			mDrawStats.Dispatches += 2; // with the clear
+		}
+		rhi->UnsetPSO();
+		rhi->UnbindResourcesFromShader(ER_COMPUTE);
 	}
 
 	void ER_FoliageManager::DrawDebugGizmos(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs)
@@ -129,6 +378,7 @@ namespace EveryRay_Core
 				object->DrawDebugGizmos(aRenderTarget, aDepth, rs);
 	}
 
+	// Zones must be added before Initialize() (batches are created there)
 	void ER_FoliageManager::AddFoliage(ER_Foliage* foliage)
 	{
 		assert(foliage);
@@ -138,18 +388,24 @@ namespace EveryRay_Core
 
 	void ER_FoliageManager::SetVoxelizationParams(float* scale, const float* dimensions, XMFLOAT4* voxelCamera)
 	{
-		for (auto& object : mFoliageCollection)
-			object->SetVoxelizationParams(scale, dimensions, voxelCamera);
+		for (auto& batch : mBatches)
+			batch->SetVoxelizationParams(scale, dimensions, voxelCamera);
 	}
 	
-	void ER_FoliageManager::UpdateImGui()
+	bool ER_FoliageManager::IsFrustumCulling()
+	{
+		return mEnableCulling && (mEnableGPUCulling ? ER_Utility::IsMainCameraGPUCulling : ER_Utility::IsMainCameraCPUCulling);
+	}
+
+	void ER_FoliageManager::UpdateImGui(const ER_CoreTime& gameTime)
 	{
 		if (!mShowDebug || mFoliageCollection.size() == 0)
 			return;
 
 		ImGui::Begin("Foliage System");
 		ImGui::Checkbox("Enabled", &mEnabled);
-		ImGui::Checkbox("CPU frustum cull", &mEnableCulling);
+		ImGui::Checkbox("Frustum cull", &mEnableCulling);
+		ImGui::Checkbox("GPU culling (compute)", &mEnableGPUCulling);
 		ImGui::SliderFloat("Max LOD distance", &mMaxDistanceToCamera, 150.0f, 1500.0f);
 		ImGui::SliderFloat("Delta LOD distance", &mDeltaDistanceToCamera, 15.0f, 150.0f);
 		ImGui::Checkbox("Open foliage editor (must be in editor mode!)", &ER_Utility::IsFoliageEditor);
@@ -160,11 +416,29 @@ namespace EveryRay_Core
 		if (ImGui::Button("Save foliage changes"))
 			mScene->SaveFoliageZonesData(mFoliageCollection);
 
+		mFoliageZonesNamesUI.resize(mFoliageCollection.size());
 		for (int i = 0; i < mFoliageCollection.size(); i++)
 			mFoliageZonesNamesUI[i] = mFoliageCollection[i]->GetName().c_str();
 
+		UINT patchesCount = 0;
+		for (auto& batch : mBatches)
+			patchesCount += batch->GetPatchesCount();
+
+		const FoliageDrawStats& stats = mLastFrameDrawStats;
+		std::string batchesText = "Zones: " + std::to_string(stats.VisibleZones) + " / " + std::to_string(mFoliageCollection.size()) + " visible in " + std::to_string(mBatches.size()) + " batches";
+		ImGui::Text(batchesText.c_str());
+		std::string patchesText = "Patches rendered: " + std::to_string(stats.Instances) + " / " + std::to_string(patchesCount) + " (" + std::to_string(stats.Draws) + " draws, " +
+			std::to_string(stats.Dispatches) + " dispatches)";
+		ImGui::Text(patchesText.c_str());
+		const double elapsedTime = gameTime.ElapsedCoreTime();
+		std::string throughputText = "Triangles: " + std::to_string(stats.Triangles) + ", instances/draw: " + std::to_string(stats.Draws > 0 ? stats.Instances / stats.Draws : 0) +
+			", instances/s: " + std::to_string(elapsedTime > 0.0 ? static_cast<UINT64>(stats.Instances / elapsedTime) : 0);
+		ImGui::Text(throughputText.c_str());
+		std::string updateText = "CPU update: " + std::to_string(stats.UpdateTimeMs) + " ms";
+		ImGui::Text(updateText.c_str());
+
 		ImGui::PushItemWidth(-1);
-		ImGui::ListBox("##empty", &mEditorSelectedFoliageZoneIndex, mFoliageZonesNamesUI, static_cast<int>(mFoliageCollection.size()), 15);
+		ImGui::ListBox("##empty", &mEditorSelectedFoliageZoneIndex, mFoliageZonesNamesUI.data(), static_cast<int>(mFoliageCollection.size()), 15);
 		ImGui::End();
 
 		for (int i = 0; i < mFoliageCollection.size(); i++)
@@ -174,7 +448,7 @@ namespace EveryRay_Core
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	ER_Foliage::ER_Foliage(ER_Core& pCore, ER_Camera& pCamera, ER_DirectionalLight& pLight, int pPatchesCount, const std::string& textureName, float scale, float distributionRadius,
-		const XMFLOAT3& distributionCenter, FoliageBillboardType bType, bool isPlacedOnTerrain, int placeChannel, float placedHeightDelta)
+		const XMFLOAT3& distributionCenter, FoliageBillboardType bType, bool isPlacedOnTerrain, int placeChannel, float placedHeightDelta, UINT placementSeed)
 		:
 		mCore(pCore),
 		mCamera(pCamera),
@@ -188,117 +462,27 @@ namespace EveryRay_Core
 		mTextureName(textureName),
 		mIsPlacedOnTerrain(isPlacedOnTerrain),
 		mTerrainSplatChannel(placeChannel),
-		mPlacementHeightDelta(placedHeightDelta)
+		mPlacementHeightDelta(placedHeightDelta),
+		mPlacementSeed(placementSeed)
 	{
-		auto rhi = mCore.GetRHI();
-
-		//shaders
-		{
-			ER_RHI_INPUT_ELEMENT_DESC inputElementDescriptions[] =
-			{
-				{ "POSITION", 0, ER_FORMAT_R32G32B32A32_FLOAT, 0, 0, true, 0 },
-				{ "TEXCOORD", 0, ER_FORMAT_R32G32_FLOAT, 0, 0xffffffff, true, 0 },
-				{ "NORMAL", 0, ER_FORMAT_R32G32B32_FLOAT, 0, 0xffffffff, true, 0 },
-				{ "WORLD", 0, ER_FORMAT_R32G32B32A32_FLOAT, 1, 0,  false, 1 },
-				{ "WORLD", 1, ER_FORMAT_R32G32B32A32_FLOAT, 1, 16, false, 1 },
-				{ "WORLD", 2, ER_FORMAT_R32G32B32A32_FLOAT, 1, 32, false, 1 },
-				{ "WORLD", 3, ER_FORMAT_R32G32B32A32_FLOAT, 1, 48, false, 1 }
-			};
-			mInputLayout = rhi->CreateInputLayout(inputElementDescriptions, ARRAYSIZE(inputElementDescriptions));
-
-			mVS = rhi->CreateGPUShader();
-			mVS->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "VSMain", ER_VERTEX, mInputLayout);
-
-			mGS = rhi->CreateGPUShader();
-			mGS->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "GSMain", ER_GEOMETRY);
-
-			mPS = rhi->CreateGPUShader();
-			mPS->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "PSMain", ER_PIXEL);
-
-			mPS_GBuffer = rhi->CreateGPUShader();
-			mPS_GBuffer->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "PSMain_gbuffer", ER_PIXEL);
-
-			mPS_Voxelization = rhi->CreateGPUShader();
-			mPS_Voxelization->CompileShader(rhi, "content\\shaders\\Foliage.hlsl", "PSMain_voxelization", ER_PIXEL);
-		}
-
-		LoadBillboardModel(mType);
-
-		mAlbedoTexture = rhi->CreateGPUTexture(L"");
-		mAlbedoTexture->CreateGPUTextureResource(rhi, textureName, true);
-		rhi->GenerateMipsWithTextureReplacement(&mAlbedoTexture,
-			[this](ER_RHI_GPUTexture** aNewTextureWithMips)
-			{
-				assert(*aNewTextureWithMips);
-				DeleteObject(mAlbedoTexture);
-				mAlbedoTexture = *aNewTextureWithMips;
-			}
-		);
 	}
 
 	ER_Foliage::~ER_Foliage()
 	{
-		DeleteObject(mVertexBuffer);
-		DeleteObject(mInstanceBuffer);
-		DeleteObject(mIndexBuffer);
-		DeleteObject(mAlbedoTexture);
 		DeleteObjects(mPatchesBufferCPU);
 		DeleteObjects(mCurrentPositions);
 		DeleteObjects(mPatchesBufferGPU);
 		DeleteObject(mDebugGizmoAABB);
-		DeleteObject(mInputLayout);
-		DeleteObject(mVS);
-		DeleteObject(mGS);
-		DeleteObject(mPS);
-		DeleteObject(mPS_GBuffer);
-		DeleteObject(mPS_Voxelization);
 		DeleteObject(mInputPositionsOnTerrainBuffer);
 		DeleteObject(mOutputPositionsOnTerrainBuffer);
-		mFoliageConstantBuffer.Release();
 	}
 
-	void ER_Foliage::LoadBillboardModel(FoliageBillboardType bType)
-	{
-		auto rhi = mCore.GetRHI();
-
-		mVertexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage - Vertex Buffer");
-		mIndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage - Index Buffer");
-		if (bType == FoliageBillboardType::SINGLE) {
-			mIsRotating = true;
-			std::unique_ptr<ER_Model> quadSingleModel(new ER_Model(mCore, ER_Utility::GetFilePath("content\\models\\vegetation\\foliage_quad_single.obj"), true));
-			quadSingleModel->GetMesh(0).CreateVertexBuffer_PositionUvNormal(mVertexBuffer);
-			quadSingleModel->GetMesh(0).CreateIndexBuffer(mIndexBuffer);
-			mVerticesCount = static_cast<int>(quadSingleModel->GetMesh(0).Indices().size());
-		}
-		else if (bType == FoliageBillboardType::TWO_QUADS_CROSSING) {
-			mIsRotating = false;
-			std::unique_ptr<ER_Model> quadDoubleModel(new ER_Model(mCore, ER_Utility::GetFilePath("content\\models\\vegetation\\foliage_quad_double.obj"), true));
-			quadDoubleModel->GetMesh(0).CreateVertexBuffer_PositionUvNormal(mVertexBuffer);
-			quadDoubleModel->GetMesh(0).CreateIndexBuffer(mIndexBuffer);
-			mVerticesCount = static_cast<int>(quadDoubleModel->GetMesh(0).Indices().size());
-		}
-		else if (bType == FoliageBillboardType::THREE_QUADS_CROSSING) {
-			mIsRotating = false;
-			std::unique_ptr<ER_Model> quadTripleModel(new ER_Model(mCore, ER_Utility::GetFilePath("content\\models\\vegetation\\foliage_quad_triple.obj"), true));
-			quadTripleModel->GetMesh(0).CreateVertexBuffer_PositionUvNormal(mVertexBuffer);
-			quadTripleModel->GetMesh(0).CreateIndexBuffer(mIndexBuffer);
-			mVerticesCount = static_cast<int>(quadTripleModel->GetMesh(0).Indices().size());
-		}
-		else if (bType == FoliageBillboardType::MULTIPLE_QUADS_CROSSING) {
-			mIsRotating = false;
-			std::unique_ptr<ER_Model> quadMultipleModel(new ER_Model(mCore, ER_Utility::GetFilePath("content\\models\\vegetation\\foliage_quad_multiple.obj"), true));
-			quadMultipleModel->GetMesh(0).CreateVertexBuffer_PositionUvNormal(mVertexBuffer);
-			quadMultipleModel->GetMesh(0).CreateIndexBuffer(mIndexBuffer);
-			mVerticesCount = static_cast<int>(quadMultipleModel->GetMesh(0).Indices().size());
-		}
-	}
 	void ER_Foliage::Initialize()
 	{
 		ER_RHI* rhi = mCore.GetRHI();
 
-		mFoliageConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Foliage CB");
 		InitializeBuffersCPU();
-		InitializeBuffersGPU(mPatchesCount);
+		InitializeInstancesData(mPatchesCount);
 
 		float radius = mDistributionRadius * 0.5f + mAABBExtentXZ;
 		XMFLOAT3 minP = XMFLOAT3(mDistributionCenter.x - radius, mDistributionCenter.y - mAABBExtentY, mDistributionCenter.z - radius);
@@ -312,7 +496,14 @@ namespace EveryRay_Core
 		{
 			ER_Terrain* terrain = mCore.GetLevel()->mTerrain;
 			assert(terrain);
-			if (terrain && terrain->IsLoaded())
+			if (terrain && terrain->IsCPUPlacementEnabled())
+			{
+				terrain->PlaceOnTerrainCPU(mCurrentPositions, mPatchesCount, (TerrainSplatChannels)mTerrainSplatChannel, mPlacementHeightDelta, mCore.GetJobSystem());
+				UpdateBuffersCPU();
+				UpdateBuffersGPU();
+				UpdateAABB();
+			}
+			else if (terrain && terrain->IsLoaded())
 			{
 				DeleteObject(mInputPositionsOnTerrainBuffer);
 				DeleteObject(mOutputPositionsOnTerrainBuffer);
@@ -347,148 +538,58 @@ namespace EveryRay_Core
 		ER_MatrixHelper::SetFloatArray(mTransformationMatrix, mCurrentObjectTransformMatrix);
 	}
 
-	void ER_Foliage::InitializeBuffersGPU(int count)
+	// instances for the pool of the batch
+	void ER_Foliage::InitializeInstancesData(int count)
 	{
-		auto rhi = mCore.GetRHI();
-
 		assert(count > 0);
 
-		// instance buffer
 		int instanceCount = count;
 		mPatchesBufferGPU = new GPUFoliageInstanceData[instanceCount];
 
+		ER_PlacementRandom random(mPlacementSeed, 2 /* scales */);
 		for (int i = 0; i < instanceCount; i++)
 		{
-			float randomScale = ER_Utility::RandomFloat(mScale - 1.0f, mScale + 1.0f);
+			float randomScale = random.NextFloat(mScale - 1.0f, mScale + 1.0f);
 			mPatchesBufferCPU[i].scale = randomScale;
-			mPatchesBufferGPU[i].worldMatrix = XMMatrixScaling(randomScale, randomScale, randomScale) * XMMatrixTranslation(mPatchesBufferCPU[i].xPos, mPatchesBufferCPU[i].yPos, mPatchesBufferCPU[i].zPos);
 			//mPatchesBufferGPU[i].color = XMFLOAT3(mPatchesBufferCPU[i].r, mPatchesBufferCPU[i].g, mPatchesBufferCPU[i].b);
 			mCurrentPositions[i] = XMFLOAT4(mPatchesBufferCPU[i].xPos, mPatchesBufferCPU[i].yPos, mPatchesBufferCPU[i].zPos, 1.0f);
 		}
-
-		mInstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage instance buffer");
-		mInstanceBuffer->CreateGPUBufferResource(mCore.GetRHI(), mPatchesBufferGPU, instanceCount, sizeof(GPUFoliageInstanceData), true, ER_BIND_VERTEX_BUFFER);
+		UpdateCells();
+		mAreInstancesDirty = true;
 	}
 
 	void ER_Foliage::InitializeBuffersCPU()
 	{
-		// randomly generate positions and color
+		// generate positions (blue noise, denser on the terrain splat channel if there is one) and colors from the zone's seed
 		mPatchesBufferCPU = new CPUFoliageData[mPatchesCount];
 		mCurrentPositions = new XMFLOAT4[mPatchesCount];
 
-		for (int i = 0; i < mPatchesCount; i++)
-		{
-			mPatchesBufferCPU[i].xPos = mDistributionCenter.x + ((float)rand() / (float)(RAND_MAX)) * mDistributionRadius - mDistributionRadius /2;
-			mPatchesBufferCPU[i].yPos = mDistributionCenter.y;
-			mPatchesBufferCPU[i].zPos = mDistributionCenter.z + ((float)rand() / (float)(RAND_MAX)) * mDistributionRadius - mDistributionRadius /2;
-			mCurrentPositions[i] = XMFLOAT4(mPatchesBufferCPU[i].xPos, mPatchesBufferCPU[i].yPos, mPatchesBufferCPU[i].zPos, 1.0f);
+		ER_PlacementDesc placementDesc;
+		placementDesc.MinXZ = XMFLOAT2(mDistributionCenter.x - mDistributionRadius / 2, mDistributionCenter.z - mDistributionRadius / 2);
+		placementDesc.MaxXZ = XMFLOAT2(mDistributionCenter.x + mDistributionRadius / 2, mDistributionCenter.z + mDistributionRadius / 2);
+		placementDesc.PointsCount = static_cast<UINT>(mPatchesCount);
+		placementDesc.Seed = mPlacementSeed;
+		ER_Terrain* terrain = mCore.GetLevel()->mTerrain;
+		if (mIsPlacedOnTerrain && terrain && terrain->IsLoaded())
+			placementDesc.DensityMask = ER_Placement::CreateSplatDensityMask(terrain, mTerrainSplatChannel);
 
-			mPatchesBufferCPU[i].r = ((float)rand() / (float)(RAND_MAX)) * 1.0f + 1.0f;
-			mPatchesBufferCPU[i].g = ((float)rand() / (float)(RAND_MAX)) * 1.0f + 0.5f;
-			mPatchesBufferCPU[i].b = 0.0f;
-		}
-	}
+		std::vector<XMFLOAT4> positions;
+		ER_Placement::GeneratePoints(placementDesc, mDistributionCenter.y, positions, mCore.GetJobSystem());
 
-	void ER_Foliage::PrepareRendering(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, ER_RHI_GPURootSignature* rs)
-	{
-		auto rhi = mCore.GetRHI();
-		const ER_Wind* wind = mCore.GetLevel()->mWind;
-
-		if (worldShadowMapper)
-		{
-			for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
-				mFoliageConstantBuffer.Data.ShadowMatrices[cascade] = XMMatrixTranspose(worldShadowMapper->GetViewMatrix(cascade) * worldShadowMapper->GetProjectionMatrix(cascade) * XMLoadFloat4x4(&ER_MatrixHelper::GetProjectionShadowMatrix()));
-			mFoliageConstantBuffer.Data.ShadowTexelSize = XMFLOAT4{ 1.0f / worldShadowMapper->GetResolution(), 1.0f, 1.0f , 1.0f };
-			mFoliageConstantBuffer.Data.ShadowCascadeDistances = XMFLOAT4{ worldShadowMapper->GetCameraFarShadowCascadeDistance(0),worldShadowMapper->GetCameraFarShadowCascadeDistance(1), worldShadowMapper->GetCameraFarShadowCascadeDistance(2), 1.0f };
-		}
-
-		mFoliageConstantBuffer.Data.World = XMMatrixIdentity();
-		mFoliageConstantBuffer.Data.View = XMMatrixTranspose(mCamera.ViewMatrix());
-		mFoliageConstantBuffer.Data.Projection = XMMatrixTranspose(mCamera.ProjectionMatrix());
-		mFoliageConstantBuffer.Data.SunDirection = XMFLOAT4(-mDirectionalLight.Direction().x, -mDirectionalLight.Direction().y, -mDirectionalLight.Direction().z, 1.0f);
-		mFoliageConstantBuffer.Data.SunColor = XMFLOAT4{ mDirectionalLight.GetColor().x, mDirectionalLight.GetColor().y, mDirectionalLight.GetColor().z , 1.0f };
-		mFoliageConstantBuffer.Data.AmbientColor = XMFLOAT4{ mDirectionalLight.GetAmbientLightColor().x, mDirectionalLight.GetAmbientLightColor().y, mDirectionalLight.GetAmbientLightColor().z , 1.0f };
-		mFoliageConstantBuffer.Data.CameraDirection = XMFLOAT4(mCamera.Direction().x, mCamera.Direction().y, mCamera.Direction().z, 1.0f);
-		mFoliageConstantBuffer.Data.CameraPos = XMFLOAT4(mCamera.Position().x, mCamera.Position().y, mCamera.Position().z, 1.0f);
-		mFoliageConstantBuffer.Data.WindDirection = XMFLOAT4{ -wind->Direction().x, -wind->Direction().y, -wind->Direction().z, 1.0f };
-		mFoliageConstantBuffer.Data.VoxelCameraPos = XMFLOAT4{ mVoxelCameraPos->x, mVoxelCameraPos->y, mVoxelCameraPos->z, 1.0 };
-		mFoliageConstantBuffer.Data.RotateToCamera = (mIsRotating) ? 1.0f : 0.0f;;
-		mFoliageConstantBuffer.Data.Time = static_cast<float>(gameTime.TotalCoreTime());
-		mFoliageConstantBuffer.Data.WindStrength = wind->GetStrength();
-		mFoliageConstantBuffer.Data.WindFrequency = wind->GetFrequency();
-		mFoliageConstantBuffer.Data.WindGustDistance = wind->GetGustDistance();
-		mFoliageConstantBuffer.Data.WorldVoxelScale = *mWorldVoxelScale;
-		mFoliageConstantBuffer.Data.VoxelTextureDimension = *mVoxelTextureDimension;
-		mFoliageConstantBuffer.ApplyChanges(rhi);
-		rhi->SetConstantBuffers(ER_VERTEX,   { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
-		rhi->SetConstantBuffers(ER_GEOMETRY, { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
-		rhi->SetConstantBuffers(ER_PIXEL,    { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
-		rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS });
-
-		std::vector<ER_RHI_GPUResource*> resources(1 + NUM_SHADOW_CASCADES);
-		resources[0] = mAlbedoTexture;
-		if (worldShadowMapper)
-		{
-			for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
-				resources[1 + i] = worldShadowMapper->GetShadowTexture(i);
-		}
-		rhi->SetShaderResources(ER_PIXEL, resources, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
-	}
-
-	void ER_Foliage::Draw(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, FoliageRenderingPass renderPass, 
-		const std::vector<ER_RHI_GPUTexture*>& aGbufferTextures, ER_RHI_GPUTexture* aDepthTarget, ER_RHI_GPURootSignature* rs)
-	{
-		if (renderPass == FOLIAGE_GBUFFER && !(mCore.GetLevel()->mGBuffer->IsEnabled()))
-			return;
-
-		if(renderPass == FOLIAGE_VOXELIZATION)
-			assert(worldShadowMapper);
-
-		auto rhi = mCore.GetRHI();
-
-		if (mPatchesCountToRender == 0 || mIsCulled)
-			return;
-
-		rhi->SetVertexBuffers({mVertexBuffer, mInstanceBuffer});
-		rhi->SetIndexBuffer(mIndexBuffer);
-
-		bool isVoxelizationRenderPass = renderPass == FOLIAGE_VOXELIZATION;
-		std::string psoName = ER_Utility::IsWireframe ? mFoliageGBufferPassWireframePSOName : mFoliageGBufferPassPSOName;
-		if (isVoxelizationRenderPass)
-			psoName = mFoliageVoxelizationPassPSOName;
-
-		if (!rhi->IsPSOReady(psoName))
+		ER_PlacementRandom random(mPlacementSeed, 1 /* colors */);
+		mPlacementOffsets.resize(mPatchesCount);
+		for (int i = 0; i < mPatchesCount; i++)
 		{
-			rhi->InitializePSO(psoName);
-			rhi->SetBlendState(ER_ALPHA_TO_COVERAGE_4_TARGETS, blendFactor, 0xffffffff);
-			rhi->SetRasterizerState((ER_Utility::IsWireframe && !isVoxelizationRenderPass)? ER_RHI_RASTERIZER_STATE::ER_WIREFRAME : ER_RHI_RASTERIZER_STATE::ER_NO_CULLING);
-			rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
-			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			rhi->SetRootSignatureToPSO(psoName, rs);
-			rhi->SetInputLayout(mInputLayout);
-			rhi->SetShader(mVS);
-			if (isVoxelizationRenderPass)
-			{
-				rhi->SetShader(mGS);
-				rhi->SetShader(mPS_Voxelization);
-			}
-			else
-			{
-				assert(aGbufferTextures.size() > 0);
-				rhi->SetShader(mPS_GBuffer);
-				rhi->SetRenderTargetFormats(aGbufferTextures, aDepthTarget);
-			}
-			rhi->FinalizePSO(psoName);
+			mPatchesBufferCPU[i].xPos = positions[i].x;
+			mPatchesBufferCPU[i].yPos = positions[i].y;
+			mPatchesBufferCPU[i].zPos = positions[i].z;
+			mCurrentPositions[i] = positions[i];
+			mPlacementOffsets[i] = XMFLOAT2(positions[i].x - mDistributionCenter.x, positions[i].z - mDistributionCenter.z);
+
+			mPatchesBufferCPU[i].r = random.NextFloat() * 1.0f + 1.0f;
+			mPatchesBufferCPU[i].g = random.NextFloat() * 1.0f + 0.5f;
+			mPatchesBufferCPU[i].b = 0.0f;
 		}
-		rhi->SetPSO(psoName);
-		PrepareRendering(gameTime, worldShadowMapper, rs);
-		rhi->DrawIndexedInstanced(mVerticesCount, mPatchesCountToRender, 0, 0, 0);
-		rhi->UnsetPSO();
-
-		rhi->SetBlendState(ER_NO_BLEND);
-		rhi->UnbindResourcesFromShader(ER_VERTEX);
-		rhi->UnbindResourcesFromShader(ER_GEOMETRY);
-		rhi->UnbindResourcesFromShader(ER_PIXEL);
 	}
 
 	void ER_Foliage::DrawDebugGizmos(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs)
@@ -505,29 +606,20 @@ namespace EveryRay_Core
 		if (editable)
 		{
 			mDistributionCenter = XMFLOAT3(mMatrixTranslation[0], mMatrixTranslation[1], mMatrixTranslation[2]);
+			// the generated pattern moves with the zone (no regeneration)
 			for (int i = 0; i < mPatchesCount; i++)
 			{
 				mCurrentPositions[i] = XMFLOAT4(
-					mDistributionCenter.x + ((float)rand() / (float)(RAND_MAX)) * mDistributionRadius - mDistributionRadius / 2,
+					mDistributionCenter.x + mPlacementOffsets[i].x,
 					mDistributionCenter.y,
-					mDistributionCenter.z + ((float)rand() / (float)(RAND_MAX)) * mDistributionRadius - mDistributionRadius / 2, 1.0f);
+					mDistributionCenter.z + mPlacementOffsets[i].y, 1.0f);
 			}
 			UpdateBuffersCPU();
 			UpdateBuffersGPU();
 			UpdateAABB();
 		}
 
-		XMFLOAT3 toCam = { mDistributionCenter.x - mCamera.Position().x, mDistributionCenter.y - mCamera.Position().y, mDistributionCenter.z - mCamera.Position().z };
-		float distanceToCam = sqrt(toCam.x * toCam.x + toCam.y * toCam.y + toCam.z * toCam.z);
-
-		//UpdateBufferGPU();
-		CalculateDynamicLOD(distanceToCam);
-
-		// adjust patches count based on quality factor
-		if (mPatchesCount > MIN_FOLIAGE_PATCHES_QUALITY_THRESHOLD && mPatchesCountToRender > MIN_FOLIAGE_PATCHES_QUALITY_THRESHOLD)
-			mPatchesCountToRender = static_cast<int>(static_cast<float>(mPatchesCountToRender) * mCore.GetLevel()->mFoliageSystem->GetQualityFactor());
-
-		if (mDebugGizmoAABB)
+		if (mDebugGizmoAABB && mIsSelectedInEditor)
 			mDebugGizmoAABB->Update(mAABB);
 
 		//imgui
@@ -544,11 +636,7 @@ namespace EveryRay_Core
 			static float boundsSnap[] = { 0.1f, 0.1f, 0.1f };
 			static bool boundSizing = false;
 			static bool boundSizingSnap = false;
-			std::string fullName = mName;
-			if (mIsCulled)
-				fullName += " (Culled)";
-
-			const char* name = fullName.c_str();
+			const char* name = mName.c_str();
 
 			ImGui::Begin("Foliage Editor");
 			ImGui::TextColored(ImVec4(0.0f, 0.9f, 0.1f, 1), name);
@@ -563,6 +651,9 @@ namespace EveryRay_Core
 			std::string textureText = "* Texture: " + mTextureName;
 			ImGui::TextWrapped(textureText.c_str());
 
+			std::string seedText = "* Placement seed: " + std::to_string(mPlacementSeed);
+			ImGui::Text(seedText.c_str());
+
 			//if (!mIsPlacedOnTerrain)
 			{
 				//terrain
@@ -573,32 +664,41 @@ namespace EveryRay_Core
 					ER_Terrain* terrain = mCore.GetLevel()->mTerrain;
 					if (ImGui::Button("Place patch on terrain") && terrain && terrain->IsLoaded())
 					{
-						DeleteObject(mInputPositionsOnTerrainBuffer);
-						DeleteObject(mOutputPositionsOnTerrainBuffer);
-
-						mInputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: foliage on-terrain placement input positions buffer");
-						mInputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mCurrentPositions, mPatchesCount, sizeof(XMFLOAT4), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
-						mOutputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: foliage on-terrain placement output positions buffer");
-						mOutputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mCurrentPositions, mPatchesCount, sizeof(XMFLOAT4), false, ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_BUFFER_STRUCTURED); //should be STAGING
-
-						terrain->PlaceOnTerrain(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mCurrentPositions, mPatchesCount, currentChannel, nullptr, 0, mPlacementHeightDelta);
+						if (terrain->IsCPUPlacementEnabled())
+						{
+							terrain->PlaceOnTerrainCPU(mCurrentPositions, mPatchesCount, currentChannel, mPlacementHeightDelta, mCore.GetJobSystem());
+							UpdateBuffersCPU();
+							UpdateBuffersGPU();
+							UpdateAABB();
+						}
+						else
+						{
+							DeleteObject(mInputPositionsOnTerrainBuffer);
+							DeleteObject(mOutputPositionsOnTerrainBuffer);
+
+							mInputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: foliage on-terrain placement input positions buffer");
+							mInputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mCurrentPositions, mPatchesCount, sizeof(XMFLOAT4), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+							mOutputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: foliage on-terrain placement output positions buffer");
+							mOutputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mCurrentPositions, mPatchesCount, sizeof(XMFLOAT4), false, ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_BUFFER_STRUCTURED); //should be STAGING
+
+							terrain->PlaceOnTerrain(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mCurrentPositions, mPatchesCount, currentChannel, nullptr, 0, mPlacementHeightDelta);
 #if !ER_PLATFORM_SUPPORTS_IMMEDIATE_CONTEXT
-						std::string eventName = "On-terrain placement callback - update of foliage: " + mName;
-						terrain->ReadbackPlacedPositionsOnUpdateEvent->AddListener(eventName, [&](ER_Terrain* aTerrain)
-							{
-								assert(aTerrain);
-								aTerrain->ReadbackPlacedPositions(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mCurrentPositions, mPatchesCount); 
-								UpdateBuffersCPU();
-								UpdateBuffersGPU();
-								UpdateAABB();
-							}
-						);
+							std::string eventName = "On-terrain placement callback - update of foliage: " + mName;
+							terrain->ReadbackPlacedPositionsOnUpdateEvent->AddListener(eventName, [&](ER_Terrain* aTerrain)
+								{
+									assert(aTerrain);
+									aTerrain->ReadbackPlacedPositions(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mCurrentPositions, mPatchesCount); 
+									UpdateBuffersCPU();
+									UpdateBuffersGPU();
+									UpdateAABB();
+								}
+							);
 #else
-						UpdateBuffersCPU();
-						UpdateBuffersGPU();
-						UpdateAABB();
+							UpdateBuffersCPU();
+							UpdateBuffersGPU();
+							UpdateAABB();
 #endif
-						
+						}
 						ER_Utility::IsFoliageEditor = false;
 					}
 				}
@@ -628,22 +728,36 @@ namespace EveryRay_Core
 				mTransformationMatrix = XMLoadFloat4x4(&mat);
 			}
 		}
-		mName = mIsCulled ? mOriginalName + " (Culled)" : mOriginalName;
+		if (mIsCulled != mIsCulledInName)
+		{
+			mName = mIsCulled ? mOriginalName + " (Culled)" : mOriginalName;
+			mIsCulledInName = mIsCulled;
+		}
 	}
 
-	// updating world matrices of visible patches
+	// updating world matrices of the patches (uploaded by the batch with the next update)
 	void ER_Foliage::UpdateBuffersGPU() 
 	{
-		ER_RHI* rhi = mCore.GetRHI();
+		UpdateCells();
+		mAreInstancesDirty = true;
+	}
 
-		XMMATRIX translationMatrix;
+	// buckets the patches into cells and writes their world matrices in the cells order
+	void ER_Foliage::UpdateCells()
+	{
+		std::vector<XMFLOAT4> positions(mPatchesCount);
+		for (int i = 0; i < mPatchesCount; i++)
+			positions[i] = XMFLOAT4(mPatchesBufferCPU[i].xPos, mPatchesBufferCPU[i].yPos, mPatchesBufferCPU[i].zPos, 1.0f);
+
+		const float patchExtent = mPatchExtentFactor * (mScale + 1.0f);
+		mCells.Build(positions.data(), mPatchesCount, mDistributionCenter, mDistributionRadius, XMFLOAT3(patchExtent, patchExtent, patchExtent));
+
+		const std::vector<UINT>& patchOrder = mCells.GetPatchOrder();
 		for (int i = 0; i < mPatchesCount; i++)
 		{
-			translationMatrix = XMMatrixTranslation(mPatchesBufferCPU[i].xPos, mPatchesBufferCPU[i].yPos, mPatchesBufferCPU[i].zPos);
-			mPatchesBufferGPU[i].worldMatrix = XMMatrixScaling(mPatchesBufferCPU[i].scale, mPatchesBufferCPU[i].scale, mPatchesBufferCPU[i].scale) * translationMatrix;
+			const CPUFoliageData& patch = mPatchesBufferCPU[patchOrder[i]];
+			mPatchesBufferGPU[i].worldMatrix = XMMatrixScaling(patch.scale, patch.scale, patch.scale) * XMMatrixTranslation(patch.xPos, patch.yPos, patch.zPos);
 		}
-
-		rhi->UpdateBuffer(mInstanceBuffer, (void*)mPatchesBufferGPU, (sizeof(GPUFoliageInstanceData) * mPatchesCount), mIsPlacedOnTerrain /* otherwise we won't have placed foliage in some frames */);
 	}
 
 	void ER_Foliage::UpdateBuffersCPU()
@@ -665,64 +779,297 @@ namespace EveryRay_Core
 		mAABB = ER_AABB(minP, maxP);
 	}
 
-	bool ER_Foliage::PerformCPUFrustumCulling(ER_Camera* camera)
+	void ER_Foliage::UpdateVisiblePatches(const ER_Frustum* aFrustum)
 	{
-		if (!camera)
+		if (aFrustum)
+		{
+			mIsCulled = ER_FrustumCulling::IsCulled(*aFrustum, mAABB);
+			mPatchesCountToRender = mIsCulled ? 0 : static_cast<int>(mCells.Select(aFrustum, mCamera.Position(), GetLODParams(), mVisiblePatchRanges));
+		}
+		else
 		{
 			mIsCulled = false;
-			return mIsCulled;
+			mPatchesCountToRender = static_cast<int>(mCells.Select(nullptr, mCamera.Position(), GetLODParams(), mVisiblePatchRanges));
 		}
+	}
+
+	FoliageLODParams ER_Foliage::GetLODParams()
+	{
+		FoliageLODParams lodParams;
+		lodParams.StartDistance = mDeltaDistanceToCamera;
+		lodParams.MaxDistance = mMaxDistanceToCamera;
+		// quality factor of the graphics config is only applied to big zones
+		if (mPatchesCount > MIN_FOLIAGE_PATCHES_QUALITY_THRESHOLD)
+			lodParams.QualityFactor = mCore.GetLevel()->mFoliageSystem->GetQualityFactor();
+		return lodParams;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	ER_FoliageBatch::ER_FoliageBatch(ER_Core& pCore, FoliageBillboardType aType, const std::string& aTextureName)
+		: mCore(pCore), mType(aType), mTextureName(aTextureName)
+	{
+		auto rhi = mCore.GetRHI();
+
+		LoadBillboardModel(mType);
+
+		mAlbedoTexture = rhi->CreateGPUTexture(L"");
+		mAlbedoTexture->CreateGPUTextureResource(rhi, aTextureName, true);
+		rhi->GenerateMipsWithTextureReplacement(&mAlbedoTexture,
+			[this](ER_RHI_GPUTexture** aNewTextureWithMips)
+			{
+				assert(*aNewTextureWithMips);
+				DeleteObject(mAlbedoTexture);
+				mAlbedoTexture = *aNewTextureWithMips;
+			}
+		);
+	}
+
+	ER_FoliageBatch::~ER_FoliageBatch()
+	{
+		DeleteObject(mVertexBuffer);
+		DeleteObject(mIndexBuffer);
+		DeleteObject(mInstanceBuffer);
+		DeleteObject(mCullingInputInstanceBuffer);
+		DeleteObject(mCullingOutputInstanceBuffer);
+		DeleteObject(mCellsBuffer);
+		DeleteObject(mZonesBuffer);
+		DeleteObject(mIndirectArgsBuffer);
+		DeleteObject(mAlbedoTexture);
+		DeleteObjects(mInstancesData);
+		mFoliageConstantBuffer.Release();
+		mFoliageCullingConstantBuffer.Release();
+	}
+
+	void ER_FoliageBatch::LoadBillboardModel(FoliageBillboardType bType)
+	{
+		auto rhi = mCore.GetRHI();
 
-		auto frustum = camera->GetFrustum();
-		bool culled = false;
-		// start a loop through all frustum planes
-		for (int planeID = 0; planeID < 6; ++planeID)
+		std::string modelPath;
+		if (bType == FoliageBillboardType::SINGLE)
+			modelPath = "content\\models\\vegetation\\foliage_quad_single.obj";
+		else if (bType == FoliageBillboardType::TWO_QUADS_CROSSING)
+			modelPath = "content\\models\\vegetation\\foliage_quad_double.obj";
+		else if (bType == FoliageBillboardType::THREE_QUADS_CROSSING)
+			modelPath = "content\\models\\vegetation\\foliage_quad_triple.obj";
+		else if (bType == FoliageBillboardType::MULTIPLE_QUADS_CROSSING)
+			modelPath = "content\\models\\vegetation\\foliage_quad_multiple.obj";
+		else
+			throw ER_CoreException("ER_FoliageBatch: Unknown billboard type of a foliage zone");
+
+		mVertexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage - Vertex Buffer");
+		mIndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage - Index Buffer");
+		std::unique_ptr<ER_Model> quadModel(new ER_Model(mCore, ER_Utility::GetFilePath(modelPath), true));
+		quadModel->GetMesh(0).CreateVertexBuffer_PositionUvNormal(mVertexBuffer);
+		quadModel->GetMesh(0).CreateIndexBuffer(mIndexBuffer);
+		mIndicesCount = static_cast<int>(quadModel->GetMesh(0).IndexCount());
+	}
+
+	void ER_FoliageBatch::Initialize()
+	{
+		ER_RHI* rhi = mCore.GetRHI();
+
+		mFoliageConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Foliage CB");
+		mFoliageCullingConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Foliage Culling CB");
+
+		// zones follow each other in the pool
+		mZonesFirstPatch.resize(mZones.size());
+		mPatchesCount = 0;
+		for (size_t zoneIndex = 0; zoneIndex < mZones.size(); zoneIndex++)
 		{
-			XMVECTOR planeNormal = XMVectorSet(frustum.Planes()[planeID].x, frustum.Planes()[planeID].y, frustum.Planes()[planeID].z, 0.0f);
-			float planeConstant = frustum.Planes()[planeID].w;
+			mZonesFirstPatch[zoneIndex] = mPatchesCount;
+			mPatchesCount += static_cast<UINT>(mZones[zoneIndex]->GetPatchesCount());
+		}
+		assert(mPatchesCount > 0);
 
-			XMFLOAT3 axisVert;
+		mInstancesData = new GPUFoliageInstanceData[mPatchesCount];
+		mZonesData.resize(mZones.size());
+		UpdatePool();
 
-			// x-axis
-			if (frustum.Planes()[planeID].x > 0.0f)
-				axisVert.x = mAABB.first.x;
-			else
-				axisVert.x = mAABB.second.x;
+		mInstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage instance buffer");
+		mInstanceBuffer->CreateGPUBufferResource(rhi, mInstancesData, mPatchesCount, sizeof(GPUFoliageInstanceData), true, ER_BIND_VERTEX_BUFFER);
+
+		// GPU culling (every zone has up to FOLIAGE_CELLS_PER_SIDE x FOLIAGE_CELLS_PER_SIDE non-empty cells, their count changes when the zone is placed again)
+		std::vector<FoliageBatchCellGPU> cells(mZones.size() * FOLIAGE_CELLS_PER_SIDE * FOLIAGE_CELLS_PER_SIDE);
+		std::copy(mCellsData.begin(), mCellsData.end(), cells.begin());
+		mCellsBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage cells buffer");
+		mCellsBuffer->CreateGPUBufferResource(rhi, cells.data(), static_cast<UINT>(cells.size()), sizeof(FoliageBatchCellGPU), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+		mZonesBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage zones buffer");
+		mZonesBuffer->CreateGPUBufferResource(rhi, mZonesData.data(), static_cast<UINT>(mZonesData.size()), sizeof(FoliageBatchZoneGPU), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+		mCullingInputInstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage culling input instance buffer");
+		mCullingInputInstanceBuffer->CreateGPUBufferResource(rhi, mInstancesData, mPatchesCount, sizeof(GPUFoliageInstanceData), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+		mCullingOutputInstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage culling output instance buffer");
+		mCullingOutputInstanceBuffer->CreateGPUBufferResource(rhi, nullptr, mPatchesCount, sizeof(GPUFoliageInstanceData), false,
+			ER_BIND_UNORDERED_ACCESS | ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		const int numArgs = 5; // number of args for DrawIndexedInstanced
+		mIndirectArgsBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Foliage indirect args buffer");
+		mIndirectArgsBuffer->CreateGPUBufferResource(rhi, nullptr, numArgs, sizeof(UINT), false,
+			ER_BIND_UNORDERED_ACCESS | ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_DRAWINDIRECT_ARGS, ER_RHI_FORMAT::ER_FORMAT_R32_UINT);
+	}
 
-			// y-axis
-			if (frustum.Planes()[planeID].y > 0.0f)
-				axisVert.y = mAABB.first.y;
-			else
-				axisVert.y = mAABB.second.y;
+	// Copies the instances of the changed zones to the pool and rebuilds the cells of the batch; returns false if no zone was changed
+	bool ER_FoliageBatch::UpdatePool()
+	{
+		bool isChanged = false;
+		for (size_t zoneIndex = 0; zoneIndex < mZones.size(); zoneIndex++)
+		{
+			ER_Foliage* zone = mZones[zoneIndex];
+			if (!zone->AreInstancesDirty())
+				continue;
 
-			// z-axis
-			if (frustum.Planes()[planeID].z > 0.0f)
-				axisVert.z = mAABB.first.z;
-			else
-				axisVert.z = mAABB.second.z;
+			std::copy(zone->GetInstancesData(), zone->GetInstancesData() + zone->GetPatchesCount(), mInstancesData + mZonesFirstPatch[zoneIndex]);
+			zone->ClearInstancesDirty();
+			isChanged = true;
+		}
+		if (!isChanged)
+			return false;
 
+		mCellsData.clear();
+		for (size_t zoneIndex = 0; zoneIndex < mZones.size(); zoneIndex++)
+		{
+			for (const FoliageCellGPU& zoneCell : mZones[zoneIndex]->GetCells().GetCells())
+			{
+				FoliageBatchCellGPU cell;
+				cell.Cell = zoneCell;
+				cell.Cell.FirstPatch += mZonesFirstPatch[zoneIndex];
+				cell.ZoneIndex = static_cast<UINT>(zoneIndex);
+				cell.pad = XMUINT3(0, 0, 0);
+				mCellsData.push_back(cell);
+			}
+		}
+		return true;
+	}
 
-			if (XMVectorGetX(XMVector3Dot(planeNormal, XMLoadFloat3(&axisVert))) + planeConstant > 0.0f)
+	void ER_FoliageBatch::Update(bool aGPUCulled)
+	{
+		ER_RHI* rhi = mCore.GetRHI();
+
+		if (UpdatePool())
+		{
+			// these are not updated every frame, so all back buffers must have them
+			rhi->UpdateBuffer(mInstanceBuffer, (void*)mInstancesData, static_cast<int>(sizeof(GPUFoliageInstanceData) * mPatchesCount), true);
+			rhi->UpdateBuffer(mCullingInputInstanceBuffer, (void*)mInstancesData, static_cast<int>(sizeof(GPUFoliageInstanceData) * mPatchesCount), true);
+			rhi->UpdateBuffer(mCellsBuffer, (void*)mCellsData.data(), static_cast<int>(sizeof(FoliageBatchCellGPU) * mCellsData.size()), true);
+		}
+
+		mPatchesCountToRender = 0;
+		mVisibleZonesCount = 0;
+		mVisiblePatchRanges.clear();
+		for (size_t zoneIndex = 0; zoneIndex < mZones.size(); zoneIndex++)
+		{
+			ER_Foliage* zone = mZones[zoneIndex];
+			const bool isVisible = !zone->IsCulled() && zone->GetPatchesCountToRender() > 0;
+			const FoliageLODParams lodParams = zone->GetLODParams();
+			mZonesData[zoneIndex].LODParams = XMFLOAT4(lodParams.StartDistance, lodParams.MaxDistance, lodParams.QualityFactor, isVisible ? 1.0f : 0.0f);
+			if (!isVisible)
+				continue;
+
+			mVisibleZonesCount++;
+			mPatchesCountToRender += static_cast<UINT>(zone->GetPatchesCountToRender());
+			if (aGPUCulled)
+				continue;
+
+			// neighbouring ranges (also of neighbouring zones) are merged into one draw
+			for (const FoliagePatchRange& zoneRange : zone->GetVisiblePatchRanges())
 			{
-				culled = true;
-				// Skip remaining planes to check and move on 
-				break;
+				const FoliagePatchRange range = { zoneRange.FirstPatch + mZonesFirstPatch[zoneIndex], zoneRange.PatchesCount };
+				if (!mVisiblePatchRanges.empty() && mVisiblePatchRanges.back().FirstPatch + mVisiblePatchRanges.back().PatchesCount == range.FirstPatch)
+					mVisiblePatchRanges.back().PatchesCount += range.PatchesCount;
+				else
+					mVisiblePatchRanges.push_back(range);
 			}
 		}
-		mIsCulled = culled;
-		return culled;
 	}
 
-	void ER_Foliage::CalculateDynamicLOD(float distanceToCam)
+	void ER_FoliageBatch::UpdateGPUCullingConstants(const ER_Frustum& aFrustum, const XMFLOAT3& aCameraPosition, bool aSkipFrustumCulling)
 	{
-		float factor = (distanceToCam - mDeltaDistanceToCamera) / mMaxDistanceToCamera;
+		ER_RHI* rhi = mCore.GetRHI();
 
-		if (factor > 1.0f)
-			factor = 1.0f;
-		else if (factor < 0.0f)
-			factor = 0.0f;
+		for (int i = 0; i < 6; i++)
+			mFoliageCullingConstantBuffer.Data.FrustumPlanes[i] = aFrustum.Planes()[i];
+		mFoliageCullingConstantBuffer.Data.CameraPos = XMFLOAT4(aCameraPosition.x, aCameraPosition.y, aCameraPosition.z, aSkipFrustumCulling ? 1.0f : -1.0f);
+		mFoliageCullingConstantBuffer.Data.IndexCountPerInstance = static_cast<UINT>(mIndicesCount);
+		mFoliageCullingConstantBuffer.Data.CellsCount = GetCellsCount();
+		mFoliageCullingConstantBuffer.Data.DispatchGroupsX = GetDispatchGroupsX();
+		mFoliageCullingConstantBuffer.Data.pad = 0;
+		mFoliageCullingConstantBuffer.ApplyChanges(rhi);
 
-		mPatchesCountToRender = static_cast<int>(static_cast<float>(mPatchesCount) * (1.0f - factor));
+		rhi->UpdateBuffer(mZonesBuffer, (void*)mZonesData.data(), static_cast<int>(sizeof(FoliageBatchZoneGPU) * mZonesData.size()));
 	}
 
-}
\ No newline at end of file
+	void ER_FoliageBatch::PrepareRendering(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, const ER_Camera& aCamera, const ER_DirectionalLight& aLight, ER_RHI_GPURootSignature* rs)
+	{
+		auto rhi = mCore.GetRHI();
+		const ER_Wind* wind = mCore.GetLevel()->mWind;
+
+		if (worldShadowMapper)
+		{
+			for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+				mFoliageConstantBuffer.Data.ShadowMatrices[cascade] = XMMatrixTranspose(worldShadowMapper->GetViewMatrix(cascade) * worldShadowMapper->GetProjectionMatrix(cascade) * XMLoadFloat4x4(&ER_MatrixHelper::GetProjectionShadowMatrix()));
+			mFoliageConstantBuffer.Data.ShadowTexelSize = XMFLOAT4{ 1.0f / worldShadowMapper->GetResolution(), 1.0f, 1.0f , 1.0f };
+			mFoliageConstantBuffer.Data.ShadowCascadeDistances = XMFLOAT4{ worldShadowMapper->GetCameraFarShadowCascadeDistance(0),worldShadowMapper->GetCameraFarShadowCascadeDistance(1), worldShadowMapper->GetCameraFarShadowCascadeDistance(2), 1.0f };
+		}
+
+		mFoliageConstantBuffer.Data.World = XMMatrixIdentity();
+		mFoliageConstantBuffer.Data.View = XMMatrixTranspose(aCamera.ViewMatrix());
+		mFoliageConstantBuffer.Data.Projection = XMMatrixTranspose(aCamera.ProjectionMatrix());
+		mFoliageConstantBuffer.Data.SunDirection = XMFLOAT4(-aLight.Direction().x, -aLight.Direction().y, -aLight.Direction().z, 1.0f);
+		mFoliageConstantBuffer.Data.SunColor = XMFLOAT4{ aLight.GetColor().x, aLight.GetColor().y, aLight.GetColor().z , 1.0f };
+		mFoliageConstantBuffer.Data.AmbientColor = XMFLOAT4{ aLight.GetAmbientLightColor().x, aLight.GetAmbientLightColor().y, aLight.GetAmbientLightColor().z , 1.0f };
+		mFoliageConstantBuffer.Data.CameraDirection = XMFLOAT4(aCamera.Direction().x, aCamera.Direction().y, aCamera.Direction().z, 1.0f);
+		mFoliageConstantBuffer.Data.CameraPos = XMFLOAT4(aCamera.Position().x, aCamera.Position().y, aCamera.Position().z, 1.0f);
+		mFoliageConstantBuffer.Data.WindDirection = XMFLOAT4{ -wind->Direction().x, -wind->Direction().y, -wind->Direction().z, 1.0f };
+		if (mVoxelCameraPos)
+			mFoliageConstantBuffer.Data.VoxelCameraPos = XMFLOAT4{ mVoxelCameraPos->x, mVoxelCameraPos->y, mVoxelCameraPos->z, 1.0 };
+		mFoliageConstantBuffer.Data.RotateToCamera = (mType == FoliageBillboardType::SINGLE) ? 1.0f : 0.0f;
+		mFoliageConstantBuffer.Data.Time = static_cast<float>(gameTime.TotalCoreTime());
+		mFoliageConstantBuffer.Data.WindStrength = wind->GetStrength();
+		mFoliageConstantBuffer.Data.WindFrequency = wind->GetFrequency();
+		mFoliageConstantBuffer.Data.WindGustDistance = wind->GetGustDistance();
+		if (mWorldVoxelScale)
+			mFoliageConstantBuffer.Data.WorldVoxelScale = *mWorldVoxelScale;
+		if (mVoxelTextureDimension)
+			mFoliageConstantBuffer.Data.VoxelTextureDimension = *mVoxelTextureDimension;
+		mFoliageConstantBuffer.ApplyChanges(rhi);
+		rhi->SetConstantBuffers(ER_VERTEX,   { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
+		rhi->SetConstantBuffers(ER_GEOMETRY, { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
+		rhi->SetConstantBuffers(ER_PIXEL,    { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
+		rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS });
+
+		ER_RHI_InlineArray<ER_RHI_GPUResource*, 1 + NUM_SHADOW_CASCADES> resources(1 + NUM_SHADOW_CASCADES);
+		resources[0] = mAlbedoTexture;
+		if (worldShadowMapper)
+		{
+			for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
+				resources[1 + i] = worldShadowMapper->GetShadowTexture(i);
+		}
+		rhi->SetShaderResources(ER_PIXEL, resources, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
+	}
+
+	UINT ER_FoliageBatch::Draw(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, const ER_Camera& aCamera, const ER_DirectionalLight& aLight, ER_RHI_GPURootSignature* rs, bool aGPUCulled)
+	{
+		if (mPatchesCountToRender == 0)
+			return 0;
+
+		auto rhi = mCore.GetRHI();
+
+		if (aGPUCulled)
+			rhi->SetVertexBuffers({ mVertexBuffer });
+		else
+			rhi->SetVertexBuffers({ mVertexBuffer, mInstanceBuffer });
+		rhi->SetIndexBuffer(mIndexBuffer);
+
+		PrepareRendering(gameTime, worldShadowMapper, aCamera, aLight, rs);
+		if (aGPUCulled)
+		{
+			rhi->SetShaderResources(ER_VERTEX, { mCullingOutputInstanceBuffer }, 4, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_VERTEX_SRV_INDEX);
+			rhi->DrawIndexedInstancedIndirect(mIndirectArgsBuffer, 0);
+			return 1;
+		}
+
+		for (const auto& range : mVisiblePatchRanges)
+			rhi->DrawIndexedInstanced(mIndicesCount, range.PatchesCount, 0, 0, range.FirstPatch);
+		return static_cast<UINT>(mVisiblePatchRanges.size());
+	}
+}
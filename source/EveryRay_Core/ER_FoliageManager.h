@@ -3,8 +3,11 @@
 #include "ER_CoreComponent.h"
 #include "ER_GenericEvent.h"
 #include "RHI/ER_RHI.h"
+#include "ER_FoliageCells.h"
+#include "ER_Placement.h"
 
-#define MAX_FOLIAGE_ZONES 4096
+#define FOLIAGE_ZONES_PER_JOB 16 // zones updated (culled and LOD'ed) by one job of the job system
+#define FOLIAGE_CULLING_MAX_GROUPS_X 65535 // dispatch limit per dimension (bigger batches are dispatched as a 2D grid of cells)
 
 // Minimum amount of drawn patches/instances before we start applying graphics config's "quality" factor.
 // In other words, for example, our foliage zone has N patches to render (after culling or without it).
@@ -22,6 +25,7 @@ namespace EveryRay_Core
 	class ER_Illumination;
 	class ER_RenderableAABB;
 	class ER_Terrain;
+	class ER_Frustum;
 
 	namespace FoliageCBufferData {
 		struct ER_ALIGN_GPU_BUFFER FoliageCB {
@@ -46,6 +50,14 @@ namespace EveryRay_Core
 			float WorldVoxelScale;
 			float VoxelTextureDimension;
 		};
+		struct ER_ALIGN_GPU_BUFFER FoliageCullingCB {
+			XMFLOAT4 FrustumPlanes[6];
+			XMFLOAT4 CameraPos; // .w - skip frustum culling
+			UINT IndexCountPerInstance;
+			UINT CellsCount;
+			UINT DispatchGroupsX;
+			UINT pad;
+		};
 	}
 
 	enum FoliageRenderingPass
@@ -80,6 +92,31 @@ namespace EveryRay_Core
 		XMMATRIX worldMatrix = XMMatrixIdentity();
 	};
 
+	// Same layout as FoliageCell in FoliageCulling.hlsl
+	struct FoliageBatchCellGPU
+	{
+		FoliageCellGPU Cell; // FirstPatch is in the instance pool of the batch
+		UINT ZoneIndex; // in the batch
+		XMUINT3 pad;
+	};
+
+	// Same layout as FoliageZone in FoliageCulling.hlsl
+	struct FoliageBatchZoneGPU
+	{
+		XMFLOAT4 LODParams; // x - start distance, y - max distance, z - quality factor, w - visible (the zone passed the CPU culling)
+	};
+
+	// CPU-side counters of the last frame (the GPU path uses the patches counts of the CPU reference)
+	struct FoliageDrawStats
+	{
+		UINT VisibleZones = 0;
+		UINT Dispatches = 0;
+		UINT Draws = 0;
+		UINT Instances = 0;
+		UINT Triangles = 0;
+		double UpdateTimeMs = 0.0; // zones and batches update
+	};
+
 	struct CPUFoliageData //for CPU buffer
 	{
 		float xPos, yPos, zPos;
@@ -92,12 +129,10 @@ namespace EveryRay_Core
 	public:
 		ER_Foliage(ER_Core& pCore, ER_Camera& pCamera, ER_DirectionalLight& pLight, int pPatchesCount, const std::string& textureName, float scale = 1.0f, float distributionRadius = 100, 
 			const XMFLOAT3& distributionCenter = XMFLOAT3(0.0f, 0.0f, 0.0f), FoliageBillboardType bType = FoliageBillboardType::SINGLE,
-			bool isPlacedOnTerrain = false, int terrainPlaceChannel = 4, float placedHeightDelta = 0.0f);
+			bool isPlacedOnTerrain = false, int terrainPlaceChannel = 4, float placedHeightDelta = 0.0f, UINT placementSeed = PLACEMENT_DEFAULT_SEED);
 		~ER_Foliage();
 
 		void Initialize();
-		void Draw(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, FoliageRenderingPass renderPass, 
-			const std::vector<ER_RHI_GPUTexture*>& aGbufferTextures, ER_RHI_GPUTexture* aDepthTarget, ER_RHI_GPURootSignature* rs);
 		void DrawDebugGizmos(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs);
 		void Update(const ER_CoreTime& gameTime);
 
@@ -107,7 +142,9 @@ namespace EveryRay_Core
 		void SetDynamicLODMaxDistance(float val) { mMaxDistanceToCamera = val; }
 		void SetDynamicDeltaDistanceToCamera(float val) { mDeltaDistanceToCamera = val; }
 
-		bool IsRotating() { return mIsRotating; }
+		bool IsRotating() { return mType == FoliageBillboardType::SINGLE; }
+		FoliageBillboardType GetBillboardType() const { return mType; }
+		const std::string& GetTextureName() const { return mTextureName; }
 
 		int GetPatchesCount() { return mPatchesCount; }
 		void SetPatchPosition(int i, float x, float y, float z) {
@@ -124,14 +161,19 @@ namespace EveryRay_Core
 		void UpdateBuffersCPU();
 		void UpdateAABB();
 
-		void SetVoxelizationParams(float* worldVoxelScale, const float* voxelTexDimension, XMFLOAT4* voxelCameraPos)
-		{
-			mWorldVoxelScale = worldVoxelScale;
-			mVoxelCameraPos = voxelCameraPos;
-			mVoxelTextureDimension = voxelTexDimension;
-		}
+		// Culls the zone and its cells (if aFrustum is not nullptr) and selects the patches to draw based on their distance to the main camera.
+		// This is also the CPU reference of the GPU path (FoliageCulling.hlsl), so the counts are valid in both. Zones can be updated in parallel.
+		void UpdateVisiblePatches(const ER_Frustum* aFrustum);
+		FoliageLODParams GetLODParams();
+
+		// Instances (in the cells order) and cells of the zone, copied to the pool of its batch when they are changed
+		const GPUFoliageInstanceData* GetInstancesData() const { return mPatchesBufferGPU; }
+		const ER_FoliageCells& GetCells() const { return mCells; }
+		bool AreInstancesDirty() const { return mAreInstancesDirty; }
+		void ClearInstancesDirty() { mAreInstancesDirty = false; }
 
-		bool PerformCPUFrustumCulling(ER_Camera* camera);
+		int GetPatchesCountToRender() { return mPatchesCountToRender; }
+		const std::vector<FoliagePatchRange>& GetVisiblePatchRanges() const { return mVisiblePatchRanges; }
 
 		void SetName(const std::string& name) { mName = name; mOriginalName = name; }
 		const std::string& GetName() { return mName; }
@@ -139,40 +181,18 @@ namespace EveryRay_Core
 		bool IsSelectedInEditor() { return mIsSelectedInEditor; }
 		bool IsCulled() { return mIsCulled; }
 	private:
-		void PrepareRendering(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, ER_RHI_GPURootSignature* rs);
-		void InitializeBuffersGPU(int count);
+		void InitializeInstancesData(int count);
 		void InitializeBuffersCPU();
-		void LoadBillboardModel(FoliageBillboardType bType);
-		void CalculateDynamicLOD(float distanceToCam);
+		void UpdateCells();
 
 		ER_Core& mCore;
 		ER_Camera& mCamera;
 		ER_DirectionalLight& mDirectionalLight;
 
-		ER_RHI_InputLayout* mInputLayout = nullptr;
-		ER_RHI_GPUShader* mVS = nullptr;
-		ER_RHI_GPUShader* mGS = nullptr;
-		ER_RHI_GPUShader* mPS = nullptr;
-		std::string mFoliageMainPassPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Main Pass";
-
-		ER_RHI_GPUShader* mPS_GBuffer = nullptr;
-		std::string mFoliageGBufferPassPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Gbuffer Pass";
-		std::string mFoliageGBufferPassWireframePSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Gbuffer (Wireframe) Pass";
-
-		ER_RHI_GPUShader* mPS_Voxelization = nullptr;
-		std::string mFoliageVoxelizationPassPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Voxelization Pass";
-
-		ER_RHI_GPUConstantBuffer<FoliageCBufferData::FoliageCB> mFoliageConstantBuffer;
-
-		ER_RHI_GPUBuffer* mVertexBuffer = nullptr;
-		ER_RHI_GPUBuffer* mIndexBuffer = nullptr;
-		ER_RHI_GPUBuffer* mInstanceBuffer = nullptr;
-		ER_RHI_GPUTexture* mAlbedoTexture = nullptr;
-		ER_RHI_GPUTexture* mVoxelizationTexture = nullptr;
-
-		GPUFoliageInstanceData* mPatchesBufferGPU = nullptr;
+		GPUFoliageInstanceData* mPatchesBufferGPU = nullptr; // in the cells order
 		CPUFoliageData* mPatchesBufferCPU = nullptr;
 		XMFLOAT4* mCurrentPositions = nullptr;
+		std::vector<XMFLOAT2> mPlacementOffsets; // generated XZ positions of the patches relative to mDistributionCenter
 
 		ER_RHI_GPUBuffer* mInputPositionsOnTerrainBuffer = nullptr; //input positions for on-terrain placement pass
 		ER_RHI_GPUBuffer* mOutputPositionsOnTerrainBuffer = nullptr; //output positions for on-terrain placement pass
@@ -182,11 +202,17 @@ namespace EveryRay_Core
 		int mTerrainSplatChannel = 4;
 		bool mIsPlacedOnTerrain = false;
 		float mPlacementHeightDelta = 0.0;
+		UINT mPlacementSeed = PLACEMENT_DEFAULT_SEED; // same seed - same patches (positions, colors and scales)
 
 		ER_RenderableAABB* mDebugGizmoAABB = nullptr;
 		ER_AABB mAABB;
 		const float mAABBExtentY = 25.0f;
 		const float mAABBExtentXZ = 1.0f;
+		const float mPatchExtentFactor = 1.25f; // billboard models fit into a unit radius (+ wind), scaled by the max patch scale
+
+		ER_FoliageCells mCells;
+		std::vector<FoliagePatchRange> mVisiblePatchRanges; // instance ranges for the CPU path (in the zone)
+		bool mAreInstancesDirty = false;
 
 		std::string mName;
 		std::string mOriginalName; //unchanged
@@ -194,6 +220,7 @@ namespace EveryRay_Core
 
 		bool mIsSelectedInEditor = false;
 		bool mIsCulled = false;
+		bool mIsCulledInName = false;
 
 		int mPatchesCount = 0; // original patches count (unchanged)
 		int mPatchesCountToRender = 0;
@@ -206,17 +233,10 @@ namespace EveryRay_Core
 		float mDistributionRadius;
 		bool mRotateFromCamPosition = false;
 
-		int mVerticesCount = 0;
-		bool mIsRotating = false;
-
 		float mWindStrength;
 		float mWindFrequency;
 		float mWindGustDistance;
 
-		float* mWorldVoxelScale;
-		const float* mVoxelTextureDimension;
-		XMFLOAT4* mVoxelCameraPos;
-
 		float		mCameraViewMatrix[16];
 		float		mCameraProjectionMatrix[16];
 		XMMATRIX	mTransformationMatrix;
@@ -232,6 +252,86 @@ namespace EveryRay_Core
 		};
 	};
 
+	// All foliage zones with the same billboard type and texture. Their patches are packed into one instance pool (every zone is a sub-range of it) with per-zone metadata,
+	// so that the batch is culled and LOD'ed by one dispatch over the cells of all its zones and drawn by one indirect draw (or by the merged instance ranges of its zones on the CPU path).
+	class ER_FoliageBatch
+	{
+	public:
+		ER_FoliageBatch(ER_Core& pCore, FoliageBillboardType aType, const std::string& aTextureName);
+		~ER_FoliageBatch();
+
+		void AddZone(ER_Foliage* aZone) { mZones.push_back(aZone); }
+		void Initialize();
+		// Copies the changed zones (placed, moved) to the pool and gathers the visible patches of the zones (must be called after the zones are updated)
+		void Update(bool aGPUCulled);
+		void UpdateGPUCullingConstants(const ER_Frustum& aFrustum, const XMFLOAT3& aCameraPosition, bool aSkipFrustumCulling);
+		// Root signature and PSO of the pass must be set; returns the number of draw calls
+		UINT Draw(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, const ER_Camera& aCamera, const ER_DirectionalLight& aLight, ER_RHI_GPURootSignature* rs, bool aGPUCulled);
+
+		void SetVoxelizationParams(float* worldVoxelScale, const float* voxelTexDimension, XMFLOAT4* voxelCameraPos)
+		{
+			mWorldVoxelScale = worldVoxelScale;
+			mVoxelCameraPos = voxelCameraPos;
+			mVoxelTextureDimension = voxelTexDimension;
+		}
+
+		bool IsMatching(FoliageBillboardType aType, const std::string& aTextureName) const { return mType == aType && mTextureName == aTextureName; }
+
+		ER_RHI_GPUBuffer* GetCullingConstantBuffer() { return mFoliageCullingConstantBuffer.Buffer(); }
+		ER_RHI_GPUBuffer* GetCullingInputInstanceBuffer() { return mCullingInputInstanceBuffer; }
+		ER_RHI_GPUBuffer* GetCullingOutputInstanceBuffer() { return mCullingOutputInstanceBuffer; }
+		ER_RHI_GPUBuffer* GetCellsBuffer() { return mCellsBuffer; }
+		ER_RHI_GPUBuffer* GetZonesBuffer() { return mZonesBuffer; }
+		ER_RHI_GPUBuffer* GetIndirectArgsBuffer() { return mIndirectArgsBuffer; }
+		UINT GetCellsCount() { return static_cast<UINT>(mCellsData.size()); }
+		UINT GetDispatchGroupsX() { return std::min(GetCellsCount(), static_cast<UINT>(FOLIAGE_CULLING_MAX_GROUPS_X)); }
+		UINT GetDispatchGroupsY() { return (GetCellsCount() + FOLIAGE_CULLING_MAX_GROUPS_X - 1) / FOLIAGE_CULLING_MAX_GROUPS_X; }
+
+		UINT GetZonesCount() { return static_cast<UINT>(mZones.size()); }
+		UINT GetVisibleZonesCount() { return mVisibleZonesCount; }
+		UINT GetPatchesCount() { return mPatchesCount; }
+		UINT GetPatchesCountToRender() { return mPatchesCountToRender; }
+		UINT GetIndicesCountPerPatch() { return mIndicesCount; }
+	private:
+		void LoadBillboardModel(FoliageBillboardType bType);
+		void PrepareRendering(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, const ER_Camera& aCamera, const ER_DirectionalLight& aLight, ER_RHI_GPURootSignature* rs);
+		bool UpdatePool();
+
+		ER_Core& mCore;
+		std::vector<ER_Foliage*> mZones; // not owned
+		std::vector<UINT> mZonesFirstPatch; // in the pool
+
+		ER_RHI_GPUConstantBuffer<FoliageCBufferData::FoliageCB> mFoliageConstantBuffer;
+		ER_RHI_GPUConstantBuffer<FoliageCBufferData::FoliageCullingCB> mFoliageCullingConstantBuffer;
+
+		ER_RHI_GPUBuffer* mVertexBuffer = nullptr;
+		ER_RHI_GPUBuffer* mIndexBuffer = nullptr;
+		ER_RHI_GPUBuffer* mInstanceBuffer = nullptr; // pool of all the zones (each in the cells order)
+		ER_RHI_GPUBuffer* mCullingInputInstanceBuffer = nullptr; // same as mInstanceBuffer, but structured
+		ER_RHI_GPUBuffer* mCullingOutputInstanceBuffer = nullptr;
+		ER_RHI_GPUBuffer* mCellsBuffer = nullptr;
+		ER_RHI_GPUBuffer* mZonesBuffer = nullptr;
+		ER_RHI_GPUBuffer* mIndirectArgsBuffer = nullptr;
+		ER_RHI_GPUTexture* mAlbedoTexture = nullptr;
+
+		GPUFoliageInstanceData* mInstancesData = nullptr;
+		std::vector<FoliageBatchCellGPU> mCellsData;
+		std::vector<FoliageBatchZoneGPU> mZonesData;
+		std::vector<FoliagePatchRange> mVisiblePatchRanges; // instance ranges for the CPU path (in the pool)
+
+		FoliageBillboardType mType;
+		std::string mTextureName;
+		int mIndicesCount = 0;
+
+		UINT mPatchesCount = 0;
+		UINT mPatchesCountToRender = 0;
+		UINT mVisibleZonesCount = 0;
+
+		float* mWorldVoxelScale = nullptr;
+		const float* mVoxelTextureDimension = nullptr;
+		XMFLOAT4* mVoxelCameraPos = nullptr;
+	};
+
 	class ER_FoliageManager : public ER_CoreComponent
 	{
 	public:
@@ -241,7 +341,8 @@ namespace EveryRay_Core
 		void Initialize();
 		void Update(const ER_CoreTime& gameTime);
 		void Draw(const ER_CoreTime& gameTime, const ER_ShadowMapper* worldShadowMapper, FoliageRenderingPass renderPass,
-			const std::vector<ER_RHI_GPUTexture*>& aGbufferTextures, ER_RHI_GPUTexture* aDepthTarget = nullptr);
+			ER_RHI_Span<ER_RHI_GPUTexture*> aGbufferTextures, ER_RHI_GPUTexture* aDepthTarget = nullptr);
+		void PerformGPUCulling(ER_Camera* aCamera);
 		void DrawDebugGizmos(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs);
 		void Config() { mShowDebug = !mShowDebug; }
 
@@ -255,16 +356,41 @@ namespace EveryRay_Core
 		using Delegate_FoliageSystemInitialized = std::function<void()>;
 		ER_GenericEvent<Delegate_FoliageSystemInitialized>* FoliageSystemInitializedEvent = new ER_GenericEvent<Delegate_FoliageSystemInitialized>();
 	private:
-		void UpdateImGui();
+		void UpdateImGui(const ER_CoreTime& gameTime);
+		bool IsFrustumCulling();
+		void CreateBatches();
+
 		std::vector<ER_Foliage*> mFoliageCollection;
+		std::vector<ER_FoliageBatch*> mBatches;
 		ER_Scene* mScene = nullptr;
+		ER_DirectionalLight& mDirectionalLight;
 
 		ER_RHI_GPURootSignature* mRootSignature = nullptr;
 
+		ER_RHI_InputLayout* mInputLayout = nullptr;
+		ER_RHI_GPUShader* mVS = nullptr;
+		ER_RHI_InputLayout* mInputLayoutIndirect = nullptr;
+		ER_RHI_GPUShader* mVS_Indirect = nullptr; // reads the instances compacted by FoliageCulling.hlsl
+		ER_RHI_GPUShader* mGS = nullptr;
+		ER_RHI_GPUShader* mPS_GBuffer = nullptr;
+		ER_RHI_GPUShader* mPS_Voxelization = nullptr;
+		const std::string mFoliageGBufferPassPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Gbuffer Pass";
+		const std::string mFoliageGBufferPassWireframePSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Gbuffer (Wireframe) Pass";
+		const std::string mFoliageVoxelizationPassPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Voxelization Pass";
+
+		ER_RHI_GPUShader* mCullingCS = nullptr;
+		ER_RHI_GPUShader* mCullingClearArgsCS = nullptr;
+		ER_RHI_GPURootSignature* mCullingRootSignature = nullptr;
+		const std::string mCullingPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Culling Pass";
+		const std::string mCullingClearArgsPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Culling Pass Clear";
+
 		FoliageQuality mCurrentFoliageQuality = FoliageQuality::FOLIAGE_HIGH;
 		float mCurrentFoliageQualityFactor = 1.0f; // percentage of drawn foliage patches/instances based on quality preset (only active when > MIN_FOLIAGE_PATCHES_QUALITY_THRESHOLD)
 
-		const char* mFoliageZonesNamesUI[MAX_FOLIAGE_ZONES];
+		std::vector<const char*> mFoliageZonesNamesUI;
+
+		FoliageDrawStats mDrawStats; // of the current frame
+		FoliageDrawStats mLastFrameDrawStats;
 
 		int mEditorSelectedFoliageZoneIndex = 0;
 
@@ -274,6 +400,7 @@ namespace EveryRay_Core
 		bool mShowDebug = false;
 		bool mEnabled = true;
 		bool mEnableCulling = true;
+		bool mEnableGPUCulling = true; // compacted instances + indirect draws instead of per-cell instance ranges
 		bool mHasFoliage = false;
 	};
 }
\ No newline at end of file
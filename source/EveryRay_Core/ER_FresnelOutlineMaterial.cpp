@@ -18,6 +18,8 @@ namespace EveryRay_Core
 	ER_FresnelOutlineMaterial::ER_FresnelOutlineMaterial(ER_Core& game, const MaterialShaderEntries& entries, unsigned int shaderFlags, bool instanced)
 		: ER_Material(game, entries, shaderFlags)
 	{
+		mPSONonInstanced = ER_Material::GetCore()->GetRHI()->GetPSOHandle(psoNameNonInstanced);
+		mPSOInstanced = ER_Material::GetCore()->GetRHI()->GetPSOHandle(psoNameInstanced);
 		if (shaderFlags & HAS_VERTEX_SHADER)
 		{
 			if (!instanced)
@@ -76,20 +78,20 @@ namespace EveryRay_Core
 		rhi->SetRootSignature(rs);
 		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		const std::string psoName = aObj->IsInstanced() ? psoNameInstanced : psoNameNonInstanced;
-		if (!rhi->IsPSOReady(psoName))
+		const ER_RHI_PSO_HANDLE pso = aObj->IsInstanced() ? mPSOInstanced : mPSONonInstanced;
+		if (!rhi->IsPSOReady(pso))
 		{
-			rhi->InitializePSO(psoName);
+			rhi->InitializePSO(pso);
 			PrepareShaders();
 			rhi->SetRenderTargetFormats({ neededSystems.mIllumination->GetLocalIlluminationRT() }, neededSystems.mIllumination->GetGBufferDepth()); // we assume that we render in local RT (don't like it but idk how to properly pass RT atm)
 			rhi->SetRasterizerState(ER_NO_CULLING);
 			rhi->SetBlendState(ER_ALPHA_BLEND);
 			rhi->SetDepthStencilState(ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
-			rhi->SetRootSignatureToPSO(psoName, rs);
-			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			rhi->FinalizePSO(psoName);
+			rhi->SetRootSignatureToPSO(pso, rs);
+			rhi->SetTopologyTypeToPSO(pso, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			rhi->FinalizePSO(pso);
 		}
-		rhi->SetPSO(psoName);
+		rhi->SetPSO(pso);
 
 		mConstantBuffer.Data.ViewProjection = XMMatrixTranspose(neededSystems.mCamera->ViewMatrix() * neededSystems.mCamera->ProjectionMatrix());
 		mConstantBuffer.Data.CameraPosition = XMFLOAT4{ neededSystems.mCamera->Position().x, neededSystems.mCamera->Position().y, neededSystems.mCamera->Position().z, 1.0f };
@@ -0,0 +1,332 @@
+#include "ER_FrustumCulling.h"
+#include "ER_Frustum.h"
+#include "ER_Utility.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+#include <random>
+
+namespace EveryRay_Core
+{
+	void ER_AABBArray::Resize(UINT aCount)
+	{
+		const UINT paddedCount = (aCount + Alignment - 1) / Alignment * Alignment;
+		mMinX.resize(paddedCount, 0.0f); mMinY.resize(paddedCount, 0.0f); mMinZ.resize(paddedCount, 0.0f);
+		mMaxX.resize(paddedCount, 0.0f); mMaxY.resize(paddedCount, 0.0f); mMaxZ.resize(paddedCount, 0.0f);
+		mCount = aCount;
+	}
+
+	void ER_AABBArray::Set(UINT aIndex, const ER_AABB& aAABB)
+	{
+		assert(aIndex < mCount);
+		mMinX[aIndex] = aAABB.first.x; mMinY[aIndex] = aAABB.first.y; mMinZ[aIndex] = aAABB.first.z;
+		mMaxX[aIndex] = aAABB.second.x; mMaxY[aIndex] = aAABB.second.y; mMaxZ[aIndex] = aAABB.second.z;
+	}
+
+	bool ER_FrustumCulling::IsCulled(const ER_Frustum& aFrustum, const ER_AABB& aAABB)
+	{
+		const XMFLOAT4* planes = aFrustum.Planes();
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			// the most "inner" vertex of the box along the (outward) plane normal
+			const float x = (planes[planeID].x > 0.0f) ? aAABB.first.x : aAABB.second.x;
+			const float y = (planes[planeID].y > 0.0f) ? aAABB.first.y : aAABB.second.y;
+			const float z = (planes[planeID].z > 0.0f) ? aAABB.first.z : aAABB.second.z;
+			if (planes[planeID].x * x + planes[planeID].y * y + planes[planeID].z * z + planes[planeID].w > 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	UINT ER_FrustumCulling::Cull(const ER_Frustum& aFrustum, const ER_AABBArray& aAABBs, std::vector<UINT>& aOutVisibleIndices, ER_FrustumCullingMode aMode)
+	{
+		// SIMD paths write (and then skip) the indices of culled boxes too, so the output has to fit the whole padded batch
+		const UINT requiredSize = (aAABBs.GetCount() + ER_AABBArray::Alignment - 1) / ER_AABBArray::Alignment * ER_AABBArray::Alignment;
+		if (aOutVisibleIndices.size() < requiredSize)
+			aOutVisibleIndices.resize(requiredSize);
+		if (aAABBs.GetCount() == 0)
+			return 0;
+
+		static const bool isAVXSupported = IsAVXSupported();
+		switch (aMode)
+		{
+		case ER_FRUSTUM_CULLING_AVX:
+			if (isAVXSupported)
+				return CullAVX(aFrustum.Planes(), aAABBs, aOutVisibleIndices.data());
+			return CullSSE(aFrustum.Planes(), aAABBs, aOutVisibleIndices.data());
+		case ER_FRUSTUM_CULLING_SSE:
+			return CullSSE(aFrustum.Planes(), aAABBs, aOutVisibleIndices.data());
+		default:
+			return CullScalar(aFrustum.Planes(), aAABBs, aOutVisibleIndices.data());
+		}
+	}
+
+	UINT ER_FrustumCulling::CullScalar(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, UINT* aOutVisibleIndices)
+	{
+		const float* minX = aAABBs.MinX(); const float* minY = aAABBs.MinY(); const float* minZ = aAABBs.MinZ();
+		const float* maxX = aAABBs.MaxX(); const float* maxY = aAABBs.MaxY(); const float* maxZ = aAABBs.MaxZ();
+
+		UINT visibleCount = 0;
+		for (UINT i = 0; i < aAABBs.GetCount(); i++)
+		{
+			bool isCulled = false;
+			for (int planeID = 0; planeID < 6 && !isCulled; planeID++)
+			{
+				const float x = (aPlanes[planeID].x > 0.0f) ? minX[i] : maxX[i];
+				const float y = (aPlanes[planeID].y > 0.0f) ? minY[i] : maxY[i];
+				const float z = (aPlanes[planeID].z > 0.0f) ? minZ[i] : maxZ[i];
+				isCulled = aPlanes[planeID].x * x + aPlanes[planeID].y * y + aPlanes[planeID].z * z + aPlanes[planeID].w > 0.0f;
+			}
+
+			if (!isCulled)
+				aOutVisibleIndices[visibleCount++] = i;
+		}
+		return visibleCount;
+	}
+
+	// The vertex to test depends only on the signs of the plane normal, so instead of selecting per box we select the source arrays once per plane.
+	struct PlaneSources
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+	};
+
+	static void GetPlaneSources(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, PlaneSources* aOutSources)
+	{
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			aOutSources[planeID].x = (aPlanes[planeID].x > 0.0f) ? aAABBs.MinX() : aAABBs.MaxX();
+			aOutSources[planeID].y = (aPlanes[planeID].y > 0.0f) ? aAABBs.MinY() : aAABBs.MaxY();
+			aOutSources[planeID].z = (aPlanes[planeID].z > 0.0f) ? aAABBs.MinZ() : aAABBs.MaxZ();
+		}
+	}
+
+	UINT ER_FrustumCulling::CullSSE(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, UINT* aOutVisibleIndices)
+	{
+		PlaneSources sources[6];
+		GetPlaneSources(aPlanes, aAABBs, sources);
+
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			planeX[planeID] = _mm_set1_ps(aPlanes[planeID].x);
+			planeY[planeID] = _mm_set1_ps(aPlanes[planeID].y);
+			planeZ[planeID] = _mm_set1_ps(aPlanes[planeID].z);
+			planeW[planeID] = _mm_set1_ps(aPlanes[planeID].w);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		const UINT count = aAABBs.GetCount();
+		UINT visibleCount = 0;
+		for (UINT i = 0; i < count; i += 4)
+		{
+			__m128 culled = zero;
+			for (int planeID = 0; planeID < 6; planeID++)
+			{
+				__m128 distance = _mm_mul_ps(planeX[planeID], _mm_loadu_ps(sources[planeID].x + i));
+				distance = _mm_add_ps(distance, _mm_mul_ps(planeY[planeID], _mm_loadu_ps(sources[planeID].y + i)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[planeID], _mm_loadu_ps(sources[planeID].z + i)));
+				distance = _mm_add_ps(distance, planeW[planeID]);
+				culled = _mm_or_ps(culled, _mm_cmpgt_ps(distance, zero));
+			}
+
+			UINT visibleMask = ~static_cast<UINT>(_mm_movemask_ps(culled)) & 0xF;
+			if (count - i < 4)
+				visibleMask &= (1u << (count - i)) - 1; // padding
+
+			// branchless compaction: always write, advance only for visible boxes
+			for (UINT lane = 0; lane < 4; lane++)
+			{
+				aOutVisibleIndices[visibleCount] = i + lane;
+				visibleCount += (visibleMask >> lane) & 1;
+			}
+		}
+		return visibleCount;
+	}
+
+	UINT ER_FrustumCulling::CullAVX(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, UINT* aOutVisibleIndices)
+	{
+		PlaneSources sources[6];
+		GetPlaneSources(aPlanes, aAABBs, sources);
+
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			planeX[planeID] = _mm256_set1_ps(aPlanes[planeID].x);
+			planeY[planeID] = _mm256_set1_ps(aPlanes[planeID].y);
+			planeZ[planeID] = _mm256_set1_ps(aPlanes[planeID].z);
+			planeW[planeID] = _mm256_set1_ps(aPlanes[planeID].w);
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		const UINT count = aAABBs.GetCount();
+		UINT visibleCount = 0;
+		for (UINT i = 0; i < count; i += 8)
+		{
+			// no FMA here: results have to match the scalar and SSE paths bit by bit
+			__m256 culled = zero;
+			for (int planeID = 0; planeID < 6; planeID++)
+			{
+				__m256 distance = _mm256_mul_ps(planeX[planeID], _mm256_loadu_ps(sources[planeID].x + i));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planeY[planeID], _mm256_loadu_ps(sources[planeID].y + i)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[planeID], _mm256_loadu_ps(sources[planeID].z + i)));
+				distance = _mm256_add_ps(distance, planeW[planeID]);
+				culled = _mm256_or_ps(culled, _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+			}
+
+			UINT visibleMask = ~static_cast<UINT>(_mm256_movemask_ps(culled)) & 0xFF;
+			if (count - i < 8)
+				visibleMask &= (1u << (count - i)) - 1; // padding
+
+			for (UINT lane = 0; lane < 8; lane++)
+			{
+				aOutVisibleIndices[visibleCount] = i + lane;
+				visibleCount += (visibleMask >> lane) & 1;
+			}
+		}
+		_mm256_zeroupper();
+		return visibleCount;
+	}
+
+	bool ER_FrustumCulling::IsAVXSupported()
+	{
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 1);
+		const bool isOSXSAVESupported = (cpuInfo[2] & (1 << 27)) != 0;
+		const bool isAVXSupported = (cpuInfo[2] & (1 << 28)) != 0;
+		if (!isOSXSAVESupported || !isAVXSupported)
+			return false;
+
+		// the OS has to save YMM registers on context switches
+		return (_xgetbv(0) & 0x6) == 0x6;
+	}
+
+	const char* ER_FrustumCulling::GetModeName(ER_FrustumCullingMode aMode)
+	{
+		switch (aMode)
+		{
+		case ER_FRUSTUM_CULLING_SCALAR: return "Scalar";
+		case ER_FRUSTUM_CULLING_SSE: return "SSE (4 boxes)";
+		case ER_FRUSTUM_CULLING_AVX: return "AVX (8 boxes)";
+		default: return "Unknown";
+		}
+	}
+
+	bool ER_FrustumCulling::RunTests()
+	{
+		const XMMATRIX view = XMMatrixLookToRH(XMVectorSet(0.0f, 10.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const XMMATRIX projection = XMMatrixPerspectiveFovRH(XM_PIDIV4, 16.0f / 9.0f, 0.5f, 1000.0f);
+		ER_Frustum frustum(XMMatrixMultiply(view, projection));
+
+		std::mt19937 generator(12345);
+		std::uniform_real_distribution<float> positionDistribution(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> sizeDistribution(0.5f, 5.0f);
+		bool isPassed = true;
+
+		const UINT counts[] = { 0, 1, 7, 8, 9, 1001 }; // around the SSE/AVX widths
+		for (UINT count : counts)
+		{
+			ER_AABBArray aabbs;
+			aabbs.Resize(count);
+			std::vector<UINT> referenceIndices;
+			for (UINT i = 0; i < count; i++)
+			{
+				const XMFLOAT3 center(positionDistribution(generator), positionDistribution(generator) * 0.05f, positionDistribution(generator));
+				const float size = sizeDistribution(generator);
+				const ER_AABB aabb(XMFLOAT3(center.x - size, center.y - size, center.z - size), XMFLOAT3(center.x + size, center.y + size, center.z + size));
+				aabbs.Set(i, aabb);
+				if (!IsCulled(frustum, aabb))
+					referenceIndices.push_back(i);
+			}
+
+			std::vector<UINT> visibleIndices;
+			for (int mode = 0; mode < ER_FRUSTUM_CULLING_MODE_COUNT; mode++)
+			{
+				if (mode == ER_FRUSTUM_CULLING_AVX && !IsAVXSupported())
+					continue;
+
+				const UINT visibleCount = Cull(frustum, aabbs, visibleIndices, static_cast<ER_FrustumCullingMode>(mode));
+				isPassed &= visibleCount == referenceIndices.size() && std::equal(referenceIndices.begin(), referenceIndices.end(), visibleIndices.begin());
+			}
+		}
+
+		std::wstring msg = L"[ER Logger][ER_FrustumCulling] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+
+		return isPassed;
+	}
+
+	void ER_FrustumCulling::Benchmark()
+	{
+		const XMMATRIX view = XMMatrixLookToRH(XMVectorSet(0.0f, 10.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const XMMATRIX projection = XMMatrixPerspectiveFovRH(XM_PIDIV4, 16.0f / 9.0f, 0.5f, 1000.0f);
+		ER_Frustum frustum(XMMatrixMultiply(view, projection));
+
+		std::mt19937 generator(12345);
+		std::uniform_real_distribution<float> positionDistribution(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> sizeDistribution(0.5f, 5.0f);
+
+		const UINT counts[] = { 10000, 100000, 1000000 };
+		for (UINT count : counts)
+		{
+			ER_AABBArray aabbs;
+			aabbs.Resize(count);
+			std::vector<ER_AABB> aabbsAoS(count);
+			for (UINT i = 0; i < count; i++)
+			{
+				const XMFLOAT3 center(positionDistribution(generator), positionDistribution(generator) * 0.05f, positionDistribution(generator));
+				const float size = sizeDistribution(generator);
+				aabbsAoS[i] = ER_AABB(XMFLOAT3(center.x - size, center.y - size, center.z - size), XMFLOAT3(center.x + size, center.y + size, center.z + size));
+				aabbs.Set(i, aabbsAoS[i]);
+			}
+
+			const int iterations = std::max(static_cast<int>(10000000 / count), 3);
+			std::wstring msg = L"[ER Logger][ER_FrustumCulling] Benchmark, " + std::to_wstring(count) + L" boxes:";
+
+			// reference: per box IsCulled() over the AoS boxes (like the old per-instance culling lambda)
+			std::vector<UINT> referenceIndices;
+			referenceIndices.reserve(count);
+			double referenceTime = 0.0;
+			{
+				auto startTime = std::chrono::high_resolution_clock::now();
+				for (int iteration = 0; iteration < iterations; iteration++)
+				{
+					referenceIndices.clear();
+					for (UINT i = 0; i < count; i++)
+					{
+						if (!IsCulled(frustum, aabbsAoS[i]))
+							referenceIndices.push_back(i);
+					}
+				}
+				std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - startTime;
+				referenceTime = time.count() / iterations;
+				msg += L" AoS " + std::to_wstring(referenceTime) + L"ms (" + std::to_wstring(referenceIndices.size()) + L" visible);";
+			}
+
+			std::vector<UINT> visibleIndices;
+			for (int mode = 0; mode < ER_FRUSTUM_CULLING_MODE_COUNT; mode++)
+			{
+				if (mode == ER_FRUSTUM_CULLING_AVX && !IsAVXSupported())
+					continue;
+
+				UINT visibleCount = 0;
+				auto startTime = std::chrono::high_resolution_clock::now();
+				for (int iteration = 0; iteration < iterations; iteration++)
+					visibleCount = Cull(frustum, aabbs, visibleIndices, static_cast<ER_FrustumCullingMode>(mode));
+				std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - startTime;
+
+				const bool isMatching = visibleCount == referenceIndices.size() && std::equal(referenceIndices.begin(), referenceIndices.end(), visibleIndices.begin());
+				assert(isMatching);
+
+				const double modeTime = time.count() / iterations;
+				msg += L" " + ER_Utility::ToWideString(GetModeName(static_cast<ER_FrustumCullingMode>(mode))) + L" " + std::to_wstring(modeTime) +
+					L"ms (x" + std::to_wstring(referenceTime / modeTime) + (isMatching ? L")" : L", MISMATCH!)") + L";";
+			}
+
+			msg += L'\n';
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+	}
+}
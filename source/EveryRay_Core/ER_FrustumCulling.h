@@ -0,0 +1,62 @@
+#pragma once
+#include "Common.h"
+
+namespace EveryRay_Core
+{
+	class ER_Frustum;
+
+	enum ER_FrustumCullingMode
+	{
+		ER_FRUSTUM_CULLING_SCALAR = 0,
+		ER_FRUSTUM_CULLING_SSE,
+		ER_FRUSTUM_CULLING_AVX, // falls back to SSE on CPUs without AVX
+
+		ER_FRUSTUM_CULLING_MODE_COUNT
+	};
+
+	// AABBs in SoA layout, padded to ER_AABBArray::Alignment elements so that SIMD loops do not need a scalar tail
+	class ER_AABBArray
+	{
+	public:
+		static const UINT Alignment = 8;
+
+		void Resize(UINT aCount);
+		void Set(UINT aIndex, const ER_AABB& aAABB);
+		UINT GetCount() const { return mCount; }
+
+		const float* MinX() const { return mMinX.data(); }
+		const float* MinY() const { return mMinY.data(); }
+		const float* MinZ() const { return mMinZ.data(); }
+		const float* MaxX() const { return mMaxX.data(); }
+		const float* MaxY() const { return mMaxY.data(); }
+		const float* MaxZ() const { return mMaxZ.data(); }
+	private:
+		std::vector<float> mMinX, mMinY, mMinZ;
+		std::vector<float> mMaxX, mMaxY, mMaxZ;
+		UINT mCount = 0;
+	};
+
+	// Batched CPU frustum culling: tests 1/4/8 boxes per iteration against all 6 planes (box is culled if it is fully outside of any plane).
+	class ER_FrustumCulling
+	{
+	public:
+		static bool IsCulled(const ER_Frustum& aFrustum, const ER_AABB& aAABB);
+
+		// Writes the indices of the visible boxes (in ascending order) to aOutVisibleIndices and returns their count.
+		// aOutVisibleIndices is only resized when it is too small, so it can be reused across frames without allocations.
+		static UINT Cull(const ER_Frustum& aFrustum, const ER_AABBArray& aAABBs, std::vector<UINT>& aOutVisibleIndices, ER_FrustumCullingMode aMode);
+
+		static bool IsAVXSupported();
+		static ER_FrustumCullingMode GetBestMode() { return IsAVXSupported() ? ER_FRUSTUM_CULLING_AVX : ER_FRUSTUM_CULLING_SSE; }
+		static const char* GetModeName(ER_FrustumCullingMode aMode);
+
+		// Checks that all the paths give the same results as the per box IsCulled() (including the SIMD tails), see ER_Tests
+		static bool RunTests();
+		// Checks that all the paths give the same results and logs their timings
+		static void Benchmark();
+	private:
+		static UINT CullScalar(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, UINT* aOutVisibleIndices);
+		static UINT CullSSE(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, UINT* aOutVisibleIndices);
+		static UINT CullAVX(const XMFLOAT4* aPlanes, const ER_AABBArray& aAABBs, UINT* aOutVisibleIndices);
+	};
+}
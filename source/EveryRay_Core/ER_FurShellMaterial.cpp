@@ -18,6 +18,8 @@ namespace EveryRay_Core
 	ER_FurShellMaterial::ER_FurShellMaterial(ER_Core& game, const MaterialShaderEntries& entries, unsigned int shaderFlags, bool instanced, int currentIndex)
 		: ER_Material(game, entries, shaderFlags), mCurrentIndex(currentIndex)
 	{
+		mPSONonInstanced = ER_Material::GetCore()->GetRHI()->GetPSOHandle(psoNameNonInstanced);
+		mPSOInstanced = ER_Material::GetCore()->GetRHI()->GetPSOHandle(psoNameInstanced);
 		assert(mCurrentIndex > -1);
 		if (shaderFlags & HAS_VERTEX_SHADER)
 		{
@@ -72,20 +74,20 @@ namespace EveryRay_Core
 		rhi->SetRootSignature(rs);
 		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		const std::string psoName = aObj->IsInstanced() ? psoNameInstanced : psoNameNonInstanced;
-		if (!rhi->IsPSOReady(psoName))
+		const ER_RHI_PSO_HANDLE pso = aObj->IsInstanced() ? mPSOInstanced : mPSONonInstanced;
+		if (!rhi->IsPSOReady(pso))
 		{
-			rhi->InitializePSO(psoName);
+			rhi->InitializePSO(pso);
 			PrepareShaders();
 			rhi->SetRenderTargetFormats({ neededSystems.mIllumination->GetLocalIlluminationRT() }, neededSystems.mIllumination->GetGBufferDepth()); // we assume that we render in local RT (don't like it but idk how to properly pass RT atm)
 			rhi->SetRasterizerState(ER_BACK_CULLING);
 			rhi->SetBlendState(ER_ALPHA_BLEND);
 			rhi->SetDepthStencilState(ER_DEPTH_ONLY_READ_COMPARISON_LESS_EQUAL);
-			rhi->SetRootSignatureToPSO(psoName, rs);
-			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			rhi->FinalizePSO(psoName);
+			rhi->SetRootSignatureToPSO(pso, rs);
+			rhi->SetTopologyTypeToPSO(pso, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			rhi->FinalizePSO(pso);
 		}
-		rhi->SetPSO(psoName);
+		rhi->SetPSO(pso);
 
 		float time = static_cast<float>(GetCore()->GetCoreTotalTime());
 
@@ -105,7 +107,7 @@ namespace EveryRay_Core
 		rhi->SetConstantBuffers(ER_VERTEX, { mConstantBuffer.Buffer(), aObj->GetObjectsConstantBuffer().Buffer() }, 0, rs, FUR_SHELL_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 		rhi->SetConstantBuffers(ER_PIXEL, { mConstantBuffer.Buffer(), aObj->GetObjectsConstantBuffer().Buffer() }, 0, rs, FUR_SHELL_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 
-		std::vector<ER_RHI_GPUResource*> resources(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + NUM_SHADOW_CASCADES + 1);
+		ER_RHI_InlineArray<ER_RHI_GPUResource*, LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + NUM_SHADOW_CASCADES + 1> resources(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + NUM_SHADOW_CASCADES + 1);
 		resources[0] = aObj->GetTextureData(meshIndex).AlbedoMap;
 		resources[1] = aObj->GetFurHeightTexture();
 		resources[2] = aObj->GetFurMaskTexture(meshIndex);
@@ -7,6 +7,10 @@
 #include "ER_RenderingObject.h"
 #include "ER_Utility.h"
 #include "ER_Scene.h"
+#include "ER_Terrain.h"
+#include "RHI\ER_RHI_RecordingContext.h"
+
+#define GBUFFER_MIN_OBJECTS_PER_RECORDING_CONTEXT 16
 
 namespace EveryRay_Core {
 
@@ -72,6 +76,11 @@ namespace EveryRay_Core {
 			mRootSignature->InitConstant(rhi, GBUFFER_MAT_ROOT_CONSTANT_INDEX, 2 /*we already use 2 slots for CBVs*/, 1 /* only 1 constant for LOD index*/, ER_RHI_SHADER_VISIBILITY_ALL);
 			mRootSignature->Finalize(rhi, "ER_RHI_GPURootSignature: GBufferMaterial Pass", true);
 		}
+
+		mPSONonInstanced = rhi->GetPSOHandle(psoNameNonInstanced);
+		mPSOInstanced = rhi->GetPSOHandle(psoNameInstanced);
+		mPSONonInstancedWireframe = rhi->GetPSOHandle(psoNameNonInstancedWireframe);
+		mPSOInstancedWireframe = rhi->GetPSOHandle(psoNameInstancedWireframe);
 	}
 
 	void ER_GBuffer::Update(const ER_CoreTime& time)
@@ -101,55 +110,133 @@ namespace EveryRay_Core {
 		rhi->UnbindRenderTargets();
 	}
 
-	void ER_GBuffer::Draw(const ER_Scene* scene)
+	void ER_GBuffer::Draw(const ER_Scene* scene, ER_Terrain* terrain)
 	{
 		auto rhi = GetCore()->GetRHI();
 		if (!mIsEnabled)
 			return;
 
+		mObjectsToDraw.clear();
+		for (auto renderingObjectInfo = scene->objects.begin(); renderingObjectInfo != scene->objects.end(); renderingObjectInfo++)
+		{
+			ER_RenderingObject* renderingObject = renderingObjectInfo->second;
+			if (!renderingObject->IsCulled() && renderingObject->GetMaterials().find(ER_MaterialHelper::gbufferMaterialName) != renderingObject->GetMaterials().end())
+				mObjectsToDraw.push_back(renderingObject);
+		}
+		const UINT objectsCount = static_cast<UINT>(mObjectsToDraw.size());
+
+		ER_JobSystem* jobSystem = GetCore()->GetJobSystem();
+		if (!jobSystem || !rhi->IsParallelRecordingSupported())
+		{
+			rhi->BeginEventTag("EveryRay: GBuffer (objects)");
+			DrawObjects(0, objectsCount);
+			rhi->EndEventTag();
+
+			rhi->BeginEventTag("EveryRay: GBuffer (terrain)");
+			if (terrain)
+				DrawTerrain(terrain);
+			rhi->EndEventTag();
+			return;
+		}
+
+		// PSOs can not be created while recording in parallel
+		for (ER_RenderingObject* renderingObject : mObjectsToDraw)
+			PreparePSO(GetPSO(renderingObject), renderingObject->GetMaterials().find(ER_MaterialHelper::gbufferMaterialName)->second);
+		if (terrain)
+			terrain->PreparePSO(TerrainRenderPass::TERRAIN_GBUFFER, { mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
+
+		// contexts: batches of objects (in the order of the scene) and the terrain after them
+		const UINT maxBatchesCount = std::min(static_cast<UINT>(jobSystem->GetWorkerCount() + 1), static_cast<UINT>(ER_RHI_MAX_RECORDING_CONTEXTS - 1));
+		const UINT batchesCount = objectsCount > 0 ? std::max(1u, std::min(maxBatchesCount, objectsCount / GBUFFER_MIN_OBJECTS_PER_RECORDING_CONTEXT)) : 0;
+		const UINT contextsCount = batchesCount + (terrain ? 1 : 0);
+		if (contextsCount == 0)
+			return;
+
+		auto recordContext = [&](UINT aContextIndex)
+		{
+			rhi->BeginRecordingContext(aContextIndex);
+			rhi->SetRenderTargets({ mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
+			if (aContextIndex < batchesCount)
+			{
+				rhi->BeginEventTag("EveryRay: GBuffer (objects), batch " + std::to_string(aContextIndex));
+				DrawObjects(objectsCount * aContextIndex / batchesCount, objectsCount * (aContextIndex + 1) / batchesCount);
+				rhi->EndEventTag();
+			}
+			else
+			{
+				rhi->BeginEventTag("EveryRay: GBuffer (terrain)");
+				DrawTerrain(terrain);
+				rhi->EndEventTag();
+			}
+			rhi->EndRecordingContext();
+		};
+
+		rhi->BeginParallelRecording();
+		ER_JobCounter counter;
+		jobSystem->ParallelFor(contextsCount, 1, recordContext, &counter);
+		jobSystem->Wait(counter);
+		rhi->EndParallelRecording();
+
+		// render targets are not inherited back from the contexts
+		rhi->SetRenderTargets({ mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
+	}
+
+	void ER_GBuffer::DrawObjects(UINT aFirstObject, UINT aLastObject)
+	{
+		auto rhi = GetCore()->GetRHI();
+
 		rhi->SetRootSignature(mRootSignature);
 		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 		ER_MaterialSystems materialSystems;
-		std::string psoName;
 
-		for (auto renderingObjectInfo = scene->objects.begin(); renderingObjectInfo != scene->objects.end(); renderingObjectInfo++)
+		for (UINT i = aFirstObject; i < aLastObject; i++)
 		{
-			ER_RenderingObject* renderingObject = renderingObjectInfo->second;
-			if (renderingObject->IsCulled())
-				continue;
-
-			psoName = ER_Utility::IsWireframe ? psoNameNonInstancedWireframe : psoNameNonInstanced;
-			if (renderingObject->IsInstanced())
-				psoName = ER_Utility::IsWireframe ? psoNameInstancedWireframe : psoNameInstanced;
+			ER_RenderingObject* renderingObject = mObjectsToDraw[i];
+			ER_GBufferMaterial* material = static_cast<ER_GBufferMaterial*>(renderingObject->GetMaterials().find(ER_MaterialHelper::gbufferMaterialName)->second);
 
-			auto materialInfo = renderingObject->GetMaterials().find(ER_MaterialHelper::gbufferMaterialName);
-			if (materialInfo != renderingObject->GetMaterials().end())
+			ER_RHI_PSO_HANDLE pso = GetPSO(renderingObject);
+			PreparePSO(pso, material);
+			rhi->SetPSO(pso);
+			for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
 			{
-				ER_GBufferMaterial* material = static_cast<ER_GBufferMaterial*>(materialInfo->second);
-				if (!rhi->IsPSOReady(psoName))
-				{
-					rhi->InitializePSO(psoName);
-					material->PrepareShaders();
-					rhi->SetRasterizerState(ER_Utility::IsWireframe ? ER_WIREFRAME : ER_NO_CULLING);
-					rhi->SetBlendState(ER_NO_BLEND);
-					rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
-					rhi->SetRenderTargetFormats({ mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
-					rhi->SetRootSignatureToPSO(psoName, mRootSignature);
-					rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-					rhi->FinalizePSO(psoName);
-				}
-				rhi->SetPSO(psoName);
-				for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
-				{
-					material->PrepareForRendering(materialSystems, renderingObject, meshIndex, mRootSignature);
-					renderingObject->Draw(ER_MaterialHelper::gbufferMaterialName, true, meshIndex);
-				}
+				material->PrepareForRendering(materialSystems, renderingObject, meshIndex, mRootSignature);
+				renderingObject->Draw(ER_MaterialHelper::gbufferMaterialName, true, meshIndex);
 			}
 		}
 		rhi->UnsetPSO();
 	}
 
+	void ER_GBuffer::DrawTerrain(ER_Terrain* aTerrain)
+	{
+		aTerrain->Draw(TerrainRenderPass::TERRAIN_GBUFFER, { mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
+	}
+
+	void ER_GBuffer::PreparePSO(ER_RHI_PSO_HANDLE aPSO, ER_Material* aMaterial)
+	{
+		auto rhi = GetCore()->GetRHI();
+		if (rhi->IsPSOReady(aPSO))
+			return;
+
+		rhi->InitializePSO(aPSO);
+		aMaterial->PrepareShaders();
+		rhi->SetRasterizerState(ER_Utility::IsWireframe ? ER_WIREFRAME : ER_NO_CULLING);
+		rhi->SetBlendState(ER_NO_BLEND);
+		rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
+		rhi->SetRenderTargetFormats({ mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
+		rhi->SetRootSignatureToPSO(aPSO, mRootSignature);
+		rhi->SetTopologyTypeToPSO(aPSO, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		rhi->FinalizePSO(aPSO);
+	}
+
+	ER_RHI_PSO_HANDLE ER_GBuffer::GetPSO(ER_RenderingObject* aObject) const
+	{
+		if (aObject->IsInstanced())
+			return ER_Utility::IsWireframe ? mPSOInstancedWireframe : mPSOInstanced;
+		else
+			return ER_Utility::IsWireframe ? mPSONonInstancedWireframe : mPSONonInstanced;
+	}
+
 	void ER_GBuffer::UpdateImGui()
 	{
 		if (!mShowDebug)
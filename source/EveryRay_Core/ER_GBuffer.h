@@ -8,6 +8,9 @@ namespace EveryRay_Core
 {
 	class ER_Scene;
 	class ER_Camera;
+	class ER_Terrain;
+	class ER_RenderingObject;
+	class ER_Material;
 
 	enum GBufferDebugMode
 	{
@@ -31,7 +34,8 @@ namespace EveryRay_Core
 
 		void Start();
 		void End();
-		void Draw(const ER_Scene* scene);
+		// Objects (and terrain) are recorded in parallel batches if the RHI supports it; the GBuffer targets are bound on the main command list after it (i.e., for foliage)
+		void Draw(const ER_Scene* scene, ER_Terrain* terrain = nullptr);
 		void Config() { mShowDebug = !mShowDebug; }
 		bool IsEnabled() { return mIsEnabled; }
 
@@ -46,8 +50,16 @@ namespace EveryRay_Core
 
 	private:
 		void UpdateImGui();
+		void DrawObjects(UINT aFirstObject, UINT aLastObject);
+		void DrawTerrain(ER_Terrain* aTerrain);
+		void PreparePSO(ER_RHI_PSO_HANDLE aPSO, ER_Material* aMaterial);
+		ER_RHI_PSO_HANDLE GetPSO(ER_RenderingObject* aObject) const;
 
 		ER_RHI_GPURootSignature* mRootSignature = nullptr;
+		ER_RHI_PSO_HANDLE mPSONonInstanced = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOInstanced = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSONonInstancedWireframe = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOInstancedWireframe = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUTexture* mDepthBuffer = nullptr;
 		ER_RHI_GPUTexture* mAlbedoBuffer= nullptr;
@@ -56,6 +68,8 @@ namespace EveryRay_Core
 		ER_RHI_GPUTexture* mExtraBuffer = nullptr;
 		ER_RHI_GPUTexture* mExtra2Buffer = nullptr;
 
+		std::vector<ER_RenderingObject*> mObjectsToDraw; // not culled and with the material, kept between frames
+
 		int mWidth;
 		int mHeight;
 		bool mIsEnabled = true;
@@ -78,7 +78,7 @@ namespace EveryRay_Core
 
 		rhi->SetConstantBuffers(ER_PIXEL, { mConstantBuffer.Buffer() , aObj->GetObjectsConstantBuffer().Buffer() }, 0, rs, GBUFFER_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 
-		std::vector<ER_RHI_GPUResource*> resources;
+		ER_RHI_InlineArray<ER_RHI_GPUResource*, 6> resources;
 		resources.push_back(aObj->GetTextureData(meshIndex).AlbedoMap);	
 		resources.push_back(aObj->GetTextureData(meshIndex).NormalMap);
 		resources.push_back(aObj->GetTextureData(meshIndex).RoughnessMap);
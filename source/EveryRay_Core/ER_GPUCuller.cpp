@@ -67,6 +67,9 @@ namespace EveryRay_Core
 			mIndirectCullingClearRS->Finalize(rhi, "ER_RHI_GPURootSignature: Indirect Culling Clear");
 		}
 
+		mPSO = rhi->GetPSOHandle(mPSOName, true);
+		mPSOClear = rhi->GetPSOHandle(mPSOClearName, true);
+
 		//cbuffers
 #if ER_PLATFORM_WIN64_DX11
 		mMeshConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: GPU Culler Mesh CB");
@@ -81,14 +84,14 @@ namespace EveryRay_Core
 		auto rhi = mCore.GetRHI();
 
 		rhi->SetRootSignature(mIndirectCullingClearRS, true);
-		if (!rhi->IsPSOReady(mPSOClearName, true))
+		if (!rhi->IsPSOReady(mPSOClear))
 		{
-			rhi->InitializePSO(mPSOClearName, true);
+			rhi->InitializePSO(mPSOClear);
 			rhi->SetShader(mIndirectCullingClearCS);
-			rhi->SetRootSignatureToPSO(mPSOClearName, mIndirectCullingClearRS, true);
-			rhi->FinalizePSO(mPSOClearName, true);
+			rhi->SetRootSignatureToPSO(mPSOClear, mIndirectCullingClearRS);
+			rhi->FinalizePSO(mPSOClear);
 		}
-		rhi->SetPSO(mPSOClearName, true);
+		rhi->SetPSO(mPSOClear);
 
 		for (ER_SceneObject& obPair : aScene->objects)
 		{
@@ -138,14 +141,14 @@ namespace EveryRay_Core
 		rhi->BeginEventTag("EveryRay: GPU culling - Main pass");
 
 		rhi->SetRootSignature(mIndirectCullingRS, true);
-		if (!rhi->IsPSOReady(mPSOName, true))
+		if (!rhi->IsPSOReady(mPSO))
 		{
-			rhi->InitializePSO(mPSOName, true);
+			rhi->InitializePSO(mPSO);
 			rhi->SetShader(mIndirectCullingCS);
-			rhi->SetRootSignatureToPSO(mPSOName, mIndirectCullingRS, true);
-			rhi->FinalizePSO(mPSOName, true);
+			rhi->SetRootSignatureToPSO(mPSO, mIndirectCullingRS);
+			rhi->FinalizePSO(mPSO);
 		}
-		rhi->SetPSO(mPSOName, true);
+		rhi->SetPSO(mPSO);
 
 		for (int i = 0; i < 6; ++i)
 			mCameraConstantBuffer.Data.FrustumPlanes[i] = aCamera->GetFrustum().Planes()[i];
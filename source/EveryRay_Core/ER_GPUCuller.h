@@ -52,6 +52,8 @@ namespace EveryRay_Core
 		ER_RHI_GPURootSignature* mIndirectCullingClearRS = nullptr;
 		const std::string mPSOName = "ER_RHI_GPUPipelineStateObject: Indirect Cull Pass";
 		const std::string mPSOClearName = "ER_RHI_GPUPipelineStateObject: Indirect Cull Pass Clear";
+		ER_RHI_PSO_HANDLE mPSO = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOClear = ER_RHI_INVALID_PSO_HANDLE;
 		
 		int mIndirectCullsCounterPerFrame = 0;
 	};
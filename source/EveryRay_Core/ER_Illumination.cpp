@@ -595,7 +595,7 @@ namespace EveryRay_Core {
 			}
 			rhi->SetPSO(mVCTMainPSOName, true);
 			rhi->SetSamplers(ER_COMPUTE, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP });
-			std::vector<ER_RHI_GPUResource*> resources(4 + NUM_VOXEL_GI_CASCADES);
+			ER_RHI_InlineArray<ER_RHI_GPUResource*, 4 + NUM_VOXEL_GI_CASCADES> resources(4 + NUM_VOXEL_GI_CASCADES);
 			resources[0] = gbuffer->GetAlbedo();
 			resources[1] = gbuffer->GetNormals();
 			resources[2] = gbuffer->GetPositions();
@@ -849,6 +849,10 @@ namespace EveryRay_Core {
 				ImGui::Checkbox("DEBUG - Hide culled probes", &mProbesManager->mDebugDiscardCulledProbes);
 				ImGui::Checkbox("DEBUG - Diffuse probes", &mDrawDiffuseProbes);
 				ImGui::Checkbox("DEBUG - Specular probes", &mDrawSpecularProbes);
+
+				const ER_LightProbesResidencyStats& residencyStats = mProbesManager->GetSpecularProbesResidencyStats();
+				ImGui::Text("Specular probes in volume: %d (resident: %d, copied: %d, evicted: %d)", residencyStats.visibleProbes, residencyStats.hits, residencyStats.uploads, residencyStats.evictions);
+				ImGui::Text("Specular probes indices changed: %d, copied in total: %llu", residencyStats.changedIndices, residencyStats.totalUploads);
 			}
 		}
 		if (ImGui::CollapsingHeader("Shadow Properties"))
@@ -974,15 +978,14 @@ namespace EveryRay_Core {
 				rhi->SetConstantBuffers(ER_COMPUTE, { mDeferredLightingConstantBuffer.Buffer() }, 0, mDeferredLightingRS, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, true);
 		}
 
-		std::vector<ER_RHI_GPUResource*> resources(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1);
+		ER_RHI_InlineArray<ER_RHI_GPUResource*, LIGHTING_SRV_INDEX_MAX + 1> resources(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1);
 		resources[0] = gbuffer->GetAlbedo();
 		resources[1] = gbuffer->GetNormals();
 		resources[2] = gbuffer->GetPositions();
 		resources[3] = gbuffer->GetExtraBuffer();
 		resources[4] = gbuffer->GetExtra2Buffer();
 		
-		std::vector<ER_RHI_GPUResource*> commonResources = GetCommonLightingShaderResources();
-		resources.insert(resources.end(), commonResources.begin(), commonResources.end());
+		GetCommonLightingShaderResources(resources);
 
 		rhi->SetShaderResources(ER_COMPUTE, resources, 0, mDeferredLightingRS, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, true);
 
@@ -1026,29 +1029,29 @@ namespace EveryRay_Core {
 		}
 	}
 
-	std::vector<ER_RHI_GPUResource*> ER_Illumination::GetCommonLightingShaderResources()
+	// Appends the shadow cascades, probes and lights after the material textures (LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1 resources)
+	void ER_Illumination::GetCommonLightingShaderResources(ER_RHI_InlineArray<ER_RHI_GPUResource*, LIGHTING_SRV_INDEX_MAX + 1>& aResources)
 	{
-		std::vector<ER_RHI_GPUResource*> resources(LIGHTING_SRV_INDEX_MAX - LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES, nullptr);
+		assert(aResources.size() == LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1);
+		aResources.resize(LIGHTING_SRV_INDEX_MAX + 1, nullptr);
 		for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_CSM_START + i] = mShadowMapper.GetShadowTexture(i);
+			aResources[LIGHTING_SRV_INDEX_CSM_START + i] = mShadowMapper.GetShadowTexture(i);
 
 		if (mProbesManager->AreGlobalProbesReady())
 		{
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_GLOBAL_DIFFUSE_PROBE] = mProbesManager->GetGlobalDiffuseProbe()->GetCubemapTexture();
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_DIFFUSE_PROBES_CELLS_INDICES] = mProbesManager->IsEnabled() ? mProbesManager->GetDiffuseProbesCellsIndicesBuffer() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_DIFFUSE_PROBES_SH_COEFFICIENTS] = mProbesManager->IsEnabled() ? mProbesManager->GetDiffuseProbesSphericalHarmonicsCoefficientsBuffer() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_DIFFUSE_PROBES_POSITIONS] = mProbesManager->IsEnabled() ? mProbesManager->GetDiffuseProbesPositionsBuffer() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_GLOBAL_SPECULAR_PROBE] = mProbesManager->GetGlobalSpecularProbe()->GetCubemapTexture();
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_SPECULAR_PROBES_CULLED] = mProbesManager->IsEnabled() ? mProbesManager->GetCulledSpecularProbesTextureArray() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_SPECULAR_PROBES_CELLS_INDICES] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesCellsIndicesBuffer() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_SPECULAR_PROBES_ARRAY_INDICES] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesTexArrayIndicesBuffer() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_SPECULAR_PROBES_POSITIONS] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesPositionsBuffer() : nullptr;
-			resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_INTEGRATION_MAP] = mProbesManager->GetIntegrationMap();
+			aResources[LIGHTING_SRV_INDEX_GLOBAL_DIFFUSE_PROBE] = mProbesManager->GetGlobalDiffuseProbe()->GetCubemapTexture();
+			aResources[LIGHTING_SRV_INDEX_DIFFUSE_PROBES_CELLS_INDICES] = mProbesManager->IsEnabled() ? mProbesManager->GetDiffuseProbesCellsIndicesBuffer() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_DIFFUSE_PROBES_SH_COEFFICIENTS] = mProbesManager->IsEnabled() ? mProbesManager->GetDiffuseProbesSphericalHarmonicsCoefficientsBuffer() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_DIFFUSE_PROBES_POSITIONS] = mProbesManager->IsEnabled() ? mProbesManager->GetDiffuseProbesPositionsBuffer() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_GLOBAL_SPECULAR_PROBE] = mProbesManager->GetGlobalSpecularProbe()->GetCubemapTexture();
+			aResources[LIGHTING_SRV_INDEX_SPECULAR_PROBES_CULLED] = mProbesManager->IsEnabled() ? mProbesManager->GetCulledSpecularProbesTextureArray() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_SPECULAR_PROBES_CELLS_INDICES] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesCellsIndicesBuffer() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_SPECULAR_PROBES_ARRAY_INDICES] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesTexArrayIndicesBuffer() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_SPECULAR_PROBES_POSITIONS] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesPositionsBuffer() : nullptr;
+			aResources[LIGHTING_SRV_INDEX_INTEGRATION_MAP] = mProbesManager->GetIntegrationMap();
 		}
 
-		resources[-(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1) + LIGHTING_SRV_INDEX_POINT_LIGHTS] = mPointLightsBuffer;
-
-		return resources;
+		aResources[LIGHTING_SRV_INDEX_POINT_LIGHTS] = mPointLightsBuffer;
 	}
 
 	void ER_Illumination::PreparePipelineForForwardLighting(ER_RenderingObject* aObj)
@@ -1151,15 +1154,14 @@ namespace EveryRay_Core {
 				rhi->SetConstantBuffers(ER_PIXEL,  { mForwardLightingConstantBuffer.Buffer(), aObj->GetObjectsConstantBuffer().Buffer(), mLightProbesConstantBuffer.Buffer() }, 0, mForwardLightingRS, FORWARD_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 			}
 
-			std::vector<ER_RHI_GPUResource*> resources(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1);
+			ER_RHI_InlineArray<ER_RHI_GPUResource*, LIGHTING_SRV_INDEX_MAX + 1> resources(LIGHTING_SRV_INDEX_MAX_RESERVED_FOR_TEXTURES + 1);
 			resources[0] = aObj->GetTextureData(meshIndex).AlbedoMap;
 			resources[1] = aObj->GetTextureData(meshIndex).NormalMap;
 			resources[2] = aObj->GetTextureData(meshIndex).MetallicMap;
 			resources[3] = aObj->GetTextureData(meshIndex).RoughnessMap;
 			resources[4] = aObj->IsTransparent() ? aObj->GetTextureData(meshIndex).ExtraMaskMap : aObj->GetTextureData(meshIndex).HeightMap;
 
-			std::vector<ER_RHI_GPUResource*> commonResources = GetCommonLightingShaderResources();
-			resources.insert(resources.end(), commonResources.begin(), commonResources.end());
+			GetCommonLightingShaderResources(resources);
 
 			rhi->SetShaderResources(ER_PIXEL, resources, 0, mForwardLightingRS, FORWARD_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_PIXEL_SRV_INDEX);
 
@@ -198,7 +198,7 @@ namespace EveryRay_Core
 		void DrawForwardLighting(ER_GBuffer* gbuffer, ER_RHI_GPUTexture* aRenderTarget);
 
 		// resources that are common for both forward / deferred shaders
-		std::vector<ER_RHI_GPUResource*> GetCommonLightingShaderResources();
+		void GetCommonLightingShaderResources(ER_RHI_InlineArray<ER_RHI_GPUResource*, LIGHTING_SRV_INDEX_MAX + 1>& aResources);
 
 		void UpdateImGui();
 		void UpdateVoxelCameraPosition();
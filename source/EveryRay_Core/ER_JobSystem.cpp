@@ -0,0 +1,362 @@
+#include "ER_JobSystem.h"
+#include "ER_Utility.h"
+#include "ER_CPUProfiler.h"
+
+namespace EveryRay_Core
+{
+	static thread_local int sWorkerIndex = -1;
+	static thread_local const ER_JobSystem* sWorkerOwner = nullptr;
+
+	ER_JobSystem::ER_JobSystem(int aWorkerCount)
+		: mPendingJobsCount(0), mQueuedJobsCount(0), mNextQueueIndex(0), mIsRunning(true)
+	{
+		if (aWorkerCount < 0)
+			aWorkerCount = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1);
+
+		// with no workers, all the jobs are executed by the threads that wait for them
+		const int queueCount = std::max(aWorkerCount, 1);
+		for (int i = 0; i < queueCount; i++)
+			mQueues.push_back(new WorkerQueue());
+
+		mWorkers.reserve(aWorkerCount);
+		for (int i = 0; i < aWorkerCount; i++)
+			mWorkers.push_back(std::thread(&ER_JobSystem::WorkerLoop, this, i));
+
+		std::wstring msg = L"[ER Logger][ER_JobSystem] Started job system with " + std::to_wstring(aWorkerCount) + L" worker threads\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+
+	ER_JobSystem::~ER_JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mIsRunning = false;
+		}
+		mSleepCondition.notify_all();
+
+		for (auto& worker : mWorkers)
+			worker.join();
+		mWorkers.clear();
+
+		assert(mPendingJobs.empty());
+		DeletePointerCollection(mQueues);
+	}
+
+	bool ER_JobSystem::IsWorkerThread()
+	{
+		return sWorkerIndex != -1;
+	}
+
+	void ER_JobSystem::Submit(const std::function<void()>& aTask, ER_JobCounter* aCounter, const ER_JobCounter* aDependency)
+	{
+		ER_Job job;
+		job.mTask = aTask;
+		job.mCounter = aCounter;
+
+		if (aCounter)
+			aCounter->mValue.fetch_add(1, std::memory_order_acq_rel);
+
+		if (aDependency)
+		{
+			// the pending job is announced before its dependency is checked, while FinishJob() checks for pending jobs after the counter reaches zero:
+			// either the dependency is seen as done here or FinishJob() sees the pending job (and waits for this lock to release it)
+			std::lock_guard<std::mutex> lock(mPendingJobsMutex);
+			mPendingJobsCount.fetch_add(1, std::memory_order_seq_cst);
+			if (aDependency->mValue.load(std::memory_order_seq_cst) != 0)
+			{
+				job.mDependency = aDependency;
+				mPendingJobs.push_back(std::move(job));
+				return;
+			}
+			mPendingJobsCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		PushJob(std::move(job));
+	}
+
+	void ER_JobSystem::ParallelFor(UINT aCount, UINT aBatchSize, const std::function<void(UINT)>& aTask, ER_JobCounter* aCounter, const ER_JobCounter* aDependency)
+	{
+		if (aBatchSize == 0)
+			aBatchSize = 1;
+
+		for (UINT first = 0; first < aCount; first += aBatchSize)
+		{
+			const UINT last = std::min(first + aBatchSize, aCount);
+			Submit([aTask, first, last]()
+			{
+				for (UINT i = first; i < last; i++)
+					aTask(i);
+			}, aCounter, aDependency);
+		}
+	}
+
+	void ER_JobSystem::Wait(const ER_JobCounter& aCounter)
+	{
+		while (!aCounter.IsDone())
+		{
+			if (!TryExecuteJob())
+				std::this_thread::yield();
+		}
+	}
+
+	void ER_JobSystem::WaitUntil(const std::function<bool()>& aIsDone)
+	{
+		while (!aIsDone())
+		{
+			if (!TryExecuteJob())
+				std::this_thread::yield();
+		}
+	}
+
+	void ER_JobSystem::WorkerLoop(int aWorkerIndex)
+	{
+		sWorkerIndex = aWorkerIndex;
+		sWorkerOwner = this;
+		ER_CPUProfiler::SetThreadName("Job worker " + std::to_string(aWorkerIndex));
+
+		while (true)
+		{
+			if (TryExecuteJob())
+				continue;
+
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			mSleepCondition.wait(lock, [this] { return mQueuedJobsCount.load(std::memory_order_acquire) > 0 || !mIsRunning; });
+			if (!mIsRunning && mQueuedJobsCount.load(std::memory_order_acquire) == 0)
+				break;
+		}
+
+		sWorkerIndex = -1;
+		sWorkerOwner = nullptr;
+	}
+
+	void ER_JobSystem::PushJob(ER_Job&& aJob)
+	{
+		// workers keep their jobs local (others can steal them); other threads spread the jobs across all the workers
+		UINT queueIndex;
+		if (sWorkerOwner == this)
+			queueIndex = static_cast<UINT>(sWorkerIndex);
+		else
+			queueIndex = mNextQueueIndex.fetch_add(1, std::memory_order_relaxed) % static_cast<UINT>(mQueues.size());
+
+		{
+			std::lock_guard<std::mutex> lock(mQueues[queueIndex]->mMutex);
+			mQueues[queueIndex]->mJobs.push_back(std::move(aJob));
+		}
+		mQueuedJobsCount.fetch_add(1, std::memory_order_acq_rel);
+
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex); // do not let a worker miss the notification between its check and its sleep
+		}
+		mSleepCondition.notify_one();
+	}
+
+	bool ER_JobSystem::PopJob(int aQueueIndex, ER_Job& aOutJob)
+	{
+		WorkerQueue* queue = mQueues[aQueueIndex];
+		std::lock_guard<std::mutex> lock(queue->mMutex);
+		if (queue->mJobs.empty())
+			return false;
+
+		aOutJob = std::move(queue->mJobs.back());
+		queue->mJobs.pop_back();
+		mQueuedJobsCount.fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	}
+
+	bool ER_JobSystem::StealJob(int aQueueIndex, ER_Job& aOutJob)
+	{
+		const int queueCount = static_cast<int>(mQueues.size());
+		const int start = (aQueueIndex >= 0) ? aQueueIndex + 1 : static_cast<int>(mNextQueueIndex.load(std::memory_order_relaxed));
+		for (int i = 0; i < queueCount; i++)
+		{
+			const int victim = (start + i) % queueCount;
+			if (victim == aQueueIndex)
+				continue;
+
+			WorkerQueue* queue = mQueues[victim];
+			std::lock_guard<std::mutex> lock(queue->mMutex);
+			if (queue->mJobs.empty())
+				continue;
+
+			aOutJob = std::move(queue->mJobs.front());
+			queue->mJobs.pop_front();
+			mQueuedJobsCount.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+		return false;
+	}
+
+	bool ER_JobSystem::TryExecuteJob()
+	{
+		if (mQueuedJobsCount.load(std::memory_order_acquire) == 0)
+			return false;
+
+		const int ownQueueIndex = (sWorkerOwner == this) ? sWorkerIndex : -1;
+
+		ER_Job job;
+		if ((ownQueueIndex >= 0 && PopJob(ownQueueIndex, job)) || StealJob(ownQueueIndex, job))
+		{
+			job.mTask();
+			FinishJob(job);
+			return true;
+		}
+		return false;
+	}
+
+	void ER_JobSystem::FinishJob(ER_Job& aJob)
+	{
+		if (!aJob.mCounter)
+			return;
+
+		// the counter must not be used after it reaches zero: a thread waiting for it can return and destroy it right away
+		const ER_JobCounter* counter = aJob.mCounter;
+		if (counter->mValue.fetch_sub(1, std::memory_order_seq_cst) != 1)
+			return;
+
+		if (mPendingJobsCount.load(std::memory_order_seq_cst) > 0)
+			ReleasePendingJobs(counter);
+	}
+
+	void ER_JobSystem::ReleasePendingJobs(const ER_JobCounter* aDependency)
+	{
+		std::vector<ER_Job> readyJobs;
+		{
+			std::lock_guard<std::mutex> lock(mPendingJobsMutex);
+			for (auto it = mPendingJobs.begin(); it != mPendingJobs.end();)
+			{
+				// only the jobs that depend on aDependency are dereferenced (they keep it alive); the check handles a new counter at the same address
+				if (it->mDependency == aDependency && it->mDependency->IsDone())
+				{
+					readyJobs.push_back(std::move(*it));
+					it = mPendingJobs.erase(it);
+				}
+				else
+					++it;
+			}
+			mPendingJobsCount.fetch_sub(static_cast<int>(readyJobs.size()), std::memory_order_relaxed);
+		}
+
+		for (auto& job : readyJobs)
+		{
+			job.mDependency = nullptr;
+			PushJob(std::move(job));
+		}
+	}
+
+	static float BenchmarkWork(UINT aIterations)
+	{
+		float result = 0.0f;
+		for (UINT i = 0; i < aIterations; i++)
+			result += sqrtf(static_cast<float>(i) * 0.5f + result * 0.001f);
+		return result;
+	}
+
+	bool ER_JobSystem::RunTests()
+	{
+		ER_JobSystem jobSystem;
+		bool isPassed = true;
+
+		// counters
+		{
+			std::atomic<int> sum(0);
+			ER_JobCounter counter;
+			jobSystem.ParallelFor(10000, 7, [&sum](UINT i) { sum.fetch_add(static_cast<int>(i), std::memory_order_relaxed); }, &counter);
+			jobSystem.Wait(counter);
+			isPassed &= (sum.load() == 10000 * 9999 / 2);
+		}
+
+		// dependencies
+		{
+			std::vector<int> values(4096, 0);
+			std::atomic<bool> isDependencyRespected(true);
+			ER_JobCounter writeCounter;
+			ER_JobCounter readCounter;
+			jobSystem.ParallelFor(static_cast<UINT>(values.size()), 16, [&values](UINT i) { values[i] = static_cast<int>(i) + 1; }, &writeCounter);
+			jobSystem.Submit([&values, &isDependencyRespected]()
+			{
+				for (size_t i = 0; i < values.size(); i++)
+				{
+					if (values[i] != static_cast<int>(i) + 1)
+						isDependencyRespected = false;
+				}
+			}, &readCounter, &writeCounter);
+			jobSystem.Wait(readCounter);
+			isPassed &= isDependencyRespected.load();
+		}
+
+		// short-lived counters (destroyed right after their wait, so the next ones reuse their addresses) with dependent jobs
+		{
+			std::atomic<int> order(0);
+			std::atomic<bool> isOrderRespected(true);
+			for (int i = 0; i < 2000; i++)
+			{
+				ER_JobCounter firstCounter;
+				ER_JobCounter secondCounter;
+				jobSystem.Submit([&order]() { order.store(1, std::memory_order_relaxed); }, &firstCounter);
+				jobSystem.Submit([&order, &isOrderRespected]()
+				{
+					if (order.exchange(0, std::memory_order_relaxed) != 1)
+						isOrderRespected = false;
+				}, &secondCounter, &firstCounter);
+				jobSystem.Wait(secondCounter);
+			}
+			isPassed &= isOrderRespected.load();
+		}
+
+		// nested jobs with waits inside of jobs
+		{
+			std::atomic<int> leafCount(0);
+			ER_JobCounter counter;
+			jobSystem.ParallelFor(64, 1, [&jobSystem, &leafCount](UINT)
+			{
+				ER_JobCounter childCounter;
+				jobSystem.ParallelFor(64, 4, [&leafCount](UINT) { leafCount.fetch_add(1, std::memory_order_relaxed); }, &childCounter);
+				jobSystem.Wait(childCounter);
+			}, &counter);
+			jobSystem.Wait(counter);
+			isPassed &= (leafCount.load() == 64 * 64);
+		}
+
+		std::wstring msg = std::wstring(L"[ER Logger][ER_JobSystem] Self-check ") + (isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_JobSystem::Benchmark()
+	{
+		// scaling: uneven workload (every 64th job is much heavier, like one big model in a scene)
+		const UINT jobCount = 4096;
+		const UINT baseIterations = 20000;
+		const int maxWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1);
+
+		std::vector<int> workerCounts = { 0 };
+		for (int workers = 1; workers < maxWorkers; workers *= 2)
+			workerCounts.push_back(workers);
+		workerCounts.push_back(maxWorkers);
+
+		double singleThreadTime = 0.0;
+		for (int workers : workerCounts)
+		{
+			ER_JobSystem jobSystem(workers);
+			std::atomic<UINT> checksum(0);
+
+			auto startTime = std::chrono::high_resolution_clock::now();
+			ER_JobCounter counter;
+			jobSystem.ParallelFor(jobCount, 1, [&checksum, baseIterations](UINT i)
+			{
+				const UINT iterations = (i % 64 == 0) ? baseIterations * 32 : baseIterations;
+				checksum.fetch_add(static_cast<UINT>(BenchmarkWork(iterations)) & 1, std::memory_order_relaxed);
+			}, &counter);
+			jobSystem.Wait(counter);
+			std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTime;
+
+			if (workers == 0)
+				singleThreadTime = time.count();
+
+			std::wstring msg = L"[ER Logger][ER_JobSystem] Benchmark: " + std::to_wstring(workers) + L" workers + waiting thread: " +
+				std::to_wstring(time.count()) + L"s (speedup x" + std::to_wstring(singleThreadTime / time.count()) + L")\n";
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+	}
+}
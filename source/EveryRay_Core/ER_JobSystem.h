@@ -0,0 +1,86 @@
+#pragma once
+#include "Common.h"
+#include <deque>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace EveryRay_Core
+{
+	// Number of unfinished jobs that were submitted with this counter.
+	// Can be waited on (ER_JobSystem::Wait) or used as a dependency of other jobs. Must outlive all the jobs that reference it.
+	class ER_JobCounter
+	{
+	public:
+		ER_JobCounter() : mValue(0) {}
+
+		bool IsDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+		int GetValue() const { return mValue.load(std::memory_order_acquire); }
+	private:
+		friend class ER_JobSystem;
+		ER_JobCounter(const ER_JobCounter& rhs);
+		ER_JobCounter& operator=(const ER_JobCounter& rhs);
+
+		std::atomic<int> mValue;
+	};
+
+	struct ER_Job
+	{
+		std::function<void()> mTask;
+		ER_JobCounter* mCounter = nullptr;
+		const ER_JobCounter* mDependency = nullptr;
+	};
+
+	// Engine-wide job system: a fixed pool of worker threads with their own deques.
+	// Workers pop their own jobs in LIFO order and steal the oldest jobs from other workers when they run out of work.
+	// Threads that wait for a counter (including the main thread) execute jobs too, so waiting inside a job is allowed.
+	class ER_JobSystem
+	{
+	public:
+		ER_JobSystem(int aWorkerCount = -1 /* hardware threads - 1 */);
+		~ER_JobSystem();
+
+		// Job will not start before aDependency (if any) reaches zero.
+		void Submit(const std::function<void()>& aTask, ER_JobCounter* aCounter = nullptr, const ER_JobCounter* aDependency = nullptr);
+		// Splits [0, aCount) into jobs of aBatchSize elements.
+		void ParallelFor(UINT aCount, UINT aBatchSize, const std::function<void(UINT)>& aTask, ER_JobCounter* aCounter, const ER_JobCounter* aDependency = nullptr);
+		void Wait(const ER_JobCounter& aCounter);
+		// Same as Wait() for other conditions (i.e., a value that is being created by another thread, see ER_ConcurrentCache)
+		void WaitUntil(const std::function<bool()>& aIsDone);
+
+		int GetWorkerCount() const { return static_cast<int>(mWorkers.size()); }
+		static bool IsWorkerThread();
+
+		// Checks the results of the pool (counters, dependencies, nested waits), see ER_Tests
+		static bool RunTests();
+		// Logs the scaling of a synthetic workload across different worker counts
+		static void Benchmark();
+	private:
+		struct WorkerQueue
+		{
+			std::mutex mMutex;
+			std::deque<ER_Job> mJobs;
+		};
+
+		void WorkerLoop(int aWorkerIndex);
+		void PushJob(ER_Job&& aJob);
+		bool PopJob(int aQueueIndex, ER_Job& aOutJob);
+		bool StealJob(int aQueueIndex, ER_Job& aOutJob);
+		bool TryExecuteJob();
+		void FinishJob(ER_Job& aJob);
+		void ReleasePendingJobs(const ER_JobCounter* aDependency);
+
+		std::vector<std::thread> mWorkers;
+		std::vector<WorkerQueue*> mQueues; // one per worker (a single one if there are no workers)
+
+		std::mutex mPendingJobsMutex;
+		std::vector<ER_Job> mPendingJobs; // jobs with unfinished dependencies
+		std::atomic<int> mPendingJobsCount; // see Submit() and FinishJob()
+
+		std::mutex mSleepMutex;
+		std::condition_variable mSleepCondition;
+		std::atomic<int> mQueuedJobsCount;
+		std::atomic<UINT> mNextQueueIndex;
+		std::atomic<bool> mIsRunning;
+	};
+}
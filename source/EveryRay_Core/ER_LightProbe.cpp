@@ -3,6 +3,7 @@
 
 #include "ER_LightProbe.h"
 #include "ER_LightProbesManager.h"
+#include "ER_LightProbesVolumeFile.h"
 #include "ER_Skybox.h"
 #include "ER_Camera.h"
 #include "ER_Core.h"
@@ -173,7 +174,7 @@ namespace EveryRay_Core
 
 		{
 			std::wstring probeName = GetConstructedProbeName(levelPath, mProbeType == DIFFUSE_PROBE && mIndex != -1);
-			std::wstring msg = L"[ER Logger][ER_LightProbe] Finished computing and saving the probe: " + probeName + L'\n';
+			std::wstring msg = L"[ER Logger][ER_LightProbe] Finished computing the probe: " + probeName + L'\n';
 			ER_OUTPUT_LOG(msg.c_str());
 		}
 	}
@@ -233,7 +234,7 @@ namespace EveryRay_Core
 					const std::string terrainTagName = "EveryRay: Draw terrain to probe: " + fullMaterialName;
 					rhi->BeginEventTag(terrainTagName);
 					terrain->Draw(TerrainRenderPass::TERRAIN_LIGHTPROBE, { aTextureNonConvoluted }, aDepthBuffers[cubeMapFaceIndex],
-						game.GetLevel()->mShadowMapper, nullptr, -1, mCubemapCameras[cubeMapFaceIndex], true);
+						game.GetLevel()->mShadowMapper, nullptr, -1, mCubemapCameras[cubeMapFaceIndex]);
 					rhi->EndEventTag();
 				}
 			}
@@ -342,65 +343,16 @@ namespace EveryRay_Core
 		if (game.GetRHI()->GetAPI() != ER_GRAPHICS_API::DX11)
 			throw ER_CoreException("Saving light probes is only available on DX11 at the moment.");
 
-		bool saveAsSphericalHarmonics = mProbeType == DIFFUSE_PROBE && mIndex != -1;
-		std::wstring probeName = GetConstructedProbeName(levelPath, saveAsSphericalHarmonics);
-
-		if (saveAsSphericalHarmonics)
-		{
-			std::wofstream shFile(probeName.c_str());
-			if (shFile.is_open())
-			{
-				std::string tempString = "";
-				shFile << L"r ";
-				for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-				{
-					tempString = std::to_string(mSphericalHarmonicsRGB[i].x);
-					if (i == SPHERICAL_HARMONICS_COEF_COUNT - 1)
-						tempString += "\n";
-					else
-						tempString += " ";
-					shFile << ER_Utility::ToWideString(tempString);
-				}
-
-				shFile << L"g ";
-				for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-				{
-					tempString = std::to_string(mSphericalHarmonicsRGB[i].y);
-					if (i == SPHERICAL_HARMONICS_COEF_COUNT - 1)
-						tempString += "\n";
-					else
-						tempString += " ";
-					shFile << ER_Utility::ToWideString(tempString);
-				}
-
-				shFile << L"b ";
-				for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-				{
-					tempString = std::to_string(mSphericalHarmonicsRGB[i].z);
-					if (i == SPHERICAL_HARMONICS_COEF_COUNT - 1)
-						tempString += "\n";
-					else
-						tempString += " ";
-					shFile << ER_Utility::ToWideString(tempString);
-				}
-				shFile.close();
-			}
-			else
-			{
-				std::string str(probeName.begin(), probeName.end());
-				std::string msg = "Failed to create a probe SH file: " + str;
-				throw ER_CoreException(msg.c_str());
-			}
+		// SH of local diffuse probes are only kept in memory: ER_LightProbesManager packs them into the level's probes volume file
+		if (mProbeType == DIFFUSE_PROBE && mIndex != -1)
+			return;
 
-		}
-		else
-		{
-			game.GetRHI()->SaveGPUTextureToFile(aTextureConvoluted, probeName);
+		std::wstring probeName = GetConstructedProbeName(levelPath, false);
+		game.GetRHI()->SaveGPUTextureToFile(aTextureConvoluted, probeName);
 
-			//loading the same probe from disk, since aTextureConvoluted is a temp texture and otherwise we need a GPU resource copy to mCubemapTexture (better than this, but I am just too lazy...)
-			if (!LoadProbeFromDisk(game, levelPath))
-				throw ER_CoreException("Could not load probe that was already generated :(");
-		}
+		//loading the same probe from disk, since aTextureConvoluted is a temp texture and otherwise we need a GPU resource copy to mCubemapTexture (better than this, but I am just too lazy...)
+		if (!LoadProbeFromDisk(game, levelPath))
+			throw ER_CoreException("Could not load probe that was already generated :(");
 	}
 
 	// Method for loading probe from disk in 2 ways: spherical harmonics coefficients and light probe cubemap texture
@@ -413,55 +365,14 @@ namespace EveryRay_Core
 
 		if (loadAsSphericalHarmonics)
 		{
-			FILE* shFile = _wfopen(probeName.c_str(), L"r");
-			if (shFile)
+			if (ER_LightProbesVolumeFile::ReadLegacySphericalHarmonics(probeName, mSphericalHarmonicsRGB.data()))
 			{
-				float coefficients[3][SPHERICAL_HARMONICS_COEF_COUNT] =
-				{
-					{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-					{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-					{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }
-				};
-				int channel = 0;
-				char line[256];
-				char channelSymbol;
-				while (fgets(line, sizeof(line), shFile))
-				{
-					if (channel == 3)
-						break;
-
-					if (line[0] == 'r' || line[0] == 'g' || line[0] == 'b')
-					{
-						sscanf(line, "%c %f %f %f %f %f %f %f %f %f", &channelSymbol,
-							&coefficients[channel][0], &coefficients[channel][1], &coefficients[channel][2],
-							&coefficients[channel][3], &coefficients[channel][4], &coefficients[channel][5],
-							&coefficients[channel][6], &coefficients[channel][7], &coefficients[channel][8]
-						);
-					}
-					else
-					{
-						std::wstring message = L"[ER Logger][ER_LightProbe] Corrupt probe's spherical harmonics file: " + probeName + L". Loading empty coefficients... \n";
-						ER_OUTPUT_LOG(message.c_str());
-						for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-							mSphericalHarmonicsRGB[i] = XMFLOAT3(0, 0, 0);
-
-						break;
-					}
-					channel++;
-				}
-
-				for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-					mSphericalHarmonicsRGB[i] = XMFLOAT3(coefficients[0][i], coefficients[1][i], coefficients[2][i]);
-
 				std::wstring message = L"[ER Logger][ER_LightProbe] Successfully loaded probe's spherical harmonics file: " + probeName + L"\n";
 				ER_OUTPUT_LOG(message.c_str());
-
 				mIsProbeLoadedFromDisk = true;
-				fclose(shFile);
 			}
 			else
 			{
-				DWORD error = GetLastError();
 				std::wstring message = L"[ER Logger][ER_LightProbe] Could not load probe's spherical harmonics file: " + probeName + L". This probe will be recomputed and saved to disk. \n";
 				ER_OUTPUT_LOG(message.c_str());
 				mIsProbeLoadedFromDisk = false;
@@ -485,6 +396,21 @@ namespace EveryRay_Core
 		return mIsProbeLoadedFromDisk;
 	}
 
+	void ER_LightProbe::LoadSphericalHarmonics(const XMFLOAT3* aCoefficients)
+	{
+		assert(mProbeType == DIFFUSE_PROBE);
+		for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+			mSphericalHarmonicsRGB[i] = aCoefficients[i];
+		mIsProbeLoadedFromDisk = true;
+	}
+
+	bool ER_LightProbe::LoadCubemapFromMemory(ER_Core& game, const void* aDDSData, UINT64 aDDSDataSize)
+	{
+		assert(mCubemapTexture);
+		mCubemapTexture->CreateGPUTextureResourceFromDDSMemory(game.GetRHI(), aDDSData, aDDSDataSize, &mIsProbeLoadedFromDisk, true);
+		return mIsProbeLoadedFromDisk;
+	}
+
 	std::wstring ER_LightProbe::GetConstructedProbeName(const std::wstring& levelPath, bool inSphericalHarmonics)
 	{
 		std::wstring fileName = levelPath;
@@ -34,6 +34,9 @@ namespace EveryRay_Core
 
 		bool LoadProbeFromDisk(ER_Core& game, const std::wstring& levelPath);
 		bool IsLoadedFromDisk() { return mIsProbeLoadedFromDisk; }
+		// Data from the level's probes volume file (see ER_LightProbesVolumeFile)
+		void LoadSphericalHarmonics(const XMFLOAT3* aCoefficients);
+		bool LoadCubemapFromMemory(ER_Core& game, const void* aDDSData, UINT64 aDDSDataSize);
 		
 		ER_RHI_GPUTexture* GetCubemapTexture() const { return mCubemapTexture; }
 
@@ -43,10 +46,13 @@ namespace EveryRay_Core
 		const std::vector<XMFLOAT3>& GetSphericalHarmonics() { return mSphericalHarmonicsRGB; }
 
 		void SetPosition(const XMFLOAT3& pos);
-		const XMFLOAT3& GetPosition() { return mPosition; }
+		const XMFLOAT3& GetPosition() const { return mPosition; }
 		void SetIndex(int index) { mIndex = index; }
 		int GetIndex() { return mIndex; }
 
+		// Legacy one-file-per-probe layout: "*_sh.txt" for SH of diffuse probes, "*.dds" for cubemaps (still used for global probes and as the intermediate of computed specular probes)
+		std::wstring GetConstructedProbeName(const std::wstring& levelPath, bool inSphericalHarmonics = false);
+
 		void CPUCullAgainstProbeBoundingVolume(const XMFLOAT3& aMin, const XMFLOAT3& aMax);
 		bool IsCulled() { return mIsCulled; }
 	private:
@@ -54,7 +60,6 @@ namespace EveryRay_Core
 		void SaveProbeOnDisk(ER_Core& game, const std::wstring& levelPath, ER_RHI_GPUTexture* aTextureConvoluted);
 		void DrawGeometryToProbe(ER_Core& game, ER_RHI_GPUTexture* aTextureNonConvoluted, ER_RHI_GPUTexture** aDepthBuffers, const LightProbeRenderingObjectsInfo& objectsToRender);
 		void ConvoluteProbe(ER_Core& game, ER_QuadRenderer* quadRenderer, ER_RHI_GPUTexture* aTextureNonConvoluted, ER_RHI_GPUTexture* aTextureConvoluted);
-		std::wstring GetConstructedProbeName(const std::wstring& levelPath, bool inSphericalHarmonics = false);
 
 		int mProbeType;
 
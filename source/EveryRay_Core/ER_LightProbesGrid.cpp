@@ -0,0 +1,288 @@
+#include "ER_LightProbesGrid.h"
+#include "ER_JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+
+#define LIGHT_PROBES_GRID_BATCH_SIZE 1024
+
+namespace EveryRay_Core
+{
+	void ER_LightProbesGrid::Initialize(const XMFLOAT3& aMinBounds, float aDistanceBetweenProbes, int aCellsCountX, int aCellsCountY, int aCellsCountZ, bool aIs2D, int aProbesPerCell)
+	{
+		assert(aDistanceBetweenProbes > 0.0f);
+		assert(aProbesPerCell > 0);
+
+		mMinBounds = aMinBounds;
+		mDistanceBetweenProbes = aDistanceBetweenProbes;
+		mCellsCountX = std::max(aCellsCountX, 0);
+		mCellsCountY = aIs2D ? 1 : std::max(aCellsCountY, 0);
+		mCellsCountZ = std::max(aCellsCountZ, 0);
+		mIs2D = aIs2D;
+		mProbesPerCell = aProbesPerCell;
+
+		mCellsProbesIndices.assign(static_cast<size_t>(GetCellsCount()) * mProbesPerCell, -1);
+	}
+
+	// Cells [aOutFirst, aOutLast] of one axis that contain the value (within the border epsilon)
+	bool ER_LightProbesGrid::GetCellsRange(float aValue, float aMin, int aCellsCount, int& aOutFirst, int& aOutLast) const
+	{
+		const float cell = (aValue - aMin) / mDistanceBetweenProbes;
+		aOutFirst = std::max(static_cast<int>(ceil(cell - LIGHT_PROBES_GRID_BORDER_EPSILON)) - 1, 0);
+		aOutLast = std::min(static_cast<int>(floor(cell + LIGHT_PROBES_GRID_BORDER_EPSILON)), aCellsCount - 1);
+		return aOutFirst <= aOutLast;
+	}
+
+	int ER_LightProbesGrid::GetCellIndices(const XMFLOAT3& aPos, int aOutIndices[LIGHT_PROBES_GRID_MAX_CELLS_PER_POSITION]) const
+	{
+		int firstX, lastX, firstY = 0, lastY = 0, firstZ, lastZ;
+		if (!GetCellsRange(aPos.x, mMinBounds.x, mCellsCountX, firstX, lastX) ||
+			!GetCellsRange(aPos.z, mMinBounds.z, mCellsCountZ, firstZ, lastZ) ||
+			(!mIs2D && !GetCellsRange(aPos.y, mMinBounds.y, mCellsCountY, firstY, lastY)))
+			return 0;
+
+		int count = 0;
+		for (int y = firstY; y <= lastY; y++)
+			for (int x = firstX; x <= lastX; x++)
+				for (int z = firstZ; z <= lastZ; z++)
+					aOutIndices[count++] = y * (mCellsCountX * mCellsCountZ) + x * mCellsCountZ + z;
+
+		assert(count <= LIGHT_PROBES_GRID_MAX_CELLS_PER_POSITION);
+		return count;
+	}
+
+	int ER_LightProbesGrid::GetCellIndex(const XMFLOAT3& aPos) const
+	{
+		const float x = (aPos.x - mMinBounds.x) / mDistanceBetweenProbes;
+		const float y = mIs2D ? 0.0f : (aPos.y - mMinBounds.y) / mDistanceBetweenProbes;
+		const float z = (aPos.z - mMinBounds.z) / mDistanceBetweenProbes;
+		if (x < 0.0f || x > mCellsCountX || y < 0.0f || y > mCellsCountY || z < 0.0f || z > mCellsCountZ)
+			return -1;
+
+		const int xIndex = std::min(static_cast<int>(x), mCellsCountX - 1);
+		const int yIndex = std::min(static_cast<int>(y), mCellsCountY - 1);
+		const int zIndex = std::min(static_cast<int>(z), mCellsCountZ - 1);
+		if (xIndex < 0 || yIndex < 0 || zIndex < 0)
+			return -1;
+
+		return yIndex * (mCellsCountX * mCellsCountZ) + xIndex * mCellsCountZ + zIndex;
+	}
+
+	bool ER_LightProbesGrid::AddProbes(const XMFLOAT4* aPositions, int aProbesCount, ER_JobSystem* aJobSystem)
+	{
+		const int cellsCount = GetCellsCount();
+		if (cellsCount <= 0 || aProbesCount <= 0)
+			return true;
+
+		// 1) scatter: every probe claims a slot in each of its cells
+		std::unique_ptr<std::atomic<int>[]> cellsProbesCounts(new std::atomic<int>[cellsCount]);
+		for (int i = 0; i < cellsCount; i++)
+			cellsProbesCounts[i].store(0, std::memory_order_relaxed);
+		std::atomic<bool> isOverflown(false);
+
+		auto addProbe = [&](UINT aProbeIndex)
+		{
+			int cells[LIGHT_PROBES_GRID_MAX_CELLS_PER_POSITION];
+			const int count = GetCellIndices(XMFLOAT3(aPositions[aProbeIndex].x, aPositions[aProbeIndex].y, aPositions[aProbeIndex].z), cells);
+			for (int i = 0; i < count; i++)
+			{
+				const int slot = cellsProbesCounts[cells[i]].fetch_add(1, std::memory_order_relaxed);
+				if (slot < mProbesPerCell)
+					mCellsProbesIndices[cells[i] * mProbesPerCell + slot] = static_cast<int>(aProbeIndex);
+				else
+					isOverflown.store(true, std::memory_order_relaxed);
+			}
+		};
+
+		// 2) sort: slots were claimed in any order, cells list their probes by index
+		auto sortCell = [&](UINT aCellIndex)
+		{
+			const int count = std::min(cellsProbesCounts[aCellIndex].load(std::memory_order_relaxed), mProbesPerCell);
+			int* first = mCellsProbesIndices.data() + aCellIndex * mProbesPerCell;
+			std::sort(first, first + count);
+		};
+
+		if (aJobSystem && aProbesCount > LIGHT_PROBES_GRID_BATCH_SIZE)
+		{
+			ER_JobCounter addCounter;
+			aJobSystem->ParallelFor(static_cast<UINT>(aProbesCount), LIGHT_PROBES_GRID_BATCH_SIZE, addProbe, &addCounter);
+			aJobSystem->Wait(addCounter);
+
+			ER_JobCounter sortCounter;
+			aJobSystem->ParallelFor(static_cast<UINT>(cellsCount), LIGHT_PROBES_GRID_BATCH_SIZE, sortCell, &sortCounter);
+			aJobSystem->Wait(sortCounter);
+		}
+		else
+		{
+			for (int i = 0; i < aProbesCount; i++)
+				addProbe(static_cast<UINT>(i));
+			for (int i = 0; i < cellsCount; i++)
+				sortCell(static_cast<UINT>(i));
+		}
+
+		return !isOverflown.load();
+	}
+
+	void ER_LightProbesGrid::GenerateProbes(int aCountX, int aCountY, int aCountZ, float aDistance, const XMFLOAT3& aMin, std::vector<XMFLOAT4>& aOutPositions)
+	{
+		aOutPositions.resize(static_cast<size_t>(aCountX) * aCountY * aCountZ);
+		for (int y = 0; y < aCountY; y++)
+			for (int x = 0; x < aCountX; x++)
+				for (int z = 0; z < aCountZ; z++)
+					aOutPositions[y * (aCountX * aCountZ) + x * aCountZ + z] = XMFLOAT4(aMin.x + x * aDistance, aMin.y + y * aDistance, aMin.z + z * aDistance, 1.0f);
+	}
+
+	void ER_LightProbesGrid::AddProbesBruteForce(const ER_LightProbesGrid& aGrid, const std::vector<XMFLOAT4>& aPositions, std::vector<int>& aOutIndices)
+	{
+		const float epsilon = LIGHT_PROBES_GRID_BORDER_EPSILON * aGrid.mDistanceBetweenProbes;
+		const int cellsCount = aGrid.GetCellsCount();
+		aOutIndices.assign(static_cast<size_t>(cellsCount) * aGrid.mProbesPerCell, -1);
+		for (int cell = 0; cell < cellsCount; cell++)
+		{
+			const int y = cell / (aGrid.mCellsCountX * aGrid.mCellsCountZ);
+			const int x = (cell / aGrid.mCellsCountZ) % aGrid.mCellsCountX;
+			const int z = cell % aGrid.mCellsCountZ;
+			const XMFLOAT3 cellMin(aGrid.mMinBounds.x + x * aGrid.mDistanceBetweenProbes, aGrid.mMinBounds.y + y * aGrid.mDistanceBetweenProbes, aGrid.mMinBounds.z + z * aGrid.mDistanceBetweenProbes);
+
+			int count = 0;
+			for (size_t i = 0; i < aPositions.size() && count < aGrid.mProbesPerCell; i++)
+			{
+				const XMFLOAT4& pos = aPositions[i];
+				if (pos.x >= cellMin.x - epsilon && pos.x <= cellMin.x + aGrid.mDistanceBetweenProbes + epsilon &&
+					pos.z >= cellMin.z - epsilon && pos.z <= cellMin.z + aGrid.mDistanceBetweenProbes + epsilon &&
+					(aGrid.mIs2D || (pos.y >= cellMin.y - epsilon && pos.y <= cellMin.y + aGrid.mDistanceBetweenProbes + epsilon)))
+					aOutIndices[cell * aGrid.mProbesPerCell + count++] = static_cast<int>(i);
+			}
+		}
+	}
+
+	bool ER_LightProbesGrid::RunTests(ER_JobSystem* aJobSystem)
+	{
+		bool isPassed = true;
+
+		// 3D grid: every cell has its 8 corner probes, same result as brute force, with and without the job system
+		{
+			const XMFLOAT3 minBounds(-35.0f, 2.0f, 10.0f);
+			const float distance = 7.5f;
+			std::vector<XMFLOAT4> positions;
+			GenerateProbes(9, 4, 6, distance, minBounds, positions);
+
+			ER_LightProbesGrid serialGrid, parallelGrid, referenceGrid;
+			serialGrid.Initialize(minBounds, distance, 8, 3, 5, false, 8);
+			parallelGrid.Initialize(minBounds, distance, 8, 3, 5, false, 8);
+			referenceGrid.Initialize(minBounds, distance, 8, 3, 5, false, 8);
+
+			isPassed &= serialGrid.AddProbes(positions.data(), static_cast<int>(positions.size()), nullptr);
+			isPassed &= parallelGrid.AddProbes(positions.data(), static_cast<int>(positions.size()), aJobSystem);
+			std::vector<int> bruteForceIndices;
+			AddProbesBruteForce(referenceGrid, positions, bruteForceIndices);
+
+			isPassed &= serialGrid.GetCellsProbesIndices() == bruteForceIndices;
+			isPassed &= parallelGrid.GetCellsProbesIndices() == bruteForceIndices;
+			for (int index : serialGrid.GetCellsProbesIndices())
+				isPassed &= index != -1;
+
+			// borders: a grid corner is in 8 cells, a face in 2, a cell center in 1 (the one the shaders pick), outside in none
+			int cells[LIGHT_PROBES_GRID_MAX_CELLS_PER_POSITION];
+			const XMFLOAT3 corner(minBounds.x + 3 * distance, minBounds.y + 1 * distance, minBounds.z + 2 * distance);
+			isPassed &= serialGrid.GetCellIndices(corner, cells) == 8;
+			isPassed &= serialGrid.GetCellIndices(XMFLOAT3(corner.x + 0.5f * distance, corner.y + 0.5f * distance, corner.z), cells) == 2;
+			const XMFLOAT3 center(corner.x + 0.5f * distance, corner.y + 0.5f * distance, corner.z + 0.5f * distance);
+			isPassed &= serialGrid.GetCellIndices(center, cells) == 1 && cells[0] == serialGrid.GetCellIndex(center);
+			isPassed &= serialGrid.GetCellIndices(XMFLOAT3(minBounds.x - distance, minBounds.y, minBounds.z), cells) == 0 && serialGrid.GetCellIndex(XMFLOAT3(minBounds.x - distance, minBounds.y, minBounds.z)) == -1;
+			isPassed &= serialGrid.GetCellIndices(minBounds, cells) == 1 && cells[0] == 0 && serialGrid.GetCellIndex(minBounds) == 0;
+			const XMFLOAT3 maxCorner(minBounds.x + 8 * distance, minBounds.y + 3 * distance, minBounds.z + 5 * distance);
+			isPassed &= serialGrid.GetCellIndices(maxCorner, cells) == 1 && cells[0] == serialGrid.GetCellsCount() - 1 && serialGrid.GetCellIndex(maxCorner) == serialGrid.GetCellsCount() - 1;
+
+			// too many probes for a cell
+			positions.push_back(XMFLOAT4(center.x, center.y, center.z, 1.0f));
+			ER_LightProbesGrid overflownGrid;
+			overflownGrid.Initialize(minBounds, distance, 8, 3, 5, false, 8);
+			isPassed &= !overflownGrid.AddProbes(positions.data(), static_cast<int>(positions.size()), aJobSystem);
+		}
+
+		// 2D grid (probes on terrain): y is ignored, 4 probes per cell
+		{
+			const XMFLOAT3 minBounds(0.0f, 0.0f, 0.0f);
+			std::vector<XMFLOAT4> positions;
+			GenerateProbes(5, 1, 7, 4.0f, minBounds, positions);
+			for (size_t i = 0; i < positions.size(); i++)
+				positions[i].y = static_cast<float>(i % 13) * 3.0f; // as if placed on terrain
+
+			ER_LightProbesGrid grid, referenceGrid;
+			grid.Initialize(minBounds, 4.0f, 4, 1, 6, true, 4);
+			referenceGrid.Initialize(minBounds, 4.0f, 4, 1, 6, true, 4);
+			isPassed &= grid.AddProbes(positions.data(), static_cast<int>(positions.size()), aJobSystem);
+			std::vector<int> bruteForceIndices;
+			AddProbesBruteForce(referenceGrid, positions, bruteForceIndices);
+			isPassed &= grid.GetCellsProbesIndices() == bruteForceIndices;
+			isPassed &= grid.GetCellIndex(XMFLOAT3(6.0f, 100.0f, 10.0f)) == 1 * 6 + 2;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_LightProbesGrid] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_LightProbesGrid::Benchmark(ER_JobSystem* aJobSystem)
+	{
+		double bruteForceTime = 0.0, serialTime = 0.0, parallelTime = 0.0, largeSerialTime = 0.0, largeParallelTime = 0.0;
+		int smallProbesCount = 0, largeProbesCount = 0;
+		bool isMatching = true;
+		{
+			const XMFLOAT3 minBounds(-500.0f, 0.0f, -500.0f);
+			std::vector<XMFLOAT4> positions;
+			std::vector<int> bruteForceIndices;
+
+			// small volume (brute force is quadratic)
+			GenerateProbes(20, 20, 20, 5.0f, minBounds, positions);
+			smallProbesCount = static_cast<int>(positions.size());
+			ER_LightProbesGrid grid;
+			grid.Initialize(minBounds, 5.0f, 19, 19, 19, false, 8);
+
+			auto startTimer = std::chrono::high_resolution_clock::now();
+			AddProbesBruteForce(grid, positions, bruteForceIndices);
+			std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTimer;
+			bruteForceTime = time.count();
+
+			startTimer = std::chrono::high_resolution_clock::now();
+			isMatching &= grid.AddProbes(positions.data(), smallProbesCount, nullptr);
+			time = std::chrono::high_resolution_clock::now() - startTimer;
+			serialTime = time.count();
+			isMatching &= grid.GetCellsProbesIndices() == bruteForceIndices;
+
+			grid.Initialize(minBounds, 5.0f, 19, 19, 19, false, 8);
+			startTimer = std::chrono::high_resolution_clock::now();
+			isMatching &= grid.AddProbes(positions.data(), smallProbesCount, aJobSystem);
+			time = std::chrono::high_resolution_clock::now() - startTimer;
+			parallelTime = time.count();
+			isMatching &= grid.GetCellsProbesIndices() == bruteForceIndices;
+
+			// large volume: 1M probes
+			GenerateProbes(100, 100, 100, 5.0f, minBounds, positions);
+			largeProbesCount = static_cast<int>(positions.size());
+			ER_LightProbesGrid serialGrid, parallelGrid;
+			serialGrid.Initialize(minBounds, 5.0f, 99, 99, 99, false, 8);
+			parallelGrid.Initialize(minBounds, 5.0f, 99, 99, 99, false, 8);
+
+			startTimer = std::chrono::high_resolution_clock::now();
+			isMatching &= serialGrid.AddProbes(positions.data(), largeProbesCount, nullptr);
+			time = std::chrono::high_resolution_clock::now() - startTimer;
+			largeSerialTime = time.count();
+
+			startTimer = std::chrono::high_resolution_clock::now();
+			isMatching &= parallelGrid.AddProbes(positions.data(), largeProbesCount, aJobSystem);
+			time = std::chrono::high_resolution_clock::now() - startTimer;
+			largeParallelTime = time.count();
+			isMatching &= serialGrid.GetCellsProbesIndices() == parallelGrid.GetCellsProbesIndices();
+		}
+
+		std::wstring msg = L"[ER Logger][ER_LightProbesGrid] Benchmark" + std::wstring(isMatching ? L"" : L" (MISMATCH!)") + L": " + std::to_wstring(smallProbesCount) +
+			L" probes: brute force " + std::to_wstring(bruteForceTime * 1000.0) + L"ms, grid " + std::to_wstring(serialTime * 1000.0) + L"ms (1 thread), " +
+			std::to_wstring(parallelTime * 1000.0) + L"ms (job system). " + std::to_wstring(largeProbesCount) + L" probes: grid " + std::to_wstring(largeSerialTime * 1000.0) +
+			L"ms (1 thread), " + std::to_wstring(largeParallelTime * 1000.0) + L"ms (job system)\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isMatching);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Common.h"
+
+#define LIGHT_PROBES_GRID_BORDER_EPSILON 0.001f // in cells: probes closer than that to a cell border belong to the cells on both sides
+#define LIGHT_PROBES_GRID_MAX_CELLS_PER_POSITION 8 // corner of 8 cells (3D), 4 in 2D grids
+
+namespace EveryRay_Core
+{
+	class ER_JobSystem;
+
+	// Uniform grid of light probe cells, shared by diffuse and specular probes.
+	// Cell (x, y, z) covers [min + i * distance, min + (i + 1) * distance] on each axis (y is ignored in 2D grids).
+	// Cell indices are laid out as in GetLightProbesCellIndex() of Lighting.hlsli: y * (countX * countZ) + x * countZ + z.
+	class ER_LightProbesGrid
+	{
+	public:
+		void Initialize(const XMFLOAT3& aMinBounds, float aDistanceBetweenProbes, int aCellsCountX, int aCellsCountY, int aCellsCountZ, bool aIs2D, int aProbesPerCell);
+
+		// Assigns every probe to all cells that contain it, so probes on cell borders go to all neighbouring cells (i.e., a probe on a grid corner goes to 8 cells).
+		// Probes of a cell are sorted by index, so the result does not depend on the job system. Fails if a cell gets more than aProbesPerCell probes.
+		bool AddProbes(const XMFLOAT4* aPositions, int aProbesCount, ER_JobSystem* aJobSystem = nullptr);
+
+		// Same lookup as the shaders do: one cell (the upper one on borders, clamped on the max side of the grid), -1 outside of the grid
+		int GetCellIndex(const XMFLOAT3& aPos) const;
+		// All cells that contain the position; returns their count
+		int GetCellIndices(const XMFLOAT3& aPos, int aOutIndices[LIGHT_PROBES_GRID_MAX_CELLS_PER_POSITION]) const;
+
+		// aProbesPerCell probe indices per cell (-1 - empty slot), ready for the GPU
+		const std::vector<int>& GetCellsProbesIndices() const { return mCellsProbesIndices; }
+		int GetCellsCount() const { return mCellsCountX * mCellsCountY * mCellsCountZ; }
+		int GetProbesPerCell() const { return mProbesPerCell; }
+
+		// Borders, determinism and 2D grids against the brute force setup (see ER_Tests)
+		static bool RunTests(ER_JobSystem* aJobSystem);
+		// Setup of the cells: brute force vs. grid (1 thread and job system), up to 1M probes
+		static void Benchmark(ER_JobSystem* aJobSystem);
+	private:
+		bool GetCellsRange(float aValue, float aMin, int aCellsCount, int& aOutFirst, int& aOutLast) const;
+
+		// probes on a regular grid, same order and placement as ER_LightProbesManager does
+		static void GenerateProbes(int aCountX, int aCountY, int aCountZ, float aDistance, const XMFLOAT3& aMin, std::vector<XMFLOAT4>& aOutPositions);
+		// reference: tests every probe against every cell (the old setup)
+		static void AddProbesBruteForce(const ER_LightProbesGrid& aGrid, const std::vector<XMFLOAT4>& aPositions, std::vector<int>& aOutIndices);
+
+		XMFLOAT3 mMinBounds = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		float mDistanceBetweenProbes = 1.0f;
+		int mCellsCountX = 0;
+		int mCellsCountY = 0;
+		int mCellsCountZ = 0;
+		int mProbesPerCell = 0;
+		bool mIs2D = false;
+
+		std::vector<int> mCellsProbesIndices;
+	};
+}
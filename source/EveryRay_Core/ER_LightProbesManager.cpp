@@ -15,6 +15,7 @@
 #include "ER_DebugLightProbeMaterial.h"
 #include "ER_MaterialsCallbacks.h"
 #include "ER_Terrain.h"
+#include "ER_LightProbesVolumeFile.h"
 
 namespace EveryRay_Core
 {
@@ -189,33 +190,8 @@ namespace EveryRay_Core
 			mDiffuseProbesCellsCountY = 1;
 			mDiffuseProbesCellsCountTotal = mDiffuseProbesCellsCountX * mDiffuseProbesCellsCountZ;
 		}
-		mDiffuseProbesCells.resize(mDiffuseProbesCellsCountTotal, {});
-
 		assert(mDiffuseProbesCellsCountTotal);
-
-		float probeCellPositionOffset = static_cast<float>(mDistanceBetweenDiffuseProbes) / 2.0f;
-		mDiffuseProbesCellBounds = {
-			XMFLOAT3(-probeCellPositionOffset, mIs2DCellsGrid ? 0.0f : -probeCellPositionOffset, -probeCellPositionOffset),
-			XMFLOAT3(probeCellPositionOffset, mIs2DCellsGrid ? 0.0f : probeCellPositionOffset, probeCellPositionOffset) };
-		{
-			for (int cellsY = 0; cellsY < mDiffuseProbesCellsCountY; cellsY++)
-			{
-				for (int cellsX = 0; cellsX < mDiffuseProbesCellsCountX; cellsX++)
-				{
-					for (int cellsZ = 0; cellsZ < mDiffuseProbesCellsCountZ; cellsZ++)
-					{
-						XMFLOAT3 pos = XMFLOAT3(
-							minBounds.x + probeCellPositionOffset + cellsX * mDistanceBetweenDiffuseProbes,
-							minBounds.y + mIs2DCellsGrid ? 0.0f : probeCellPositionOffset + cellsY * mDistanceBetweenDiffuseProbes,
-							minBounds.z + probeCellPositionOffset + cellsZ * mDistanceBetweenDiffuseProbes);
-
-						int index = cellsY * (mDiffuseProbesCellsCountX * mDiffuseProbesCellsCountZ) + cellsX * mDiffuseProbesCellsCountZ + cellsZ;
-						mDiffuseProbesCells[index].index = index;
-						mDiffuseProbesCells[index].position = pos;
-					}
-				}
-			}
-		}
+		mDiffuseProbesGrid.Initialize(minBounds, mDistanceBetweenDiffuseProbes, mDiffuseProbesCellsCountX, mDiffuseProbesCellsCountY, mDiffuseProbesCellsCountZ, mIs2DCellsGrid, mCurrentProbeCountPerCell);
 
 		// simple 3D grid distribution of probes or 2D grid (i.e. when placeable on terrain)
 		for (int i = 0; i < mDiffuseProbesCountTotal; i++)
@@ -234,7 +210,6 @@ namespace EveryRay_Core
 					int index = probesY * (mDiffuseProbesCountX * mDiffuseProbesCountZ) + probesX * mDiffuseProbesCountZ + probesZ;
 					mDiffuseProbes[index].SetPosition(pos);
 					mDiffuseProbes[index].SetShaderInfoForConvolution(mConvolutionPS);
-					AddProbeToCells(mDiffuseProbes[index], DIFFUSE_PROBE, minBounds, maxBounds);
 				}
 			}
 		}
@@ -247,6 +222,9 @@ namespace EveryRay_Core
 			for (int probeIndex = 0; probeIndex < mDiffuseProbesCountTotal; probeIndex++)
 				mDiffuseProbesPositionsTempCPUBuffer[probeIndex] = XMFLOAT4(mDiffuseProbes[probeIndex].GetPosition().x, mDiffuseProbes[probeIndex].GetPosition().y, mDiffuseProbes[probeIndex].GetPosition().z, 1.0);
 
+			if (!mDiffuseProbesGrid.AddProbes(mDiffuseProbesPositionsTempCPUBuffer, mDiffuseProbesCountTotal, core.GetJobSystem()))
+				throw ER_CoreException("Too many diffuse probes per cell!");
+
 			mDiffuseProbesPositionsGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: diffuse probes positions buffer");
 			mDiffuseProbesPositionsGPUBuffer->CreateGPUBufferResource(rhi, mDiffuseProbesPositionsTempCPUBuffer, mDiffuseProbesCountTotal, sizeof(XMFLOAT4), mIsPlacedOnTerrain, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
 
@@ -262,21 +240,9 @@ namespace EveryRay_Core
 			}
 		}
 
-		// probe cell's indices GPU buffer, tex. array indices GPU/CPU buffers
-		int* diffuseProbeCellsIndicesCPUBuffer = new int[mDiffuseProbesCellsCountTotal * mCurrentProbeCountPerCell];
-		for (int probeIndex = 0; probeIndex < mDiffuseProbesCellsCountTotal; probeIndex++)
-		{
-			for (int indices = 0; indices < mCurrentProbeCountPerCell; indices++)
-			{
-				if (indices >= mDiffuseProbesCells[probeIndex].lightProbeIndices.size())
-					diffuseProbeCellsIndicesCPUBuffer[probeIndex * mCurrentProbeCountPerCell + indices] = -1;
-				else
-					diffuseProbeCellsIndicesCPUBuffer[probeIndex * mCurrentProbeCountPerCell + indices] = mDiffuseProbesCells[probeIndex].lightProbeIndices[indices];
-			}
-		}
+		// probe cell's indices GPU buffer
 		mDiffuseProbesCellsIndicesGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: diffuse probes cells indices buffer");
-		mDiffuseProbesCellsIndicesGPUBuffer->CreateGPUBufferResource(rhi, diffuseProbeCellsIndicesCPUBuffer, mDiffuseProbesCellsCountTotal * mCurrentProbeCountPerCell, sizeof(int), false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
-		DeleteObjects(diffuseProbeCellsIndicesCPUBuffer);
+		mDiffuseProbesCellsIndicesGPUBuffer->CreateGPUBufferResource(rhi, const_cast<int*>(mDiffuseProbesGrid.GetCellsProbesIndices().data()), mDiffuseProbesCellsCountTotal * mCurrentProbeCountPerCell, sizeof(int), false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
 		
 		std::string name = "Debug diffuse lightprobes ";
 		scene->objects.emplace_back(name, new ER_RenderingObject(name, scene->objects.size(), core, camera,
@@ -337,31 +303,8 @@ namespace EveryRay_Core
 			mSpecularProbesCellsCountY = 1;
 			mSpecularProbesCellsCountTotal = mSpecularProbesCellsCountX * mSpecularProbesCellsCountZ;
 		}
-		mSpecularProbesCells.resize(mSpecularProbesCellsCountTotal, {});
 		assert(mSpecularProbesCellsCountTotal);
-
-		float probeCellPositionOffset = static_cast<float>(mDistanceBetweenSpecularProbes) / 2.0f;
-		mSpecularProbesCellBounds = {
-			XMFLOAT3(-probeCellPositionOffset, mIs2DCellsGrid ? 0.0f : -probeCellPositionOffset, -probeCellPositionOffset),
-			XMFLOAT3(probeCellPositionOffset, mIs2DCellsGrid ? 0.0f : probeCellPositionOffset, probeCellPositionOffset) };
-		
-		for (int cellsY = 0; cellsY < mSpecularProbesCellsCountY; cellsY++)
-		{
-			for (int cellsX = 0; cellsX < mSpecularProbesCellsCountX; cellsX++)
-			{
-				for (int cellsZ = 0; cellsZ < mSpecularProbesCellsCountZ; cellsZ++)
-				{
-					XMFLOAT3 pos = XMFLOAT3(
-						minBounds.x + probeCellPositionOffset + cellsX * mDistanceBetweenSpecularProbes,
-						minBounds.y + mIs2DCellsGrid ? 0.0f : probeCellPositionOffset + cellsY * mDistanceBetweenSpecularProbes,
-						minBounds.z + probeCellPositionOffset + cellsZ * mDistanceBetweenSpecularProbes);
-
-					int index = cellsY * (mSpecularProbesCellsCountX * mSpecularProbesCellsCountZ) + cellsX * mSpecularProbesCellsCountZ + cellsZ;
-					mSpecularProbesCells[index].index = index;
-					mSpecularProbesCells[index].position = pos;
-				}
-			}
-		}
+		mSpecularProbesGrid.Initialize(minBounds, mDistanceBetweenSpecularProbes, mSpecularProbesCellsCountX, mSpecularProbesCellsCountY, mSpecularProbesCellsCountZ, mIs2DCellsGrid, mCurrentProbeCountPerCell);
 
 		// simple 3D grid distribution of probes or 2D grid (i.e. when placeable on terrain)
 		for (size_t i = 0; i < mSpecularProbesCountTotal; i++)
@@ -381,7 +324,6 @@ namespace EveryRay_Core
 					//mSpecularProbes[index]->SetIndex(index);
 					mSpecularProbes[index].SetPosition(pos);
 					mSpecularProbes[index].SetShaderInfoForConvolution(mConvolutionPS);
-					AddProbeToCells(mSpecularProbes[index], SPECULAR_PROBE, minBounds, maxBounds);
 				}
 			}
 		}
@@ -393,6 +335,10 @@ namespace EveryRay_Core
 		
 			for (int probeIndex = 0; probeIndex < mSpecularProbesCountTotal; probeIndex++)
 				mSpecularProbesPositionsTempCPUBuffer[probeIndex] = XMFLOAT4(mSpecularProbes[probeIndex].GetPosition().x,mSpecularProbes[probeIndex].GetPosition().y,mSpecularProbes[probeIndex].GetPosition().z, 1.0);
+
+			if (!mSpecularProbesGrid.AddProbes(mSpecularProbesPositionsTempCPUBuffer, mSpecularProbesCountTotal, game.GetJobSystem()))
+				throw ER_CoreException("Too many specular probes per cell!");
+
 			mSpecularProbesPositionsGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: specular probes positions buffer");
 			mSpecularProbesPositionsGPUBuffer->CreateGPUBufferResource(rhi, mSpecularProbesPositionsTempCPUBuffer, mSpecularProbesCountTotal, sizeof(XMFLOAT4), mIsPlacedOnTerrain, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
 			
@@ -408,23 +354,14 @@ namespace EveryRay_Core
 			}
 		}
 
-		// probe cell's indices GPU buffer, tex. array indices GPU/CPU buffers
-		int* specularProbeCellsIndicesCPUBuffer = new int[mSpecularProbesCellsCountTotal * mCurrentProbeCountPerCell];
-		for (int probeIndex = 0; probeIndex < mSpecularProbesCellsCountTotal; probeIndex++)
-		{
-			for (int indices = 0; indices < mCurrentProbeCountPerCell; indices++)
-			{
-				if (indices >= mSpecularProbesCells[probeIndex].lightProbeIndices.size())
-					specularProbeCellsIndicesCPUBuffer[probeIndex * mCurrentProbeCountPerCell + indices] = -1;
-				else
-					specularProbeCellsIndicesCPUBuffer[probeIndex * mCurrentProbeCountPerCell + indices] = mSpecularProbesCells[probeIndex].lightProbeIndices[indices];
-			}
-		}
+		// probe cell's indices GPU buffer
 		mSpecularProbesCellsIndicesGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: specular probes cells indices buffer");
-		mSpecularProbesCellsIndicesGPUBuffer->CreateGPUBufferResource(rhi, specularProbeCellsIndicesCPUBuffer,	mSpecularProbesCellsCountTotal * mCurrentProbeCountPerCell, sizeof(int), false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
-		DeleteObjects(specularProbeCellsIndicesCPUBuffer);
+		mSpecularProbesCellsIndicesGPUBuffer->CreateGPUBufferResource(rhi, const_cast<int*>(mSpecularProbesGrid.GetCellsProbesIndices().data()), mSpecularProbesCellsCountTotal * mCurrentProbeCountPerCell, sizeof(int), false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
 
 		mSpecularProbesTexArrayIndicesCPUBuffer = new int[mSpecularProbesCountTotal];
+		for (int i = 0; i < mSpecularProbesCountTotal; i++)
+			mSpecularProbesTexArrayIndicesCPUBuffer[i] = -1;
+		mSpecularProbesTexArrayIndicesUploadFramesLeft = SPECULAR_PROBES_TEX_ARRAY_INDICES_UPLOAD_FRAMES;
 		mSpecularProbesTexArrayIndicesGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: specular probes texture array indices buffer");
 		mSpecularProbesTexArrayIndicesGPUBuffer->CreateGPUBufferResource(rhi, mSpecularProbesTexArrayIndicesCPUBuffer, mSpecularProbesCountTotal, sizeof(int), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
 
@@ -450,97 +387,12 @@ namespace EveryRay_Core
 
 		mSpecularCubemapArrayRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Specular Cubemap Array RT");
 		mSpecularCubemapArrayRT->CreateGPUTextureResource(rhi, SPECULAR_PROBE_SIZE, SPECULAR_PROBE_SIZE, 1, ER_FORMAT_R8G8B8A8_UNORM, ER_BIND_SHADER_RESOURCE, SPECULAR_PROBE_MIP_COUNT, -1, CUBEMAP_FACES_COUNT, true, mMaxSpecularProbesInVolumeCount);
+		mSpecularProbesResidency.Initialize(mMaxSpecularProbesInVolumeCount, mSpecularProbesCountTotal);
 	}
 
-	void ER_LightProbesManager::AddProbeToCells(ER_LightProbe& aProbe, ER_ProbeType aType, const XMFLOAT3& minBounds, const XMFLOAT3& maxBounds)
-	{
-		int index = aProbe.GetIndex();
-		if (aType == DIFFUSE_PROBE)
-		{
-			// brute force O(cells * probes)
-			for (auto& cell : mDiffuseProbesCells)
-			{
-				if (IsProbeInCell(aProbe, cell, mDiffuseProbesCellBounds))
-					cell.lightProbeIndices.push_back(index);
-
-				if (cell.lightProbeIndices.size() > mCurrentProbeCountPerCell)
-					throw ER_CoreException("Too many diffuse probes per cell!");
-			}
-		}
-		else
-		{
-			// brute force O(cells * probes)
-			for (auto& cell : mSpecularProbesCells)
-			{
-				if (IsProbeInCell(aProbe, cell, mSpecularProbesCellBounds))
-					cell.lightProbeIndices.push_back(index);
-
-				if (cell.lightProbeIndices.size() > mCurrentProbeCountPerCell)
-					throw ER_CoreException("Too many specular probes per cell!");
-			}
-		}
-	}
-
-	// Fast uniform-grid searching approach (WARNING: can not do multiple indices per pos. (i.e., when pos. is on the edge of several cells))
 	int ER_LightProbesManager::GetCellIndex(const XMFLOAT3& pos, ER_ProbeType aType)
 	{
-		int finalIndex = -1;
-
-		if (aType == DIFFUSE_PROBE)
-		{
-			int xIndex = floor((pos.x - mSceneProbesMinBounds.x) / static_cast<float>(mDistanceBetweenDiffuseProbes));
-			int yIndex = mIs2DCellsGrid ? 0 : floor((pos.y - mSceneProbesMinBounds.y) / static_cast<float>(mDistanceBetweenDiffuseProbes));
-			int zIndex = floor((pos.z - mSceneProbesMinBounds.z) / static_cast<float>(mDistanceBetweenDiffuseProbes));
-
-			if (xIndex < 0 || xIndex > mDiffuseProbesCellsCountX)
-				return -1;
-			if (yIndex < 0 || yIndex > mDiffuseProbesCellsCountY)
-				return -1;
-			if (zIndex < 0 || zIndex > mDiffuseProbesCellsCountZ)
-				return -1;
-
-			//little hacky way to prevent from out-of-bounds
-			if (xIndex == mDiffuseProbesCellsCountX)
-				xIndex = mDiffuseProbesCellsCountX - 1;
-			if (yIndex == mDiffuseProbesCellsCountY)
-				yIndex = mDiffuseProbesCellsCountY - 1;
-			if (zIndex == mDiffuseProbesCellsCountZ)
-				zIndex = mDiffuseProbesCellsCountZ - 1;
-
-			finalIndex = yIndex * (mDiffuseProbesCellsCountX * mDiffuseProbesCellsCountZ) + xIndex * mDiffuseProbesCellsCountZ + zIndex;
-
-			if (finalIndex >= mDiffuseProbesCellsCountTotal)
-				return -1;
-		}
-		else
-		{
-			int xIndex = floor((pos.x - mSceneProbesMinBounds.x) / static_cast<float>(mDistanceBetweenSpecularProbes));
-			int yIndex = mIs2DCellsGrid ? 0 : floor((pos.y - mSceneProbesMinBounds.y) / static_cast<float>(mDistanceBetweenSpecularProbes));
-			int zIndex = floor((pos.z - mSceneProbesMinBounds.z) / static_cast<float>(mDistanceBetweenSpecularProbes));
-
-			if (xIndex < 0 || xIndex > mSpecularProbesCellsCountX)
-				return -1;
-			if (yIndex < 0 || yIndex > mSpecularProbesCellsCountY)
-				return -1;
-			if (zIndex < 0 || zIndex > mSpecularProbesCellsCountZ)
-				return -1;
-
-			//little hacky way to prevent from out-of-bounds
-			if (xIndex == mSpecularProbesCellsCountX)
-				xIndex = mSpecularProbesCellsCountX - 1;
-			if (yIndex == mSpecularProbesCellsCountY)
-				yIndex = mSpecularProbesCellsCountY - 1;
-			if (zIndex == mSpecularProbesCellsCountZ)
-				zIndex = mSpecularProbesCellsCountZ - 1;
-
-			finalIndex = yIndex * (mSpecularProbesCellsCountX * mSpecularProbesCellsCountZ) + xIndex * mSpecularProbesCellsCountZ + zIndex;
-
-			if (finalIndex >= mSpecularProbesCellsCountTotal)
-				return -1;
-
-		}
-
-		return finalIndex;
+		return (aType == DIFFUSE_PROBE) ? mDiffuseProbesGrid.GetCellIndex(pos) : mSpecularProbesGrid.GetCellIndex(pos);
 	}
 
 	XMFLOAT4 ER_LightProbesManager::GetProbesCellsCount(ER_ProbeType aType)
@@ -551,36 +403,6 @@ namespace EveryRay_Core
 			return XMFLOAT4(mSpecularProbesCellsCountX, mSpecularProbesCellsCountY, mSpecularProbesCellsCountZ, mSpecularProbesCellsCountTotal);
 	}
 
-	bool ER_LightProbesManager::IsProbeInCell(ER_LightProbe& aProbe, ER_LightProbeCell& aCell, ER_AABB& aCellBounds)
-	{
-		XMFLOAT3 pos = aProbe.GetPosition();
-		float epsilon = 0.00001f;
-
-		XMFLOAT3 maxBounds = XMFLOAT3(
-			aCellBounds.second.x + aCell.position.x,
-			aCellBounds.second.y + aCell.position.y,
-			aCellBounds.second.z + aCell.position.z);
-
-		XMFLOAT3 minBounds = XMFLOAT3(
-			aCellBounds.first.x + aCell.position.x,
-			aCellBounds.first.y + aCell.position.y,
-			aCellBounds.first.z + aCell.position.z);
-
-		if (mIs2DCellsGrid)
-		{
-			return	
-				(pos.x <= (maxBounds.x + epsilon) && pos.x >= (minBounds.x - epsilon)) &&
-				(pos.z <= (maxBounds.z + epsilon) && pos.z >= (minBounds.z - epsilon));
-		}
-		else
-		{
-			return	
-				(pos.x <= (maxBounds.x + epsilon) && pos.x >= (minBounds.x - epsilon)) &&
-				(pos.y <= (maxBounds.y + epsilon) && pos.y >= (minBounds.y - epsilon)) &&
-				(pos.z <= (maxBounds.z + epsilon) && pos.z >= (minBounds.z - epsilon));
-		}
-	}
-
 	void ER_LightProbesManager::ComputeOrLoadGlobalProbes(ER_Core& game, ProbesRenderingObjectsInfo& aObjects)
 	{
 		// DIFFUSE_PROBE
@@ -630,28 +452,45 @@ namespace EveryRay_Core
 
 		assert(numThreads > 0);
 
+		// all local probes of the level are in one memory-mapped file; legacy per-probe files are only read (and converted) when it is missing or stale
+		const std::wstring volumeFilePath = ER_LightProbesVolumeFile::GetPath(mLevelPath);
+		ER_LightProbesVolumeFile volumeFile;
+		volumeFile.Open(volumeFilePath);
+		bool isVolumeFileOutdated = false;
+
 		if (mDistanceBetweenDiffuseProbes <= 0.0)
 			mDiffuseProbesReady = true;
 
 		if (!mDiffuseProbesReady && mDistanceBetweenDiffuseProbes > 0)
 		{
 			std::wstring diffuseProbesPath = mLevelPath + L"diffuse_probes\\";
-			
-			std::vector<std::thread> threads;
-			threads.reserve(numThreads);
-
-			int probesPerThread = mDiffuseProbes.size() / numThreads;
 
-			for (int i = 0; i < numThreads; i++)
+			const XMFLOAT3* volumeSH = IsVolumeFileMatching(volumeFile, DIFFUSE_PROBE) ? volumeFile.GetSphericalHarmonics(DIFFUSE_PROBE) : nullptr;
+			if (volumeSH)
 			{
-				threads.push_back(std::thread([&, diffuseProbesPath, i]
-				{ 
-					int endRange = (i < numThreads - 1) ? (i + 1) * probesPerThread : mDiffuseProbes.size();
-					for (int j = i * probesPerThread; j < endRange; j++)
-						mDiffuseProbes[j].LoadProbeFromDisk(game, diffuseProbesPath);
-				}));
+				for (int probeIndex = 0; probeIndex < mDiffuseProbesCountTotal; probeIndex++)
+					mDiffuseProbes[probeIndex].LoadSphericalHarmonics(volumeSH + probeIndex * SPHERICAL_HARMONICS_COEF_COUNT);
+			}
+			else
+			{
+				isVolumeFileOutdated = true;
+
+				std::vector<std::thread> threads;
+				threads.reserve(numThreads);
+
+				int probesPerThread = mDiffuseProbes.size() / numThreads;
+
+				for (int i = 0; i < numThreads; i++)
+				{
+					threads.push_back(std::thread([&, diffuseProbesPath, i]
+					{ 
+						int endRange = (i < numThreads - 1) ? (i + 1) * probesPerThread : mDiffuseProbes.size();
+						for (int j = i * probesPerThread; j < endRange; j++)
+							mDiffuseProbes[j].LoadProbeFromDisk(game, diffuseProbesPath);
+					}));
+				}
+				for (auto& t : threads) t.join();
 			}
-			for (auto& t : threads) t.join();
 
 			for (auto& probe : mDiffuseProbes)
 			{
@@ -672,16 +511,20 @@ namespace EveryRay_Core
 
 			UpdateProbesByType(game, DIFFUSE_PROBE);
 
-			// SH GPU buffer
-			XMFLOAT3* shCPUBuffer = new XMFLOAT3[mDiffuseProbesCountTotal * SPHERICAL_HARMONICS_COEF_COUNT];
-			for (int probeIndex = 0; probeIndex < mDiffuseProbesCountTotal; probeIndex++)
+			// SH GPU buffer (straight from the mapped file if possible)
+			XMFLOAT3* shCPUBuffer = nullptr;
+			if (!volumeSH)
 			{
-				const std::vector<XMFLOAT3>& sh = mDiffuseProbes[probeIndex].GetSphericalHarmonics();
-				for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-					shCPUBuffer[probeIndex * SPHERICAL_HARMONICS_COEF_COUNT + i] = sh[i];
+				shCPUBuffer = new XMFLOAT3[mDiffuseProbesCountTotal * SPHERICAL_HARMONICS_COEF_COUNT];
+				for (int probeIndex = 0; probeIndex < mDiffuseProbesCountTotal; probeIndex++)
+				{
+					const std::vector<XMFLOAT3>& sh = mDiffuseProbes[probeIndex].GetSphericalHarmonics();
+					for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+						shCPUBuffer[probeIndex * SPHERICAL_HARMONICS_COEF_COUNT + i] = sh[i];
+				}
 			}
 			mDiffuseProbesSphericalHarmonicsGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: diffuse probes SH buffer");
-			mDiffuseProbesSphericalHarmonicsGPUBuffer->CreateGPUBufferResource(rhi, shCPUBuffer, mDiffuseProbesCountTotal* SPHERICAL_HARMONICS_COEF_COUNT, sizeof(XMFLOAT3),
+			mDiffuseProbesSphericalHarmonicsGPUBuffer->CreateGPUBufferResource(rhi, volumeSH ? const_cast<XMFLOAT3*>(volumeSH) : shCPUBuffer, mDiffuseProbesCountTotal* SPHERICAL_HARMONICS_COEF_COUNT, sizeof(XMFLOAT3),
 				false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
 			DeleteObjects(shCPUBuffer);
 		}
@@ -692,25 +535,40 @@ namespace EveryRay_Core
 		{
 			std::wstring specularProbesPath = mLevelPath + L"specular_probes\\";
 
-			std::vector<std::thread> threads;
-			int numThreads = std::thread::hardware_concurrency();
-			if (game.GetRHI()->GetAPI() != ER_GRAPHICS_API::DX11)
-				numThreads = 1; //TODO fix this on DX12 (need to support multiple command lists)
+			if (IsVolumeFileMatching(volumeFile, SPECULAR_PROBE))
+			{
+				// GPU resources creation is serialized in the RHI anyway, so no threads here
+				for (int probeIndex = 0; probeIndex < mSpecularProbesCountTotal; probeIndex++)
+				{
+					UINT64 size = 0;
+					const char* cubemap = volumeFile.GetCubemap(SPECULAR_PROBE, probeIndex, size);
+					if (!cubemap || !mSpecularProbes[probeIndex].LoadCubemapFromMemory(game, cubemap, size))
+					{
+						isVolumeFileOutdated = true;
+						mSpecularProbes[probeIndex].LoadProbeFromDisk(game, specularProbesPath);
+					}
+				}
+			}
+			else
+			{
+				isVolumeFileOutdated = true;
 
-			threads.reserve(numThreads);
+				std::vector<std::thread> threads;
+				threads.reserve(numThreads);
 
-			int probesPerThread = mSpecularProbes.size() / numThreads;
+				int probesPerThread = mSpecularProbes.size() / numThreads;
 
-			for (int i = 0; i < numThreads; i++)
-			{
-				threads.push_back(std::thread([&, specularProbesPath, i]
+				for (int i = 0; i < numThreads; i++)
 				{
-					int endRange = (i < numThreads - 1) ? (i + 1) * probesPerThread : mSpecularProbes.size();
-					for (int j = i * probesPerThread; j < endRange; j++)
-						mSpecularProbes[j].LoadProbeFromDisk(game, specularProbesPath);
-				}));
+					threads.push_back(std::thread([&, specularProbesPath, i]
+					{
+						int endRange = (i < numThreads - 1) ? (i + 1) * probesPerThread : mSpecularProbes.size();
+						for (int j = i * probesPerThread; j < endRange; j++)
+							mSpecularProbes[j].LoadProbeFromDisk(game, specularProbesPath);
+					}));
+				}
+				for (auto& t : threads) t.join();
 			}
-			for (auto& t : threads) t.join();
 
 			for (auto& probe : mSpecularProbes)
 			{
@@ -729,6 +587,113 @@ namespace EveryRay_Core
 			}
 			mSpecularProbesReady = true;
 		}
+
+		if (isVolumeFileOutdated)
+			SaveProbesVolumeFile(volumeFile, volumeFilePath);
+	}
+
+	// Old volume file (if it is still open) is the source of the cubemaps that were loaded from it, legacy "*.dds" files are the source of the rest.
+	void ER_LightProbesManager::BenchmarkVolumeLoad()
+	{
+		std::vector<std::wstring> legacySHPaths;
+		std::vector<std::wstring> legacyCubemapsPaths;
+		for (auto& probe : mDiffuseProbes)
+			legacySHPaths.push_back(probe.GetConstructedProbeName(mLevelPath + L"diffuse_probes\\", true));
+		for (auto& probe : mSpecularProbes)
+			legacyCubemapsPaths.push_back(probe.GetConstructedProbeName(mLevelPath + L"specular_probes\\", false));
+		ER_LightProbesVolumeFile::BenchmarkLoad(ER_LightProbesVolumeFile::GetPath(mLevelPath), legacySHPaths, legacyCubemapsPaths);
+	}
+
+	void ER_LightProbesManager::SaveProbesVolumeFile(ER_LightProbesVolumeFile& aOldVolumeFile, const std::wstring& aPath)
+	{
+		ER_LightProbesVolumeSectionData sectionsData[PROBE_TYPES_COUNT];
+		const ER_LightProbesVolumeSectionData* sections[PROBE_TYPES_COUNT] = { nullptr, nullptr };
+
+		if (mDistanceBetweenDiffuseProbes > 0 && mDiffuseProbesCountTotal > 0)
+		{
+			ER_LightProbesVolumeSectionData& data = sectionsData[DIFFUSE_PROBE];
+			data.countX = mDiffuseProbesCountX;
+			data.countY = mDiffuseProbesCountY;
+			data.countZ = mDiffuseProbesCountZ;
+			data.distanceBetweenProbes = mDistanceBetweenDiffuseProbes;
+			data.minBounds = mSceneProbesMinBounds;
+			data.positions.reserve(mDiffuseProbesCountTotal);
+			data.sphericalHarmonics.reserve(mDiffuseProbesCountTotal * SPHERICAL_HARMONICS_COEF_COUNT);
+			for (auto& probe : mDiffuseProbes)
+			{
+				data.positions.push_back(probe.GetPosition());
+				const std::vector<XMFLOAT3>& sh = probe.GetSphericalHarmonics();
+				data.sphericalHarmonics.insert(data.sphericalHarmonics.end(), sh.begin(), sh.end());
+			}
+			sections[DIFFUSE_PROBE] = &data;
+		}
+
+		if (mDistanceBetweenSpecularProbes > 0 && mSpecularProbesCountTotal > 0)
+		{
+			const bool isOldSectionMatching = IsVolumeFileMatching(aOldVolumeFile, SPECULAR_PROBE);
+			const std::wstring specularProbesPath = mLevelPath + L"specular_probes\\";
+
+			ER_LightProbesVolumeSectionData& data = sectionsData[SPECULAR_PROBE];
+			data.countX = mSpecularProbesCountX;
+			data.countY = mSpecularProbesCountY;
+			data.countZ = mSpecularProbesCountZ;
+			data.distanceBetweenProbes = mDistanceBetweenSpecularProbes;
+			data.minBounds = mSceneProbesMinBounds;
+			data.positions.reserve(mSpecularProbesCountTotal);
+			data.cubemaps.resize(mSpecularProbesCountTotal);
+			int missingCubemapsCount = 0;
+			for (int probeIndex = 0; probeIndex < mSpecularProbesCountTotal; probeIndex++)
+			{
+				data.positions.push_back(mSpecularProbes[probeIndex].GetPosition());
+
+				UINT64 size = 0;
+				const char* cubemap = isOldSectionMatching ? aOldVolumeFile.GetCubemap(SPECULAR_PROBE, probeIndex, size) : nullptr;
+				if (cubemap)
+					data.cubemaps[probeIndex].assign(cubemap, cubemap + size);
+				else if (!ER_LightProbesVolumeFile::ReadFileToMemory(mSpecularProbes[probeIndex].GetConstructedProbeName(specularProbesPath, false), data.cubemaps[probeIndex]))
+					missingCubemapsCount++;
+			}
+			sections[SPECULAR_PROBE] = &data;
+
+			if (missingCubemapsCount > 0)
+			{
+				std::wstring message = L"[ER Logger][ER_LightProbesManager] " + std::to_wstring(missingCubemapsCount) + L" specular probes have no cubemap in the probes volume file, they will be recomputed next time\n";
+				ER_OUTPUT_LOG(message.c_str());
+			}
+		}
+
+		std::vector<char> data;
+		ER_LightProbesVolumeFile::Build(sections, data);
+
+		aOldVolumeFile.Close(); // can not overwrite a mapped file
+		if (ER_LightProbesVolumeFile::WriteToDisk(data, aPath))
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Saved probes volume file (legacy per-probe files are not needed anymore): " + aPath + L"\n";
+			ER_OUTPUT_LOG(message.c_str());
+		}
+		else
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Could not save probes volume file: " + aPath + L"\n";
+			ER_OUTPUT_LOG(message.c_str());
+		}
+	}
+
+	// Volume file is only used if it was built for the same grid and probes did not move since
+	bool ER_LightProbesManager::IsVolumeFileMatching(const ER_LightProbesVolumeFile& aVolumeFile, ER_ProbeType aType)
+	{
+		const std::vector<ER_LightProbe>& probes = (aType == DIFFUSE_PROBE) ? mDiffuseProbes : mSpecularProbes;
+		bool isMatching = (aType == DIFFUSE_PROBE) ?
+			aVolumeFile.IsMatchingGrid(aType, mDiffuseProbesCountTotal, mDiffuseProbesCountX, mDiffuseProbesCountY, mDiffuseProbesCountZ, mDistanceBetweenDiffuseProbes, mSceneProbesMinBounds) :
+			aVolumeFile.IsMatchingGrid(aType, mSpecularProbesCountTotal, mSpecularProbesCountX, mSpecularProbesCountY, mSpecularProbesCountZ, mDistanceBetweenSpecularProbes, mSceneProbesMinBounds);
+		if (!isMatching)
+			return false;
+
+		for (size_t i = 0; i < probes.size(); i++)
+		{
+			if (!aVolumeFile.IsMatchingPosition(aType, static_cast<UINT>(i), probes[i].GetPosition()))
+				return false;
+		}
+		return true;
 	}
 
 	void ER_LightProbesManager::DrawDebugProbes(ER_RHI* rhi, ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_ProbeType aType, ER_RHI_GPURootSignature* rs)
@@ -786,7 +751,6 @@ namespace EveryRay_Core
 			if (!mSpecularProbesReady || mDistanceBetweenSpecularProbes <= 0)
 				return;
 
-			mNonCulledSpecularProbesCount = 0;
 			mNonCulledSpecularProbesIndices.clear();
 		}
 
@@ -801,8 +765,13 @@ namespace EveryRay_Core
 				mSpecularProbesVolumeSize + mMainCamera.Position().y,
 				mSpecularProbesVolumeSize + mMainCamera.Position().z);
 
-			for (auto& lightProbe : probes)
-				lightProbe.CPUCullAgainstProbeBoundingVolume(minBounds, maxBounds);
+			for (int i = 0; i < static_cast<int>(probes.size()); i++)
+			{
+				probes[i].CPUCullAgainstProbeBoundingVolume(minBounds, maxBounds);
+				if (!probes[i].IsCulled())
+					mNonCulledSpecularProbesIndices.push_back(i);
+			}
+			mSpecularProbesResidency.Update(mNonCulledSpecularProbesIndices);
 		}
 
 		if (probeRenderingObject)
@@ -828,47 +797,51 @@ namespace EveryRay_Core
 					if (aType == DIFFUSE_PROBE)
 						oldInstancedData[i].World._11 = static_cast<float>(i);
 					else
-					{
-						oldInstancedData[i].World._11 = static_cast<float>(mNonCulledSpecularProbesCount);
-						mNonCulledSpecularProbesCount++;
-						mNonCulledSpecularProbesIndices.push_back(i);
-					}
+						oldInstancedData[i].World._11 = static_cast<float>(mSpecularProbesResidency.GetProbeSlot(i));
 				}
 			}
 
+			probeRenderingObject->MarkAllInstancesDirty();
 			probeRenderingObject->UpdateInstanceBuffer(oldInstancedData);
 		}
 
+		// only the cubemaps of the probes that entered the volume are copied and only the changed indices are rewritten (see ER_LightProbesResidencyCache)
 		ER_RHI* rhi = game.GetRHI();
 		if (aType == SPECULAR_PROBE)
 		{
-			for (int i = 0; i < mSpecularProbesCountTotal; i++)
-				mSpecularProbesTexArrayIndicesCPUBuffer[i] = -1;
-
-			for (int i = 0; i < mMaxSpecularProbesInVolumeCount; i++)
+			for (const ER_LightProbesResidencyUpload& upload : mSpecularProbesResidency.GetUploads())
 			{
-				if (i < mNonCulledSpecularProbesIndices.size() && i < probes.size())
-				{
-					int probeIndex = mNonCulledSpecularProbesIndices[i];
+				ER_RHI_GPUTexture* cubemap = mSpecularProbes[upload.probeIndex].GetCubemapTexture();
 
-					rhi->TransitionResources({ static_cast<ER_RHI_GPUResource*>(mSpecularCubemapArrayRT), static_cast<ER_RHI_GPUResource*>(mSpecularProbes[probeIndex].GetCubemapTexture()) },
-						{ ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_DEST, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_SOURCE }, rhi->GetCurrentGraphicsCommandListIndex());
+				rhi->TransitionResources({ static_cast<ER_RHI_GPUResource*>(mSpecularCubemapArrayRT), static_cast<ER_RHI_GPUResource*>(cubemap) },
+					{ ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_DEST, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_SOURCE }, rhi->GetCurrentGraphicsCommandListIndex());
 
-					for (int cubeI = 0; cubeI < CUBEMAP_FACES_COUNT; cubeI++)
+				for (int cubeI = 0; cubeI < CUBEMAP_FACES_COUNT; cubeI++)
+				{
+					for (int mip = 0; mip < SPECULAR_PROBE_MIP_COUNT; mip++)
 					{
-						for (int mip = 0; mip < SPECULAR_PROBE_MIP_COUNT; mip++)
-						{
-							rhi->CopyGPUTextureSubresourceRegion(mSpecularCubemapArrayRT, mip + (cubeI + CUBEMAP_FACES_COUNT * i) * SPECULAR_PROBE_MIP_COUNT, 0, 0, 0,
-								mSpecularProbes[probeIndex].GetCubemapTexture(), mip + cubeI * SPECULAR_PROBE_MIP_COUNT, true);
-						}
+						rhi->CopyGPUTextureSubresourceRegion(mSpecularCubemapArrayRT, mip + (cubeI + CUBEMAP_FACES_COUNT * upload.slot) * SPECULAR_PROBE_MIP_COUNT, 0, 0, 0,
+							cubemap, mip + cubeI * SPECULAR_PROBE_MIP_COUNT, true);
 					}
-					mSpecularProbesTexArrayIndicesCPUBuffer[probeIndex] = CUBEMAP_FACES_COUNT * i;
-
-					rhi->TransitionResources({ static_cast<ER_RHI_GPUResource*>(mSpecularCubemapArrayRT), static_cast<ER_RHI_GPUResource*>(mSpecularProbes[probeIndex].GetCubemapTexture()) },
-						{ ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE }, rhi->GetCurrentGraphicsCommandListIndex());
 				}
+
+				rhi->TransitionResources({ static_cast<ER_RHI_GPUResource*>(mSpecularCubemapArrayRT), static_cast<ER_RHI_GPUResource*>(cubemap) },
+					{ ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE }, rhi->GetCurrentGraphicsCommandListIndex());
+			}
+
+			for (int probeIndex : mSpecularProbesResidency.GetChangedProbes())
+			{
+				const int slot = mSpecularProbesResidency.GetProbeSlot(probeIndex);
+				mSpecularProbesTexArrayIndicesCPUBuffer[probeIndex] = (slot == -1) ? -1 : CUBEMAP_FACES_COUNT * slot;
+			}
+			if (!mSpecularProbesResidency.GetChangedProbes().empty())
+				mSpecularProbesTexArrayIndicesUploadFramesLeft = SPECULAR_PROBES_TEX_ARRAY_INDICES_UPLOAD_FRAMES;
+
+			if (mSpecularProbesTexArrayIndicesUploadFramesLeft > 0)
+			{
+				rhi->UpdateBuffer(mSpecularProbesTexArrayIndicesGPUBuffer, mSpecularProbesTexArrayIndicesCPUBuffer, sizeof(mSpecularProbesTexArrayIndicesCPUBuffer[0]) * mSpecularProbesCountTotal);
+				mSpecularProbesTexArrayIndicesUploadFramesLeft--;
 			}
-			rhi->UpdateBuffer(mSpecularProbesTexArrayIndicesGPUBuffer, mSpecularProbesTexArrayIndicesCPUBuffer, sizeof(mSpecularProbesTexArrayIndicesCPUBuffer[0]) * mSpecularProbesCountTotal);
 		}
 	}
 
@@ -896,10 +869,21 @@ namespace EveryRay_Core
 		if (!terrain)
 			throw ER_CoreException("You want to place light probes on terrain but terrain is not found in the scene!");
 
-		terrain->PlaceOnTerrain(outputBuffer, inputBuffer, positions, positionsCount, TerrainSplatChannels::NONE, nullptr, 0, customDampDelta);
-
 		ER_RHI_GPUBuffer* finalGPUBuffer = (aType == DIFFUSE_PROBE) ? mDiffuseProbesPositionsGPUBuffer : mSpecularProbesPositionsGPUBuffer;
 
+		if (terrain->IsCPUPlacementEnabled())
+		{
+			terrain->PlaceOnTerrainCPU(positions, positionsCount, TerrainSplatChannels::NONE, customDampDelta, game.GetJobSystem());
+
+			std::vector<ER_LightProbe>& probes = (aType == DIFFUSE_PROBE) ? mDiffuseProbes : mSpecularProbes;
+			game.GetRHI()->UpdateBuffer(finalGPUBuffer, (void*)positions, positionsCount * sizeof(XMFLOAT4), true);
+			for (int i = 0; i < positionsCount; i++)
+				probes[i].SetPosition(XMFLOAT3(positions[i].x, positions[i].y, positions[i].z));
+			return;
+		}
+
+		terrain->PlaceOnTerrain(outputBuffer, inputBuffer, positions, positionsCount, TerrainSplatChannels::NONE, nullptr, 0, customDampDelta);
+
 #if !ER_PLATFORM_SUPPORTS_IMMEDIATE_CONTEXT
 		const std::string probeTypeName = (aType == DIFFUSE_PROBE) ? "diffuse" : "specular";
 		const std::string eventName = "On-terrain placement callback - placement of probes: " + probeTypeName;
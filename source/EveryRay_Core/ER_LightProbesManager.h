@@ -10,12 +10,16 @@
 #define PROBE_COUNT_PER_CELL_3D 8
 #define PROBE_COUNT_PER_CELL_2D 4
 
+#define SPECULAR_PROBES_TEX_ARRAY_INDICES_UPLOAD_FRAMES 2 // dynamic buffers have a copy per back buffer in DX12 (DX12_MAX_BACK_BUFFER_COUNT), so indices are uploaded for that many frames after a change
+
 #define SPHERICAL_HARMONICS_ORDER 2
 #define SPHERICAL_HARMONICS_COEF_COUNT (SPHERICAL_HARMONICS_ORDER + 1) * (SPHERICAL_HARMONICS_ORDER + 1)
 
 #include "Common.h"
 #include "ER_RenderingObject.h"
 #include "ER_LightProbe.h"
+#include "ER_LightProbesGrid.h"
+#include "ER_LightProbesResidencyCache.h"
 #include "RHI/ER_RHI.h"
 
 namespace EveryRay_Core
@@ -28,6 +32,7 @@ namespace EveryRay_Core
 	class ER_QuadRenderer;
 	class ER_Scene;
 	class ER_RenderableAABB;
+	class ER_LightProbesVolumeFile;
 
 	enum ER_ProbeType
 	{
@@ -36,13 +41,6 @@ namespace EveryRay_Core
 		PROBE_TYPES_COUNT = 2
 	};
 
-	struct ER_LightProbeCell
-	{
-		XMFLOAT3 position;
-		std::vector<int> lightProbeIndices;
-		int index;
-	};
-
 	class ER_LightProbesManager
 	{
 	public:
@@ -72,6 +70,7 @@ namespace EveryRay_Core
 		ER_RHI_GPUBuffer* GetSpecularProbesTexArrayIndicesBuffer() const { return mSpecularProbesTexArrayIndicesGPUBuffer; }
 		ER_RHI_GPUBuffer* GetSpecularProbesPositionsBuffer() const { return mSpecularProbesPositionsGPUBuffer; }
 		float GetDistanceBetweenSpecularProbes() { return mDistanceBetweenSpecularProbes; }
+		const ER_LightProbesResidencyStats& GetSpecularProbesResidencyStats() const { return mSpecularProbesResidency.GetStats(); }
 
 		ER_RHI_GPUTexture* GetIntegrationMap() const { return mIntegrationMapTextureSRV; }
 		
@@ -84,6 +83,9 @@ namespace EveryRay_Core
 		bool IsEnabled() { return mEnabled; }
 		bool AreGlobalProbesReady() { return mGlobalDiffuseProbeReady && mGlobalSpecularProbeReady; }
 
+		// Logs legacy per-probe files vs. probes volume file load times of the loaded level (CPU only, see ER_Tests)
+		void BenchmarkVolumeLoad();
+
 		void SetDiffuseProbePosition(int index, const XMFLOAT3& pos) { mDiffuseProbes[index].SetPosition(pos); }
 		void SetSpecularProbePosition(int index, const XMFLOAT3& pos) { mSpecularProbes[index].SetPosition(pos); }
 
@@ -93,11 +95,11 @@ namespace EveryRay_Core
 		void SetupGlobalSpecularProbe(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper);
 		void SetupDiffuseProbes(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper);
 		void SetupSpecularProbes(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper);
-		void AddProbeToCells(ER_LightProbe& aProbe, ER_ProbeType aType, const XMFLOAT3& minBounds, const XMFLOAT3& maxBounds);
-		bool IsProbeInCell(ER_LightProbe& aProbe, ER_LightProbeCell& aCell, ER_AABB& aCellBounds);
 		void UpdateProbesByType(ER_Core& game, ER_ProbeType aType);
 		void PlaceProbesOnTerrain(ER_Core& game, ER_ProbeType aType, ER_RHI_GPUBuffer* outputBuffer, ER_RHI_GPUBuffer* inputBuffer, 
 			XMFLOAT4* positions, int positionsCount, float customDampDelta = FLT_MAX);
+		bool IsVolumeFileMatching(const ER_LightProbesVolumeFile& aVolumeFile, ER_ProbeType aType);
+		void SaveProbesVolumeFile(ER_LightProbesVolumeFile& aOldVolumeFile, const std::wstring& aPath);
 
 		ER_QuadRenderer* mQuadRenderer = nullptr;
 		ER_Camera& mMainCamera;
@@ -122,8 +124,7 @@ namespace EveryRay_Core
 		ER_RHI_GPUTexture* mTempDiffuseCubemapFacesRT = nullptr;
 		ER_RHI_GPUTexture* mTempDiffuseCubemapFacesConvolutedRT = nullptr;
 		ER_RHI_GPUTexture* mTempDiffuseCubemapDepthBuffers[CUBEMAP_FACES_COUNT] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
-		std::vector<ER_LightProbeCell> mDiffuseProbesCells;
-		ER_AABB mDiffuseProbesCellBounds;
+		ER_LightProbesGrid mDiffuseProbesGrid;
 		int mDiffuseProbesCountTotal = 0;
 		int mDiffuseProbesCountX = 0;
 		int mDiffuseProbesCountY = 0;
@@ -152,9 +153,10 @@ namespace EveryRay_Core
 		ER_RHI_GPUTexture* mTempSpecularCubemapFacesConvolutedRT = nullptr;
 		ER_RHI_GPUTexture* mTempSpecularCubemapDepthBuffers[CUBEMAP_FACES_COUNT] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
 		ER_RHI_GPUTexture* mSpecularCubemapArrayRT = nullptr;
-		std::vector<ER_LightProbeCell> mSpecularProbesCells;
-		ER_AABB mSpecularProbesCellBounds;
+		ER_LightProbesGrid mSpecularProbesGrid;
 		std::vector<int> mNonCulledSpecularProbesIndices;
+		ER_LightProbesResidencyCache mSpecularProbesResidency;
+		int mSpecularProbesTexArrayIndicesUploadFramesLeft = 0;
 		int mSpecularProbesCountTotal = 0;
 		int mSpecularProbesCountX = 0;
 		int mSpecularProbesCountY = 0;
@@ -163,7 +165,6 @@ namespace EveryRay_Core
 		int mSpecularProbesCellsCountY = 0;
 		int mSpecularProbesCellsCountZ = 0;
 		int mSpecularProbesCellsCountTotal = 0;
-		int mNonCulledSpecularProbesCount = 0;
 		bool mSpecularProbesReady = false;
 		ER_LightProbe* mGlobalSpecularProbe = nullptr;
 		bool mGlobalSpecularProbeReady = false;
@@ -0,0 +1,237 @@
+#include "ER_LightProbesResidencyCache.h"
+
+#include <algorithm>
+
+namespace EveryRay_Core
+{
+	void ER_LightProbesResidencyCache::Initialize(int aSlotsCount, int aProbesCount)
+	{
+		assert(aSlotsCount >= 0 && aProbesCount >= 0);
+
+		mSlots.assign(aSlotsCount, {});
+		mResidentProbesSlots.assign(aProbesCount, -1);
+		mVisibleProbesSlots.assign(aProbesCount, -1);
+		mProbesVisibleFrames.assign(aProbesCount, 0);
+		mVisibleProbes.clear();
+		mUploads.clear();
+		mChangedProbes.clear();
+		mStats = {};
+		mFrame = 0;
+	}
+
+	void ER_LightProbesResidencyCache::Update(const std::vector<int>& aVisibleProbes)
+	{
+		mFrame++;
+		mUploads.clear();
+		mChangedProbes.clear();
+		mMissingProbes.clear();
+		mNewVisibleProbes.clear();
+
+		const UINT64 totalUploads = mStats.totalUploads;
+		const UINT64 totalEvictions = mStats.totalEvictions;
+		mStats = {};
+		mStats.totalUploads = totalUploads;
+		mStats.totalEvictions = totalEvictions;
+
+		// 1) visible probes that are resident already keep their slots
+		const int visibleCount = std::min(static_cast<int>(aVisibleProbes.size()), static_cast<int>(mSlots.size()));
+		for (int i = 0; i < visibleCount; i++)
+		{
+			const int probeIndex = aVisibleProbes[i];
+			assert(probeIndex >= 0 && probeIndex < static_cast<int>(mResidentProbesSlots.size()));
+			if (mProbesVisibleFrames[probeIndex] == mFrame)
+				continue;
+
+			mProbesVisibleFrames[probeIndex] = mFrame;
+			mNewVisibleProbes.push_back(probeIndex);
+
+			const int slot = mResidentProbesSlots[probeIndex];
+			if (slot != -1)
+			{
+				mSlots[slot].lastUsedFrame = mFrame;
+				mStats.hits++;
+			}
+			else
+				mMissingProbes.push_back(probeIndex);
+		}
+
+		// 2) the rest get empty slots first, then the least recently used ones
+		if (!mMissingProbes.empty())
+		{
+			mFreeSlots.clear();
+			for (int slot = 0; slot < static_cast<int>(mSlots.size()); slot++)
+			{
+				if (mSlots[slot].lastUsedFrame != mFrame)
+					mFreeSlots.push_back(slot);
+			}
+			std::sort(mFreeSlots.begin(), mFreeSlots.end(), [this](int a, int b)
+			{
+				const bool isAEmpty = mSlots[a].probeIndex == -1;
+				const bool isBEmpty = mSlots[b].probeIndex == -1;
+				if (isAEmpty != isBEmpty)
+					return isAEmpty;
+				if (mSlots[a].lastUsedFrame != mSlots[b].lastUsedFrame)
+					return mSlots[a].lastUsedFrame < mSlots[b].lastUsedFrame;
+				return a < b;
+			});
+			assert(mFreeSlots.size() >= mMissingProbes.size());
+
+			for (size_t i = 0; i < mMissingProbes.size(); i++)
+			{
+				const int probeIndex = mMissingProbes[i];
+				const int slot = mFreeSlots[i];
+
+				const int evictedProbeIndex = mSlots[slot].probeIndex;
+				if (evictedProbeIndex != -1)
+				{
+					mResidentProbesSlots[evictedProbeIndex] = -1;
+					mStats.evictions++;
+				}
+
+				mSlots[slot].probeIndex = probeIndex;
+				mSlots[slot].lastUsedFrame = mFrame;
+				mResidentProbesSlots[probeIndex] = slot;
+				mUploads.push_back({ probeIndex, slot });
+			}
+			mStats.uploads = static_cast<int>(mMissingProbes.size());
+			mStats.totalUploads += mStats.uploads;
+			mStats.totalEvictions += mStats.evictions;
+		}
+
+		// 3) index entries: probes that left the volume, then the visible ones that entered it or moved to another slot
+		for (int probeIndex : mVisibleProbes)
+		{
+			if (mProbesVisibleFrames[probeIndex] != mFrame && mVisibleProbesSlots[probeIndex] != -1)
+			{
+				mVisibleProbesSlots[probeIndex] = -1;
+				mChangedProbes.push_back(probeIndex);
+			}
+		}
+
+		for (int probeIndex : mNewVisibleProbes)
+		{
+			const int slot = mResidentProbesSlots[probeIndex];
+			if (mVisibleProbesSlots[probeIndex] != slot)
+			{
+				mVisibleProbesSlots[probeIndex] = slot;
+				mChangedProbes.push_back(probeIndex);
+			}
+		}
+		mVisibleProbes.swap(mNewVisibleProbes);
+
+		mStats.visibleProbes = static_cast<int>(mVisibleProbes.size());
+		mStats.changedIndices = static_cast<int>(mChangedProbes.size());
+	}
+
+	bool ER_LightProbesResidencyCache::RunTests()
+	{
+		bool isPassed = true;
+
+		// mirrors of what the owner keeps on the GPU: index entries are only rewritten from GetChangedProbes() and slots from GetUploads()
+		std::vector<int> indices;
+		std::vector<int> slotsContents;
+		auto update = [&](ER_LightProbesResidencyCache& aCache, const std::vector<int>& aVisibleProbes)
+		{
+			aCache.Update(aVisibleProbes);
+			for (const ER_LightProbesResidencyUpload& upload : aCache.GetUploads())
+				slotsContents[upload.slot] = upload.probeIndex;
+			for (int probeIndex : aCache.GetChangedProbes())
+				indices[probeIndex] = aCache.GetProbeSlot(probeIndex);
+
+			// every visible probe (up to the slots count) points to a slot with its texture, others are -1
+			bool isValid = true;
+			const int visibleCount = std::min(static_cast<int>(aVisibleProbes.size()), aCache.GetSlotsCount());
+			std::vector<int> expected(indices.size(), -1);
+			for (int i = 0; i < visibleCount; i++)
+				expected[aVisibleProbes[i]] = -2;
+			for (size_t probeIndex = 0; probeIndex < indices.size(); probeIndex++)
+			{
+				if (expected[probeIndex] == -2)
+					isValid &= indices[probeIndex] >= 0 && slotsContents[indices[probeIndex]] == static_cast<int>(probeIndex);
+				else
+					isValid &= indices[probeIndex] == -1;
+				isValid &= indices[probeIndex] == aCache.GetProbeSlot(static_cast<int>(probeIndex));
+			}
+			return isValid;
+		};
+		auto reset = [&](ER_LightProbesResidencyCache& aCache, int aSlotsCount, int aProbesCount)
+		{
+			aCache.Initialize(aSlotsCount, aProbesCount);
+			indices.assign(aProbesCount, -1);
+			slotsContents.assign(aSlotsCount, -1);
+		};
+
+		// basic residency and LRU eviction
+		{
+			ER_LightProbesResidencyCache cache;
+			reset(cache, 4, 10);
+
+			isPassed &= update(cache, { 0, 1, 2 });
+			isPassed &= cache.GetStats().uploads == 3 && cache.GetStats().hits == 0 && cache.GetStats().changedIndices == 3;
+
+			// same probes: nothing to do
+			isPassed &= update(cache, { 0, 1, 2 });
+			isPassed &= cache.GetStats().uploads == 0 && cache.GetStats().hits == 3 && cache.GetStats().changedIndices == 0;
+
+			// 0 leaves, 3 enters into the empty slot
+			const int slotOfProbe0 = cache.GetProbeSlot(0);
+			isPassed &= update(cache, { 1, 2, 3 });
+			isPassed &= cache.GetStats().uploads == 1 && cache.GetStats().evictions == 0 && cache.GetStats().changedIndices == 2;
+
+			// 0 comes back: still resident in its old slot, no copy
+			isPassed &= update(cache, { 0, 1, 2, 3 });
+			isPassed &= cache.GetStats().uploads == 0 && cache.GetStats().hits == 4 && cache.GetStats().changedIndices == 1 && cache.GetProbeSlot(0) == slotOfProbe0;
+
+			// 2 and 3 are used more recently than 0 and 1, so 6 evicts 0 (the lower slot of the two oldest)
+			isPassed &= update(cache, { 2, 3 });
+			const int slotOfProbe2 = cache.GetProbeSlot(2);
+			isPassed &= update(cache, { 3, 6 });
+			isPassed &= cache.GetStats().uploads == 1 && cache.GetStats().evictions == 1 && cache.GetProbeSlot(6) == slotOfProbe0;
+			isPassed &= update(cache, { 2, 3, 6 });
+			isPassed &= cache.GetStats().uploads == 0 && cache.GetProbeSlot(2) == slotOfProbe2;
+
+			// more visible probes than slots: only the first ones get a slot
+			isPassed &= update(cache, { 7, 8, 9, 1, 2, 3 });
+			isPassed &= cache.GetStats().visibleProbes == 4 && cache.GetProbeSlot(2) == -1 && cache.GetProbeSlot(3) == -1;
+
+			// empty volume
+			isPassed &= update(cache, {});
+			isPassed &= cache.GetStats().uploads == 0 && cache.GetStats().changedIndices == 4;
+			isPassed &= cache.GetStats().totalUploads == 3 + 1 + 1 + 3;
+		}
+
+		// camera moving through a row of probes: every frame 2 probes leave and 2 enter the volume
+		UINT64 uploadsWithoutCache = 0, uploadsWithCache = 0;
+		{
+			const int probesCount = 500;
+			const int volumeCount = 24;
+			ER_LightProbesResidencyCache cache;
+			reset(cache, 32, probesCount);
+
+			std::vector<int> visibleProbes;
+			for (int frame = 0; frame < 2000; frame++)
+			{
+				// back and forth, so some probes come back while still resident
+				const int maxStep = (probesCount - volumeCount) / 2;
+				const int step = (frame % (2 * maxStep) < maxStep) ? frame % (2 * maxStep) : 2 * maxStep - frame % (2 * maxStep);
+				const int first = 2 * step;
+
+				visibleProbes.clear();
+				for (int i = first; i < first + volumeCount && i < probesCount; i++)
+					visibleProbes.push_back(i);
+
+				isPassed &= update(cache, visibleProbes);
+				isPassed &= cache.GetStats().uploads <= 2 || frame == 0;
+				uploadsWithoutCache += visibleProbes.size();
+			}
+			uploadsWithCache = cache.GetStats().totalUploads;
+			isPassed &= uploadsWithCache < uploadsWithoutCache / 10;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_LightProbesResidencyCache] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L". Cubemaps copied in the moving camera test: " +
+			std::to_wstring(uploadsWithCache) + L" (" + std::to_wstring(uploadsWithoutCache) + L" without the cache)\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Common.h"
+
+namespace EveryRay_Core
+{
+	// Cubemap of a probe that has to be copied into a slot of the array this frame
+	struct ER_LightProbesResidencyUpload
+	{
+		int probeIndex;
+		int slot;
+	};
+
+	struct ER_LightProbesResidencyStats
+	{
+		// last frame
+		int visibleProbes = 0; // probes in the volume that got a slot (at most the slots count)
+		int hits = 0; // visible probes that were resident already (no copy)
+		int uploads = 0; // probes copied into a slot
+		int evictions = 0; // uploads that replaced another resident probe
+		int changedIndices = 0; // probe -> slot entries rewritten
+		// since Initialize()
+		UINT64 totalUploads = 0;
+		UINT64 totalEvictions = 0;
+	};
+
+	// CPU side of a texture array with a fixed number of slots that caches per-probe textures (i.e., culled specular probes' cubemaps).
+	// Probes stay resident after they leave the volume and get their slot back for free if they return before being evicted (least recently used first).
+	// Only works with indices, so the GPU copies are done by the owner (see GetUploads()).
+	class ER_LightProbesResidencyCache
+	{
+	public:
+		void Initialize(int aSlotsCount, int aProbesCount);
+
+		// aVisibleProbes - probes in the volume this frame; only the first "slots count" of them get a slot (same as without the cache)
+		void Update(const std::vector<int>& aVisibleProbes);
+
+		// Slot of a probe that is visible this frame (-1 otherwise), i.e. what the shaders should use
+		int GetProbeSlot(int aProbeIndex) const { return mVisibleProbesSlots[aProbeIndex]; }
+		// Probes whose GetProbeSlot() changed during the last Update()
+		const std::vector<int>& GetChangedProbes() const { return mChangedProbes; }
+		const std::vector<ER_LightProbesResidencyUpload>& GetUploads() const { return mUploads; }
+		const ER_LightProbesResidencyStats& GetStats() const { return mStats; }
+		int GetSlotsCount() const { return static_cast<int>(mSlots.size()); }
+
+		// LRU eviction, index entries and counters (see ER_Tests)
+		static bool RunTests();
+	private:
+		struct Slot
+		{
+			int probeIndex = -1;
+			UINT64 lastUsedFrame = 0;
+		};
+
+		std::vector<Slot> mSlots;
+		std::vector<int> mResidentProbesSlots; // per probe: slot with its texture (even if not visible) or -1
+		std::vector<int> mVisibleProbesSlots; // per probe: slot if visible this frame or -1
+		std::vector<UINT64> mProbesVisibleFrames; // per probe: last frame it was visible in
+		std::vector<int> mVisibleProbes; // last frame
+		std::vector<int> mNewVisibleProbes; // temp
+		std::vector<int> mMissingProbes; // temp
+		std::vector<int> mFreeSlots; // temp
+
+		std::vector<ER_LightProbesResidencyUpload> mUploads;
+		std::vector<int> mChangedProbes;
+		ER_LightProbesResidencyStats mStats;
+		UINT64 mFrame = 0;
+	};
+}
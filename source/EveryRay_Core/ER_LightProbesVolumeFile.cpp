@@ -0,0 +1,524 @@
+#include "ER_LightProbesVolumeFile.h"
+#include "ER_LightProbesManager.h"
+#include "ER_Utility.h"
+
+#include <fstream>
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		template<typename T>
+		UINT64 AppendArray(std::vector<char>& aData, const T* aArray, size_t aCount, size_t aAlignment = 16)
+		{
+			size_t offset = (aData.size() + aAlignment - 1) & ~(aAlignment - 1);
+			aData.resize(offset + aCount * sizeof(T), 0);
+			if (aCount)
+				memcpy(aData.data() + offset, aArray, aCount * sizeof(T));
+			return static_cast<UINT64>(offset);
+		}
+	}
+
+	ER_LightProbesVolumeFile::ER_LightProbesVolumeFile()
+	{
+	}
+
+	ER_LightProbesVolumeFile::~ER_LightProbesVolumeFile()
+	{
+		Close();
+	}
+
+	void ER_LightProbesVolumeFile::Build(const ER_LightProbesVolumeSectionData* aSections[ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT], std::vector<char>& aOutData)
+	{
+		ER_LightProbesVolumeHeader header = {};
+		header.magic = ER_LIGHT_PROBES_VOLUME_MAGIC;
+		header.version = ER_LIGHT_PROBES_VOLUME_VERSION;
+		header.sphericalHarmonicsCoefficientsCount = SPHERICAL_HARMONICS_COEF_COUNT;
+
+		aOutData.clear();
+		aOutData.resize(sizeof(ER_LightProbesVolumeHeader), 0);
+
+		for (int type = 0; type < ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT; type++)
+		{
+			const ER_LightProbesVolumeSectionData* sectionData = aSections[type];
+			ER_LightProbesVolumeSection& section = header.sections[type];
+			if (!sectionData || sectionData->positions.empty())
+				continue;
+
+			const size_t probesCount = sectionData->positions.size();
+			assert(sectionData->sphericalHarmonics.empty() || sectionData->sphericalHarmonics.size() == probesCount * SPHERICAL_HARMONICS_COEF_COUNT);
+			assert(sectionData->cubemaps.empty() || sectionData->cubemaps.size() == probesCount);
+
+			section.probesCount = static_cast<UINT>(probesCount);
+			section.countX = sectionData->countX;
+			section.countY = sectionData->countY;
+			section.countZ = sectionData->countZ;
+			section.distanceBetweenProbes = sectionData->distanceBetweenProbes;
+			section.minBounds[0] = sectionData->minBounds.x;
+			section.minBounds[1] = sectionData->minBounds.y;
+			section.minBounds[2] = sectionData->minBounds.z;
+
+			section.positionsOffset = AppendArray(aOutData, sectionData->positions.data(), probesCount);
+			if (!sectionData->sphericalHarmonics.empty())
+				section.sphericalHarmonicsOffset = AppendArray(aOutData, sectionData->sphericalHarmonics.data(), sectionData->sphericalHarmonics.size());
+
+			if (!sectionData->cubemaps.empty())
+			{
+				std::vector<ER_LightProbesVolumeCubemap> cubemaps(probesCount);
+				UINT64 blobSize = 0;
+				for (size_t i = 0; i < probesCount; i++)
+				{
+					cubemaps[i].offset = blobSize;
+					cubemaps[i].size = static_cast<UINT64>(sectionData->cubemaps[i].size());
+					blobSize += (cubemaps[i].size + 15) & ~15ull;
+				}
+				section.cubemapsIndexOffset = AppendArray(aOutData, cubemaps.data(), probesCount);
+
+				section.cubemapsBlobOffset = AppendArray<char>(aOutData, nullptr, 0);
+				section.cubemapsBlobSize = blobSize;
+				aOutData.resize(static_cast<size_t>(section.cubemapsBlobOffset + blobSize), 0);
+				for (size_t i = 0; i < probesCount; i++)
+				{
+					if (cubemaps[i].size)
+						memcpy(aOutData.data() + section.cubemapsBlobOffset + cubemaps[i].offset, sectionData->cubemaps[i].data(), static_cast<size_t>(cubemaps[i].size));
+				}
+			}
+		}
+
+		memcpy(aOutData.data(), &header, sizeof(ER_LightProbesVolumeHeader));
+	}
+
+	bool ER_LightProbesVolumeFile::WriteToDisk(const std::vector<char>& aData, const std::wstring& aPath)
+	{
+		std::ofstream file(aPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(aData.data(), aData.size());
+		return file.good();
+	}
+
+	bool ER_LightProbesVolumeFile::Open(const std::wstring& aPath)
+	{
+		Close();
+
+		mFile = CreateFileW(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ER_LightProbesVolumeHeader)))
+		{
+			Close();
+			return false;
+		}
+
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMapping)
+		{
+			Close();
+			return false;
+		}
+
+		mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!mData || !Validate(static_cast<UINT64>(fileSize.QuadPart)))
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ER_LightProbesVolumeFile::Validate(UINT64 aSize)
+	{
+		mHeader = reinterpret_cast<const ER_LightProbesVolumeHeader*>(mData);
+		if (mHeader->magic != ER_LIGHT_PROBES_VOLUME_MAGIC || mHeader->version != ER_LIGHT_PROBES_VOLUME_VERSION ||
+			mHeader->sphericalHarmonicsCoefficientsCount != SPHERICAL_HARMONICS_COEF_COUNT)
+			return false;
+
+		for (int type = 0; type < ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT; type++)
+		{
+			const ER_LightProbesVolumeSection& section = mHeader->sections[type];
+			if (!section.probesCount)
+				continue;
+
+			if (section.positionsOffset + section.probesCount * sizeof(XMFLOAT3) > aSize ||
+				(section.sphericalHarmonicsOffset && section.sphericalHarmonicsOffset + section.probesCount * SPHERICAL_HARMONICS_COEF_COUNT * sizeof(XMFLOAT3) > aSize) ||
+				(section.cubemapsIndexOffset && section.cubemapsIndexOffset + section.probesCount * sizeof(ER_LightProbesVolumeCubemap) > aSize) ||
+				section.cubemapsBlobOffset + section.cubemapsBlobSize > aSize)
+				return false;
+
+			if (section.cubemapsIndexOffset)
+			{
+				const ER_LightProbesVolumeCubemap* cubemaps = reinterpret_cast<const ER_LightProbesVolumeCubemap*>(mData + section.cubemapsIndexOffset);
+				for (UINT i = 0; i < section.probesCount; i++)
+				{
+					if (cubemaps[i].offset + cubemaps[i].size > section.cubemapsBlobSize)
+						return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void ER_LightProbesVolumeFile::Close()
+	{
+		if (mMapping && mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = nullptr;
+		mData = nullptr;
+		mHeader = nullptr;
+	}
+
+	const ER_LightProbesVolumeSection* ER_LightProbesVolumeFile::GetSection(UINT aType) const
+	{
+		if (!mHeader || aType >= ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT || !mHeader->sections[aType].probesCount)
+			return nullptr;
+		return &mHeader->sections[aType];
+	}
+
+	bool ER_LightProbesVolumeFile::IsMatchingGrid(UINT aType, UINT aProbesCount, int aCountX, int aCountY, int aCountZ, float aDistanceBetweenProbes, const XMFLOAT3& aMinBounds) const
+	{
+		const ER_LightProbesVolumeSection* section = GetSection(aType);
+		if (!section)
+			return false;
+
+		return section->probesCount == aProbesCount &&
+			section->countX == aCountX && section->countY == aCountY && section->countZ == aCountZ &&
+			section->distanceBetweenProbes == aDistanceBetweenProbes &&
+			section->minBounds[0] == aMinBounds.x && section->minBounds[1] == aMinBounds.y && section->minBounds[2] == aMinBounds.z;
+	}
+
+	bool ER_LightProbesVolumeFile::IsMatchingPosition(UINT aType, UINT aProbeIndex, const XMFLOAT3& aPosition) const
+	{
+		const ER_LightProbesVolumeSection* section = GetSection(aType);
+		if (!section || aProbeIndex >= section->probesCount)
+			return false;
+
+		const float epsilon = 0.01f;
+		const XMFLOAT3& position = reinterpret_cast<const XMFLOAT3*>(mData + section->positionsOffset)[aProbeIndex];
+		return fabs(aPosition.x - position.x) <= epsilon && fabs(aPosition.y - position.y) <= epsilon && fabs(aPosition.z - position.z) <= epsilon;
+	}
+
+	UINT ER_LightProbesVolumeFile::GetProbesCount(UINT aType) const
+	{
+		const ER_LightProbesVolumeSection* section = GetSection(aType);
+		return section ? section->probesCount : 0;
+	}
+
+	const XMFLOAT3* ER_LightProbesVolumeFile::GetPositions(UINT aType) const
+	{
+		const ER_LightProbesVolumeSection* section = GetSection(aType);
+		return section ? reinterpret_cast<const XMFLOAT3*>(mData + section->positionsOffset) : nullptr;
+	}
+
+	const XMFLOAT3* ER_LightProbesVolumeFile::GetSphericalHarmonics(UINT aType) const
+	{
+		const ER_LightProbesVolumeSection* section = GetSection(aType);
+		if (!section || !section->sphericalHarmonicsOffset)
+			return nullptr;
+		return reinterpret_cast<const XMFLOAT3*>(mData + section->sphericalHarmonicsOffset);
+	}
+
+	const char* ER_LightProbesVolumeFile::GetCubemap(UINT aType, UINT aProbeIndex, UINT64& aOutSize) const
+	{
+		aOutSize = 0;
+		const ER_LightProbesVolumeSection* section = GetSection(aType);
+		if (!section || !section->cubemapsIndexOffset || aProbeIndex >= section->probesCount)
+			return nullptr;
+
+		const ER_LightProbesVolumeCubemap& cubemap = reinterpret_cast<const ER_LightProbesVolumeCubemap*>(mData + section->cubemapsIndexOffset)[aProbeIndex];
+		if (!cubemap.size)
+			return nullptr;
+
+		aOutSize = cubemap.size;
+		return mData + section->cubemapsBlobOffset + cubemap.offset;
+	}
+
+	bool ER_LightProbesVolumeFile::ReadLegacySphericalHarmonics(const std::wstring& aPath, XMFLOAT3* aOutCoefficients)
+	{
+		FILE* shFile = _wfopen(aPath.c_str(), L"r");
+		if (!shFile)
+			return false;
+
+		float coefficients[3][SPHERICAL_HARMONICS_COEF_COUNT] =
+		{
+			{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+			{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+			{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }
+		};
+		int channel = 0;
+		char line[256];
+		char channelSymbol;
+		while (fgets(line, sizeof(line), shFile))
+		{
+			if (channel == 3)
+				break;
+
+			if (line[0] == 'r' || line[0] == 'g' || line[0] == 'b')
+			{
+				sscanf(line, "%c %f %f %f %f %f %f %f %f %f", &channelSymbol,
+					&coefficients[channel][0], &coefficients[channel][1], &coefficients[channel][2],
+					&coefficients[channel][3], &coefficients[channel][4], &coefficients[channel][5],
+					&coefficients[channel][6], &coefficients[channel][7], &coefficients[channel][8]
+				);
+			}
+			else
+			{
+				std::wstring message = L"[ER Logger][ER_LightProbesVolumeFile] Corrupt probe's spherical harmonics file: " + aPath + L". Loading empty coefficients... \n";
+				ER_OUTPUT_LOG(message.c_str());
+				memset(coefficients, 0, sizeof(coefficients));
+				break;
+			}
+			channel++;
+		}
+		fclose(shFile);
+
+		for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+			aOutCoefficients[i] = XMFLOAT3(coefficients[0][i], coefficients[1][i], coefficients[2][i]);
+
+		return true;
+	}
+
+	bool ER_LightProbesVolumeFile::ReadFileToMemory(const std::wstring& aPath, std::vector<char>& aOutData)
+	{
+		aOutData.clear();
+
+		std::ifstream file(aPath.c_str(), std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+
+		const std::streamoff size = file.tellg();
+		if (size <= 0)
+			return false;
+
+		aOutData.resize(static_cast<size_t>(size));
+		file.seekg(0, std::ios::beg);
+		file.read(aOutData.data(), size);
+		if (!file.good())
+		{
+			aOutData.clear();
+			return false;
+		}
+		return true;
+	}
+
+	bool ER_LightProbesVolumeFile::RunTests()
+	{
+		bool isPassed = true;
+
+		wchar_t tempDirectory[MAX_PATH];
+		if (!GetTempPathW(MAX_PATH, tempDirectory))
+			return false;
+		const std::wstring path = std::wstring(tempDirectory) + L"ER_LightProbesVolumeFileTests.erprobes";
+
+		// diffuse: 3x2x2 grid with SH, specular: 2x1x2 grid with cubemaps of different sizes (one missing)
+		ER_LightProbesVolumeSectionData sectionsData[ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT];
+		const int counts[ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT][3] = { { 3, 2, 2 }, { 2, 1, 2 } };
+		for (int type = 0; type < ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT; type++)
+		{
+			ER_LightProbesVolumeSectionData& data = sectionsData[type];
+			data.countX = counts[type][0];
+			data.countY = counts[type][1];
+			data.countZ = counts[type][2];
+			data.distanceBetweenProbes = type == 0 ? 2.5f : 7.0f;
+			data.minBounds = XMFLOAT3(-10.0f, 1.0f, -4.0f);
+
+			for (int z = 0; z < data.countZ; z++)
+				for (int y = 0; y < data.countY; y++)
+					for (int x = 0; x < data.countX; x++)
+					{
+						const float distance = data.distanceBetweenProbes;
+						data.positions.push_back(XMFLOAT3(data.minBounds.x + x * distance, data.minBounds.y + y * distance + 0.1f * x, data.minBounds.z + z * distance));
+					}
+
+			const UINT probesCount = static_cast<UINT>(data.positions.size());
+			if (type == 0)
+			{
+				for (UINT i = 0; i < probesCount * SPHERICAL_HARMONICS_COEF_COUNT; i++)
+					data.sphericalHarmonics.push_back(XMFLOAT3(0.01f * i, -0.5f * i, 1.0f / (i + 1)));
+			}
+			else
+			{
+				data.cubemaps.resize(probesCount);
+				for (UINT i = 0; i < probesCount; i++)
+				{
+					if (i == 1)
+						continue;
+					for (UINT byte = 0; byte < 100 + 37 * i; byte++)
+						data.cubemaps[i].push_back(static_cast<char>(byte * 7 + i));
+				}
+			}
+		}
+
+		const ER_LightProbesVolumeSectionData* sections[ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT] = { &sectionsData[0], &sectionsData[1] };
+		std::vector<char> data;
+		Build(sections, data);
+		isPassed &= WriteToDisk(data, path);
+
+		{
+			ER_LightProbesVolumeFile volumeFile;
+			isPassed &= volumeFile.Open(path);
+			for (UINT type = 0; isPassed && type < ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT; type++)
+			{
+				const ER_LightProbesVolumeSectionData& section = sectionsData[type];
+				const UINT probesCount = static_cast<UINT>(section.positions.size());
+				isPassed &= volumeFile.GetProbesCount(type) == probesCount &&
+					volumeFile.IsMatchingGrid(type, probesCount, section.countX, section.countY, section.countZ, section.distanceBetweenProbes, section.minBounds);
+
+				// files built for another grid are rejected
+				isPassed &= !volumeFile.IsMatchingGrid(type, probesCount - 1, section.countX, section.countY, section.countZ, section.distanceBetweenProbes, section.minBounds) &&
+					!volumeFile.IsMatchingGrid(type, probesCount, section.countX + 1, section.countY, section.countZ, section.distanceBetweenProbes, section.minBounds) &&
+					!volumeFile.IsMatchingGrid(type, probesCount, section.countX, section.countY, section.countZ, section.distanceBetweenProbes * 2.0f, section.minBounds) &&
+					!volumeFile.IsMatchingGrid(type, probesCount, section.countX, section.countY, section.countZ, section.distanceBetweenProbes, XMFLOAT3(section.minBounds.x, 0.0f, section.minBounds.z));
+
+				const XMFLOAT3* positions = volumeFile.GetPositions(type);
+				isPassed &= positions && memcmp(positions, section.positions.data(), probesCount * sizeof(XMFLOAT3)) == 0;
+				for (UINT i = 0; isPassed && i < probesCount; i++)
+				{
+					// moved probes (beyond the tolerance) are rejected
+					const XMFLOAT3& position = section.positions[i];
+					isPassed &= volumeFile.IsMatchingPosition(type, i, position) && volumeFile.IsMatchingPosition(type, i, XMFLOAT3(position.x + 0.005f, position.y, position.z)) &&
+						!volumeFile.IsMatchingPosition(type, i, XMFLOAT3(position.x, position.y + 0.5f, position.z)) &&
+						!volumeFile.IsMatchingPosition(type, (i + 1) % probesCount, position);
+				}
+				isPassed &= !volumeFile.IsMatchingPosition(type, probesCount, section.positions[0]);
+
+				const XMFLOAT3* sh = volumeFile.GetSphericalHarmonics(type);
+				isPassed &= section.sphericalHarmonics.empty() ? !sh :
+					sh && memcmp(sh, section.sphericalHarmonics.data(), section.sphericalHarmonics.size() * sizeof(XMFLOAT3)) == 0;
+
+				for (UINT i = 0; isPassed && i < probesCount; i++)
+				{
+					UINT64 size = 0;
+					const char* cubemap = volumeFile.GetCubemap(type, i, size);
+					if (section.cubemaps.empty() || section.cubemaps[i].empty())
+						isPassed &= !cubemap && size == 0;
+					else
+						isPassed &= cubemap && size == section.cubemaps[i].size() && memcmp(cubemap, section.cubemaps[i].data(), static_cast<size_t>(size)) == 0;
+				}
+			}
+		}
+
+		// corrupt or outdated files are not opened
+		auto isOpening = [&path](const std::vector<char>& aData)
+		{
+			ER_LightProbesVolumeFile volumeFile;
+			return WriteToDisk(aData, path) && volumeFile.Open(path);
+		};
+		{
+			std::vector<char> corruptData = data;
+			reinterpret_cast<ER_LightProbesVolumeHeader*>(corruptData.data())->version = ER_LIGHT_PROBES_VOLUME_VERSION + 1;
+			isPassed &= !isOpening(corruptData);
+
+			corruptData = data;
+			reinterpret_cast<ER_LightProbesVolumeHeader*>(corruptData.data())->magic = 0;
+			isPassed &= !isOpening(corruptData);
+
+			corruptData.assign(data.begin(), data.end() - 16); // truncated cubemaps blob
+			isPassed &= !isOpening(corruptData);
+
+			corruptData.assign(data.begin(), data.begin() + sizeof(ER_LightProbesVolumeHeader) - 1);
+			isPassed &= !isOpening(corruptData);
+
+			isPassed &= isOpening(data);
+		}
+
+		DeleteFileW(path.c_str());
+
+		std::wstring msg = L"[ER Logger][ER_LightProbesVolumeFile] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_LightProbesVolumeFile::BenchmarkLoad(const std::wstring& aVolumePath, const std::vector<std::wstring>& aLegacySphericalHarmonicsPaths, const std::vector<std::wstring>& aLegacyCubemapsPaths)
+	{
+		double legacyTime = 0.0;
+		double volumeTime = 0.0;
+		UINT legacyFilesCount = 0;
+		float checksum = 0.0f;
+		UINT64 bytesTouched = 0;
+
+		// legacy: one open + text parse per diffuse probe, one file read per specular probe
+		{
+			auto startTimer = std::chrono::high_resolution_clock::now();
+
+			XMFLOAT3 coefficients[SPHERICAL_HARMONICS_COEF_COUNT];
+			for (const std::wstring& path : aLegacySphericalHarmonicsPaths)
+			{
+				if (ReadLegacySphericalHarmonics(path, coefficients))
+				{
+					checksum += coefficients[0].x;
+					legacyFilesCount++;
+				}
+			}
+
+			std::vector<char> cubemap;
+			for (const std::wstring& path : aLegacyCubemapsPaths)
+			{
+				if (ReadFileToMemory(path, cubemap))
+				{
+					bytesTouched += cubemap.size();
+					legacyFilesCount++;
+				}
+			}
+
+			std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTimer;
+			legacyTime = time.count();
+		}
+
+		// volume file: one mapping, walk all SH and touch every page of the cubemaps (as creating textures from them would)
+		UINT probesCount = 0;
+		{
+			auto startTimer = std::chrono::high_resolution_clock::now();
+
+			ER_LightProbesVolumeFile volumeFile;
+			if (!volumeFile.Open(aVolumePath))
+			{
+				ER_OUTPUT_LOG(L"[ER Logger][ER_LightProbesVolumeFile] Load benchmark skipped: could not open the probes volume file\n");
+				return;
+			}
+
+			for (UINT type = 0; type < ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT; type++)
+			{
+				const UINT count = volumeFile.GetProbesCount(type);
+				probesCount += count;
+
+				const XMFLOAT3* sh = volumeFile.GetSphericalHarmonics(type);
+				if (sh)
+				{
+					for (UINT i = 0; i < count * SPHERICAL_HARMONICS_COEF_COUNT; i++)
+						checksum += sh[i].x;
+				}
+
+				for (UINT i = 0; i < count; i++)
+				{
+					UINT64 size = 0;
+					const char* cubemap = volumeFile.GetCubemap(type, i, size);
+					for (UINT64 offset = 0; offset < size; offset += 4096)
+						bytesTouched += static_cast<unsigned char>(cubemap[offset]);
+				}
+			}
+
+			std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTimer;
+			volumeTime = time.count();
+		}
+
+		// keep the loops from being optimized away
+		if (checksum == 0.12345f && bytesTouched == 0)
+			ER_OUTPUT_LOG(L"");
+
+		std::string message = "[ER Logger][ER_LightProbesVolumeFile] Load benchmark (" + std::to_string(probesCount) + " probes): legacy " + std::to_string(legacyFilesCount) + " files " +
+			std::to_string(legacyTime * 1000.0) + "ms, volume file " + std::to_string(volumeTime * 1000.0) + "ms\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Common.h"
+
+#define ER_LIGHT_PROBES_VOLUME_MAGIC 0x56505245 // "ERPV"
+#define ER_LIGHT_PROBES_VOLUME_VERSION 1
+#define ER_LIGHT_PROBES_VOLUME_FILE_NAME L"light_probes.erprobes"
+#define ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT 2 // one per ER_ProbeType
+
+namespace EveryRay_Core
+{
+	// All structs below are stored in the file as is (POD, fixed size).
+	// Probes of a section are stored in the same order as in ER_LightProbesManager (by index), not by their position.
+	struct ER_LightProbesVolumeSection
+	{
+		UINT probesCount; // 0 - no probes of this type in the file
+		int countX;
+		int countY;
+		int countZ;
+		float distanceBetweenProbes;
+		float minBounds[3];
+
+		UINT64 positionsOffset; // float3 per probe
+		UINT64 sphericalHarmonicsOffset; // SPHERICAL_HARMONICS_COEF_COUNT float3 (RGB) per probe, diffuse probes only
+		UINT64 cubemapsIndexOffset; // ER_LightProbesVolumeCubemap per probe, specular probes only
+		UINT64 cubemapsBlobOffset; // packed DDS files
+		UINT64 cubemapsBlobSize;
+	};
+
+	struct ER_LightProbesVolumeCubemap
+	{
+		UINT64 offset; // from the start of the cubemaps blob
+		UINT64 size; // 0 - missing
+	};
+
+	struct ER_LightProbesVolumeHeader
+	{
+		UINT magic;
+		UINT version;
+		UINT sphericalHarmonicsCoefficientsCount;
+		UINT padding;
+
+		ER_LightProbesVolumeSection sections[ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT];
+	};
+
+	// CPU data of one probe type for building a volume file
+	struct ER_LightProbesVolumeSectionData
+	{
+		int countX = 0;
+		int countY = 0;
+		int countZ = 0;
+		float distanceBetweenProbes = 0.0f;
+		XMFLOAT3 minBounds = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> sphericalHarmonics; // SPHERICAL_HARMONICS_COEF_COUNT per probe or empty
+		std::vector<std::vector<char>> cubemaps; // DDS file per probe (empty - missing) or empty
+	};
+
+	// Single versioned file with all local light probes of a level: grid dimensions, positions and SH of all probes as contiguous float arrays
+	// and the specular cubemaps as one blob of packed DDS files with an index.
+	// Replaces the legacy layout (one "*_sh.txt"/"*.dds" file per probe, see ER_LightProbe::GetConstructedProbeName()) which is converted on load.
+	// At runtime the file is memory-mapped and read in place.
+	class ER_LightProbesVolumeFile
+	{
+	public:
+		ER_LightProbesVolumeFile();
+		~ER_LightProbesVolumeFile();
+
+		static std::wstring GetPath(const std::wstring& aLevelPath) { return aLevelPath + ER_LIGHT_PROBES_VOLUME_FILE_NAME; }
+		static void Build(const ER_LightProbesVolumeSectionData* aSections[ER_LIGHT_PROBES_VOLUME_SECTIONS_COUNT], std::vector<char>& aOutData);
+		static bool WriteToDisk(const std::vector<char>& aData, const std::wstring& aPath);
+
+		// Maps the file; fails if it does not exist, has a different version or is corrupt.
+		bool Open(const std::wstring& aPath);
+		void Close();
+		bool IsOpen() const { return mData != nullptr; }
+
+		// Section exists and was built for the same grid of probes
+		bool IsMatchingGrid(UINT aType, UINT aProbesCount, int aCountX, int aCountY, int aCountZ, float aDistanceBetweenProbes, const XMFLOAT3& aMinBounds) const;
+		// Probe did not move since the file was built (i.e., terrain changes when probes are placed on it); call after IsMatchingGrid()
+		bool IsMatchingPosition(UINT aType, UINT aProbeIndex, const XMFLOAT3& aPosition) const;
+		UINT GetProbesCount(UINT aType) const;
+		const XMFLOAT3* GetPositions(UINT aType) const;
+		const XMFLOAT3* GetSphericalHarmonics(UINT aType) const; // nullptr if the section has no SH
+		const char* GetCubemap(UINT aType, UINT aProbeIndex, UINT64& aOutSize) const; // nullptr if missing
+
+		// Legacy "r .../g .../b ..." text file of one diffuse probe; false if the file could not be opened (corrupt files are read as zero coefficients)
+		static bool ReadLegacySphericalHarmonics(const std::wstring& aPath, XMFLOAT3* aOutCoefficients);
+		static bool ReadFileToMemory(const std::wstring& aPath, std::vector<char>& aOutData);
+
+		// Build -> WriteToDisk -> Open round trip of a small synthetic volume and rejection of files built for another grid/probe positions or corrupt ones
+		static bool RunTests();
+		// CPU-only comparison of legacy vs. volume file load times (file reads and SH parsing, no GPU work)
+		static void BenchmarkLoad(const std::wstring& aVolumePath, const std::vector<std::wstring>& aLegacySphericalHarmonicsPaths, const std::vector<std::wstring>& aLegacyCubemapsPaths);
+	private:
+		bool Validate(UINT64 aSize);
+		const ER_LightProbesVolumeSection* GetSection(UINT aType) const;
+
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+
+		const char* mData = nullptr;
+		const ER_LightProbesVolumeHeader* mHeader = nullptr;
+	};
+}
@@ -59,6 +59,10 @@ namespace EveryRay_Core
 		unsigned int mShaderFlags;
 		MaterialShaderEntries mShaderEntries;
 
+		// PSOs of standard materials, derived classes get them from their PSO names in constructors
+		ER_RHI_PSO_HANDLE mPSONonInstanced = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOInstanced = ER_RHI_INVALID_PSO_HANDLE;
+
 		bool mIsStandard = true; // non-standard materials (like shadow map, voxelization, gbuffer, etc.) are processed in their systems (ER_ShadowMapper, ER_Illumination, etc.)
 	};
 }
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include "ER_ModelMaterial.h"
 #include "ER_Core.h"
 #include "ER_CoreException.h"
-#include "ER_VertexDeclarations.h"
+#include "ER_MeshOptimizer.h"
 
 #include "assimp\scene.h"
 
@@ -86,9 +86,9 @@ namespace EveryRay_Core
 		}
 	}
 
-	/*ER_Mesh::ER_Mesh(Model & model, ER_ModelMaterial * material)
+	ER_Mesh::ER_Mesh(ER_Model& model, ER_ModelMaterial& material) : mModel(model), mMaterial(material), mName(), mVertices(), mNormals(), mTangents(), mBiNormals(), mTextureCoordinates(), mVertexColors(), mFaceCount(0), mIndices()
 	{
-	}*/
+	}
 
 	ER_Mesh::~ER_Mesh()
 	{
@@ -109,34 +109,51 @@ namespace EveryRay_Core
 		return mName;
 	}
 
-	const std::vector<XMFLOAT3>& ER_Mesh::Vertices() const
+	ER_Span<XMFLOAT3> ER_Mesh::Vertices() const
+	{
+		return mIsMapped ? mMapped.Vertices : ER_Span<XMFLOAT3>(mVertices);
+	}
+
+	ER_Span<XMFLOAT3> ER_Mesh::Normals() const
+	{
+		return mIsMapped ? mMapped.Normals : ER_Span<XMFLOAT3>(mNormals);
+	}
+
+	ER_Span<XMFLOAT3> ER_Mesh::Tangents() const
+	{
+		return mIsMapped ? mMapped.Tangents : ER_Span<XMFLOAT3>(mTangents);
+	}
+
+	ER_Span<XMFLOAT3> ER_Mesh::BiNormals() const
 	{
-		return mVertices;
+		return mIsMapped ? mMapped.BiNormals : ER_Span<XMFLOAT3>(mBiNormals);
 	}
 
-	const std::vector<XMFLOAT3>& ER_Mesh::Normals() const
+	ER_Span<XMFLOAT3> ER_Mesh::TextureCoordinates(UINT aChannel) const
 	{
-		return mNormals;
+		assert(aChannel < GetUVChannelCount());
+		return mIsMapped ? mMapped.TextureCoordinates[aChannel] : ER_Span<XMFLOAT3>(mTextureCoordinates[aChannel]);
 	}
 
-	const std::vector<XMFLOAT3>& ER_Mesh::Tangents() const
+	ER_Span<XMFLOAT4> ER_Mesh::VertexColors(UINT aChannel) const
 	{
-		return mTangents;
+		assert(aChannel < GetColorChannelCount());
+		return mIsMapped ? mMapped.VertexColors[aChannel] : ER_Span<XMFLOAT4>(mVertexColors[aChannel]);
 	}
 
-	const std::vector<XMFLOAT3>& ER_Mesh::BiNormals() const
+	UINT ER_Mesh::GetUVChannelCount() const
 	{
-		return mBiNormals;
+		return static_cast<UINT>(mIsMapped ? mMapped.TextureCoordinates.size() : mTextureCoordinates.size());
 	}
 
-	const std::vector<std::vector<XMFLOAT3>>& ER_Mesh::TextureCoordinates() const
+	UINT ER_Mesh::GetColorChannelCount() const
 	{
-		return mTextureCoordinates;
+		return static_cast<UINT>(mIsMapped ? mMapped.VertexColors.size() : mVertexColors.size());
 	}
 
-	const std::vector<std::vector<XMFLOAT4>>& ER_Mesh::VertexColors() const
+	UINT ER_Mesh::IndexCount() const
 	{
-		return mVertexColors;
+		return mIsMapped ? mMapped.IndexCount : static_cast<UINT>(mIndices.size());
 	}
 
 	UINT ER_Mesh::FaceCount() const
@@ -144,47 +161,137 @@ namespace EveryRay_Core
 		return mFaceCount;
 	}
 
-	const std::vector<UINT>& ER_Mesh::Indices() const
+	ER_RHI_FORMAT ER_Mesh::GetIndexFormat() const
 	{
-		return mIndices;
+		return Vertices().size() <= 0x10000 ? ER_FORMAT_R16_UINT : ER_FORMAT_R32_UINT;
 	}
 
 	void ER_Mesh::CreateIndexBuffer(ER_RHI_GPUBuffer* indexBuffer) const
 	{
 		assert(indexBuffer);
-		indexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), (void*)(mIndices.data()), static_cast<UINT>(mIndices.size()), sizeof(UINT), false,
-			ER_BIND_INDEX_BUFFER, 0, ER_RHI_RESOURCE_MISC_FLAG::ER_RESOURCE_MISC_NONE, ER_FORMAT_R32_UINT);
+		const ER_RHI_FORMAT format = GetIndexFormat();
+		if (mIsMapped)
+		{
+			// stored in the buffer's format already
+			indexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), const_cast<void*>(mMapped.IndexData), mMapped.IndexCount, format == ER_FORMAT_R16_UINT ? sizeof(USHORT) : sizeof(UINT), false,
+				ER_BIND_INDEX_BUFFER, 0, ER_RHI_RESOURCE_MISC_FLAG::ER_RESOURCE_MISC_NONE, format);
+		}
+		else if (format == ER_FORMAT_R16_UINT)
+		{
+			std::vector<USHORT> indices(mIndices.begin(), mIndices.end());
+			indexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), (void*)(indices.data()), static_cast<UINT>(indices.size()), sizeof(USHORT), false,
+				ER_BIND_INDEX_BUFFER, 0, ER_RHI_RESOURCE_MISC_FLAG::ER_RESOURCE_MISC_NONE, ER_FORMAT_R16_UINT);
+		}
+		else
+			indexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), (void*)(mIndices.data()), static_cast<UINT>(mIndices.size()), sizeof(UINT), false,
+				ER_BIND_INDEX_BUFFER, 0, ER_RHI_RESOURCE_MISC_FLAG::ER_RESOURCE_MISC_NONE, ER_FORMAT_R32_UINT);
 	}
 
-	void ER_Mesh::CreateVertexBuffer_Position(ER_RHI_GPUBuffer* vertexBuffer) const
+	void ER_Mesh::Optimize(ER_MeshCacheStats* aOutStatsBefore, ER_MeshCacheStats* aOutStatsAfter)
 	{
-		const std::vector<XMFLOAT3>& sourceVertices = Vertices();
-		std::vector<VertexPosition> vertices;
-		vertices.reserve(sourceVertices.size());
+		assert(!mIsMapped);
+		UINT vertexCount = static_cast<UINT>(mVertices.size());
 
-		for (UINT i = 0; i < sourceVertices.size(); i++)
+		// only triangle lists (aiProcess_SortByPType splits points and lines into separate meshes)
+		const bool isTriangleList = vertexCount > 0 && mFaceCount > 0 && mIndices.size() == mFaceCount * 3;
+		if (isTriangleList)
 		{
-			XMFLOAT3 position = sourceVertices.at(i);
-			vertices.push_back(VertexPosition(XMFLOAT4(position.x, position.y, position.z, 1.0f)));
+			if (aOutStatsBefore)
+				*aOutStatsBefore = ER_MeshOptimizer::AnalyzeVertexCache(mIndices, vertexCount);
+
+			std::vector<ER_MeshStream> streams;
+			auto addStream = [&streams, vertexCount](const void* data, size_t size, UINT stride)
+			{
+				if (size == vertexCount)
+					streams.push_back({ data, stride });
+			};
+			addStream(mVertices.data(), mVertices.size(), sizeof(XMFLOAT3));
+			addStream(mNormals.data(), mNormals.size(), sizeof(XMFLOAT3));
+			addStream(mTangents.data(), mTangents.size(), sizeof(XMFLOAT3));
+			addStream(mBiNormals.data(), mBiNormals.size(), sizeof(XMFLOAT3));
+			for (const auto& textureCoordinates : mTextureCoordinates)
+				addStream(textureCoordinates.data(), textureCoordinates.size(), sizeof(XMFLOAT3));
+			for (const auto& vertexColors : mVertexColors)
+				addStream(vertexColors.data(), vertexColors.size(), sizeof(XMFLOAT4));
+
+			auto remapStreams = [this](const std::vector<UINT>& remap, UINT newVertexCount)
+			{
+				ER_MeshOptimizer::RemapIndices(mIndices, remap);
+				ER_MeshOptimizer::RemapStream(mVertices, remap, newVertexCount);
+				ER_MeshOptimizer::RemapStream(mNormals, remap, newVertexCount);
+				ER_MeshOptimizer::RemapStream(mTangents, remap, newVertexCount);
+				ER_MeshOptimizer::RemapStream(mBiNormals, remap, newVertexCount);
+				for (auto& textureCoordinates : mTextureCoordinates)
+					ER_MeshOptimizer::RemapStream(textureCoordinates, remap, newVertexCount);
+				for (auto& vertexColors : mVertexColors)
+					ER_MeshOptimizer::RemapStream(vertexColors, remap, newVertexCount);
+			};
+
+			std::vector<UINT> remap;
+			UINT newVertexCount = ER_MeshOptimizer::GenerateWeldRemap(streams, vertexCount, remap);
+			if (newVertexCount < vertexCount)
+			{
+				remapStreams(remap, newVertexCount);
+				vertexCount = newVertexCount;
+			}
+
+			ER_MeshOptimizer::OptimizeVertexCache(mIndices, vertexCount);
+			ER_MeshOptimizer::OptimizeOverdraw(mIndices, mVertices);
+
+			newVertexCount = ER_MeshOptimizer::GenerateVertexFetchRemap(mIndices, vertexCount, remap);
+			remapStreams(remap, newVertexCount);
+			vertexCount = newVertexCount;
+
+			if (aOutStatsAfter)
+				*aOutStatsAfter = ER_MeshOptimizer::AnalyzeVertexCache(mIndices, vertexCount);
 		}
 
+		BuildVertexLayouts();
+	}
+
+	void ER_Mesh::BuildVertexLayouts()
+	{
+		mVerticesPositionUvNormalTangent.clear();
+
+		const size_t vertexCount = mVertices.size();
+		if (vertexCount == 0 || mTextureCoordinates.empty() || mTextureCoordinates[0].size() != vertexCount || mNormals.size() != vertexCount || mTangents.size() != vertexCount)
+			return;
+
+		const std::vector<XMFLOAT3>& textureCoordinates = mTextureCoordinates[0];
+		mVerticesPositionUvNormalTangent.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			VertexPositionTextureNormalTangent& vertex = mVerticesPositionUvNormalTangent[i];
+			vertex.Position = XMFLOAT4(mVertices[i].x, mVertices[i].y, mVertices[i].z, 1.0f);
+			vertex.TextureCoordinates = XMFLOAT2(textureCoordinates[i].x, textureCoordinates[i].y);
+			vertex.Normal = mNormals[i];
+			vertex.Tangent = mTangents[i];
+		}
+	}
+
+	void ER_Mesh::CreateVertexBuffer_Position(ER_RHI_GPUBuffer* vertexBuffer) const
+	{
+		const ER_Span<XMFLOAT3> sourceVertices = Vertices();
+		std::vector<VertexPosition> vertices(sourceVertices.size());
+		for (UINT i = 0; i < sourceVertices.size(); i++)
+			vertices[i].Position = XMFLOAT4(sourceVertices[i].x, sourceVertices[i].y, sourceVertices[i].z, 1.0f);
+
 		assert(vertexBuffer);
 		vertexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), &vertices[0], static_cast<UINT>(vertices.size()), sizeof(VertexPosition), false, ER_BIND_VERTEX_BUFFER);
 	}
 
 	void ER_Mesh::CreateVertexBuffer_PositionUv(ER_RHI_GPUBuffer* vertexBuffer, int uvChannel) const
 	{
-		const std::vector<XMFLOAT3>& sourceVertices = Vertices();
-		const std::vector<XMFLOAT3>& textureCoordinates = mTextureCoordinates[uvChannel];
-		assert(textureCoordinates.size() == sourceVertices.size());
+		const ER_Span<XMFLOAT3> sourceVertices = Vertices();
+		if (uvChannel >= static_cast<int>(GetUVChannelCount()) || TextureCoordinates(uvChannel).size() != sourceVertices.size())
+			throw ER_CoreException("ER_Mesh: Could not create a vertex buffer, mesh has no texture coordinates in the requested channel");
+		const ER_Span<XMFLOAT3> textureCoordinates = TextureCoordinates(uvChannel);
 
-		std::vector<VertexPositionTexture> vertices;
-		vertices.reserve(sourceVertices.size());
+		std::vector<VertexPositionTexture> vertices(sourceVertices.size());
 		for (UINT i = 0; i < sourceVertices.size(); i++)
 		{
-			XMFLOAT3 position = sourceVertices.at(i);
-			XMFLOAT3 uv = textureCoordinates.at(i);
-			vertices.push_back(VertexPositionTexture(XMFLOAT4(position.x, position.y, position.z, 1.0f), XMFLOAT2(uv.x, uv.y)));
+			vertices[i].Position = XMFLOAT4(sourceVertices[i].x, sourceVertices[i].y, sourceVertices[i].z, 1.0f);
+			vertices[i].TextureCoordinates = XMFLOAT2(textureCoordinates[i].x, textureCoordinates[i].y);
 		}
 
 		assert(vertexBuffer);
@@ -193,23 +300,20 @@ namespace EveryRay_Core
 
 	void ER_Mesh::CreateVertexBuffer_PositionUvNormal(ER_RHI_GPUBuffer* vertexBuffer, int uvChannel) const
 	{
-		const std::vector<XMFLOAT3>& sourceVertices = Vertices();
-		const std::vector<XMFLOAT3>& textureCoordinates = mTextureCoordinates[uvChannel];
-		assert(textureCoordinates.size() == sourceVertices.size());
-
-		const std::vector<XMFLOAT3>& normals = Normals();
-		assert(normals.size() == sourceVertices.size());
-
-		std::vector<VertexPositionTextureNormal> vertices;
-		vertices.reserve(sourceVertices.size());
-
+		const ER_Span<XMFLOAT3> sourceVertices = Vertices();
+		if (uvChannel >= static_cast<int>(GetUVChannelCount()) || TextureCoordinates(uvChannel).size() != sourceVertices.size())
+			throw ER_CoreException("ER_Mesh: Could not create a vertex buffer, mesh has no texture coordinates in the requested channel");
+		const ER_Span<XMFLOAT3> normals = Normals();
+		if (normals.size() != sourceVertices.size())
+			throw ER_CoreException("ER_Mesh: Could not create a vertex buffer, mesh has no normals");
+		const ER_Span<XMFLOAT3> textureCoordinates = TextureCoordinates(uvChannel);
+
+		std::vector<VertexPositionTextureNormal> vertices(sourceVertices.size());
 		for (UINT i = 0; i < sourceVertices.size(); i++)
 		{
-			XMFLOAT3 position = sourceVertices.at(i);
-			XMFLOAT3 uv = textureCoordinates.at(i);
-			XMFLOAT3 normal = normals.at(i);
-
-			vertices.push_back(VertexPositionTextureNormal(XMFLOAT4(position.x, position.y, position.z, 1.0f), XMFLOAT2(uv.x, uv.y), normal));
+			vertices[i].Position = XMFLOAT4(sourceVertices[i].x, sourceVertices[i].y, sourceVertices[i].z, 1.0f);
+			vertices[i].TextureCoordinates = XMFLOAT2(textureCoordinates[i].x, textureCoordinates[i].y);
+			vertices[i].Normal = normals[i];
 		}
 
 		assert(vertexBuffer);
@@ -218,30 +322,35 @@ namespace EveryRay_Core
 
 	void ER_Mesh::CreateVertexBuffer_PositionUvNormalTangent(ER_RHI_GPUBuffer* vertexBuffer, int uvChannel) const
 	{
-		const std::vector<XMFLOAT3>& sourceVertices = Vertices();
-		const std::vector<XMFLOAT3>& textureCoordinates = mTextureCoordinates[uvChannel];
-		assert(textureCoordinates.size() == sourceVertices.size());
-
-		const std::vector<XMFLOAT3>& normals = Normals();
-		assert(normals.size() == sourceVertices.size());
+		assert(vertexBuffer);
 
-		const std::vector<XMFLOAT3>& tangents = Tangents();
-		assert(tangents.size() == sourceVertices.size());
+		// already interleaved at import (or in the mapped cache blob)
+		const ER_Span<VertexPositionTextureNormalTangent> interleavedVertices = mIsMapped ? mMapped.VerticesPositionUvNormalTangent : ER_Span<VertexPositionTextureNormalTangent>(mVerticesPositionUvNormalTangent);
+		if (uvChannel == 0 && !interleavedVertices.empty())
+		{
+			vertexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), (void*)interleavedVertices.data(), interleavedVertices.size(),
+				sizeof(VertexPositionTextureNormalTangent), false, ER_BIND_VERTEX_BUFFER);
+			return;
+		}
 
-		std::vector<VertexPositionTextureNormalTangent> vertices;
-		vertices.reserve(sourceVertices.size());
+		const ER_Span<XMFLOAT3> sourceVertices = Vertices();
+		if (uvChannel >= static_cast<int>(GetUVChannelCount()) || TextureCoordinates(uvChannel).size() != sourceVertices.size())
+			throw ER_CoreException("ER_Mesh: Could not create a vertex buffer, mesh has no texture coordinates in the requested channel");
+		const ER_Span<XMFLOAT3> normals = Normals();
+		const ER_Span<XMFLOAT3> tangents = Tangents();
+		if (normals.size() != sourceVertices.size() || tangents.size() != sourceVertices.size())
+			throw ER_CoreException("ER_Mesh: Could not create a vertex buffer, mesh has no normals or tangents");
+		const ER_Span<XMFLOAT3> textureCoordinates = TextureCoordinates(uvChannel);
 
+		std::vector<VertexPositionTextureNormalTangent> vertices(sourceVertices.size());
 		for (UINT i = 0; i < sourceVertices.size(); i++)
 		{
-			XMFLOAT3 position = sourceVertices.at(i);
-			XMFLOAT3 uv = textureCoordinates.at(i);
-			XMFLOAT3 normal = normals.at(i);
-			XMFLOAT3 tangent = tangents.at(i);
-
-			vertices.push_back(VertexPositionTextureNormalTangent(XMFLOAT4(position.x, position.y, position.z, 1.0f), XMFLOAT2(uv.x, uv.y), normal, tangent));
+			vertices[i].Position = XMFLOAT4(sourceVertices[i].x, sourceVertices[i].y, sourceVertices[i].z, 1.0f);
+			vertices[i].TextureCoordinates = XMFLOAT2(textureCoordinates[i].x, textureCoordinates[i].y);
+			vertices[i].Normal = normals[i];
+			vertices[i].Tangent = tangents[i];
 		}
 
-		assert(vertexBuffer);
 		vertexBuffer->CreateGPUBufferResource(mModel.GetCore().GetRHI(), &vertices[0], static_cast<UINT>(vertices.size()), sizeof(VertexPositionTextureNormalTangent), false, ER_BIND_VERTEX_BUFFER);
 	}
-}
\ No newline at end of file
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Common.h"
+#include "ER_Span.h"
 #include "RHI/ER_RHI.h"
+#include "ER_VertexDeclarations.h"
 
 struct aiMesh;
 
@@ -9,26 +11,32 @@ namespace EveryRay_Core
 {
 	class ER_Model;
 	class ER_ModelMaterial;
+	struct ER_MeshCacheStats;
 
 	class ER_Mesh
 	{
 	public:
 		ER_Mesh(ER_Model& model, ER_ModelMaterial& material, aiMesh& mesh);
+		ER_Mesh(ER_Model& model, ER_ModelMaterial& material); // empty mesh, filled by ER_MeshCache (its streams point into the mapped cache blob)
 		~ER_Mesh();
 
 		ER_Model& GetModel();
 		const ER_ModelMaterial& GetMaterial() const;
 		const std::string& Name() const;
 
-		const std::vector<XMFLOAT3>& Vertices() const;
-		const std::vector<XMFLOAT3>& Normals() const;
-		const std::vector<XMFLOAT3>& Tangents() const;
-		const std::vector<XMFLOAT3>& BiNormals() const;
-		const std::vector<std::vector<XMFLOAT3>>& TextureCoordinates() const;
-		const std::vector<std::vector<XMFLOAT4>>& VertexColors() const;
-		const std::vector<UINT>& Indices() const;
+		// Views of the mesh's own streams or of the mapped ER_MeshCache blob: valid as long as the model is
+		ER_Span<XMFLOAT3> Vertices() const;
+		ER_Span<XMFLOAT3> Normals() const;
+		ER_Span<XMFLOAT3> Tangents() const;
+		ER_Span<XMFLOAT3> BiNormals() const;
+		ER_Span<XMFLOAT3> TextureCoordinates(UINT aChannel) const;
+		ER_Span<XMFLOAT4> VertexColors(UINT aChannel) const;
+		UINT GetUVChannelCount() const;
+		UINT GetColorChannelCount() const;
+		UINT IndexCount() const;
 		UINT FaceCount() const;
 
+		// 16-bit indices (ER_FORMAT_R16_UINT) for meshes with up to 65536 vertices, 32-bit otherwise
 		void CreateIndexBuffer(ER_RHI_GPUBuffer* indexBuffer) const;
 
 		void CreateVertexBuffer_Position(ER_RHI_GPUBuffer* vertexBuffer) const;
@@ -36,7 +44,29 @@ namespace EveryRay_Core
 		void CreateVertexBuffer_PositionUvNormal(ER_RHI_GPUBuffer* vertexBuffer, int uvChannel = 0) const;
 		void CreateVertexBuffer_PositionUvNormalTangent(ER_RHI_GPUBuffer* vertexBuffer, int uvChannel = 0) const;
 
+		// Import-time: welds duplicate vertices, reorders indices (vertex cache, overdraw) and vertices (fetch locality), then builds the vertex layouts.
+		// Optionally returns the post-transform cache stats of the mesh before and after.
+		void Optimize(ER_MeshCacheStats* aOutStatsBefore = nullptr, ER_MeshCacheStats* aOutStatsAfter = nullptr);
 	private:
+		friend class ER_MeshCache;
+
+		// Streams of a mesh loaded from ER_MeshCache: the blob stays mapped by the model and the vectors below stay empty
+		struct MappedStreams
+		{
+			ER_Span<XMFLOAT3> Vertices;
+			ER_Span<XMFLOAT3> Normals;
+			ER_Span<XMFLOAT3> Tangents;
+			ER_Span<XMFLOAT3> BiNormals;
+			std::vector<ER_Span<XMFLOAT3>> TextureCoordinates;
+			std::vector<ER_Span<XMFLOAT4>> VertexColors;
+			ER_Span<VertexPositionTextureNormalTangent> VerticesPositionUvNormalTangent;
+			const void* IndexData = nullptr; // already in the format of the index buffer (see GetIndexFormat())
+			UINT IndexCount = 0;
+		};
+
+		void BuildVertexLayouts();
+		ER_RHI_FORMAT GetIndexFormat() const;
+
 		ER_Model& mModel;
 		ER_ModelMaterial& mMaterial;
 		std::string mName;
@@ -48,5 +78,10 @@ namespace EveryRay_Core
 		std::vector<std::vector<XMFLOAT4>> mVertexColors;
 		UINT mFaceCount;
 		std::vector<UINT> mIndices;
+
+		std::vector<VertexPositionTextureNormalTangent> mVerticesPositionUvNormalTangent; // interleaved once (uv channel 0), most of the materials use it
+
+		MappedStreams mMapped;
+		bool mIsMapped = false;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,630 @@
+#include "ER_MeshCache.h"
+#include "ER_Mesh.h"
+#include "ER_Model.h"
+#include "ER_ModelMaterial.h"
+#include "ER_Core.h"
+#include "ER_Utility.h"
+
+#include <iomanip>
+#include <algorithm>
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		class ER_MeshCacheWriter
+		{
+		public:
+			template<typename T>
+			void Write(const T& aValue)
+			{
+				const char* bytes = reinterpret_cast<const char*>(&aValue);
+				mData.insert(mData.end(), bytes, bytes + sizeof(T));
+			}
+
+			// streams start aligned, so that they can be read in place from the mapped blob
+			template<typename T>
+			void WriteStream(const std::vector<T>& aValues)
+			{
+				mData.resize(ER_BitmaskAlign(static_cast<UINT>(mData.size()), ER_MESH_CACHE_STREAM_ALIGNMENT), 0);
+				if (aValues.empty())
+					return;
+				const char* bytes = reinterpret_cast<const char*>(aValues.data());
+				mData.insert(mData.end(), bytes, bytes + aValues.size() * sizeof(T));
+			}
+
+			template<typename CharType>
+			void WriteString(const std::basic_string<CharType>& aString)
+			{
+				Write(static_cast<UINT>(aString.length()));
+				const char* bytes = reinterpret_cast<const char*>(aString.data());
+				mData.insert(mData.end(), bytes, bytes + aString.length() * sizeof(CharType));
+			}
+
+			std::vector<char> mData;
+		};
+
+		// Reads the blob sequentially and fails (instead of reading out of bounds) on truncated/corrupted files
+		class ER_MeshCacheReader
+		{
+		public:
+			ER_MeshCacheReader(const char* aData, size_t aSize) : mData(aData), mSize(aSize) {}
+
+			template<typename T>
+			bool Read(T& aOutValue)
+			{
+				return ReadBytes(&aOutValue, sizeof(T));
+			}
+
+			// see ER_MeshCacheWriter::WriteStream()
+			template<typename T>
+			bool ReadStream(ER_Span<T>& aOutValues, UINT aCount)
+			{
+				const void* data = nullptr;
+				if (!ReadStreamBytes(data, static_cast<UINT64>(aCount) * sizeof(T)))
+					return false;
+				aOutValues = ER_Span<T>(static_cast<const T*>(data), aCount);
+				return true;
+			}
+
+			bool ReadStreamBytes(const void*& aOutData, UINT64 aByteCount)
+			{
+				const size_t offset = (mOffset + ER_MESH_CACHE_STREAM_ALIGNMENT - 1) & ~static_cast<size_t>(ER_MESH_CACHE_STREAM_ALIGNMENT - 1);
+				if (offset > mSize || aByteCount > mSize - offset)
+					return false;
+				aOutData = mData + offset;
+				mOffset = offset + static_cast<size_t>(aByteCount);
+				return true;
+			}
+
+			template<typename CharType>
+			bool ReadString(std::basic_string<CharType>& aOutString)
+			{
+				UINT length = 0;
+				return Read(length) && ReadString(aOutString, length);
+			}
+
+			template<typename CharType>
+			bool ReadString(std::basic_string<CharType>& aOutString, UINT aLength)
+			{
+				if (static_cast<UINT64>(aLength) * sizeof(CharType) > mSize - mOffset)
+					return false;
+				aOutString.assign(reinterpret_cast<const CharType*>(mData + mOffset), aLength);
+				mOffset += aLength * sizeof(CharType);
+				return true;
+			}
+		private:
+			bool ReadBytes(void* aOut, size_t aByteCount)
+			{
+				if (aByteCount > mSize - mOffset)
+					return false;
+				memcpy(aOut, mData + mOffset, aByteCount);
+				mOffset += aByteCount;
+				return true;
+			}
+
+			const char* mData;
+			size_t mSize;
+			size_t mOffset = 0;
+		};
+
+		struct ER_MeshCacheMeshInfo
+		{
+			UINT materialIndex;
+			UINT vertexCount;
+			UINT faceCount;
+			UINT indexCount;
+			UINT hasNormals;
+			UINT hasTangentsAndBiNormals;
+			UINT uvChannelCount;
+			UINT colorChannelCount;
+			UINT hasInterleavedVertices; // VertexPositionTextureNormalTangent (uv channel 0)
+		};
+
+		// FNV-1a over 64-bit words (and the remaining bytes) with a final avalanche
+		UINT64 HashBytes(const char* aData, size_t aSize)
+		{
+			const UINT64 prime = 0x100000001b3ull;
+			UINT64 hash = 0xcbf29ce484222325ull ^ aSize;
+
+			size_t offset = 0;
+			for (; offset + sizeof(UINT64) <= aSize; offset += sizeof(UINT64))
+			{
+				UINT64 word;
+				memcpy(&word, aData + offset, sizeof(UINT64));
+				hash = (hash ^ word) * prime;
+			}
+			for (; offset < aSize; offset++)
+				hash = (hash ^ static_cast<unsigned char>(aData[offset])) * prime;
+
+			hash ^= hash >> 33;
+			hash *= 0xff51afd7ed558ccdull;
+			hash ^= hash >> 33;
+			hash *= 0xc4ceb9fe1a85ec53ull;
+			hash ^= hash >> 33;
+			return hash;
+		}
+
+		bool IsModelFile(const std::string& aFileName)
+		{
+			const size_t dot = aFileName.rfind('.');
+			if (dot == std::string::npos)
+				return false;
+
+			std::string extension = aFileName.substr(dot + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			return extension == "fbx" || extension == "obj" || extension == "gltf" || extension == "glb" || extension == "dae" || extension == "3ds";
+		}
+
+		template<typename T>
+		bool IsSameStream(const ER_Span<T>& aStream, const ER_Span<T>& aOtherStream)
+		{
+			return aStream.size() == aOtherStream.size() && (aStream.empty() || memcmp(aStream.data(), aOtherStream.data(), aStream.size() * sizeof(T)) == 0);
+		}
+
+		bool WriteTextFile(const std::string& aPath, const std::string& aText)
+		{
+			std::ofstream file(aPath.c_str(), std::ios::binary | std::ios::trunc);
+			file << aText;
+			return file.good();
+		}
+	}
+
+	void ER_MeshCache::FindModelFiles(const std::string& aDirectory, std::vector<std::string>& aOutFiles)
+	{
+		WIN32_FIND_DATAA findData;
+		HANDLE findHandle = FindFirstFileA((aDirectory + "*").c_str(), &findData);
+		if (findHandle == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			const std::string name = findData.cFileName;
+			if (name == "." || name == "..")
+				continue;
+
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				FindModelFiles(aDirectory + name + "\\", aOutFiles);
+			else if (IsModelFile(name))
+				aOutFiles.push_back(aDirectory + name);
+		} while (FindNextFileA(findHandle, &findData));
+
+		FindClose(findHandle);
+	}
+
+	ER_MeshCacheMapping::~ER_MeshCacheMapping()
+	{
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+	}
+
+	bool ER_MeshCacheMapping::Open(const std::string& aPath)
+	{
+		assert(!mData);
+
+		mFile = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+			return false;
+
+		mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMapping)
+			return false;
+
+		mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		mSize = static_cast<size_t>(fileSize.QuadPart);
+		return mData != nullptr;
+	}
+
+	bool ER_MeshCache::GetSourceContentHash(const std::string& aSourcePath, UINT64& aSize, UINT64& aHash)
+	{
+		ER_MeshCacheMapping source;
+		if (!source.Open(aSourcePath))
+			return false;
+
+		aSize = source.GetSize();
+		aHash = HashBytes(source.GetData(), source.GetSize());
+		return true;
+	}
+
+	std::string ER_MeshCache::GetCachePath(const std::string& aSourcePath, UINT aImportFlags)
+	{
+		// one file per source and flags: a changed source overwrites its stale blob
+		const std::string key = aSourcePath + "|" + std::to_string(aImportFlags) + "|" + std::to_string(ER_MESH_CACHE_VERSION);
+		const UINT hash = ER_Utility::FastHash(key.data(), static_cast<int>(key.length()));
+
+		std::string fileName;
+		ER_Utility::GetFileName(aSourcePath, fileName);
+
+		std::stringstream path;
+		path << ER_Utility::GetFilePath(std::string(ER_MESH_CACHE_DIRECTORY)) << fileName << "_" << std::hex << std::setw(8) << std::setfill('0') << hash << ER_MESH_CACHE_EXTENSION;
+		return path.str();
+	}
+
+	bool ER_MeshCache::Save(const std::string& aSourcePath, UINT aImportFlags, const std::vector<ER_ModelMaterial>& aMaterials, const std::vector<ER_Mesh>& aMeshes)
+	{
+		const std::string cachePath = GetCachePath(aSourcePath, aImportFlags);
+
+		ER_MeshCacheHeader header = {};
+		header.magic = ER_MESH_CACHE_MAGIC;
+		header.version = ER_MESH_CACHE_VERSION;
+		if (!GetSourceContentHash(aSourcePath, header.sourceFileSize, header.sourceContentHash))
+			return false;
+		header.importFlags = aImportFlags;
+		header.sourcePathLength = static_cast<UINT>(aSourcePath.length());
+		header.materialCount = static_cast<UINT>(aMaterials.size());
+		header.meshCount = static_cast<UINT>(aMeshes.size());
+
+		ER_MeshCacheWriter writer;
+		writer.Write(header);
+		writer.mData.insert(writer.mData.end(), aSourcePath.begin(), aSourcePath.end());
+
+		for (const ER_ModelMaterial& material : aMaterials)
+		{
+			writer.WriteString(material.Name());
+			writer.Write(static_cast<UINT>(material.Textures().size()));
+			for (const auto& textures : material.Textures())
+			{
+				writer.Write(static_cast<UINT>(textures.first));
+				writer.Write(static_cast<UINT>(textures.second.size()));
+				for (const std::wstring& texturePath : textures.second)
+					writer.WriteString(texturePath);
+			}
+		}
+
+		for (const ER_Mesh& mesh : aMeshes)
+		{
+			assert(!mesh.mIsMapped); // only imported meshes are saved
+
+			UINT materialIndex = 0;
+			for (UINT i = 0; i < aMaterials.size(); i++)
+			{
+				if (&aMaterials[i] == &mesh.GetMaterial())
+					materialIndex = i;
+			}
+
+			ER_MeshCacheMeshInfo info = {};
+			info.materialIndex = materialIndex;
+			info.vertexCount = static_cast<UINT>(mesh.mVertices.size());
+			info.faceCount = mesh.mFaceCount;
+			info.indexCount = static_cast<UINT>(mesh.mIndices.size());
+			info.hasNormals = mesh.mNormals.empty() ? 0 : 1;
+			info.hasTangentsAndBiNormals = mesh.mTangents.empty() ? 0 : 1;
+			info.uvChannelCount = static_cast<UINT>(mesh.mTextureCoordinates.size());
+			info.colorChannelCount = static_cast<UINT>(mesh.mVertexColors.size());
+			info.hasInterleavedVertices = mesh.mVerticesPositionUvNormalTangent.empty() ? 0 : 1;
+
+			writer.WriteString(mesh.mName);
+			writer.Write(info);
+			writer.WriteStream(mesh.mVertices);
+			if (info.hasNormals)
+				writer.WriteStream(mesh.mNormals);
+			if (info.hasTangentsAndBiNormals)
+			{
+				writer.WriteStream(mesh.mTangents);
+				writer.WriteStream(mesh.mBiNormals);
+			}
+			for (const auto& uvs : mesh.mTextureCoordinates)
+				writer.WriteStream(uvs);
+			for (const auto& colors : mesh.mVertexColors)
+				writer.WriteStream(colors);
+			if (info.hasInterleavedVertices)
+				writer.WriteStream(mesh.mVerticesPositionUvNormalTangent);
+
+			// in the format of the index buffer (see ER_Mesh::CreateIndexBuffer())
+			if (mesh.GetIndexFormat() == ER_FORMAT_R16_UINT)
+				writer.WriteStream(std::vector<USHORT>(mesh.mIndices.begin(), mesh.mIndices.end()));
+			else
+				writer.WriteStream(mesh.mIndices);
+		}
+
+		CreateDirectoryA(ER_Utility::GetFilePath(std::string("content\\cache\\")).c_str(), nullptr);
+		CreateDirectoryA(ER_Utility::GetFilePath(std::string(ER_MESH_CACHE_DIRECTORY)).c_str(), nullptr);
+
+		// write to a temp file first, so that other processes/threads never map a partially written blob
+		const std::string tempPath = cachePath + ".tmp" + std::to_string(GetCurrentThreadId());
+		{
+			std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+			file.write(writer.mData.data(), writer.mData.size());
+			if (!file.good())
+				return false;
+		}
+
+		if (!MoveFileExA(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileA(tempPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool ER_MeshCache::Load(ER_Model& aModel, const std::string& aSourcePath, UINT aImportFlags, std::vector<ER_ModelMaterial>& aOutMaterials, std::vector<ER_Mesh>& aOutMeshes,
+		std::unique_ptr<ER_MeshCacheMapping>& aOutMapping)
+	{
+		std::unique_ptr<ER_MeshCacheMapping> mapping(new ER_MeshCacheMapping());
+		if (!mapping->Open(GetCachePath(aSourcePath, aImportFlags)) || mapping->GetSize() < sizeof(ER_MeshCacheHeader))
+			return false;
+
+		UINT64 sourceSize = 0, sourceContentHash = 0;
+		if (!GetSourceContentHash(aSourcePath, sourceSize, sourceContentHash))
+			return false;
+
+		ER_MeshCacheReader reader(mapping->GetData(), mapping->GetSize());
+
+		ER_MeshCacheHeader header;
+		std::string sourcePath;
+		bool isLoaded = reader.Read(header) &&
+			header.magic == ER_MESH_CACHE_MAGIC && header.version == ER_MESH_CACHE_VERSION &&
+			header.sourceFileSize == sourceSize && header.sourceContentHash == sourceContentHash && header.importFlags == aImportFlags &&
+			header.sourcePathLength == aSourcePath.length() &&
+			header.materialCount <= mapping->GetSize() && header.meshCount <= mapping->GetSize();
+
+		if (isLoaded)
+			isLoaded = reader.ReadString(sourcePath, header.sourcePathLength) && sourcePath == aSourcePath;
+
+		// materials must be complete before the meshes are created (meshes keep references to them)
+		aOutMaterials.clear();
+		if (isLoaded)
+			aOutMaterials.reserve(header.materialCount);
+		for (UINT i = 0; isLoaded && i < header.materialCount; i++)
+		{
+			aOutMaterials.push_back(ER_ModelMaterial(aModel));
+			ER_ModelMaterial& material = aOutMaterials.back();
+
+			UINT typeCount = 0;
+			isLoaded = reader.ReadString(material.mName) && reader.Read(typeCount);
+			for (UINT type = 0; isLoaded && type < typeCount; type++)
+			{
+				UINT textureType = 0, textureCount = 0;
+				isLoaded = reader.Read(textureType) && reader.Read(textureCount) && textureType < TextureTypeEnd;
+				if (!isLoaded)
+					break;
+
+				std::vector<std::wstring>& textures = material.mTextures[static_cast<TextureType>(textureType)];
+				textures.resize(textureCount);
+				for (UINT texture = 0; isLoaded && texture < textureCount; texture++)
+					isLoaded = reader.ReadString(textures[texture]);
+			}
+		}
+
+		aOutMeshes.clear();
+		if (isLoaded)
+			aOutMeshes.reserve(header.meshCount);
+		for (UINT i = 0; isLoaded && i < header.meshCount; i++)
+		{
+			std::string name;
+			ER_MeshCacheMeshInfo info;
+			isLoaded = reader.ReadString(name) && reader.Read(info) && info.materialIndex < aOutMaterials.size();
+			if (!isLoaded)
+				break;
+
+			aOutMeshes.emplace_back(aModel, aOutMaterials[info.materialIndex]);
+			ER_Mesh& mesh = aOutMeshes.back();
+			mesh.mName = name;
+			mesh.mFaceCount = info.faceCount;
+			mesh.mIsMapped = true;
+
+			ER_Mesh::MappedStreams& streams = mesh.mMapped;
+			isLoaded = reader.ReadStream(streams.Vertices, info.vertexCount);
+			if (isLoaded && info.hasNormals)
+				isLoaded = reader.ReadStream(streams.Normals, info.vertexCount);
+			if (isLoaded && info.hasTangentsAndBiNormals)
+				isLoaded = reader.ReadStream(streams.Tangents, info.vertexCount) && reader.ReadStream(streams.BiNormals, info.vertexCount);
+
+			streams.TextureCoordinates.resize(info.uvChannelCount);
+			for (UINT channel = 0; isLoaded && channel < info.uvChannelCount; channel++)
+				isLoaded = reader.ReadStream(streams.TextureCoordinates[channel], info.vertexCount);
+
+			streams.VertexColors.resize(info.colorChannelCount);
+			for (UINT channel = 0; isLoaded && channel < info.colorChannelCount; channel++)
+				isLoaded = reader.ReadStream(streams.VertexColors[channel], info.vertexCount);
+
+			if (isLoaded && info.hasInterleavedVertices)
+				isLoaded = reader.ReadStream(streams.VerticesPositionUvNormalTangent, info.vertexCount);
+
+			if (isLoaded)
+			{
+				const UINT indexStride = mesh.GetIndexFormat() == ER_FORMAT_R16_UINT ? sizeof(USHORT) : sizeof(UINT);
+				isLoaded = reader.ReadStreamBytes(streams.IndexData, static_cast<UINT64>(info.indexCount) * indexStride);
+				streams.IndexCount = info.indexCount;
+			}
+		}
+
+		if (!isLoaded)
+		{
+			aOutMeshes.clear();
+			aOutMaterials.clear();
+			return false;
+		}
+
+		aOutMapping = std::move(mapping);
+		return true;
+	}
+
+	bool ER_MeshCache::RunTests(ER_Core& aCore)
+	{
+		bool isPassed = true;
+
+		char tempDirectory[MAX_PATH];
+		if (!GetTempPathA(MAX_PATH, tempDirectory))
+			return false;
+		const std::string objPath = std::string(tempDirectory) + "ER_MeshCacheTests.obj";
+		const std::string mtlPath = std::string(tempDirectory) + "ER_MeshCacheTests.mtl";
+		const UINT flags = ER_Model::GetImportFlags(true);
+		const std::string cachePath = GetCachePath(objPath, flags);
+
+		// 4x4 grid (uvs, normals) split into two meshes with textured materials
+		{
+			std::stringstream obj;
+			obj << "# a generated grid\nmtllib ER_MeshCacheTests.mtl\n";
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+					obj << "v " << x << " " << (x * y) % 3 << " " << y << "\nvt " << x / 3.0f << " " << y / 3.0f << "\nvn 0 1 0\n";
+			}
+			for (int cell = 0; cell < 9; cell++)
+			{
+				if (cell == 0 || cell == 5)
+					obj << "usemtl " << (cell == 0 ? "Stone" : "Wood") << "\n";
+				const int i = (cell / 3) * 4 + cell % 3 + 1;
+				obj << "f " << i << "/" << i << "/" << i << " " << i + 4 << "/" << i + 4 << "/" << i + 4 << " " << i + 1 << "/" << i + 1 << "/" << i + 1 << "\n";
+				obj << "f " << i + 1 << "/" << i + 1 << "/" << i + 1 << " " << i + 4 << "/" << i + 4 << "/" << i + 4 << " " << i + 5 << "/" << i + 5 << "/" << i + 5 << "\n";
+			}
+			if (!WriteTextFile(objPath, obj.str()) ||
+				!WriteTextFile(mtlPath, "newmtl Stone\nmap_Kd stone_albedo.png\nmap_bump stone_normal.png\nnewmtl Wood\nmap_Kd wood_albedo.png\n"))
+				return false;
+		}
+
+		// import (and save), then load the blob
+		DeleteFileA(cachePath.c_str());
+		{
+			ER_Model imported(aCore, objPath, true, true, true);
+			std::vector<ER_ModelMaterial> materials;
+			std::vector<ER_Mesh> meshes;
+			std::unique_ptr<ER_MeshCacheMapping> mapping;
+			isPassed &= imported.IsLoaded() && imported.Meshes().size() == 2 && Load(imported, objPath, flags, materials, meshes, mapping) && mapping;
+
+			isPassed &= materials.size() == imported.Materials().size();
+			for (UINT i = 0; isPassed && i < materials.size(); i++)
+				isPassed &= materials[i].Name() == imported.Materials()[i].Name() && materials[i].Textures() == imported.Materials()[i].Textures();
+
+			bool hasTextures = false;
+			for (const ER_ModelMaterial& material : materials)
+				hasTextures |= material.HasTexturesOfType(TextureTypeDifffuse);
+			isPassed &= hasTextures;
+
+			isPassed &= meshes.size() == imported.Meshes().size();
+			for (UINT i = 0; isPassed && i < meshes.size(); i++)
+			{
+				const ER_Mesh& mesh = meshes[i];
+				const ER_Mesh& importedMesh = imported.Meshes()[i];
+				isPassed &= mesh.mIsMapped && !importedMesh.mIsMapped && mesh.Name() == importedMesh.Name() &&
+					&mesh.GetMaterial() - materials.data() == &importedMesh.GetMaterial() - imported.Materials().data();
+
+				isPassed &= !mesh.Vertices().empty() && IsSameStream(mesh.Vertices(), importedMesh.Vertices()) &&
+					IsSameStream(mesh.Normals(), importedMesh.Normals()) && IsSameStream(mesh.Tangents(), importedMesh.Tangents()) &&
+					IsSameStream(mesh.BiNormals(), importedMesh.BiNormals());
+
+				isPassed &= mesh.GetUVChannelCount() == importedMesh.GetUVChannelCount() && mesh.GetColorChannelCount() == importedMesh.GetColorChannelCount();
+				for (UINT channel = 0; isPassed && channel < mesh.GetUVChannelCount(); channel++)
+					isPassed &= IsSameStream(mesh.TextureCoordinates(channel), importedMesh.TextureCoordinates(channel));
+				for (UINT channel = 0; isPassed && channel < mesh.GetColorChannelCount(); channel++)
+					isPassed &= IsSameStream(mesh.VertexColors(channel), importedMesh.VertexColors(channel));
+				isPassed &= IsSameStream(mesh.mMapped.VerticesPositionUvNormalTangent, ER_Span<VertexPositionTextureNormalTangent>(importedMesh.mVerticesPositionUvNormalTangent));
+
+				isPassed &= mesh.FaceCount() == importedMesh.FaceCount() && mesh.IndexCount() == importedMesh.IndexCount() &&
+					mesh.GetIndexFormat() == importedMesh.GetIndexFormat() && mesh.mMapped.IndexData;
+				for (UINT index = 0; isPassed && index < mesh.IndexCount(); index++)
+				{
+					const UINT cachedIndex = mesh.GetIndexFormat() == ER_FORMAT_R16_UINT ?
+						static_cast<const USHORT*>(mesh.mMapped.IndexData)[index] : static_cast<const UINT*>(mesh.mMapped.IndexData)[index];
+					isPassed &= cachedIndex == importedMesh.mIndices[index];
+				}
+			}
+		}
+
+		// models read the blob instead of running assimp
+		{
+			ER_Model cached(aCore, objPath, true, true, true);
+			isPassed &= cached.IsLoaded() && cached.Meshes().size() == 2 && cached.Meshes()[0].mIsMapped;
+		}
+
+		// the blob is rejected once the version, the source content (same size) or the source size change
+		{
+			ER_Model model(aCore, objPath, true, true, false);
+			std::vector<ER_ModelMaterial> materials;
+			std::vector<ER_Mesh> meshes;
+			std::unique_ptr<ER_MeshCacheMapping> mapping;
+			auto isLoaded = [&]()
+			{
+				const bool result = Load(model, objPath, flags, materials, meshes, mapping);
+				meshes.clear();
+				mapping.reset(); // mapped files can not be overwritten
+				return result;
+			};
+
+			std::vector<char> blob;
+			{
+				std::ifstream file(cachePath.c_str(), std::ios::binary);
+				blob.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+			isPassed &= blob.size() > sizeof(ER_MeshCacheHeader);
+
+			if (isPassed)
+			{
+				std::vector<char> outdatedBlob = blob;
+				reinterpret_cast<ER_MeshCacheHeader*>(outdatedBlob.data())->version = ER_MESH_CACHE_VERSION - 1;
+				isPassed &= WriteTextFile(cachePath, std::string(outdatedBlob.begin(), outdatedBlob.end())) && !isLoaded();
+				isPassed &= WriteTextFile(cachePath, std::string(blob.begin(), blob.end())) && isLoaded();
+			}
+
+			std::string obj;
+			{
+				std::ifstream file(objPath.c_str(), std::ios::binary);
+				obj.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+			isPassed &= obj.size() > 2 && obj[2] == 'a';
+			if (isPassed)
+			{
+				obj[2] = 'b';
+				isPassed &= WriteTextFile(objPath, obj) && !isLoaded();
+				obj[2] = 'a';
+				isPassed &= WriteTextFile(objPath, obj) && isLoaded();
+				isPassed &= WriteTextFile(objPath, obj + "# appended\n") && !isLoaded();
+			}
+		}
+
+		DeleteFileA(cachePath.c_str());
+		DeleteFileA(objPath.c_str());
+		DeleteFileA(mtlPath.c_str());
+
+		std::wstring msg = L"[ER Logger][ER_MeshCache] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_MeshCache::BenchmarkImport(ER_Core& aCore, const std::string& aDirectory)
+	{
+		std::vector<std::string> modelPaths;
+		FindModelFiles(aDirectory, modelPaths);
+
+		double totalColdTime = 0.0;
+		double totalWarmTime = 0.0;
+		for (const std::string& modelPath : modelPaths)
+		{
+			auto startTime = std::chrono::high_resolution_clock::now();
+			ER_Model coldModel(aCore, modelPath, true, true, false);
+			std::chrono::duration<double> coldTime = std::chrono::high_resolution_clock::now() - startTime;
+			if (!coldModel.IsLoaded())
+				continue;
+
+			{
+				ER_Model cachingModel(aCore, modelPath, true, true); // makes sure the cache exists
+			}
+
+			startTime = std::chrono::high_resolution_clock::now();
+			ER_Model warmModel(aCore, modelPath, true, true);
+			std::chrono::duration<double> warmTime = std::chrono::high_resolution_clock::now() - startTime;
+
+			totalColdTime += coldTime.count();
+			totalWarmTime += warmTime.count();
+
+			std::string msg = "[ER Logger][ER_MeshCache] " + modelPath + ": cold (assimp) " + std::to_string(coldTime.count()) + "s, warm (cache) " + std::to_string(warmTime.count()) + "s\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+		}
+
+		std::string msg = "[ER Logger][ER_MeshCache] Total for " + std::to_string(modelPaths.size()) + " models: cold (assimp) " + std::to_string(totalColdTime) +
+			"s, warm (cache) " + std::to_string(totalWarmTime) + "s\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+	}
+}
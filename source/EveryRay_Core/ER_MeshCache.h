@@ -0,0 +1,70 @@
+#pragma once
+#include "Common.h"
+
+#define ER_MESH_CACHE_MAGIC 0x434D5245 // "ERMC"
+#define ER_MESH_CACHE_VERSION 3 // 2: meshes are stored optimized (welded, reordered for vertex cache/overdraw/fetch), 3: content hash, aligned streams read in place, interleaved vertices and indices in the GPU format
+#define ER_MESH_CACHE_STREAM_ALIGNMENT 16
+#define ER_MESH_CACHE_EXTENSION ".ermesh"
+#define ER_MESH_CACHE_DIRECTORY "content\\cache\\models\\"
+
+namespace EveryRay_Core
+{
+	class ER_Core;
+	class ER_Mesh;
+	class ER_ModelMaterial;
+	class ER_Model;
+
+	struct ER_MeshCacheHeader
+	{
+		UINT magic;
+		UINT version;
+		UINT64 sourceFileSize;
+		UINT64 sourceContentHash; // of the source model file's bytes
+		UINT importFlags; // assimp post-processing flags
+		UINT sourcePathLength; // the path itself follows the header (to reject hash collisions)
+		UINT materialCount;
+		UINT meshCount;
+	};
+
+	// Read-only file mapping (a cache blob or a source model file)
+	class ER_MeshCacheMapping
+	{
+	public:
+		ER_MeshCacheMapping() {}
+		~ER_MeshCacheMapping();
+
+		bool Open(const std::string& aPath);
+		const char* GetData() const { return mData; }
+		size_t GetSize() const { return mSize; }
+	private:
+		ER_MeshCacheMapping(const ER_MeshCacheMapping& rhs);
+		ER_MeshCacheMapping& operator=(const ER_MeshCacheMapping& rhs);
+
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+		const char* mData = nullptr;
+		size_t mSize = 0;
+	};
+
+	// Persistent cache of already imported (post-processed by assimp) models: one flat binary blob per model, named after the hash of source path and import flags
+	// and valid as long as the source file has the same size and content hash.
+	// Blob layout: header, source path, materials (name + texture paths per type), meshes (name, material index, counts, vertex streams, interleaved vertices, indices).
+	// Streams are aligned and loaded meshes read them in place: the model keeps the blob mapped (aOutMapping), so warm starts neither run assimp nor copy the streams.
+	class ER_MeshCache
+	{
+	public:
+		static bool Load(ER_Model& aModel, const std::string& aSourcePath, UINT aImportFlags, std::vector<ER_ModelMaterial>& aOutMaterials, std::vector<ER_Mesh>& aOutMeshes,
+			std::unique_ptr<ER_MeshCacheMapping>& aOutMapping);
+		static bool Save(const std::string& aSourcePath, UINT aImportFlags, const std::vector<ER_ModelMaterial>& aMaterials, const std::vector<ER_Mesh>& aMeshes);
+		static std::string GetCachePath(const std::string& aSourcePath, UINT aImportFlags);
+		// Model files (by extension) in a directory, recursively
+		static void FindModelFiles(const std::string& aDirectory, std::vector<std::string>& aOutFiles);
+
+		// Save -> Load round trip of a small generated model and invalidation of its blob (changed source size, content or cache version); needs the core for ER_Model (see ER_Tests)
+		static bool RunTests(ER_Core& aCore);
+		// Logs cold (assimp) vs. warm (cache) import times of all models in a directory (recursively)
+		static void BenchmarkImport(ER_Core& aCore, const std::string& aDirectory);
+	private:
+		static bool GetSourceContentHash(const std::string& aSourcePath, UINT64& aSize, UINT64& aHash);
+	};
+}
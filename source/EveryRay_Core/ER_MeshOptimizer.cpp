@@ -0,0 +1,452 @@
+#include "ER_MeshOptimizer.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <array>
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		struct WeldKeyHasher
+		{
+			const std::vector<ER_MeshStream>* streams;
+
+			size_t operator()(UINT aVertex) const
+			{
+				// FNV-1a over all the attributes of the vertex
+				size_t hash = 2166136261u;
+				for (const auto& stream : *streams)
+				{
+					const unsigned char* bytes = static_cast<const unsigned char*>(stream.data) + static_cast<size_t>(aVertex) * stream.stride;
+					for (UINT i = 0; i < stream.stride; i++)
+						hash = (hash ^ bytes[i]) * 16777619u;
+				}
+				return hash;
+			}
+		};
+
+		struct WeldKeyEqual
+		{
+			const std::vector<ER_MeshStream>* streams;
+
+			bool operator()(UINT aLhs, UINT aRhs) const
+			{
+				for (const auto& stream : *streams)
+				{
+					const unsigned char* base = static_cast<const unsigned char*>(stream.data);
+					if (memcmp(base + static_cast<size_t>(aLhs) * stream.stride, base + static_cast<size_t>(aRhs) * stream.stride, stream.stride) != 0)
+						return false;
+				}
+				return true;
+			}
+		};
+
+		// Forsyth, "Linear-Speed Vertex Cache Optimisation"
+		const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+		const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+		const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+		const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+		float GetForsythVertexScore(int aCachePosition, UINT aRemainingTriangles)
+		{
+			if (aRemainingTriangles == 0)
+				return -1.0f; // not needed anymore
+
+			float score = 0.0f;
+			if (aCachePosition >= 0)
+			{
+				if (aCachePosition < 3)
+					score = FORSYTH_LAST_TRIANGLE_SCORE; // used by the last triangle: fixed score, so the order inside of a triangle does not matter
+				else
+				{
+					const float scaler = 1.0f / (MESH_OPTIMIZER_CACHE_SIZE - 3);
+					score = powf(1.0f - (aCachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+				}
+			}
+
+			// prefer vertices with few remaining triangles, so that they do not stay alone in the end
+			score += FORSYTH_VALENCE_BOOST_SCALE * powf(static_cast<float>(aRemainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		// triangles rotated so that their smallest index is first (keeps the winding) and sorted: equal for index buffers with the same triangles in any order
+		std::vector<UINT> GetTriangleSet(const std::vector<UINT>& aIndices)
+		{
+			std::vector<std::array<UINT, 3>> triangles(aIndices.size() / 3);
+			for (size_t t = 0; t < triangles.size(); t++)
+			{
+				const UINT* triangle = &aIndices[t * 3];
+				int first = 0;
+				if (triangle[1] < triangle[first]) first = 1;
+				if (triangle[2] < triangle[first]) first = 2;
+				triangles[t] = { triangle[first], triangle[(first + 1) % 3], triangle[(first + 2) % 3] };
+			}
+			std::sort(triangles.begin(), triangles.end());
+
+			std::vector<UINT> result;
+			result.reserve(aIndices.size());
+			for (const auto& triangle : triangles)
+				result.insert(result.end(), triangle.begin(), triangle.end());
+			return result;
+		}
+	}
+
+	UINT ER_MeshOptimizer::GenerateWeldRemap(const std::vector<ER_MeshStream>& aStreams, UINT aVertexCount, std::vector<UINT>& aOutRemap)
+	{
+		aOutRemap.assign(aVertexCount, ~0u);
+
+		WeldKeyHasher hasher = { &aStreams };
+		WeldKeyEqual equal = { &aStreams };
+		std::unordered_map<UINT, UINT, WeldKeyHasher, WeldKeyEqual> uniqueVertices(aVertexCount, hasher, equal);
+
+		UINT newVertexCount = 0;
+		for (UINT i = 0; i < aVertexCount; i++)
+		{
+			auto it = uniqueVertices.find(i);
+			if (it != uniqueVertices.end())
+				aOutRemap[i] = it->second;
+			else
+			{
+				uniqueVertices.emplace(i, newVertexCount);
+				aOutRemap[i] = newVertexCount++;
+			}
+		}
+		return newVertexCount;
+	}
+
+	void ER_MeshOptimizer::OptimizeVertexCache(std::vector<UINT>& aIndices, UINT aVertexCount)
+	{
+		const UINT triangleCount = static_cast<UINT>(aIndices.size() / 3);
+		if (triangleCount == 0 || aVertexCount == 0)
+			return;
+
+		// vertex -> triangles adjacency
+		std::vector<UINT> remainingTriangles(aVertexCount, 0);
+		for (UINT index : aIndices)
+			remainingTriangles[index]++;
+
+		std::vector<UINT> adjacencyOffsets(aVertexCount + 1, 0);
+		for (UINT v = 0; v < aVertexCount; v++)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+
+		std::vector<UINT> adjacency(aIndices.size());
+		{
+			std::vector<UINT> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (UINT t = 0; t < triangleCount; t++)
+				for (int k = 0; k < 3; k++)
+					adjacency[fillOffsets[aIndices[t * 3 + k]]++] = t;
+		}
+
+		std::vector<int> cachePositions(aVertexCount, -1);
+		std::vector<float> vertexScores(aVertexCount);
+		for (UINT v = 0; v < aVertexCount; v++)
+			vertexScores[v] = GetForsythVertexScore(-1, remainingTriangles[v]);
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> isTriangleAdded(triangleCount, false);
+		for (UINT t = 0; t < triangleCount; t++)
+			triangleScores[t] = vertexScores[aIndices[t * 3]] + vertexScores[aIndices[t * 3 + 1]] + vertexScores[aIndices[t * 3 + 2]];
+
+		// +3 for the vertices of the new triangle that push the old ones out
+		std::vector<UINT> cache;
+		std::vector<UINT> newCache;
+		cache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+		newCache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+
+		std::vector<UINT> result;
+		result.reserve(aIndices.size());
+
+		UINT nextUnaddedTriangle = 0; // for the full scan fallback (when the cache has no useful triangles)
+		int bestTriangle = -1;
+		for (UINT addedCount = 0; addedCount < triangleCount; addedCount++)
+		{
+			if (bestTriangle < 0)
+			{
+				float bestScore = -1.0f;
+				for (UINT t = nextUnaddedTriangle; t < triangleCount; t++)
+				{
+					if (isTriangleAdded[t])
+						continue;
+					if (triangleScores[t] > bestScore)
+					{
+						bestScore = triangleScores[t];
+						bestTriangle = static_cast<int>(t);
+					}
+				}
+			}
+			assert(bestTriangle >= 0);
+
+			const UINT* triangle = &aIndices[bestTriangle * 3];
+			isTriangleAdded[bestTriangle] = true;
+			result.insert(result.end(), triangle, triangle + 3);
+
+			// the triangle's vertices go to the front of the LRU cache, the rest keeps its order
+			newCache.clear();
+			for (int k = 0; k < 3; k++)
+			{
+				const UINT v = triangle[k];
+				newCache.push_back(v);
+
+				// remove the triangle from the adjacency of its vertices
+				UINT* vertexTriangles = &adjacency[adjacencyOffsets[v]];
+				for (UINT i = 0; i < remainingTriangles[v]; i++)
+				{
+					if (vertexTriangles[i] == static_cast<UINT>(bestTriangle))
+					{
+						std::swap(vertexTriangles[i], vertexTriangles[remainingTriangles[v] - 1]);
+						break;
+					}
+				}
+				remainingTriangles[v]--;
+			}
+			for (UINT v : cache)
+			{
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					newCache.push_back(v);
+			}
+			cache.swap(newCache);
+
+			// update the scores of the vertices in the cache (and of the ones that were pushed out) and of their triangles
+			for (size_t i = 0; i < cache.size(); i++)
+			{
+				const UINT v = cache[i];
+				cachePositions[v] = (i < MESH_OPTIMIZER_CACHE_SIZE) ? static_cast<int>(i) : -1;
+				const float newScore = GetForsythVertexScore(cachePositions[v], remainingTriangles[v]);
+				const float scoreDelta = newScore - vertexScores[v];
+				vertexScores[v] = newScore;
+
+				const UINT* vertexTriangles = &adjacency[adjacencyOffsets[v]];
+				for (UINT j = 0; j < remainingTriangles[v]; j++)
+					triangleScores[vertexTriangles[j]] += scoreDelta;
+			}
+			if (cache.size() > MESH_OPTIMIZER_CACHE_SIZE)
+				cache.resize(MESH_OPTIMIZER_CACHE_SIZE);
+
+			// the next triangle is the best one that touches the cache (otherwise full scan)
+			bestTriangle = -1;
+			float bestScore = -1.0f;
+			for (UINT v : cache)
+			{
+				const UINT* vertexTriangles = &adjacency[adjacencyOffsets[v]];
+				for (UINT j = 0; j < remainingTriangles[v]; j++)
+				{
+					const UINT t = vertexTriangles[j];
+					if (triangleScores[t] > bestScore)
+					{
+						bestScore = triangleScores[t];
+						bestTriangle = static_cast<int>(t);
+					}
+				}
+			}
+
+			if (bestTriangle < 0)
+			{
+				while (nextUnaddedTriangle < triangleCount && isTriangleAdded[nextUnaddedTriangle])
+					nextUnaddedTriangle++;
+			}
+		}
+
+		aIndices.swap(result);
+	}
+
+	void ER_MeshOptimizer::OptimizeOverdraw(std::vector<UINT>& aIndices, const std::vector<XMFLOAT3>& aPositions)
+	{
+		const UINT triangleCount = static_cast<UINT>(aIndices.size() / 3);
+		if (triangleCount < 2 || aPositions.empty())
+			return;
+
+		// Split the vertex cache optimized list into clusters at the points where the cache "restarts" (a triangle with all 3 vertices missing in a FIFO cache).
+		// Reordering whole clusters keeps most of the cache efficiency (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+		std::vector<UINT> clusterStarts;
+		{
+			std::vector<UINT> cacheTimestamps(aPositions.size(), 0);
+			UINT timestamp = MESH_OPTIMIZER_STATS_CACHE_SIZE + 1;
+			for (UINT t = 0; t < triangleCount; t++)
+			{
+				UINT misses = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					const UINT v = aIndices[t * 3 + k];
+					if (timestamp - cacheTimestamps[v] > MESH_OPTIMIZER_STATS_CACHE_SIZE)
+					{
+						cacheTimestamps[v] = timestamp++;
+						misses++;
+					}
+				}
+				if (t == 0 || misses == 3)
+					clusterStarts.push_back(t);
+			}
+		}
+		const UINT clusterCount = static_cast<UINT>(clusterStarts.size());
+		if (clusterCount < 2)
+			return;
+
+		XMVECTOR meshCentroid = XMVectorZero();
+		for (const auto& position : aPositions)
+			meshCentroid = XMVectorAdd(meshCentroid, XMLoadFloat3(&position));
+		meshCentroid = XMVectorScale(meshCentroid, 1.0f / aPositions.size());
+
+		// Clusters that face away from the center of the mesh are drawn first: they are likely to occlude the others
+		std::vector<float> clusterSortKeys(clusterCount);
+		for (UINT c = 0; c < clusterCount; c++)
+		{
+			const UINT first = clusterStarts[c];
+			const UINT last = (c + 1 < clusterCount) ? clusterStarts[c + 1] : triangleCount;
+
+			XMVECTOR centroid = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+			float area = 0.0f;
+			for (UINT t = first; t < last; t++)
+			{
+				const XMVECTOR p0 = XMLoadFloat3(&aPositions[aIndices[t * 3 + 0]]);
+				const XMVECTOR p1 = XMLoadFloat3(&aPositions[aIndices[t * 3 + 1]]);
+				const XMVECTOR p2 = XMLoadFloat3(&aPositions[aIndices[t * 3 + 2]]);
+				const XMVECTOR triangleNormal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)); // length is 2 * area
+				const float triangleArea = XMVectorGetX(XMVector3Length(triangleNormal)) * 0.5f;
+
+				centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triangleArea / 3.0f));
+				normal = XMVectorAdd(normal, triangleNormal);
+				area += triangleArea;
+			}
+
+			if (area > 0.0f)
+				centroid = XMVectorScale(centroid, 1.0f / area);
+			normal = XMVector3Normalize(normal);
+			clusterSortKeys[c] = XMVectorGetX(XMVector3Dot(XMVectorSubtract(centroid, meshCentroid), normal));
+		}
+
+		std::vector<UINT> clusterOrder(clusterCount);
+		for (UINT c = 0; c < clusterCount; c++)
+			clusterOrder[c] = c;
+		std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKeys](UINT a, UINT b) { return clusterSortKeys[a] > clusterSortKeys[b]; });
+
+		std::vector<UINT> result;
+		result.reserve(aIndices.size());
+		for (UINT c : clusterOrder)
+		{
+			const UINT first = clusterStarts[c];
+			const UINT last = (c + 1 < clusterCount) ? clusterStarts[c + 1] : triangleCount;
+			result.insert(result.end(), aIndices.begin() + first * 3, aIndices.begin() + last * 3);
+		}
+		aIndices.swap(result);
+	}
+
+	UINT ER_MeshOptimizer::GenerateVertexFetchRemap(const std::vector<UINT>& aIndices, UINT aVertexCount, std::vector<UINT>& aOutRemap)
+	{
+		aOutRemap.assign(aVertexCount, ~0u);
+
+		UINT newVertexCount = 0;
+		for (UINT index : aIndices)
+		{
+			if (aOutRemap[index] == ~0u)
+				aOutRemap[index] = newVertexCount++;
+		}
+		return newVertexCount;
+	}
+
+	ER_MeshCacheStats ER_MeshOptimizer::AnalyzeVertexCache(const std::vector<UINT>& aIndices, UINT aVertexCount, UINT aCacheSize)
+	{
+		ER_MeshCacheStats stats;
+		const UINT triangleCount = static_cast<UINT>(aIndices.size() / 3);
+		if (triangleCount == 0 || aVertexCount == 0)
+			return stats;
+
+		// FIFO cache: a vertex is in the cache if it was transformed less than aCacheSize misses ago
+		std::vector<UINT> cacheTimestamps(aVertexCount, 0);
+		std::vector<bool> isUsed(aVertexCount, false);
+		UINT timestamp = aCacheSize + 1;
+		UINT misses = 0;
+		UINT usedVertexCount = 0;
+		for (UINT index : aIndices)
+		{
+			if (timestamp - cacheTimestamps[index] > aCacheSize)
+			{
+				cacheTimestamps[index] = timestamp++;
+				misses++;
+			}
+			if (!isUsed[index])
+			{
+				isUsed[index] = true;
+				usedVertexCount++;
+			}
+		}
+
+		stats.ACMR = static_cast<float>(misses) / triangleCount;
+		stats.ATVR = static_cast<float>(misses) / usedVertexCount;
+		return stats;
+	}
+
+	void ER_MeshOptimizer::RemapIndices(std::vector<UINT>& aIndices, const std::vector<UINT>& aRemap)
+	{
+		for (auto& index : aIndices)
+			index = aRemap[index];
+	}
+
+	bool ER_MeshOptimizer::RunTests()
+	{
+		bool isPassed = true;
+
+		// welding: bitwise equal vertices (in all streams) are merged, -0.0f and 0.0f or different UVs are not
+		{
+			const std::vector<XMFLOAT3> positions = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { -0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } };
+			const std::vector<XMFLOAT2> uvs = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 0.0f }, { 0.5f, 1.0f } };
+			const std::vector<ER_MeshStream> streams = { { positions.data(), sizeof(XMFLOAT3) }, { uvs.data(), sizeof(XMFLOAT2) } };
+
+			std::vector<UINT> remap;
+			const UINT vertexCount = GenerateWeldRemap(streams, static_cast<UINT>(positions.size()), remap);
+			isPassed &= vertexCount == 5 && remap.size() == positions.size();
+			isPassed &= remap == std::vector<UINT>({ 0, 1, 2, 0, 1, 3, 4 });
+		}
+
+		// vertex fetch remap: dense, in the order of first use, unused vertices dropped
+		{
+			std::vector<UINT> indices = { 5, 2, 6, 0, 2, 5, 7, 0, 6 };
+			std::vector<UINT> remap;
+			const UINT vertexCount = GenerateVertexFetchRemap(indices, 8, remap);
+			isPassed &= vertexCount == 5;
+			isPassed &= remap == std::vector<UINT>({ 3, ~0u, 1, ~0u, ~0u, 0, 2, 4 });
+
+			RemapIndices(indices, remap);
+			isPassed &= indices == std::vector<UINT>({ 0, 1, 2, 3, 1, 0, 4, 3, 2 });
+		}
+
+		// triangle reordering of a grid in row order: same triangles, ACMR not worse
+		{
+			const UINT quadsPerRow = 64;
+			const UINT verticesPerRow = quadsPerRow + 1;
+			const UINT vertexCount = verticesPerRow * verticesPerRow;
+			std::vector<XMFLOAT3> positions(vertexCount);
+			for (UINT y = 0; y < verticesPerRow; y++)
+				for (UINT x = 0; x < verticesPerRow; x++)
+					positions[y * verticesPerRow + x] = XMFLOAT3(static_cast<float>(x), 0.0f, static_cast<float>(y));
+
+			std::vector<UINT> indices;
+			for (UINT y = 0; y < quadsPerRow; y++)
+			{
+				for (UINT x = 0; x < quadsPerRow; x++)
+				{
+					const UINT v = y * verticesPerRow + x;
+					indices.insert(indices.end(), { v, v + verticesPerRow, v + 1, v + 1, v + verticesPerRow, v + verticesPerRow + 1 });
+				}
+			}
+			const std::vector<UINT> triangleSet = GetTriangleSet(indices);
+			const ER_MeshCacheStats statsBefore = AnalyzeVertexCache(indices, vertexCount);
+
+			OptimizeVertexCache(indices, vertexCount);
+			const ER_MeshCacheStats statsVertexCache = AnalyzeVertexCache(indices, vertexCount);
+			isPassed &= GetTriangleSet(indices) == triangleSet;
+			isPassed &= statsVertexCache.ACMR <= statsBefore.ACMR;
+
+			OptimizeOverdraw(indices, positions);
+			const ER_MeshCacheStats statsOverdraw = AnalyzeVertexCache(indices, vertexCount);
+			isPassed &= GetTriangleSet(indices) == triangleSet;
+			isPassed &= statsOverdraw.ACMR <= statsBefore.ACMR;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_MeshOptimizer] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "Common.h"
+
+#define MESH_OPTIMIZER_CACHE_SIZE 32 // post-transform cache size we optimize for
+#define MESH_OPTIMIZER_STATS_CACHE_SIZE 16 // FIFO cache size for ACMR/ATVR stats (conservative, like older HW)
+
+namespace EveryRay_Core
+{
+	// One vertex attribute stream (used for welding: vertices are equal if all their streams are bitwise equal)
+	struct ER_MeshStream
+	{
+		const void* data;
+		UINT stride;
+	};
+
+	struct ER_MeshCacheStats
+	{
+		float ACMR = 0.0f; // average cache miss ratio: transformed vertices per triangle (0.5 is ideal for big regular meshes, 3.0 is the worst)
+		float ATVR = 0.0f; // average transformed vertex ratio: transformed vertices per unique vertex (1.0 is ideal)
+	};
+
+	// Totals of many meshes before/after their optimization (triangle lists only), see ER_Model::ReportOptimization()
+	struct ER_MeshOptimizationStats
+	{
+		UINT triangleCount = 0;
+		UINT vertexCountBefore = 0;
+		UINT vertexCountAfter = 0;
+		double missesBefore = 0.0; // transformed vertices (ACMR * triangles)
+		double missesAfter = 0.0;
+
+		void Add(const ER_MeshOptimizationStats& aStats)
+		{
+			triangleCount += aStats.triangleCount;
+			vertexCountBefore += aStats.vertexCountBefore;
+			vertexCountAfter += aStats.vertexCountAfter;
+			missesBefore += aStats.missesBefore;
+			missesAfter += aStats.missesAfter;
+		}
+	};
+
+	// Import-time processing of indexed triangle lists:
+	// welding of duplicates, index reordering for post-transform cache (Forsyth) and overdraw (cluster sorting), vertex reordering for fetch locality.
+	class ER_MeshOptimizer
+	{
+	public:
+		// Fills aOutRemap (old vertex -> new vertex) and returns the new vertex count
+		static UINT GenerateWeldRemap(const std::vector<ER_MeshStream>& aStreams, UINT aVertexCount, std::vector<UINT>& aOutRemap);
+		static void OptimizeVertexCache(std::vector<UINT>& aIndices, UINT aVertexCount);
+		// Expects vertex cache optimized indices (keeps the order inside of the clusters)
+		static void OptimizeOverdraw(std::vector<UINT>& aIndices, const std::vector<XMFLOAT3>& aPositions);
+		// Vertices are renumbered in the order of their first use; fills aOutRemap and returns the new vertex count (unused vertices are dropped)
+		static UINT GenerateVertexFetchRemap(const std::vector<UINT>& aIndices, UINT aVertexCount, std::vector<UINT>& aOutRemap);
+		static ER_MeshCacheStats AnalyzeVertexCache(const std::vector<UINT>& aIndices, UINT aVertexCount, UINT aCacheSize = MESH_OPTIMIZER_STATS_CACHE_SIZE);
+
+		static void RemapIndices(std::vector<UINT>& aIndices, const std::vector<UINT>& aRemap);
+
+		// Welding, vertex fetch remap and triangle reordering of small generated meshes (see ER_Tests)
+		static bool RunTests();
+		template<typename T>
+		static void RemapStream(std::vector<T>& aStream, const std::vector<UINT>& aRemap, UINT aNewVertexCount)
+		{
+			if (aStream.empty())
+				return;
+
+			std::vector<T> result(aNewVertexCount);
+			for (size_t i = 0; i < aRemap.size(); i++)
+			{
+				if (aRemap[i] != ~0u)
+					result[aRemap[i]] = aStream[i];
+			}
+			aStream.swap(result);
+		}
+	};
+}
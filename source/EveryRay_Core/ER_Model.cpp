@@ -5,6 +5,9 @@
 #include "ER_ModelMaterial.h"
 #include "ER_Core.h"
 #include "ER_CoreException.h"
+#include "ER_MeshCache.h"
+#include "ER_MeshOptimizer.h"
+#include "ER_Utility.h"
 
 #include "assimp\Importer.hpp"
 #include "assimp\scene.h"
@@ -12,17 +15,19 @@
 
 namespace EveryRay_Core
 {
-	ER_Model::ER_Model(ER_Core& game, const std::string& filename, bool flipUVs, bool isSilent)
+	ER_Model::ER_Model(ER_Core& game, const std::string& filename, bool flipUVs, bool isSilent, bool useMeshCache, ER_MeshOptimizationStats* aOutOptimizationStats)
 		: mCore(game), mMeshes(), mMaterials()
 	{
-		Assimp::Importer importer;
+		const UINT flags = GetImportFlags(flipUVs);
 
-		UINT flags = aiProcess_Triangulate /*| aiProcess_JoinIdenticalVertices*/ | aiProcess_SortByPType | aiProcess_FlipWindingOrder;
-		if (flipUVs)
+		if (useMeshCache && ER_MeshCache::Load(*this, filename, flags, mMaterials, mMeshes, mMeshCacheMapping))
 		{
-			flags |= aiProcess_FlipUVs;
+			mIsLoaded = true;
+			mFilename = filename;
+			return;
 		}
 
+		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(filename, flags);
 		
 		if (scene == nullptr)
@@ -47,17 +52,57 @@ namespace EveryRay_Core
 		if (scene->HasMeshes())
 		{
 			assert(scene->mNumMeshes < MAX_MESH_COUNT);
+			mMeshes.reserve(scene->mNumMeshes);
+
 			for (UINT i = 0; i < scene->mNumMeshes; i++)
+			{
 				mMeshes.push_back(ER_Mesh(*this, mMaterials[scene->mMeshes[i]->mMaterialIndex], *(scene->mMeshes[i])));
+				if (!aOutOptimizationStats)
+				{
+					mMeshes.back().Optimize();
+					continue;
+				}
+
+				ER_MeshCacheStats statsBefore, statsAfter;
+				const UINT meshVertexCountBefore = static_cast<UINT>(mMeshes.back().Vertices().size());
+				mMeshes.back().Optimize(&statsBefore, &statsAfter);
+				const UINT meshVertexCountAfter = static_cast<UINT>(mMeshes.back().Vertices().size());
+
+				if (statsAfter.ACMR > 0.0f) // triangle lists only
+				{
+					const UINT meshTriangleCount = mMeshes.back().FaceCount();
+					aOutOptimizationStats->triangleCount += meshTriangleCount;
+					aOutOptimizationStats->vertexCountBefore += meshVertexCountBefore;
+					aOutOptimizationStats->vertexCountAfter += meshVertexCountAfter;
+					aOutOptimizationStats->missesBefore += statsBefore.ACMR * meshTriangleCount;
+					aOutOptimizationStats->missesAfter += statsAfter.ACMR * meshTriangleCount;
+				}
+			}
 		}
 
 		mFilename = filename;
+
+		if (useMeshCache && !ER_MeshCache::Save(filename, flags, mMaterials, mMeshes))
+		{
+			std::string msg = "[ER Logger][ER_Model] Warning! Could not write the model to the mesh cache: " + filename + '\n';
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+		}
 	}
 
 	ER_Model::~ER_Model()
 	{
 	}
 
+	UINT ER_Model::GetImportFlags(bool aFlipUVs)
+	{
+		UINT flags = aiProcess_Triangulate /*| aiProcess_JoinIdenticalVertices*/ | aiProcess_SortByPType | aiProcess_FlipWindingOrder; // vertices are welded later in ER_Mesh::Optimize()
+		if (aFlipUVs)
+		{
+			flags |= aiProcess_FlipUVs;
+		}
+		return flags;
+	}
+
 	ER_Core& ER_Model::GetCore()
 	{
 		return mCore;
@@ -114,4 +159,35 @@ namespace EveryRay_Core
 		mAABB = { minVertex, maxVertex };
 		return mAABB;
 	}
+	void ER_Model::ReportOptimization(ER_Core& aCore, const std::string& aDirectory)
+	{
+		std::vector<std::string> modelPaths;
+		ER_MeshCache::FindModelFiles(aDirectory, modelPaths);
+
+		auto toString = [](const std::string& aName, const ER_MeshOptimizationStats& aStats) -> std::string
+		{
+			return aName + ": vertices " + std::to_string(aStats.vertexCountBefore) + " -> " + std::to_string(aStats.vertexCountAfter) +
+				", ACMR " + std::to_string(aStats.missesBefore / std::max(aStats.triangleCount, 1u)) + " -> " + std::to_string(aStats.missesAfter / std::max(aStats.triangleCount, 1u)) +
+				", ATVR " + std::to_string(aStats.missesBefore / std::max(aStats.vertexCountBefore, 1u)) + " -> " + std::to_string(aStats.missesAfter / std::max(aStats.vertexCountAfter, 1u)) + '\n';
+		};
+
+		ER_MeshOptimizationStats totalStats;
+		UINT modelsCount = 0;
+		for (const std::string& modelPath : modelPaths)
+		{
+			ER_MeshOptimizationStats stats;
+			ER_Model model(aCore, modelPath, true, true, false, &stats);
+			if (!model.IsLoaded() || stats.triangleCount == 0)
+				continue;
+
+			totalStats.Add(stats);
+			modelsCount++;
+
+			std::string msg = "[ER Logger][ER_Model] Mesh optimization of " + toString(modelPath, stats);
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+		}
+
+		std::string msg = "[ER Logger][ER_Model] Mesh optimization of " + toString(std::to_string(modelsCount) + " models", totalStats);
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+	}
 }
\ No newline at end of file
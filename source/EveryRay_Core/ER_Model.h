@@ -2,16 +2,22 @@
 
 #include "Common.h"
 
+#define USE_MESH_CACHE 1 // load already imported models from ER_MeshCache (and store newly imported ones there) instead of running assimp every time
+
 namespace EveryRay_Core
 {
 	class ER_Core;
 	class ER_Mesh;
 	class ER_ModelMaterial;
+	class ER_MeshCacheMapping;
+	struct ER_MeshOptimizationStats;
 
 	class ER_Model
 	{
 	public:
-		ER_Model(ER_Core& game, const std::string& filename, bool flipUVs = false, bool isSilent = true);
+		// aOutOptimizationStats (if any) are only filled when the model is imported by assimp (not loaded from the mesh cache)
+		ER_Model(ER_Core& game, const std::string& filename, bool flipUVs = false, bool isSilent = true, bool useMeshCache = USE_MESH_CACHE,
+			ER_MeshOptimizationStats* aOutOptimizationStats = nullptr);
 		~ER_Model();
 
 		ER_Core& GetCore();
@@ -25,12 +31,19 @@ namespace EveryRay_Core
 		const char* GetFileNameChar() { return mFilename.c_str(); }
 		const ER_AABB& GenerateAABB();
 		bool IsLoaded() { return mIsLoaded; }
+
+		// assimp post-processing flags (also a part of the mesh cache key)
+		static UINT GetImportFlags(bool aFlipUVs);
+
+		// Logs vertex counts and ACMR/ATVR before/after the optimization of all models in a directory (recursively), imported without the mesh cache
+		static void ReportOptimization(ER_Core& aCore, const std::string& aDirectory);
 	private:
 		ER_Model(const ER_Model& rhs);
 		ER_Model& operator=(const ER_Model& rhs);
 
 		ER_Core& mCore;
 		ER_AABB mAABB;
+		std::unique_ptr<ER_MeshCacheMapping> mMeshCacheMapping; // cache blob the meshes read their streams from (if loaded from ER_MeshCache)
 		std::vector<ER_Mesh> mMeshes;
 		std::vector<ER_ModelMaterial> mMaterials;
 		std::string mFilename;
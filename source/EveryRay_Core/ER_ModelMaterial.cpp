@@ -27,7 +27,7 @@ namespace EveryRay_Core
 
 		for (TextureType textureType = (TextureType)0; textureType < TextureTypeEnd; textureType = (TextureType)(textureType + 1))
 		{
-			aiTextureType mappedTextureType = (aiTextureType)sTextureTypeMappings[textureType];
+			aiTextureType mappedTextureType = (aiTextureType)sTextureTypeMappings.at(textureType);
 
 			UINT textureCount = material->GetTextureCount(mappedTextureType);
 			if (textureCount > 0)
@@ -84,18 +84,21 @@ namespace EveryRay_Core
 			return false;
 	}
 
+	// Models can be imported from several job system workers at once, so the mappings are initialized only once
 	void ER_ModelMaterial::InitializeTextureTypeMappings()
 	{
-		if (sTextureTypeMappings.size() != TextureTypeEnd)
+		static std::once_flag initializedFlag;
+		std::call_once(initializedFlag, []()
 		{
 			sTextureTypeMappings[TextureTypeDifffuse] = aiTextureType_DIFFUSE;
 			sTextureTypeMappings[TextureTypeSpecularMap] = aiTextureType_SPECULAR;
 			sTextureTypeMappings[TextureTypeAmbient] = aiTextureType_AMBIENT;
+			sTextureTypeMappings[TextureTypeEmissive] = aiTextureType_NONE; // not used (reading an unmapped type must not insert into the map from several threads)
 			sTextureTypeMappings[TextureTypeHeightmap] = aiTextureType_HEIGHT;
 			sTextureTypeMappings[TextureTypeNormalMap] = aiTextureType_NORMALS;
 			sTextureTypeMappings[TextureTypeSpecularPowerMap] = aiTextureType_SHININESS;
 			sTextureTypeMappings[TextureTypeDisplacementMap] = aiTextureType_DISPLACEMENT;
 			sTextureTypeMappings[TextureTypeLightMap] = aiTextureType_LIGHTMAP;
-		}
+		});
 	}
 }
\ No newline at end of file
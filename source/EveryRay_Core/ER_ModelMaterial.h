@@ -36,6 +36,8 @@ namespace EveryRay_Core
 		bool HasTexturesOfType(TextureType type) const;
 
 	private:
+		friend class ER_MeshCache;
+
 		static void InitializeTextureTypeMappings();
 		static std::map<TextureType, UINT> sTextureTypeMappings;
 
@@ -0,0 +1,377 @@
+#include "ER_Placement.h"
+#include "ER_Core.h"
+#include "ER_Utility.h"
+#include "ER_Terrain.h"
+
+#include <algorithm>
+
+#define PLACEMENT_TILE_CELLS 32 // tile size (in grid cells) of the parallel Poisson-disk sampling
+#define PLACEMENT_POISSON_CANDIDATES 12 // candidates around an active point before it is retired (Bridson's "k")
+
+namespace EveryRay_Core
+{
+	ER_PlacementRandom::ER_PlacementRandom(UINT aSeed, UINT aStream)
+		: mIncrement((static_cast<UINT64>(aStream) << 1u) | 1u)
+	{
+		NextUInt();
+		mState += aSeed;
+		NextUInt();
+	}
+
+	UINT ER_PlacementRandom::NextUInt()
+	{
+		const UINT64 oldState = mState;
+		mState = oldState * 6364136223846793005ull + mIncrement;
+		const UINT xorShifted = static_cast<UINT>(((oldState >> 18u) ^ oldState) >> 27u);
+		const UINT rotation = static_cast<UINT>(oldState >> 59u);
+		return (xorShifted >> rotation) | (xorShifted << ((~rotation + 1u) & 31u));
+	}
+
+	float ER_PlacementRandom::NextFloat()
+	{
+		return static_cast<float>(NextUInt() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	UINT ER_Placement::CombineSeeds(UINT aSeed, UINT aValue)
+	{
+		UINT hash = aSeed ^ (aValue + 0x9e3779b9u + (aSeed << 6) + (aSeed >> 2));
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6bu;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35u;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	UINT ER_Placement::GetSeedFromName(const std::string& aName)
+	{
+		return CombineSeeds(PLACEMENT_DEFAULT_SEED, ER_Utility::FastHash(aName.data(), static_cast<int>(aName.length())));
+	}
+
+	ER_PlacementDensityMask ER_Placement::CreateSplatDensityMask(const ER_Terrain* aTerrain, int aSplatChannel)
+	{
+		if (!aTerrain || aSplatChannel < 0 || aSplatChannel >= static_cast<int>(TerrainSplatChannels::NONE))
+			return ER_PlacementDensityMask();
+
+		return [aTerrain, aSplatChannel](float x, float z)
+		{
+			const float density = aTerrain->GetSplatDensity(x, z, aSplatChannel);
+			return density > 0.2f ? density : 0.0f; // same threshold as in IsOnSplatMap()
+		};
+	}
+
+	void ER_Placement::GeneratePoissonDisk(const XMFLOAT2& aMinXZ, const XMFLOAT2& aMaxXZ, float aMinDistance, UINT aSeed, const ER_PlacementDensityMask& aDensityMask,
+		std::vector<XMFLOAT2>& aOutPoints, ER_JobSystem* aJobSystem)
+	{
+		ER_PROFILE_SCOPE("ER_Placement::GeneratePoissonDisk");
+
+		aOutPoints.clear();
+		const float width = aMaxXZ.x - aMinXZ.x;
+		const float depth = aMaxXZ.y - aMinXZ.y;
+		if (width <= 0.0f || depth <= 0.0f || aMinDistance <= 0.0f)
+			return;
+
+		// cell diagonal is the min distance, so every cell has one point at most and only 5x5 cells have to be checked
+		const float cellSize = aMinDistance / sqrtf(2.0f);
+		const float invCellSize = 1.0f / cellSize;
+		const float minDistanceSq = aMinDistance * aMinDistance;
+		const float candidateRadius = aMinDistance * 1.0001f;
+		const XMFLOAT2 candidateStep(cosf(XM_2PI / PLACEMENT_POISSON_CANDIDATES), sinf(XM_2PI / PLACEMENT_POISSON_CANDIDATES));
+		const int gridWidth = std::max(static_cast<int>(ceilf(width / cellSize)), 1);
+		const int gridDepth = std::max(static_cast<int>(ceilf(depth / cellSize)), 1);
+		const int tilesX = (gridWidth + PLACEMENT_TILE_CELLS - 1) / PLACEMENT_TILE_CELLS;
+		const int tilesZ = (gridDepth + PLACEMENT_TILE_CELLS - 1) / PLACEMENT_TILE_CELLS;
+
+		std::vector<XMFLOAT2> grid(static_cast<size_t>(gridWidth) * gridDepth, XMFLOAT2(FLT_MAX, FLT_MAX));
+		std::vector<std::vector<XMFLOAT2>> tilePoints(tilesX * tilesZ);
+
+		// Every tile is sampled with its own generator and only writes to its own cells. It can read the cells of the neighbouring tiles (2 cells deep):
+		// those are either finished (previous passes) or not started yet, so the result does not depend on the order in which the tiles of one pass run.
+		auto sampleTile = [&](UINT aTileIndex)
+		{
+			const int cellMinX = (aTileIndex % tilesX) * PLACEMENT_TILE_CELLS;
+			const int cellMinZ = (aTileIndex / tilesX) * PLACEMENT_TILE_CELLS;
+			const int cellMaxX = std::min(cellMinX + PLACEMENT_TILE_CELLS, gridWidth);
+			const int cellMaxZ = std::min(cellMinZ + PLACEMENT_TILE_CELLS, gridDepth);
+			const float tileMinX = aMinXZ.x + cellMinX * cellSize;
+			const float tileMinZ = aMinXZ.y + cellMinZ * cellSize;
+			const float tileMaxX = (cellMaxX == gridWidth) ? aMaxXZ.x : aMinXZ.x + cellMaxX * cellSize;
+			const float tileMaxZ = (cellMaxZ == gridDepth) ? aMaxXZ.y : aMinXZ.y + cellMaxZ * cellSize;
+
+			ER_PlacementRandom random(aSeed, aTileIndex);
+			std::vector<XMFLOAT2>& points = tilePoints[aTileIndex];
+			std::vector<XMFLOAT2> activePoints;
+
+			auto getCell = [&](const XMFLOAT2& aPoint, int& aOutX, int& aOutZ)
+			{
+				aOutX = std::min(std::max(static_cast<int>((aPoint.x - aMinXZ.x) * invCellSize), cellMinX), cellMaxX - 1);
+				aOutZ = std::min(std::max(static_cast<int>((aPoint.y - aMinXZ.y) * invCellSize), cellMinZ), cellMaxZ - 1);
+			};
+			auto isValid = [&](const XMFLOAT2& aPoint)
+			{
+				if (aPoint.x < tileMinX || aPoint.x >= tileMaxX || aPoint.y < tileMinZ || aPoint.y >= tileMaxZ)
+					return false;
+
+				int cellX, cellZ;
+				getCell(aPoint, cellX, cellZ);
+				for (int z = std::max(cellZ - 2, 0); z <= std::min(cellZ + 2, gridDepth - 1); z++)
+				{
+					const bool isBorderRow = abs(z - cellZ) == 2;
+					for (int x = std::max(cellX - 2, 0); x <= std::min(cellX + 2, gridWidth - 1); x++)
+					{
+						if (isBorderRow && abs(x - cellX) == 2)
+							continue; // corner cells are too far away
+
+						const XMFLOAT2& other = grid[static_cast<size_t>(z) * gridWidth + x];
+						const float dx = other.x - aPoint.x;
+						const float dz = other.y - aPoint.y;
+						if (dx * dx + dz * dz < minDistanceSq)
+							return false;
+					}
+				}
+				return true;
+			};
+			auto addPoint = [&](const XMFLOAT2& aPoint)
+			{
+				int cellX, cellZ;
+				getCell(aPoint, cellX, cellZ);
+				grid[static_cast<size_t>(cellZ) * gridWidth + cellX] = aPoint;
+				activePoints.push_back(aPoint);
+				if (!aDensityMask || random.NextFloat() < aDensityMask(aPoint.x, aPoint.y))
+					points.push_back(aPoint);
+			};
+
+			for (int attempt = 0; attempt < PLACEMENT_POISSON_CANDIDATES; attempt++)
+			{
+				const XMFLOAT2 point(random.NextFloat(tileMinX, tileMaxX), random.NextFloat(tileMinZ, tileMaxZ));
+				if (isValid(point))
+				{
+					addPoint(point);
+					break;
+				}
+			}
+
+			while (!activePoints.empty())
+			{
+				const UINT activeIndex = random.NextUInt() % static_cast<UINT>(activePoints.size());
+				const XMFLOAT2 center = activePoints[activeIndex];
+
+				// candidates are evenly spread on the circle right outside of the min distance (from a random angle), which packs the points
+				// tighter than random candidates in the [d, 2d] ring and needs less of them
+				const float startAngle = random.NextFloat() * XM_2PI;
+				XMFLOAT2 direction(cosf(startAngle) * candidateRadius, sinf(startAngle) * candidateRadius);
+				bool isFound = false;
+				for (int candidate = 0; candidate < PLACEMENT_POISSON_CANDIDATES; candidate++)
+				{
+					const XMFLOAT2 point(center.x + direction.x, center.y + direction.y);
+					direction = XMFLOAT2(direction.x * candidateStep.x - direction.y * candidateStep.y, direction.x * candidateStep.y + direction.y * candidateStep.x);
+					if (isValid(point))
+					{
+						addPoint(point);
+						isFound = true;
+						break;
+					}
+				}
+
+				if (!isFound)
+				{
+					activePoints[activeIndex] = activePoints.back();
+					activePoints.pop_back();
+				}
+			}
+		};
+
+		for (int pass = 0; pass < 4; pass++)
+		{
+			std::vector<UINT> passTiles;
+			for (int tileZ = 0; tileZ < tilesZ; tileZ++)
+				for (int tileX = 0; tileX < tilesX; tileX++)
+					if ((tileX & 1) + 2 * (tileZ & 1) == pass)
+						passTiles.push_back(static_cast<UINT>(tileZ * tilesX + tileX));
+
+			if (aJobSystem && passTiles.size() > 1)
+			{
+				ER_JobCounter counter;
+				aJobSystem->ParallelFor(static_cast<UINT>(passTiles.size()), 4, [&](UINT aIndex) { sampleTile(passTiles[aIndex]); }, &counter);
+				aJobSystem->Wait(counter);
+			}
+			else
+			{
+				for (UINT tileIndex : passTiles)
+					sampleTile(tileIndex);
+			}
+		}
+
+		size_t pointsCount = 0;
+		for (const auto& points : tilePoints)
+			pointsCount += points.size();
+		aOutPoints.reserve(pointsCount);
+		for (const auto& points : tilePoints)
+			aOutPoints.insert(aOutPoints.end(), points.begin(), points.end());
+	}
+
+	void ER_Placement::GeneratePoints(const ER_PlacementDesc& aDesc, float aHeight, std::vector<XMFLOAT4>& aOutPoints, ER_JobSystem* aJobSystem)
+	{
+		ER_PROFILE_SCOPE("ER_Placement::GeneratePoints");
+
+		aOutPoints.clear();
+		const UINT pointsCount = aDesc.PointsCount;
+		if (pointsCount == 0)
+			return;
+		aOutPoints.reserve(pointsCount);
+
+		const float width = std::max(aDesc.MaxXZ.x - aDesc.MinXZ.x, 0.0f);
+		const float depth = std::max(aDesc.MaxXZ.y - aDesc.MinXZ.y, 0.0f);
+		auto getDensity = [&aDesc](float x, float z) { return aDesc.DensityMask ? std::min(std::max(aDesc.DensityMask(x, z), 0.0f), 1.0f) : 1.0f; };
+
+		// average density of the mask
+		float coverage = 1.0f;
+		if (aDesc.DensityMask)
+		{
+			const int samplesPerSide = 64;
+			float sum = 0.0f;
+			for (int z = 0; z < samplesPerSide; z++)
+				for (int x = 0; x < samplesPerSide; x++)
+					sum += getDensity(aDesc.MinXZ.x + (x + 0.5f) / samplesPerSide * width, aDesc.MinXZ.y + (z + 0.5f) / samplesPerSide * depth);
+			coverage = sum / (samplesPerSide * samplesPerSide);
+		}
+
+		std::vector<XMFLOAT2> points;
+		const float area = width * depth;
+		if (area > 0.0f && coverage > 0.0f)
+		{
+			// GeneratePoissonDisk() gives ~0.8 / (d * d) points per unit area: aim ~15% above the requested count and drop the extra points.
+			// Very sparse masks are not compensated further, so that the grid stays in the order of the points count.
+			float minDistance = 0.95f * sqrtf(0.8f * area * std::max(coverage, 0.25f) / pointsCount);
+			for (int attempt = 0; attempt < 3; attempt++)
+			{
+				GeneratePoissonDisk(aDesc.MinXZ, aDesc.MaxXZ, minDistance, CombineSeeds(aDesc.Seed, attempt), aDesc.DensityMask, points, aJobSystem);
+				if (points.size() >= pointsCount || points.empty())
+					break;
+				minDistance *= 0.9f * sqrtf(static_cast<float>(points.size()) / pointsCount);
+			}
+		}
+
+		ER_PlacementRandom random(aDesc.Seed, 1);
+		if (points.size() > pointsCount)
+		{
+			// partial Fisher-Yates shuffle: a random subset of blue noise is still evenly distributed
+			for (UINT i = 0; i < pointsCount; i++)
+				std::swap(points[i], points[i + random.NextUInt() % static_cast<UINT>(points.size() - i)]);
+			points.resize(pointsCount);
+		}
+		for (const auto& point : points)
+			aOutPoints.push_back(XMFLOAT4(point.x, aHeight, point.y, 1.0f));
+
+		while (aOutPoints.size() < pointsCount)
+		{
+			XMFLOAT2 point(0.0f, 0.0f);
+			for (int attempt = 0; attempt < 32; attempt++)
+			{
+				point = XMFLOAT2(aDesc.MinXZ.x + random.NextFloat() * width, aDesc.MinXZ.y + random.NextFloat() * depth);
+				if (random.NextFloat() < getDensity(point.x, point.y))
+					break;
+			}
+			aOutPoints.push_back(XMFLOAT4(point.x, aHeight, point.y, 1.0f));
+		}
+	}
+
+	bool ER_Placement::RunTests(ER_JobSystem* aJobSystem)
+	{
+		const XMFLOAT2 minXZ(-100.0f, -50.0f);
+		const XMFLOAT2 maxXZ(300.0f, 250.0f);
+		bool isPassed = true;
+
+		auto isInside = [](const XMFLOAT4& aPoint, const XMFLOAT2& aMin, const XMFLOAT2& aMax)
+		{
+			return aPoint.x >= aMin.x && aPoint.x <= aMax.x && aPoint.z >= aMin.y && aPoint.z <= aMax.y;
+		};
+
+		// spacing: no pair of points is closer than the min distance (sweep over the points sorted by x) and the rectangle is filled up
+		size_t poissonPointsCount = 0;
+		{
+			const float minDistance = 2.0f;
+			std::vector<XMFLOAT2> points;
+			GeneratePoissonDisk(minXZ, maxXZ, minDistance, 7, nullptr, points, aJobSystem);
+			poissonPointsCount = points.size();
+
+			std::sort(points.begin(), points.end(), [](const XMFLOAT2& a, const XMFLOAT2& b) { return a.x < b.x; });
+			for (size_t i = 0; i < points.size(); i++)
+			{
+				isPassed &= points[i].x >= minXZ.x && points[i].x <= maxXZ.x && points[i].y >= minXZ.y && points[i].y <= maxXZ.y;
+				for (size_t j = i + 1; j < points.size() && points[j].x - points[i].x < minDistance; j++)
+				{
+					const float dx = points[j].x - points[i].x;
+					const float dz = points[j].y - points[i].y;
+					isPassed &= dx * dx + dz * dz >= minDistance * minDistance * 0.9999f;
+				}
+			}
+			isPassed &= poissonPointsCount > 0.75f * (maxXZ.x - minXZ.x) * (maxXZ.y - minXZ.y) / (minDistance * minDistance);
+		}
+
+		// determinism: same points with and without the job system, different ones for another seed
+		ER_PlacementDesc desc;
+		desc.MinXZ = minXZ;
+		desc.MaxXZ = maxXZ;
+		desc.PointsCount = 50000;
+		desc.Seed = 42;
+		{
+			std::vector<XMFLOAT4> serialPoints, parallelPoints, otherSeedPoints;
+			GeneratePoints(desc, 1.0f, serialPoints, nullptr);
+			GeneratePoints(desc, 1.0f, parallelPoints, aJobSystem);
+			isPassed &= serialPoints.size() == desc.PointsCount && parallelPoints.size() == desc.PointsCount;
+			isPassed &= memcmp(serialPoints.data(), parallelPoints.data(), serialPoints.size() * sizeof(XMFLOAT4)) == 0;
+			for (const auto& point : serialPoints)
+				isPassed &= isInside(point, minXZ, maxXZ) && point.y == 1.0f;
+
+			desc.Seed = 43;
+			GeneratePoints(desc, 1.0f, otherSeedPoints, aJobSystem);
+			isPassed &= otherSeedPoints.size() == desc.PointsCount && memcmp(serialPoints.data(), otherSeedPoints.data(), serialPoints.size() * sizeof(XMFLOAT4)) != 0;
+		}
+
+		// density mask: all points on the masked half
+		{
+			desc.DensityMask = [](float x, float z) { return x < 100.0f ? 1.0f : 0.0f; };
+			std::vector<XMFLOAT4> points;
+			GeneratePoints(desc, 0.0f, points, aJobSystem);
+			isPassed &= points.size() == desc.PointsCount;
+			for (const auto& point : points)
+				isPassed &= isInside(point, minXZ, XMFLOAT2(100.0f, maxXZ.y));
+			desc.DensityMask = nullptr;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_Placement] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L": " + std::to_wstring(poissonPointsCount) +
+			L" Poisson-disk points checked\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_Placement::Benchmark(ER_JobSystem* aJobSystem)
+	{
+		ER_PlacementDesc desc;
+		desc.MinXZ = XMFLOAT2(-500.0f, -500.0f);
+		desc.MaxXZ = XMFLOAT2(500.0f, 500.0f);
+		desc.PointsCount = 1000000;
+		desc.Seed = 1;
+
+		// uniform (rand()) as the baseline
+		std::vector<XMFLOAT4> uniformPoints(desc.PointsCount), serialPoints, parallelPoints;
+		auto startTimer = std::chrono::high_resolution_clock::now();
+		for (auto& point : uniformPoints)
+			point = XMFLOAT4(ER_Utility::RandomFloat(desc.MinXZ.x, desc.MaxXZ.x), 0.0f, ER_Utility::RandomFloat(desc.MinXZ.y, desc.MaxXZ.y), 1.0f);
+		std::chrono::duration<double> uniformTime = std::chrono::high_resolution_clock::now() - startTimer;
+
+		startTimer = std::chrono::high_resolution_clock::now();
+		GeneratePoints(desc, 0.0f, serialPoints, nullptr);
+		std::chrono::duration<double> serialTime = std::chrono::high_resolution_clock::now() - startTimer;
+
+		startTimer = std::chrono::high_resolution_clock::now();
+		GeneratePoints(desc, 0.0f, parallelPoints, aJobSystem);
+		std::chrono::duration<double> parallelTime = std::chrono::high_resolution_clock::now() - startTimer;
+
+		std::wstring msg = L"[ER Logger][ER_Placement] Benchmark, 1M points: uniform " + std::to_wstring(uniformTime.count() * 1000.0) + L"ms, blue noise " + std::to_wstring(serialTime.count() * 1000.0) +
+			L"ms (1 thread), " + std::to_wstring(parallelTime.count() * 1000.0) + L"ms (job system)\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+}
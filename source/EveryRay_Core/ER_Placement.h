@@ -0,0 +1,65 @@
+#pragma once
+#include "Common.h"
+
+#include <functional>
+
+#define PLACEMENT_DEFAULT_SEED 0x45525053 // "ERPS", used when a level does not provide a seed
+
+namespace EveryRay_Core
+{
+	class ER_JobSystem;
+	class ER_Terrain;
+
+	// Small and fast seedable generator (PCG32): placement does not depend on rand() and its global state.
+	// Different streams of the same seed are independent sequences (i.e., positions, colors and scales of one zone).
+	class ER_PlacementRandom
+	{
+	public:
+		ER_PlacementRandom(UINT aSeed, UINT aStream = 0);
+
+		UINT NextUInt();
+		float NextFloat(); // [0, 1)
+		float NextFloat(float aMin, float aMax) { return aMin + NextFloat() * (aMax - aMin); }
+	private:
+		UINT64 mState = 0;
+		UINT64 mIncrement = 0;
+	};
+
+	// Returns the placement density in [0, 1] at the world XZ position; must be thread-safe
+	using ER_PlacementDensityMask = std::function<float(float x, float z)>;
+
+	struct ER_PlacementDesc
+	{
+		XMFLOAT2 MinXZ = XMFLOAT2(0.0f, 0.0f);
+		XMFLOAT2 MaxXZ = XMFLOAT2(0.0f, 0.0f);
+		UINT PointsCount = 0;
+		UINT Seed = PLACEMENT_DEFAULT_SEED;
+		ER_PlacementDensityMask DensityMask; // optional
+	};
+
+	// Deterministic procedural placement: the output only depends on the description (seed included), not on the job system or the number of its workers.
+	// Points are distributed as blue noise (Poisson-disk) instead of uniformly, so that they do not clump.
+	class ER_Placement
+	{
+	public:
+		// Exactly aDesc.PointsCount points (x, aHeight, z, 1.0) inside of the XZ rectangle. The min distance between them is derived from the count, the area and the average density of the mask.
+		// Only if the mask leaves no room for all of them, the rest is placed uniformly on the masked area (or on the whole rectangle).
+		static void GeneratePoints(const ER_PlacementDesc& aDesc, float aHeight, std::vector<XMFLOAT4>& aOutPoints, ER_JobSystem* aJobSystem = nullptr);
+
+		// Poisson-disk sampling with a fixed min distance (Bridson's algorithm on an acceleration grid). The rectangle is split into tiles that are sampled in parallel
+		// in 4 passes (tiles of one pass never touch each other). Points rejected by aDensityMask (if any) still take part in the spacing, so the result is a thinned blue noise.
+		static void GeneratePoissonDisk(const XMFLOAT2& aMinXZ, const XMFLOAT2& aMaxXZ, float aMinDistance, UINT aSeed, const ER_PlacementDensityMask& aDensityMask,
+			std::vector<XMFLOAT2>& aOutPoints, ER_JobSystem* aJobSystem = nullptr);
+
+		// Splat weight of the terrain channel as density (none below the threshold of the on-terrain placement)
+		static ER_PlacementDensityMask CreateSplatDensityMask(const ER_Terrain* aTerrain, int aSplatChannel);
+
+		static UINT CombineSeeds(UINT aSeed, UINT aValue);
+		static UINT GetSeedFromName(const std::string& aName);
+
+		// Determinism, spacing and density masks (see ER_Tests)
+		static bool RunTests(ER_JobSystem* aJobSystem);
+		// 1M points: uniform vs. blue noise on one thread vs. blue noise with the job system
+		static void Benchmark(ER_JobSystem* aJobSystem);
+	};
+}
@@ -96,7 +96,7 @@ namespace EveryRay_Core
 				rs, RENDERTOLIGHTPROBE_MAT_ROOT_DESCRIPTOR_TABLE_VERTEX_SRV_INDEX);
 		}
 
-		std::vector<ER_RHI_GPUResource*> resources;
+		ER_RHI_InlineArray<ER_RHI_GPUResource*, 5 + NUM_SHADOW_CASCADES> resources;
 		resources.push_back(aObj->GetTextureData(meshIndex).AlbedoMap);
 		resources.push_back(aObj->GetTextureData(meshIndex).NormalMap);
 		resources.push_back(aObj->GetTextureData(meshIndex).MetallicMap);
@@ -17,6 +17,8 @@
 #include "ER_Terrain.h"
 #include "ER_Settings.h"
 #include "ER_Scene.h"
+#include "ER_JobSystem.h"
+#include "ER_Placement.h"
 
 #define LOAD_OLD_INSTANCED_DATA_FOR_GPU_INDIRECT_OBJECTS 0 // uncommnet if you need to debug "direct" instancing code (old-way)
 #define ALLOW_ANY_QUALITY_TEXTURE_LOAD 1
@@ -50,6 +52,8 @@ namespace EveryRay_Core
 		mIndexInScene(index),
 		mCurrentTextureQuality((RenderingObjectTextureQuality)ER_Settings::TexturesQuality)
 	{
+		mTerrainProceduralSeed = ER_Placement::GetSeedFromName(pName);
+
 		mModel = mCore->AddOrGet3DModelFromCache(pModelPath, nullptr, true);
 		if (!mModel)
 		{
@@ -77,12 +81,7 @@ namespace EveryRay_Core
 		}
 
 		for (size_t i = 0; i < mMeshVertices[0].size(); i++)
-		{
-			for (size_t j = 0; j < mMeshVertices[0][i].size(); j++)
-			{
-				mMeshAllVertices[0].push_back(mMeshVertices[0][i][j]);
-			}
-		}
+			mMeshAllVertices[0].insert(mMeshAllVertices[0].end(), mMeshVertices[0][i].begin(), mMeshVertices[0][i].end());
 
 		mLocalAABB = mModel->GenerateAABB();
 		mGlobalAABB = mLocalAABB;
@@ -426,7 +425,7 @@ namespace EveryRay_Core
 		auto createIndexBuffer = [this, rhi](const ER_Mesh& aMesh, int meshIndex, int lod) {
 			mMeshRenderBuffers[lod][meshIndex]->IndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Index Buffer: " + mName + ", lod: " + std::to_string(lod) + ", mesh: " + std::to_string(meshIndex));
 			aMesh.CreateIndexBuffer(mMeshRenderBuffers[lod][meshIndex]->IndexBuffer);
-			mMeshRenderBuffers[lod][meshIndex]->IndicesCount = static_cast<UINT>(aMesh.Indices().size());
+			mMeshRenderBuffers[lod][meshIndex]->IndicesCount = aMesh.IndexCount();
 		};
 
 		{
@@ -484,6 +483,7 @@ namespace EveryRay_Core
 				return;
 			
 			{
+				std::lock_guard<std::mutex> lock(mObjectConstantBuffersMutex);
 				mObjectConstantBuffer.Data.World = XMMatrixTranspose(mTransformationMatrix);
 				mObjectConstantBuffer.Data.IndexOfRefraction = mIOR;
 				mObjectConstantBuffer.Data.CustomRoughness = mCustomRoughness;
@@ -565,24 +565,28 @@ namespace EveryRay_Core
 	{
 		mTransformationMatrix = mat;
 		ER_MatrixHelper::SetFloatArray(mTransformationMatrix, mEditorCurrentObjectTransformMatrix);
+		mIsTransformDirty = true;
 	}
 
 	void ER_RenderingObject::SetTranslation(float x, float y, float z)
 	{
 		mTransformationMatrix *= XMMatrixTranslation(x, y, z);
 		ER_MatrixHelper::SetFloatArray(mTransformationMatrix, mEditorCurrentObjectTransformMatrix);
+		mIsTransformDirty = true;
 	}
 
 	void ER_RenderingObject::SetScale(float x, float y, float z)
 	{
 		mTransformationMatrix *= XMMatrixScaling(x, y, z);
 		ER_MatrixHelper::SetFloatArray(mTransformationMatrix, mEditorCurrentObjectTransformMatrix);
+		mIsTransformDirty = true;
 	}
 
 	void ER_RenderingObject::SetRotation(float x, float y, float z)
 	{
 		mTransformationMatrix *= XMMatrixRotationRollPitchYaw(x, y, z);
 		ER_MatrixHelper::SetFloatArray(mTransformationMatrix, mEditorCurrentObjectTransformMatrix);
+		mIsTransformDirty = true;
 	}
 
 	// new instancing code
@@ -656,6 +660,31 @@ namespace EveryRay_Core
 			// dynamically update instance buffer
 			mCore->GetRHI()->UpdateBuffer(mMeshesInstanceBuffers[lod][i]->InstanceBuffer, mInstanceCountToRender[lod] == 0 ? nullptr : &instanceData[0], InstanceSize() * mInstanceCountToRender[lod]);
 		}
+		mUploadedInstancesCount += mInstanceCountToRender[lod];
+	}
+
+	// Uploads [firstInstance, lastInstance) of mInstanceData and keeps the rest of the buffer (or all the instances if the buffer is renamed by the driver)
+	void ER_RenderingObject::UpdateInstanceBufferRange(int lod, UINT firstInstance, UINT lastInstance)
+	{
+		if (!mIsLoaded || mIsIndirectlyRendered)
+			return;
+
+		assert(lod < mMeshesInstanceBuffers.size());
+
+		mInstanceCountToRender[lod] = static_cast<UINT>(mInstanceData[lod].size());
+		// this is the first write of the buffer in the frame, which discards it if the driver renames the buffer (see ER_RHI::UpdateBufferRange())
+		if (mCore->GetRHI()->GetDynamicBufferCopiesCount() == 1)
+		{
+			firstInstance = 0;
+			lastInstance = mInstanceCountToRender[lod];
+		}
+		lastInstance = std::min(lastInstance, mInstanceCountToRender[lod]);
+		if (firstInstance >= lastInstance)
+			return;
+
+		for (size_t i = 0; i < mMeshesCount[lod]; i++)
+			mCore->GetRHI()->UpdateBufferRange(mMeshesInstanceBuffers[lod][i]->InstanceBuffer, &mInstanceData[lod][firstInstance], InstanceSize() * firstInstance, InstanceSize() * (lastInstance - firstInstance));
+		mUploadedInstancesCount += lastInstance - firstInstance;
 	}
 
 	UINT ER_RenderingObject::InstanceSize() const
@@ -672,72 +701,59 @@ namespace EveryRay_Core
 
 		assert(!mIsIndirectlyRendered);
 
-		auto frustum = camera->GetFrustum();
-		auto cullFunction = [&frustum](ER_AABB& aabb) {
-			bool culled = false;
-			// start a loop through all frustum planes
-			for (int planeID = 0; planeID < 6; ++planeID)
-			{
-				XMVECTOR planeNormal = XMVectorSet(frustum.Planes()[planeID].x, frustum.Planes()[planeID].y, frustum.Planes()[planeID].z, 0.0f);
-				float planeConstant = frustum.Planes()[planeID].w;
-
-				XMFLOAT3 axisVert;
+		const ER_Frustum& frustum = camera->GetFrustum();
+		if (mIsInstanced)
+		{
+			const int currentLOD = 0; // no need to iterate through LODs (AABBs are shared between LODs, so culling results will be identical)
 
-				// x-axis
-				if (frustum.Planes()[planeID].x > 0.0f)
-					axisVert.x = aabb.first.x;
-				else
-					axisVert.x = aabb.second.x;
+			assert(mInstanceAABBsSoA.GetCount() == mInstanceCount);
+			mInstanceVisibleCount = ER_FrustumCulling::Cull(frustum, mInstanceAABBsSoA, mInstanceVisibleIndices, ER_Utility::MainCameraCPUCullingMode);
 
-				// y-axis
-				if (frustum.Planes()[planeID].y > 0.0f)
-					axisVert.y = aabb.first.y;
-				else
-					axisVert.y = aabb.second.y;
+			// we store a copy for future usages (storage is reused between frames)
+			mTempPostCullingInstanceData.resize(mInstanceVisibleCount);
+			for (UINT i = 0; i < mInstanceVisibleCount; i++)
+				mTempPostCullingInstanceData[i].World = mInstanceData[currentLOD][mInstanceVisibleIndices[i]].World;
 
-				// z-axis
-				if (frustum.Planes()[planeID].z > 0.0f)
-					axisVert.z = aabb.first.z;
-				else
-					axisVert.z = aabb.second.z;
+			// if we have lods, we will update instance buffers later in UpdateLODs()
+			if (GetLODCount() <= 1)
+				QueueInstanceBufferUpdate(mTempPostCullingInstanceData, 0);
+		}
+		else
+			mIsCulled = ER_FrustumCulling::IsCulled(frustum, mGlobalAABB);
+	}
 
+	bool ER_RenderingObject::IsInstanceCulled(int index) const
+	{
+		return !std::binary_search(mInstanceVisibleIndices.begin(), mInstanceVisibleIndices.begin() + mInstanceVisibleCount, static_cast<UINT>(index));
+	}
 
-				if (XMVectorGetX(XMVector3Dot(planeNormal, XMLoadFloat3(&axisVert))) + planeConstant > 0.0f)
-				{
-					culled = true;
-					// Skip remaining planes to check and move on 
-					break;
-				}
-			}
-			return culled;
-		};
+	void ER_RenderingObject::SetInstanceWorldMatrix(int index, const XMFLOAT4X4& world)
+	{
+		assert(index < static_cast<int>(mInstanceData[0].size()));
+		if (memcmp(&mInstanceData[0][index].World, &world, sizeof(XMFLOAT4X4)) == 0)
+			return;
 
-		assert(mInstanceCullingFlags.size() == mInstanceCount);
+		for (int lod = 0; lod < GetLODCount(); lod++)
+			mInstanceData[lod][index].World = world;
+		MarkInstanceDirty(index);
+	}
 
-		if (mIsInstanced)
-		{
-			XMMATRIX instanceWorldMatrix = XMMatrixIdentity();
-			const int currentLOD = 0; // no need to iterate through LODs (AABBs are shared between LODs, so culling results will be identical)
+	void ER_RenderingObject::MarkInstanceDirty(int index)
+	{
+		assert(index < static_cast<int>(mInstanceDirtyFlags.size()));
+		if (mInstanceDirtyFlags[index])
+			return;
 
-			mTempPostCullingInstanceData.clear();
-			{
-				std::vector<InstancedData> newInstanceData;
-				for (int instanceIndex = 0; instanceIndex < static_cast<int>(mInstanceCount); instanceIndex++)
-				{
-					instanceWorldMatrix = XMLoadFloat4x4(&(mInstanceData[currentLOD][instanceIndex].World));
-					mInstanceCullingFlags[instanceIndex] = cullFunction(mInstanceAABBs[instanceIndex]);
-					if (!mInstanceCullingFlags[instanceIndex])
-						newInstanceData.push_back(instanceWorldMatrix);
-				}
-				mTempPostCullingInstanceData = newInstanceData; //we store a copy for future usages
+		mInstanceDirtyFlags[index] = true;
+		mDirtyInstanceIndices.push_back(static_cast<UINT>(index));
+	}
 
-				// if we have lods, we will update instance buffers later in UpdateLODs()
-				if (GetLODCount() <= 1)
-					UpdateInstanceBuffer(mTempPostCullingInstanceData, 0);
-			}
-		}
-		else
-			mIsCulled = cullFunction(mGlobalAABB);
+	void ER_RenderingObject::MarkAllInstancesDirty()
+	{
+		mInstanceDirtyFlags.assign(mInstanceCount, true);
+		mDirtyInstanceIndices.resize(mInstanceCount);
+		for (UINT i = 0; i < mInstanceCount; i++)
+			mDirtyInstanceIndices[i] = i;
 	}
 
 	void ER_RenderingObject::StoreInstanceDataAfterTerrainPlacement()
@@ -747,22 +763,23 @@ namespace EveryRay_Core
 
 		assert(mTempInstancesPositions);
 		XMMATRIX worldMatrix = XMMatrixIdentity();
-		for (int lod = 0; lod < GetLODCount(); lod++)
+		ER_PlacementRandom random(mTerrainProceduralSeed, 1 /* transforms */);
+		for (int instanceI = 0; instanceI < static_cast<int>(mInstanceCount); instanceI++)
 		{
-			for (int instanceI = 0; instanceI < static_cast<int>(mInstanceCount); instanceI++)
-			{
-				float scale = ER_Utility::RandomFloat(mTerrainProceduralObjectMinScale, mTerrainProceduralObjectMaxScale);
-				float roll = ER_Utility::RandomFloat(mTerrainProceduralObjectMinRoll, mTerrainProceduralObjectMaxRoll);
-				float pitch = ER_Utility::RandomFloat(mTerrainProceduralObjectMinPitch, mTerrainProceduralObjectMaxPitch);
-				float yaw = ER_Utility::RandomFloat(mTerrainProceduralObjectMinYaw, mTerrainProceduralObjectMaxYaw);
-
-				worldMatrix = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationRollPitchYaw(pitch, yaw, roll);
-				ER_MatrixHelper::SetTranslation(worldMatrix, XMFLOAT3(mTempInstancesPositions[instanceI].x, mTempInstancesPositions[instanceI].y, mTempInstancesPositions[instanceI].z));
+			float scale = random.NextFloat(mTerrainProceduralObjectMinScale, mTerrainProceduralObjectMaxScale);
+			float roll = random.NextFloat(mTerrainProceduralObjectMinRoll, mTerrainProceduralObjectMaxRoll);
+			float pitch = random.NextFloat(mTerrainProceduralObjectMinPitch, mTerrainProceduralObjectMaxPitch);
+			float yaw = random.NextFloat(mTerrainProceduralObjectMinYaw, mTerrainProceduralObjectMaxYaw);
+
+			// same transform in all LODs
+			worldMatrix = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationRollPitchYaw(pitch, yaw, roll);
+			ER_MatrixHelper::SetTranslation(worldMatrix, XMFLOAT3(mTempInstancesPositions[instanceI].x, mTempInstancesPositions[instanceI].y, mTempInstancesPositions[instanceI].z));
+			for (int lod = 0; lod < GetLODCount(); lod++)
 				XMStoreFloat4x4(&(mInstanceData[lod][instanceI].World), worldMatrix);
-				worldMatrix = XMMatrixIdentity();
-			}
-			UpdateInstanceBuffer(mInstanceData[lod], lod);
 		}
+		for (int lod = 0; lod < GetLODCount(); lod++)
+			UpdateInstanceBuffer(mInstanceData[lod], lod);
+		MarkAllInstancesDirty();
 	}
 
 	XMFLOAT4 ER_RenderingObject::GetFurGravityStrength()
@@ -789,7 +806,14 @@ namespace EveryRay_Core
 			XMFLOAT4 currentPos;
 			ER_MatrixHelper::GetTranslation(XMLoadFloat4x4(&(XMFLOAT4X4(mEditorCurrentObjectTransformMatrix))), currentPos);
 
-			if (isOnInit)
+			if (isOnInit && terrain->IsCPUPlacementEnabled())
+			{
+				terrain->PlaceOnTerrainCPU(&currentPos, 1, (TerrainSplatChannels)mTerrainProceduralPlacementSplatChannel,
+					abs(mTerrainProceduralPlacementHeightDelta) < std::numeric_limits<float>::epsilon() ? FLT_MAX : mTerrainProceduralPlacementHeightDelta);
+				ER_MatrixHelper::SetTranslation(mTransformationMatrix, XMFLOAT3(currentPos.x, currentPos.y, currentPos.z));
+				SetTransformationMatrix(mTransformationMatrix);
+			}
+			else if (isOnInit)
 			{
 				DeleteObject(mInputPositionsOnTerrainBuffer);
 				DeleteObject(mOutputPositionsOnTerrainBuffer);
@@ -830,36 +854,49 @@ namespace EveryRay_Core
 				DeleteObjects(mTempInstancesPositions);
 				mTempInstancesPositions = new XMFLOAT4[mInstanceCount];
 
-				for (int instanceI = 0; instanceI < static_cast<int>(mInstanceCount); instanceI++)
+				// blue noise in the zone (denser on the terrain splat channel if there is one)
+				ER_PlacementDesc placementDesc;
+				placementDesc.MinXZ = XMFLOAT2(mTerrainProceduralZoneCenterPos.x - mTerrainProceduralZoneRadius, mTerrainProceduralZoneCenterPos.z - mTerrainProceduralZoneRadius);
+				placementDesc.MaxXZ = XMFLOAT2(mTerrainProceduralZoneCenterPos.x + mTerrainProceduralZoneRadius, mTerrainProceduralZoneCenterPos.z + mTerrainProceduralZoneRadius);
+				placementDesc.PointsCount = mInstanceCount;
+				placementDesc.Seed = mTerrainProceduralSeed;
+				placementDesc.DensityMask = ER_Placement::CreateSplatDensityMask(terrain, mTerrainProceduralPlacementSplatChannel);
+
+				std::vector<XMFLOAT4> positions;
+				ER_Placement::GeneratePoints(placementDesc, mTerrainProceduralZoneCenterPos.y, positions, mCore->GetJobSystem());
+				std::copy(positions.begin(), positions.end(), mTempInstancesPositions);
+
+				if (terrain->IsCPUPlacementEnabled())
 				{
-					mTempInstancesPositions[instanceI] = XMFLOAT4(
-						mTerrainProceduralZoneCenterPos.x + ER_Utility::RandomFloat(-mTerrainProceduralZoneRadius, mTerrainProceduralZoneRadius),
-						mTerrainProceduralZoneCenterPos.y,
-						mTerrainProceduralZoneCenterPos.z + ER_Utility::RandomFloat(-mTerrainProceduralZoneRadius, mTerrainProceduralZoneRadius), 1.0f);
+					terrain->PlaceOnTerrainCPU(mTempInstancesPositions, mInstanceCount, (TerrainSplatChannels)mTerrainProceduralPlacementSplatChannel,
+						abs(mTerrainProceduralPlacementHeightDelta) < std::numeric_limits<float>::epsilon() ? FLT_MAX : mTerrainProceduralPlacementHeightDelta, mCore->GetJobSystem());
+					StoreInstanceDataAfterTerrainPlacement();
 				}
+				else
+				{
+					DeleteObject(mInputPositionsOnTerrainBuffer);
+					DeleteObject(mOutputPositionsOnTerrainBuffer);
 
-				DeleteObject(mInputPositionsOnTerrainBuffer);
-				DeleteObject(mOutputPositionsOnTerrainBuffer);
+					mInputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject on-terrain placement input positions buffer: " + mName);
+					mInputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mTempInstancesPositions, mInstanceCount, sizeof(XMFLOAT4), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+					mOutputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject on-terrain placement input positions buffer: " + mName);
+					mOutputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mTempInstancesPositions, mInstanceCount, sizeof(XMFLOAT4), false, ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_BUFFER_STRUCTURED); //should be STAGING
+					terrain->PlaceOnTerrain(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mTempInstancesPositions, mInstanceCount, (TerrainSplatChannels)mTerrainProceduralPlacementSplatChannel,
+						nullptr, 0, abs(mTerrainProceduralPlacementHeightDelta) < std::numeric_limits<float>::epsilon() ? FLT_MAX : mTerrainProceduralPlacementHeightDelta);
 
-				mInputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject on-terrain placement input positions buffer: " + mName);
-				mInputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mTempInstancesPositions, mInstanceCount, sizeof(XMFLOAT4), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
-				mOutputPositionsOnTerrainBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject on-terrain placement input positions buffer: " + mName);
-				mOutputPositionsOnTerrainBuffer->CreateGPUBufferResource(rhi, mTempInstancesPositions, mInstanceCount, sizeof(XMFLOAT4), false, ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_BUFFER_STRUCTURED); //should be STAGING
-				terrain->PlaceOnTerrain(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mTempInstancesPositions, mInstanceCount, (TerrainSplatChannels)mTerrainProceduralPlacementSplatChannel,
-					nullptr, 0, abs(mTerrainProceduralPlacementHeightDelta) < std::numeric_limits<float>::epsilon() ? FLT_MAX : mTerrainProceduralPlacementHeightDelta);
-				
 #if !ER_PLATFORM_SUPPORTS_IMMEDIATE_CONTEXT
-				std::string eventName = "On-terrain placement callback - initialization of ER_RenderingObject: " + mName;
-				terrain->ReadbackPlacedPositionsOnInitEvent->AddListener(eventName, [&](ER_Terrain* aTerrain)
-					{
-						assert(aTerrain);
-						aTerrain->ReadbackPlacedPositions(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mTempInstancesPositions, mInstanceCount);
-						StoreInstanceDataAfterTerrainPlacement();
-					}
-				);
+					std::string eventName = "On-terrain placement callback - initialization of ER_RenderingObject: " + mName;
+					terrain->ReadbackPlacedPositionsOnInitEvent->AddListener(eventName, [&](ER_Terrain* aTerrain)
+						{
+							assert(aTerrain);
+							aTerrain->ReadbackPlacedPositions(mOutputPositionsOnTerrainBuffer, mInputPositionsOnTerrainBuffer, mTempInstancesPositions, mInstanceCount);
+							StoreInstanceDataAfterTerrainPlacement();
+						}
+					);
 #else
-				StoreInstanceDataAfterTerrainPlacement();
+					StoreInstanceDataAfterTerrainPlacement();
 #endif
+				}
 			}
 			else
 			{
@@ -870,6 +907,16 @@ namespace EveryRay_Core
 	}
 	void ER_RenderingObject::Update(const ER_CoreTime& time)
 	{
+		UpdateCPU(time);
+		UpdateGPU();
+	}
+
+	// CPU part of the update (AABBs, culling, LODs): does not touch RHI/ImGui, so it is safe to run for different objects in parallel.
+	// Instance buffer uploads are only queued here and flushed in UpdateGPU().
+	void ER_RenderingObject::UpdateCPU(const ER_CoreTime& time, ER_JobSystem* aJobSystem)
+	{
+		ER_PROFILE_SCOPE("ER_RenderingObject::UpdateCPU");
+
 		if (!mIsLoaded)
 			return;
 
@@ -878,6 +925,9 @@ namespace EveryRay_Core
 		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
 		assert(camera);
 
+		mUpdatedInstancesCount = 0;
+		mUploadedInstancesCount = 0;
+
 		bool isCurrentlyEditable = ER_Utility::IsEditorMode && mIsAvailableInEditorMode && mIsSelected;
 
 		if (isCurrentlyEditable && mIsInstanced)
@@ -891,45 +941,110 @@ namespace EveryRay_Core
 		//if (mIsTerrainPlacement && !mIsTerrainPlacementFinished)
 		//	PlaceProcedurallyOnTerrain();
 
-		//update AABBs (global and instanced)
+		//update AABBs (global and instanced) - only for the transforms that were modified
 		{
-			mGlobalAABB = mLocalAABB;
-			UpdateAABB(mGlobalAABB, mTransformationMatrix);
+			if (mIsTransformDirty)
+			{
+				mGlobalAABB = mLocalAABB;
+				UpdateAABB(mGlobalAABB, mTransformationMatrix);
+				mIsTransformDirty = false;
+			}
 
 			if (mIsInstanced && (!mIsIndirectlyRendered || (mIsIndirectlyRendered && !mIndirectOriginalInstanceDataBuffer)))
 			{
-				XMMATRIX instanceWorldMatrix = XMMatrixIdentity();
-				for (int instanceIndex = 0; instanceIndex < static_cast<int>(mInstanceCount); instanceIndex++)
+				auto updateInstanceAABB = [this](UINT dirtyIndex)
 				{
-					instanceWorldMatrix = XMLoadFloat4x4(&(mInstanceData[0][instanceIndex].World));
+					const UINT instanceIndex = mDirtyInstanceIndices[dirtyIndex];
 					mInstanceAABBs[instanceIndex] = mLocalAABB;
-					UpdateAABB(mInstanceAABBs[instanceIndex], instanceWorldMatrix);
+					UpdateAABB(mInstanceAABBs[instanceIndex], XMLoadFloat4x4(&(mInstanceData[0][instanceIndex].World)));
+					mInstanceAABBsSoA.Set(instanceIndex, mInstanceAABBs[instanceIndex]);
+				};
+
+				// big instance counts are split into ranges (every instance writes only to its own slots)
+				mUpdatedInstancesCount = static_cast<UINT>(mDirtyInstanceIndices.size());
+				if (aJobSystem && mUpdatedInstancesCount > INSTANCES_UPDATE_BATCH_SIZE)
+				{
+					ER_JobCounter counter;
+					aJobSystem->ParallelFor(mUpdatedInstancesCount, INSTANCES_UPDATE_BATCH_SIZE, updateInstanceAABB, &counter);
+					aJobSystem->Wait(counter);
+				}
+				else
+				{
+					for (UINT dirtyIndex = 0; dirtyIndex < mUpdatedInstancesCount; dirtyIndex++)
+						updateInstanceAABB(dirtyIndex);
 				}
 			}
 		}
 
-		if (mIsIndirectlyRendered)
-			CreateIndirectInstanceData(); // only happens once but we need to do it after the first update (i.e. after we placed the instances and calculated their AABBs)
-		else // fallback for old CPU frustum culling (i.e., makes sense for non-instanced objects)
+		if (!mIsIndirectlyRendered) // fallback for old CPU frustum culling (i.e., makes sense for non-instanced objects)
 		{
 			if (ER_Utility::IsMainCameraCPUCulling && camera)
+			{
 				PerformCPUFrustumCull(camera);
-			else
+				mIsInstanceBufferMirrored = false;
+				mInstanceBufferDirtyFramesLeft = 0;
+			}
+			else if (mIsInstanced && GetLODCount() <= 1)
 			{
 				// you can still use CPU culling of instances with buffer updates (for objects which do not use indirect rendering)
 				// however, this is left here mainly for legacy reason and potential debugging of indirect culling/rendering bugs
-				if (mIsInstanced)
+				// the buffer mirrors mInstanceData here, so we only upload the range of the modified transforms (if any)
+				if (!mIsInstanceBufferMirrored)
 				{
-					//just updating transforms (that could be changed in a previous frame); this is not optimal (GPU buffer map() every frame...)
-					for (int lod = 0; lod < GetLODCount(); lod++)
-						UpdateInstanceBuffer(mInstanceData[lod], lod);
+					mInstanceBufferDirtyBegin = 0;
+					mInstanceBufferDirtyEnd = mInstanceCount;
+					mInstanceBufferDirtyFramesLeft = mCore->GetRHI()->GetDynamicBufferCopiesCount();
+					mIsInstanceBufferMirrored = true;
 				}
+				else if (!mDirtyInstanceIndices.empty())
+				{
+					const auto minmax = std::minmax_element(mDirtyInstanceIndices.begin(), mDirtyInstanceIndices.end());
+					const bool isRangeEmpty = mInstanceBufferDirtyFramesLeft == 0;
+					mInstanceBufferDirtyBegin = isRangeEmpty ? *minmax.first : std::min(mInstanceBufferDirtyBegin, *minmax.first);
+					mInstanceBufferDirtyEnd = isRangeEmpty ? *minmax.second + 1 : std::max(mInstanceBufferDirtyEnd, *minmax.second + 1);
+					mInstanceBufferDirtyFramesLeft = mCore->GetRHI()->GetDynamicBufferCopiesCount();
+				}
+			}
+			else
+			{
+				mIsInstanceBufferMirrored = false; // instance buffers are rebuilt in UpdateLODs()
+				mInstanceBufferDirtyFramesLeft = 0;
 			}
 		}
 
+		for (UINT instanceIndex : mDirtyInstanceIndices)
+			mInstanceDirtyFlags[instanceIndex] = false;
+		mDirtyInstanceIndices.clear();
+
 		if (GetLODCount() > 1)
 			UpdateLODs();
+	}
+
+	// GPU part of the update: must be called from the main thread after UpdateCPU() (objects are processed in scene order, so the uploads are deterministic)
+	void ER_RenderingObject::UpdateGPU()
+	{
+		if (!mIsLoaded)
+			return;
+
+		if (mIsIndirectlyRendered)
+			CreateIndirectInstanceData(); // only happens once but we need to do it after the first update (i.e. after we placed the instances and calculated their AABBs)
+
+		for (int lod = 0; lod < MAX_LOD; lod++)
+		{
+			if (mPendingInstanceBufferUpdates[lod])
+			{
+				UpdateInstanceBuffer(*mPendingInstanceBufferUpdates[lod], lod);
+				mPendingInstanceBufferUpdates[lod] = nullptr;
+			}
+		}
 
+		if (mInstanceBufferDirtyFramesLeft > 0)
+		{
+			UpdateInstanceBufferRange(0, mInstanceBufferDirtyBegin, mInstanceBufferDirtyEnd);
+			mInstanceBufferDirtyFramesLeft--;
+		}
+
+		bool isCurrentlyEditable = ER_Utility::IsEditorMode && mIsAvailableInEditorMode && mIsSelected;
 		if (isCurrentlyEditable)
 		{
 			UpdateGizmosAndUI();
@@ -938,42 +1053,28 @@ namespace EveryRay_Core
 		}
 	}
 
-	void ER_RenderingObject::UpdateAABB(ER_AABB& aabb, const XMMATRIX& transformMatrix)
+	void ER_RenderingObject::QueueInstanceBufferUpdate(std::vector<InstancedData>& instanceData, int lod)
 	{
-		// computing AABB from the non-axis aligned BB
-		mCurrentGlobalAABBVertices[0] = (XMFLOAT3(aabb.first.x, aabb.second.y, aabb.first.z));
-		mCurrentGlobalAABBVertices[1] = (XMFLOAT3(aabb.second.x, aabb.second.y, aabb.first.z));
-		mCurrentGlobalAABBVertices[2] = (XMFLOAT3(aabb.second.x, aabb.first.y, aabb.first.z));
-		mCurrentGlobalAABBVertices[3] = (XMFLOAT3(aabb.first.x, aabb.first.y, aabb.first.z));
-		mCurrentGlobalAABBVertices[4] = (XMFLOAT3(aabb.first.x, aabb.second.y, aabb.second.z));
-		mCurrentGlobalAABBVertices[5] = (XMFLOAT3(aabb.second.x, aabb.second.y, aabb.second.z));
-		mCurrentGlobalAABBVertices[6] = (XMFLOAT3(aabb.second.x, aabb.first.y, aabb.second.z));
-		mCurrentGlobalAABBVertices[7] = (XMFLOAT3(aabb.first.x, aabb.first.y, aabb.second.z));
-
-		// non-axis-aligned BB (applying transform)
-		for (size_t i = 0; i < 8; i++)
-		{
-			XMVECTOR point = XMVector3Transform(XMLoadFloat3(&(mCurrentGlobalAABBVertices[i])), transformMatrix);
-			XMStoreFloat3(&(mCurrentGlobalAABBVertices[i]), point);
-		}
-
-		XMFLOAT3 minVertex = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
-		XMFLOAT3 maxVertex = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-
-		for (UINT i = 0; i < 8; i++)
-		{
-			//Get the smallest vertex 
-			minVertex.x = std::min(minVertex.x, mCurrentGlobalAABBVertices[i].x);    // Find smallest x value in model
-			minVertex.y = std::min(minVertex.y, mCurrentGlobalAABBVertices[i].y);    // Find smallest y value in model
-			minVertex.z = std::min(minVertex.z, mCurrentGlobalAABBVertices[i].z);    // Find smallest z value in model
-
-			//Get the largest vertex 
-			maxVertex.x = std::max(maxVertex.x, mCurrentGlobalAABBVertices[i].x);    // Find largest x value in model
-			maxVertex.y = std::max(maxVertex.y, mCurrentGlobalAABBVertices[i].y);    // Find largest y value in model
-			maxVertex.z = std::max(maxVertex.z, mCurrentGlobalAABBVertices[i].z);    // Find largest z value in model
-		}
+		assert(lod < MAX_LOD);
+		mPendingInstanceBufferUpdates[lod] = &instanceData; // the latest request wins, data is read during UpdateGPU()
+	}
 
-		aabb = ER_AABB(minVertex, maxVertex);
+	// Transforms the box by its center and extents (Arvo's method), so it does not need any scratch memory (thread-safe)
+	void ER_RenderingObject::UpdateAABB(ER_AABB& aabb, const XMMATRIX& transformMatrix)
+	{
+		XMVECTOR minVertex = XMLoadFloat3(&aabb.first);
+		XMVECTOR maxVertex = XMLoadFloat3(&aabb.second);
+		XMVECTOR center = XMVectorScale(XMVectorAdd(minVertex, maxVertex), 0.5f);
+		XMVECTOR extents = XMVectorScale(XMVectorSubtract(maxVertex, minVertex), 0.5f);
+
+		XMVECTOR newCenter = XMVector3Transform(center, transformMatrix);
+		XMVECTOR newExtents = XMVectorAdd(XMVectorAdd(
+			XMVectorMultiply(XMVectorSplatX(extents), XMVectorAbs(transformMatrix.r[0])),
+			XMVectorMultiply(XMVectorSplatY(extents), XMVectorAbs(transformMatrix.r[1]))),
+			XMVectorMultiply(XMVectorSplatZ(extents), XMVectorAbs(transformMatrix.r[2])));
+
+		XMStoreFloat3(&aabb.first, XMVectorSubtract(newCenter, newExtents));
+		XMStoreFloat3(&aabb.second, XMVectorAdd(newCenter, newExtents));
 	}
 	
 	void ER_RenderingObject::UpdateGizmosAndUI()
@@ -987,14 +1088,17 @@ namespace EveryRay_Core
 		ShowObjectsEditorWindow(mCameraViewMatrix, mCameraProjectionMatrix, mEditorCurrentObjectTransformMatrix);
 
 		XMFLOAT4X4 mat(mEditorCurrentObjectTransformMatrix);
-		mTransformationMatrix = XMLoadFloat4x4(&mat);
+		XMFLOAT4X4 currentMat;
+		XMStoreFloat4x4(&currentMat, mTransformationMatrix);
+		if (memcmp(&mat, &currentMat, sizeof(XMFLOAT4X4)) != 0)
+		{
+			mTransformationMatrix = XMLoadFloat4x4(&mat);
+			mIsTransformDirty = true;
+		}
 
 		//update instance world transform (from editor's gizmo/UI)
 		if (mIsInstanced && ER_Utility::IsEditorMode)
-		{
-			for (int lod = 0; lod < GetLODCount(); lod++)
-				mInstanceData[lod][mEditorSelectedInstancedObjectIndex].World = XMFLOAT4X4(mEditorCurrentObjectTransformMatrix);
-		}
+			SetInstanceWorldMatrix(mEditorSelectedInstancedObjectIndex, mat);
 	}
 	
 	void ER_RenderingObject::UpdateBitmaskFlags()
@@ -1104,7 +1208,7 @@ namespace EveryRay_Core
 				if (mIsInstanced)
 				{
 					name = mEditorInstancedNamesUI[mEditorSelectedInstancedObjectIndex] ? mEditorInstancedNamesUI[mEditorSelectedInstancedObjectIndex] : "Unknown Name";
-					if (mInstanceCullingFlags[mEditorSelectedInstancedObjectIndex]) //showing info for main LOD only in editor
+					if (IsInstanceCulled(mEditorSelectedInstancedObjectIndex)) //showing info for main LOD only in editor
 						name += " (Culled)";
 				}
 				else
@@ -1288,9 +1392,10 @@ namespace EveryRay_Core
 			if (ER_Utility::IsMainCameraCPUCulling && mTempPostCullingInstanceData.size() == 0)
 				return;
 
-			mTempPostLoddingInstanceData.clear();
-			for (int lod = 0; lod < GetLODCount(); lod++)
-				mTempPostLoddingInstanceData.push_back({});
+			// storage is reused between frames
+			mTempPostLoddingInstanceData.resize(GetLODCount());
+			for (auto& lodInstanceData : mTempPostLoddingInstanceData)
+				lodInstanceData.clear();
 
 			//traverse through original or culled instance data (sort of "read-only") to rebalance LOD's instance buffers
 			int length = (ER_Utility::IsMainCameraCPUCulling) ? static_cast<int>(mTempPostCullingInstanceData.size()) : static_cast<int>(mInstanceData[0].size());
@@ -1318,7 +1423,7 @@ namespace EveryRay_Core
 			}
 
 			for (int i = 0; i < GetLODCount(); i++)
-				UpdateInstanceBuffer(mTempPostLoddingInstanceData[i], i);
+				QueueInstanceBufferUpdate(mTempPostLoddingInstanceData[i], i);
 		}
 		else
 		{
@@ -1365,12 +1470,7 @@ namespace EveryRay_Core
 			mMeshVertices[lodIndex].push_back(mModelLODs[lodIndex - 1]->GetMesh(i).Vertices());
 
 		for (size_t i = 0; i < mMeshVertices[lodIndex].size(); i++)
-		{
-			for (size_t j = 0; j < mMeshVertices[lodIndex][i].size(); j++)
-			{
-				mMeshAllVertices[lodIndex].push_back(mMeshVertices[lodIndex][i][j]);
-			}
-		}
+			mMeshAllVertices[lodIndex].insert(mMeshAllVertices[lodIndex].end(), mMeshVertices[lodIndex][i].begin(), mMeshVertices[lodIndex][i].end());
 
 		LoadRenderBuffers(lodIndex);
 	}
@@ -1391,8 +1491,19 @@ namespace EveryRay_Core
 			mInstanceAABBs.clear();
 			mInstanceAABBs.resize(mInstanceCount, mLocalAABB);
 
-			mInstanceCullingFlags.clear();
-			mInstanceCullingFlags.resize(mInstanceCount, false);
+			mInstanceAABBsSoA.Resize(mInstanceCount);
+			for (UINT i = 0; i < mInstanceCount; i++)
+				mInstanceAABBsSoA.Set(i, mLocalAABB);
+
+			// everything is visible until the first culling
+			mInstanceVisibleIndices.resize(mInstanceCount);
+			for (UINT i = 0; i < mInstanceCount; i++)
+				mInstanceVisibleIndices[i] = i;
+			mInstanceVisibleCount = mInstanceCount;
+
+			// new data will be added, so all AABBs and the whole instance buffer need an update
+			MarkAllInstancesDirty();
+			mIsInstanceBufferMirrored = false;
 
 			if (!mIsIndirectlyRendered)
 			{
@@ -3,12 +3,14 @@
 #include "Common.h"
 #include "ER_GenericEvent.h"
 #include "ER_ModelMaterial.h"
+#include "ER_FrustumCulling.h"
 
 #include "RHI\ER_RHI.h"
 
 #define MAX_NAME_CHAR_LENGTH 100
 
 const UINT MAX_DIRECT_INSTANCE_COUNT = 20000; // max count for instances which are NOT GPU indirectly drawn
+const UINT INSTANCES_UPDATE_BATCH_SIZE = 1024; // instances per job when updating instance AABBs in parallel
 
 // Bitmasks for "RenderingObjectFlags" as decimal values
 // Keep in sync with content/shaders/Common.hlsli!
@@ -34,6 +36,7 @@ namespace EveryRay_Core
 	class ER_RenderableAABB;
 	class ER_Camera;
 	class ER_Model;
+	class ER_JobSystem;
 
 	enum RenderingObjectTextureQuality
 	{
@@ -167,7 +170,9 @@ namespace EveryRay_Core
 		void Draw(const std::string& materialName, bool toDepth = false, int meshIndex = -1);
 		void DrawLOD(const std::string& materialName, bool toDepth /*remove? probably legacy code that i don't remember anymore*/, int meshIndex, int lod, bool skipCulling = false);
 		void DrawAABB(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs);
-		void Update(const ER_CoreTime& time);
+		void Update(const ER_CoreTime& time); // UpdateCPU() + UpdateGPU()
+		void UpdateCPU(const ER_CoreTime& time, ER_JobSystem* aJobSystem = nullptr); // no RHI calls, can run in parallel for different objects
+		void UpdateGPU(); // main thread only: flushes the instance buffer uploads queued in UpdateCPU(), editor gizmos/UI
 
 		std::map<std::string, ER_Material*>& GetMaterials() { return mMaterials; }
 		
@@ -185,6 +190,15 @@ namespace EveryRay_Core
 		ER_AABB& GetLocalAABB() { return mLocalAABB; } //local space (no transforms)
 		ER_AABB& GetGlobalAABB() { return mGlobalAABB; } //world space (with transforms)
 		ER_AABB& GetInstanceAABB(int index) { return mInstanceAABBs[index]; } //world space (with transforms)
+		bool IsInstanceCulled(int index) const; // result of the last CPU frustum culling
+
+		// Instances are only re-processed (AABBs, buffer uploads) when they are marked as dirty.
+		// Call MarkInstanceDirty()/MarkAllInstancesDirty() after modifying GetInstancesData() directly (main thread only, not during UpdateCPU()).
+		void SetInstanceWorldMatrix(int index, const XMFLOAT4X4& world); // all LODs
+		void MarkInstanceDirty(int index);
+		void MarkAllInstancesDirty();
+		UINT GetUpdatedInstancesCount() const { return mUpdatedInstancesCount; } // instances with recomputed AABBs in the last update
+		UINT GetUploadedInstancesCount() const { return mUploadedInstancesCount; } // instances written to the GPU buffers in the last update
 
 		void SetTransformationMatrix(const XMMATRIX& mat);
 		void SetTranslation(float x, float y, float z);
@@ -254,6 +268,8 @@ namespace EveryRay_Core
 		void SetTerrainProceduralObjectsMinMaxYaw(float minYaw, float maxYaw) { mTerrainProceduralObjectMinYaw = XMConvertToRadians(minYaw); mTerrainProceduralObjectMaxYaw = XMConvertToRadians(maxYaw); }
 		void SetTerrainProceduralObjectsMinMaxPitch(float minPitch, float maxPitch) { mTerrainProceduralObjectMinPitch = XMConvertToRadians(minPitch); mTerrainProceduralObjectMaxPitch = XMConvertToRadians(maxPitch); }
 		void SetTerrainProceduralObjectsMinMaxRoll(float minRoll, float maxRoll) { mTerrainProceduralObjectMinRoll = XMConvertToRadians(minRoll); mTerrainProceduralObjectMaxRoll = XMConvertToRadians(maxRoll); }
+		void SetTerrainProceduralSeed(UINT seed) { mTerrainProceduralSeed = seed; }
+		UINT GetTerrainProceduralSeed() { return mTerrainProceduralSeed; }
 
 		void SetReflective(bool value) { mIsReflective = value; }
 		bool IsReflective() { return mIsReflective; }
@@ -361,6 +377,8 @@ namespace EveryRay_Core
 		bool IsLoaded() { return mIsLoaded; }
 	private:
 		void UpdateAABB(ER_AABB& aabb, const XMMATRIX& transformMatrix);
+		void QueueInstanceBufferUpdate(std::vector<InstancedData>& instanceData, int lod);
+		void UpdateInstanceBufferRange(int lod, UINT firstInstance, UINT lastInstance);
 		void LoadTexture(ER_RHI_GPUTexture** aTexture, bool* loadStat, const std::wstring& path, int meshIndex, bool isPlaceholder = false);
 		void CreateInstanceBuffer(InstancedData* instanceData, UINT instanceCount, ER_RHI_GPUBuffer* instanceBuffer);
 		
@@ -376,11 +394,12 @@ namespace EveryRay_Core
 
 		ER_RHI_GPUConstantBuffer<ObjectCB>						mObjectConstantBuffer;
 		ER_RHI_GPUConstantBuffer<ObjectFakeRootCB>				mObjectFakeRootConstantBuffer; // for platforms where root constants aren't supported
+		std::mutex												mObjectConstantBuffersMutex; // shadow cascades can draw the object in parallel (see ER_ShadowMapper::Draw())
 
 		///****************************************************************************************************************************
 		// *** mesh/model data (buffers, textures, etc.) ***
 		std::vector<TextureData>								mMeshesTextureBuffers;
-		std::vector<std::vector<std::vector<XMFLOAT3>>>			mMeshVertices; // vertices per mesh, per LOD group
+		std::vector<std::vector<ER_Span<XMFLOAT3>>>			mMeshVertices; // vertices per mesh (views of the model's streams), per LOD group
 		std::vector<std::vector<RenderBufferData*>>				mMeshRenderBuffers; // vertex/index buffers per mesh, per LOD group
 		std::vector<std::vector<InstanceBufferData*>>			mMeshesInstanceBuffers; // instance buffers per mesh, per LOD group
 		std::vector<std::vector<XMFLOAT3>>						mMeshAllVertices; // vertices of all meshes combined, per LOD group
@@ -396,9 +415,20 @@ namespace EveryRay_Core
 		// *** instancing data (counters, transforms etc.) ***
 		UINT													mInstanceCount = 0;
 		std::vector<ER_AABB>									mInstanceAABBs; // collection of AABBs for every instance (shared for LODs)
-		std::vector<bool>										mInstanceCullingFlags; // collection of culling flags for every instance (vector is lame here btw...)
+		ER_AABBArray											mInstanceAABBsSoA; // same as mInstanceAABBs but in SoA layout (for SIMD culling)
+		std::vector<UINT>										mInstanceVisibleIndices; // indices of instances that passed CPU culling (ascending, first mInstanceVisibleCount are valid)
+		UINT													mInstanceVisibleCount = 0;
 		std::vector<InstancedData>								mTempPostCullingInstanceData; // temp instance data after CPU culling
 		std::vector<std::vector<InstancedData>>					mTempPostLoddingInstanceData; // temp instance data after lodding (per LOD group)
+		std::vector<InstancedData>*								mPendingInstanceBufferUpdates[MAX_LOD] = {}; // uploads queued in UpdateCPU() for UpdateGPU()
+		std::vector<bool>										mInstanceDirtyFlags;
+		std::vector<UINT>										mDirtyInstanceIndices; // instances modified since the last UpdateCPU()
+		UINT													mInstanceBufferDirtyBegin = 0; // [begin, end) range of instances to upload in UpdateGPU() (when buffer mirrors mInstanceData)
+		UINT													mInstanceBufferDirtyEnd = 0;
+		int														mInstanceBufferDirtyFramesLeft = 0; // the range is written once for every CPU-visible copy of the buffer
+		bool													mIsInstanceBufferMirrored = false; // false if the buffer holds culled/LODed data
+		UINT													mUpdatedInstancesCount = 0;
+		UINT													mUploadedInstancesCount = 0;
 		std::vector<UINT>										mInstanceCountToRender; //instance render count  (per LOD group)
 		std::vector<std::vector<InstancedData>>					mInstanceData; //original instance data  (per LOD group)
 		XMFLOAT4*												mTempInstancesPositions = nullptr;
@@ -432,6 +462,7 @@ namespace EveryRay_Core
 		float													mTerrainProceduralObjectMaxPitch = 0.0f;
 		float													mTerrainProceduralObjectMinYaw = 0.0f;
 		float													mTerrainProceduralObjectMaxYaw = 0.0f;
+		UINT													mTerrainProceduralSeed = 0; // same seed - same positions, scales and rotations of the instances (from the name by default)
 		bool													mIsTerrainPlacementFinished = false;
 		bool													mIsTerrainPlacement = false; //possible/wanted or not
 		///****************************************************************************************************************************
@@ -459,13 +490,13 @@ namespace EveryRay_Core
 
 		ER_AABB													mLocalAABB; //mesh space AABB
 		ER_AABB													mGlobalAABB; //world space AABB
-		XMFLOAT3												mCurrentGlobalAABBVertices[8];
 		ER_RenderableAABB*										mDebugGizmoAABB = nullptr;
 	
 		std::string												mName;
 		int														mIndexInScene = -1;
 		int														mCurrentLODIndex = 0; //only used for non-instanced object
 		bool													mIsAABBDebugEnabled = true;
+		bool													mIsTransformDirty = true; // global AABB needs to be recomputed
 		bool													mIsAvailableInEditorMode = false;
 		bool													mIsSelected = false;
 		bool													mIsRendered = true;
@@ -12,14 +12,20 @@
 #include "ER_Editor.h"
 #include "ER_QuadRenderer.h"
 #include "ER_Model.h"
+#include "ER_MeshCache.h"
+#include "ER_Tests.h"
+#include "RHI\ER_RHI_Span.h"
+#include "RHI\Null\ER_RHI_Null.h"
 
 #include "..\JsonCpp\include\json\json.h"
 
+#include <algorithm>
+
+#define HEADLESS_WARMUP_FRAMES 2 // not measured in RunHeadless(): they create PSOs/buffers lazily and get the commands recorded while loading
+
 namespace EveryRay_Core
 {
 	static int currentLevel = 0;
-	static std::mutex renderingObjectsTextureCacheMutex;
-	static std::mutex renderingObjects3DModelsCacheMutex;
 
 	ER_RuntimeCore::ER_RuntimeCore(ER_RHI* aRHI, HINSTANCE instance, const std::wstring& windowClass, const std::wstring& windowTitle, int showCommand, bool isFullscreen)
 		: ER_Core(aRHI, instance, windowClass, windowTitle, showCommand, isFullscreen),
@@ -29,7 +35,9 @@ namespace EveryRay_Core
 		mGamepad(nullptr),
 		mShowProfiler(false),
 		mEditor(nullptr),
-		mQuadRenderer(nullptr)
+		mQuadRenderer(nullptr),
+		mRenderingObjectsTextureCache(GetJobSystem()),
+		mRenderingObjects3DModelsCache(GetJobSystem())
 	{
 		LoadGraphicsConfig();
 
@@ -45,10 +53,14 @@ namespace EveryRay_Core
 
 	ER_RuntimeCore::~ER_RuntimeCore()
 	{
+		mRenderingObjects3DModelsCache.ForEach([](const std::string& aPath, ER_Model*& aModel) { DeleteObject(aModel); });
+		mRenderingObjects3DModelsCache.Clear();
 	}
 
 	void ER_RuntimeCore::Initialize()
 	{
+		ER_PROFILE_SCOPE("ER_RuntimeCore::Initialize");
+
 		{
 			if (FAILED(DirectInput8Create(mInstance, DIRECTINPUT_VERSION, IID_IDirectInput8, (LPVOID*)&mDirectInput, nullptr)))
 			{
@@ -124,7 +136,7 @@ namespace EveryRay_Core
 
 		ER_Core::Initialize();
 		LoadGlobalLevelsConfig();
-		SetLevel(mStartupSceneName, true);
+		SetLevel(mHeadlessSceneName.empty() ? mStartupSceneName : mHeadlessSceneName, true);
 	}
 
 	void ER_RuntimeCore::LoadGlobalLevelsConfig()
@@ -237,11 +249,11 @@ namespace EveryRay_Core
 			DeleteObject(mCurrentSandbox);
 		}
 
-		for (auto& it : mRenderingObjectsTextureCache)
-			DeleteObject(it.second);
-		mRenderingObjectsTextureCache.erase(mRenderingObjectsTextureCache.begin(), mRenderingObjectsTextureCache.end());
+		mRenderingObjectsTextureCache.ForEach([](const std::wstring& aPath, ER_RHI_GPUTexture*& aTexture) { DeleteObject(aTexture); });
+		mRenderingObjectsTextureCache.Clear();
 
-		mRenderingObjects3DModelsCache.erase(mRenderingObjects3DModelsCache.begin(), mRenderingObjects3DModelsCache.end());
+		mRenderingObjects3DModelsCache.ForEach([](const std::string& aPath, ER_Model*& aModel) { DeleteObject(aModel); });
+		mRenderingObjects3DModelsCache.Clear();
 
 		if (mRHI && !isFirstLoad)
 		{
@@ -264,6 +276,7 @@ namespace EveryRay_Core
 
 	void ER_RuntimeCore::Update(const ER_CoreTime& gameTime)
 	{
+		ER_PROFILE_SCOPE("ER_RuntimeCore::Update");
 		assert(mCurrentSandbox);
 		if (mIsRHIReset)
 			mIsRHIReset = false;
@@ -320,6 +333,14 @@ namespace EveryRay_Core
 			{
 				ImGui::TextColored(ImVec4(0.95f, 0.5f, 0.0f, 1), "CPU Render: %f ms", mElapsedTimeRenderCPU.count() * 1000);
 				ImGui::TextColored(ImVec4(0.95f, 0.5f, 0.0f, 1), "CPU Update: %f ms", mElapsedTimeUpdateCPU.count() * 1000);
+				if (mRHI)
+				{
+					const ER_RHI_PSOStats& psoStats = mRHI->GetPSOStats();
+					ImGui::Text("PSO: %u lookups by name, %u sets, %u switches, %u redundant sets skipped", psoStats.lookups, psoStats.sets, psoStats.switches, psoStats.redundantSets);
+					if (ER_RHI_AllocationsCounter::IsEnabled())
+						ImGui::Text("Heap allocations in sandbox draw: %llu", mElapsedRenderAllocationsCount);
+				}
+				CPUProfiler()->ShowImGui();
 			}
 			
 			if (ImGui::CollapsingHeader("Load level"))
@@ -364,6 +385,7 @@ namespace EveryRay_Core
 	
 	void ER_RuntimeCore::Draw(const ER_CoreTime& gameTime)
 	{
+		ER_PROFILE_SCOPE("ER_RuntimeCore::Draw");
 		assert(mCurrentSandbox);
 		assert(mRHI);
 
@@ -382,123 +404,314 @@ namespace EveryRay_Core
 		mRHI->SetRasterizerState(ER_RHI_RASTERIZER_STATE::ER_NO_CULLING);
 		mRHI->SetBlendState(ER_RHI_BLEND_STATE::ER_NO_BLEND);
 
+		const UINT64 startAllocationsCount = ER_RHI_AllocationsCounter::GetCount();
 		mCurrentSandbox->Draw(*this, gameTime);
+		mElapsedRenderAllocationsCount = ER_RHI_AllocationsCounter::GetCount() - startAllocationsCount;
 
 		mRHI->TransitionMainRenderTargetToPresent();
 		mRHI->EndGraphicsCommandList();
 		mRHI->ExecuteCommandLists();
 		mRHI->PresentGraphics();
+		mRHI->EndPSOStatsFrame();
 
 		auto endRenderTimer = std::chrono::high_resolution_clock::now();
 		mElapsedTimeRenderCPU = endRenderTimer - startRenderTimer;
 	}
 
-	ER_Model* ER_RuntimeCore::AddOrGet3DModelFromCache(const std::string& aFullPath, bool* didExist /*= nullptr*/, bool isSilent /*= false*/)
+	// Same frame as in ER_Core::Run(), but a fixed number of them and without waiting for window messages, so it can run on build machines with ER_RHI_Null.
+	// The window is still created (hidden by the caller): input and ImGui need one. The first HEADLESS_WARMUP_FRAMES frames are not measured.
+	// Reports per frame: CPU time of every profiler zone (aggregated by name over all threads), heap allocations and the commands recorded by the null RHI.
+	void ER_RuntimeCore::RunHeadless(const std::string& aSceneName, UINT aFramesCount)
 	{
-		const std::lock_guard<std::mutex> lock(renderingObjects3DModelsCacheMutex);
-		
-		auto it = mRenderingObjects3DModelsCache.find(aFullPath);
-		if (it != mRenderingObjects3DModelsCache.end())
+		mHeadlessSceneName = aSceneName;
+
+		InitializeWindow();
+		if (!mRHI->Initialize(mWindowHandle, mScreenWidth, mScreenHeight, mIsFullscreen))
+			throw ER_CoreException("Could not initialize RHI or it is null!");
+		Initialize();
+
+		ER_RHI_Null* nullRHI = (mRHI->GetAPI() == ER_GRAPHICS_API::NULL_RHI) ? static_cast<ER_RHI_Null*>(mRHI) : nullptr;
+
+		struct ZoneTotals
 		{
-			if (didExist)
-				*didExist = true;
-			return &(it->second);
-		}
-		else
+			double TotalMs = 0.0;
+			UINT64 CallsCount = 0;
+		};
+		std::map<std::string, ZoneTotals> zones;
+		ER_RHI_NullFrameStats rhiTotals;
+		double updateTotalMs = 0.0;
+		double renderTotalMs = 0.0;
+		double maxFrameMs = 0.0;
+		UINT64 allocationsTotal = 0;
+		UINT64 drawAllocationsTotal = 0;
+		UINT measuredFramesCount = 0;
+
+		MSG message;
+		ZeroMemory(&message, sizeof(message));
+
+		mCoreClock.Reset();
+		for (UINT frame = 0; frame < aFramesCount && message.message != WM_QUIT; frame++)
 		{
-			if (didExist)
-				*didExist = false;
+			while (message.message != WM_QUIT && PeekMessage(&message, nullptr, 0, 0, PM_REMOVE))
+			{
+				TranslateMessage(&message);
+				DispatchMessage(&message);
+			}
+
+			const UINT64 startAllocationsCount = ER_RHI_AllocationsCounter::GetCount();
+			mCoreClock.UpdateGameTime(mCoreTime);
+			Update(mCoreTime);
+			Draw(mCoreTime);
+			const UINT64 allocationsCount = ER_RHI_AllocationsCounter::GetCount() - startAllocationsCount;
+
+			mCPUProfiler->EndFrame(mFrameIndex);
+			mFrameIndex++;
 
-			auto result = mRenderingObjects3DModelsCache.emplace(std::piecewise_construct,
-				std::forward_as_tuple(aFullPath), std::forward_as_tuple(*this, aFullPath, true, isSilent)); // this is ugly and we might consider updating to c++17 (try_emplace)
-			if (!result.first->second.IsLoaded())
+			if (frame < HEADLESS_WARMUP_FRAMES)
+				continue;
+			measuredFramesCount++;
+
+			const double updateMs = mElapsedTimeUpdateCPU.count() * 1000.0;
+			const double renderMs = mElapsedTimeRenderCPU.count() * 1000.0;
+			updateTotalMs += updateMs;
+			renderTotalMs += renderMs;
+			maxFrameMs = std::max(maxFrameMs, updateMs + renderMs);
+			allocationsTotal += allocationsCount;
+			drawAllocationsTotal += mElapsedRenderAllocationsCount;
+
+			if (!mCPUProfiler->GetFrames().empty())
 			{
-				std::string msg = "[ER Logger][ER_Core] Error! Could not load a new 3D model to models cache: " + aFullPath + '\n';
-				ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+				for (const ER_CPUProfilerThreadFrame& thread : mCPUProfiler->GetFrames().back().Threads)
+				{
+					for (const ER_CPUProfilerNode& node : thread.Tree)
+					{
+						ZoneTotals& zone = zones[node.Name];
+						zone.TotalMs += node.TotalMs;
+						zone.CallsCount += node.CallsCount;
+					}
+				}
+			}
 
-				mRenderingObjects3DModelsCache.erase(aFullPath);
+			if (nullRHI)
+			{
+				const ER_RHI_NullFrameStats& stats = nullRHI->GetLastFrameStats();
+				for (int i = 0; i < ER_NULL_CMD_COUNT; i++)
+					rhiTotals.commands[i] += stats.commands[i];
+				rhiTotals.draws += stats.draws;
+				rhiTotals.dispatches += stats.dispatches;
+				rhiTotals.bindCalls += stats.bindCalls;
+				rhiTotals.boundObjects += stats.boundObjects;
+				rhiTotals.stateChanges += stats.stateChanges;
+				rhiTotals.transitions += stats.transitions;
+				rhiTotals.bufferUpdates += stats.bufferUpdates;
+				rhiTotals.bufferUpdateBytes += stats.bufferUpdateBytes;
+				rhiTotals.commandStreamBytes += stats.commandStreamBytes;
+			}
+		}
 
-				return nullptr;
+		if (measuredFramesCount == 0)
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RuntimeCore] Headless run: no frames were measured, run more frames than HEADLESS_WARMUP_FRAMES. \n");
+		}
+		else
+		{
+			const double framesCount = static_cast<double>(measuredFramesCount);
+			std::vector<std::pair<std::string, ZoneTotals>> sortedZones(zones.begin(), zones.end());
+			std::sort(sortedZones.begin(), sortedZones.end(), [](const std::pair<std::string, ZoneTotals>& a, const std::pair<std::string, ZoneTotals>& b) { return a.second.TotalMs > b.second.TotalMs; });
+
+			Json::Value root;
+			root["scene"] = aSceneName;
+			root["rhi"] = nullRHI ? "null" : (mRHI->GetAPI() == ER_GRAPHICS_API::DX11 ? "dx11" : "dx12");
+			root["measured_frames"] = measuredFramesCount;
+			root["warmup_frames"] = HEADLESS_WARMUP_FRAMES;
+			root["update_ms"] = updateTotalMs / framesCount;
+			root["render_ms"] = renderTotalMs / framesCount;
+			root["max_frame_ms"] = maxFrameMs;
+			if (ER_RHI_AllocationsCounter::IsEnabled())
+			{
+				root["allocations"] = static_cast<double>(allocationsTotal) / framesCount;
+				root["sandbox_draw_allocations"] = static_cast<double>(drawAllocationsTotal) / framesCount;
 			}
-			else
+			if (nullRHI)
 			{
-				std::string msg = "[ER Logger][ER_Core] Added new 3D model to models cache: " + aFullPath + '\n';
-				ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+				Json::Value& rhiRoot = root["rhi_commands"];
+				rhiRoot["draws"] = rhiTotals.draws / framesCount;
+				rhiRoot["dispatches"] = rhiTotals.dispatches / framesCount;
+				rhiRoot["bind_calls"] = rhiTotals.bindCalls / framesCount;
+				rhiRoot["bound_objects"] = rhiTotals.boundObjects / framesCount;
+				rhiRoot["state_changes"] = rhiTotals.stateChanges / framesCount;
+				rhiRoot["pso_switches"] = rhiTotals.commands[ER_NULL_CMD_SET_PSO] / framesCount;
+				rhiRoot["transitions"] = rhiTotals.transitions / framesCount;
+				rhiRoot["buffer_updates"] = rhiTotals.bufferUpdates / framesCount;
+				rhiRoot["buffer_update_bytes"] = static_cast<double>(rhiTotals.bufferUpdateBytes) / framesCount;
+				rhiRoot["command_stream_bytes"] = static_cast<double>(rhiTotals.commandStreamBytes) / framesCount;
+			}
+			for (const auto& zone : sortedZones)
+			{
+				Json::Value zoneRoot;
+				zoneRoot["name"] = zone.first;
+				zoneRoot["ms"] = zone.second.TotalMs / framesCount;
+				zoneRoot["calls"] = static_cast<double>(zone.second.CallsCount) / framesCount;
+				root["zones"].append(zoneRoot);
+			}
 
-				return &(result.first->second);
+			std::wstring msg = L"[ER Logger][ER_RuntimeCore] Headless run of " + ER_Utility::ToWideString(aSceneName) + L": " + std::to_wstring(measuredFramesCount) +
+				L" frames, per frame: update " + std::to_wstring(updateTotalMs / framesCount) + L"ms, render " + std::to_wstring(renderTotalMs / framesCount) + L"ms (max frame " +
+				std::to_wstring(maxFrameMs) + L"ms), heap allocations " + (ER_RHI_AllocationsCounter::IsEnabled() ? std::to_wstring(allocationsTotal / measuredFramesCount) : std::wstring(L"not counted")) + L"\n";
+			ER_OUTPUT_LOG(msg.c_str());
+			if (nullRHI)
+			{
+				msg = L"[ER Logger][ER_RuntimeCore] Headless run, recorded per frame: " + std::to_wstring(rhiTotals.draws / measuredFramesCount) + L" draws, " +
+					std::to_wstring(rhiTotals.dispatches / measuredFramesCount) + L" dispatches, " + std::to_wstring(rhiTotals.bindCalls / measuredFramesCount) + L" bind calls (" +
+					std::to_wstring(rhiTotals.boundObjects / measuredFramesCount) + L" objects), " + std::to_wstring(rhiTotals.transitions / measuredFramesCount) + L" transitions, " +
+					std::to_wstring(rhiTotals.bufferUpdates / measuredFramesCount) + L" buffer updates (" + std::to_wstring(rhiTotals.bufferUpdateBytes / measuredFramesCount / 1024) + L"KB)\n";
+				ER_OUTPUT_LOG(msg.c_str());
+			}
+			for (size_t i = 0; i < sortedZones.size() && i < 20; i++)
+			{
+				msg = L"[ER Logger][ER_RuntimeCore]     " + ER_Utility::ToWideString(sortedZones[i].first) + L": " + std::to_wstring(sortedZones[i].second.TotalMs / framesCount) + L"ms\n";
+				ER_OUTPUT_LOG(msg.c_str());
 			}
+
+			const std::string reportPath = ER_Utility::GetFilePath("headless_report_" + aSceneName + ".json");
+			Json::StreamWriterBuilder builder;
+			std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+			std::ofstream file_id;
+			file_id.open(reportPath.c_str());
+			writer->write(root, &file_id);
 		}
 
-		return nullptr;
+		Shutdown();
 	}
 
-	ER_RHI_GPUTexture* ER_RuntimeCore::AddOrGetGPUTextureFromCache(const std::wstring& aFullPath, bool* didExist, bool is3D /*= false*/, bool skipFallback /*= false*/, bool* statusFlag /*= nullptr*/, bool isSilent /*= false*/)
+	int ER_RuntimeCore::RunTests(const std::string& aSceneName, bool aRunBenchmarks)
 	{
-		const std::lock_guard<std::mutex> lock(renderingObjectsTextureCacheMutex);
+		mHeadlessSceneName = aSceneName;
 
-		auto it = mRenderingObjectsTextureCache.find(aFullPath);
-		if (it != mRenderingObjectsTextureCache.end())
-		{
-			if (didExist)
-				*didExist = true;
-			return it->second;
-		}
-		else
-		{
-			if (didExist)
-				*didExist = false;
+		InitializeWindow();
+		if (!mRHI->Initialize(mWindowHandle, mScreenWidth, mScreenHeight, mIsFullscreen))
+			throw ER_CoreException("Could not initialize RHI or it is null!");
+		Initialize();
 
-			auto result = mRenderingObjectsTextureCache.emplace(aFullPath, mRHI->CreateGPUTexture(aFullPath));
-			result.first->second->CreateGPUTextureResource(mRHI, aFullPath, true, is3D, skipFallback, statusFlag, isSilent);
-			if (statusFlag && *statusFlag == false)
+		const int failedCount = ER_Tests::RunScene(*this);
+		if (aRunBenchmarks)
+			ER_Tests::RunSceneBenchmarks(*this);
+
+		Shutdown();
+		return failedCount;
+	}
+
+	// Only the RHI is initialized (no level, input or ImGui): models are imported twice, without and with the mesh cache, and their import times are logged
+	void ER_RuntimeCore::RunMeshCacheBenchmark(const std::string& aDirectory)
+	{
+		InitializeWindow();
+		if (!mRHI->Initialize(mWindowHandle, mScreenWidth, mScreenHeight, mIsFullscreen))
+			throw ER_CoreException("Could not initialize RHI or it is null!");
+
+		ER_MeshCache::BenchmarkImport(*this, aDirectory);
+
+		ER_Core::Shutdown();
+	}
+
+	// Same as RunMeshCacheBenchmark(): models are imported by assimp (without the mesh cache) and their optimization stats are logged
+	void ER_RuntimeCore::RunMeshOptimizerReport(const std::string& aDirectory)
+	{
+		InitializeWindow();
+		if (!mRHI->Initialize(mWindowHandle, mScreenWidth, mScreenHeight, mIsFullscreen))
+			throw ER_CoreException("Could not initialize RHI or it is null!");
+
+		ER_Model::ReportOptimization(*this, aDirectory);
+
+		ER_Core::Shutdown();
+	}
+
+	// Models are imported outside of any lock, so different models can be imported in parallel (i.e., by job system workers during scene loading).
+	// If a model is being imported by another thread, we wait for it instead of importing it twice (see ER_ConcurrentCache).
+	ER_Model* ER_RuntimeCore::AddOrGet3DModelFromCache(const std::string& aFullPath, bool* didExist /*= nullptr*/, bool isSilent /*= false*/)
+	{
+		ER_PROFILE_SCOPE("ER_RuntimeCore::AddOrGet3DModelFromCache");
+		return mRenderingObjects3DModelsCache.GetOrAdd(aFullPath, [this, &aFullPath, isSilent]() -> ER_Model*
+		{
+			ER_Model* model = new ER_Model(*this, aFullPath, true, isSilent);
+			if (!model->IsLoaded())
 			{
-				DeleteObject(result.first->second);
-				mRenderingObjectsTextureCache.erase(aFullPath);
+				std::string msg = "[ER Logger][ER_Core] Error! Could not load a new 3D model to models cache: " + aFullPath + '\n';
+				ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+
+				DeleteObject(model);
 				return nullptr;
 			}
-			else
+
+			std::string msg = "[ER Logger][ER_Core] Added new 3D model to models cache: " + aFullPath + '\n';
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(msg).c_str());
+			return model;
+		}, didExist);
+	}
+
+	// Same as for models: textures are loaded outside of any lock, and concurrent requests for the same texture wait for the first one.
+	ER_RHI_GPUTexture* ER_RuntimeCore::AddOrGetGPUTextureFromCache(const std::wstring& aFullPath, bool* didExist, bool is3D /*= false*/, bool skipFallback /*= false*/, bool* statusFlag /*= nullptr*/, bool isSilent /*= false*/)
+	{
+		bool isCached = false;
+		ER_RHI_GPUTexture* cachedTexture = mRenderingObjectsTextureCache.GetOrAdd(aFullPath, [this, &aFullPath, is3D, skipFallback, statusFlag, isSilent]() -> ER_RHI_GPUTexture*
+		{
+			ER_RHI_GPUTexture* texture = mRHI->CreateGPUTexture(aFullPath);
+			try
 			{
-				std::wstring msg = L"[ER Logger][ER_Core] Added new texture to rendering objects' texture cache: " + aFullPath + L'\n';
-				ER_OUTPUT_LOG(msg.c_str());
+				texture->CreateGPUTextureResource(mRHI, aFullPath, true, is3D, skipFallback, statusFlag, isSilent);
+			}
+			catch (...)
+			{
+				DeleteObject(texture);
+				throw;
+			}
 
-				return result.first->second;
+			if (statusFlag && *statusFlag == false)
+			{
+				DeleteObject(texture);
+				return nullptr;
 			}
-		}
 
-		return nullptr;
+			std::wstring msg = L"[ER Logger][ER_Core] Added new texture to rendering objects' texture cache: " + aFullPath + L'\n';
+			ER_OUTPUT_LOG(msg.c_str());
+			return texture;
+		}, &isCached);
+
+		// cached textures (including the ones loaded by another thread while we were waiting) were loaded successfully
+		if (isCached && statusFlag)
+			*statusFlag = true;
+		if (didExist)
+			*didExist = isCached;
+		return cachedTexture;
 	}
 
 	void ER_RuntimeCore::AddGPUTextureToCache(const std::wstring& aFullPath, ER_RHI_GPUTexture* aTexture)
 	{
-		mRenderingObjectsTextureCache.emplace(aFullPath, aTexture);
+		mRenderingObjectsTextureCache.Add(aFullPath, aTexture);
 	}
 
 	bool ER_RuntimeCore::RemoveGPUTextureFromCache(const std::wstring& aFullPath, bool removeKey)
 	{
-		auto it = mRenderingObjectsTextureCache.find(aFullPath);
-		if (it != mRenderingObjectsTextureCache.end())
-		{
-			DeleteObject(it->second);
-			if (removeKey)
-				mRenderingObjectsTextureCache.erase(it->first);
+		ER_RHI_GPUTexture* texture = nullptr;
+		if (!mRenderingObjectsTextureCache.Find(aFullPath, &texture))
+			return false;
 
-			return true;
-		}
+		DeleteObject(texture);
+		if (removeKey)
+			mRenderingObjectsTextureCache.Remove(aFullPath);
 		else
-			return false;
+			mRenderingObjectsTextureCache.Replace(aFullPath, nullptr);
+
+		return true;
 	}
 
 	void ER_RuntimeCore::ReplaceGPUTextureFromCache(const std::wstring& aFullPath, ER_RHI_GPUTexture* aTex)
 	{
-		auto it = mRenderingObjectsTextureCache.find(aFullPath);
-		if (it != mRenderingObjectsTextureCache.end())
-			it->second = aTex;
+		mRenderingObjectsTextureCache.Replace(aFullPath, aTex);
 	}
 
 	bool ER_RuntimeCore::IsGPUTextureInCache(const std::wstring& aFullPath)
 	{
-		auto it = mRenderingObjectsTextureCache.find(aFullPath);
-		return (it != mRenderingObjectsTextureCache.end());
+		return mRenderingObjectsTextureCache.Find(aFullPath);
 	}
 
 }
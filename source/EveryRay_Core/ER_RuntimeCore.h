@@ -2,6 +2,7 @@
 #define MAX_SCENES_COUNT 25 // bump if needed
 
 #include "ER_Core.h"
+#include "ER_ConcurrentCache.h"
 #include "Common.h"
 
 namespace EveryRay_Core
@@ -34,6 +35,15 @@ namespace EveryRay_Core
 		virtual void Update(const ER_CoreTime& gameTime) override;
 		virtual void Draw(const ER_CoreTime& gameTime) override;	
 
+		// Runs aFramesCount frames of the level without the message loop and logs/saves a report of their CPU cost (see Program.cpp "-headless")
+		void RunHeadless(const std::string& aSceneName, UINT aFramesCount);
+		// Loads the level with the null RHI (if any) and runs the scene tests (and benchmarks) of ER_Tests on it, returns the number of failed suites (see the tests Program.cpp)
+		int RunTests(const std::string& aSceneName, bool aRunBenchmarks);
+		// Logs cold (assimp) vs. warm (mesh cache) import times of all the models in aDirectory (see the tests Program.cpp "-meshcache")
+		void RunMeshCacheBenchmark(const std::string& aDirectory);
+		// Logs vertex counts and ACMR/ATVR before/after the mesh optimization of all the models in aDirectory (see the tests Program.cpp "-meshoptimizer")
+		void RunMeshOptimizerReport(const std::string& aDirectory);
+
 		// methods for 3D models (on disk) cache from ER_RenderingObjects in the level
 		virtual ER_Model* AddOrGet3DModelFromCache(const std::string& aFullPath, bool* didExist = nullptr, bool isSilent = false) override;
 
@@ -63,9 +73,10 @@ namespace EveryRay_Core
 
 		std::chrono::duration<double> mElapsedTimeUpdateCPU;
 		std::chrono::duration<double> mElapsedTimeRenderCPU;
+		UINT64 mElapsedRenderAllocationsCount = 0; // heap allocations by the sandbox draw of the last frame (only counted with ER_RHI_ALLOCATIONS_COUNTER)
 
-		std::map<std::wstring, ER_RHI_GPUTexture*> mRenderingObjectsTextureCache; // all physical textures (on disk) from ER_RenderingObjects in the level
-		std::map<std::string, ER_Model> mRenderingObjects3DModelsCache; // all 3D models from ER_RenderingObjects in the level (not wstring due to assimp)
+		ER_ConcurrentCache<std::wstring, ER_RHI_GPUTexture*> mRenderingObjectsTextureCache; // all physical textures (on disk) from ER_RenderingObjects in the level
+		ER_ConcurrentCache<std::string, ER_Model*> mRenderingObjects3DModelsCache; // all 3D models from ER_RenderingObjects in the level (not wstring due to assimp), owned
 
 		std::map<std::string, std::string> mScenesPaths;
 		std::vector<std::string> mScenesNamesByIndices;
@@ -74,6 +85,7 @@ namespace EveryRay_Core
 
 		std::string mStartupSceneName;
 		std::string mCurrentSceneName;
+		std::string mHeadlessSceneName; // loaded instead of the startup scene in RunHeadless() and RunTests()
 
 		bool mShowProfiler = false;
 		bool mShowCameraSettings = true;
@@ -24,6 +24,7 @@
 #include "ER_Illumination.h"
 #include "ER_LightProbesManager.h"
 #include "ER_GPUCuller.h"
+#include "ER_JobSystem.h"
 
 #include "RHI/ER_RHI.h"
 
@@ -64,6 +65,7 @@ namespace EveryRay_Core {
 
     void ER_Sandbox::Initialize(ER_Core& game, ER_Camera& camera, const std::string& sceneName, const std::string& sceneFolderPath)
     {
+		ER_PROFILE_SCOPE("ER_Sandbox::Initialize");
 		mName = sceneName;
 
 		ER_RHI* rhi = game.GetRHI();
@@ -268,6 +270,8 @@ namespace EveryRay_Core {
 
 	void ER_Sandbox::Update(ER_Core& game, const ER_CoreTime& gameTime)
 	{
+		ER_PROFILE_SCOPE("ER_Sandbox::Update");
+
 		mSkybox->Update(gameTime);
 		mSkybox->UpdateSun(gameTime);
 
@@ -300,8 +304,49 @@ namespace EveryRay_Core {
 		for (auto& pointLight : mPointLights)
 			pointLight->Update(gameTime);
 
-		for (auto& object : mScene->objects)
-			object.second->Update(gameTime);
+		// objects update: CPU work (AABBs, culling, LODs) runs in parallel for all objects, then GPU uploads are done serially in scene order
+		{
+			ER_PROFILE_SCOPE("Objects update (CPU + upload)");
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			ER_JobSystem* jobSystem = game.GetJobSystem();
+			if (mIsParallelObjectsUpdate && jobSystem)
+			{
+				ER_JobCounter counter;
+				for (auto& object : mScene->objects)
+				{
+					ER_RenderingObject* renderingObject = object.second;
+					jobSystem->Submit([renderingObject, &gameTime, jobSystem]() { renderingObject->UpdateCPU(gameTime, jobSystem); }, &counter);
+				}
+				jobSystem->Wait(counter);
+			}
+			else
+			{
+				for (auto& object : mScene->objects)
+					object.second->UpdateCPU(gameTime);
+			}
+
+			auto cpuEndTime = std::chrono::high_resolution_clock::now();
+
+			mObjectsUpdatedInstancesCount = 0;
+			mObjectsUploadedInstancesCount = 0;
+			{
+				ER_PROFILE_SCOPE("Objects upload");
+				for (auto& object : mScene->objects)
+				{
+					object.second->UpdateGPU();
+					mObjectsUpdatedInstancesCount += object.second->GetUpdatedInstancesCount();
+					mObjectsUploadedInstancesCount += object.second->GetUploadedInstancesCount();
+				}
+			}
+
+			auto gpuEndTime = std::chrono::high_resolution_clock::now();
+
+			// smoothed, so that the numbers are readable in the UI
+			const float smoothing = 0.05f;
+			mObjectsUpdateCPUTimeMs += (std::chrono::duration<float, std::milli>(cpuEndTime - startTime).count() - mObjectsUpdateCPUTimeMs) * smoothing;
+			mObjectsUpdateGPUTimeMs += (std::chrono::duration<float, std::milli>(gpuEndTime - cpuEndTime).count() - mObjectsUpdateGPUTimeMs) * smoothing;
+		}
 
         UpdateImGui();
 	}
@@ -331,11 +376,18 @@ namespace EveryRay_Core {
 		if (ImGui::Button("Terrain") && mTerrain)
 			mTerrain->Config();
 
+		ImGui::Separator();
+		ImGui::Checkbox("Parallel objects update", &mIsParallelObjectsUpdate);
+		ImGui::Text("Objects update - CPU: %.3f ms, uploads: %.3f ms", mObjectsUpdateCPUTimeMs, mObjectsUpdateGPUTimeMs);
+		ImGui::Text("Instances - updated AABBs: %u, uploaded: %u", mObjectsUpdatedInstancesCount, mObjectsUploadedInstancesCount);
+
         ImGui::End();
     }
 
 	void ER_Sandbox::Draw(ER_Core& game, const ER_CoreTime& gameTime)
 	{
+		ER_PROFILE_SCOPE("ER_Sandbox::Draw");
+
 		ER_RHI* rhi = game.GetRHI();
 		ER_Camera* camera = (ER_Camera*)game.GetServices().FindService(ER_Camera::TypeIdClass());
 
@@ -345,24 +397,19 @@ namespace EveryRay_Core {
 		rhi->BeginEventTag("EveryRay: GPU culling (Main camera)");
 		mGPUCuller->PerformCull(mScene, camera);
 		rhi->EndEventTag();
+
+		rhi->BeginEventTag("EveryRay: GPU culling (Foliage)");
+		if (mFoliageSystem)
+			mFoliageSystem->PerformGPUCulling(camera);
+		rhi->EndEventTag();
 #pragma endregion
 
 		#pragma region DRAW_GBUFFER
 		rhi->BeginEventTag("EveryRay: GBuffer");
 		{
+			ER_PROFILE_SCOPE("GBuffer");
 			mGBuffer->Start();
-
-			rhi->BeginEventTag("EveryRay: GBuffer (objects)");
-			mGBuffer->Draw(mScene);
-			rhi->EndEventTag();
-
-			rhi->BeginEventTag("EveryRay: GBuffer (terrain)");
-			if (mTerrain)
-			{
-				mTerrain->Draw(TerrainRenderPass::TERRAIN_GBUFFER,
-					{ mGBuffer->GetAlbedo(), mGBuffer->GetNormals(), mGBuffer->GetPositions(), mGBuffer->GetExtraBuffer(), mGBuffer->GetExtra2Buffer() }, mGBuffer->GetDepth());
-			}
-			rhi->EndEventTag();
+			mGBuffer->Draw(mScene, mTerrain);
 
 			rhi->BeginEventTag("EveryRay: GBuffer (foliage)");
 			if (mFoliageSystem)
@@ -380,6 +427,7 @@ namespace EveryRay_Core {
 		#pragma region DRAW_SHADOWS
 		rhi->BeginEventTag("EveryRay: Shadow Maps");
 		{
+			ER_PROFILE_SCOPE("Shadow maps");
 			mShadowMapper->Draw(mScene, mTerrain);
 		}
 		rhi->EndEventTag();
@@ -406,6 +454,7 @@ namespace EveryRay_Core {
 		// compute dynamic GI
 		rhi->BeginEventTag("EveryRay: Dynamic Global Illumination");
 		{
+			ER_PROFILE_SCOPE("Dynamic global illumination");
 			mIllumination->DrawDynamicGlobalIllumination(mGBuffer, gameTime);
 		}
 		rhi->EndEventTag();
@@ -414,6 +463,7 @@ namespace EveryRay_Core {
 		#pragma region DRAW_LOCAL_ILLUMINATION
 		rhi->BeginEventTag("EveryRay: Local Illumination");
 		{
+			ER_PROFILE_SCOPE("Local illumination");
 			mIllumination->DrawLocalIllumination(mGBuffer, mSkybox);
 			ER_RHI_GPUTexture* localRT = mIllumination->GetLocalIlluminationRT();
 
@@ -59,6 +59,12 @@ namespace EveryRay_Core
         void UpdateImGui();
 
         std::string mName;
+
+        bool mIsParallelObjectsUpdate = true;
+        float mObjectsUpdateCPUTimeMs = 0.0f; // UpdateCPU() of all objects
+        float mObjectsUpdateGPUTimeMs = 0.0f; // UpdateGPU() of all objects
+        UINT mObjectsUpdatedInstancesCount = 0; // instances with modified transforms in the last frame
+        UINT mObjectsUploadedInstancesCount = 0; // instances written to GPU buffers in the last frame
 	};
 
 }
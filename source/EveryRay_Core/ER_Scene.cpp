@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <fstream>
 #include <iostream>
+#include <set>
 
 #include "ER_Scene.h"
 #include "ER_Core.h"
@@ -19,6 +20,8 @@
 #include "ER_PointLight.h"
 #include "ER_Terrain.h"
 #include "ER_PostProcessingStack.h"
+#include "ER_BakedScene.h"
+#include "ER_Placement.h"
 
 #if defined(DEBUG) || defined(_DEBUG)  
 	#define MULTITHREADED_SCENE_LOAD 0
@@ -28,6 +31,8 @@
 
 namespace EveryRay_Core 
 {
+	static std::mutex standardMaterialsRootSignaturesMutex; // fur layers add their root signatures from loading jobs
+
 	template<>
 	int ER_Scene::GetValueFromSceneRoot(const std::string& aName)
 	{
@@ -139,80 +144,180 @@ namespace EveryRay_Core
 
 		CreateStandardMaterialsRootSignatures();
 
-		Json::Reader reader;
-		std::ifstream scene(path.c_str(), std::ifstream::binary);
+		LoadBakedScene();
 
-		if (!reader.parse(scene, mSceneJsonRoot)) {
-			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
-		}
-		else {
+		// load camera
+		{
+			mCamera.SetPosition(GetValueFromSceneRoot<XMFLOAT3>("camera_position"));
 
-			// load camera
-			{
-				mCamera.SetPosition(GetValueFromSceneRoot<XMFLOAT3>("camera_position"));
+			if (IsValueInSceneRoot("camera_direction"))
+				mCamera.SetDirection(GetValueFromSceneRoot<XMFLOAT3>("camera_direction"));
 
-				if (IsValueInSceneRoot("camera_direction"))
-					mCamera.SetDirection(GetValueFromSceneRoot<XMFLOAT3>("camera_direction"));
+			if (IsValueInSceneRoot("camera_plane_far"))
+				mCamera.SetFarPlaneDistance(GetValueFromSceneRoot<float>("camera_plane_far"));
 
-				if (IsValueInSceneRoot("camera_plane_far"))
-					mCamera.SetFarPlaneDistance(GetValueFromSceneRoot<float>("camera_plane_far"));
+			if (IsValueInSceneRoot("camera_plane_near"))
+				mCamera.SetNearPlaneDistance(GetValueFromSceneRoot<float>("camera_plane_near"));
+		}
 
-				if (IsValueInSceneRoot("camera_plane_near"))
-					mCamera.SetNearPlaneDistance(GetValueFromSceneRoot<float>("camera_plane_near"));
-			}
+		unsigned int numRenderingObjects = mBakedScene.GetObjectCount();
 
-			// add rendering objects to scene
-			unsigned int numRenderingObjects = mSceneJsonRoot["rendering_objects"].size();
-			for (Json::Value::ArrayIndex i = 0; i != numRenderingObjects; i++) {
-				objects.emplace_back(
-					mSceneJsonRoot["rendering_objects"][i]["name"].asString(), 
-					new ER_RenderingObject(mSceneJsonRoot["rendering_objects"][i]["name"].asString(), i, *mCore, mCamera, 
-						ER_Utility::GetFilePath(mSceneJsonRoot["rendering_objects"][i]["model_path"].asString()),
-						true, mSceneJsonRoot["rendering_objects"][i]["instanced"].asBool())
-				);
+		// import all unique models (main ones and LODs) in parallel, so that the objects get them from the cache
+		{
+			std::set<std::string> modelPaths;
+			for (UINT i = 0; i < numRenderingObjects; i++)
+			{
+				const ER_BakedSceneObject& record = mBakedScene.GetObjectRecord(i);
+				modelPaths.insert(ER_Utility::GetFilePath(std::string(mBakedScene.GetString(record.modelPath))));
+				if (record.Has(BAKED_FIELD_MODEL_LODS))
+				{
+					for (UINT lod = 1 /* 0 is main model */; lod < record.lodCount; lod++)
+						modelPaths.insert(ER_Utility::GetFilePath(std::string(mBakedScene.GetLODPath(record.firstLOD + lod))));
+				}
 			}
-			std::partition(objects.begin(), objects.end(), [](const ER_SceneObject& obj) {	return obj.second->IsInstanced(); });
-			assert(numRenderingObjects == objects.size());
 
-#if MULTITHREADED_SCENE_LOAD && !ER_PLATFORM_WIN64_DX12
-			int numThreads = std::thread::hardware_concurrency();
-#else
-			int numThreads = 1;
-#endif
-			int objectsPerThread = numRenderingObjects / numThreads;
-			if (objectsPerThread == 0)
+			ER_JobCounter modelsCounter;
+			for (const std::string& modelPath : modelPaths)
+				SubmitLoadingJob([this, &modelPath]() { mCore->AddOrGet3DModelFromCache(modelPath, nullptr, true); }, &modelsCounter);
+			WaitForLoadingJobs(modelsCounter);
+		}
+
+		// add rendering objects to scene
+		for (UINT i = 0; i < numRenderingObjects; i++) {
+			const ER_BakedSceneObject& record = mBakedScene.GetObjectRecord(i);
+			objects.emplace_back(
+				mBakedScene.GetString(record.name),
+				new ER_RenderingObject(mBakedScene.GetString(record.name), i, *mCore, mCamera,
+					ER_Utility::GetFilePath(std::string(mBakedScene.GetString(record.modelPath))),
+					true, record.GetBool(BAKED_FIELD_INSTANCED))
+			);
+		}
+		std::partition(objects.begin(), objects.end(), [](const ER_SceneObject& obj) {	return obj.second->IsInstanced(); });
+		assert(numRenderingObjects == objects.size());
+
+		// every object is a separate job (with nested jobs for its textures), so one heavy object does not hold back the rest
+		{
+			ER_JobCounter objectsCounter;
+			for (auto& obj : objects)
 			{
-				numThreads = 1;
-				objectsPerThread = numRenderingObjects;
+				ER_RenderingObject* renderingObject = obj.second;
+				SubmitLoadingJob([this, renderingObject]() { LoadRenderingObjectData(renderingObject); }, &objectsCounter);
 			}
+			WaitForLoadingJobs(objectsCounter);
+		}
 
-			std::vector<std::thread> threads;
-			threads.reserve(numThreads);
+		for (auto& obj : objects)
+			LoadRenderingObjectInstancedData(obj.second);
 
-			for (int i = 0; i < numThreads; i++)
-			{
-				threads.push_back(std::thread([&, numThreads, numRenderingObjects, objectsPerThread, i]
-				{
-					int endRange = (i < numThreads - 1) ? (i + 1) * objectsPerThread : numRenderingObjects;
+		{
+			std::wstring msg = L"[ER Logger][ER_Scene] Finished loading scene: " + ER_Utility::ToWideString(path) + L" Enjoy! \n";
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+	}
 
-					for (int j = i * objectsPerThread; j < endRange; j++)
-					{
-						auto objectI = objects.begin();
-						std::advance(objectI, j);
-						LoadRenderingObjectData(objectI->second);
-					}
-				}));
-			}
-			for (auto& t : threads) t.join();
+	// Maps the baked version of the scene if it is up-to-date with the json file. Otherwise, parses the json and (re)bakes it.
+	// Only the remainder of the scene root (everything except rendering objects) is parsed as json when the bake is valid.
+	void ER_Scene::LoadBakedScene()
+	{
+		mIsSceneJsonRootFull = !LoadSceneData(mScenePath, true, true, mBakedScene, mSceneJsonRoot);
+		if (!mIsSceneJsonRootFull)
+		{
+			std::wstring msg = L"[ER Logger][ER_Scene] Loaded baked scene: " + ER_Utility::ToWideString(ER_BakedScene::GetBakedPath(mScenePath)) + L'\n';
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+	}
 
-			for (auto& obj : objects)
-				LoadRenderingObjectInstancedData(obj.second);
+	// Returns true if the baked file was mapped (and only the remainder of the scene root was parsed), false if the json was parsed in full and baked in memory.
+	// Shared by the scene and its load benchmark (which uses both paths explicitly and does not write anything to disk).
+	bool ER_Scene::LoadSceneData(const std::string& aScenePath, bool aUseBakedFile, bool aWriteBake, ER_BakedScene& aOutBakedScene, Json::Value& aOutSceneRoot)
+	{
+		const std::string bakedPath = ER_BakedScene::GetBakedPath(aScenePath);
+		if (aUseBakedFile && aOutBakedScene.Open(bakedPath, aScenePath))
+		{
+			UINT sceneRootSize = 0;
+			const char* sceneRootText = aOutBakedScene.GetSceneRootText(sceneRootSize);
+
+			Json::Reader reader;
+			if (!reader.parse(sceneRootText, sceneRootText + sceneRootSize, aOutSceneRoot))
+				throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
+			return true;
 		}
 
+		ParseSceneJson(aScenePath, aOutSceneRoot);
+
+		std::vector<char> bakedData;
+		if (!ER_BakedScene::Bake(aOutSceneRoot, aScenePath, bakedData))
+			throw ER_CoreException("Could not bake the scene json file!");
+
+		if (aWriteBake && ER_BakedScene::WriteToDisk(bakedData, bakedPath))
 		{
-			std::wstring msg = L"[ER Logger][ER_Scene] Finished loading scene: " + ER_Utility::ToWideString(path) + L" Enjoy! \n";
+			std::wstring msg = L"[ER Logger][ER_Scene] Baked scene to disk: " + ER_Utility::ToWideString(bakedPath) + L'\n';
 			ER_OUTPUT_LOG(msg.c_str());
 		}
+
+		if (!aOutBakedScene.OpenFromMemory(std::move(bakedData)))
+			throw ER_CoreException("Could not load the baked scene data!");
+		return false;
+	}
+
+	void ER_Scene::ParseSceneJson(const std::string& aScenePath, Json::Value& aOutSceneRoot)
+	{
+		Json::Reader reader;
+		std::ifstream scene(aScenePath.c_str(), std::ifstream::binary);
+
+		if (!reader.parse(scene, aOutSceneRoot))
+			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
+	}
+
+	// The json root is needed in full only when saving (baked scenes parse just the remainder of the root)
+	void ER_Scene::LoadFullSceneJsonRoot()
+	{
+		if (mIsSceneJsonRootFull)
+			return;
+
+		ParseSceneJson(mScenePath, mSceneJsonRoot);
+		mIsSceneJsonRootFull = true;
+	}
+
+	// Both paths produce the same data for the scene (the records are then read from the baked scene in either case), so only the difference between them is measured
+	void ER_Scene::BenchmarkLoad(const std::string& aScenePath)
+	{
+		double jsonTime = 0.0;
+		double bakedTime = 0.0;
+		UINT objectCount = 0;
+		bool isMapped = false;
+
+		try
+		{
+			{
+				ER_BakedScene bakedScene;
+				Json::Value sceneRoot;
+
+				auto startTimer = std::chrono::high_resolution_clock::now();
+				LoadSceneData(aScenePath, false, false, bakedScene, sceneRoot);
+				std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTimer;
+				jsonTime = time.count();
+				objectCount = bakedScene.GetObjectCount();
+			}
+			{
+				ER_BakedScene bakedScene;
+				Json::Value sceneRoot;
+
+				auto startTimer = std::chrono::high_resolution_clock::now();
+				isMapped = LoadSceneData(aScenePath, true, false, bakedScene, sceneRoot);
+				std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTimer;
+				bakedTime = time.count();
+			}
+		}
+		catch (const ER_CoreException& ex)
+		{
+			ER_OUTPUT_LOG((L"[ER Logger][ER_Scene] Load benchmark failed for " + ER_Utility::ToWideString(aScenePath) + L": " + ex.whatw() + L"\n").c_str());
+			return;
+		}
+
+		std::string message = "[ER Logger][ER_Scene] Load benchmark for " + aScenePath + " (" + std::to_string(objectCount) + " objects): json " + std::to_string(jsonTime * 1000.0) +
+			"ms, baked " + std::to_string(bakedTime * 1000.0) + "ms" + (isMapped ? "" : " (baked file is missing or stale: json path both times)") + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
 	}
 
 	ER_Scene::~ER_Scene()
@@ -286,301 +391,298 @@ namespace EveryRay_Core
 		}
 	}
 
+	// Loading jobs go to the engine's job system (or are executed right away when multithreaded loading is disabled)
+	void ER_Scene::SubmitLoadingJob(const std::function<void()>& aTask, ER_JobCounter* aCounter)
+	{
+#if MULTITHREADED_SCENE_LOAD
+		mCore->GetJobSystem()->Submit(aTask, aCounter);
+#else
+		aTask();
+#endif
+	}
+
+	void ER_Scene::WaitForLoadingJobs(const ER_JobCounter& aCounter)
+	{
+#if MULTITHREADED_SCENE_LOAD
+		mCore->GetJobSystem()->Wait(aCounter);
+#endif
+	}
+
 	void ER_Scene::LoadRenderingObjectData(ER_RenderingObject* aObject)
 	{
+		ER_PROFILE_SCOPE("ER_Scene::LoadRenderingObjectData");
+
 		if (!aObject || !aObject->IsLoaded())
 			return;
 
-		int i = aObject->GetIndexInScene();
+		const ER_BakedSceneObject& record = mBakedScene.GetObjectRecord(aObject->GetIndexInScene());
 		bool isInstanced = aObject->IsInstanced();
-		bool hasLODs = false;
 
 		// load flags
 		{
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("foliageMask"))
-				aObject->SetIsMarkedAsFoliage(mSceneJsonRoot["rendering_objects"][i]["foliageMask"].asBool());
+			if (record.Has(BAKED_FIELD_FOLIAGE_MASK))
+				aObject->SetIsMarkedAsFoliage(record.GetBool(BAKED_FIELD_FOLIAGE_MASK));
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_indirect_global_lightprobe"))
-				aObject->SetUseIndirectGlobalLightProbe(mSceneJsonRoot["rendering_objects"][i]["use_indirect_global_lightprobe"].asBool());
+			if (record.Has(BAKED_FIELD_USE_INDIRECT_GLOBAL_LIGHTPROBE))
+				aObject->SetUseIndirectGlobalLightProbe(record.GetBool(BAKED_FIELD_USE_INDIRECT_GLOBAL_LIGHTPROBE));
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_in_global_lightprobe_rendering"))
-				aObject->SetIsUsedForGlobalLightProbeRendering(mSceneJsonRoot["rendering_objects"][i]["use_in_global_lightprobe_rendering"].asBool());
+			if (record.Has(BAKED_FIELD_USE_IN_GLOBAL_LIGHTPROBE_RENDERING))
+				aObject->SetIsUsedForGlobalLightProbeRendering(record.GetBool(BAKED_FIELD_USE_IN_GLOBAL_LIGHTPROBE_RENDERING));
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_parallax_occlusion_mapping"))
-				aObject->SetParallaxOcclusionMapping(mSceneJsonRoot["rendering_objects"][i]["use_parallax_occlusion_mapping"].asBool());
+			if (record.Has(BAKED_FIELD_USE_PARALLAX_OCCLUSION_MAPPING))
+				aObject->SetParallaxOcclusionMapping(record.GetBool(BAKED_FIELD_USE_PARALLAX_OCCLUSION_MAPPING));
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_forward_shading"))
-				aObject->SetForwardShading(mSceneJsonRoot["rendering_objects"][i]["use_forward_shading"].asBool());
+			if (record.Has(BAKED_FIELD_USE_FORWARD_SHADING))
+				aObject->SetForwardShading(record.GetBool(BAKED_FIELD_USE_FORWARD_SHADING));
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_reflection"))
-				aObject->SetReflective(mSceneJsonRoot["rendering_objects"][i]["use_reflection"].asBool());
+			if (record.Has(BAKED_FIELD_USE_REFLECTION))
+				aObject->SetReflective(record.GetBool(BAKED_FIELD_USE_REFLECTION));
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_sss"))
-				aObject->SetSeparableSubsurfaceScattering(mSceneJsonRoot["rendering_objects"][i]["use_sss"].asBool());
+			if (record.Has(BAKED_FIELD_USE_SSS))
+				aObject->SetSeparableSubsurfaceScattering(record.GetBool(BAKED_FIELD_USE_SSS));
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_custom_alpha_discard"))
-				aObject->SetCustomAlphaDiscard(mSceneJsonRoot["rendering_objects"][i]["use_custom_alpha_discard"].asFloat());
+			if (record.Has(BAKED_FIELD_USE_CUSTOM_ALPHA_DISCARD))
+				aObject->SetCustomAlphaDiscard(record.customAlphaDiscard);
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_transparency"))
-				aObject->SetTransparency(mSceneJsonRoot["rendering_objects"][i]["use_transparency"].asBool());
+			if (record.Has(BAKED_FIELD_USE_TRANSPARENCY))
+				aObject->SetTransparency(record.GetBool(BAKED_FIELD_USE_TRANSPARENCY));
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_gpu_indirect_rendering"))
-				aObject->SetGPUIndirectlyRendered(mSceneJsonRoot["rendering_objects"][i]["use_gpu_indirect_rendering"].asBool());
+			if (record.Has(BAKED_FIELD_USE_GPU_INDIRECT_RENDERING))
+				aObject->SetGPUIndirectlyRendered(record.GetBool(BAKED_FIELD_USE_GPU_INDIRECT_RENDERING));
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("skip_indirect_specular"))
-				aObject->SetSkipIndirectSpecular(mSceneJsonRoot["rendering_objects"][i]["skip_indirect_specular"].asBool());
+			if (record.Has(BAKED_FIELD_SKIP_INDIRECT_SPECULAR))
+				aObject->SetSkipIndirectSpecular(record.GetBool(BAKED_FIELD_SKIP_INDIRECT_SPECULAR));
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("index_of_refraction"))
-				aObject->SetIOR(mSceneJsonRoot["rendering_objects"][i]["index_of_refraction"].asFloat());
+			if (record.Has(BAKED_FIELD_INDEX_OF_REFRACTION))
+				aObject->SetIOR(record.indexOfRefraction);
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("custom_roughness"))
-				aObject->SetCustomRoughness(mSceneJsonRoot["rendering_objects"][i]["custom_roughness"].asFloat());
+			if (record.Has(BAKED_FIELD_CUSTOM_ROUGHNESS))
+				aObject->SetCustomRoughness(record.customRoughness);
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("custom_metalness"))
-				aObject->SetCustomMetalness(mSceneJsonRoot["rendering_objects"][i]["custom_metalness"].asFloat());
+			if (record.Has(BAKED_FIELD_CUSTOM_METALNESS))
+				aObject->SetCustomMetalness(record.customMetalness);
 
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("use_triplanar_mapping"))
-				aObject->SetTriplanarMapping(mSceneJsonRoot["rendering_objects"][i]["use_triplanar_mapping"].asBool());
-			//if (mSceneJsonRoot["rendering_objects"][i].isMember("triplanar_mapping_sharpness"))
-			//	aObject->SetTriplanarMappedSharpness(mSceneJsonRoot["rendering_objects"][i]["triplanar_mapping_sharpness"].asFloat());
+			if (record.Has(BAKED_FIELD_USE_TRIPLANAR_MAPPING))
+				aObject->SetTriplanarMapping(record.GetBool(BAKED_FIELD_USE_TRIPLANAR_MAPPING));
 
 			//fur
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_layers_count"))
-				aObject->SetFurLayersCount(mSceneJsonRoot["rendering_objects"][i]["fur_layers_count"].asInt());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_color"))
-			{
-				float vec3[3];
-				for (Json::Value::ArrayIndex vecI = 0; vecI != mSceneJsonRoot["rendering_objects"][i]["fur_color"].size(); vecI++)
-					vec3[vecI] = mSceneJsonRoot["rendering_objects"][i]["fur_color"][vecI].asFloat();
-
-				aObject->SetFurColor(vec3[0], vec3[1], vec3[2]);
-			}
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_color_interpolation"))
-				aObject->SetFurColorInterpolation(mSceneJsonRoot["rendering_objects"][i]["fur_color_interpolation"].asFloat());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_length"))
-				aObject->SetFurLength(mSceneJsonRoot["rendering_objects"][i]["fur_length"].asFloat());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_cutoff"))
-				aObject->SetFurCutoff(mSceneJsonRoot["rendering_objects"][i]["fur_cutoff"].asFloat());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_cutoff_end"))
-				aObject->SetFurCutoffEnd(mSceneJsonRoot["rendering_objects"][i]["fur_cutoff_end"].asFloat());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_wind_frequency"))
-				aObject->SetFurWindFrequency(mSceneJsonRoot["rendering_objects"][i]["fur_wind_frequency"].asFloat());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_gravity_strength"))
-				aObject->SetFurGravityStrength(mSceneJsonRoot["rendering_objects"][i]["fur_gravity_strength"].asFloat());
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_uv_scale"))
-				aObject->SetFurUVScale(mSceneJsonRoot["rendering_objects"][i]["fur_uv_scale"].asFloat());
+			if (record.Has(BAKED_FIELD_FUR_LAYERS_COUNT))
+				aObject->SetFurLayersCount(record.furLayersCount);
+			if (record.Has(BAKED_FIELD_FUR_COLOR))
+				aObject->SetFurColor(record.furColor[0], record.furColor[1], record.furColor[2]);
+			if (record.Has(BAKED_FIELD_FUR_COLOR_INTERPOLATION))
+				aObject->SetFurColorInterpolation(record.furColorInterpolation);
+			if (record.Has(BAKED_FIELD_FUR_LENGTH))
+				aObject->SetFurLength(record.furLength);
+			if (record.Has(BAKED_FIELD_FUR_CUTOFF))
+				aObject->SetFurCutoff(record.furCutoff);
+			if (record.Has(BAKED_FIELD_FUR_CUTOFF_END))
+				aObject->SetFurCutoffEnd(record.furCutoffEnd);
+			if (record.Has(BAKED_FIELD_FUR_WIND_FREQUENCY))
+				aObject->SetFurWindFrequency(record.furWindFrequency);
+			if (record.Has(BAKED_FIELD_FUR_GRAVITY_STRENGTH))
+				aObject->SetFurGravityStrength(record.furGravityStrength);
+			if (record.Has(BAKED_FIELD_FUR_UV_SCALE))
+				aObject->SetFurUVScale(record.furUVScale);
 
 			//terrain
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_placement"))
+			if (record.Has(BAKED_FIELD_TERRAIN_PLACEMENT))
 			{
-				aObject->SetTerrainPlacement(mSceneJsonRoot["rendering_objects"][i]["terrain_placement"].asBool());
+				aObject->SetTerrainPlacement(record.GetBool(BAKED_FIELD_TERRAIN_PLACEMENT));
 
-				if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_splat_channel"))
-					aObject->SetTerrainProceduralPlacementSplatChannel(mSceneJsonRoot["rendering_objects"][i]["terrain_splat_channel"].asInt());
+				if (record.Has(BAKED_FIELD_TERRAIN_SPLAT_CHANNEL))
+					aObject->SetTerrainProceduralPlacementSplatChannel(record.terrainSplatChannel);
 
-				if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_height_delta"))
-					aObject->SetTerrainProceduralPlacementHeightDelta(mSceneJsonRoot["rendering_objects"][i]["terrain_height_delta"].asFloat());
+				if (record.Has(BAKED_FIELD_TERRAIN_HEIGHT_DELTA))
+					aObject->SetTerrainProceduralPlacementHeightDelta(record.terrainHeightDelta);
 
 				//procedural flags
 				{
-					if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_scale_min") && mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_scale_max"))
-						aObject->SetTerrainProceduralObjectsMinMaxScale(
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_scale_min"].asFloat(),
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_scale_max"].asFloat());
-
-					if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_pitch_min") && mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_pitch_max"))
-						aObject->SetTerrainProceduralObjectsMinMaxPitch(
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_pitch_min"].asFloat(),
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_pitch_max"].asFloat());
-
-					if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_roll_min") && mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_roll_max"))
-						aObject->SetTerrainProceduralObjectsMinMaxRoll(
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_roll_min"].asFloat(),
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_roll_max"].asFloat());
-
-					if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_yaw_min") && mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_yaw_max"))
-						aObject->SetTerrainProceduralObjectsMinMaxYaw(
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_yaw_min"].asFloat(),
-							mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_yaw_max"].asFloat());
-
-					if (isInstanced && mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_instance_count"))
-						aObject->SetTerrainProceduralInstanceCount(mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_instance_count"].asInt());
-
-					if (mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_zone_center_pos"))
-					{
-						float vec3[3];
-						for (Json::Value::ArrayIndex vecI = 0; vecI != mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_zone_center_pos"].size(); vecI++)
-							vec3[vecI] = mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_zone_center_pos"][vecI].asFloat();
+					if (record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_SCALE))
+						aObject->SetTerrainProceduralObjectsMinMaxScale(record.terrainProceduralScale[0], record.terrainProceduralScale[1]);
+
+					if (record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_PITCH))
+						aObject->SetTerrainProceduralObjectsMinMaxPitch(record.terrainProceduralPitch[0], record.terrainProceduralPitch[1]);
+
+					if (record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_ROLL))
+						aObject->SetTerrainProceduralObjectsMinMaxRoll(record.terrainProceduralRoll[0], record.terrainProceduralRoll[1]);
+
+					if (record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_YAW))
+						aObject->SetTerrainProceduralObjectsMinMaxYaw(record.terrainProceduralYaw[0], record.terrainProceduralYaw[1]);
 
-						XMFLOAT3 centerPos = XMFLOAT3(vec3[0], vec3[1], vec3[2]);
+					if (isInstanced && record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_INSTANCE_COUNT))
+						aObject->SetTerrainProceduralInstanceCount(record.terrainProceduralInstanceCount);
+
+					if (record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_ZONE_CENTER_POS))
+					{
+						XMFLOAT3 centerPos = XMFLOAT3(record.terrainProceduralZoneCenterPos);
 						aObject->SetTerrainProceduralZoneCenterPos(centerPos);
 					}
 
-					if (isInstanced && mSceneJsonRoot["rendering_objects"][i].isMember("terrain_procedural_zone_radius"))
-						aObject->SetTerrainProceduralZoneRadius(mSceneJsonRoot["rendering_objects"][i]["terrain_procedural_zone_radius"].asFloat());
+					if (isInstanced && record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_ZONE_RADIUS))
+						aObject->SetTerrainProceduralZoneRadius(record.terrainProceduralZoneRadius);
+
+					if (record.Has(BAKED_FIELD_TERRAIN_PROCEDURAL_SEED))
+						aObject->SetTerrainProceduralSeed(record.terrainProceduralSeed);
 				}
 			}
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("min_scale"))
-				aObject->SetMinScale(mSceneJsonRoot["rendering_objects"][i]["min_scale"].asFloat());
+			if (record.Has(BAKED_FIELD_MIN_SCALE))
+				aObject->SetMinScale(record.minScale);
 			
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("max_scale"))
-				aObject->SetMaxScale(mSceneJsonRoot["rendering_objects"][i]["max_scale"].asFloat());
+			if (record.Has(BAKED_FIELD_MAX_SCALE))
+				aObject->SetMaxScale(record.maxScale);
 		}
 
 		// load materials
 		{
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("new_materials")) {
-				unsigned int numMaterials = mSceneJsonRoot["rendering_objects"][i]["new_materials"].size();
-				for (Json::Value::ArrayIndex matIndex = 0; matIndex != numMaterials; matIndex++) {
-					std::string name = mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex]["name"].asString();
-
-					MaterialShaderEntries shaderEntries;
-					if (mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex].isMember("vertexEntry"))
-						shaderEntries.vertexEntry = mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex]["vertexEntry"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex].isMember("geometryEntry"))
-						shaderEntries.geometryEntry = mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex]["geometryEntry"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex].isMember("hullEntry"))
-						shaderEntries.hullEntry = mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex]["hullEntry"].asString();	
-					if (mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex].isMember("domainEntry"))
-						shaderEntries.domainEntry = mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex]["domainEntry"].asString();	
-					if (mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex].isMember("pixelEntry"))
-						shaderEntries.pixelEntry = mSceneJsonRoot["rendering_objects"][i]["new_materials"][matIndex]["pixelEntry"].asString();
-
-					if (isInstanced) //be careful with the instancing support in shaders of the materials! (i.e., maybe the material does not have instancing entry point/support)
-						shaderEntries.vertexEntry = shaderEntries.vertexEntry + "_instancing";
-					
-					aObject->SetInGBuffer(name == ER_MaterialHelper::gbufferMaterialName);
-					aObject->SetInLightProbes(name == ER_MaterialHelper::renderToLightProbeMaterialName);
-
-					if (name == ER_MaterialHelper::shadowMapMaterialName)
+			for (UINT matIndex = 0; matIndex < record.materialCount; matIndex++) {
+				const ER_BakedSceneMaterial& material = mBakedScene.GetMaterial(record.firstMaterial + matIndex);
+				std::string name = mBakedScene.GetString(material.name);
+
+				MaterialShaderEntries shaderEntries;
+				if (mBakedScene.HasString(material.vertexEntry))
+					shaderEntries.vertexEntry = mBakedScene.GetString(material.vertexEntry);
+				if (mBakedScene.HasString(material.geometryEntry))
+					shaderEntries.geometryEntry = mBakedScene.GetString(material.geometryEntry);
+				if (mBakedScene.HasString(material.hullEntry))
+					shaderEntries.hullEntry = mBakedScene.GetString(material.hullEntry);
+				if (mBakedScene.HasString(material.domainEntry))
+					shaderEntries.domainEntry = mBakedScene.GetString(material.domainEntry);
+				if (mBakedScene.HasString(material.pixelEntry))
+					shaderEntries.pixelEntry = mBakedScene.GetString(material.pixelEntry);
+
+				if (isInstanced) //be careful with the instancing support in shaders of the materials! (i.e., maybe the material does not have instancing entry point/support)
+					shaderEntries.vertexEntry = shaderEntries.vertexEntry + "_instancing";
+				
+				aObject->SetInGBuffer(name == ER_MaterialHelper::gbufferMaterialName);
+				aObject->SetInLightProbes(name == ER_MaterialHelper::renderToLightProbeMaterialName);
+
+				if (name == ER_MaterialHelper::shadowMapMaterialName)
+				{
+					for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
 					{
-						for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
-						{
-							std::string cascadedname = ER_MaterialHelper::shadowMapMaterialName + " " + std::to_string(cascade);
-							aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), cascadedname);
-						}
+						std::string cascadedname = ER_MaterialHelper::shadowMapMaterialName + " " + std::to_string(cascade);
+						aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), cascadedname);
 					}
-					else if (name == ER_MaterialHelper::voxelizationMaterialName)
+				}
+				else if (name == ER_MaterialHelper::voxelizationMaterialName)
+				{
+					aObject->SetInVoxelization(true);
+					for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
 					{
-						aObject->SetInVoxelization(true);
-						for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
-						{
-							const std::string fullname = ER_MaterialHelper::voxelizationMaterialName + "_" + std::to_string(cascade);
-							aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), fullname);
-						}
+						const std::string fullname = ER_MaterialHelper::voxelizationMaterialName + "_" + std::to_string(cascade);
+						aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), fullname);
 					}
-					else if (name == ER_MaterialHelper::furShellMaterialName)
+				}
+				else if (name == ER_MaterialHelper::furShellMaterialName)
+				{
+					ER_RHI_GPURootSignature* rs = mStandardMaterialsRootSignatures.at(name);
+					int layerCount = aObject->GetFurLayersCount();
+					if (layerCount > 0)
 					{
-						ER_RHI_GPURootSignature* rs = mStandardMaterialsRootSignatures.at(name);
-						int layerCount = aObject->GetFurLayersCount();
-						if (layerCount > 0)
+						for (int layer = 0; layer < layerCount; layer++)
 						{
-							for (int layer = 0; layer < layerCount; layer++)
+							const std::string fullname = ER_MaterialHelper::furShellMaterialName + "_" + std::to_string(layer);
+							aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced, layer), fullname);
+							if (rs)
 							{
-								const std::string fullname = ER_MaterialHelper::furShellMaterialName + "_" + std::to_string(layer);
-								aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced, layer), fullname);
-								if (rs)
-									mStandardMaterialsRootSignatures.emplace(fullname, rs);
+								const std::lock_guard<std::mutex> lock(standardMaterialsRootSignaturesMutex);
+								mStandardMaterialsRootSignatures.emplace(fullname, rs);
 							}
 						}
-
 					}
-					else if (name == ER_MaterialHelper::renderToLightProbeMaterialName)
+
+				}
+				else if (name == ER_MaterialHelper::renderToLightProbeMaterialName)
+				{
+					std::string originalPSEntry = shaderEntries.pixelEntry;
+					for (int cubemapFaceIndex = 0; cubemapFaceIndex < CUBEMAP_FACES_COUNT; cubemapFaceIndex++)
 					{
-						std::string originalPSEntry = shaderEntries.pixelEntry;
-						for (int cubemapFaceIndex = 0; cubemapFaceIndex < CUBEMAP_FACES_COUNT; cubemapFaceIndex++)
+						std::string newName;
+						//diffuse
 						{
-							std::string newName;
-							//diffuse
-							{
-								shaderEntries.pixelEntry = originalPSEntry + "_DiffuseProbes";
-								newName = "diffuse_" + ER_MaterialHelper::renderToLightProbeMaterialName + "_" + std::to_string(cubemapFaceIndex);
-								aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), newName);
-							}
-							//specular
-							{
-								shaderEntries.pixelEntry = originalPSEntry + "_SpecularProbes";
-								newName = "specular_" + ER_MaterialHelper::renderToLightProbeMaterialName + "_" + std::to_string(cubemapFaceIndex);
-								aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), newName);
-							}
+							shaderEntries.pixelEntry = originalPSEntry + "_DiffuseProbes";
+							newName = "diffuse_" + ER_MaterialHelper::renderToLightProbeMaterialName + "_" + std::to_string(cubemapFaceIndex);
+							aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), newName);
+						}
+						//specular
+						{
+							shaderEntries.pixelEntry = originalPSEntry + "_SpecularProbes";
+							newName = "specular_" + ER_MaterialHelper::renderToLightProbeMaterialName + "_" + std::to_string(cubemapFaceIndex);
+							aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), newName);
 						}
 					}
-					else //other standard materials
-						aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), name);
 				}
+				else //other standard materials
+					aObject->LoadMaterial(GetMaterialByName(name, shaderEntries, isInstanced), name);
 			}
 
 			aObject->LoadRenderBuffers();
 		}
 
 		// load extra materials data
-		if (mSceneJsonRoot["rendering_objects"][i].isMember("snow_albedo"))
-			aObject->mSnowAlbedoTexturePath = mSceneJsonRoot["rendering_objects"][i]["snow_albedo"].asString();
-		if (mSceneJsonRoot["rendering_objects"][i].isMember("snow_normal"))
-			aObject->mSnowNormalTexturePath = mSceneJsonRoot["rendering_objects"][i]["snow_normal"].asString();
-		if (mSceneJsonRoot["rendering_objects"][i].isMember("snow_roughness"))
-			aObject->mSnowRoughnessTexturePath = mSceneJsonRoot["rendering_objects"][i]["snow_roughness"].asString();
+		if (mBakedScene.HasString(record.snowAlbedo))
+			aObject->mSnowAlbedoTexturePath = mBakedScene.GetString(record.snowAlbedo);
+		if (mBakedScene.HasString(record.snowNormal))
+			aObject->mSnowNormalTexturePath = mBakedScene.GetString(record.snowNormal);
+		if (mBakedScene.HasString(record.snowRoughness))
+			aObject->mSnowRoughnessTexturePath = mBakedScene.GetString(record.snowRoughness);
 		
-		if (mSceneJsonRoot["rendering_objects"][i].isMember("fresnel_outline_color"))
+		if (record.Has(BAKED_FIELD_FRESNEL_OUTLINE_COLOR))
 		{
-			float vec3[3];
-			for (Json::Value::ArrayIndex vecI = 0; vecI != mSceneJsonRoot["rendering_objects"][i]["fresnel_outline_color"].size(); vecI++)
-				vec3[vecI] = mSceneJsonRoot["rendering_objects"][i]["fresnel_outline_color"][vecI].asFloat();
-
-			XMFLOAT3 color = XMFLOAT3(vec3[0], vec3[1], vec3[2]);
+			XMFLOAT3 color = XMFLOAT3(record.fresnelOutlineColor);
 			aObject->SetFresnelOutlineColor(color);
 		}
 
-		if (mSceneJsonRoot["rendering_objects"][i].isMember("fur_height"))
-			aObject->mFurHeightTexturePath = mSceneJsonRoot["rendering_objects"][i]["fur_height"].asString();
+		if (mBakedScene.HasString(record.furHeight))
+			aObject->mFurHeightTexturePath = mBakedScene.GetString(record.furHeight);
 
-		// load textures
+		// load textures (every mesh is a separate job)
 		{
 			const int meshCount = aObject->GetMeshCount();
 
-			const bool containsCustomTextures = mSceneJsonRoot["rendering_objects"][i].isMember("textures");
-			const int maxCustomTextures = mSceneJsonRoot["rendering_objects"][i]["textures"].size();
+			const bool containsCustomTextures = record.Has(BAKED_FIELD_TEXTURES);
+			const int maxCustomTextures = static_cast<int>(record.meshTexturesCount);
 
+			ER_JobCounter texturesCounter;
 			for (int meshIndex = 0; meshIndex < meshCount; meshIndex++)
 			{
-				if (containsCustomTextures && meshIndex < maxCustomTextures)
+				const bool hasCustomTextures = containsCustomTextures && meshIndex < maxCustomTextures;
+				if (hasCustomTextures)
 				{
-					if (mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex].isMember("albedo"))
-						aObject->mCustomAlbedoTextures[meshIndex] = mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex]["albedo"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex].isMember("normal"))
-						aObject->mCustomNormalTextures[meshIndex] = mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex]["normal"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex].isMember("roughness"))
-						aObject->mCustomRoughnessTextures[meshIndex] = mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex]["roughness"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex].isMember("metalness"))
-						aObject->mCustomMetalnessTextures[meshIndex] = mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex]["metalness"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex].isMember("height"))
-						aObject->mCustomHeightTextures[meshIndex] = mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex]["height"].asString();
-					if (mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex].isMember("reflection_mask"))
-						aObject->mCustomReflectionMaskTextures[meshIndex] = mSceneJsonRoot["rendering_objects"][i]["textures"][meshIndex]["reflection_mask"].asString();
-
-					aObject->LoadCustomMeshTextures(meshIndex);
+					const ER_BakedSceneMeshTextures& textures = mBakedScene.GetMeshTextures(record.firstMeshTextures + meshIndex);
+					if (mBakedScene.HasString(textures.albedo))
+						aObject->mCustomAlbedoTextures[meshIndex] = mBakedScene.GetString(textures.albedo);
+					if (mBakedScene.HasString(textures.normal))
+						aObject->mCustomNormalTextures[meshIndex] = mBakedScene.GetString(textures.normal);
+					if (mBakedScene.HasString(textures.roughness))
+						aObject->mCustomRoughnessTextures[meshIndex] = mBakedScene.GetString(textures.roughness);
+					if (mBakedScene.HasString(textures.metalness))
+						aObject->mCustomMetalnessTextures[meshIndex] = mBakedScene.GetString(textures.metalness);
+					if (mBakedScene.HasString(textures.height))
+						aObject->mCustomHeightTextures[meshIndex] = mBakedScene.GetString(textures.height);
+					if (mBakedScene.HasString(textures.reflectionMask))
+						aObject->mCustomReflectionMaskTextures[meshIndex] = mBakedScene.GetString(textures.reflectionMask);
 				}
-				aObject->LoadAssignedMeshTextures(meshIndex);
+
+				SubmitLoadingJob([aObject, meshIndex, hasCustomTextures]()
+				{
+					if (hasCustomTextures)
+						aObject->LoadCustomMeshTextures(meshIndex);
+					aObject->LoadAssignedMeshTextures(meshIndex);
+				}, &texturesCounter);
 			}
-			aObject->LoadCustomMaterialTextures();
+			SubmitLoadingJob([aObject]() { aObject->LoadCustomMaterialTextures(); }, &texturesCounter);
+			WaitForLoadingJobs(texturesCounter);
 		}
 
 		// load world transform
 		{
-			if (mSceneJsonRoot["rendering_objects"][i].isMember("transform")) {
-				if (mSceneJsonRoot["rendering_objects"][i]["transform"].size() != 16)
-				{
-					aObject->SetTransformationMatrix(XMMatrixIdentity());
-				}
-				else {
-					float matrix[16];
-					for (Json::Value::ArrayIndex matC = 0; matC != mSceneJsonRoot["rendering_objects"][i]["transform"].size(); matC++) {
-						matrix[matC] = mSceneJsonRoot["rendering_objects"][i]["transform"][matC].asFloat();
-					}
-					XMFLOAT4X4 worldTransform(matrix);
-					aObject->SetTransformationMatrix(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)));
-				}
+			if (record.Has(BAKED_FIELD_TRANSFORM))
+			{
+				XMFLOAT4X4 worldTransform(record.transform);
+				aObject->SetTransformationMatrix(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)));
 			}
 			else
 				aObject->SetTransformationMatrix(XMMatrixIdentity());
@@ -588,10 +690,9 @@ namespace EveryRay_Core
 
 		// load lods
 		{
-			hasLODs = mSceneJsonRoot["rendering_objects"][i].isMember("model_lods");
-			if (hasLODs) {
-				for (Json::Value::ArrayIndex lod = 1 /* 0 is main model loaded before */; lod != mSceneJsonRoot["rendering_objects"][i]["model_lods"].size(); lod++) {
-					std::string path = mSceneJsonRoot["rendering_objects"][i]["model_lods"][lod]["path"].asString();
+			if (record.Has(BAKED_FIELD_MODEL_LODS)) {
+				for (UINT lod = 1 /* 0 is main model loaded before */; lod < record.lodCount; lod++) {
+					std::string path = mBakedScene.GetLODPath(record.firstLOD + lod);
 					aObject->AddLOD(ER_Utility::GetFilePath(path));
 				}
 			}
@@ -603,15 +704,17 @@ namespace EveryRay_Core
 	// [WARNING] NOT THREAD-SAFE!
 	void ER_Scene::LoadRenderingObjectInstancedData(ER_RenderingObject* aObject)
 	{
-		int i = aObject->GetIndexInScene();
 		bool isInstanced = aObject->IsInstanced();
 		if (!isInstanced)
 			return;
 
-		bool hasLODs = mSceneJsonRoot["rendering_objects"][i].isMember("model_lods");
+		const ER_BakedSceneObject& record = mBakedScene.GetObjectRecord(aObject->GetIndexInScene());
+		const XMFLOAT4X4* instancesTransforms = mBakedScene.GetInstanceTransforms(record.firstInstanceTransform);
+
+		bool hasLODs = record.Has(BAKED_FIELD_MODEL_LODS);
 		if (hasLODs)
 		{
-			for (int lod = 0; lod < static_cast<int>(mSceneJsonRoot["rendering_objects"][i]["model_lods"].size()); lod++)
+			for (int lod = 0; lod < static_cast<int>(record.lodCount); lod++)
 			{
 				aObject->LoadInstanceBuffers(lod);
 				if (aObject->GetTerrainPlacement() && aObject->GetTerrainProceduralInstanceCount() > 0)
@@ -623,16 +726,10 @@ namespace EveryRay_Core
 				}
 				else
 				{
-					if (mSceneJsonRoot["rendering_objects"][i].isMember("instances_transforms")) {
-						aObject->ResetInstanceData(mSceneJsonRoot["rendering_objects"][i]["instances_transforms"].size(), true, lod);
-						for (Json::Value::ArrayIndex instance = 0; instance != mSceneJsonRoot["rendering_objects"][i]["instances_transforms"].size(); instance++) {
-							float matrix[16];
-							for (Json::Value::ArrayIndex matC = 0; matC != mSceneJsonRoot["rendering_objects"][i]["instances_transforms"][instance]["transform"].size(); matC++) {
-								matrix[matC] = mSceneJsonRoot["rendering_objects"][i]["instances_transforms"][instance]["transform"][matC].asFloat();
-							}
-							XMFLOAT4X4 worldTransform(matrix);
-							aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)), lod);
-						}
+					if (record.Has(BAKED_FIELD_INSTANCES_TRANSFORMS)) {
+						aObject->ResetInstanceData(record.instanceTransformCount, true, lod);
+						for (UINT instance = 0; instance < record.instanceTransformCount; instance++)
+							aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&instancesTransforms[instance])), lod);
 					}
 					else {
 						aObject->ResetInstanceData(1, true, lod);
@@ -654,16 +751,10 @@ namespace EveryRay_Core
 			}
 			else
 			{
-				if (mSceneJsonRoot["rendering_objects"][i].isMember("instances_transforms")) {
-					aObject->ResetInstanceData(mSceneJsonRoot["rendering_objects"][i]["instances_transforms"].size(), true);
-					for (Json::Value::ArrayIndex instance = 0; instance != mSceneJsonRoot["rendering_objects"][i]["instances_transforms"].size(); instance++) {
-						float matrix[16];
-						for (Json::Value::ArrayIndex matC = 0; matC != mSceneJsonRoot["rendering_objects"][i]["instances_transforms"][instance]["transform"].size(); matC++) {
-							matrix[matC] = mSceneJsonRoot["rendering_objects"][i]["instances_transforms"][instance]["transform"][matC].asFloat();
-						}
-						XMFLOAT4X4 worldTransform(matrix);
-						aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)));
-					}
+				if (record.Has(BAKED_FIELD_INSTANCES_TRANSFORMS)) {
+					aObject->ResetInstanceData(record.instanceTransformCount, true);
+					for (UINT instance = 0; instance < record.instanceTransformCount; instance++)
+						aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&instancesTransforms[instance])));
 				}
 				else {
 					aObject->ResetInstanceData(1, true);
@@ -679,6 +770,8 @@ namespace EveryRay_Core
 		if (mScenePath.empty())
 			throw ER_CoreException("Can't save to scene json file! Empty scene name...");
 
+		LoadFullSceneJsonRoot();
+
 		// store world transform
 		for (Json::Value::ArrayIndex i = 0; i != mSceneJsonRoot["rendering_objects"].size(); i++) {
 			Json::Value content(Json::arrayValue);
@@ -759,15 +852,10 @@ namespace EveryRay_Core
 
 	void ER_Scene::LoadFoliageZonesData(std::vector<ER_Foliage*>& foliageZones, ER_DirectionalLight& light)
 	{
-		Json::Reader reader;
-		std::ifstream scene(mScenePath.c_str(), std::ifstream::binary);
 		ER_Core* core = GetCore();
 		assert(core);
 
-		if (!reader.parse(scene, mSceneJsonRoot)) {
-			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
-		}
-		else {
+		{
 			if (mSceneJsonRoot.isMember("foliage_zones")) 
 			{
 				for (Json::Value::ArrayIndex i = 0; i != mSceneJsonRoot["foliage_zones"].size(); i++)
@@ -788,13 +876,18 @@ namespace EveryRay_Core
 					if (mSceneJsonRoot["foliage_zones"][i].isMember("placed_height_delta"))
 						placedHeightDelta = mSceneJsonRoot["foliage_zones"][i]["placed_height_delta"].asFloat();
 
+					// zones without a seed still get a stable one (based on their order in the level)
+					UINT placementSeed = ER_Placement::CombineSeeds(PLACEMENT_DEFAULT_SEED, i);
+					if (mSceneJsonRoot["foliage_zones"][i].isMember("placement_seed"))
+						placementSeed = mSceneJsonRoot["foliage_zones"][i]["placement_seed"].asUInt();
+
 					foliageZones.push_back(new ER_Foliage(*core, mCamera, light,
 						mSceneJsonRoot["foliage_zones"][i]["patch_count"].asInt(),
 						ER_Utility::GetFilePath(mSceneJsonRoot["foliage_zones"][i]["texture_path"].asString()),
 						mSceneJsonRoot["foliage_zones"][i]["average_scale"].asFloat(),
 						mSceneJsonRoot["foliage_zones"][i]["distribution_radius"].asFloat(),
 						XMFLOAT3(vec3[0], vec3[1], vec3[2]),
-						(FoliageBillboardType)mSceneJsonRoot["foliage_zones"][i]["type"].asInt(), placedOnTerrain, terrainChannel, placedHeightDelta));
+						(FoliageBillboardType)mSceneJsonRoot["foliage_zones"][i]["type"].asInt(), placedOnTerrain, terrainChannel, placedHeightDelta, placementSeed));
 				}
 			}
 		}
@@ -805,6 +898,8 @@ namespace EveryRay_Core
 		if (mScenePath.empty())
 			throw ER_CoreException("Can't save to scene json file! Empty scene name...");
 
+		LoadFullSceneJsonRoot();
+
 		if (mSceneJsonRoot.isMember("foliage_zones")) {
 			assert(foliageZones.size() == mSceneJsonRoot["foliage_zones"].size());
 			float vec3[3];
@@ -835,13 +930,6 @@ namespace EveryRay_Core
 
 		ER_PostProcessingStack* pp = core->GetLevel()->mPostProcessingStack;
 
-		Json::Reader reader;
-		std::ifstream scene(mScenePath.c_str(), std::ifstream::binary);
-
-		if (!reader.parse(scene, mSceneJsonRoot)) {
-			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
-		}
-		else
 		{
 			if (mSceneJsonRoot.isMember("posteffects_volumes")) 
 			{
@@ -950,6 +1038,8 @@ namespace EveryRay_Core
 		if (mScenePath.empty())
 			throw ER_CoreException("Can't save to scene json file! Empty scene name...");
 
+		LoadFullSceneJsonRoot();
+
 		ER_Core* core = GetCore();
 		assert(core);
 
@@ -1038,6 +1128,8 @@ namespace EveryRay_Core
 		if (mScenePath.empty())
 			throw ER_CoreException("Can't save to scene json file! Empty scene name...");
 
+		LoadFullSceneJsonRoot();
+
 		std::vector<ER_PointLight*>& lights = GetCore()->GetLevel()->mPointLights;
 		
 		// store world transform
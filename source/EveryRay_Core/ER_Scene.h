@@ -4,6 +4,8 @@
 #include "ER_Camera.h"
 #include "ER_ModelMaterial.h"
 #include "ER_Material.h"
+#include "ER_BakedScene.h"
+#include "ER_JobSystem.h"
 
 #include "..\JsonCpp\include\json\json.h"
 
@@ -41,7 +43,16 @@ namespace EveryRay_Core
 		T GetValueFromSceneRoot(const std::string& aName);
 		bool IsValueInSceneRoot(const std::string& aName);
 
+		// CPU-only comparison of the json (parse + bake in memory) and the baked (map) load paths of the scene data; does not write the bake to disk
+		static void BenchmarkLoad(const std::string& aScenePath);
+
 	private:
+		void LoadBakedScene();
+		static bool LoadSceneData(const std::string& aScenePath, bool aUseBakedFile, bool aWriteBake, ER_BakedScene& aOutBakedScene, Json::Value& aOutSceneRoot);
+		static void ParseSceneJson(const std::string& aScenePath, Json::Value& aOutSceneRoot);
+		void LoadFullSceneJsonRoot();
+		void SubmitLoadingJob(const std::function<void()>& aTask, ER_JobCounter* aCounter);
+		void WaitForLoadingJobs(const ER_JobCounter& aCounter);
 		void LoadRenderingObjectInstancedData(ER_RenderingObject* aObject);
 		
 		void CreateStandardMaterialsRootSignatures();
@@ -52,6 +63,9 @@ namespace EveryRay_Core
 
 		Json::Value mSceneJsonRoot;
 		std::string mScenePath;
+		bool mIsSceneJsonRootFull = false; // false when loaded from the baked scene (i.e., no "rendering_objects")
+
+		ER_BakedScene mBakedScene;
 
 		ER_Camera& mCamera;
 	};
@@ -79,6 +79,9 @@ namespace EveryRay_Core
 			mRootSignature->InitConstant(rhi, SHADOWMAP_MAT_ROOT_ROOT_CONSTANT_INDEX, 2 /*we already use 2 slots for CBVs*/, 1 /* only 1 constant for LOD index*/, ER_RHI_SHADER_VISIBILITY_ALL);
 			mRootSignature->Finalize(rhi, "ER_RHI_GPURootSignature: ShadowMapMaterial Pass", true);
 		}
+
+		mPSONonInstanced = rhi->GetPSOHandle(psoNameNonInstanced);
+		mPSOInstanced = rhi->GetPSOHandle(psoNameInstanced);
 	}
 
 	ER_ShadowMapper::~ER_ShadowMapper()
@@ -151,9 +154,9 @@ namespace EveryRay_Core
 
 		auto rhi = GetCore()->GetRHI();
 
-		mOriginalRS = rhi->GetCurrentRasterizerState();
-		mOriginalViewport = rhi->GetCurrentViewport();
-		mOriginalRect = rhi->GetCurrentRect();
+		mOriginalRS[cascadeIndex] = rhi->GetCurrentRasterizerState();
+		mOriginalViewport[cascadeIndex] = rhi->GetCurrentViewport();
+		mOriginalRect[cascadeIndex] = rhi->GetCurrentRect();
 
 		ER_RHI_Viewport newViewport;
 		newViewport.TopLeftX = 0.0f;
@@ -178,9 +181,9 @@ namespace EveryRay_Core
 		auto rhi = GetCore()->GetRHI();
 
 		rhi->UnbindRenderTargets();
-		rhi->SetViewport(mOriginalViewport);
-		rhi->SetRect(mOriginalRect);
-		rhi->SetRasterizerState(mOriginalRS);
+		rhi->SetViewport(mOriginalViewport[cascadeIndex]);
+		rhi->SetRect(mOriginalRect[cascadeIndex]);
+		rhi->SetRasterizerState(mOriginalRS[cascadeIndex]);
 	}
 
 	XMMATRIX ER_ShadowMapper::GetViewMatrix(int cascadeIndex /*= 0*/) const
@@ -317,65 +320,106 @@ namespace EveryRay_Core
 	}
 
 	void ER_ShadowMapper::Draw(const ER_Scene* scene, ER_Terrain* terrain)
+	{
+		auto rhi = GetCore()->GetRHI();
+		ER_JobSystem* jobSystem = GetCore()->GetJobSystem();
+
+		// one recording context per cascade
+		if (jobSystem && rhi->IsParallelRecordingSupported())
+		{
+			// PSOs can not be created while recording in parallel
+			const std::string materialName = ER_MaterialHelper::shadowMapMaterialName + " 0"; // same shaders and formats for all cascades
+			for (auto renderingObjectInfo = scene->objects.begin(); renderingObjectInfo != scene->objects.end(); renderingObjectInfo++)
+			{
+				ER_RenderingObject* renderingObject = renderingObjectInfo->second;
+				auto materialInfo = renderingObject->GetMaterials().find(materialName);
+				if (materialInfo != renderingObject->GetMaterials().end())
+					PreparePSO(renderingObject->IsInstanced() ? mPSOInstanced : mPSONonInstanced, materialInfo->second, 0);
+			}
+			if (terrain)
+				terrain->PreparePSO(TerrainRenderPass::TERRAIN_SHADOW, { mShadowMaps[0] }, nullptr, this, 0);
+
+			rhi->BeginParallelRecording();
+			ER_JobCounter counter;
+			jobSystem->ParallelFor(NUM_SHADOW_CASCADES, 1, [&](UINT aCascadeIndex)
+			{
+				rhi->BeginRecordingContext(aCascadeIndex);
+				DrawCascade(static_cast<int>(aCascadeIndex), scene, terrain);
+				rhi->EndRecordingContext();
+			}, &counter);
+			jobSystem->Wait(counter);
+			rhi->EndParallelRecording();
+		}
+		else
+		{
+			for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
+				DrawCascade(i, scene, terrain);
+		}
+	}
+
+	void ER_ShadowMapper::DrawCascade(int cascadeIndex, const ER_Scene* scene, ER_Terrain* terrain)
 	{
 		auto rhi = GetCore()->GetRHI();
 
 		ER_MaterialSystems materialSystems;
 		materialSystems.mShadowMapper = this;
 
-		for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
-		{
-			std::string materialName = ER_MaterialHelper::shadowMapMaterialName + " " + std::to_string(i);
-			BeginRenderingToShadowMap(i);
+		std::string materialName = ER_MaterialHelper::shadowMapMaterialName + " " + std::to_string(cascadeIndex);
+		BeginRenderingToShadowMap(cascadeIndex);
 
-			rhi->BeginEventTag("EveryRay: Shadow Maps (terrain), cascade " + std::to_string(i));
-			if (terrain)
-				terrain->Draw(TerrainRenderPass::TERRAIN_SHADOW, { mShadowMaps[i] }, nullptr, this, nullptr, i, nullptr, true);
-			rhi->EndEventTag();
+		rhi->BeginEventTag("EveryRay: Shadow Maps (terrain), cascade " + std::to_string(cascadeIndex));
+		if (terrain)
+			terrain->Draw(TerrainRenderPass::TERRAIN_SHADOW, { mShadowMaps[cascadeIndex] }, nullptr, this, nullptr, cascadeIndex);
+		rhi->EndEventTag();
 
-			rhi->BeginEventTag("EveryRay: Shadow Maps (objects), cascade " + std::to_string(i));
+		rhi->BeginEventTag("EveryRay: Shadow Maps (objects), cascade " + std::to_string(cascadeIndex));
 
-			rhi->SetRootSignature(mRootSignature);
-			rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		rhi->SetRootSignature(mRootSignature);
+		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-			int objectIndex = 0;
-			std::string psoName;
-			for (auto renderingObjectInfo = scene->objects.begin(); renderingObjectInfo != scene->objects.end(); renderingObjectInfo++, objectIndex++)
+		int objectIndex = 0;
+		ER_RHI_PSO_HANDLE pso;
+		for (auto renderingObjectInfo = scene->objects.begin(); renderingObjectInfo != scene->objects.end(); renderingObjectInfo++, objectIndex++)
+		{
+			ER_RenderingObject* renderingObject = renderingObjectInfo->second;
+			pso = renderingObject->IsInstanced() ? mPSOInstanced : mPSONonInstanced;
+			auto materialInfo = renderingObject->GetMaterials().find(materialName);
+			if (materialInfo != renderingObject->GetMaterials().end())
 			{
-				ER_RenderingObject* renderingObject = renderingObjectInfo->second;
-				psoName = renderingObject->IsInstanced() ? psoNameInstanced : psoNameNonInstanced;
-				auto materialInfo = renderingObject->GetMaterials().find(materialName);
-				if (materialInfo != renderingObject->GetMaterials().end())
+				ER_Material* material = materialInfo->second;
+				PreparePSO(pso, material, cascadeIndex);
+				rhi->SetPSO(pso);
+				for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
 				{
-					ER_Material* material = materialInfo->second;
-					if (!rhi->IsPSOReady(psoName))
-					{
-						rhi->InitializePSO(psoName);
-						rhi->SetRasterizerState(ER_SHADOW_RS);
-						rhi->SetBlendState(ER_NO_BLEND);
-						rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
-						material->PrepareShaders();
-						rhi->SetRenderTargetFormats({}, mShadowMaps[i]);
-						rhi->SetRootSignatureToPSO(psoName, mRootSignature);
-						rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-						rhi->FinalizePSO(psoName);
-					}
-					rhi->SetPSO(psoName);
-					for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
-					{
-						static_cast<ER_ShadowMapMaterial*>(material)->PrepareForRendering(materialSystems, renderingObject, meshIndex, i, mRootSignature);
-						if (!renderingObject->IsInstanced())
-							renderingObject->DrawLOD(materialName, true, meshIndex, renderingObject->GetLODCount() - 1); //drawing highest LOD
-						else
-							renderingObject->Draw(materialName, true, meshIndex);
-					}
+					static_cast<ER_ShadowMapMaterial*>(material)->PrepareForRendering(materialSystems, renderingObject, meshIndex, cascadeIndex, mRootSignature);
+					if (!renderingObject->IsInstanced())
+						renderingObject->DrawLOD(materialName, true, meshIndex, renderingObject->GetLODCount() - 1); //drawing highest LOD
+					else
+						renderingObject->Draw(materialName, true, meshIndex);
 				}
 			}
-			rhi->EndEventTag();
-
-			rhi->UnsetPSO();
-			StopRenderingToShadowMap(i);
 		}
+		rhi->EndEventTag();
+
+		rhi->UnsetPSO();
+		StopRenderingToShadowMap(cascadeIndex);
+	}
+
+	void ER_ShadowMapper::PreparePSO(ER_RHI_PSO_HANDLE aPSO, ER_Material* aMaterial, int cascadeIndex)
+	{
+		auto rhi = GetCore()->GetRHI();
+		if (rhi->IsPSOReady(aPSO))
+			return;
+
+		rhi->InitializePSO(aPSO);
+		rhi->SetRasterizerState(ER_SHADOW_RS);
+		rhi->SetBlendState(ER_NO_BLEND);
+		rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
+		aMaterial->PrepareShaders();
+		rhi->SetRenderTargetFormats({}, mShadowMaps[cascadeIndex]);
+		rhi->SetRootSignatureToPSO(aPSO, mRootSignature);
+		rhi->SetTopologyTypeToPSO(aPSO, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		rhi->FinalizePSO(aPSO);
 	}
 
 	float ER_ShadowMapper::GetCameraFarShadowCascadeDistance(int index) const
@@ -11,6 +11,7 @@ namespace EveryRay_Core
 	class ER_DirectionalLight;
 	class ER_Scene;
 	class ER_Terrain;
+	class ER_Material;
 
 	enum ShadowQuality
 	{
@@ -43,20 +44,25 @@ namespace EveryRay_Core
 	private:
 		XMMATRIX GetLightProjectionMatrixInFrustum(int index, ER_Frustum& cameraFrustum, ER_DirectionalLight& light);
 		XMMATRIX GetProjectionBoundingSphere(int index, float& sphereRadius);
+		void DrawCascade(int cascadeIndex, const ER_Scene* scene, ER_Terrain* terrain);
+		void PreparePSO(ER_RHI_PSO_HANDLE aPSO, ER_Material* aMaterial, int cascadeIndex);
 
 		ER_Camera& mCamera;
 		ER_DirectionalLight& mDirectionalLight;
 
 		ER_RHI_GPURootSignature* mRootSignature = nullptr;
+		ER_RHI_PSO_HANDLE mPSONonInstanced = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOInstanced = ER_RHI_INVALID_PSO_HANDLE;
 
 		std::vector<ER_RHI_GPUTexture*> mShadowMaps;
 		std::vector<ER_Projector> mLightProjectors;
 		std::vector<ER_Frustum> mCameraCascadesFrustums;
 		std::vector<XMFLOAT3> mLightProjectorCenteredPositions;
 
-		ER_RHI_RASTERIZER_STATE mOriginalRS;
-		ER_RHI_Viewport mOriginalViewport;
-		ER_RHI_Rect mOriginalRect;
+		// per cascade: cascades can be recorded in parallel
+		ER_RHI_RASTERIZER_STATE mOriginalRS[NUM_SHADOW_CASCADES];
+		ER_RHI_Viewport mOriginalViewport[NUM_SHADOW_CASCADES];
+		ER_RHI_Rect mOriginalRect[NUM_SHADOW_CASCADES];
 		XMMATRIX mShadowMapViewMatrix;
 		XMMATRIX mShadowMapProjectionMatrix;
 		UINT mResolution = 0;
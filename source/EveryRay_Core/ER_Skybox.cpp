@@ -72,7 +72,7 @@ namespace EveryRay_Core
 			meshes[0].CreateVertexBuffer_Position(mVertexBuffer);
 			mIndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Skybox - Index Buffer");
 			meshes[0].CreateIndexBuffer(mIndexBuffer);
-			mIndexCount = static_cast<UINT>(meshes[0].Indices().size());
+			mIndexCount = meshes[0].IndexCount();
 		}
 
 		//skybox rendering
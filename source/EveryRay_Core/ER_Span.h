@@ -0,0 +1,30 @@
+#pragma once
+#include "Common.h"
+
+#include <initializer_list>
+
+namespace EveryRay_Core
+{
+	// Read-only view (pointer + count) of contiguous data owned by someone else: a vector, a C array, a brace list or a mapped file (i.e., mesh streams read in place).
+	// A span does not own its data, so it is only valid as long as its source is (the array of a brace list is destroyed at the end of the full-expression).
+	template <typename T>
+	class ER_Span
+	{
+	public:
+		ER_Span() : mData(nullptr), mSize(0) {}
+		ER_Span(const T* aData, UINT aSize) : mData(aData), mSize(aSize) {}
+		ER_Span(std::initializer_list<T> aList) : mData(aList.begin()), mSize(static_cast<UINT>(aList.size())) {}
+		ER_Span(const std::vector<T>& aVector) : mData(aVector.data()), mSize(static_cast<UINT>(aVector.size())) {}
+		template <UINT N> ER_Span(const T(&aArray)[N]) : mData(aArray), mSize(N) {}
+
+		UINT size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		const T& operator[](UINT aIndex) const { assert(aIndex < mSize); return mData[aIndex]; }
+		const T* data() const { return mData; }
+		const T* begin() const { return mData; }
+		const T* end() const { return mData + mSize; }
+	private:
+		const T* mData;
+		UINT mSize;
+	};
+}
@@ -0,0 +1,680 @@
+#include "ER_SphericalHarmonics.h"
+#include "ER_JobSystem.h"
+
+#include "DirectXSH.h"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+#define SPHERICAL_HARMONICS_PREFILTER_BATCH_SIZE 4 // rows per job
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		// Exact solid angle of the texel (aX, aY) of a face (same for all faces)
+		float GetTexelSolidAngle(UINT aX, UINT aY, UINT aSize)
+		{
+			auto area = [](float x, float y) { return atan2f(x * y, sqrtf(x * x + y * y + 1.0f)); };
+
+			const float invSize = 1.0f / static_cast<float>(aSize);
+			const float x0 = 2.0f * aX * invSize - 1.0f;
+			const float x1 = 2.0f * (aX + 1) * invSize - 1.0f;
+			const float y0 = 2.0f * aY * invSize - 1.0f;
+			const float y1 = 2.0f * (aY + 1) * invSize - 1.0f;
+			return area(x0, y0) - area(x0, y1) - area(x1, y0) + area(x1, y1);
+		}
+
+		float RadicalInverse(UINT aBits)
+		{
+			aBits = (aBits << 16u) | (aBits >> 16u);
+			aBits = ((aBits & 0x55555555u) << 1u) | ((aBits & 0xAAAAAAAAu) >> 1u);
+			aBits = ((aBits & 0x33333333u) << 2u) | ((aBits & 0xCCCCCCCCu) >> 2u);
+			aBits = ((aBits & 0x0F0F0F0Fu) << 4u) | ((aBits & 0xF0F0F0F0u) >> 4u);
+			aBits = ((aBits & 0x00FF00FFu) << 8u) | ((aBits & 0xFF00FF00u) >> 8u);
+			return static_cast<float>(aBits) * 2.3283064365386963e-10f;
+		}
+
+		// Used by the tests and the benchmark
+		void FillCubemap(ER_CPUCubemap& aCubemap, const std::function<XMFLOAT3(const XMFLOAT3&)>& aEnvironment)
+		{
+			const UINT size = aCubemap.GetSize();
+			for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+			{
+				XMFLOAT4* texels = aCubemap.GetFace(face);
+				for (UINT y = 0; y < size; y++)
+				{
+					for (UINT x = 0; x < size; x++)
+					{
+						XMFLOAT3 direction = ER_CPUCubemap::GetDirection(face, (x + 0.5f) / size, (y + 0.5f) / size);
+						XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+						const XMFLOAT3 color = aEnvironment(direction);
+						texels[y * size + x] = XMFLOAT4(color.x, color.y, color.z, 1.0f);
+					}
+				}
+			}
+			aCubemap.GenerateMips();
+		}
+
+		float GetMaxError(const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			return std::max(fabs(a.x - b.x), std::max(fabs(a.y - b.y), fabs(a.z - b.z)));
+		}
+	}
+
+	void ER_CPUCubemap::Initialize(UINT aSize, UINT aMipsCount)
+	{
+		assert(aSize > 0 && aMipsCount > 0);
+
+		mSize = aSize;
+		mMipsCount = aMipsCount;
+		mMipsOffsets.resize(aMipsCount);
+		mFaceTexelsCount = 0;
+		for (UINT mip = 0; mip < aMipsCount; mip++)
+		{
+			mMipsOffsets[mip] = mFaceTexelsCount;
+			mFaceTexelsCount += GetSize(mip) * GetSize(mip);
+		}
+		mTexels.assign(static_cast<size_t>(mFaceTexelsCount) * CPU_CUBEMAP_FACES_COUNT, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+	}
+
+	void ER_CPUCubemap::GenerateMips()
+	{
+		for (UINT mip = 1; mip < mMipsCount; mip++)
+		{
+			const UINT size = GetSize(mip);
+			const UINT parentSize = GetSize(mip - 1);
+			for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+			{
+				const XMFLOAT4* parent = GetFace(face, mip - 1);
+				XMFLOAT4* texels = GetFace(face, mip);
+				for (UINT y = 0; y < size; y++)
+				{
+					for (UINT x = 0; x < size; x++)
+					{
+						const UINT x0 = std::min(2 * x, parentSize - 1), x1 = std::min(2 * x + 1, parentSize - 1);
+						const UINT y0 = std::min(2 * y, parentSize - 1), y1 = std::min(2 * y + 1, parentSize - 1);
+						XMVECTOR sum = XMVectorAdd(XMLoadFloat4(&parent[y0 * parentSize + x0]), XMLoadFloat4(&parent[y0 * parentSize + x1]));
+						sum = XMVectorAdd(sum, XMVectorAdd(XMLoadFloat4(&parent[y1 * parentSize + x0]), XMLoadFloat4(&parent[y1 * parentSize + x1])));
+						XMStoreFloat4(&texels[y * size + x], XMVectorScale(sum, 0.25f));
+					}
+				}
+			}
+		}
+	}
+
+	XMFLOAT3 ER_CPUCubemap::GetDirection(UINT aFace, float aU, float aV)
+	{
+		const float a = aU * 2.0f - 1.0f;
+		const float b = aV * 2.0f - 1.0f;
+		switch (aFace)
+		{
+		case 0: return XMFLOAT3(1.0f, -b, -a);
+		case 1: return XMFLOAT3(-1.0f, -b, a);
+		case 2: return XMFLOAT3(a, 1.0f, b);
+		case 3: return XMFLOAT3(a, -1.0f, -b);
+		case 4: return XMFLOAT3(a, -b, 1.0f);
+		default: return XMFLOAT3(-a, -b, -1.0f);
+		}
+	}
+
+	XMFLOAT3 ER_CPUCubemap::Sample(const XMFLOAT3& aDirection, float aMip) const
+	{
+		// inverse of GetDirection()
+		const float absX = fabs(aDirection.x), absY = fabs(aDirection.y), absZ = fabs(aDirection.z);
+		UINT face;
+		float a, b;
+		if (absX >= absY && absX >= absZ)
+		{
+			face = (aDirection.x >= 0.0f) ? 0 : 1;
+			a = (aDirection.x >= 0.0f) ? -aDirection.z / absX : aDirection.z / absX;
+			b = -aDirection.y / absX;
+		}
+		else if (absY >= absZ)
+		{
+			face = (aDirection.y >= 0.0f) ? 2 : 3;
+			a = aDirection.x / absY;
+			b = (aDirection.y >= 0.0f) ? aDirection.z / absY : -aDirection.z / absY;
+		}
+		else
+		{
+			face = (aDirection.z >= 0.0f) ? 4 : 5;
+			a = (aDirection.z >= 0.0f) ? aDirection.x / absZ : -aDirection.x / absZ;
+			b = -aDirection.y / absZ;
+		}
+		const float u = (a + 1.0f) * 0.5f;
+		const float v = (b + 1.0f) * 0.5f;
+
+		const float mip = std::min(std::max(aMip, 0.0f), static_cast<float>(mMipsCount - 1));
+		const UINT mip0 = static_cast<UINT>(mip);
+		const float mipLerp = mip - static_cast<float>(mip0);
+		if (mipLerp <= 0.0f || mip0 + 1 >= mMipsCount)
+			return SampleMip(face, u, v, mip0);
+
+		const XMFLOAT3 color0 = SampleMip(face, u, v, mip0);
+		const XMFLOAT3 color1 = SampleMip(face, u, v, mip0 + 1);
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVectorLerp(XMLoadFloat3(&color0), XMLoadFloat3(&color1), mipLerp));
+		return result;
+	}
+
+	XMFLOAT3 ER_CPUCubemap::SampleMip(UINT aFace, float aU, float aV, UINT aMip) const
+	{
+		const UINT size = GetSize(aMip);
+		const XMFLOAT4* texels = GetFace(aFace, aMip);
+
+		const float x = std::min(std::max(aU * size - 0.5f, 0.0f), static_cast<float>(size - 1));
+		const float y = std::min(std::max(aV * size - 0.5f, 0.0f), static_cast<float>(size - 1));
+		const UINT x0 = static_cast<UINT>(x), y0 = static_cast<UINT>(y);
+		const UINT x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+
+		const XMVECTOR top = XMVectorLerp(XMLoadFloat4(&texels[y0 * size + x0]), XMLoadFloat4(&texels[y0 * size + x1]), x - x0);
+		const XMVECTOR bottom = XMVectorLerp(XMLoadFloat4(&texels[y1 * size + x0]), XMLoadFloat4(&texels[y1 * size + x1]), x - x0);
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVectorLerp(top, bottom, y - y0));
+		return result;
+	}
+
+	void ER_SphericalHarmonics::EvaluateBasis(const XMFLOAT3& aDirection, UINT aOrder, float* aOutBasis)
+	{
+		assert(aOrder >= 1 && aOrder <= SPHERICAL_HARMONICS_MAX_ORDER);
+		const float x = aDirection.x, y = aDirection.y, z = aDirection.z;
+
+		aOutBasis[0] = 0.282094792f;
+		if (aOrder < 2)
+			return;
+		aOutBasis[1] = -0.488602512f * y;
+		aOutBasis[2] = 0.488602512f * z;
+		aOutBasis[3] = -0.488602512f * x;
+		if (aOrder < 3)
+			return;
+		aOutBasis[4] = 1.092548431f * x * y;
+		aOutBasis[5] = -1.092548431f * y * z;
+		aOutBasis[6] = 0.946174696f * z * z - 0.315391565f;
+		aOutBasis[7] = -1.092548431f * x * z;
+		aOutBasis[8] = 0.546274215f * (x * x - y * y);
+	}
+
+	XMFLOAT3 ER_SphericalHarmonics::Evaluate(const XMFLOAT3* aCoefficients, UINT aOrder, const XMFLOAT3& aDirection)
+	{
+		float basis[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+		EvaluateBasis(aDirection, aOrder, basis);
+
+		XMVECTOR result = XMVectorZero();
+		for (UINT i = 0; i < aOrder * aOrder; i++)
+			result = XMVectorMultiplyAdd(XMLoadFloat3(&aCoefficients[i]), XMVectorReplicate(basis[i]), result);
+
+		XMFLOAT3 value;
+		XMStoreFloat3(&value, result);
+		return value;
+	}
+
+	void ER_SphericalHarmonics::ProjectCubemap(const ER_CPUCubemap& aCubemap, UINT aOrder, XMFLOAT3* aOutCoefficients, UINT aMip)
+	{
+		assert(aOrder >= 1 && aOrder <= SPHERICAL_HARMONICS_MAX_ORDER);
+		assert(aMip < aCubemap.GetMipsCount());
+
+		const UINT coefficientsCount = aOrder * aOrder;
+		const UINT size = aCubemap.GetSize(aMip);
+		const UINT rowBlocksCount = (size + 3) / 4; // 4 texels per block
+		const UINT rowStride = rowBlocksCount * 4;
+
+		// face coordinates of the texels' centers and their solid angles (same for all faces); the padding of the last block has 0 weight
+		std::vector<float> coordinates(rowStride, 0.0f);
+		std::vector<float> solidAngles(static_cast<size_t>(size) * rowStride, 0.0f);
+		for (UINT x = 0; x < size; x++)
+			coordinates[x] = 2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(size) - 1.0f;
+		for (UINT y = 0; y < size; y++)
+			for (UINT x = 0; x < size; x++)
+				solidAngles[y * rowStride + x] = GetTexelSolidAngle(x, y, size);
+
+		const XMVECTOR one = XMVectorSplatOne();
+		double sums[SPHERICAL_HARMONICS_MAX_COEF_COUNT][3] = {};
+		XMVECTOR basis[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+		basis[0] = XMVectorReplicate(0.282094792f);
+
+		for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+		{
+			// per face in floats, then in doubles
+			XMVECTOR faceSums[SPHERICAL_HARMONICS_MAX_COEF_COUNT][3];
+			for (UINT i = 0; i < coefficientsCount; i++)
+				faceSums[i][0] = faceSums[i][1] = faceSums[i][2] = XMVectorZero();
+
+			const XMFLOAT4* texels = aCubemap.GetFace(face, aMip);
+			for (UINT y = 0; y < size; y++)
+			{
+				const XMVECTOR b = XMVectorReplicate(2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(size) - 1.0f);
+				for (UINT block = 0; block < rowBlocksCount; block++)
+				{
+					const UINT firstX = block * 4;
+					const XMVECTOR a = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&coordinates[firstX]));
+					const XMVECTOR weights = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&solidAngles[y * rowStride + firstX]));
+
+					// 4 texels to RGBA "rows"
+					XMMATRIX colors;
+					for (UINT i = 0; i < 4; i++)
+						colors.r[i] = XMLoadFloat4(&texels[y * size + std::min(firstX + i, size - 1)]);
+					colors = XMMatrixTranspose(colors);
+
+					XMVECTOR x, yDir, z;
+					switch (face)
+					{
+					case 0: x = one; yDir = XMVectorNegate(b); z = XMVectorNegate(a); break;
+					case 1: x = XMVectorNegate(one); yDir = XMVectorNegate(b); z = a; break;
+					case 2: x = a; yDir = one; z = b; break;
+					case 3: x = a; yDir = XMVectorNegate(one); z = XMVectorNegate(b); break;
+					case 4: x = a; yDir = XMVectorNegate(b); z = one; break;
+					default: x = XMVectorNegate(a); yDir = XMVectorNegate(b); z = XMVectorNegate(one); break;
+					}
+					const XMVECTOR invLength = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(a, a, XMVectorMultiplyAdd(b, b, one)));
+					x = XMVectorMultiply(x, invLength);
+					yDir = XMVectorMultiply(yDir, invLength);
+					z = XMVectorMultiply(z, invLength);
+
+					// same as EvaluateBasis()
+					if (aOrder > 1)
+					{
+						basis[1] = XMVectorScale(yDir, -0.488602512f);
+						basis[2] = XMVectorScale(z, 0.488602512f);
+						basis[3] = XMVectorScale(x, -0.488602512f);
+					}
+					if (aOrder > 2)
+					{
+						basis[4] = XMVectorScale(XMVectorMultiply(x, yDir), 1.092548431f);
+						basis[5] = XMVectorScale(XMVectorMultiply(yDir, z), -1.092548431f);
+						basis[6] = XMVectorMultiplyAdd(XMVectorMultiply(z, z), XMVectorReplicate(0.946174696f), XMVectorReplicate(-0.315391565f));
+						basis[7] = XMVectorScale(XMVectorMultiply(x, z), -1.092548431f);
+						basis[8] = XMVectorScale(XMVectorSubtract(XMVectorMultiply(x, x), XMVectorMultiply(yDir, yDir)), 0.546274215f);
+					}
+
+					for (UINT i = 0; i < coefficientsCount; i++)
+					{
+						const XMVECTOR weightedBasis = XMVectorMultiply(basis[i], weights);
+						faceSums[i][0] = XMVectorMultiplyAdd(weightedBasis, colors.r[0], faceSums[i][0]);
+						faceSums[i][1] = XMVectorMultiplyAdd(weightedBasis, colors.r[1], faceSums[i][1]);
+						faceSums[i][2] = XMVectorMultiplyAdd(weightedBasis, colors.r[2], faceSums[i][2]);
+					}
+				}
+			}
+
+			for (UINT i = 0; i < coefficientsCount; i++)
+				for (UINT channel = 0; channel < 3; channel++)
+					sums[i][channel] += XMVectorGetX(XMVector4Dot(faceSums[i][channel], one));
+		}
+
+		for (UINT i = 0; i < coefficientsCount; i++)
+			aOutCoefficients[i] = XMFLOAT3(static_cast<float>(sums[i][0]), static_cast<float>(sums[i][1]), static_cast<float>(sums[i][2]));
+	}
+
+	void ER_SphericalHarmonics::ProjectCubemaps(const ER_CPUCubemap* const* aCubemaps, UINT aCubemapsCount, UINT aOrder, XMFLOAT3* aOutCoefficients, ER_JobSystem* aJobSystem)
+	{
+		auto project = [&](UINT aIndex) { ProjectCubemap(*aCubemaps[aIndex], aOrder, &aOutCoefficients[aIndex * aOrder * aOrder]); };
+
+		if (aJobSystem && aCubemapsCount > 1)
+		{
+			ER_JobCounter counter;
+			aJobSystem->ParallelFor(aCubemapsCount, 1, project, &counter);
+			aJobSystem->Wait(counter);
+		}
+		else
+		{
+			for (UINT i = 0; i < aCubemapsCount; i++)
+				project(i);
+		}
+	}
+
+	void ER_SphericalHarmonics::Rotate(const XMFLOAT3* aCoefficients, UINT aOrder, FXMMATRIX aRotation, XMFLOAT3* aOutCoefficients)
+	{
+		assert(aOrder >= 1 && aOrder <= SPHERICAL_HARMONICS_MAX_ORDER);
+		if (aOrder < XM_SH_MINORDER) // constant
+		{
+			aOutCoefficients[0] = aCoefficients[0];
+			return;
+		}
+
+		float channel[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+		float rotatedChannel[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+		for (UINT c = 0; c < 3; c++)
+		{
+			for (UINT i = 0; i < aOrder * aOrder; i++)
+				channel[i] = (&aCoefficients[i].x)[c];
+			XMSHRotate(rotatedChannel, aOrder, aRotation, channel);
+			for (UINT i = 0; i < aOrder * aOrder; i++)
+				(&aOutCoefficients[i].x)[c] = rotatedChannel[i];
+		}
+	}
+
+	void ER_SphericalHarmonics::ConvolveIrradiance(const XMFLOAT3* aCoefficients, UINT aOrder, XMFLOAT3* aOutCoefficients)
+	{
+		assert(aOrder >= 1 && aOrder <= SPHERICAL_HARMONICS_MAX_ORDER);
+		const float bandScales[SPHERICAL_HARMONICS_MAX_ORDER] = { XM_PI, 2.0f * XM_PI / 3.0f, XM_PI / 4.0f };
+
+		for (UINT band = 0; band < aOrder; band++)
+			for (UINT i = band * band; i < (band + 1) * (band + 1); i++)
+				XMStoreFloat3(&aOutCoefficients[i], XMVectorScale(XMLoadFloat3(&aCoefficients[i]), bandScales[band]));
+	}
+
+	void ER_SphericalHarmonics::PrefilterGGX(const ER_CPUCubemap& aSource, ER_CPUCubemap& aOutCubemap, UINT aSamplesCount, ER_JobSystem* aJobSystem)
+	{
+		assert(aSamplesCount > 0 && aOutCubemap.GetMipsCount() > 0);
+
+		struct GGXSample
+		{
+			XMFLOAT3 direction; // tangent space (N = V = (0, 0, 1))
+			float weight; // NoL
+			float sourceMip;
+		};
+		std::vector<GGXSample> samples;
+		const float sourceTexelSolidAngle = 4.0f * XM_PI / (CPU_CUBEMAP_FACES_COUNT * static_cast<float>(aSource.GetSize()) * static_cast<float>(aSource.GetSize()));
+
+		const UINT mipsCount = aOutCubemap.GetMipsCount();
+		for (UINT mip = 0; mip < mipsCount; mip++)
+		{
+			// importance sampling of the GGX lobe, same as ImportanceSampleGGX() in ProbeConvolution.hlsl
+			const float roughness = static_cast<float>(mip) / static_cast<float>(mipsCount);
+			samples.clear();
+			if (mip == 0)
+				samples.push_back({ XMFLOAT3(0.0f, 0.0f, 1.0f), 1.0f, 0.0f });
+			else
+			{
+				const float alpha = roughness * roughness;
+				const float alpha2 = alpha * alpha;
+				for (UINT i = 0; i < aSamplesCount; i++)
+				{
+					const float phi = 2.0f * XM_PI * static_cast<float>(i) / static_cast<float>(aSamplesCount);
+					const float xi = RadicalInverse(i);
+					const float cosTheta = sqrtf((1.0f - xi) / (1.0f + (alpha2 - 1.0f) * xi));
+					const float sinTheta = sqrtf(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+
+					// reflect V = N around H
+					const float NoL = 2.0f * cosTheta * cosTheta - 1.0f;
+					if (NoL <= 0.0f)
+						continue;
+
+					// pdf of L = D(NoH) / 4 when V = N; the source mip covers the solid angle of the sample [GPU Gems 3, ch. 20]
+					const float d = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+					const float pdf = alpha2 / (XM_PI * d * d) * 0.25f;
+					const float sampleSolidAngle = 1.0f / (static_cast<float>(aSamplesCount) * pdf);
+					const float sourceMip = std::max(0.5f * log2f(sampleSolidAngle / sourceTexelSolidAngle) + 1.0f, 0.0f);
+
+					samples.push_back({ XMFLOAT3(2.0f * cosTheta * sinTheta * cosf(phi), 2.0f * cosTheta * sinTheta * sinf(phi), NoL), NoL, sourceMip });
+				}
+			}
+
+			const UINT size = aOutCubemap.GetSize(mip);
+			auto filterRow = [&, mip, size](UINT aRow)
+			{
+				const UINT face = aRow / size;
+				const UINT y = aRow % size;
+				XMFLOAT4* texels = aOutCubemap.GetFace(face, mip) + y * size;
+				for (UINT x = 0; x < size; x++)
+				{
+					const XMFLOAT3 direction = ER_CPUCubemap::GetDirection(face, (static_cast<float>(x) + 0.5f) / size, (static_cast<float>(y) + 0.5f) / size);
+					const XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&direction));
+					const XMVECTOR up = (fabs(XMVectorGetZ(normal)) < 0.999f) ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+					const XMVECTOR tangentX = XMVector3Normalize(XMVector3Cross(up, normal));
+					const XMVECTOR tangentY = XMVector3Cross(normal, tangentX);
+
+					XMVECTOR color = XMVectorZero();
+					float totalWeight = 0.0f;
+					for (const GGXSample& sample : samples)
+					{
+						XMFLOAT3 sampleDirection;
+						XMStoreFloat3(&sampleDirection, XMVectorMultiplyAdd(tangentX, XMVectorReplicate(sample.direction.x),
+							XMVectorMultiplyAdd(tangentY, XMVectorReplicate(sample.direction.y), XMVectorScale(normal, sample.direction.z))));
+						const XMFLOAT3 sampleColor = aSource.Sample(sampleDirection, sample.sourceMip);
+						color = XMVectorMultiplyAdd(XMLoadFloat3(&sampleColor), XMVectorReplicate(sample.weight), color);
+						totalWeight += sample.weight;
+					}
+					if (totalWeight > 0.0f)
+						color = XMVectorScale(color, 1.0f / totalWeight);
+					XMStoreFloat4(&texels[x], XMVectorSetW(color, 1.0f));
+				}
+			};
+
+			const UINT rowsCount = CPU_CUBEMAP_FACES_COUNT * size;
+			if (aJobSystem && rowsCount > SPHERICAL_HARMONICS_PREFILTER_BATCH_SIZE)
+			{
+				ER_JobCounter counter;
+				aJobSystem->ParallelFor(rowsCount, SPHERICAL_HARMONICS_PREFILTER_BATCH_SIZE, filterRow, &counter);
+				aJobSystem->Wait(counter);
+			}
+			else
+			{
+				for (UINT row = 0; row < rowsCount; row++)
+					filterRow(row);
+			}
+		}
+	}
+
+	bool ER_SphericalHarmonics::RunTests(ER_JobSystem* aJobSystem)
+	{
+		bool isPassed = true;
+		std::mt19937 generator(0x45525348); // "ERSH"
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		auto randomDirection = [&]()
+		{
+			XMFLOAT3 direction;
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(distribution(generator), distribution(generator), distribution(generator) + 0.01f, 0.0f)));
+			return direction;
+		};
+
+		// basis: same as DirectXSH
+		for (int i = 0; i < 100; i++)
+		{
+			const XMFLOAT3 direction = randomDirection();
+			float basis[SPHERICAL_HARMONICS_MAX_COEF_COUNT], referenceBasis[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+			EvaluateBasis(direction, SPHERICAL_HARMONICS_MAX_ORDER, basis);
+			XMSHEvalDirection(referenceBasis, SPHERICAL_HARMONICS_MAX_ORDER, XMLoadFloat3(&direction));
+			for (int j = 0; j < SPHERICAL_HARMONICS_MAX_COEF_COUNT; j++)
+				isPassed &= fabs(basis[j] - referenceBasis[j]) < 1e-5f;
+		}
+
+		// projection: environment made of SH gives the same coefficients back (the basis is orthonormal), constant environment has only the first one
+		XMFLOAT3 coefficients[SPHERICAL_HARMONICS_MAX_COEF_COUNT], result[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+		float projectionError = 0.0f;
+		{
+			for (int i = 0; i < SPHERICAL_HARMONICS_MAX_COEF_COUNT; i++)
+				coefficients[i] = XMFLOAT3(distribution(generator), distribution(generator), distribution(generator));
+
+			ER_CPUCubemap cubemap;
+			cubemap.Initialize(64);
+			FillCubemap(cubemap, [&](const XMFLOAT3& aDirection) { return Evaluate(coefficients, SPHERICAL_HARMONICS_MAX_ORDER, aDirection); });
+			ProjectCubemap(cubemap, SPHERICAL_HARMONICS_MAX_ORDER, result);
+			for (int i = 0; i < SPHERICAL_HARMONICS_MAX_COEF_COUNT; i++)
+				projectionError = std::max(projectionError, GetMaxError(result[i], coefficients[i]));
+			isPassed &= projectionError < 2e-3f;
+
+			FillCubemap(cubemap, [](const XMFLOAT3&) { return XMFLOAT3(1.0f, 0.5f, 0.25f); });
+			ProjectCubemap(cubemap, SPHERICAL_HARMONICS_MAX_ORDER, result);
+			const float c0 = 4.0f * XM_PI * 0.282094792f;
+			isPassed &= GetMaxError(result[0], XMFLOAT3(c0, 0.5f * c0, 0.25f * c0)) < 1e-3f;
+			for (int i = 1; i < SPHERICAL_HARMONICS_MAX_COEF_COUNT; i++)
+				isPassed &= GetMaxError(result[i], XMFLOAT3(0.0f, 0.0f, 0.0f)) < 1e-4f;
+		}
+
+		// irradiance: sky hemisphere (radiance 1 for z > 0) gives E(n) = pi * (1 + n.z) / 2, which has no bands above 1, so order 3 is exact
+		float irradianceError = 0.0f;
+		{
+			ER_CPUCubemap cubemap;
+			cubemap.Initialize(64);
+			FillCubemap(cubemap, [](const XMFLOAT3& aDirection) { return (aDirection.z > 0.0f) ? XMFLOAT3(1.0f, 1.0f, 1.0f) : XMFLOAT3(0.0f, 0.0f, 0.0f); });
+			ProjectCubemap(cubemap, SPHERICAL_HARMONICS_MAX_ORDER, coefficients);
+			ConvolveIrradiance(coefficients, SPHERICAL_HARMONICS_MAX_ORDER, result);
+			for (int i = 0; i < 100; i++)
+			{
+				const XMFLOAT3 normal = randomDirection();
+				const float expected = XM_PI * (1.0f + normal.z) * 0.5f;
+				irradianceError = std::max(irradianceError, GetMaxError(Evaluate(result, SPHERICAL_HARMONICS_MAX_ORDER, normal), XMFLOAT3(expected, expected, expected)) / XM_PI);
+			}
+			isPassed &= irradianceError < 5e-3f;
+		}
+
+		// rotation
+		{
+			for (int i = 0; i < SPHERICAL_HARMONICS_MAX_COEF_COUNT; i++)
+				coefficients[i] = XMFLOAT3(distribution(generator), distribution(generator), distribution(generator));
+			const XMMATRIX rotation = XMMatrixRotationRollPitchYaw(0.3f, -1.2f, 2.1f);
+			Rotate(coefficients, SPHERICAL_HARMONICS_MAX_ORDER, rotation, result);
+			for (int i = 0; i < 100; i++)
+			{
+				const XMFLOAT3 direction = randomDirection();
+				XMFLOAT3 rotatedDirection;
+				XMStoreFloat3(&rotatedDirection, XMVector3TransformNormal(XMLoadFloat3(&direction), rotation));
+				isPassed &= GetMaxError(Evaluate(result, SPHERICAL_HARMONICS_MAX_ORDER, rotatedDirection), Evaluate(coefficients, SPHERICAL_HARMONICS_MAX_ORDER, direction)) < 1e-4f;
+			}
+		}
+
+		// GGX prefilter: constant environment stays constant, filtered importance sampling with few samples is close to the brute force (as on the GPU: 1 source mip, many samples)
+		float prefilterError = 0.0f;
+		{
+			const UINT size = 32, mipsCount = 6;
+			ER_CPUCubemap source, prefiltered;
+			source.Initialize(size, mipsCount);
+			prefiltered.Initialize(size, mipsCount);
+			FillCubemap(source, [](const XMFLOAT3&) { return XMFLOAT3(0.5f, 1.0f, 2.0f); });
+			PrefilterGGX(source, prefiltered, 64, aJobSystem);
+			for (UINT mip = 0; mip < mipsCount; mip++)
+				for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+					for (UINT i = 0; i < prefiltered.GetSize(mip) * prefiltered.GetSize(mip); i++)
+						isPassed &= GetMaxError(XMFLOAT3(prefiltered.GetFace(face, mip)[i].x, prefiltered.GetFace(face, mip)[i].y, prefiltered.GetFace(face, mip)[i].z), XMFLOAT3(0.5f, 1.0f, 2.0f)) < 1e-3f;
+
+			auto environment = [](const XMFLOAT3& aDirection) { return XMFLOAT3(1.0f + 0.5f * aDirection.x, 1.0f + 0.5f * aDirection.y * aDirection.y, 1.0f + 0.5f * std::max(aDirection.z, 0.0f)); };
+			FillCubemap(source, environment);
+			ER_CPUCubemap sourceWithoutMips, reference;
+			sourceWithoutMips.Initialize(size);
+			FillCubemap(sourceWithoutMips, environment);
+			reference.Initialize(size, mipsCount);
+			PrefilterGGX(source, prefiltered, 64, aJobSystem);
+			PrefilterGGX(sourceWithoutMips, reference, 2048, aJobSystem);
+			for (UINT mip = 0; mip < mipsCount; mip++)
+			{
+				for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+				{
+					for (UINT i = 0; i < prefiltered.GetSize(mip) * prefiltered.GetSize(mip); i++)
+					{
+						const XMFLOAT4& value = prefiltered.GetFace(face, mip)[i];
+						const XMFLOAT4& expected = reference.GetFace(face, mip)[i];
+						prefilterError = std::max(prefilterError, GetMaxError(XMFLOAT3(value.x, value.y, value.z), XMFLOAT3(expected.x, expected.y, expected.z)));
+					}
+				}
+			}
+			isPassed &= prefilterError < 0.06f; // worst on the last mips where the lobe covers whole faces
+
+			// same result on the job system
+			ER_CPUCubemap serialPrefiltered;
+			serialPrefiltered.Initialize(size, mipsCount);
+			PrefilterGGX(source, serialPrefiltered, 64, nullptr);
+			for (UINT mip = 0; mip < mipsCount; mip++)
+				for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+					isPassed &= memcmp(serialPrefiltered.GetFace(face, mip), prefiltered.GetFace(face, mip), sizeof(XMFLOAT4) * prefiltered.GetSize(mip) * prefiltered.GetSize(mip)) == 0;
+		}
+
+		// projection of many cubemaps: same result with and without the job system
+		{
+			const UINT probesCount = 16;
+			std::vector<ER_CPUCubemap> cubemaps(probesCount);
+			std::vector<const ER_CPUCubemap*> cubemapsPointers(probesCount);
+			for (UINT i = 0; i < probesCount; i++)
+			{
+				const float tint = 0.5f + 0.5f * distribution(generator);
+				cubemaps[i].Initialize(16);
+				FillCubemap(cubemaps[i], [tint](const XMFLOAT3& aDirection) { return XMFLOAT3(tint * (1.0f + aDirection.x), tint * aDirection.y * aDirection.z, tint); });
+				cubemapsPointers[i] = &cubemaps[i];
+			}
+
+			std::vector<XMFLOAT3> serialResults(probesCount * SPHERICAL_HARMONICS_MAX_COEF_COUNT), parallelResults(serialResults.size());
+			ProjectCubemaps(cubemapsPointers.data(), probesCount, SPHERICAL_HARMONICS_MAX_ORDER, serialResults.data(), nullptr);
+			ProjectCubemaps(cubemapsPointers.data(), probesCount, SPHERICAL_HARMONICS_MAX_ORDER, parallelResults.data(), aJobSystem);
+			isPassed &= memcmp(serialResults.data(), parallelResults.data(), sizeof(XMFLOAT3) * serialResults.size()) == 0;
+			for (UINT i = 0; i < probesCount; i++)
+			{
+				ProjectCubemap(cubemaps[i], SPHERICAL_HARMONICS_MAX_ORDER, result);
+				for (int j = 0; j < SPHERICAL_HARMONICS_MAX_COEF_COUNT; j++)
+					isPassed &= GetMaxError(result[j], serialResults[i * SPHERICAL_HARMONICS_MAX_COEF_COUNT + j]) < 1e-3f;
+			}
+		}
+
+		std::wstring msg = L"[ER Logger][ER_SphericalHarmonics] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") +
+			L". Max errors: projection " + std::to_wstring(projectionError) + L", irradiance " + std::to_wstring(irradianceError) + L" (relative), GGX prefilter " + std::to_wstring(prefilterError) + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_SphericalHarmonics::Benchmark(ER_JobSystem* aJobSystem)
+	{
+		std::mt19937 generator(0x45525348); // "ERSH"
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		bool isMatching = true;
+
+		const UINT probesCount = 256, probeSize = 32;
+		double scalarTime = 0.0, serialTime = 0.0, parallelTime = 0.0;
+		{
+			std::vector<ER_CPUCubemap> cubemaps(probesCount);
+			std::vector<const ER_CPUCubemap*> cubemapsPointers(probesCount);
+			for (UINT i = 0; i < probesCount; i++)
+			{
+				const XMFLOAT3 tint(0.5f + 0.5f * distribution(generator), 0.5f + 0.5f * distribution(generator), 0.5f + 0.5f * distribution(generator));
+				cubemaps[i].Initialize(probeSize);
+				FillCubemap(cubemaps[i], [&](const XMFLOAT3& aDirection) { return XMFLOAT3(tint.x * (1.0f + aDirection.x), tint.y * (1.0f + aDirection.y * aDirection.z), tint.z); });
+				cubemapsPointers[i] = &cubemaps[i];
+			}
+
+			std::vector<XMFLOAT3> scalarResults(probesCount * SPHERICAL_HARMONICS_MAX_COEF_COUNT), serialResults(scalarResults.size()), parallelResults(scalarResults.size());
+			auto startTimer = std::chrono::high_resolution_clock::now();
+			for (UINT probe = 0; probe < probesCount; probe++)
+			{
+				double sums[SPHERICAL_HARMONICS_MAX_COEF_COUNT][3] = {};
+				for (UINT face = 0; face < CPU_CUBEMAP_FACES_COUNT; face++)
+				{
+					const XMFLOAT4* texels = cubemaps[probe].GetFace(face);
+					for (UINT y = 0; y < probeSize; y++)
+					{
+						for (UINT x = 0; x < probeSize; x++)
+						{
+							XMFLOAT3 direction = ER_CPUCubemap::GetDirection(face, (x + 0.5f) / probeSize, (y + 0.5f) / probeSize);
+							XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+							float basis[SPHERICAL_HARMONICS_MAX_COEF_COUNT];
+							EvaluateBasis(direction, SPHERICAL_HARMONICS_MAX_ORDER, basis);
+							const float solidAngle = GetTexelSolidAngle(x, y, probeSize);
+							const XMFLOAT4& color = texels[y * probeSize + x];
+							for (int i = 0; i < SPHERICAL_HARMONICS_MAX_COEF_COUNT; i++)
+							{
+								sums[i][0] += basis[i] * solidAngle * color.x;
+								sums[i][1] += basis[i] * solidAngle * color.y;
+								sums[i][2] += basis[i] * solidAngle * color.z;
+							}
+						}
+					}
+				}
+				for (int i = 0; i < SPHERICAL_HARMONICS_MAX_COEF_COUNT; i++)
+					scalarResults[probe * SPHERICAL_HARMONICS_MAX_COEF_COUNT + i] = XMFLOAT3(static_cast<float>(sums[i][0]), static_cast<float>(sums[i][1]), static_cast<float>(sums[i][2]));
+			}
+			std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - startTimer;
+			scalarTime = time.count();
+
+			startTimer = std::chrono::high_resolution_clock::now();
+			ProjectCubemaps(cubemapsPointers.data(), probesCount, SPHERICAL_HARMONICS_MAX_ORDER, serialResults.data(), nullptr);
+			time = std::chrono::high_resolution_clock::now() - startTimer;
+			serialTime = time.count();
+
+			startTimer = std::chrono::high_resolution_clock::now();
+			ProjectCubemaps(cubemapsPointers.data(), probesCount, SPHERICAL_HARMONICS_MAX_ORDER, parallelResults.data(), aJobSystem);
+			time = std::chrono::high_resolution_clock::now() - startTimer;
+			parallelTime = time.count();
+
+			isMatching &= memcmp(serialResults.data(), parallelResults.data(), sizeof(XMFLOAT3) * serialResults.size()) == 0;
+			for (size_t i = 0; i < scalarResults.size(); i++)
+				isMatching &= GetMaxError(scalarResults[i], serialResults[i]) < 1e-4f;
+		}
+
+		std::wstring msg = L"[ER Logger][ER_SphericalHarmonics] Benchmark" + std::wstring(isMatching ? L"" : L" (MISMATCH!)") +
+			L", projection of " + std::to_wstring(probesCount) + L" cubemaps (" + std::to_wstring(probeSize) + L"x" + std::to_wstring(probeSize) + L"): per texel " + std::to_wstring(scalarTime * 1000.0) +
+			L"ms, 4 texels at a time " + std::to_wstring(serialTime * 1000.0) + L"ms (1 thread), " + std::to_wstring(parallelTime * 1000.0) + L"ms (job system)\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isMatching);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "Common.h"
+
+#define SPHERICAL_HARMONICS_MAX_ORDER 3 // number of bands as in DirectXSH (3 - 9 coefficients, same as the light probes)
+#define SPHERICAL_HARMONICS_MAX_COEF_COUNT (SPHERICAL_HARMONICS_MAX_ORDER * SPHERICAL_HARMONICS_MAX_ORDER)
+
+#define CPU_CUBEMAP_FACES_COUNT 6
+
+namespace EveryRay_Core
+{
+	class ER_JobSystem;
+
+	// RGBA32F cubemap in CPU memory. Faces go in D3D order (+X, -X, +Y, -Y, +Z, -Z), every face has its mip chain (mip 0 first) and rows go from top to bottom,
+	// i.e. the same layout as the subresources of a cubemap texture, so the data can be uploaded/read back as is.
+	class ER_CPUCubemap
+	{
+	public:
+		void Initialize(UINT aSize, UINT aMipsCount = 1);
+		// 2x2 box filter from mip 0 down to the last mip
+		void GenerateMips();
+
+		UINT GetSize(UINT aMip = 0) const { return std::max(mSize >> aMip, 1u); }
+		UINT GetMipsCount() const { return mMipsCount; }
+		XMFLOAT4* GetFace(UINT aFace, UINT aMip = 0) { return &mTexels[aFace * mFaceTexelsCount + mMipsOffsets[aMip]]; }
+		const XMFLOAT4* GetFace(UINT aFace, UINT aMip = 0) const { return &mTexels[aFace * mFaceTexelsCount + mMipsOffsets[aMip]]; }
+
+		// Bilinear inside a face (clamped at the edges), linear between mips
+		XMFLOAT3 Sample(const XMFLOAT3& aDirection, float aMip = 0.0f) const;
+
+		// Direction through the point of a face, aU and aV in [0, 1] (same as GetNormal() in ProbeConvolution.hlsl); not normalized
+		static XMFLOAT3 GetDirection(UINT aFace, float aU, float aV);
+	private:
+		XMFLOAT3 SampleMip(UINT aFace, float aU, float aV, UINT aMip) const;
+
+		UINT mSize = 0;
+		UINT mMipsCount = 0;
+		UINT mFaceTexelsCount = 0; // all mips
+		std::vector<UINT> mMipsOffsets;
+		std::vector<XMFLOAT4> mTexels;
+	};
+
+	// CPU spherical harmonics for probe baking without a graphics API (i.e., on worker threads or in tests).
+	// Real SH in the DirectXSH convention (order of the basis functions and their signs as in XMSHEvalDirection() and SHProjectCubeMap()),
+	// so the coefficients can go to Lighting.hlsli as is. "Order" is the number of bands: 1..SPHERICAL_HARMONICS_MAX_ORDER.
+	class ER_SphericalHarmonics
+	{
+	public:
+		static void EvaluateBasis(const XMFLOAT3& aDirection, UINT aOrder, float* aOutBasis);
+		static XMFLOAT3 Evaluate(const XMFLOAT3* aCoefficients, UINT aOrder, const XMFLOAT3& aDirection);
+
+		// Projection of one mip of a cubemap, every texel is weighted by its exact solid angle. 4 texels at a time (DirectXMath vectors).
+		static void ProjectCubemap(const ER_CPUCubemap& aCubemap, UINT aOrder, XMFLOAT3* aOutCoefficients, UINT aMip = 0);
+		// Many cubemaps (probes) on the job system; aOrder^2 coefficients per cubemap in aOutCoefficients
+		static void ProjectCubemaps(const ER_CPUCubemap* const* aCubemaps, UINT aCubemapsCount, UINT aOrder, XMFLOAT3* aOutCoefficients, ER_JobSystem* aJobSystem = nullptr);
+
+		// The rotated function at XMVector3TransformNormal(dir, aRotation) is the original one at dir (XMSHRotate() per channel)
+		static void Rotate(const XMFLOAT3* aCoefficients, UINT aOrder, FXMMATRIX aRotation, XMFLOAT3* aOutCoefficients);
+		// Radiance -> irradiance (convolution with the clamped cosine lobe: band l is scaled by A0 = pi, A1 = 2pi/3, A2 = pi/4)
+		static void ConvolveIrradiance(const XMFLOAT3* aCoefficients, UINT aOrder, XMFLOAT3* aOutCoefficients);
+
+		// Fills all mips of aOutCubemap (already initialized) like ProbeConvolution.hlsl does for specular probes (GGX lobe with N = V = R, roughness = mip / mips count), but with filtered importance sampling:
+		// samples are read from the source mip that matches their solid angle, so call GenerateMips() on the source to get less noise with fewer samples.
+		static void PrefilterGGX(const ER_CPUCubemap& aSource, ER_CPUCubemap& aOutCubemap, UINT aSamplesCount, ER_JobSystem* aJobSystem = nullptr);
+
+		// Analytic environments, rotation and GGX prefilter (see ER_Tests)
+		static bool RunTests(ER_JobSystem* aJobSystem);
+		// Projection of many diffuse-probe-sized cubemaps: per texel (scalar) vs. 4 texels at a time vs. job system
+		static void Benchmark(ER_JobSystem* aJobSystem);
+	};
+}
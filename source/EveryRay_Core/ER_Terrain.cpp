@@ -17,6 +17,11 @@
 #include "ER_RenderableAABB.h"
 #include "ER_Camera.h"
 #include "ER_GBuffer.h"
+#include "ER_JobSystem.h"
+#include "ER_Frustum.h"
+#include "ER_FrustumCulling.h"
+
+#include <psapi.h>
 
 #define USE_RAYCASTING_FOR_ON_TERRAIN_PLACEMENT 0
 
@@ -43,7 +48,7 @@ namespace EveryRay_Core
 			ER_RHI_INPUT_ELEMENT_DESC inputElementDescriptions[] =
 			{
 				{ "PATCH_INFO", 0, ER_FORMAT_R32G32B32A32_FLOAT, 0, 0, true, 0 },
-				{ "TILE_INDEX", 0, ER_FORMAT_R32_FLOAT, 0, 0xffffffff, true, 0 } //too much for tile index, but whatever for now...
+				{ "TILE_INFO", 0, ER_FORMAT_R32G32B32A32_FLOAT, 0, 0xffffffff, true, 0 }
 			};
 			mInputLayout = rhi->CreateInputLayout(inputElementDescriptions, ARRAYSIZE(inputElementDescriptions));
 
@@ -101,6 +106,17 @@ namespace EveryRay_Core
 				mTerrainPlacementPassRS->Finalize(rhi, "ER_RHI_GPURootSignature: Terrain Placement Pass");
 			}
 		}
+
+		// PSO handles
+		{
+			mTerrainMainPassPSO = rhi->GetPSOHandle(mTerrainMainPassPSOName);
+			mTerrainMainPassWireframePSO = rhi->GetPSOHandle(mTerrainMainPassWireframePSOName);
+			mTerrainLightProbePassPSO = rhi->GetPSOHandle(mTerrainLightProbePassPSOName);
+			mTerrainShadowPassPSO = rhi->GetPSOHandle(mTerrainShadowPassPSOName);
+			mTerrainGBufferPassPSO = rhi->GetPSOHandle(mTerrainGBufferPassPSOName);
+			mTerrainGBufferPassWireframePSO = rhi->GetPSOHandle(mTerrainGBufferPassWireframePSOName);
+			mTerrainPlacementPassPSO = rhi->GetPSOHandle(mTerrainPlacementPassPSOName, true);
+		}
 		mTerrainConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Terrain CB");
 		mPlaceOnTerrainGlobalConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Place On Terrain Global CB");
 		mPlaceOnTerrainPropConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Place On Terrain Prop CB");
@@ -125,6 +141,8 @@ namespace EveryRay_Core
 		DeleteObject(mPlaceOnTerrainCS);
 		DeleteObject(mInputLayout);
 		DeleteObject(mTerrainTilesDataGPU);
+		DeleteObject(mTerrainTilesIndexBufferNonTS);
+		DeleteObject(mPatchesBufferTS);
 		DeleteObject(mTerrainTilesHeightmapsArrayTexture);
 		DeleteObject(mTerrainTilesSplatmapsArrayTexture);
 		DeleteObject(mTerrainCommonPassRS);
@@ -167,8 +185,8 @@ namespace EveryRay_Core
 		mTerrainNonTessellatedHeightScale = aScene->GetValueFromSceneRoot<float>("terrain_non_tessellated_height_scale");
 
 		mTileResolution = aScene->GetValueFromSceneRoot<int>("terrain_tile_resolution");
-		if (mTileResolution == 0)
-			throw ER_CoreException("Tile resolution (= heightmap texture tile resolution) of the terrain is 0!");
+		if (mTileResolution < 2)
+			throw ER_CoreException("Tile resolution (= heightmap texture tile resolution) of the terrain is less than 2!");
 		mWidth = mHeight = mTileResolution;
 
 		std::wstring terrainSplatLayersTextureNames[NUM_TEXTURE_SPLAT_CHANNELS];
@@ -199,9 +217,47 @@ namespace EveryRay_Core
 			path + terrainSplatLayersTextureNames[3]
 		); //not thread-safe
 
-		for (int i = 0; i < mNumTiles; i++)
+		// CPU data of the tiles (memory-mapped heightmaps, AABBs) is loaded in parallel, GPU resources are created afterwards on this thread
 		{
-			LoadTile(i, path); //not thread-safe
+			PROCESS_MEMORY_COUNTERS memoryCountersBefore = {};
+			GetProcessMemoryInfo(GetCurrentProcess(), &memoryCountersBefore, sizeof(memoryCountersBefore));
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			std::vector<char> isTileLoaded(mNumTiles, 0);
+			ER_JobCounter counter;
+			GetCore()->GetJobSystem()->ParallelFor(mNumTiles, 1, [this, &path, &isTileLoaded](UINT aTileIndex)
+			{
+				isTileLoaded[aTileIndex] = LoadTile(aTileIndex, path);
+			}, &counter);
+			GetCore()->GetJobSystem()->Wait(counter);
+
+			for (int i = 0; i < mNumTiles; i++)
+			{
+				if (!isTileLoaded[i])
+					throw ER_CoreException("Can not load the terrain's heightmap RAW file!");
+			}
+			const double cpuLoadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+			CreateTerrainTilesIndexBufferNonTS();
+			int numTilesSqrt = sqrt(mNumTiles);
+			for (int i = 0; i < mNumTiles; i++)
+				CreateTerrainTileDataGPU(i / numTilesSqrt, i % numTilesSqrt); //not thread-safe
+
+			// enough for the full draw lists of the main camera and all shadow cascades in one frame
+			mPatchesBufferCapacity = mNumTiles * NUM_TERRAIN_PATCHES_PER_TILE * NUM_TERRAIN_PATCHES_PER_TILE * (1 + NUM_SHADOW_CASCADES);
+			std::vector<TerrainPatchGPU> patches(mPatchesBufferCapacity);
+			mPatchesBufferTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Patches (TS) - Vertex Buffer");
+			mPatchesBufferTS->CreateGPUBufferResource(rhi, patches.data(), mPatchesBufferCapacity, sizeof(TerrainPatchGPU), true, ER_BIND_VERTEX_BUFFER);
+
+			const double loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+			PROCESS_MEMORY_COUNTERS memoryCountersAfter = {};
+			GetProcessMemoryInfo(GetCurrentProcess(), &memoryCountersAfter, sizeof(memoryCountersAfter));
+
+			std::wstring msg = L"[ER Logger][ER_Terrain] Loaded " + std::to_wstring(mNumTiles) + L" tiles (" + std::to_wstring(mWidth) + L"x" + std::to_wstring(mHeight) +
+				L") in " + std::to_wstring(loadTimeMs) + L" ms (CPU data in jobs: " + std::to_wstring(cpuLoadTimeMs) + L" ms), RSS: " +
+				std::to_wstring(memoryCountersBefore.WorkingSetSize / (1024 * 1024)) + L" MB -> " + std::to_wstring(memoryCountersAfter.WorkingSetSize / (1024 * 1024)) +
+				L" MB, mapped heightmaps: " + std::to_wstring(static_cast<UINT64>(mNumTiles) * mWidth * mHeight * sizeof(unsigned short) / (1024 * 1024)) + L" MB\n";
+			ER_OUTPUT_LOG(msg.c_str());
 		}
 
 		int tileSize = mTileScale * mTileResolution;
@@ -228,6 +284,7 @@ namespace EveryRay_Core
 			rhi->CopyGPUTextureSubresourceRegion(mTerrainTilesHeightmapsArrayTexture, tileIndex, 0, 0, 0, mHeightMaps[tileIndex]->mHeightTexture, 0);
 			rhi->CopyGPUTextureSubresourceRegion(mTerrainTilesSplatmapsArrayTexture, tileIndex, 0, 0, 0, mHeightMaps[tileIndex]->mSplatTexture, 0);
 		}
+
 	}
 
 	void ER_Terrain::LoadTextures(const std::wstring& aTexturesPath, const std::wstring& splatLayer0Path, const std::wstring& splatLayer1Path, const std::wstring& splatLayer2Path, const std::wstring& splatLayer3Path)
@@ -299,6 +356,7 @@ namespace EveryRay_Core
 				std::wstring filePathSplatmap = aTexturesPath;
 				filePathSplatmap += L"terrainSplat_x" + std::to_wstring(i) + L"_y" + std::to_wstring(j) + L".png";
 				LoadSplatmapPerTileGPU(i, j, filePathSplatmap); //unfortunately, not thread safe
+				LoadSplatmapPerTileCPU(i, j, filePathSplatmap);
 
 				std::wstring filePathHeightmap = aTexturesPath;
 				filePathHeightmap += L"terrainHeight_x" + std::to_wstring(i) + L"_y" + std::to_wstring(j) + L".png";
@@ -307,19 +365,17 @@ namespace EveryRay_Core
 		}
 	}
 	
-	void ER_Terrain::LoadTile(int threadIndex, const std::wstring& aTexturesPath)
+	bool ER_Terrain::LoadTile(int tileIndex, const std::wstring& aTexturesPath)
 	{
 		int numTilesSqrt = sqrt(mNumTiles);
 
-		int tileX = threadIndex / numTilesSqrt;
-		int tileY = threadIndex - numTilesSqrt * tileX;
+		int tileX = tileIndex / numTilesSqrt;
+		int tileY = tileIndex - numTilesSqrt * tileX;
 
-		int index = tileX * numTilesSqrt + tileY;
 		std::wstring filePathHeightmap = aTexturesPath;
 		filePathHeightmap += L"terrainHeight_x" + std::to_wstring(tileX) + L"_y" + std::to_wstring(tileY) + L".r16";
 
-		CreateTerrainTileDataCPU(tileX, tileY, filePathHeightmap);
-		CreateTerrainTileDataGPU(tileX, tileY);
+		return CreateTerrainTileDataCPU(tileX, tileY, filePathHeightmap);
 	}
 
 	void ER_Terrain::LoadSplatmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path)
@@ -343,6 +399,38 @@ namespace EveryRay_Core
 
 	}
 
+	// RGBA8 copy of the splatmap for CPU placement (only channels' thresholds are checked, so 8 bits are enough)
+	void ER_Terrain::LoadSplatmapPerTileCPU(int tileIndexX, int tileIndexY, const std::wstring& path)
+	{
+		int tileIndex = tileIndexX * sqrt(mNumTiles) + tileIndexY;
+		if (tileIndex >= mHeightMaps.size())
+			return;
+
+		DirectX::ScratchImage image;
+		DirectX::ScratchImage convertedImage;
+		if (FAILED(DirectX::LoadFromWICFile(path.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image)))
+		{
+			std::wstring msg = L"[ER Logger][ER_Terrain] Could not load a splatmap on CPU (CPU placement will ignore splat channels): " + path + L'\n';
+			ER_OUTPUT_LOG(msg.c_str());
+			return;
+		}
+
+		const DirectX::Image* splatImage = image.GetImage(0, 0, 0);
+		if (splatImage->format != DXGI_FORMAT_R8G8B8A8_UNORM)
+		{
+			if (FAILED(DirectX::Convert(*splatImage, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, convertedImage)))
+				return;
+			splatImage = convertedImage.GetImage(0, 0, 0);
+		}
+
+		HeightMap* heightMap = mHeightMaps[tileIndex];
+		heightMap->mSplatWidth = static_cast<int>(splatImage->width);
+		heightMap->mSplatHeight = static_cast<int>(splatImage->height);
+		heightMap->mRawSplat.resize(splatImage->width * splatImage->height * 4);
+		for (size_t row = 0; row < splatImage->height; row++)
+			memcpy(&heightMap->mRawSplat[row * splatImage->width * 4], splatImage->pixels + row * splatImage->rowPitch, splatImage->width * 4);
+	}
+
 	void ER_Terrain::LoadHeightmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path)
 	{
 		ER_RHI* rhi = GetCore()->GetRHI();
@@ -365,188 +453,166 @@ namespace EveryRay_Core
 
 		int terrainTileSize = mTileResolution * mTileScale;
 
-		const int numOfFloats = 5;
+		mHeightMaps[tileIndex]->mWorldMatrixTS = XMMatrixTranslation(terrainTileSize * (tileIndexX - 1), 0.0f, terrainTileSize * -tileIndexY);
+		mHeightMaps[tileIndex]->mTileUVOffset = XMFLOAT2(terrainTileSize - tileIndexX * terrainTileSize, tileIndexY * terrainTileSize);
 
-		// creating terrain vertex buffer for patches
-		float* patches_rawdata = new float[NUM_TERRAIN_PATCHES_PER_TILE * NUM_TERRAIN_PATCHES_PER_TILE * numOfFloats];
-		for (int i = 0; i < NUM_TERRAIN_PATCHES_PER_TILE; i++)
+		// non-tessellated vertex buffer (CPU terrain)
 		{
-			for (int j = 0; j < NUM_TERRAIN_PATCHES_PER_TILE; j++)
+			mHeightMaps[tileIndex]->mVertexCountNonTS = mWidth * mHeight;
+			DebugTerrainVertexInput* vertices = new DebugTerrainVertexInput[mHeightMaps[tileIndex]->mVertexCountNonTS];
+			for (int j = 0; j < static_cast<int>(mHeight); j++)
 			{
-				patches_rawdata[(i + j * NUM_TERRAIN_PATCHES_PER_TILE) * numOfFloats + 0] = i * terrainTileSize / NUM_TERRAIN_PATCHES_PER_TILE;
-				patches_rawdata[(i + j * NUM_TERRAIN_PATCHES_PER_TILE) * numOfFloats + 1] = j * terrainTileSize / NUM_TERRAIN_PATCHES_PER_TILE;
-				patches_rawdata[(i + j * NUM_TERRAIN_PATCHES_PER_TILE) * numOfFloats + 2] = terrainTileSize / NUM_TERRAIN_PATCHES_PER_TILE;
-				patches_rawdata[(i + j * NUM_TERRAIN_PATCHES_PER_TILE) * numOfFloats + 3] = terrainTileSize / NUM_TERRAIN_PATCHES_PER_TILE;
-
-				patches_rawdata[(i + j * NUM_TERRAIN_PATCHES_PER_TILE) * numOfFloats + 4] = static_cast<float>(tileIndex);
+				for (int i = 0; i < static_cast<int>(mWidth); i++)
+				{
+					const XMFLOAT3 position = mHeightMaps[tileIndex]->GetVertexPosition(i, j);
+					vertices[mWidth * j + i].Position = XMFLOAT4(position.x, position.y, position.z, 1.0f);
+				}
 			}
-		}
-
-		mHeightMaps[tileIndex]->mVertexBufferTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (TS) - Vertex Buffer, tile index: " + std::to_string(tileIndex));
-		mHeightMaps[tileIndex]->mVertexBufferTS->CreateGPUBufferResource(rhi, patches_rawdata, NUM_TERRAIN_PATCHES_PER_TILE * NUM_TERRAIN_PATCHES_PER_TILE, numOfFloats * sizeof(float), false, ER_BIND_VERTEX_BUFFER);
 
-		DeleteObjects(patches_rawdata);
+			mHeightMaps[tileIndex]->mVertexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Vertex Buffer, tile index: " + std::to_string(tileIndex));
+			mHeightMaps[tileIndex]->mVertexBufferNonTS->CreateGPUBufferResource(rhi, vertices, mHeightMaps[tileIndex]->mVertexCountNonTS, sizeof(DebugTerrainVertexInput), false, ER_BIND_VERTEX_BUFFER);
+			DeleteObjects(vertices);
+		}
 
-		mHeightMaps[tileIndex]->mWorldMatrixTS = XMMatrixTranslation(terrainTileSize * (tileIndexX - 1), 0.0f, terrainTileSize * -tileIndexY);
-		mHeightMaps[tileIndex]->mTileUVOffset = XMFLOAT2(terrainTileSize - tileIndexX * terrainTileSize, tileIndexY * terrainTileSize);
+		mHeightMaps[tileIndex]->mDebugGizmoAABB = new ER_RenderableAABB(*GetCore(), XMFLOAT4(0.0, 0.0, 1.0, 1.0));
+		mHeightMaps[tileIndex]->mDebugGizmoAABB->InitializeGeometry({ mHeightMaps[tileIndex]->mAABB.first, mHeightMaps[tileIndex]->mAABB.second });
 	}
 
-	// Create CPU tile data which is used for terrain debugging, collisions, placement of ER_RenderingObject(s) (no GPU tessellation pipeline)
-	void ER_Terrain::CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath)
+	// Create CPU tile data which is used for terrain debugging, collisions, placement of ER_RenderingObject(s) (no GPU tessellation pipeline).
+	// Only the 16-bit RAW heightmap is kept (memory-mapped), vertex positions are computed from it on demand. Thread-safe (no RHI calls).
+	bool ER_Terrain::CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath)
 	{
 		int tileIndex = tileIndexX * sqrt(mNumTiles) + tileIndexY;
 		assert(tileIndex < mHeightMaps.size());
-		ER_RHI* rhi = GetCore()->GetRHI();
+		assert(mTerrainNonTessellatedHeightScale > std::numeric_limits<float>::epsilon());
 
-		int error, i, j, index;
-		FILE* filePtr;
-		unsigned long long imageSize, count;
-		unsigned short* rawImage;
+		HeightMap* heightMap = mHeightMaps[tileIndex];
+		if (!heightMap->MapRawHeights(aPath))
+			return false;
 
-		// Load raw heightmap file
+		int tileSize = mTileResolution * mTileScale;
+		heightMap->mCellSize = mTileScale;
+		heightMap->mHeightScaleCPU = mTerrainNonTessellatedHeightScale;
+		heightMap->mOrigin = XMFLOAT2(static_cast<float>(tileSize * (tileIndexX - 1)), static_cast<float>(-tileSize * tileIndexY));
+		if (tileIndex > 0) //a way to fix the seams between tiles...
 		{
-			// Open the 16 bit raw height map file for reading in binary.
-			error = _wfopen_s(&filePtr, aPath.c_str(), L"rb");
-			if (error != 0)
-				throw ER_CoreException("Can not open the terrain's heightmap RAW!");
-
-			// Calculate the size of the raw image data.
-			imageSize = mWidth * mHeight;
-
-			// Allocate memory for the raw image data.
-			rawImage = new unsigned short[imageSize];
-
-			// Read in the raw image data.
-			count = fread(rawImage, sizeof(unsigned short), imageSize, filePtr);
-			if (count != imageSize)
-				throw ER_CoreException("Can not read the terrain's heightmap RAW file!");
-
-			// Close the file.
-			error = fclose(filePtr);
-			if (error != 0)
-				throw ER_CoreException("Can not close the terrain's heightmap RAW file!");
+			heightMap->mOrigin.x -= static_cast<float>(tileIndexX) /** scale*/;
+			heightMap->mOrigin.y += static_cast<float>(tileIndexY) /** scale*/;
 		}
 
-		// Copy the image data into the height map array.
+		// calculate AABB of the tile
+		unsigned short minHeight = std::numeric_limits<unsigned short>::max();
+		unsigned short maxHeight = 0;
+		for (int i = 0; i < static_cast<int>(mWidth * mHeight); i++)
 		{
-			assert(mTerrainNonTessellatedHeightScale > std::numeric_limits<float>::epsilon());
+			minHeight = std::min(minHeight, heightMap->mRawHeights[i]);
+			maxHeight = std::max(maxHeight, heightMap->mRawHeights[i]);
+		}
+		const XMFLOAT3 lastVertex = heightMap->GetVertexPosition(mWidth - 1, mHeight - 1);
+		heightMap->mAABB = {
+			XMFLOAT3(heightMap->mOrigin.x, static_cast<float>(minHeight) / mTerrainNonTessellatedHeightScale, heightMap->mOrigin.y),
+			XMFLOAT3(lastVertex.x, static_cast<float>(maxHeight) / mTerrainNonTessellatedHeightScale, lastVertex.z)
+		};
+
+		BuildQuadTree(heightMap);
+		return true;
+	}
 
-			int tileSize = mTileResolution * mTileScale;
-			for (j = 0; j < static_cast<int>(mHeight); j++)
+	// Min/max heights of every quadtree node: leaves are computed from the heightmap texels (+1 texel border for bilinear filtering), parents from their children
+	void ER_Terrain::BuildQuadTree(HeightMap* aHeightMap)
+	{
+		int nodesCount = 0;
+		for (int level = 0; level <= TERRAIN_QUADTREE_MAX_LEVEL; level++)
+			nodesCount += (1 << level) * (1 << level);
+		aHeightMap->mQuadTreeMinHeights.resize(nodesCount);
+		aHeightMap->mQuadTreeMaxHeights.resize(nodesCount);
+
+		const int leavesPerSide = 1 << TERRAIN_QUADTREE_MAX_LEVEL;
+		int levelOffset = nodesCount - leavesPerSide * leavesPerSide;
+		for (int j = 0; j < leavesPerSide; j++)
+		{
+			for (int i = 0; i < leavesPerSide; i++)
 			{
-				for (i = 0; i < static_cast<int>(mWidth); i++)
+				const int minTexelX = std::max(i * aHeightMap->mWidth / leavesPerSide - 1, 0);
+				const int maxTexelX = std::min((i + 1) * aHeightMap->mWidth / leavesPerSide + 1, aHeightMap->mWidth - 1);
+				const int minTexelY = std::max(j * aHeightMap->mHeight / leavesPerSide - 1, 0);
+				const int maxTexelY = std::min((j + 1) * aHeightMap->mHeight / leavesPerSide + 1, aHeightMap->mHeight - 1);
+
+				unsigned short minHeight = std::numeric_limits<unsigned short>::max();
+				unsigned short maxHeight = 0;
+				for (int y = minTexelY; y <= maxTexelY; y++)
 				{
-					index = (mWidth * j) + i;
-
-					// Store the height at this point in the height map array.
-					mHeightMaps[tileIndex]->mData[index].x = static_cast<float>(i * mTileScale + tileSize * (tileIndexX - 1));
-					mHeightMaps[tileIndex]->mData[index].y = static_cast<float>(rawImage[index]) / mTerrainNonTessellatedHeightScale;
-					mHeightMaps[tileIndex]->mData[index].z = static_cast<float>(j * mTileScale - tileSize * tileIndexY);
-
-					if (tileIndex > 0) //a way to fix the seams between tiles...
+					for (int x = minTexelX; x <= maxTexelX; x++)
 					{
-						mHeightMaps[tileIndex]->mData[index].x -= static_cast<float>(tileIndexX) /** scale*/;
-						mHeightMaps[tileIndex]->mData[index].z += static_cast<float>(tileIndexY) /** scale*/;
+						minHeight = std::min(minHeight, aHeightMap->mRawHeights[aHeightMap->mWidth * y + x]);
+						maxHeight = std::max(maxHeight, aHeightMap->mRawHeights[aHeightMap->mWidth * y + x]);
 					}
-
 				}
+				aHeightMap->mQuadTreeMinHeights[levelOffset + j * leavesPerSide + i] = minHeight;
+				aHeightMap->mQuadTreeMaxHeights[levelOffset + j * leavesPerSide + i] = maxHeight;
 			}
-
-			// Release image data.
-			delete[] rawImage;
-			rawImage = 0;
 		}
 
-		// Generate CPU mesh (and its GPU vertex/index buffers) + calculate AABB of the tile
+		for (int level = TERRAIN_QUADTREE_MAX_LEVEL - 1; level >= 0; level--)
 		{
-			mHeightMaps[tileIndex]->mVertexCountNonTS = (mWidth - 1) * (mHeight - 1) * 6;
-			DebugTerrainVertexInput* vertices = new DebugTerrainVertexInput[mHeightMaps[tileIndex]->mVertexCountNonTS];
-
-			mHeightMaps[tileIndex]->mIndexCountNonTS = mHeightMaps[tileIndex]->mVertexCountNonTS;
-			unsigned long* indices = new unsigned long[mHeightMaps[tileIndex]->mIndexCountNonTS];
-
-			int index = 0;
-			int index1, index2, index3, index4;
-			// Load the vertex and index array with the terrain data.
-			for (int j = 0; j < ((int)mHeight - 1); j++)
+			const int nodesPerSide = 1 << level;
+			const int childLevelOffset = levelOffset;
+			levelOffset -= nodesPerSide * nodesPerSide;
+			for (int j = 0; j < nodesPerSide; j++)
 			{
-				for (int i = 0; i < ((int)mWidth - 1); i++)
+				for (int i = 0; i < nodesPerSide; i++)
 				{
-					index1 = (mHeight * j) + i;					// Bottom left.	
-					index2 = (mHeight * j) + (i + 1);			// Bottom right.
-					index3 = (mHeight * (j + 1)) + i;			// Upper left.	
-					index4 = (mHeight * (j + 1)) + (i + 1);		// Upper right.	
-
-					// Upper left.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index3].x, mHeightMaps[tileIndex]->mData[index3].y, mHeightMaps[tileIndex]->mData[index3].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Upper right.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index4].x, mHeightMaps[tileIndex]->mData[index4].y, mHeightMaps[tileIndex]->mData[index4].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Bottom left.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index1].x, mHeightMaps[tileIndex]->mData[index1].y, mHeightMaps[tileIndex]->mData[index1].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Bottom left.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index1].x, mHeightMaps[tileIndex]->mData[index1].y, mHeightMaps[tileIndex]->mData[index1].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Upper right.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index4].x, mHeightMaps[tileIndex]->mData[index4].y, mHeightMaps[tileIndex]->mData[index4].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Bottom right.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index2].x, mHeightMaps[tileIndex]->mData[index2].y, mHeightMaps[tileIndex]->mData[index2].z, 1.0f);
-					indices[index] = index;
-					index++;
+					unsigned short minHeight = std::numeric_limits<unsigned short>::max();
+					unsigned short maxHeight = 0;
+					for (int child = 0; child < 4; child++)
+					{
+						const int childIndex = childLevelOffset + (2 * j + child / 2) * (2 * nodesPerSide) + (2 * i + child % 2);
+						minHeight = std::min(minHeight, aHeightMap->mQuadTreeMinHeights[childIndex]);
+						maxHeight = std::max(maxHeight, aHeightMap->mQuadTreeMaxHeights[childIndex]);
+					}
+					aHeightMap->mQuadTreeMinHeights[levelOffset + j * nodesPerSide + i] = minHeight;
+					aHeightMap->mQuadTreeMaxHeights[levelOffset + j * nodesPerSide + i] = maxHeight;
 				}
 			}
+		}
+	}
 
-			mHeightMaps[tileIndex]->mVertexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Vertex Buffer, tile index: " + std::to_string(tileIndex));
-			mHeightMaps[tileIndex]->mVertexBufferNonTS->CreateGPUBufferResource(rhi, vertices, mHeightMaps[tileIndex]->mVertexCountNonTS, sizeof(DebugTerrainVertexInput), false, ER_BIND_VERTEX_BUFFER);
+	// Non-tessellated tiles are the same grid, so they share one index buffer
+	void ER_Terrain::CreateTerrainTilesIndexBufferNonTS()
+	{
+		ER_RHI* rhi = GetCore()->GetRHI();
 
-			XMFLOAT3 minVertex = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
-			XMFLOAT3 maxVertex = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		mTerrainTilesIndexCountNonTS = (mWidth - 1) * (mHeight - 1) * 6;
+		unsigned long* indices = new unsigned long[mTerrainTilesIndexCountNonTS];
 
-			// copy vertices to tile data + calculate AABB
-			for (int i = 0; i < mHeightMaps[tileIndex]->mVertexCountNonTS; i++)
+		int index = 0;
+		for (int j = 0; j < ((int)mHeight - 1); j++)
+		{
+			for (int i = 0; i < ((int)mWidth - 1); i++)
 			{
-				mHeightMaps[tileIndex]->mVertexList[i].x = vertices[i].Position.x;
-				mHeightMaps[tileIndex]->mVertexList[i].y = vertices[i].Position.y;
-				mHeightMaps[tileIndex]->mVertexList[i].z = vertices[i].Position.z;
-
-				//Get the smallest vertex 
-				minVertex.x = std::min(minVertex.x, vertices[i].Position.x);    // Find smallest x value in model
-				minVertex.y = std::min(minVertex.y, vertices[i].Position.y);    // Find smallest y value in model
-				minVertex.z = std::min(minVertex.z, vertices[i].Position.z);    // Find smallest z value in model
-
-				//Get the largest vertex 
-				maxVertex.x = std::max(maxVertex.x, vertices[i].Position.x);    // Find largest x value in model
-				maxVertex.y = std::max(maxVertex.y, vertices[i].Position.y);    // Find largest y value in model
-				maxVertex.z = std::max(maxVertex.z, vertices[i].Position.z);    // Find largest z value in model
+				unsigned long index1 = (mWidth * j) + i;				// Bottom left.
+				unsigned long index2 = (mWidth * j) + (i + 1);			// Bottom right.
+				unsigned long index3 = (mWidth * (j + 1)) + i;			// Upper left.
+				unsigned long index4 = (mWidth * (j + 1)) + (i + 1);	// Upper right.
+
+				indices[index++] = index3;
+				indices[index++] = index4;
+				indices[index++] = index1;
+
+				indices[index++] = index1;
+				indices[index++] = index4;
+				indices[index++] = index2;
 			}
-			mHeightMaps[tileIndex]->mAABB = { minVertex, maxVertex };
-
-			DeleteObjects(vertices);
-
-			mHeightMaps[tileIndex]->mIndexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Index Buffer, tile index: " + std::to_string(tileIndex));
-			mHeightMaps[tileIndex]->mIndexBufferNonTS->CreateGPUBufferResource(rhi, indices, mHeightMaps[tileIndex]->mIndexCountNonTS, sizeof(unsigned long), false, ER_BIND_INDEX_BUFFER);
+		}
 
-			DeleteObjects(indices);
+		DeleteObject(mTerrainTilesIndexBufferNonTS);
+		mTerrainTilesIndexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tiles (non-TS) - Shared Index Buffer");
+		mTerrainTilesIndexBufferNonTS->CreateGPUBufferResource(rhi, indices, mTerrainTilesIndexCountNonTS, sizeof(unsigned long), false, ER_BIND_INDEX_BUFFER);
 
-			mHeightMaps[tileIndex]->mDebugGizmoAABB = new ER_RenderableAABB(*GetCore(), XMFLOAT4(0.0, 0.0, 1.0, 1.0));
-			mHeightMaps[tileIndex]->mDebugGizmoAABB->InitializeGeometry({ mHeightMaps[tileIndex]->mAABB.first,mHeightMaps[tileIndex]->mAABB.second });
-		}
+		DeleteObjects(indices);
 	}
 
-	void ER_Terrain::Draw(TerrainRenderPass aPass, const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget,
+	void ER_Terrain::Draw(TerrainRenderPass aPass, ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget,
 		ER_ShadowMapper* worldShadowMapper, ER_LightProbesManager* probeManager, int shadowMapCascade, ER_Camera* aCustomCamera, bool skipCulling)
 	{
 		if (!mEnabled || !mLoaded)
@@ -558,43 +624,189 @@ namespace EveryRay_Core
 		ER_RHI* rhi = mCore->GetRHI();
 		ER_Camera* camera = aCustomCamera ? aCustomCamera : (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
 
-		if (worldShadowMapper && aPass != TerrainRenderPass::TERRAIN_GBUFFER)
+		// the same traversal for all the cameras: LOD is always based on the camera that we render from (main one for shadow cascades)
+		TerrainDrawList& drawList = mDrawLists[aPass == TerrainRenderPass::TERRAIN_SHADOW ? 1 + shadowMapCascade : 0];
 		{
-			for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+			ER_PROFILE_SCOPE("ER_Terrain: Select patches");
+			ER_Frustum cullingFrustum = camera->GetFrustum();
+			if (aPass == TerrainRenderPass::TERRAIN_SHADOW)
+				cullingFrustum.SetMatrix(worldShadowMapper->GetViewMatrix(shadowMapCascade) * worldShadowMapper->GetProjectionMatrix(shadowMapCascade));
+			SelectPatches(camera->Position(), (!skipCulling && mDoCPUFrustumCulling) ? &cullingFrustum : nullptr, drawList);
+		}
+
+		UINT firstPatch = 0;
+		{
+			std::lock_guard<std::mutex> lock(mDrawMutex);
+
+			if (worldShadowMapper && aPass != TerrainRenderPass::TERRAIN_GBUFFER)
+			{
+				for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+				{
+					mTerrainShadowBuffers[cascade].Data.LightViewProjection = XMMatrixTranspose(worldShadowMapper->GetViewMatrix(cascade) * worldShadowMapper->GetProjectionMatrix(cascade));
+					mTerrainShadowBuffers[cascade].ApplyChanges(rhi);
+
+					mTerrainConstantBuffer.Data.ShadowMatrices[cascade] = XMMatrixTranspose(worldShadowMapper->GetViewMatrix(cascade) * worldShadowMapper->GetProjectionMatrix(cascade) * XMLoadFloat4x4(&ER_MatrixHelper::GetProjectionShadowMatrix()));
+				}
+
+				mTerrainConstantBuffer.Data.ShadowTexelSize = XMFLOAT4{ 1.0f / worldShadowMapper->GetResolution(), 1.0f, 1.0f , 1.0f };
+				mTerrainConstantBuffer.Data.ShadowCascadeDistances = XMFLOAT4{ worldShadowMapper->GetCameraFarShadowCascadeDistance(0), worldShadowMapper->GetCameraFarShadowCascadeDistance(1), worldShadowMapper->GetCameraFarShadowCascadeDistance(2), 1.0f };
+			}
+
+			mTerrainConstantBuffer.Data.View = XMMatrixTranspose(camera->ViewMatrix());
+			mTerrainConstantBuffer.Data.Projection = XMMatrixTranspose(camera->ProjectionMatrix());
+			mTerrainConstantBuffer.Data.SunDirection = XMFLOAT4(-mDirectionalLight.Direction().x, -mDirectionalLight.Direction().y, -mDirectionalLight.Direction().z, 1.0f);
+			mTerrainConstantBuffer.Data.SunColor = XMFLOAT4{ mDirectionalLight.GetColor().x, mDirectionalLight.GetColor().y, mDirectionalLight.GetColor().z, mDirectionalLight.mLightIntensity };
+			mTerrainConstantBuffer.Data.CameraPosition = XMFLOAT4(camera->Position().x, camera->Position().y, camera->Position().z, 1.0f);
+			mTerrainConstantBuffer.Data.TessellationFactor = static_cast<float>(mTessellationFactor);
+			mTerrainConstantBuffer.Data.TerrainHeightScale = mTerrainTessellatedHeightScale;
+			mTerrainConstantBuffer.Data.TessellationFactorDynamic = static_cast<float>(mTessellationFactorDynamic);
+			mTerrainConstantBuffer.Data.UseDynamicTessellation = mUseDynamicTessellation ? 1.0f : 0.0f;
+			mTerrainConstantBuffer.Data.DistanceFactor = mTessellationDistanceFactor;
+			mTerrainConstantBuffer.Data.TileSize = mTileResolution * mTileScale;
+			mTerrainConstantBuffer.ApplyChanges(rhi);
+
+			if (mPatchesBufferFrameIndex != GetCore()->GetFrameIndex())
 			{
-				mTerrainShadowBuffers[cascade].Data.LightViewProjection = XMMatrixTranspose(worldShadowMapper->GetViewMatrix(cascade) * worldShadowMapper->GetProjectionMatrix(cascade));
-				mTerrainShadowBuffers[cascade].ApplyChanges(rhi);
+				mPatchesBufferFrameIndex = GetCore()->GetFrameIndex();
+				mPatchesBufferOffset = 0;
+				for (int i = 0; i < TERRAIN_RENDER_PASS_COUNT; i++)
+					mDrawStats[i] = TerrainDrawStats();
+			}
+			firstPatch = UploadPatches(drawList);
+			drawList.Stats.Draws = static_cast<UINT>(drawList.Tiles.size());
+
+			TerrainDrawStats& stats = mDrawStats[aPass];
+			stats.VisitedNodes += drawList.Stats.VisitedNodes;
+			stats.CulledNodes += drawList.Stats.CulledNodes;
+			stats.Patches += drawList.Stats.Patches;
+			stats.Draws += drawList.Stats.Draws;
+			for (int level = 0; level <= TERRAIN_QUADTREE_MAX_LEVEL; level++)
+				stats.PatchesPerLevel[level] += drawList.Stats.PatchesPerLevel[level];
+		}
+
+		for (const TerrainTileDrawRange& tileRange : drawList.Tiles)
+			DrawTessellated(aPass, aRenderTargets, aDepthTarget, tileRange.TileIndex, firstPatch + tileRange.FirstPatch, tileRange.PatchCount, worldShadowMapper, probeManager, shadowMapCascade);
+	}
+
+	// Appends the patches to the dynamic vertex buffer and returns the index of the first one
+	UINT ER_Terrain::UploadPatches(const TerrainDrawList& aDrawList)
+	{
+		ER_RHI* rhi = GetCore()->GetRHI();
+
+		const UINT patchesCount = static_cast<UINT>(aDrawList.Patches.size());
+		if (patchesCount == 0)
+			return 0;
+		assert(patchesCount <= mPatchesBufferCapacity);
+
+		// the first upload of a frame (or after running out of space) discards the previous content on DX11; DX12 buffers are per back buffer,
+		// so the capacity has to be enough for one frame there (light probes, which can render many cameras per frame, are only computed on DX11)
+		if (mPatchesBufferOffset == 0 || mPatchesBufferOffset + patchesCount > mPatchesBufferCapacity)
+		{
+			assert(mPatchesBufferOffset == 0 || rhi->GetAPI() != ER_GRAPHICS_API::DX12);
+			rhi->UpdateBuffer(mPatchesBufferTS, (void*)aDrawList.Patches.data(), patchesCount * sizeof(TerrainPatchGPU));
+			mPatchesBufferOffset = patchesCount;
+			return 0;
+		}
+
+		const UINT firstPatch = mPatchesBufferOffset;
+		rhi->UpdateBufferRange(mPatchesBufferTS, (void*)aDrawList.Patches.data(), firstPatch * sizeof(TerrainPatchGPU), patchesCount * sizeof(TerrainPatchGPU));
+		mPatchesBufferOffset += patchesCount;
+		return firstPatch;
+	}
+
+	void ER_Terrain::SelectPatches(const XMFLOAT3& aLODOrigin, const ER_Frustum* aFrustum, TerrainDrawList& aOutDrawList) const
+	{
+		aOutDrawList.Clear();
+		for (int tileIndex = 0; tileIndex < mNumTiles; tileIndex++)
+		{
+			const UINT firstPatch = static_cast<UINT>(aOutDrawList.Patches.size());
+			SelectQuadTreeNode(tileIndex, 0, 0, 0, aLODOrigin, aFrustum, aOutDrawList);
+
+			const UINT patchCount = static_cast<UINT>(aOutDrawList.Patches.size()) - firstPatch;
+			if (patchCount > 0)
+				aOutDrawList.Tiles.push_back({ tileIndex, firstPatch, patchCount });
+		}
+		aOutDrawList.Stats.Patches = static_cast<UINT>(aOutDrawList.Patches.size());
+	}
+
+	void ER_Terrain::SelectQuadTreeNode(int aTileIndex, int aLevel, int aI, int aJ, const XMFLOAT3& aLODOrigin, const ER_Frustum* aFrustum, TerrainDrawList& aOutDrawList) const
+	{
+		aOutDrawList.Stats.VisitedNodes++;
+
+		const int numTilesSqrt = sqrt(mNumTiles);
+		const int tileIndexX = aTileIndex / numTilesSqrt;
+		const int tileIndexY = aTileIndex % numTilesSqrt;
+		const int terrainTileSize = mTileResolution * mTileScale;
+		const float nodeSize = static_cast<float>(terrainTileSize) / (1 << aLevel);
+		const XMFLOAT2 tileOffset = XMFLOAT2(static_cast<float>(terrainTileSize * (tileIndexX - 1)), static_cast<float>(terrainTileSize * -tileIndexY)); // same as mWorldMatrixTS
 
-				mTerrainConstantBuffer.Data.ShadowMatrices[cascade] = XMMatrixTranspose(worldShadowMapper->GetViewMatrix(cascade) * worldShadowMapper->GetProjectionMatrix(cascade) * XMLoadFloat4x4(&ER_MatrixHelper::GetProjectionShadowMatrix()));
+		if (aFrustum)
+		{
+			const HeightMap* heightMap = mHeightMaps[aTileIndex];
+			const int nodeIndex = ((1 << (2 * aLevel)) - 1) / 3 + aJ * (1 << aLevel) + aI; // nodes count of the previous levels = (4^level - 1) / 3
+			const float heightScale = mTerrainTessellatedHeightScale / std::numeric_limits<unsigned short>::max();
+			const ER_AABB aabb = {
+				XMFLOAT3(tileOffset.x + aI * nodeSize, heightMap->mQuadTreeMinHeights[nodeIndex] * heightScale, tileOffset.y + aJ * nodeSize),
+				XMFLOAT3(tileOffset.x + (aI + 1) * nodeSize, heightMap->mQuadTreeMaxHeights[nodeIndex] * heightScale, tileOffset.y + (aJ + 1) * nodeSize)
+			};
+			if (ER_FrustumCulling::IsCulled(*aFrustum, aabb))
+			{
+				aOutDrawList.Stats.CulledNodes++;
+				return;
 			}
+		}
 
-			mTerrainConstantBuffer.Data.ShadowTexelSize = XMFLOAT4{ 1.0f / worldShadowMapper->GetResolution(), 1.0f, 1.0f , 1.0f };
-			mTerrainConstantBuffer.Data.ShadowCascadeDistances = XMFLOAT4{ worldShadowMapper->GetCameraFarShadowCascadeDistance(0), worldShadowMapper->GetCameraFarShadowCascadeDistance(1), worldShadowMapper->GetCameraFarShadowCascadeDistance(2), 1.0f };
+		// global node coordinates (tile rows go towards -Z)
+		const int x = tileIndexX * (1 << aLevel) + aI;
+		const int z = (numTilesSqrt - 1 - tileIndexY) * (1 << aLevel) + aJ;
+		if (IsQuadTreeNodeSplit(aLevel, x, z, aLODOrigin))
+		{
+			for (int child = 0; child < 4; child++)
+				SelectQuadTreeNode(aTileIndex, aLevel + 1, 2 * aI + child % 2, 2 * aJ + child / 2, aLODOrigin, aFrustum, aOutDrawList);
+			return;
 		}
 
-		int tileIndex = 0;
-		for (int i = 0; i < MAX_TERRAIN_TILE_COUNT; i++, tileIndex++)
+		// neighbours along the edges of the quad domain: -X, -Z, +X, +Z
+		static const int edgeDirections[4][2] = { { -1, 0 }, { 0, -1 }, { 1, 0 }, { 0, 1 } };
+		const int nodesPerSide = numTilesSqrt * (1 << aLevel);
+		UINT edgeFlags = 0;
+		for (int edge = 0; edge < 4; edge++)
 		{
-			if (tileIndex < static_cast<int>(mHeightMaps.size()))
-				mTerrainConstantBuffer.Data.TerrainTileWorld[tileIndex] = XMMatrixTranspose(mHeightMaps[tileIndex]->mWorldMatrixTS);
-			else
-				mTerrainConstantBuffer.Data.TerrainTileWorld[i] = XMMatrixIdentity();
+			const int neighbourX = x + edgeDirections[edge][0];
+			const int neighbourZ = z + edgeDirections[edge][1];
+			if (neighbourX < 0 || neighbourZ < 0 || neighbourX >= nodesPerSide || neighbourZ >= nodesPerSide)
+				continue;
+
+			// our parent is split, so the neighbour is coarser only if its parent is not (and finer if it is split itself)
+			if (aLevel > 0 && !IsQuadTreeNodeSplit(aLevel - 1, neighbourX / 2, neighbourZ / 2, aLODOrigin))
+				edgeFlags |= TERRAIN_PATCH_EDGE_COARSER_NEIGHBOUR << edge;
+			else if (IsQuadTreeNodeSplit(aLevel, neighbourX, neighbourZ, aLODOrigin))
+				edgeFlags |= TERRAIN_PATCH_EDGE_FINER_NEIGHBOUR << edge;
 		}
-		mTerrainConstantBuffer.Data.View = XMMatrixTranspose(camera->ViewMatrix());
-		mTerrainConstantBuffer.Data.Projection = XMMatrixTranspose(camera->ProjectionMatrix());
-		mTerrainConstantBuffer.Data.SunDirection = XMFLOAT4(-mDirectionalLight.Direction().x, -mDirectionalLight.Direction().y, -mDirectionalLight.Direction().z, 1.0f);
-		mTerrainConstantBuffer.Data.SunColor = XMFLOAT4{ mDirectionalLight.GetColor().x, mDirectionalLight.GetColor().y, mDirectionalLight.GetColor().z, mDirectionalLight.mLightIntensity };
-		mTerrainConstantBuffer.Data.CameraPosition = XMFLOAT4(camera->Position().x, camera->Position().y, camera->Position().z, 1.0f);
-		mTerrainConstantBuffer.Data.TessellationFactor = static_cast<float>(mTessellationFactor);
-		mTerrainConstantBuffer.Data.TerrainHeightScale = mTerrainTessellatedHeightScale;
-		mTerrainConstantBuffer.Data.TessellationFactorDynamic = static_cast<float>(mTessellationFactorDynamic);
-		mTerrainConstantBuffer.Data.UseDynamicTessellation = mUseDynamicTessellation ? 1.0f : 0.0f;
-		mTerrainConstantBuffer.Data.DistanceFactor = mTessellationDistanceFactor;
-		mTerrainConstantBuffer.Data.TileSize = mTileResolution * mTileScale;
-		mTerrainConstantBuffer.ApplyChanges(rhi);
 
-		for (int i = 0; i < mHeightMaps.size(); i++)
-			DrawTessellated(aPass, aRenderTargets, aDepthTarget, i, worldShadowMapper, probeManager, shadowMapCascade, skipCulling);
+		TerrainPatchGPU patch;
+		patch.PatchInfo = XMFLOAT4(aI * nodeSize, aJ * nodeSize, nodeSize, nodeSize);
+		patch.TileInfo = XMFLOAT4(static_cast<float>(aTileIndex), static_cast<float>(edgeFlags), tileOffset.x, tileOffset.y);
+		aOutDrawList.Patches.push_back(patch);
+		aOutDrawList.Stats.PatchesPerLevel[aLevel]++;
+	}
+
+	bool ER_Terrain::IsQuadTreeNodeSplit(int aLevel, int aX, int aZ, const XMFLOAT3& aLODOrigin) const
+	{
+		if (aLevel >= TERRAIN_QUADTREE_MAX_LEVEL)
+			return false;
+
+		const int numTilesSqrt = sqrt(mNumTiles);
+		const int terrainTileSize = mTileResolution * mTileScale;
+		const float nodeSize = static_cast<float>(terrainTileSize) / (1 << aLevel);
+		const float minX = static_cast<float>(-terrainTileSize) + aX * nodeSize;
+		const float minZ = static_cast<float>(-terrainTileSize * (numTilesSqrt - 1)) + aZ * nodeSize;
+
+		// XZ distance to the node's rectangle (heights are ignored, so that the neighbours can be checked without their bounds)
+		const float dx = std::max(std::max(minX - aLODOrigin.x, aLODOrigin.x - (minX + nodeSize)), 0.0f);
+		const float dz = std::max(std::max(minZ - aLODOrigin.z, aLODOrigin.z - (minZ + nodeSize)), 0.0f);
+		const float splitDistance = mLODDistanceFactor * nodeSize;
+		return dx * dx + dz * dz < splitDistance * splitDistance;
 	}
 
 	void ER_Terrain::DrawDebugGizmos(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs)
@@ -611,22 +823,24 @@ namespace EveryRay_Core
 		if (!mEnabled && !mLoaded)
 			return;
 
-		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
-
-		int visibleTiles = 0;
-		for (int i = 0; i < mHeightMaps.size(); i++)
-		{
-			if (!mHeightMaps[i]->PerformCPUFrustumCulling(mDoCPUFrustumCulling ? camera : nullptr))
-				visibleTiles++;
-		}
-
 		if (mShowDebug) {
 			ImGui::Begin("Terrain System");
 			
-			std::string cullText = "Visible tiles: " + std::to_string(visibleTiles) + "/" + std::to_string(mHeightMaps.size());
+			const TerrainDrawStats& mainStats = mDrawStats[TERRAIN_GBUFFER];
+			std::string cullText = "Visible tiles: " + std::to_string(mainStats.Draws) + "/" + std::to_string(mHeightMaps.size());
 			ImGui::Text(cullText.c_str());
+			std::string patchesText = "Patches: " + std::to_string(mainStats.Patches) + " (per level:";
+			for (int level = 0; level <= TERRAIN_QUADTREE_MAX_LEVEL; level++)
+				patchesText += " " + std::to_string(mainStats.PatchesPerLevel[level]);
+			patchesText += "), nodes visited: " + std::to_string(mainStats.VisitedNodes) + ", culled: " + std::to_string(mainStats.CulledNodes);
+			ImGui::Text(patchesText.c_str());
+			const TerrainDrawStats& shadowStats = mDrawStats[TERRAIN_SHADOW];
+			std::string shadowText = "Shadow cascades: " + std::to_string(shadowStats.Patches) + " patches in " + std::to_string(shadowStats.Draws) + " draws";
+			ImGui::Text(shadowText.c_str());
 			ImGui::Checkbox("Enabled", &mEnabled);
 			ImGui::Checkbox("CPU frustum culling", &mDoCPUFrustumCulling);
+			if (ImGui::SliderFloat("Quadtree LOD distance factor", &mLODDistanceFactor, TERRAIN_MIN_LOD_DISTANCE_FACTOR, 8.0f))
+				SetLODDistanceFactor(mLODDistanceFactor);
 			ImGui::Checkbox("Debug tiles AABBs", &mDrawDebugAABBs);
 			ImGui::SliderInt("Tessellation factor static", &mTessellationFactor, 1, 64);
 			ImGui::SliderInt("Tessellation factor dynamic", &mTessellationFactorDynamic, 1, 64);
@@ -634,48 +848,40 @@ namespace EveryRay_Core
 			ImGui::SliderFloat("Dynamic LOD distance factor", &mTessellationDistanceFactor, 0.0001f, 0.1f);
 			ImGui::SliderFloat("Tessellated terrain height scale", &mTerrainTessellatedHeightScale, 0.0f, 1000.0f);
 			ImGui::SliderFloat("Placement height delta", &mPlacementHeightDelta, 0.0f, 10.0f);
+			ImGui::Checkbox("CPU placement", &mUseCPUPlacement);
 			ImGui::End();
 		}
 	}
 
-	void ER_Terrain::DrawTessellated(TerrainRenderPass aPass, const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, int tileIndex,
-		ER_ShadowMapper* worldShadowMapper, ER_LightProbesManager* probeManager, int shadowMapCascade, bool skipCulling)
+	ER_RHI_PSO_HANDLE ER_Terrain::GetPassPSO(TerrainRenderPass aPass) const
 	{
-		if (aPass == TerrainRenderPass::TERRAIN_SHADOW)
-			assert(shadowMapCascade != -1);
-		
-		//for shadow mapping pass we dont want to cull with main camera frustum
-		if (mHeightMaps[tileIndex]->IsCulled() && !skipCulling)
-			return;
-
-		ER_RHI* rhi = mCore->GetRHI();
-
-		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
-		assert(camera);
-
-		ER_RHI_PRIMITIVE_TYPE originalPrimitiveTopology = rhi->GetCurrentTopologyType();
-
-		ER_RHI_GPURootSignature* rootSig = mTerrainCommonPassRS;
-		std::string psoName = ER_Utility::IsWireframe ? mTerrainMainPassWireframePSOName : mTerrainMainPassPSOName;
 		if (aPass == TERRAIN_SHADOW)
-			psoName = mTerrainShadowPassPSOName;
+			return mTerrainShadowPassPSO;
 		else if (aPass == TERRAIN_GBUFFER)
-			psoName = ER_Utility::IsWireframe ? mTerrainGBufferPassWireframePSOName : mTerrainGBufferPassPSOName;
+			return ER_Utility::IsWireframe ? mTerrainGBufferPassWireframePSO : mTerrainGBufferPassPSO;
 		else if (aPass == TERRAIN_LIGHTPROBE)
-			psoName = mTerrainLightProbePassPSOName;
+			return mTerrainLightProbePassPSO;
+		else
+			return ER_Utility::IsWireframe ? mTerrainMainPassWireframePSO : mTerrainMainPassPSO;
+	}
 
-		rhi->SetRootSignature(rootSig);
-		rhi->SetVertexBuffers({ mHeightMaps[tileIndex]->mVertexBufferTS });
-		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_CONTROL_POINT_PATCHLIST);
+	void ER_Terrain::PreparePSO(TerrainRenderPass aPass, ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, ER_ShadowMapper* worldShadowMapper, int shadowMapCascade)
+	{
+		if (!mEnabled || !mLoaded)
+			return;
+
+		ER_RHI* rhi = mCore->GetRHI();
+		ER_RHI_GPURootSignature* rootSig = mTerrainCommonPassRS;
+		ER_RHI_PSO_HANDLE pso = GetPassPSO(aPass);
 
-		if (!rhi->IsPSOReady(psoName))
+		if (!rhi->IsPSOReady(pso))
 		{
-			rhi->InitializePSO(psoName);
-			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_CONTROL_POINT_PATCHLIST);
+			rhi->InitializePSO(pso);
+			rhi->SetTopologyTypeToPSO(pso, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_CONTROL_POINT_PATCHLIST);
 			rhi->SetInputLayout(mInputLayout);
 			rhi->SetShader(mVS);
 			rhi->SetShader(mHS);
-			rhi->SetRootSignatureToPSO(psoName, rootSig);
+			rhi->SetRootSignatureToPSO(pso, rootSig);
 			rhi->SetBlendState(ER_RHI_BLEND_STATE::ER_NO_BLEND);
 			rhi->SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
 			if (aPass == TerrainRenderPass::TERRAIN_SHADOW)
@@ -699,9 +905,32 @@ namespace EveryRay_Core
 				rhi->SetRenderTargetFormats(aRenderTargets, aDepthTarget);
 			}
 				
-			rhi->FinalizePSO(psoName);
+			rhi->FinalizePSO(pso);
 		}
-		rhi->SetPSO(psoName);
+	}
+
+	void ER_Terrain::DrawTessellated(TerrainRenderPass aPass, ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, int tileIndex,
+		UINT firstPatch, UINT patchCount, ER_ShadowMapper* worldShadowMapper, ER_LightProbesManager* probeManager, int shadowMapCascade)
+	{
+		if (aPass == TerrainRenderPass::TERRAIN_SHADOW)
+			assert(shadowMapCascade != -1);
+
+		ER_RHI* rhi = mCore->GetRHI();
+
+		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
+		assert(camera);
+
+		ER_RHI_PRIMITIVE_TYPE originalPrimitiveTopology = rhi->GetCurrentTopologyType();
+
+		ER_RHI_GPURootSignature* rootSig = mTerrainCommonPassRS;
+		ER_RHI_PSO_HANDLE pso = GetPassPSO(aPass);
+
+		rhi->SetRootSignature(rootSig);
+		rhi->SetVertexBuffers({ mPatchesBufferTS });
+		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_CONTROL_POINT_PATCHLIST);
+
+		PreparePSO(aPass, aRenderTargets, aDepthTarget, worldShadowMapper, shadowMapCascade);
+		rhi->SetPSO(pso);
 		
 		//set shader resources
 		{
@@ -721,7 +950,7 @@ namespace EveryRay_Core
 				rhi->SetConstantBuffers(ER_PIXEL,				{ mTerrainConstantBuffer.Buffer() }, 0, rootSig, TERRAIN_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 			}
 
-			std::vector<ER_RHI_GPUResource*> resources(19);
+			ER_RHI_InlineArray<ER_RHI_GPUResource*, 19> resources(19);
 			resources[0] = mHeightMaps[tileIndex]->mSplatTexture;
 			resources[1] = mSplatChannelTextures[0];
 			resources[2] = mSplatChannelTextures[1];
@@ -751,7 +980,7 @@ namespace EveryRay_Core
 			rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS, ER_RHI_SAMPLER_STATE::ER_TRILINEAR_CLAMP });
 		}
 		
-		rhi->Draw(NUM_TERRAIN_PATCHES_PER_TILE * NUM_TERRAIN_PATCHES_PER_TILE);
+		rhi->DrawInstanced(patchCount, 1, firstPatch, 0);
 		
 		rhi->UnsetPSO();
 
@@ -766,7 +995,6 @@ namespace EveryRay_Core
 
 	float HeightMap::FindHeightFromPosition(float x, float z)
 	{
-		int index = 0;
 		float vertex1[3] = { 0.0, 0.0, 0.0 };
 		float vertex2[3] = { 0.0, 0.0, 0.0 }; 
 		float vertex3[3] = { 0.0, 0.0, 0.0 }; 
@@ -774,82 +1002,109 @@ namespace EveryRay_Core
 		float height = 0.0f;
 		bool isFound = false;
 
-		int index1 = 0;
-		int index2 = 0;
-		int index3 = 0;
-
-		for (int i = 0; i < mVertexCountNonTS / 3; i++)
+		auto setVertex = [this](float vertex[3], int i, int j)
 		{
-			index = i * 3;
-
-			vertex1[0] = mVertexList[index].x;
-			vertex1[1] = mVertexList[index].y;
-			vertex1[2] = mVertexList[index].z;
-			index++;
-
-			vertex2[0] = mVertexList[index].x;
-			vertex2[1] = mVertexList[index].y;
-			vertex2[2] = mVertexList[index].z;
-			index++;
-
-			vertex3[0] = mVertexList[index].x;
-			vertex3[1] = mVertexList[index].y;
-			vertex3[2] = mVertexList[index].z;
-
-			// Check to see if this is the polygon we are looking for.
-			isFound = GetHeightFromTriangle(x, z, vertex1, vertex2, vertex3, normals, height);
-			if (isFound)
-				return height;
+			const XMFLOAT3 position = GetVertexPosition(i, j);
+			vertex[0] = position.x;
+			vertex[1] = position.y;
+			vertex[2] = position.z;
+		};
+
+		// same triangles (and order) as in the CPU mesh
+		for (int j = 0; j < mHeight - 1; j++)
+		{
+			for (int i = 0; i < mWidth - 1; i++)
+			{
+				// upper left, upper right, bottom left
+				setVertex(vertex1, i, j + 1);
+				setVertex(vertex2, i + 1, j + 1);
+				setVertex(vertex3, i, j);
+				isFound = GetHeightFromTriangle(x, z, vertex1, vertex2, vertex3, normals, height);
+				if (isFound)
+					return height;
+
+				// bottom left, upper right, bottom right
+				setVertex(vertex1, i, j);
+				setVertex(vertex2, i + 1, j + 1);
+				setVertex(vertex3, i + 1, j);
+				isFound = GetHeightFromTriangle(x, z, vertex1, vertex2, vertex3, normals, height);
+				if (isFound)
+					return height;
+			}
 		}
 		return -1.0f;
 	}
 
-	bool HeightMap::PerformCPUFrustumCulling(ER_Camera* camera)
+	// Same triangles as in the CPU mesh (and FindHeightFromPosition()), but the cell is found directly from the position
+	bool HeightMap::FindHeightFromGrid(float x, float z, float& height) const
 	{
-		if (!camera)
-		{
-			mIsCulled = false;
-			return mIsCulled;
-		}
-
-		auto frustum = camera->GetFrustum();
-		bool culled = false;
-		// start a loop through all frustum planes
-		for (int planeID = 0; planeID < 6; ++planeID)
-		{
-			XMVECTOR planeNormal = XMVectorSet(frustum.Planes()[planeID].x, frustum.Planes()[planeID].y, frustum.Planes()[planeID].z, 0.0f);
-			float planeConstant = frustum.Planes()[planeID].w;
+		const float cellX = (x - mOrigin.x) / mCellSize;
+		const float cellZ = (z - mOrigin.y) / mCellSize;
+		const float epsilon = 0.0001f;
+		if (cellX < -epsilon || cellZ < -epsilon || cellX > mWidth - 1 + epsilon || cellZ > mHeight - 1 + epsilon)
+			return false;
 
-			XMFLOAT3 axisVert;
+		const int i = std::min(std::max(static_cast<int>(cellX), 0), mWidth - 2);
+		const int j = std::min(std::max(static_cast<int>(cellZ), 0), mHeight - 2);
+		const float fx = cellX - i;
+		const float fz = cellZ - j;
 
-			// x-axis
-			if (frustum.Planes()[planeID].x > 0.0f)
-				axisVert.x = mAABB.first.x;
-			else
-				axisVert.x = mAABB.second.x;
+		const float bottomLeft = GetVertexPosition(i, j).y;
+		const float bottomRight = GetVertexPosition(i + 1, j).y;
+		const float upperLeft = GetVertexPosition(i, j + 1).y;
+		const float upperRight = GetVertexPosition(i + 1, j + 1).y;
 
-			// y-axis
-			if (frustum.Planes()[planeID].y > 0.0f)
-				axisVert.y = mAABB.first.y;
-			else
-				axisVert.y = mAABB.second.y;
-
-			// z-axis
-			if (frustum.Planes()[planeID].z > 0.0f)
-				axisVert.z = mAABB.first.z;
-			else
-				axisVert.z = mAABB.second.z;
+		// the quad is split by the "bottom left - upper right" diagonal
+		if (fz >= fx)
+			height = bottomLeft + fx * (upperRight - upperLeft) + fz * (upperLeft - bottomLeft);
+		else
+			height = bottomLeft + fx * (bottomRight - bottomLeft) + fz * (upperRight - bottomRight);
+		return true;
+	}
 
+	// Bilinear sampling with clamped addressing (same as SampleLevel() with ER_BILINEAR_CLAMP on the R16_UNORM heightmap), returns [0, 1]
+	float HeightMap::SampleHeightmap(float u, float v) const
+	{
+		const float texelX = u * mWidth - 0.5f;
+		const float texelY = v * mHeight - 0.5f;
+		const float floorX = floorf(texelX);
+		const float floorY = floorf(texelY);
+		const float fx = texelX - floorX;
+		const float fy = texelY - floorY;
+
+		const int x0 = std::min(std::max(static_cast<int>(floorX), 0), mWidth - 1);
+		const int y0 = std::min(std::max(static_cast<int>(floorY), 0), mHeight - 1);
+		const int x1 = std::min(std::max(static_cast<int>(floorX) + 1, 0), mWidth - 1);
+		const int y1 = std::min(std::max(static_cast<int>(floorY) + 1, 0), mHeight - 1);
+
+		const float top = mRawHeights[mWidth * y0 + x0] + fx * (static_cast<float>(mRawHeights[mWidth * y0 + x1]) - mRawHeights[mWidth * y0 + x0]);
+		const float bottom = mRawHeights[mWidth * y1 + x0] + fx * (static_cast<float>(mRawHeights[mWidth * y1 + x1]) - mRawHeights[mWidth * y1 + x0]);
+		return (top + fy * (bottom - top)) / 65535.0f;
+	}
 
-			if (XMVectorGetX(XMVector3Dot(planeNormal, XMLoadFloat3(&axisVert))) + planeConstant > 0.0f)
-			{
-				culled = true;
-				// Skip remaining planes to check and move on 
-				break;
-			}
-		}
-		mIsCulled = culled;
-		return culled;
+	// Bilinear sampling with wrapped addressing (same as SampleLevel() with ER_TRILINEAR_WRAP on mip 0), returns [0, 1]
+	float HeightMap::SampleSplatmap(float u, float v, int channel) const
+	{
+		if (mRawSplat.empty())
+			return 1.0f;
+
+		const float texelX = u * mSplatWidth - 0.5f;
+		const float texelY = v * mSplatHeight - 0.5f;
+		const float floorX = floorf(texelX);
+		const float floorY = floorf(texelY);
+		const float fx = texelX - floorX;
+		const float fy = texelY - floorY;
+
+		auto wrap = [](int value, int size) { return ((value % size) + size) % size; };
+		const int x0 = wrap(static_cast<int>(floorX), mSplatWidth);
+		const int y0 = wrap(static_cast<int>(floorY), mSplatHeight);
+		const int x1 = wrap(static_cast<int>(floorX) + 1, mSplatWidth);
+		const int y1 = wrap(static_cast<int>(floorY) + 1, mSplatHeight);
+		auto texel = [this, channel](int x, int y) { return static_cast<float>(mRawSplat[(mSplatWidth * y + x) * 4 + channel]); };
+
+		const float top = texel(x0, y0) + fx * (texel(x1, y0) - texel(x0, y0));
+		const float bottom = texel(x0, y1) + fx * (texel(x1, y1) - texel(x0, y1));
+		return (top + fy * (bottom - top)) / 255.0f;
 	}
 
 	bool HeightMap::RayIntersectsTriangle(float x, float z, float v0[3], float v1[3], float v2[3], float normals[3], float& height)
@@ -1033,7 +1288,7 @@ namespace EveryRay_Core
 		return true;
 	}
 
-	bool HeightMap::IsColliding(const XMFLOAT4& position, bool onlyXZCheck)
+	bool HeightMap::IsColliding(const XMFLOAT4& position, bool onlyXZCheck) const
 	{
 		bool isColliding =  onlyXZCheck ?
 			((position.x <= mAABB.second.x && position.x >= mAABB.first.x) &&
@@ -1046,6 +1301,250 @@ namespace EveryRay_Core
 		return isColliding;
 	}
 
+	// Tiles are laid out on a grid, so we only check the AABBs of the tile under the position and its neighbours
+	// (AABBs are from the CPU mesh and are slightly shifted because of the seams fix). Like in PlaceObjectsOnTerrain.hlsl, the lowest colliding index wins.
+	int ER_Terrain::GetTileIndex(float x, float z) const
+	{
+		if (!mLoaded || mNumTiles == 0)
+			return -1;
+
+		const int numTilesSqrt = static_cast<int>(sqrt(mNumTiles));
+		const float tileSize = static_cast<float>(static_cast<int>(mTileResolution * mTileScale));
+		const int tileX = static_cast<int>(floorf(x / tileSize)) + 1;
+		const int tileY = static_cast<int>(floorf(-z / tileSize)) + 1;
+		const XMFLOAT4 position = XMFLOAT4(x, 0.0f, z, 1.0f);
+
+		int result = -1;
+		for (int neighbourX = std::max(tileX - 1, 0); neighbourX <= std::min(tileX + 1, numTilesSqrt - 1); neighbourX++)
+		{
+			for (int neighbourY = std::max(tileY - 1, 0); neighbourY <= std::min(tileY + 1, numTilesSqrt - 1); neighbourY++)
+			{
+				const int tileIndex = neighbourX * numTilesSqrt + neighbourY;
+				if ((result == -1 || tileIndex < result) && mHeightMaps[tileIndex]->IsColliding(position, true))
+					result = tileIndex;
+			}
+		}
+		return result;
+	}
+
+	bool ER_Terrain::GetHeight(float x, float z, float& aOutHeight, TerrainHeightSampling aSampling) const
+	{
+		const int tileIndex = GetTileIndex(x, z);
+		if (tileIndex < 0)
+			return false;
+
+		const HeightMap* heightMap = mHeightMaps[tileIndex];
+		if (aSampling == TerrainHeightSampling::TERRAIN_HEIGHT_SAMPLING_MESH)
+			return heightMap->FindHeightFromGrid(x, z, aOutHeight);
+
+		// same texture coordinates as in PlaceObjectsOnTerrain.hlsl (GetTextureCoordinates())
+		const float tileSize = static_cast<float>(static_cast<int>(mTileResolution * mTileScale));
+		const float u = (x + heightMap->mTileUVOffset.x) / tileSize;
+		const float v = (z + heightMap->mTileUVOffset.y) / tileSize;
+		aOutHeight = heightMap->SampleHeightmap(u, v) * mTerrainTessellatedHeightScale;
+		return true;
+	}
+
+	float ER_Terrain::GetSplatDensity(float x, float z, int aSplatChannel) const
+	{
+		const int tileIndex = GetTileIndex(x, z);
+		if (tileIndex < 0)
+			return 0.0f;
+
+		// same texture coordinates as in PlaceOnTerrainCPU()
+		const HeightMap* heightMap = mHeightMaps[tileIndex];
+		const float tileSize = static_cast<float>(static_cast<int>(mTileResolution * mTileScale));
+		const float u = (x + heightMap->mTileUVOffset.x) / tileSize;
+		const float v = 1.0f - (z + heightMap->mTileUVOffset.y) / tileSize;
+		return heightMap->SampleSplatmap(u, v, aSplatChannel);
+	}
+
+	void ER_Terrain::GetHeights(const XMFLOAT4* aPositions, float* aOutHeights, int aPositionsCount, TerrainHeightSampling aSampling, ER_JobSystem* aJobSystem) const
+	{
+		const int batchSize = 4096;
+		auto processBatch = [this, aPositions, aOutHeights, aPositionsCount, aSampling, batchSize](UINT aBatchIndex)
+		{
+			const int end = std::min(static_cast<int>(aBatchIndex + 1) * batchSize, aPositionsCount);
+			for (int i = aBatchIndex * batchSize; i < end; i++)
+			{
+				if (!GetHeight(aPositions[i].x, aPositions[i].z, aOutHeights[i], aSampling))
+					aOutHeights[i] = TERRAIN_INVALID_HEIGHT;
+			}
+		};
+
+		const UINT batchesCount = static_cast<UINT>((aPositionsCount + batchSize - 1) / batchSize);
+		if (aJobSystem && batchesCount > 1)
+		{
+			ER_JobCounter counter;
+			aJobSystem->ParallelFor(batchesCount, 1, processBatch, &counter);
+			aJobSystem->Wait(counter);
+		}
+		else
+		{
+			for (UINT i = 0; i < batchesCount; i++)
+				processBatch(i);
+		}
+	}
+
+	// Compares the grid queries with the brute-force FindHeightFromPosition() and the CPU placement (SIMD path, with and without jobs) with the grid queries on random points
+	bool ER_Terrain::RunHeightQueryTests()
+	{
+		const int validationPointsCount = 64; // brute-force path is very slow on big tiles
+		const int placementPointsCount = 4096;
+
+		XMFLOAT3 terrainMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 terrainMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (auto heightMap : mHeightMaps)
+		{
+			terrainMin = XMFLOAT3(std::min(terrainMin.x, heightMap->mAABB.first.x), 0.0f, std::min(terrainMin.z, heightMap->mAABB.first.z));
+			terrainMax = XMFLOAT3(std::max(terrainMax.x, heightMap->mAABB.second.x), 0.0f, std::max(terrainMax.z, heightMap->mAABB.second.z));
+		}
+
+		int mismatchesCount = 0;
+		float maxError = 0.0f;
+		for (int i = 0; i < validationPointsCount; i++)
+		{
+			const float x = ER_Utility::RandomFloat(terrainMin.x, terrainMax.x);
+			const float z = ER_Utility::RandomFloat(terrainMin.z, terrainMax.z);
+			const int tileIndex = GetTileIndex(x, z);
+
+			int bruteForceTileIndex = -1;
+			for (int tile = 0; tile < mNumTiles; tile++)
+			{
+				if (mHeightMaps[tile]->IsColliding(XMFLOAT4(x, 0.0f, z, 1.0f), true))
+				{
+					bruteForceTileIndex = tile;
+					break;
+				}
+			}
+
+			if (tileIndex != bruteForceTileIndex)
+			{
+				mismatchesCount++;
+				continue;
+			}
+			if (tileIndex < 0)
+				continue;
+
+			float height = 0.0f;
+			const float bruteForceHeight = mHeightMaps[tileIndex]->FindHeightFromPosition(x, z);
+			if (!GetHeight(x, z, height, TerrainHeightSampling::TERRAIN_HEIGHT_SAMPLING_MESH))
+			{
+				if (bruteForceHeight != -1.0f)
+					mismatchesCount++;
+				continue;
+			}
+
+			const float error = abs(height - bruteForceHeight);
+			maxError = std::max(maxError, error);
+			if (error > 0.005f * std::max(1.0f, abs(bruteForceHeight))) // brute-force path is not very precise on steep triangles
+				mismatchesCount++;
+		}
+
+		// CPU placement (SIMD path) must give the same heights as the scalar queries
+		std::vector<XMFLOAT4> positions(placementPointsCount);
+		for (auto& position : positions)
+			position = XMFLOAT4(ER_Utility::RandomFloat(terrainMin.x, terrainMax.x), 0.0f, ER_Utility::RandomFloat(terrainMin.z, terrainMax.z), 1.0f);
+		std::vector<float> heights(placementPointsCount);
+		GetHeights(positions.data(), heights.data(), placementPointsCount, TerrainHeightSampling::TERRAIN_HEIGHT_SAMPLING_HEIGHTMAP);
+
+		int placementMismatchesCount = 0;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			std::vector<XMFLOAT4> placedPositions(positions);
+			PlaceOnTerrainCPU(placedPositions.data(), placementPointsCount, TerrainSplatChannels::NONE, 0.0f, (pass == 0) ? nullptr : GetCore()->GetJobSystem());
+			for (int i = 0; i < placementPointsCount; i++)
+			{
+				if (abs(placedPositions[i].y - heights[i]) > 0.001f * std::max(1.0f, abs(heights[i])))
+					placementMismatchesCount++;
+			}
+		}
+
+		const bool isPassed = mismatchesCount == 0 && placementMismatchesCount == 0;
+		std::wstring msg = L"[ER Logger][ER_Terrain] Height query tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L": " + std::to_wstring(mismatchesCount) +
+			L" mismatches with the brute-force path out of " + std::to_wstring(validationPointsCount) + L" points (max error: " + std::to_wstring(maxError) + L"), " +
+			std::to_wstring(placementMismatchesCount) + L" CPU placement mismatches\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+
+		return isPassed;
+	}
+
+	// Logs the throughput of both sampling modes and of the CPU placement (and the GPU vs. CPU placement error on DX11)
+	void ER_Terrain::BenchmarkHeightQueries()
+	{
+		const int benchmarkPointsCount = 1 << 20;
+
+		XMFLOAT3 terrainMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 terrainMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (auto heightMap : mHeightMaps)
+		{
+			terrainMin = XMFLOAT3(std::min(terrainMin.x, heightMap->mAABB.first.x), 0.0f, std::min(terrainMin.z, heightMap->mAABB.first.z));
+			terrainMax = XMFLOAT3(std::max(terrainMax.x, heightMap->mAABB.second.x), 0.0f, std::max(terrainMax.z, heightMap->mAABB.second.z));
+		}
+
+		std::vector<XMFLOAT4> positions(benchmarkPointsCount);
+		for (auto& position : positions)
+			position = XMFLOAT4(ER_Utility::RandomFloat(terrainMin.x, terrainMax.x), 0.0f, ER_Utility::RandomFloat(terrainMin.z, terrainMax.z), 1.0f);
+		std::vector<float> heights(benchmarkPointsCount);
+
+		auto measure = [&](TerrainHeightSampling aSampling, ER_JobSystem* aJobSystem)
+		{
+			auto startTime = std::chrono::high_resolution_clock::now();
+			GetHeights(positions.data(), heights.data(), benchmarkPointsCount, aSampling, aJobSystem);
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		};
+		const double heightmapMs = measure(TerrainHeightSampling::TERRAIN_HEIGHT_SAMPLING_HEIGHTMAP, nullptr);
+		const double meshMs = measure(TerrainHeightSampling::TERRAIN_HEIGHT_SAMPLING_MESH, nullptr);
+		const double heightmapJobsMs = measure(TerrainHeightSampling::TERRAIN_HEIGHT_SAMPLING_HEIGHTMAP, GetCore()->GetJobSystem());
+
+		std::vector<XMFLOAT4> placedPositions(positions);
+		auto startTime = std::chrono::high_resolution_clock::now();
+		PlaceOnTerrainCPU(placedPositions.data(), benchmarkPointsCount, TerrainSplatChannels::NONE, 0.0f);
+		const double placementMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		placedPositions = positions;
+		startTime = std::chrono::high_resolution_clock::now();
+		PlaceOnTerrainCPU(placedPositions.data(), benchmarkPointsCount, TerrainSplatChannels::NONE, 0.0f, GetCore()->GetJobSystem());
+		const double placementJobsMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+#if ER_PLATFORM_SUPPORTS_IMMEDIATE_CONTEXT
+		// GPU placement pass vs. CPU placement (not asserted: GPU bilinear filtering has lower precision)
+		{
+			ER_RHI* rhi = GetCore()->GetRHI();
+			const int gpuPointsCount = 4096;
+			std::vector<XMFLOAT4> gpuPositions(positions.begin(), positions.begin() + gpuPointsCount);
+			std::vector<XMFLOAT4> cpuPositions(gpuPositions);
+
+			ER_RHI_GPUBuffer* inputBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain placement test input positions buffer");
+			inputBuffer->CreateGPUBufferResource(rhi, gpuPositions.data(), gpuPointsCount, sizeof(XMFLOAT4), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+			ER_RHI_GPUBuffer* outputBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain placement test output positions buffer");
+			outputBuffer->CreateGPUBufferResource(rhi, gpuPositions.data(), gpuPointsCount, sizeof(XMFLOAT4), false, ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_BUFFER_STRUCTURED); //should be STAGING
+			PlaceOnTerrain(outputBuffer, inputBuffer, gpuPositions.data(), gpuPointsCount);
+			PlaceOnTerrainCPU(cpuPositions.data(), gpuPointsCount);
+			DeleteObject(inputBuffer);
+			DeleteObject(outputBuffer);
+
+			int culledMismatchesCount = 0;
+			float maxGPUError = 0.0f;
+			for (int i = 0; i < gpuPointsCount; i++)
+			{
+				if ((gpuPositions[i].y == TERRAIN_INVALID_HEIGHT) != (cpuPositions[i].y == TERRAIN_INVALID_HEIGHT))
+					culledMismatchesCount++;
+				else
+					maxGPUError = std::max(maxGPUError, abs(gpuPositions[i].y - cpuPositions[i].y));
+			}
+			std::wstring msg = L"[ER Logger][ER_Terrain] GPU vs. CPU placement: max error: " + std::to_wstring(maxGPUError) + L", culling mismatches: " +
+				std::to_wstring(culledMismatchesCount) + L" out of " + std::to_wstring(gpuPointsCount) + L" points\n";
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+#endif
+
+		std::wstring msg = L"[ER Logger][ER_Terrain] Height queries benchmark, " + std::to_wstring(benchmarkPointsCount) + L" queries - heightmap: " + std::to_wstring(heightmapMs) +
+			L" ms, mesh: " + std::to_wstring(meshMs) + L" ms, heightmap (jobs): " + std::to_wstring(heightmapJobsMs) + L" ms, CPU placement: " + std::to_wstring(placementMs) +
+			L" ms, CPU placement (jobs): " + std::to_wstring(placementJobsMs) + L" ms\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+
 	// Method for displacing points on terrain: send some points to the GPU, get transformed points from the GPU on the CPU (optional).
 	// GPU does everything in a compute shader (it finds a proper terrain tile, checks for the splat channel and transforms the provided points).
 	// There is also some older functionality (USE_RAYCASTING_FOR_ON_TERRAIN_PLACEMENT) if you do not want to check heightmap collisions (fast) but use raycasts to geometry instead (slow).
@@ -1073,14 +1572,14 @@ namespace EveryRay_Core
 		rhi->BeginEventTag("EveryRay: Place on terrain CS");
 
 		rhi->SetRootSignature(mTerrainPlacementPassRS, true);		
-		if (!rhi->IsPSOReady(mTerrainPlacementPassPSOName, true))
+		if (!rhi->IsPSOReady(mTerrainPlacementPassPSO))
 		{
-			rhi->InitializePSO(mTerrainPlacementPassPSOName, true);
-			rhi->SetRootSignatureToPSO(mTerrainPlacementPassPSOName, mTerrainPlacementPassRS, true);
+			rhi->InitializePSO(mTerrainPlacementPassPSO);
+			rhi->SetRootSignatureToPSO(mTerrainPlacementPassPSO, mTerrainPlacementPassRS);
 			rhi->SetShader(mPlaceOnTerrainCS);
-			rhi->FinalizePSO(mTerrainPlacementPassPSOName, true);
+			rhi->FinalizePSO(mTerrainPlacementPassPSO);
 		}
-		rhi->SetPSO(mTerrainPlacementPassPSOName, true);
+		rhi->SetPSO(mTerrainPlacementPassPSO);
 
 		mPlaceOnTerrainGlobalConstantBuffer.Data.HeightScale = mTerrainTessellatedHeightScale;
 		mPlaceOnTerrainGlobalConstantBuffer.Data.TerrainTileCount = static_cast<int>(mNumTiles);
@@ -1125,6 +1624,121 @@ namespace EveryRay_Core
 #endif
 	}
 
+	// CPU version of PlaceOnTerrain() with the same logic as PlaceObjectsOnTerrain.hlsl (tile lookup, splat channel check, heightmap sampling and damping).
+	// Positions are split into batches (jobs if aJobSystem is provided) and processed 4 at a time: tile lookups and texel fetches are scalar,
+	// texel coordinates, bilinear weights and heights are computed with SIMD.
+	void ER_Terrain::PlaceOnTerrainCPU(XMFLOAT4* positions, int positionsCount, TerrainSplatChannels splatCh, float customDampDelta, ER_JobSystem* aJobSystem) const
+	{
+		ER_PROFILE_SCOPE("ER_Terrain::PlaceOnTerrainCPU");
+		if (!mLoaded || positionsCount <= 0)
+			return;
+
+		const int batchSize = 4096;
+		const float tileSize = static_cast<float>(static_cast<int>(mTileResolution * mTileScale));
+		const float placementHeightDelta = abs(customDampDelta - FLT_MAX) < std::numeric_limits<float>::epsilon() ? mPlacementHeightDelta : customDampDelta;
+		const int splatChannel = (splatCh == TerrainSplatChannels::NONE) ? -1 : static_cast<int>(splatCh);
+		const int width = static_cast<int>(mWidth);
+		const int height = static_cast<int>(mHeight);
+
+		auto placeBatch = [&](UINT aBatchIndex)
+		{
+			const XMVECTOR texelsPerUnitX = XMVectorReplicate(width / tileSize);
+			const XMVECTOR texelsPerUnitY = XMVectorReplicate(height / tileSize);
+			const XMVECTOR halfTexel = XMVectorReplicate(0.5f);
+			const XMVECTOR maxTexel = XMVectorSet(static_cast<float>(width - 1), static_cast<float>(height - 1), 0.0f, 0.0f);
+			const XMVECTOR heightScale = XMVectorReplicate(mTerrainTessellatedHeightScale / 65535.0f);
+			const XMVECTOR heightDelta = XMVectorReplicate(placementHeightDelta);
+
+			const int begin = static_cast<int>(aBatchIndex) * batchSize;
+			const int end = std::min(begin + batchSize, positionsCount);
+			for (int first = begin; first < end; first += 4)
+			{
+				const int lanesCount = std::min(4, end - first);
+				int tileIndices[4] = { -1, -1, -1, -1 };
+				XMFLOAT4A tileX(0.0f, 0.0f, 0.0f, 0.0f); // positions in the tile's texture space (world units)
+				XMFLOAT4A tileY(0.0f, 0.0f, 0.0f, 0.0f);
+				for (int lane = 0; lane < lanesCount; lane++)
+				{
+					const XMFLOAT4& position = positions[first + lane];
+					tileIndices[lane] = GetTileIndex(position.x, position.z);
+					if (tileIndices[lane] >= 0)
+					{
+						(&tileX.x)[lane] = position.x + mHeightMaps[tileIndices[lane]]->mTileUVOffset.x;
+						(&tileY.x)[lane] = position.z + mHeightMaps[tileIndices[lane]]->mTileUVOffset.y;
+					}
+				}
+
+				const XMVECTOR texelX = XMVectorSubtract(XMVectorMultiply(XMLoadFloat4A(&tileX), texelsPerUnitX), halfTexel);
+				const XMVECTOR texelY = XMVectorSubtract(XMVectorMultiply(XMLoadFloat4A(&tileY), texelsPerUnitY), halfTexel);
+				const XMVECTOR floorX = XMVectorFloor(texelX);
+				const XMVECTOR floorY = XMVectorFloor(texelY);
+				const XMVECTOR fx = XMVectorSubtract(texelX, floorX);
+				const XMVECTOR fy = XMVectorSubtract(texelY, floorY);
+
+				XMFLOAT4A x0, x1, y0, y1;
+				XMStoreFloat4A(&x0, XMVectorClamp(floorX, XMVectorZero(), XMVectorSplatX(maxTexel)));
+				XMStoreFloat4A(&x1, XMVectorClamp(XMVectorAdd(floorX, g_XMOne), XMVectorZero(), XMVectorSplatX(maxTexel)));
+				XMStoreFloat4A(&y0, XMVectorClamp(floorY, XMVectorZero(), XMVectorSplatY(maxTexel)));
+				XMStoreFloat4A(&y1, XMVectorClamp(XMVectorAdd(floorY, g_XMOne), XMVectorZero(), XMVectorSplatY(maxTexel)));
+
+				XMFLOAT4A h00(0.0f, 0.0f, 0.0f, 0.0f), h10(0.0f, 0.0f, 0.0f, 0.0f), h01(0.0f, 0.0f, 0.0f, 0.0f), h11(0.0f, 0.0f, 0.0f, 0.0f);
+				for (int lane = 0; lane < lanesCount; lane++)
+				{
+					if (tileIndices[lane] < 0)
+						continue;
+
+					const unsigned short* rawHeights = mHeightMaps[tileIndices[lane]]->mRawHeights;
+					const int row0 = static_cast<int>((&y0.x)[lane]) * width;
+					const int row1 = static_cast<int>((&y1.x)[lane]) * width;
+					const int column0 = static_cast<int>((&x0.x)[lane]);
+					const int column1 = static_cast<int>((&x1.x)[lane]);
+					(&h00.x)[lane] = rawHeights[row0 + column0];
+					(&h10.x)[lane] = rawHeights[row0 + column1];
+					(&h01.x)[lane] = rawHeights[row1 + column0];
+					(&h11.x)[lane] = rawHeights[row1 + column1];
+				}
+
+				const XMVECTOR top = XMVectorLerpV(XMLoadFloat4A(&h00), XMLoadFloat4A(&h10), fx);
+				const XMVECTOR bottom = XMVectorLerpV(XMLoadFloat4A(&h01), XMLoadFloat4A(&h11), fx);
+				XMFLOAT4A heights;
+				XMStoreFloat4A(&heights, XMVectorSubtract(XMVectorMultiply(XMVectorLerpV(top, bottom, fy), heightScale), heightDelta));
+
+				for (int lane = 0; lane < lanesCount; lane++)
+				{
+					XMFLOAT4& position = positions[first + lane];
+					const int tileIndex = tileIndices[lane];
+					if (tileIndex < 0)
+					{
+						position.y = TERRAIN_INVALID_HEIGHT; //culled
+						continue;
+					}
+
+					bool isOnSplatChannel = true;
+					if (splatChannel >= 0)
+					{
+						const float u = (&tileX.x)[lane] / tileSize;
+						const float v = 1.0f - (&tileY.x)[lane] / tileSize;
+						isOnSplatChannel = mHeightMaps[tileIndex]->SampleSplatmap(u, v, splatChannel) > 0.2f; // same threshold as in IsOnSplatMap()
+					}
+					position.y = isOnSplatChannel ? (&heights.x)[lane] : TERRAIN_INVALID_HEIGHT; //culled
+				}
+			}
+		};
+
+		const UINT batchesCount = static_cast<UINT>((positionsCount + batchSize - 1) / batchSize);
+		if (aJobSystem && batchesCount > 1)
+		{
+			ER_JobCounter counter;
+			aJobSystem->ParallelFor(batchesCount, 1, placeBatch, &counter);
+			aJobSystem->Wait(counter);
+		}
+		else
+		{
+			for (UINT i = 0; i < batchesCount; i++)
+				placeBatch(i);
+		}
+	}
+
 	// Read-back (GPU to CPU) new positions from placement compute pass
 	// WARNING: we are doing that in a current frame and waiting when GPU is finished => this produces a stall
 	// Ideally we should do that in async (on modern APIs) or read back on CPU in the next frame
@@ -1151,21 +1765,61 @@ namespace EveryRay_Core
 		rhi->EndEventTag();
 	}
 
-	HeightMap::HeightMap(int width, int height)
+	HeightMap::HeightMap(int width, int height) : mWidth(width), mHeight(height)
 	{
-		mData = new MapData[width * height];
-		mVertexList = new Vertex[(width - 1) * (height - 1) * 6];
 	}
 
 	HeightMap::~HeightMap()
 	{		
-		DeleteObject(mVertexBufferTS);
 		DeleteObject(mVertexBufferNonTS);
-		DeleteObject(mIndexBufferNonTS);
 		DeleteObject(mSplatTexture);
 		DeleteObject(mHeightTexture);
-		DeleteObjects(mVertexList);
-		DeleteObjects(mData);
 		DeleteObject(mDebugGizmoAABB);
+		UnmapRawHeights();
+	}
+
+	bool HeightMap::MapRawHeights(const std::wstring& aPath)
+	{
+		UnmapRawHeights();
+
+		mRawHeightsFile = CreateFileW(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (mRawHeightsFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(mRawHeightsFile, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(mWidth) * mHeight * static_cast<LONGLONG>(sizeof(unsigned short)))
+		{
+			UnmapRawHeights();
+			return false;
+		}
+
+		mRawHeightsMapping = CreateFileMappingW(mRawHeightsFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mRawHeightsMapping)
+		{
+			UnmapRawHeights();
+			return false;
+		}
+
+		mRawHeights = static_cast<const unsigned short*>(MapViewOfFile(mRawHeightsMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!mRawHeights)
+		{
+			UnmapRawHeights();
+			return false;
+		}
+		return true;
+	}
+
+	void HeightMap::UnmapRawHeights()
+	{
+		if (mRawHeights)
+			UnmapViewOfFile(mRawHeights);
+		if (mRawHeightsMapping)
+			CloseHandle(mRawHeightsMapping);
+		if (mRawHeightsFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mRawHeightsFile);
+
+		mRawHeights = nullptr;
+		mRawHeightsMapping = nullptr;
+		mRawHeightsFile = INVALID_HANDLE_VALUE;
 	}
 }
\ No newline at end of file
@@ -5,9 +5,12 @@
 #include "RHI/ER_RHI.h"
 
 #define NUM_THREADS_PER_TERRAIN_SIDE 4
-#define NUM_TERRAIN_PATCHES_PER_TILE 8
+#define NUM_TERRAIN_PATCHES_PER_TILE 8 // per side, at the finest level of the tile's quadtree
+#define TERRAIN_QUADTREE_MAX_LEVEL 3 // log2(NUM_TERRAIN_PATCHES_PER_TILE), level 0 is the whole tile
 #define NUM_TEXTURE_SPLAT_CHANNELS 4
-#define MAX_TERRAIN_TILE_COUNT 64
+#define MAX_TERRAIN_TILE_COUNT 256 // same as in PlaceObjectsOnTerrain.hlsl
+#define TERRAIN_INVALID_HEIGHT -999.0f // same as "culled" points in PlaceObjectsOnTerrain.hlsl
+#define TERRAIN_MIN_LOD_DISTANCE_FACTOR 1.5f // > sqrt(2) keeps the neighbouring quadtree nodes within one LOD level from each other
 
 namespace EveryRay_Core 
 {
@@ -26,6 +29,8 @@ namespace EveryRay_Core
 	class ER_LightProbesManager;
 	class ER_RenderableAABB;
 	class ER_Camera;
+	class ER_Frustum;
+	class ER_JobSystem;
 
 	struct /*ER_ALIGN_GPU_BUFFER*/ TerrainTileDataGPU
 	{
@@ -34,6 +39,46 @@ namespace EveryRay_Core
 		XMFLOAT4 AABBMaxPoint;
 	};
 
+	// Vertex of the tessellated terrain: one selected quadtree node (patch)
+	struct TerrainPatchGPU
+	{
+		XMFLOAT4 PatchInfo; // xy - origin in the tile, zw - size
+		XMFLOAT4 TileInfo; // x - tile index, y - edge flags (TerrainPatchEdgeFlags), zw - world offset of the tile (XZ)
+	};
+
+	// Per edge (in the quad domain order: -X, -Z, +X, +Z), same as in Terrain.hlsl
+	enum TerrainPatchEdgeFlags
+	{
+		TERRAIN_PATCH_EDGE_COARSER_NEIGHBOUR = 1 << 0,
+		TERRAIN_PATCH_EDGE_FINER_NEIGHBOUR = 1 << 4
+	};
+
+	struct TerrainTileDrawRange
+	{
+		int TileIndex;
+		UINT FirstPatch;
+		UINT PatchCount;
+	};
+
+	struct TerrainDrawStats
+	{
+		UINT VisitedNodes = 0;
+		UINT CulledNodes = 0;
+		UINT Patches = 0;
+		UINT Draws = 0;
+		UINT PatchesPerLevel[TERRAIN_QUADTREE_MAX_LEVEL + 1] = {};
+	};
+
+	// Patches of all the visible tiles for one camera, grouped by tile (one draw per tile)
+	struct TerrainDrawList
+	{
+		std::vector<TerrainPatchGPU> Patches;
+		std::vector<TerrainTileDrawRange> Tiles;
+		TerrainDrawStats Stats;
+
+		void Clear() { Patches.clear(); Tiles.clear(); Stats = TerrainDrawStats(); }
+	};
+
 	enum TerrainSplatChannels {
 		CHANNEL_0 = 0,
 		CHANNEL_1 = 1,
@@ -42,12 +87,20 @@ namespace EveryRay_Core
 		NONE = 4
 	};
 
+	enum TerrainHeightSampling
+	{
+		TERRAIN_HEIGHT_SAMPLING_HEIGHTMAP, // bilinear sampling of the heightmap with the GPU height scale (same as PlaceObjectsOnTerrain.hlsl)
+		TERRAIN_HEIGHT_SAMPLING_MESH // interpolation on the triangles of the CPU (non-tessellated) mesh (same as HeightMap::FindHeightFromPosition)
+	};
+
 	enum TerrainRenderPass
 	{
 		TERRAIN_GBUFFER,
 		TERRAIN_FORWARD,
 		TERRAIN_SHADOW,
-		TERRAIN_LIGHTPROBE
+		TERRAIN_LIGHTPROBE,
+
+		TERRAIN_RENDER_PASS_COUNT
 	};
 
 	namespace TerrainCBufferData {
@@ -56,7 +109,6 @@ namespace EveryRay_Core
 		};
 
 		struct ER_ALIGN_GPU_BUFFER TerrainCB {
-			XMMATRIX TerrainTileWorld[MAX_TERRAIN_TILE_COUNT];
 			XMMATRIX ShadowMatrices[NUM_SHADOW_CASCADES];
 			XMMATRIX View;
 			XMMATRIX Projection;
@@ -92,28 +144,41 @@ namespace EveryRay_Core
 
 	class HeightMap
 	{
-		struct MapData
-		{
-			float x, y, z;
-		};
-
-		struct Vertex {
-			float x, y, z;
-		};
-
 	public:
 		bool GetHeightFromTriangle(float x, float z, float v0[3], float v1[3], float v2[3], float normal[3], float& height);
 		bool RayIntersectsTriangle(float x, float z, float v0[3], float v1[3], float v2[3], float normals[3], float& height);
-		float FindHeightFromPosition(float x, float z);
-		bool PerformCPUFrustumCulling(ER_Camera* camera);
-		bool IsCulled() { return mIsCulled; }
-		bool IsColliding(const XMFLOAT4& position, bool onlyXZCheck = false);
+		float FindHeightFromPosition(float x, float z); // brute-force (all triangles), use ER_Terrain::GetHeight() instead
+		bool FindHeightFromGrid(float x, float z, float& height) const;
+		float SampleHeightmap(float u, float v) const;
+		float SampleSplatmap(float u, float v, int channel) const;
+		bool IsColliding(const XMFLOAT4& position, bool onlyXZCheck = false) const;
+
+		bool MapRawHeights(const std::wstring& aPath);
+		void UnmapRawHeights();
+		// CPU (non-tessellated) terrain vertex, computed from the raw height
+		XMFLOAT3 GetVertexPosition(int i, int j) const
+		{
+			return XMFLOAT3(mOrigin.x + i * mCellSize, static_cast<float>(mRawHeights[mWidth * j + i]) / mHeightScaleCPU, mOrigin.y + j * mCellSize);
+		}
 
 		HeightMap(int width, int height);
 		~HeightMap();
 
-		Vertex* mVertexList = nullptr;
-		MapData* mData = nullptr;
+		const unsigned short* mRawHeights = nullptr; // memory-mapped 16-bit RAW heightmap (same texels as in mHeightTexture)
+		HANDLE mRawHeightsFile = INVALID_HANDLE_VALUE;
+		HANDLE mRawHeightsMapping = nullptr;
+		XMFLOAT2 mOrigin = XMFLOAT2(0.0, 0.0); // XZ of the (0, 0) vertex
+		float mCellSize = 1.0f;
+		float mHeightScaleCPU = 1.0f;
+		std::vector<unsigned char> mRawSplat; // RGBA8 copy of mSplatTexture (for CPU placement)
+		int mSplatWidth = 0;
+		int mSplatHeight = 0;
+		// normalized (raw) min/max heights of the quadtree nodes (level by level, row by row), used for per-node culling
+		std::vector<unsigned short> mQuadTreeMinHeights;
+		std::vector<unsigned short> mQuadTreeMaxHeights;
+
+		int mWidth = 0;
+		int mHeight = 0;
 
 		ER_RHI_GPUTexture* mSplatTexture = nullptr;
 		ER_RHI_GPUTexture* mHeightTexture = nullptr;
@@ -123,15 +188,10 @@ namespace EveryRay_Core
 
 		XMFLOAT2 mTileUVOffset = XMFLOAT2(0.0, 0.0);
 
-		ER_RHI_GPUBuffer* mVertexBufferTS = nullptr;
 		XMMATRIX mWorldMatrixTS = XMMatrixIdentity();
 
-		ER_RHI_GPUBuffer* mVertexBufferNonTS = nullptr;
+		ER_RHI_GPUBuffer* mVertexBufferNonTS = nullptr; // one vertex per texel, indexed with ER_Terrain's shared grid index buffer
 		int mVertexCountNonTS = 0; //not used in GPU tessellated terrain
-		ER_RHI_GPUBuffer* mIndexBufferNonTS = nullptr;
-		int mIndexCountNonTS = 0; //not used in GPU tessellated terrain
-
-		bool mIsCulled = false;
 	};
 
 	class ER_Terrain : public ER_CoreComponent
@@ -145,8 +205,10 @@ namespace EveryRay_Core
 		UINT GetWidth() { return mWidth; }
 		UINT GetHeight() { return mHeight; }
 
-		void Draw(TerrainRenderPass aPass, const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr,
+		void Draw(TerrainRenderPass aPass, ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr,
 			ER_ShadowMapper* worldShadowMapper = nullptr, ER_LightProbesManager* probeManager = nullptr, int shadowMapCascade = -1, ER_Camera* aCustomCamera = nullptr, bool skipCulling = false);
+		// Draw() creates the pass's PSO on the first use; call it on the main thread before Draw() is recorded in parallel (PSOs can not be created in recording contexts)
+		void PreparePSO(TerrainRenderPass aPass, ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_ShadowMapper* worldShadowMapper = nullptr, int shadowMapCascade = -1);
 		void DrawDebugGizmos(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs);
 		void Update(const ER_CoreTime& gameTime);
 		void Config() { mShowDebug = !mShowDebug; }
@@ -158,10 +220,33 @@ namespace EveryRay_Core
 		void SetDynamicTessellationDistanceFactor(float factor) { mTessellationDistanceFactor = factor; }
 		void SetTessellationFactorDynamic(int factor) { mTessellationFactorDynamic = factor; }
 		void SetTerrainHeightScale(float scale) { mTerrainTessellatedHeightScale = scale; }
+		void SetLODDistanceFactor(float factor) { mLODDistanceFactor = std::max(factor, TERRAIN_MIN_LOD_DISTANCE_FACTOR); }
 		HeightMap* GetHeightmap(int index) { return mHeightMaps.at(index); }
+
+		// Selects the visible quadtree nodes of all tiles (hierarchical culling if aFrustum is provided) with LOD levels based on the XZ distance to aLODOrigin.
+		// Neighbouring nodes differ by one level at most (see mLODDistanceFactor), their edge flags are set for crack-free tessellation.
+		void SelectPatches(const XMFLOAT3& aLODOrigin, const ER_Frustum* aFrustum, TerrainDrawList& aOutDrawList) const;
+		const TerrainDrawStats& GetDrawStats(TerrainRenderPass aPass) const { return mDrawStats[aPass]; }
+
+		// CPU height queries without GPU round-trips: the tile and its grid cell are found directly from the world XZ position
+		int GetTileIndex(float x, float z) const;
+		bool GetHeight(float x, float z, float& aOutHeight, TerrainHeightSampling aSampling = TERRAIN_HEIGHT_SAMPLING_HEIGHTMAP) const;
+		// Weight of the splat channel at the world XZ position (from the CPU copy of the splat map, 1.0 if it is missing; 0.0 outside of the terrain)
+		float GetSplatDensity(float x, float z, int aSplatChannel) const;
+		// Batch version (TERRAIN_INVALID_HEIGHT for positions outside of the terrain), split into jobs if aJobSystem is provided
+		void GetHeights(const XMFLOAT4* aPositions, float* aOutHeights, int aPositionsCount, TerrainHeightSampling aSampling = TERRAIN_HEIGHT_SAMPLING_HEIGHTMAP,
+			ER_JobSystem* aJobSystem = nullptr) const;
 		void PlaceOnTerrain(ER_RHI_GPUBuffer* outputBuffer, ER_RHI_GPUBuffer* inputBuffer, XMFLOAT4* positions, int positionsCount,
 			TerrainSplatChannels splatCh = TerrainSplatChannels::NONE,	XMFLOAT4* terrainVertices = nullptr, int terrainVertexCount = 0, float customDampDelta = FLT_MAX, bool needsCPUReadback = true);
 		void ReadbackPlacedPositions(ER_RHI_GPUBuffer* outputBuffer, ER_RHI_GPUBuffer* inputBuffer, XMFLOAT4* positions, int positionsCount);
+		// Same as PlaceOnTerrain() but on the CPU: positions are ready right after the call (no dispatches, readbacks or deferred events)
+		void PlaceOnTerrainCPU(XMFLOAT4* positions, int positionsCount, TerrainSplatChannels splatCh = TerrainSplatChannels::NONE, float customDampDelta = FLT_MAX,
+			ER_JobSystem* aJobSystem = nullptr) const;
+		bool IsCPUPlacementEnabled() const { return mUseCPUPlacement && mLoaded; }
+		void SetCPUPlacement(bool value) { mUseCPUPlacement = value; }
+		// Validate/measure the CPU height queries and placement of the loaded terrain (see ER_Tests)
+		bool RunHeightQueryTests();
+		void BenchmarkHeightQueries();
 		//float GetHeightScale(bool tessellated) { if (tessellated) return mTerrainTessellatedHeightScale; else return mTerrainNonTessellatedHeightScale; }
 
 		void SetEnabled(bool val) { mEnabled = val; }
@@ -172,14 +257,22 @@ namespace EveryRay_Core
 		ER_GenericEvent<Delegate_ReadbackPlacedPositions>* ReadbackPlacedPositionsOnInitEvent = new ER_GenericEvent<Delegate_ReadbackPlacedPositions>();
 		ER_GenericEvent<Delegate_ReadbackPlacedPositions>* ReadbackPlacedPositionsOnUpdateEvent = new ER_GenericEvent<Delegate_ReadbackPlacedPositions>();
 	private:
-		void LoadTile(int threadIndex, const std::wstring& path);
-		void CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath);
+		bool LoadTile(int tileIndex, const std::wstring& path);
+		bool CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath);
+		void CreateTerrainTilesIndexBufferNonTS();
 		void CreateTerrainTileDataGPU(int tileIndexX, int tileIndexY);
 		void LoadTextures(const std::wstring& aTexturesPath, const std::wstring& splatLayer0Path, const std::wstring& splatLayer1Path,	const std::wstring& splatLayer2Path, const std::wstring& splatLayer3Path);
 		void LoadSplatmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path);
+		void LoadSplatmapPerTileCPU(int tileIndexX, int tileIndexY, const std::wstring& path);
 		void LoadHeightmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path);
-		void DrawTessellated(TerrainRenderPass aPass, const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, int tileIndex,
-			ER_ShadowMapper* worldShadowMapper = nullptr, ER_LightProbesManager* probeManager = nullptr, int shadowMapCascade = -1, bool skipCulling = false);
+		void DrawTessellated(TerrainRenderPass aPass, ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, int tileIndex,
+			UINT firstPatch, UINT patchCount, ER_ShadowMapper* worldShadowMapper = nullptr, ER_LightProbesManager* probeManager = nullptr, int shadowMapCascade = -1);
+		UINT UploadPatches(const TerrainDrawList& aDrawList);
+		ER_RHI_PSO_HANDLE GetPassPSO(TerrainRenderPass aPass) const;
+
+		void BuildQuadTree(HeightMap* aHeightMap);
+		void SelectQuadTreeNode(int aTileIndex, int aLevel, int aI, int aJ, const XMFLOAT3& aLODOrigin, const ER_Frustum* aFrustum, TerrainDrawList& aOutDrawList) const;
+		bool IsQuadTreeNodeSplit(int aLevel, int aX, int aZ, const XMFLOAT3& aLODOrigin) const; // global node coordinates (X grows with world X, Z with world Z)
 
 		ER_DirectionalLight& mDirectionalLight;
 
@@ -196,24 +289,40 @@ namespace EveryRay_Core
 		ER_RHI_GPUShader* mPS = nullptr;
 		std::string mTerrainMainPassPSOName = "ER_RHI_GPUPipelineStateObject: Terrain - Main Pass";
 		std::string mTerrainMainPassWireframePSOName = "ER_RHI_GPUPipelineStateObject: Terrain - Main (Wireframe) Pass";
+		ER_RHI_PSO_HANDLE mTerrainMainPassPSO = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mTerrainMainPassWireframePSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUShader* mPS_LightProbe = nullptr;
 		std::string mTerrainLightProbePassPSOName = "ER_RHI_GPUPipelineStateObject: Terrain - Light Probe Pass";
+		ER_RHI_PSO_HANDLE mTerrainLightProbePassPSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUShader* mDS_ShadowMap = nullptr;
 		ER_RHI_GPUShader* mPS_ShadowMap = nullptr;
 		std::string mTerrainShadowPassPSOName = "ER_RHI_GPUPipelineStateObject: Terrain - Shadow Pass";
+		ER_RHI_PSO_HANDLE mTerrainShadowPassPSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUShader* mPS_GBuffer = nullptr;
 		std::string mTerrainGBufferPassPSOName = "ER_RHI_GPUPipelineStateObject: Terrain - GBuffer Pass";
 		std::string mTerrainGBufferPassWireframePSOName = "ER_RHI_GPUPipelineStateObject: Terrain - GBuffer (Wireframe) Pass";
+		ER_RHI_PSO_HANDLE mTerrainGBufferPassPSO = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mTerrainGBufferPassWireframePSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUShader* mPlaceOnTerrainCS = nullptr;
 		std::string mTerrainPlacementPassPSOName = "ER_RHI_GPUPipelineStateObject: Terrain - Placement Pass";
+		ER_RHI_PSO_HANDLE mTerrainPlacementPassPSO = ER_RHI_INVALID_PSO_HANDLE;
 		ER_RHI_GPURootSignature* mTerrainPlacementPassRS = nullptr;
 		ER_RHI_GPURootSignature* mTerrainCommonPassRS = nullptr;
 
 		ER_RHI_GPUBuffer* mTerrainTilesDataGPU = nullptr;
+		ER_RHI_GPUBuffer* mPatchesBufferTS = nullptr; // dynamic, draw lists of all the passes of a frame are appended to it
+		UINT mPatchesBufferCapacity = 0;
+		UINT mPatchesBufferOffset = 0;
+		UINT mPatchesBufferFrameIndex = std::numeric_limits<UINT>::max();
+		TerrainDrawList mDrawLists[1 + NUM_SHADOW_CASCADES]; // one per shadow cascade (they can be recorded in parallel, see ER_ShadowMapper::Draw()) + one for the other passes
+		TerrainDrawStats mDrawStats[TERRAIN_RENDER_PASS_COUNT]; // of the last frame (shadow cascades are summed)
+		std::mutex mDrawMutex; // constant buffers, patches buffer and stats are shared by the parallel Draw() calls
+		ER_RHI_GPUBuffer* mTerrainTilesIndexBufferNonTS = nullptr; // shared by all tiles (same grid)
+		int mTerrainTilesIndexCountNonTS = 0; //not used in GPU tessellated terrain
 		ER_RHI_GPUTexture* mTerrainTilesHeightmapsArrayTexture = nullptr;
 		ER_RHI_GPUTexture* mTerrainTilesSplatmapsArrayTexture = nullptr;
 
@@ -237,7 +346,9 @@ namespace EveryRay_Core
 		int mTessellationFactor = 4;
 		int mTessellationFactorDynamic = 64;
 		float mTessellationDistanceFactor = 0.015f;
+		float mLODDistanceFactor = 2.0f; // quadtree node is split if it is closer than its size * factor
 		float mPlacementHeightDelta = 0.5f; // how much we want to damp the point on terrain
+		bool mUseCPUPlacement = true; // callers use PlaceOnTerrainCPU() instead of the GPU placement pass (no readback stalls)
 
 		bool mDrawDebugAABBs = false;
 		bool mDoCPUFrustumCulling = true;
@@ -0,0 +1,100 @@
+#include "ER_Tests.h"
+#include "ER_Core.h"
+#include "ER_Sandbox.h"
+#include "ER_Scene.h"
+#include "ER_Utility.h"
+#include "ER_Terrain.h"
+#include "ER_LightProbesManager.h"
+#include "ER_JobSystem.h"
+#include "ER_CPUProfiler.h"
+#include "ER_ConcurrentCache.h"
+#include "ER_FrustumCulling.h"
+#include "ER_FoliageCells.h"
+#include "ER_Placement.h"
+#include "ER_LightProbesGrid.h"
+#include "ER_LightProbesResidencyCache.h"
+#include "ER_LightProbesVolumeFile.h"
+#include "ER_SphericalHarmonics.h"
+#include "ER_BakedScene.h"
+#include "ER_MeshOptimizer.h"
+#include "ER_MeshCache.h"
+#include "RHI\ER_RHI_PSORegistry.h"
+#include "RHI\ER_RHI_Span.h"
+#include "RHI\ER_RHI_RecordingContext.h"
+#include "RHI\Null\ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	int ER_Tests::Run(ER_JobSystem* aJobSystem)
+	{
+		assert(aJobSystem);
+
+		int failedCount = 0;
+		failedCount += ER_JobSystem::RunTests() ? 0 : 1;
+		failedCount += ER_CPUProfiler::RunTests() ? 0 : 1;
+		failedCount += ER_ConcurrentCacheTests::RunTests(aJobSystem) ? 0 : 1;
+		failedCount += ER_BakedScene::RunTests() ? 0 : 1;
+		failedCount += ER_FrustumCulling::RunTests() ? 0 : 1;
+		failedCount += ER_FoliageCells::RunTests() ? 0 : 1;
+		failedCount += ER_MeshOptimizer::RunTests() ? 0 : 1;
+		failedCount += ER_Placement::RunTests(aJobSystem) ? 0 : 1;
+		failedCount += ER_LightProbesGrid::RunTests(aJobSystem) ? 0 : 1;
+		failedCount += ER_LightProbesResidencyCache::RunTests() ? 0 : 1;
+		failedCount += ER_LightProbesVolumeFile::RunTests() ? 0 : 1;
+		failedCount += ER_SphericalHarmonics::RunTests(aJobSystem) ? 0 : 1;
+		failedCount += ER_RHI_PSORegistry::RunTests() ? 0 : 1;
+		failedCount += ER_RHI_AllocationsCounter::RunTests() ? 0 : 1;
+		failedCount += ER_RHI_Null::RunTests() ? 0 : 1;
+		failedCount += ER_RHI_RecordingContext::RunTests() ? 0 : 1;
+
+		std::wstring msg = L"[ER Logger][ER_Tests] " + std::to_wstring(failedCount) + L" test suites FAILED!\n";
+		if (failedCount == 0)
+			msg = L"[ER Logger][ER_Tests] All test suites passed\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		return failedCount;
+	}
+
+	void ER_Tests::RunBenchmarks(ER_JobSystem* aJobSystem)
+	{
+		assert(aJobSystem);
+
+		ER_JobSystem::Benchmark();
+		ER_FrustumCulling::Benchmark();
+		ER_ConcurrentCacheTests::Benchmark();
+		ER_Placement::Benchmark(aJobSystem);
+		ER_LightProbesGrid::Benchmark(aJobSystem);
+		ER_SphericalHarmonics::Benchmark(aJobSystem);
+		ER_RHI_PSORegistry::Benchmark();
+		ER_RHI_AllocationsCounter::Benchmark();
+		ER_RHI_Null::Benchmark();
+
+		for (const char* sceneName : { "sponzaScene", "terrainScene" })
+			ER_Scene::BenchmarkLoad(ER_Utility::GetFilePath("content\\levels\\" + std::string(sceneName) + "\\" + sceneName + ".json"));
+	}
+
+	int ER_Tests::RunScene(ER_Core& aCore)
+	{
+		int failedCount = 0;
+		failedCount += ER_MeshCache::RunTests(aCore) ? 0 : 1;
+
+		ER_Sandbox* level = aCore.GetLevel();
+		if (!level)
+			return failedCount + 1;
+
+		if (level->mTerrain && level->mTerrain->IsLoaded())
+			failedCount += level->mTerrain->RunHeightQueryTests() ? 0 : 1;
+		return failedCount;
+	}
+
+	void ER_Tests::RunSceneBenchmarks(ER_Core& aCore)
+	{
+		ER_Sandbox* level = aCore.GetLevel();
+		if (!level)
+			return;
+
+		if (level->mTerrain && level->mTerrain->IsLoaded())
+			level->mTerrain->BenchmarkHeightQueries();
+		if (level->mLightProbesManager && level->mLightProbesManager->IsEnabled())
+			level->mLightProbesManager->BenchmarkVolumeLoad();
+	}
+}
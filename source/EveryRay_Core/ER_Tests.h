@@ -0,0 +1,25 @@
+#pragma once
+#include "Common.h"
+
+namespace EveryRay_Core
+{
+	class ER_Core;
+	class ER_JobSystem;
+
+	// Entry points of the test target (EveryRay_Tests_Win64_*): self-checks and benchmarks of the engine systems, nothing has to be enabled in the headers.
+	// Standalone suites only need a job system, scene suites need the core (and most of them a loaded level, see ER_RuntimeCore::RunTests()).
+	// Tests return the number of failed suites, benchmarks only log their timings.
+	class ER_Tests
+	{
+	public:
+		static int Run(ER_JobSystem* aJobSystem);
+		static void RunBenchmarks(ER_JobSystem* aJobSystem);
+
+		static int RunScene(ER_Core& aCore);
+		static void RunSceneBenchmarks(ER_Core& aCore);
+	private:
+		ER_Tests();
+		ER_Tests(const ER_Tests& rhs);
+		ER_Tests& operator=(const ER_Tests& rhs);
+	};
+}
@@ -16,6 +16,7 @@ namespace EveryRay_Core
 	bool ER_Utility::IsPostEffectsVolumeEditor = false;
 	bool ER_Utility::IsMainCameraCPUCulling = true;
 	bool ER_Utility::IsMainCameraGPUCulling = true;
+	ER_FrustumCullingMode ER_Utility::MainCameraCPUCullingMode = ER_FrustumCulling::GetBestMode();
 
 	bool ER_Utility::StopDrawingRenderingObjects = false;
 	bool ER_Utility::IsWireframe = false;
@@ -6,6 +6,7 @@
 #include "ER_MatrixHelper.h"
 #include "ER_ColorHelper.h"
 #include "ER_MaterialHelper.h"
+#include "ER_FrustumCulling.h"
 
 static float clearColorBlack[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 static float clearColorWhite[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -43,6 +44,7 @@ namespace EveryRay_Core
 
 		static bool IsMainCameraCPUCulling;
 		static bool IsMainCameraGPUCulling;
+		static ER_FrustumCullingMode MainCameraCPUCullingMode;
 		static bool StopDrawingRenderingObjects;
 		static bool IsWireframe;
 		static float DistancesLOD[MAX_LOD];
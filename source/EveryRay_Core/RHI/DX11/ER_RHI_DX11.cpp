@@ -439,6 +439,8 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX11::GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture)
 	{
+		const std::lock_guard<std::recursive_mutex> lock(mResourceCreationMutex);
+
 		assert(aTexture);
 		ID3D11ShaderResourceView* pShaderResourceView = static_cast<ID3D11ShaderResourceView*>(aTexture->GetSRV());
 		assert(pShaderResourceView);
@@ -451,6 +453,7 @@ namespace EveryRay_Core
 		HRESULT hr = mSwapChain->Present(0, 0);
 		if (FAILED(hr))
 			throw ER_CoreException("ER_RHI_DX11: IDXGISwapChain::Present() failed.", hr);
+		mPresentedFramesCount++;
 	}
 
 	bool ER_RHI_DX11::ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB)
@@ -490,7 +493,7 @@ namespace EveryRay_Core
 		mDirect3DDeviceContext->OMSetRenderTargets(1, &mMainRenderTargetView, NULL);
 	}
 
-	void ER_RHI_DX11::SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
+	void ER_RHI_DX11::SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
 	{
 		if (!aUAV)
 		{
@@ -613,7 +616,7 @@ namespace EveryRay_Core
 		mDirect3DDeviceContext->RSSetScissorRects(1, &currentRect);
 	}
 
-	void ER_RHI_DX11::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot,
+	void ER_RHI_DX11::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		assert(aSRVs.size() > 0);
@@ -655,7 +658,7 @@ namespace EveryRay_Core
 		}
 	}
 
-	void ER_RHI_DX11::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot,
+	void ER_RHI_DX11::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		assert(aUAVs.size() > 0);
@@ -691,7 +694,7 @@ namespace EveryRay_Core
 		}
 	}
 
-	void ER_RHI_DX11::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot,
+	void ER_RHI_DX11::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS)
 	{
 		assert(aCBs.size() > 0);
@@ -780,7 +783,7 @@ namespace EveryRay_Core
 		}
 	}
 
-	void ER_RHI_DX11::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot, ER_RHI_GPURootSignature* rs)
+	void ER_RHI_DX11::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot, ER_RHI_GPURootSignature* rs)
 	{
 		assert(aSamplers.size() > 0);
 		assert(aSamplers.size() <= DX11_MAX_BOUND_SAMPLERS);
@@ -840,7 +843,7 @@ namespace EveryRay_Core
 		mDirect3DDeviceContext->IASetIndexBuffer(buf, GetFormat(aBuffer->GetFormatRhi()), offset);
 	}
 
-	void ER_RHI_DX11::SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers)
+	void ER_RHI_DX11::SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers)
 	{
 		assert(aVertexBuffers.size() > 0 && aVertexBuffers.size() <= ER_RHI_MAX_BOUND_VERTEX_BUFFERS);
 		if (aVertexBuffers.size() == 1)
@@ -964,6 +967,26 @@ namespace EveryRay_Core
 		buffer->Map(this, D3D11_MAP_WRITE_DISCARD, &mappedResource);
 		memcpy(mappedResource.pData, aData, dataSize);
 		buffer->Unmap(this);
+		buffer->SetDiscardFrame(mPresentedFramesCount);
+	}
+
+	// NO_OVERWRITE is only safe after a WRITE_DISCARD in the same frame: before it, the GPU may still be reading the range for the previous frame.
+	// So the first write of a buffer in a frame discards it (the rest of the buffer is undefined then, see ER_RHI::UpdateBufferRange()) and later ones write in place.
+	void ER_RHI_DX11::UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize)
+	{
+		assert(aBuffer->GetSize() >= aOffset + dataSize);
+
+		ER_RHI_DX11_GPUBuffer* buffer = static_cast<ER_RHI_DX11_GPUBuffer*>(aBuffer);
+		assert(buffer);
+
+		const bool isDiscarded = buffer->GetDiscardFrame() == mPresentedFramesCount;
+
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
+		buffer->Map(this, isDiscarded ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD, &mappedResource);
+		memcpy(static_cast<unsigned char*>(mappedResource.pData) + aOffset, aData, dataSize);
+		buffer->Unmap(this);
+		buffer->SetDiscardFrame(mPresentedFramesCount);
 	}
 
 	void ER_RHI_DX11::InitImGui()
@@ -86,9 +86,9 @@ namespace EveryRay_Core
 		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) override;
 
 		virtual void SetMainRenderTargets(int cmdListIndex = 0) override;
-		virtual void SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
 		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) override;
-		virtual void SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override {}; //not supported on DX11
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override {}; //not supported on DX11
 		virtual void SetMainRenderTargetFormats() override {}; //not supported on DX11
 
 		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) override;
@@ -98,13 +98,13 @@ namespace EveryRay_Core
 		virtual void SetViewport(const ER_RHI_Viewport& aViewport) override;
 		virtual void SetRect(const ER_RHI_Rect& rect) override;
 
-		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot = 0,
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot = 0,
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot = 0,
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) override;
-		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
 		
 		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) override {}; //not supported on DX11
 		virtual void SetRootConstant(UINT aConstant, UINT aRootIndex, UINT anOffset = 0, bool isCompute = false) override {}; //not supported on DX11
@@ -113,7 +113,7 @@ namespace EveryRay_Core
 		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) override;
 		virtual void SetEmptyInputLayout() override;
 		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) override;
-		virtual void SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers) override;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) override;
 
 		virtual void SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType) override;
 		virtual ER_RHI_PRIMITIVE_TYPE GetCurrentTopologyType() override;
@@ -121,22 +121,24 @@ namespace EveryRay_Core
 		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) override {}; //not supported on DX11
 		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex) override {}; //not supported on DX11
 
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
 		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) override {}; //not supported on DX11
 
-		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) override { return false; } //not supported on DX11
-		virtual void InitializePSO(const std::string& aName, bool isCompute = false) override {}; //not supported on DX11
-		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) override {}; //not supported on DX11
-		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) override {}; //not supported on DX11
-		virtual void FinalizePSO(const std::string& aName, bool isCompute = false) override {}; //not supported on DX11
-		virtual void SetPSO(const std::string& aName, bool isCompute = false) override {}; //not supported on DX11
+		virtual bool IsPSOReady(ER_RHI_PSO_HANDLE aHandle) override { return false; } //not supported on DX11
+		virtual void InitializePSO(ER_RHI_PSO_HANDLE aHandle) override {}; //not supported on DX11
+		virtual void SetRootSignatureToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_GPURootSignature* rs) override {}; //not supported on DX11
+		virtual void SetTopologyTypeToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_PRIMITIVE_TYPE aType) override {}; //not supported on DX11
+		virtual void FinalizePSO(ER_RHI_PSO_HANDLE aHandle) override {}; //not supported on DX11
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle) override {}; //not supported on DX11
 		virtual void UnsetPSO()override {}; //not supported on DX11
 
 		virtual void UnbindRenderTargets() override;
 		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) override;
 
 		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) override;
+		virtual void UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize) override;
+		virtual int GetDynamicBufferCopiesCount() override { return 1; } // renaming is done by the driver
 		
 		virtual bool IsHardwareRaytracingSupported() override { return false; }
 		virtual bool IsRootConstantSupported()  override { return false; }
@@ -161,7 +163,10 @@ namespace EveryRay_Core
 
 		ID3D11Device1* GetDevice() { return mDirect3DDevice; }
 		ID3D11DeviceContext1* GetContext() { return mDirect3DDeviceContext; }
+		// Textures can be loaded from ER_JobSystem workers (i.e., during scene loading) and their loaders use the immediate context, so we serialize them
+		std::recursive_mutex& GetResourceCreationMutex() { return mResourceCreationMutex; }
 		DXGI_FORMAT GetFormat(ER_RHI_FORMAT aFormat);
+		UINT64 GetPresentedFramesCount() const { return mPresentedFramesCount; }
 
 		ER_GRAPHICS_API GetAPI() { return mAPI; }
 	private:
@@ -176,6 +181,8 @@ namespace EveryRay_Core
 		D3D_FEATURE_LEVEL mFeatureLevel = D3D_FEATURE_LEVEL_11_1;
 		ID3D11Device1* mDirect3DDevice = nullptr;
 		ID3D11DeviceContext1* mDirect3DDeviceContext = nullptr;
+		std::recursive_mutex mResourceCreationMutex;
+		UINT64 mPresentedFramesCount = 0; // dynamic buffers are discarded once per frame, see UpdateBufferRange()
 		IDXGISwapChain1* mSwapChain = nullptr;
 		ID3DUserDefinedAnnotation* mUserDefinedAnnotation = nullptr;
 
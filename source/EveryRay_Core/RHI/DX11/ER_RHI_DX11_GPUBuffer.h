@@ -29,6 +29,8 @@ namespace EveryRay_Core
 		void Unmap(ER_RHI* aRHI);
 		void Update(ER_RHI* aRHI, void* aData, int dataSize);
 		DXGI_FORMAT GetFormat() { return mFormat; }
+		UINT64 GetDiscardFrame() const { return mDiscardFrame; }
+		void SetDiscardFrame(UINT64 aFrame) { mDiscardFrame = aFrame; }
 	private:
 		ID3D11Buffer* mBuffer = nullptr;
 		ID3D11UnorderedAccessView* mBufferUAV = nullptr;
@@ -38,5 +40,6 @@ namespace EveryRay_Core
 		ER_RHI_FORMAT mRHIFormat;
 		UINT mStride;
 		int mByteSize = 0;
+		UINT64 mDiscardFrame = UINT64_MAX; // last frame (ER_RHI_DX11::GetPresentedFramesCount()) in which the buffer was mapped with WRITE_DISCARD
 	};
 }
\ No newline at end of file
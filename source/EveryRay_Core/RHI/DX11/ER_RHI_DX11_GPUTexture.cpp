@@ -334,6 +334,7 @@ namespace EveryRay_Core
 	{
 		assert(aRHI);
 		ER_RHI_DX11* aRHIDX11 = static_cast<ER_RHI_DX11*>(aRHI);
+		const std::lock_guard<std::recursive_mutex> lock(aRHIDX11->GetResourceCreationMutex());
 		ID3D11Device* device = aRHIDX11->GetDevice();
 		assert(device);
 		ID3D11DeviceContext1* context = aRHIDX11->GetContext();
@@ -411,6 +412,39 @@ namespace EveryRay_Core
 		resourceTex->Release();
 	}
 
+	void ER_RHI_DX11_GPUTexture::CreateGPUTextureResourceFromDDSMemory(ER_RHI* aRHI, const void* aData, UINT64 aDataSize, bool* statusFlag, bool isSilent)
+	{
+		assert(aRHI);
+		assert(aData);
+		ER_RHI_DX11* aRHIDX11 = static_cast<ER_RHI_DX11*>(aRHI);
+		const std::lock_guard<std::recursive_mutex> lock(aRHIDX11->GetResourceCreationMutex());
+		ID3D11Device* device = aRHIDX11->GetDevice();
+		assert(device);
+
+		ReleaseObject(mSRV);
+		ReleaseObject(mTexture2D);
+		mIsLoadedFromFile = true;
+
+		ID3D11Resource* resourceTex = NULL;
+		if (FAILED(DirectX::CreateDDSTextureFromMemory(device, static_cast<const uint8_t*>(aData), static_cast<size_t>(aDataSize), &resourceTex, &mSRV)) || !resourceTex)
+		{
+			if (!isSilent)
+			{
+				std::wstring msg = L"[ER Logger][ER_RHI_DX11_GPUTexture] Failed to create texture from DDS data in memory: " + debugName + L"\n";
+				ER_OUTPUT_LOG(msg.c_str());
+			}
+			if (statusFlag)
+				*statusFlag = false;
+			return;
+		}
+
+		bool isLoaded = SUCCEEDED(resourceTex->QueryInterface(IID_ID3D11Texture2D, (void**)&mTexture2D));
+		if (statusFlag)
+			*statusFlag = isLoaded;
+
+		resourceTex->Release();
+	}
+
 	void ER_RHI_DX11_GPUTexture::LoadFallbackTexture(ER_RHI* aRHI, ID3D11Resource** texture, ID3D11ShaderResourceView** textureView)
 	{
 		assert(aRHI);
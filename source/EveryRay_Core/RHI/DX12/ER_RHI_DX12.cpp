@@ -13,6 +13,7 @@ namespace EveryRay_Core
 {
 	static ER_RHI_DX12_DescriptorHandle sNullSRV2DHandle;
 	static ER_RHI_DX12_DescriptorHandle sNullSRV3DHandle;
+	static thread_local ER_RHI_DX12_RecordingContext* sBoundRecordingContext = nullptr; // see BeginRecordingContext()
 	int ER_RHI_DX12::mBackBufferIndex = 0;
 
 	ER_RHI_DX12::ER_RHI_DX12()
@@ -31,6 +32,11 @@ namespace EveryRay_Core
 		DeleteObject(mClearUAV3DCS);
 		DeleteObject(mClearUAV3DRS);
 
+		DeletePointerCollection(mGraphicsPSOs);
+		DeletePointerCollection(mComputePSOs);
+		for (int i = 0; i < ER_RHI_MAX_RECORDING_CONTEXTS; i++)
+			DeleteObject(mRecordingContexts[i]);
+
 		ResetReplacementMippedTexturesPool();
 
 		DeleteObject(mDescriptorHeapManager);
@@ -194,6 +200,30 @@ namespace EveryRay_Core
 				}
 			}
 
+			// recording contexts (see BeginRecordingContext())
+			for (int i = 0; i < ER_RHI_MAX_RECORDING_CONTEXTS; i++)
+			{
+				if (!mRecordingContexts[i])
+					mRecordingContexts[i] = new ER_RHI_DX12_RecordingContext();
+
+				for (int j = 0; j < DX12_MAX_BACK_BUFFER_COUNT; j++)
+				{
+					if (FAILED(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(mRecordingContexts[i]->mCommandAllocators[j].ReleaseAndGetAddressOf()))))
+					{
+						std::string message = "ER_RHI_DX12: Could not create recording context command allocator " + std::to_string(j) + " " + std::to_string(i);
+						throw ER_CoreException(message.c_str());
+					}
+					mRecordingContexts[i]->mCommandAllocatorsFrames[j] = 0;
+				}
+
+				if (FAILED(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, mRecordingContexts[i]->mCommandAllocators[0].Get(), nullptr, IID_PPV_ARGS(mRecordingContexts[i]->mCommandList.ReleaseAndGetAddressOf()))))
+				{
+					std::string message = "ER_RHI_DX12: Could not create recording context command list " + std::to_string(i);
+					throw ER_CoreException(message.c_str());
+				}
+				mRecordingContexts[i]->mCommandList->Close();
+			}
+
 			// fences
 			{
 				// Create a fence for tracking GPU execution progress.
@@ -265,6 +295,11 @@ namespace EveryRay_Core
 
 		ResetDescriptorManager();
 
+		mClearUAV2DPSO = GetPSOHandle(mClearUAV2DPSOName, true);
+		mClearUAV3DPSO = GetPSOHandle(mClearUAV3DPSOName, true);
+		mGenerateMips2DPSO = GetPSOHandle(mGenerateMips2DPSOName, true);
+		mGenerateMips3DPSO = GetPSOHandle(mGenerateMips3DPSOName, true);
+
 		//clear uav state and rs
 		{
 			mClearUAV2DCS = CreateGPUShader();
@@ -305,10 +340,10 @@ namespace EveryRay_Core
 				mGenerateMips2DRS->InitConstant(this, 2, 0, 3);
 				mGenerateMips2DRS->Finalize(this, "ER_RHI_GPURootSignature: Generate Mips 2D");
 
-				InitializePSO(mGenerateMips2DPSOName, true);
-				SetRootSignatureToPSO(mGenerateMips2DPSOName, mGenerateMips2DRS, true);
+				InitializePSO(mGenerateMips2DPSO);
+				SetRootSignatureToPSO(mGenerateMips2DPSO, mGenerateMips2DRS);
 				SetShader(mGenerateMips2DCS);
-				FinalizePSO(mGenerateMips2DPSOName, true);
+				FinalizePSO(mGenerateMips2DPSO);
 			}
 
 			mGenerateMips3DRS = CreateRootSignature(3, 1);
@@ -320,10 +355,10 @@ namespace EveryRay_Core
 				mGenerateMips3DRS->InitConstant(this, 2, 0, 4);
 				mGenerateMips3DRS->Finalize(this, "ER_RHI_GPURootSignature: Generate Mips 3D");
 
-				InitializePSO(mGenerateMips3DPSOName, true);
-				SetRootSignatureToPSO(mGenerateMips3DPSOName, mGenerateMips3DRS, true);
+				InitializePSO(mGenerateMips3DPSO);
+				SetRootSignatureToPSO(mGenerateMips3DPSO, mGenerateMips3DRS);
 				SetShader(mGenerateMips3DCS);
-				FinalizePSO(mGenerateMips3DPSOName, true);
+				FinalizePSO(mGenerateMips3DPSO);
 			}
 		}
 
@@ -431,23 +466,25 @@ namespace EveryRay_Core
 	void ER_RHI_DX12::BeginEventTag(const std::string& aName, bool isComputeQueue)
 	{
 		if (mCurrentGraphicsCommandListIndex >= 0 || mCurrentComputeCommandListIndex >= 0)
-			PIXBeginEvent(isComputeQueue ? mCommandListCompute[mCurrentComputeCommandListIndex].Get() : mCommandListGraphics[mCurrentGraphicsCommandListIndex].Get(), 0, aName.c_str());
+			PIXBeginEvent(isComputeQueue ? mCommandListCompute[mCurrentComputeCommandListIndex].Get() : GetRecordingCommandList(), 0, aName.c_str());
 	}
 
 	void ER_RHI_DX12::EndEventTag(bool isComputeQueue)
 	{
 		if (mCurrentGraphicsCommandListIndex >= 0 || mCurrentComputeCommandListIndex >= 0)
-			PIXEndEvent(isComputeQueue ? mCommandListCompute[mCurrentComputeCommandListIndex].Get() : mCommandListGraphics[mCurrentGraphicsCommandListIndex].Get());
+			PIXEndEvent(isComputeQueue ? mCommandListCompute[mCurrentComputeCommandListIndex].Get() : GetRecordingCommandList());
 	}
 
 	void ER_RHI_DX12::BeginGraphicsCommandList(int index)
 	{
 		assert(index < ER_RHI_MAX_GRAPHICS_COMMAND_LISTS);
 
+		assert(!mIsRecordingInParallel);
+
 		mCurrentGraphicsCommandListIndex = index;
-#if defined(_DEBUG) || defined (DEBUG)
-		mCurrentPSOSwitchesCount = 0;
-#endif
+		// new command list has no pipeline state
+		mMainRecordingState.SetGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		mMainRecordingState.SetComputePSO = ER_RHI_INVALID_PSO_HANDLE;
 		HRESULT hr;
 		if (FAILED(hr = mCommandAllocatorsGraphics[mBackBufferIndex][index]->Reset()))
 		{
@@ -465,6 +502,7 @@ namespace EveryRay_Core
 	void ER_RHI_DX12::EndGraphicsCommandList(int index)
 	{
 		assert(index < ER_RHI_MAX_GRAPHICS_COMMAND_LISTS);
+		assert(!mIsRecordingInParallel);
 		mCurrentGraphicsCommandListIndex = -1;
 
 		HRESULT hr;
@@ -492,18 +530,177 @@ namespace EveryRay_Core
 			throw ER_CoreException("ER_RHI_DX12:: Could not close command list (copy)");
 	}
 
+	void ER_RHI_DX12::BeginParallelRecording()
+	{
+		assert(mCurrentGraphicsCommandListIndex > -1);
+		assert(!mIsRecordingInParallel && !sBoundRecordingContext);
+
+		mIsRecordingInParallel = true;
+		mRecordingContextsCount = 0;
+	}
+
+	void ER_RHI_DX12::BeginRecordingContext(UINT aOrder)
+	{
+		assert(mIsRecordingInParallel);
+		assert(!sBoundRecordingContext);
+
+		const int index = mRecordingContextsCount++;
+		if (index >= ER_RHI_MAX_RECORDING_CONTEXTS)
+			throw ER_CoreException("ER_RHI_DX12: Too many recording contexts in a parallel section! Increase ER_RHI_MAX_RECORDING_CONTEXTS.");
+
+		ER_RHI_DX12_RecordingContext* context = mRecordingContexts[index];
+		HRESULT hr;
+		// the frame's allocator is reset once: the context's list might have been submitted already by a previous parallel section of this frame
+		if (context->mCommandAllocatorsFrames[mBackBufferIndex] != mFrameIndex)
+		{
+			if (FAILED(hr = context->mCommandAllocators[mBackBufferIndex]->Reset()))
+			{
+				std::string message = "ER_RHI_DX12:: Could not Reset() command allocator (recording context) " + std::to_string(index);
+				throw ER_CoreException(message.c_str());
+			}
+			context->mCommandAllocatorsFrames[mBackBufferIndex] = mFrameIndex;
+		}
+
+		if (FAILED(hr = context->mCommandList->Reset(context->mCommandAllocators[mBackBufferIndex].Get(), nullptr)))
+		{
+			std::string message = "ER_RHI_DX12:: Could not Reset() command list (recording context) " + std::to_string(index);
+			throw ER_CoreException(message.c_str());
+		}
+
+		context->Begin(aOrder, &mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)->GetAllocator());
+		context->mState.Inherit(mMainRecordingState);
+
+		sBoundRecordingContext = context;
+		ApplyRecordingState(context->mCommandList.Get(), context->mState);
+	}
+
+	void ER_RHI_DX12::EndRecordingContext()
+	{
+		assert(sBoundRecordingContext && sBoundRecordingContext->IsRecording());
+		sBoundRecordingContext->End();
+		sBoundRecordingContext = nullptr;
+	}
+
+	void ER_RHI_DX12::EndParallelRecording()
+	{
+		assert(mIsRecordingInParallel && !sBoundRecordingContext);
+		mIsRecordingInParallel = false;
+
+		const int count = mRecordingContextsCount;
+		mRecordingContextsCount = 0;
+		if (count == 0)
+			return;
+
+		ER_RHI_InlineArray<ER_RHI_RecordingContext*, ER_RHI_MAX_RECORDING_CONTEXTS> contexts;
+		for (int i = 0; i < count; i++)
+			contexts.push_back(mRecordingContexts[i]);
+		if (!ER_RHI_RecordingContext::SortForSubmission(contexts.data(), contexts.size()))
+			throw ER_CoreException("ER_RHI_DX12: Two recording contexts of a parallel section have the same order!");
+
+		ID3D12GraphicsCommandList* mainCommandList = mCommandListGraphics[mCurrentGraphicsCommandListIndex].Get();
+		ER_RHI_RecordingContext::ResolveResourceStates(contexts, [&](int aListIndex, ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aBefore, ER_RHI_RESOURCE_STATE aAfter)
+		{
+			ID3D12GraphicsCommandList* commandList = aListIndex < 0 ? mainCommandList : static_cast<ER_RHI_DX12_RecordingContext*>(contexts[aListIndex])->mCommandList.Get();
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResource->GetResource()), GetState(aBefore), GetState(aAfter), D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+			commandList->ResourceBarrier(1, &barrier);
+		});
+
+		// main list (with the commands before the parallel section) + contexts in order, in one submission
+		ER_RHI_InlineArray<ID3D12CommandList*, ER_RHI_MAX_RECORDING_CONTEXTS + 1> commandLists;
+		HRESULT hr;
+		if (FAILED(hr = mainCommandList->Close()))
+			throw ER_CoreException("ER_RHI_DX12:: Could not close command list (graphics) before submitting recording contexts");
+		commandLists.push_back(mainCommandList);
+		for (UINT i = 0; i < contexts.size(); i++)
+		{
+			ER_RHI_DX12_RecordingContext* context = static_cast<ER_RHI_DX12_RecordingContext*>(contexts[i]);
+			if (FAILED(hr = context->mCommandList->Close()))
+				throw ER_CoreException("ER_RHI_DX12:: Could not close command list (recording context)");
+			commandLists.push_back(context->mCommandList.Get());
+
+			const ER_RHI_PSOStats& stats = context->GetPSOStats();
+			mPSOStats.sets += stats.sets;
+			mPSOStats.switches += stats.switches;
+			mPSOStats.redundantSets += stats.redundantSets;
+		}
+		mCommandQueueGraphics->ExecuteCommandLists(commandLists.size(), commandLists.data());
+
+		// continue recording on the main list: its allocator is not reset, the submitted commands stay valid
+		if (FAILED(hr = mainCommandList->Reset(mCommandAllocatorsGraphics[mBackBufferIndex][mCurrentGraphicsCommandListIndex].Get(), nullptr)))
+			throw ER_CoreException("ER_RHI_DX12:: Could not Reset() command list (graphics) after submitting recording contexts");
+
+		mMainRecordingState.SetGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		mMainRecordingState.SetComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+		mMainRecordingState.PSOState = ER_RHI_DX12_PSO_STATE::UNSET;
+		mMainRecordingState.IsInstancedBufferBound = false;
+		ApplyRecordingState(mainCommandList, mMainRecordingState);
+	}
+
+	ER_RHI_DX12_RecordingState& ER_RHI_DX12::GetRecordingState()
+	{
+		return sBoundRecordingContext ? sBoundRecordingContext->mState : mMainRecordingState;
+	}
+
+	ID3D12GraphicsCommandList* ER_RHI_DX12::GetRecordingCommandList(int aMainCommandListIndex)
+	{
+		// not checking mIsRecordingInParallel: loading jobs record into the main list on workers (under mResourceCreationMutex)
+		if (sBoundRecordingContext)
+			return sBoundRecordingContext->mCommandList.Get();
+
+		assert(aMainCommandListIndex > -1);
+		return mCommandListGraphics[aMainCommandListIndex].Get();
+	}
+
+	ER_RHI_DX12_DescriptorHandle ER_RHI_DX12::GetRecordingDescriptorsBlock(UINT aCount)
+	{
+		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		if (!sBoundRecordingContext)
+			return gpuDescriptorHeap->GetHandleBlock(aCount);
+
+		UINT index = 0;
+		if (!sBoundRecordingContext->AllocateDescriptors(aCount, index))
+			throw ER_CoreException("ER_RHI_DX12: Ran out of GPU descriptor heap handles, need to increase heap size");
+		return gpuDescriptorHeap->GetHandle(index);
+	}
+
+	void ER_RHI_DX12::ApplyRecordingState(ID3D12GraphicsCommandList* aCommandList, const ER_RHI_DX12_RecordingState& aState)
+	{
+		ID3D12DescriptorHeap* ppHeaps[] = { mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)->GetHeap() };
+		aCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+		if (aState.Viewport.Width > 0.0f)
+		{
+			D3D12_VIEWPORT viewport;
+			viewport.TopLeftX = aState.Viewport.TopLeftX;
+			viewport.TopLeftY = aState.Viewport.TopLeftY;
+			viewport.Width = aState.Viewport.Width;
+			viewport.Height = aState.Viewport.Height;
+			viewport.MinDepth = aState.Viewport.MinDepth;
+			viewport.MaxDepth = aState.Viewport.MaxDepth;
+			aCommandList->RSSetViewports(1, &viewport);
+		}
+
+		if (aState.Rect.right > aState.Rect.left)
+		{
+			D3D12_RECT rect = { aState.Rect.left, aState.Rect.top, aState.Rect.right, aState.Rect.bottom };
+			aCommandList->RSSetScissorRects(1, &rect);
+		}
+
+		aCommandList->IASetPrimitiveTopology(GetTopology(aState.Topology));
+	}
+
 	void ER_RHI_DX12::ClearMainRenderTarget(float colors[4])
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(mMainRenderTarget[mBackBufferIndex].Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ResourceBarrier(1, &barrier);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ClearRenderTargetView(GetMainRenderTargetView(), colors, 0, nullptr);
+		GetRecordingCommandList()->ResourceBarrier(1, &barrier);
+		GetRecordingCommandList()->ClearRenderTargetView(GetMainRenderTargetView(), colors, 0, nullptr);
 	}
 
 	void ER_RHI_DX12::ClearMainDepthStencilTarget(float depth, UINT stencil /*= 0*/)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ClearDepthStencilView(GetMainDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, depth, stencil, 0, nullptr);
+		GetRecordingCommandList()->ClearDepthStencilView(GetMainDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, depth, stencil, 0, nullptr);
 	}
 
 	void ER_RHI_DX12::ClearRenderTarget(ER_RHI_GPUTexture* aRenderTarget, float colors[4], int rtvArrayIndex)
@@ -514,12 +711,12 @@ namespace EveryRay_Core
 		if (rtvArrayIndex > 0)
 		{
 			ER_RHI_DX12_DescriptorHandle& handle = static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTarget)->GetRTVHandle(rtvArrayIndex);
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ClearRenderTargetView(handle.GetCPUHandle(), colors, 0, nullptr);
+			GetRecordingCommandList()->ClearRenderTargetView(handle.GetCPUHandle(), colors, 0, nullptr);
 		}
 		else
 		{
 			ER_RHI_DX12_DescriptorHandle& handle = static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTarget)->GetRTVHandle();
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ClearRenderTargetView(handle.GetCPUHandle(), colors, 0, nullptr);
+			GetRecordingCommandList()->ClearRenderTargetView(handle.GetCPUHandle(), colors, 0, nullptr);
 		}
 	}
 
@@ -530,7 +727,7 @@ namespace EveryRay_Core
 		ER_RHI_DX12_GPUTexture* dtDX12 = static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget);
 		assert(dtDX12);
 		TransitionResources({ aDepthTarget }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ClearDepthStencilView(dtDX12->GetDSVHandle().GetCPUHandle(), (stencil == -1) ? D3D12_CLEAR_FLAG_DEPTH : D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, depth, stencil, 0, nullptr);
+		GetRecordingCommandList()->ClearDepthStencilView(dtDX12->GetDSVHandle().GetCPUHandle(), (stencil == -1) ? D3D12_CLEAR_FLAG_DEPTH : D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, depth, stencil, 0, nullptr);
 	}
 
 	// Two versions are available (shader and command). Shader is the default one at the moment
@@ -548,20 +745,20 @@ namespace EveryRay_Core
 		TransitionResources({ aRenderTarget }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_UNORDERED_ACCESS, mCurrentGraphicsCommandListIndex);
 
 		#pragma region SHADER_CLEAR
-		auto cmdList = mCommandListGraphics[mCurrentGraphicsCommandListIndex];
+		auto cmdList = GetRecordingCommandList();
 
-		const std::string psoName = is3D ? mClearUAV3DPSOName : mClearUAV2DPSOName;
+		const ER_RHI_PSO_HANDLE pso = is3D ? mClearUAV3DPSO : mClearUAV2DPSO;
 		ER_RHI_GPURootSignature* rs = is3D ? mClearUAV3DRS : mClearUAV2DRS;
 
 		SetRootSignature(rs, true);
-		if (!IsPSOReady(psoName, true))
+		if (!IsPSOReady(pso))
 		{
-			InitializePSO(psoName, true);
-			SetRootSignatureToPSO(psoName, rs, true);
+			InitializePSO(pso);
+			SetRootSignatureToPSO(pso, rs);
 			SetShader(is3D ? mClearUAV3DCS : mClearUAV2DCS);
-			FinalizePSO(psoName, true);
+			FinalizePSO(pso);
 		}
-		SetPSO(psoName, true);
+		SetPSO(pso);
 
 		int mipCount = uavDX12->GetMips();
 		UINT srcWidth = uavDX12->GetWidth();
@@ -679,7 +876,7 @@ namespace EveryRay_Core
 			{ ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_DEST, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_SOURCE }, isInCopyQueue ? 0 : cmdListIndex, isInCopyQueue);
 
 		if (!isInCopyQueue)
-			mCommandListGraphics[cmdListIndex]->CopyResource(static_cast<ID3D12Resource*>(dstResource->GetResource()), static_cast<ID3D12Resource*>(srcResource->GetResource()));
+			GetRecordingCommandList(cmdListIndex)->CopyResource(static_cast<ID3D12Resource*>(dstResource->GetResource()), static_cast<ID3D12Resource*>(srcResource->GetResource()));
 		else
 			mCommandListCopy->CopyResource(static_cast<ID3D12Resource*>(dstResource->GetResource()), static_cast<ID3D12Resource*>(srcResource->GetResource()));
 		
@@ -737,7 +934,7 @@ namespace EveryRay_Core
 		srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 		srcLocation.SubresourceIndex = SrcSubresource;
 		
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->CopyTextureRegion(&dstLocation, DstX, DstY, DstZ, &srcLocation, NULL);
+		GetRecordingCommandList()->CopyTextureRegion(&dstLocation, DstX, DstY, DstZ, &srcLocation, NULL);
 		//else if (dstbuffer->GetTexture3D() && srcbuffer->GetTexture3D())
 		//else
 		//	throw ER_CoreException("ER_RHI_DX12:: One of the resources is NULL during CopyGPUTextureSubresourceRegion()");
@@ -753,14 +950,14 @@ namespace EveryRay_Core
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 		assert(VertexCount > 0);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->DrawInstanced(VertexCount, 1, 0, 0);
+		GetRecordingCommandList()->DrawInstanced(VertexCount, 1, 0, 0);
 	}
 
 	void ER_RHI_DX12::DrawIndexed(UINT IndexCount)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 		assert(IndexCount > 0);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->DrawIndexedInstanced(IndexCount, 1, 0, 0, 0);
+		GetRecordingCommandList()->DrawIndexedInstanced(IndexCount, 1, 0, 0, 0);
 	}
 
 	void ER_RHI_DX12::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
@@ -769,7 +966,7 @@ namespace EveryRay_Core
 		assert(InstanceCount > 0);
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+		GetRecordingCommandList()->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
 	}
 
 	void ER_RHI_DX12::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
@@ -778,7 +975,7 @@ namespace EveryRay_Core
 		assert(IndexCountPerInstance > 0);
 		assert(InstanceCount > 0);
 
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+		GetRecordingCommandList()->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 	}
 
 	void ER_RHI_DX12::DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* anArgsBuffer, UINT alignedByteOffset)
@@ -788,13 +985,13 @@ namespace EveryRay_Core
 
 		TransitionResources({ anArgsBuffer }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_INDIRECT_ARGUMENT);
 
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ExecuteIndirect(mCommandSignature_DrawIndexed.Get(), 1, static_cast<ID3D12Resource*>(anArgsBuffer->GetResource()), alignedByteOffset, nullptr, 0);
+		GetRecordingCommandList()->ExecuteIndirect(mCommandSignature_DrawIndexed.Get(), 1, static_cast<ID3D12Resource*>(anArgsBuffer->GetResource()), alignedByteOffset, nullptr, 0);
 	}
 
 	void ER_RHI_DX12::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+		GetRecordingCommandList()->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
 	}
 
 	void ER_RHI_DX12::ExecuteCommandLists(int commandListIndex /*= 0*/, bool isCompute /*= false*/)
@@ -817,6 +1014,8 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX12::GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture)
 	{
+		const std::lock_guard<std::recursive_mutex> lock(mResourceCreationMutex);
+
 		if ((aTexture->GetWidth() != aTexture->GetHeight()) /*|| !(ER_IsPowerOfTwo(aTexture->GetWidth()) && ER_IsPowerOfTwo(aTexture->GetHeight()))*/)
 			return; //TODO add support
 
@@ -836,20 +1035,20 @@ namespace EveryRay_Core
 		UINT mipCount = (aTexture->GetMips() > 1) ? aTexture->GetMips() : aTexture->GetCalculatedMipCount();
 		assert(mipCount > 1);
 
-		auto cmdList = mCommandListGraphics[mCurrentGraphicsCommandListIndex];
+		auto cmdList = GetRecordingCommandList();
 
-		const std::string& psoName = is3D ? mGenerateMips3DPSOName : mGenerateMips2DPSOName;
+		const ER_RHI_PSO_HANDLE pso = is3D ? mGenerateMips3DPSO : mGenerateMips2DPSO;
 		ER_RHI_GPURootSignature* rs = is3D ? mGenerateMips3DRS : mGenerateMips2DRS;
 
 		SetRootSignature(rs, true);
-		if (!IsPSOReady(psoName, true))
+		if (!IsPSOReady(pso))
 		{
-			InitializePSO(psoName, true);
-			SetRootSignatureToPSO(psoName, rs, true);
+			InitializePSO(pso);
+			SetRootSignatureToPSO(pso, rs);
 			SetShader(is3D ? mGenerateMips3DCS : mGenerateMips2DCS);
-			FinalizePSO(psoName, true);
+			FinalizePSO(pso);
 		}
-		SetPSO(psoName, true);
+		SetPSO(pso);
 
 		//transition first mip to non-pixel shader resource (because we will read from it) and all other mips to unordered access
 		std::vector< CD3DX12_RESOURCE_BARRIER> barriers;
@@ -896,6 +1095,8 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX12::GenerateMipsWithTextureReplacement(ER_RHI_GPUTexture** aTexture, std::function<void(ER_RHI_GPUTexture**)> aReplacementCallback)
 	{
+		const std::lock_guard<std::recursive_mutex> lock(mResourceCreationMutex);
+
 		if ((*aTexture)->GetMips() > 1) //probably the texture already has mips
 			return;
 
@@ -972,6 +1173,7 @@ namespace EveryRay_Core
 
 			// Set the fence value for the next frame.
 			mFenceValuesGraphics[mBackBufferIndex] = currentFenceValue + 1;
+			mFrameIndex++;
 
 			if (!mDXGIFactory->IsCurrent())
 			{
@@ -1006,10 +1208,10 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX12::SetMainRenderTargets(int cmdListIndex)
 	{
-		mCommandListGraphics[cmdListIndex]->OMSetRenderTargets(1, &GetMainRenderTargetView(), false, &GetMainDepthStencilView());
+		GetRecordingCommandList(cmdListIndex)->OMSetRenderTargets(1, &GetMainRenderTargetView(), false, &GetMainDepthStencilView());
 	}
 
-	void ER_RHI_DX12::SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
+	void ER_RHI_DX12::SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 		if (!aUAV)
@@ -1022,7 +1224,7 @@ namespace EveryRay_Core
 
 			D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[DX12_MAX_BOUND_RENDER_TARGETS_VIEWS] = {};
 			UINT rtCount = static_cast<UINT>(aRenderTargets.size());
-			std::vector<ER_RHI_GPUResource*> resources(rtCount);
+			ER_RHI_InlineArray<ER_RHI_GPUResource*, DX12_MAX_BOUND_RENDER_TARGETS_VIEWS + 1> resources(rtCount);
 			for (UINT i = 0; i < rtCount; i++)
 			{
 				assert(aRenderTargets[i]);
@@ -1038,19 +1240,17 @@ namespace EveryRay_Core
 			{
 				D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget)->GetDSVHandle().GetCPUHandle();
 
-				std::vector<ER_RHI_RESOURCE_STATE> transitions(rtCount);
-				for (UINT i = 0; i < rtCount; i++)
-					transitions[i] = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET;
+				ER_RHI_InlineArray<ER_RHI_RESOURCE_STATE, DX12_MAX_BOUND_RENDER_TARGETS_VIEWS + 1> transitions(rtCount, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET);
 
 				resources.push_back(static_cast<ER_RHI_GPUResource*>(aDepthTarget));
 				transitions.push_back(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE);
 				TransitionResources(resources, transitions);
-				mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(rtCount, rtvHandles, FALSE, &dsvHandle);
+				GetRecordingCommandList()->OMSetRenderTargets(rtCount, rtvHandles, FALSE, &dsvHandle);
 			}
 			else
 			{
 				TransitionResources(resources, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET);
-				mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(rtCount, rtvHandles, FALSE, NULL);
+				GetRecordingCommandList()->OMSetRenderTargets(rtCount, rtvHandles, FALSE, NULL);
 			}
 
 		}
@@ -1069,47 +1269,52 @@ namespace EveryRay_Core
 		D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget)->GetDSVHandle().GetCPUHandle();
 		TransitionResources({ static_cast<ER_RHI_GPUResource*>(aDepthTarget) }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE);
 
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(0, nullptr, FALSE, &dsvHandle);
+		GetRecordingCommandList()->OMSetRenderTargets(0, nullptr, FALSE, &dsvHandle);
 	}
 
-	void ER_RHI_DX12::SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/)
+	void ER_RHI_DX12::SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/)
 	{
-		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::COMPUTE)
+		const ER_RHI_DX12_PSO_STATE psoState = GetRecordingState().PSOState;
+		if (psoState == ER_RHI_DX12_PSO_STATE::COMPUTE)
 			return;
 
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(psoState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
-		ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+		ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
 		int rtCount = static_cast<int>(aRenderTargets.size());
-		assert(rtCount <= 8);
+		assert(rtCount <= DX12_MAX_BOUND_RENDER_TARGETS_VIEWS);
 
-		std::vector<DXGI_FORMAT> formats;
+		DXGI_FORMAT formats[DX12_MAX_BOUND_RENDER_TARGETS_VIEWS] = {};
 		for (int i = 0; i < rtCount; i++)
-			formats.push_back(static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTargets[i])->GetFormat());
-		pso.SetRenderTargetFormats(rtCount, rtCount > 0 ? &formats[0] : nullptr, aDepthTarget ? static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget)->GetFormat() : DXGI_FORMAT_UNKNOWN);
+			formats[i] = static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTargets[i])->GetFormat();
+		pso.SetRenderTargetFormats(rtCount, rtCount > 0 ? formats : nullptr, aDepthTarget ? static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget)->GetFormat() : DXGI_FORMAT_UNKNOWN);
 	}
 
 	void ER_RHI_DX12::SetMainRenderTargetFormats()
 	{
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(GetRecordingState().PSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
-		ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+		ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
 		pso.SetRenderTargetFormats(1, &mMainRTBufferFormat, mMainDepthBufferFormat);
 	}
 
 	void ER_RHI_DX12::SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef)
 	{
-		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::UNSET)
+		ER_RHI_DX12_RecordingState& state = GetRecordingState();
+		if (state.PSOState == ER_RHI_DX12_PSO_STATE::UNSET)
 			return;
 
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(state.PSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
 		auto it = mDepthStates.find(aDS);
 		if (it != mDepthStates.end())
 		{
-			mCurrentDS = aDS;
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
-			pso.SetDepthStencilState(it->second);
+			state.DepthStencilState = aDS;
+			if (!sBoundRecordingContext) // PSOs are finalized before recording in parallel, their descriptions are shared between the threads
+			{
+				ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
+				pso.SetDepthStencilState(it->second);
+			}
 		}
 		else
 			throw ER_CoreException("ER_RHI_DX11: DepthStencil state is not found.");
@@ -1117,17 +1322,21 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX12::SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4], UINT SampleMask)
 	{
-		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::UNSET)
+		ER_RHI_DX12_RecordingState& state = GetRecordingState();
+		if (state.PSOState == ER_RHI_DX12_PSO_STATE::UNSET)
 			return;
 
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(state.PSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
 		auto it = mBlendStates.find(aBS);
 		if (it != mBlendStates.end())
 		{
-			mCurrentBS = aBS;
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
-			pso.SetBlendState(it->second);
+			state.BlendState = aBS;
+			if (!sBoundRecordingContext)
+			{
+				ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
+				pso.SetBlendState(it->second);
+			}
 		}
 		else
 			throw ER_CoreException("ER_RHI_DX11: Blend state is not found.");
@@ -1135,17 +1344,21 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX12::SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS)
 	{
-		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::UNSET)
+		ER_RHI_DX12_RecordingState& state = GetRecordingState();
+		if (state.PSOState == ER_RHI_DX12_PSO_STATE::UNSET)
 			return;
 
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(state.PSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
 		auto it = mRasterizerStates.find(aRS);
 		if (it != mRasterizerStates.end())
 		{
-			mCurrentRS = aRS;
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
-			pso.SetRasterizerState(it->second);
+			state.RasterizerState = aRS;
+			if (!sBoundRecordingContext)
+			{
+				ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
+				pso.SetRasterizerState(it->second);
+			}
 		}
 		else
 			throw ER_CoreException("ER_RHI_DX11: Rasterizer state is not found.");
@@ -1161,26 +1374,27 @@ namespace EveryRay_Core
 		viewport.MinDepth = aViewport.MinDepth;
 		viewport.MaxDepth = aViewport.MaxDepth;
 
-		mCurrentViewport = aViewport;
+		GetRecordingState().Viewport = aViewport;
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->RSSetViewports(1, &viewport);
+		GetRecordingCommandList()->RSSetViewports(1, &viewport);
 	}
 
 	void ER_RHI_DX12::SetRect(const ER_RHI_Rect& rect)
 	{
-		mCurrentRect = rect;
+		GetRecordingState().Rect = rect;
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
 		D3D12_RECT currentRect = { rect.left, rect.top, rect.right, rect.bottom };
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->RSSetScissorRects(1, &currentRect);
+		GetRecordingCommandList()->RSSetScissorRects(1, &currentRect);
 	}
 
 	void ER_RHI_DX12::SetShader(ER_RHI_GPUShader* aShader)
 	{
 		assert(aShader);
 
-		assert(mCurrentPSOState != ER_RHI_DX12_PSO_STATE::UNSET);
+		const ER_RHI_DX12_PSO_STATE psoState = GetRecordingState().PSOState;
+		assert(psoState != ER_RHI_DX12_PSO_STATE::UNSET);
 
 		ER_RHI_DX12_GPUShader* aDX12_Shader = static_cast<ER_RHI_DX12_GPUShader*>(aShader);
 		assert(aDX12_Shader);
@@ -1188,9 +1402,9 @@ namespace EveryRay_Core
 		ID3DBlob* blob = static_cast<ID3DBlob*>(aDX12_Shader->GetShaderObject());
 		assert(blob);
 
-		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS)
+		if (psoState == ER_RHI_DX12_PSO_STATE::GRAPHICS)
 		{
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+			ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
 
 			switch (aShader->mShaderType)
 			{
@@ -1213,12 +1427,12 @@ namespace EveryRay_Core
 		}
 		else
 		{
-			ER_RHI_DX12_ComputePSO& pso = mComputePSONames.at(mCurrentComputePSOName);
+			ER_RHI_DX12_ComputePSO& pso = GetCurrentComputePSO();
 			pso.SetComputeShader(blob->GetBufferPointer(), blob->GetBufferSize());
 		}
 	}
 
-	void ER_RHI_DX12::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot /*= 0*/,
+	void ER_RHI_DX12::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot /*= 0*/,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		int srvCount = static_cast<int>(aSRVs.size());
@@ -1230,7 +1444,7 @@ namespace EveryRay_Core
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
 		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		ER_RHI_DX12_DescriptorHandle& srvHandle = gpuDescriptorHeap->GetHandleBlock(srvCount);
+		ER_RHI_DX12_DescriptorHandle srvHandle = GetRecordingDescriptorsBlock(srvCount);
 		for (int i = 0; i < srvCount; i++)
 		{
 			if (aSRVs[i])
@@ -1249,14 +1463,14 @@ namespace EveryRay_Core
 			TransitionResources(aSRVs, aShaderType == ER_RHI_SHADER_TYPE::ER_PIXEL ? ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE : ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mCurrentGraphicsCommandListIndex);
 
 		if (!isComputeRS)
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootDescriptorTable(rootParamIndex, srvHandle.GetGPUHandle());
+			GetRecordingCommandList()->SetGraphicsRootDescriptorTable(rootParamIndex, srvHandle.GetGPUHandle());
 		else
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRootDescriptorTable(rootParamIndex, srvHandle.GetGPUHandle());
+			GetRecordingCommandList()->SetComputeRootDescriptorTable(rootParamIndex, srvHandle.GetGPUHandle());
 
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot /*= 0*/,
+	void ER_RHI_DX12::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot /*= 0*/,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		int uavCount = static_cast<int>(aUAVs.size());
@@ -1268,7 +1482,7 @@ namespace EveryRay_Core
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
 		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		ER_RHI_DX12_DescriptorHandle& uavHandle = gpuDescriptorHeap->GetHandleBlock(uavCount);
+		ER_RHI_DX12_DescriptorHandle uavHandle = GetRecordingDescriptorsBlock(uavCount);
 		for (int i = 0; i < uavCount; i++)
 		{
 			assert(aUAVs[i]);
@@ -1282,14 +1496,14 @@ namespace EveryRay_Core
 			TransitionResources(aUAVs, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_UNORDERED_ACCESS, mCurrentGraphicsCommandListIndex);
 
 		if (!isComputeRS)
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootDescriptorTable(rootParamIndex, uavHandle.GetGPUHandle());
+			GetRecordingCommandList()->SetGraphicsRootDescriptorTable(rootParamIndex, uavHandle.GetGPUHandle());
 		else
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRootDescriptorTable(rootParamIndex, uavHandle.GetGPUHandle());
+			GetRecordingCommandList()->SetComputeRootDescriptorTable(rootParamIndex, uavHandle.GetGPUHandle());
 
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot /*= 0*/,
+	void ER_RHI_DX12::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot /*= 0*/,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS)
 	{
 		int cbvCount = static_cast<int>(aCBs.size());
@@ -1301,7 +1515,7 @@ namespace EveryRay_Core
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
 		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		ER_RHI_DX12_DescriptorHandle& cbvHandle = gpuDescriptorHeap->GetHandleBlock(cbvCount);
+		ER_RHI_DX12_DescriptorHandle cbvHandle = GetRecordingDescriptorsBlock(cbvCount);
 		for (int i = 0; i < cbvCount; i++)
 		{
 			assert(aCBs[i]);
@@ -1309,14 +1523,14 @@ namespace EveryRay_Core
 		}
 
 		if (!isComputeRS)
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootDescriptorTable(rootParamIndex, cbvHandle.GetGPUHandle());
+			GetRecordingCommandList()->SetGraphicsRootDescriptorTable(rootParamIndex, cbvHandle.GetGPUHandle());
 		else
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRootDescriptorTable(rootParamIndex, cbvHandle.GetGPUHandle());
+			GetRecordingCommandList()->SetComputeRootDescriptorTable(rootParamIndex, cbvHandle.GetGPUHandle());
 
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot /*= 0*/, ER_RHI_GPURootSignature* rs)
+	void ER_RHI_DX12::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot /*= 0*/, ER_RHI_GPURootSignature* rs)
 	{
 		//assert(rs);
 		//assert(rs->GetStaticSamplersCount() == aSamplers.size()); // we can do better checks (compare samplers), but thats ok for now
@@ -1326,10 +1540,10 @@ namespace EveryRay_Core
 
 	void ER_RHI_DX12::SetInputLayout(ER_RHI_InputLayout* aIL)
 	{
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(GetRecordingState().PSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 		assert(aIL);
 
-		ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+		ER_RHI_DX12_GraphicsPSO& pso = GetCurrentGraphicsPSO();
 		pso.SetInputLayout(this, aIL->mInputElementDescriptionCount, aIL->mInputElementDescriptions);
 	}
 
@@ -1347,10 +1561,10 @@ namespace EveryRay_Core
 		assert(buf);
 
 		D3D12_INDEX_BUFFER_VIEW view = buf->GetIndexBufferView();
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetIndexBuffer(&view);
+		GetRecordingCommandList()->IASetIndexBuffer(&view);
 	}
 
-	void ER_RHI_DX12::SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers)
+	void ER_RHI_DX12::SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
@@ -1363,11 +1577,12 @@ namespace EveryRay_Core
 			assert(buffer);
 
 			D3D12_VERTEX_BUFFER_VIEW view = buffer->GetVertexBufferView();
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetVertexBuffers(0, 1, &view);
-			if (mIsInstancedBufferBound)
+			GetRecordingCommandList()->IASetVertexBuffers(0, 1, &view);
+			ER_RHI_DX12_RecordingState& state = GetRecordingState();
+			if (state.IsInstancedBufferBound)
 			{
-				mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetVertexBuffers(1, 1, nullptr);
-				mIsInstancedBufferBound = false;
+				GetRecordingCommandList()->IASetVertexBuffers(1, 1, nullptr);
+				state.IsInstancedBufferBound = false;
 			}
 		}
 		else //+ instance buffer
@@ -1383,16 +1598,17 @@ namespace EveryRay_Core
 			assert(instanceBuffer);
 
 			D3D12_VERTEX_BUFFER_VIEW views[2] = { vertexBuffer->GetVertexBufferView(), instanceBuffer->GetVertexBufferView() };
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetVertexBuffers(0, 2, views);
+			GetRecordingCommandList()->IASetVertexBuffers(0, 2, views);
 
-			mIsInstancedBufferBound = true;
+			GetRecordingState().IsInstancedBufferBound = true;
 		}
 	}
 
 	void ER_RHI_DX12::SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetPrimitiveTopology(GetTopology(aType));
+		GetRecordingState().Topology = aType;
+		GetRecordingCommandList()->IASetPrimitiveTopology(GetTopology(aType));
 	}
 
 	void ER_RHI_DX12::SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute)
@@ -1400,9 +1616,9 @@ namespace EveryRay_Core
 		assert(rs);
 		assert(mCurrentGraphicsCommandListIndex > -1);
 		if (!isCompute)
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootSignature(static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature());
+			GetRecordingCommandList()->SetGraphicsRootSignature(static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature());
 		else
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRootSignature(static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature());
+			GetRecordingCommandList()->SetComputeRootSignature(static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature());
 
 		//TODO compute queue
 	}
@@ -1410,33 +1626,34 @@ namespace EveryRay_Core
 	void ER_RHI_DX12::SetRootConstant(UINT aConstant, UINT aRootIndex, UINT anOffset, bool isCompute)
 	{
 		if (!isCompute)
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRoot32BitConstant(aRootIndex, aConstant, anOffset);
+			GetRecordingCommandList()->SetGraphicsRoot32BitConstant(aRootIndex, aConstant, anOffset);
 		else
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRoot32BitConstant(aRootIndex, aConstant, anOffset);
+			GetRecordingCommandList()->SetComputeRoot32BitConstant(aRootIndex, aConstant, anOffset);
 
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType)
+	void ER_RHI_DX12::SetTopologyTypeToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_PRIMITIVE_TYPE aType)
 	{
-		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::UNSET)
+		const ER_RHI_DX12_RecordingState& state = GetRecordingState();
+		if (state.PSOState == ER_RHI_DX12_PSO_STATE::UNSET)
 			return;
 
-		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
-		assert(mCurrentGraphicsPSOName == aName);
-		mGraphicsPSONames.at(aName).SetPrimitiveTopologyType(GetTopologyType(aType));
+		assert(state.PSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
+		assert(state.GraphicsPSO == aHandle);
+		GetCurrentGraphicsPSO().SetPrimitiveTopologyType(GetTopologyType(aType));
 	}
 
 	ER_RHI_PRIMITIVE_TYPE ER_RHI_DX12::GetCurrentTopologyType()
 	{
-		//TODO
-		return ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_LINELIST;
+		return GetRecordingState().Topology;
 	}
 
 	void ER_RHI_DX12::SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset)
 	{
 		assert(mDescriptorHeapManager);
 		assert(mCurrentGraphicsCommandListIndex > -1);
+		assert(!sBoundRecordingContext && !mIsRecordingInParallel); // recording contexts use the heap that is set to the main list
 
 		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(GetHeapType(aType));
 		if (aReset)
@@ -1452,204 +1669,195 @@ namespace EveryRay_Core
 		mCommandListGraphics[cmdListIndex]->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 	}
 
-	bool ER_RHI_DX12::IsPSOReady(const std::string& aName, bool isCompute)
+	bool ER_RHI_DX12::IsPSOReady(ER_RHI_PSO_HANDLE aHandle)
 	{
-		if (!isCompute)
-		{
-			auto it = mGraphicsPSONames.find(aName);
-			if (it != mGraphicsPSONames.end())
-				return true;
-			else
-				return false;
-		}
+		assert(mPSORegistry.IsValid(aHandle));
+		if (mPSORegistry.IsCompute(aHandle))
+			return aHandle < static_cast<int>(mComputePSOs.size()) && mComputePSOs[aHandle];
 		else
-		{
-			auto it2 = mComputePSONames.find(aName);
-			if (it2 != mComputePSONames.end())
-				return true;
-			else
-				return false;
-		}
+			return aHandle < static_cast<int>(mGraphicsPSOs.size()) && mGraphicsPSOs[aHandle];
 	}
 
-	void ER_RHI_DX12::InitializePSO(const std::string& aName, bool isCompute)
+	void ER_RHI_DX12::InitializePSO(ER_RHI_PSO_HANDLE aHandle)
 	{
-		if (isCompute)
+		assert(mPSORegistry.IsValid(aHandle));
+		assert(!sBoundRecordingContext && !mIsRecordingInParallel); // PSO arrays are read by recording contexts: create PSOs before recording in parallel
+		if (mPSORegistry.IsCompute(aHandle))
 		{
-			mComputePSONames.insert(std::make_pair(aName, ER_RHI_DX12_ComputePSO(aName)));
-			mCurrentComputePSOName = aName;
-			mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
+			if (aHandle >= static_cast<int>(mComputePSOs.size()))
+				mComputePSOs.resize(mPSORegistry.GetHandlesCount(), nullptr);
+			DeleteObject(mComputePSOs[aHandle]);
+			mComputePSOs[aHandle] = new ER_RHI_DX12_ComputePSO(mPSORegistry.GetName(aHandle));
+			mMainRecordingState.ComputePSO = aHandle;
+			mMainRecordingState.PSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
 		}
 		else
 		{
-			mGraphicsPSONames.insert(std::make_pair(aName, ER_RHI_DX12_GraphicsPSO(aName)));
-			mCurrentGraphicsPSOName = aName;
-			mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
+			if (aHandle >= static_cast<int>(mGraphicsPSOs.size()))
+				mGraphicsPSOs.resize(mPSORegistry.GetHandlesCount(), nullptr);
+			DeleteObject(mGraphicsPSOs[aHandle]);
+			mGraphicsPSOs[aHandle] = new ER_RHI_DX12_GraphicsPSO(mPSORegistry.GetName(aHandle));
+			mMainRecordingState.GraphicsPSO = aHandle;
+			mMainRecordingState.PSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
 			SetRasterizerState(ER_RHI_RASTERIZER_STATE::ER_BACK_CULLING); // set default RS to all gfx PSO on init
 		}
 	}
 
-	void ER_RHI_DX12::SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute /*= false*/)
+	void ER_RHI_DX12::SetRootSignatureToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_GPURootSignature* rs)
 	{
 		assert(rs);
 		ER_RHI_DX12_GPURootSignature* rsDX12 = static_cast<ER_RHI_DX12_GPURootSignature*>(rs);
 		assert(rsDX12);
 
-		if (!isCompute)
+		if (!mPSORegistry.IsCompute(aHandle))
 		{
-			assert(mCurrentGraphicsPSOName == aName);
-			mGraphicsPSONames.at(aName).SetRootSignature(*rsDX12);
+			assert(GetRecordingState().GraphicsPSO == aHandle);
+			GetCurrentGraphicsPSO().SetRootSignature(*rsDX12);
 		}
 		else
 		{
-			assert(mCurrentComputePSOName == aName);
-			mComputePSONames.at(aName).SetRootSignature(*rsDX12);
+			assert(GetRecordingState().ComputePSO == aHandle);
+			GetCurrentComputePSO().SetRootSignature(*rsDX12);
 		}
 	}
 
-	void ER_RHI_DX12::FinalizePSO(const std::string& aName, bool isCompute /*= false*/)
+	void ER_RHI_DX12::FinalizePSO(ER_RHI_PSO_HANDLE aHandle)
 	{
-		if (!isCompute)
+		if (!mPSORegistry.IsCompute(aHandle))
 		{
-			assert(mCurrentGraphicsPSOName == aName);
-			mGraphicsPSONames.at(aName).Finalize(mDevice.Get());
+			assert(GetRecordingState().GraphicsPSO == aHandle);
+			GetCurrentGraphicsPSO().Finalize(mDevice.Get());
 		}
 		else
 		{
-			assert(mCurrentComputePSOName == aName);
-			mComputePSONames.at(aName).Finalize(mDevice.Get());
+			assert(GetRecordingState().ComputePSO == aHandle);
+			GetCurrentComputePSO().Finalize(mDevice.Get());
 		}
 	}
 
-	void ER_RHI_DX12::SetPSO(const std::string& aName, bool isCompute)
+	void ER_RHI_DX12::SetPSO(ER_RHI_PSO_HANDLE aHandle)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
-		auto resetPSO = [&](const std::string& name, bool comp)
+		ER_RHI_PSOStats& stats = sBoundRecordingContext ? sBoundRecordingContext->GetPSOStats() : mPSOStats;
+		stats.sets++;
+
+		if (!IsPSOReady(aHandle))
 		{
-			std::wstring msg = L"[ER Logger][ER_RHI_DX12] Could not find PSO to set, adding it now and trying to reset: " + ER_Utility::ToWideString(aName) + L'\n';
+			std::wstring msg = L"[ER Logger][ER_RHI_DX12] Could not find PSO to set, adding it now and trying to reset: " + ER_Utility::ToWideString(mPSORegistry.GetName(aHandle)) + L'\n';
 			ER_OUTPUT_LOG(msg.c_str());
-			InitializePSO(name, comp);
-			SetPSO(name, comp);
-		};
+			InitializePSO(aHandle);
+		}
 
-		if (!isCompute)
-		{
-			auto it = mGraphicsPSONames.find(aName);
-			if (it != mGraphicsPSONames.end())
-			{
-				if (mCurrentGraphicsPSOName == aName && mCurrentSetGraphicsPSOName == aName)
-				{
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
-					return;
-				}
-				else
-				{
-					mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetPipelineState(it->second.GetPipelineStateObject());
-					mCurrentGraphicsPSOName = it->first;
-					mCurrentSetGraphicsPSOName = mCurrentGraphicsPSOName;
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
+		const bool isCompute = mPSORegistry.IsCompute(aHandle);
+		ER_RHI_DX12_RecordingState& state = GetRecordingState();
+		ER_RHI_PSO_HANDLE& currentPSO = isCompute ? state.ComputePSO : state.GraphicsPSO;
+		ER_RHI_PSO_HANDLE& currentSetPSO = isCompute ? state.SetComputePSO : state.SetGraphicsPSO;
+		state.PSOState = isCompute ? ER_RHI_DX12_PSO_STATE::COMPUTE : ER_RHI_DX12_PSO_STATE::GRAPHICS;
 
-#if defined(_DEBUG) || defined (DEBUG)
-					mCurrentPSOSwitchesCount++;
-#endif
-				}
-			}
-			else
-				resetPSO(aName, isCompute);
-		}
-		else
+		if (currentPSO == aHandle && currentSetPSO == aHandle)
 		{
-			auto it = mComputePSONames.find(aName);
-			if (it != mComputePSONames.end())
-			{
-				if (mCurrentComputePSOName == aName && mCurrentSetComputePSOName == aName)
-				{
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
-					return;
-				}
-				{
-					mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetPipelineState(it->second.GetPipelineStateObject());
-					mCurrentComputePSOName = it->first;
-					mCurrentSetComputePSOName = mCurrentComputePSOName;
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
-
-#if defined(_DEBUG) || defined (DEBUG)
-					mCurrentPSOSwitchesCount++;
-#endif
-				}
-			}
-			else
-				resetPSO(aName, isCompute);
+			stats.redundantSets++;
+			return;
 		}
+
+		ID3D12PipelineState* pipelineState = isCompute ? mComputePSOs[aHandle]->GetPipelineStateObject() : mGraphicsPSOs[aHandle]->GetPipelineStateObject();
+		GetRecordingCommandList()->SetPipelineState(pipelineState);
+		currentPSO = aHandle;
+		currentSetPSO = aHandle;
+		stats.switches++;
 	}
 
 	void ER_RHI_DX12::UnsetPSO()
 	{
-		mCurrentPSOState = ER_RHI_DX12_PSO_STATE::UNSET;
-		mCurrentSetGraphicsPSOName = "";
-		mCurrentSetComputePSOName = "";
+		ER_RHI_DX12_RecordingState& state = GetRecordingState();
+		state.PSOState = ER_RHI_DX12_PSO_STATE::UNSET;
+		state.SetGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		state.SetComputePSO = ER_RHI_INVALID_PSO_HANDLE;
 	}
 
-	void ER_RHI_DX12::TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
+	void ER_RHI_DX12::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
 	{
 		int size = static_cast<int>(aResources.size());
-		assert(size > 0 && size == aStates.size());
-		std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+		assert(size > 0 && aResources.size() == aStates.size());
+		ER_RHI_InlineArray<CD3DX12_RESOURCE_BARRIER, DX12_MAX_BOUND_SHADER_RESOURCE_VIEWS> barriers;
+		auto flushBarriers = [&]()
+		{
+			if (barriers.size() > 0)
+			{
+				if (!isCopyQueue)
+					GetRecordingCommandList(cmdListIndex)->ResourceBarrier(barriers.size(), barriers.data());
+				else
+					mCommandListCopy->ResourceBarrier(barriers.size(), barriers.data());
+				barriers.clear();
+			}
+		};
 
 		for (int i = 0; i < size; i++)
 		{
-			if (aStates[i] == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE &&
-				aResources[i]->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
-				continue;
-
-			if (aResources[i] && aResources[i]->GetCurrentState() != aStates[i])
+			ER_RHI_RESOURCE_STATE before;
+			if (aResources[i] && IsTransitionNeeded(aResources[i], aStates[i], isCopyQueue, subresourceIndex, before))
 			{
-				barriers.emplace_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(aResources[i]->GetCurrentState()), GetState(aStates[i]),
+				if (barriers.full())
+					flushBarriers();
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(before), GetState(aStates[i]),
 					subresourceIndex < 0 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : subresourceIndex)
 				);
-				aResources[i]->SetCurrentState(aStates[i]);
 			}
 		}
 
-		if (barriers.size() > 0)
-		{
-			if (!isCopyQueue)
-				mCommandListGraphics[cmdListIndex]->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-			else
-				mCommandListCopy->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-		}
+		flushBarriers();
 	}
 
-	void ER_RHI_DX12::TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex /*= 0*/, bool isCopyQueue, int subresourceIndex)
+	void ER_RHI_DX12::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex /*= 0*/, bool isCopyQueue, int subresourceIndex)
 	{
 		int size = static_cast<int>(aResources.size());
-		std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+		ER_RHI_InlineArray<CD3DX12_RESOURCE_BARRIER, DX12_MAX_BOUND_SHADER_RESOURCE_VIEWS> barriers;
+		auto flushBarriers = [&]()
+		{
+			if (barriers.size() > 0)
+			{
+				if (!isCopyQueue)
+					GetRecordingCommandList(cmdListIndex)->ResourceBarrier(barriers.size(), barriers.data());
+				else
+					mCommandListCopy->ResourceBarrier(barriers.size(), barriers.data());
+				barriers.clear();
+			}
+		};
 
 		for (int i = 0; i < size; i++)
 		{
-			if (!aResources[i])
-				continue;
-
-			if (aState == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE &&
-				aResources[i]->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
-				continue;
-
-			if (aResources[i] && aResources[i]->GetCurrentState() != aState)
+			ER_RHI_RESOURCE_STATE before;
+			if (aResources[i] && IsTransitionNeeded(aResources[i], aState, isCopyQueue, subresourceIndex, before))
 			{
-				barriers.emplace_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(aResources[i]->GetCurrentState()), GetState(aState),
+				if (barriers.full())
+					flushBarriers();
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(before), GetState(aState),
 					subresourceIndex < 0 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : subresourceIndex)
 				);
-				aResources[i]->SetCurrentState(aState);
 			}
 		}
 
-		if (barriers.size() > 0)
+		flushBarriers();
+	}
+
+	bool ER_RHI_DX12::IsTransitionNeeded(ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aState, bool isCopyQueue, int subresourceIndex, ER_RHI_RESOURCE_STATE& aOutBefore)
+	{
+		if (sBoundRecordingContext && !isCopyQueue)
 		{
-			if (!isCopyQueue)
-				mCommandListGraphics[cmdListIndex]->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-			else
-				mCommandListCopy->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+			assert(subresourceIndex < 0); // recording contexts track whole resources only
+			return sBoundRecordingContext->Transition(aResource, aState, aOutBefore);
 		}
+
+		if (aState == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE &&
+			aResource->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+			return false;
+
+		if (aResource->GetCurrentState() == aState)
+			return false;
+
+		aOutBefore = aResource->GetCurrentState();
+		aResource->SetCurrentState(aState);
+		return true;
 	}
 
 	void ER_RHI_DX12::TransitionMainRenderTargetToPresent(int cmdListIndex)
@@ -1661,7 +1869,7 @@ namespace EveryRay_Core
 	void ER_RHI_DX12::UnbindRenderTargets()
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(0, nullptr, false, nullptr);
+		GetRecordingCommandList()->OMSetRenderTargets(0, nullptr, false, nullptr);
 	}
 
 	void ER_RHI_DX12::UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers)
@@ -1674,6 +1882,16 @@ namespace EveryRay_Core
 		buffer->Update(this, aData, dataSize, updateForAllBackBuffers);
 	}
 
+	void ER_RHI_DX12::UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize)
+	{
+		assert(aBuffer->GetSize() >= aOffset + dataSize);
+
+		ER_RHI_DX12_GPUBuffer* buffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aBuffer);
+		assert(buffer);
+
+		buffer->UpdateRange(this, aData, aOffset, dataSize);
+	}
+
 	void ER_RHI_DX12::InitImGui()
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC desc = {};
@@ -1,5 +1,6 @@
 #pragma once
 #include "..\ER_RHI.h"
+#include "..\ER_RHI_RecordingContext.h"
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
@@ -38,6 +39,31 @@ namespace EveryRay_Core
 	class ER_RHI_DX12_GPUDescriptorHeapManager;
 	class ER_RHI_DX12_DescriptorHandle;
 
+	// What is set to a command list: one for the main command lists and one per recording context
+	struct ER_RHI_DX12_RecordingState : public ER_RHI_RecordingContextState
+	{
+		ER_RHI_DX12_PSO_STATE PSOState = ER_RHI_DX12_PSO_STATE::UNSET;
+		bool IsInstancedBufferBound = false;
+
+		void Inherit(const ER_RHI_DX12_RecordingState& aState)
+		{
+			ER_RHI_RecordingContextState::Inherit(aState);
+			PSOState = ER_RHI_DX12_PSO_STATE::UNSET;
+			IsInstancedBufferBound = false;
+		}
+	};
+
+	// Recording context with its own command list and allocators (one per back buffer), see ER_RHI::BeginRecordingContext().
+	// The list stays open after EndRecordingContext(): the barriers of the next context are recorded at its end on submission.
+	class ER_RHI_DX12_RecordingContext : public ER_RHI_RecordingContext
+	{
+	public:
+		ComPtr<ID3D12GraphicsCommandList> mCommandList;
+		ComPtr<ID3D12CommandAllocator> mCommandAllocators[DX12_MAX_BACK_BUFFER_COUNT];
+		UINT64 mCommandAllocatorsFrames[DX12_MAX_BACK_BUFFER_COUNT] = {}; // frame of the last Reset() (an allocator is reset once per frame, a context can be used by several parallel sections)
+		ER_RHI_DX12_RecordingState mState;
+	};
+
 	class ER_RHI_DX12: public ER_RHI
 	{
 	public:
@@ -55,6 +81,12 @@ namespace EveryRay_Core
 		virtual void BeginCopyCommandList(int index = 0) override;
 		virtual void EndCopyCommandList(int index = 0) override;
 
+		virtual bool IsParallelRecordingSupported() override { return true; }
+		virtual void BeginParallelRecording() override;
+		virtual void EndParallelRecording() override;
+		virtual void BeginRecordingContext(UINT aOrder) override;
+		virtual void EndRecordingContext() override;
+
 		virtual void ClearMainRenderTarget(float colors[4]) override;
 		virtual void ClearMainDepthStencilTarget(float depth, UINT stencil = 0) override;
 		virtual void ClearRenderTarget(ER_RHI_GPUTexture* aRenderTarget, float colors[4], int rtvArrayIndex = -1) override;
@@ -104,30 +136,35 @@ namespace EveryRay_Core
 		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) override;
 
 		virtual void SetMainRenderTargets(int cmdListIndex = 0) override;
-		virtual void SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
 		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) override;
-		virtual void SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override;
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override;
 		virtual void SetMainRenderTargetFormats() override;
 
 		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) override;
+		virtual ER_RHI_DEPTH_STENCIL_STATE GetCurrentDepthStencilState() override { return GetRecordingState().DepthStencilState; }
 
 		virtual void SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4] = nullptr, UINT SampleMask = 0xffffffff) override;
+		virtual ER_RHI_BLEND_STATE GetCurrentBlendState() override { return GetRecordingState().BlendState; }
 		
 		virtual void SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS) override;
+		virtual ER_RHI_RASTERIZER_STATE GetCurrentRasterizerState() override { return GetRecordingState().RasterizerState; }
 		
 		virtual void SetViewport(const ER_RHI_Viewport& aViewport) override;
+		virtual const ER_RHI_Viewport& GetCurrentViewport() override { return GetRecordingState().Viewport; }
 		
 		virtual void SetRect(const ER_RHI_Rect& rect) override;
+		virtual const ER_RHI_Rect& GetCurrentRect() override { return GetRecordingState().Rect; }
 		
 		virtual void SetShader(ER_RHI_GPUShader* aShader) override;
 		
-		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot = 0, 
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0, 
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot = 0,
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot = 0,
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) override;
-		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
 		
 		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) override;
 		virtual void SetRootConstant(UINT aConstant, UINT aRootIndex, UINT anOffset = 0, bool isCompute = false) override;
@@ -135,7 +172,7 @@ namespace EveryRay_Core
 		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) override;
 		virtual void SetEmptyInputLayout() override;
 		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) override;
-		virtual void SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers) override;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) override;
 
 		virtual void SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType) override;
 		virtual ER_RHI_PRIMITIVE_TYPE GetCurrentTopologyType() override;
@@ -143,22 +180,24 @@ namespace EveryRay_Core
 		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) override;
 		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex = 0) override;
 
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
 		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) override;
 
-		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) override;
-		virtual void InitializePSO(const std::string& aName, bool isCompute = false) override;
-		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) override;
-		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) override;
-		virtual void FinalizePSO(const std::string& aName, bool isCompute = false) override;
-		virtual void SetPSO(const std::string& aName, bool isCompute = false) override;
+		virtual bool IsPSOReady(ER_RHI_PSO_HANDLE aHandle) override;
+		virtual void InitializePSO(ER_RHI_PSO_HANDLE aHandle) override;
+		virtual void SetRootSignatureToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_GPURootSignature* rs) override;
+		virtual void SetTopologyTypeToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_PRIMITIVE_TYPE aType) override;
+		virtual void FinalizePSO(ER_RHI_PSO_HANDLE aHandle) override;
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle) override;
 		virtual void UnsetPSO() override;
 
 		virtual void UnbindRenderTargets() override;
 		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) override {}; //Not needed on DX12
 
 		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) override;
+		virtual void UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize) override;
+		virtual int GetDynamicBufferCopiesCount() override { return DX12_MAX_BACK_BUFFER_COUNT; } // dynamic buffers have one copy per back buffer
 		
 		virtual bool IsHardwareRaytracingSupported() override { return mIsRaytracingTierAvailable; }
 		virtual bool IsRootConstantSupported()  override { return true; }
@@ -186,6 +225,8 @@ namespace EveryRay_Core
 		ID3D12GraphicsCommandList* GetGraphicsCommandList(int index) const { return mCommandListGraphics[index].Get(); }
 		ID3D12GraphicsCommandList* GetComputeCommandList(int index) const { return mCommandListCompute[index].Get(); }
 		ER_RHI_DX12_GPUDescriptorHeapManager* GetDescriptorHeapManager() const { return mDescriptorHeapManager; }
+		// Resources can be created from ER_JobSystem workers (i.e., during scene loading): their upload commands and descriptors go through the shared command list/heaps, so we serialize them
+		std::recursive_mutex& GetResourceCreationMutex() { return mResourceCreationMutex; }
 
 		const D3D12_SAMPLER_DESC& FindSamplerState(ER_RHI_SAMPLER_STATE aState);
 		DXGI_FORMAT GetFormat(ER_RHI_FORMAT aFormat);
@@ -206,6 +247,14 @@ namespace EveryRay_Core
 
 		D3D12_DESCRIPTOR_HEAP_TYPE GetHeapType(ER_RHI_DESCRIPTOR_HEAP_TYPE aType);
 
+		// The calling thread's recording context (if one is bound) or the main command lists
+		ER_RHI_DX12_RecordingState& GetRecordingState();
+		ID3D12GraphicsCommandList* GetRecordingCommandList() { return GetRecordingCommandList(mCurrentGraphicsCommandListIndex); }
+		ID3D12GraphicsCommandList* GetRecordingCommandList(int aMainCommandListIndex);
+		ER_RHI_DX12_DescriptorHandle GetRecordingDescriptorsBlock(UINT aCount); // in the frame's CBV_SRV_UAV heap
+		bool IsTransitionNeeded(ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aState, bool isCopyQueue, int subresourceIndex, ER_RHI_RESOURCE_STATE& aOutBefore);
+		void ApplyRecordingState(ID3D12GraphicsCommandList* aCommandList, const ER_RHI_DX12_RecordingState& aState);
+
 		DXGI_FORMAT ChangeFormatToNonSRGB(DXGI_FORMAT aFormat);
 		DXGI_FORMAT ChangeFormatToUncompressed(DXGI_FORMAT aFormat);
 		bool IsFormatSRGB(DXGI_FORMAT aFormat);
@@ -265,18 +314,21 @@ namespace EveryRay_Core
 		std::map<ER_RHI_RASTERIZER_STATE, D3D12_RASTERIZER_DESC> mRasterizerStates;
 		std::map<ER_RHI_DEPTH_STENCIL_STATE, D3D12_DEPTH_STENCIL_DESC> mDepthStates;
 
-		std::map<std::string, ER_RHI_DX12_GraphicsPSO> mGraphicsPSONames;
-		std::map<std::string, ER_RHI_DX12_ComputePSO> mComputePSONames;
-		std::string mCurrentGraphicsPSOName;
-		std::string mCurrentComputePSOName;
-		std::string mCurrentSetGraphicsPSOName; //which was set to command list already
-		std::string mCurrentSetComputePSOName; //which was set to command list already
-		ER_RHI_DX12_PSO_STATE mCurrentPSOState = ER_RHI_DX12_PSO_STATE::UNSET;
-#if defined(_DEBUG) || defined (DEBUG)
-		UINT mCurrentPSOSwitchesCount = 0; // to debug how many times we switch our PSOs per frame
-#endif
+		ER_RHI_DX12_GraphicsPSO& GetCurrentGraphicsPSO() { const ER_RHI_PSO_HANDLE pso = GetRecordingState().GraphicsPSO; assert(mGraphicsPSOs[pso]); return *mGraphicsPSOs[pso]; }
+		ER_RHI_DX12_ComputePSO& GetCurrentComputePSO() { const ER_RHI_PSO_HANDLE pso = GetRecordingState().ComputePSO; assert(mComputePSOs[pso]); return *mComputePSOs[pso]; }
+
+		// per PSO handle (nullptr if not initialized or of the other type), only created/resized on the main thread outside of parallel recording
+		std::vector<ER_RHI_DX12_GraphicsPSO*> mGraphicsPSOs;
+		std::vector<ER_RHI_DX12_ComputePSO*> mComputePSOs;
+
+		ER_RHI_DX12_RecordingState mMainRecordingState;
+		ER_RHI_DX12_RecordingContext* mRecordingContexts[ER_RHI_MAX_RECORDING_CONTEXTS] = { nullptr };
+		std::atomic<int> mRecordingContextsCount{ 0 }; // used in the current parallel section
+		bool mIsRecordingInParallel = false;
+		UINT64 mFrameIndex = 1; // incremented on Present
 
 		ER_RHI_DX12_GPUDescriptorHeapManager* mDescriptorHeapManager = nullptr;
+		std::recursive_mutex mResourceCreationMutex;
 
 		ComPtr<ID3D12CommandSignature> mCommandSignature_DrawIndexed;
 
@@ -284,26 +336,29 @@ namespace EveryRay_Core
 
 		bool mIsRaytracingTierAvailable = false;
 		bool mIsContextReadingBuffer = false;
-		bool mIsInstancedBufferBound = false;
 
 		ER_RHI_GPURootSignature* mClearUAV2DRS = nullptr;
 		ER_RHI_GPUShader* mClearUAV2DCS = nullptr;
 		std::string mClearUAV2DPSOName = "ER_RHI_GPUPipelineStateObject: Clear UAV 2D";
+		ER_RHI_PSO_HANDLE mClearUAV2DPSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPURootSignature* mClearUAV3DRS = nullptr;
 		ER_RHI_GPUShader* mClearUAV3DCS = nullptr;
 		std::string mClearUAV3DPSOName = "ER_RHI_GPUPipelineStateObject: Clear UAV 3D";
+		ER_RHI_PSO_HANDLE mClearUAV3DPSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPURootSignature* mGenerateMips2DRS = nullptr;
 		ER_RHI_GPUShader* mGenerateMips2DCS = nullptr;
 		std::string mGenerateMips2DPSOName = "ER_RHI_GPUPipelineStateObject: Generate Mips 2D";
+		ER_RHI_PSO_HANDLE mGenerateMips2DPSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPURootSignature* mGenerateMips3DRS = nullptr;
 		ER_RHI_GPUShader* mGenerateMips3DCS = nullptr;
 		std::string mGenerateMips3DPSOName = "ER_RHI_GPUPipelineStateObject: Generate Mips 3D";
+		ER_RHI_PSO_HANDLE mGenerateMips3DPSO = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUTexture* mGenerateMipsWithReplacementReadyTexturesPool[DX12_MAX_GENERATE_MIPS_TEXTURES_IN_POOL] = { nullptr };
 		std::function<void(ER_RHI_GPUTexture**)> mGenerateMipsWithReplacementCallbacks[DX12_MAX_GENERATE_MIPS_TEXTURES_IN_POOL];
-		int mGenerateMipsWithReplacementCurrentTextureIndexInPool = 0; // should be atomic (in the future), at the moment we do not use multithreading for submitting mip generation commands
+		int mGenerateMipsWithReplacementCurrentTextureIndexInPool = 0; // guarded by mResourceCreationMutex (mip generation commands can be submitted from job system workers)
 	};
 }
\ No newline at end of file
@@ -24,6 +24,7 @@ namespace EveryRay_Core
 	void ER_RHI_DX12_GPUBuffer::CreateGPUBufferResource(ER_RHI* aRHI, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic /*= false*/, ER_RHI_BIND_FLAG bindFlags /*= 0*/, UINT cpuAccessFlags /*= 0*/, ER_RHI_RESOURCE_MISC_FLAG miscFlags /*= 0*/, ER_RHI_FORMAT format /*= ER_FORMAT_UNKNOWN*/)
 	{
 		ER_RHI_DX12* aRHIDX12 = static_cast<ER_RHI_DX12*>(aRHI);
+		const std::lock_guard<std::recursive_mutex> lock(aRHIDX12->GetResourceCreationMutex());
 		ID3D12Device* device = aRHIDX12->GetDevice();
 		assert(device);
 		mIsDynamic = isDynamic;
@@ -253,4 +254,14 @@ namespace EveryRay_Core
 		//	UpdateSubresource(aRHI, aData, dataSize, aRHIDX12->GetCurrentGraphicsCommandListIndex());
 	}
 
+	void ER_RHI_DX12_GPUBuffer::UpdateRange(ER_RHI* aRHI, void* aData, int aOffset, int dataSize)
+	{
+		assert(mSize >= aOffset + dataSize);
+		assert(mIsDynamic);
+		assert(aRHI);
+
+		if (mIsDynamic)
+			memcpy(mMappedData[ER_RHI_DX12::mBackBufferIndex] + aOffset, aData, dataSize);
+	}
+
 }
\ No newline at end of file
@@ -34,6 +34,7 @@ namespace EveryRay_Core
 		void Map(ER_RHI* aRHI, void** aOutData);
 		void Unmap(ER_RHI* aRHI);
 		void Update(ER_RHI* aRHI, void* aData, int dataSize, bool updateForAllBackBuffers = false);
+		void UpdateRange(ER_RHI* aRHI, void* aData, int aOffset, int dataSize); // only the current back buffer's copy
 		DXGI_FORMAT GetFormat() { return mFormat; }
 	private:
 		void UpdateSubresource(ER_RHI* aRHI, void* aData, int aSize, int cmdListIndex);
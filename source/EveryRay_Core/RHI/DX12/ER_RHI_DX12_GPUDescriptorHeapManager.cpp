@@ -80,40 +80,40 @@ namespace EveryRay_Core
 
 	ER_RHI_DX12_GPUDescriptorHeap::ER_RHI_DX12_GPUDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE heapType, UINT numDescriptors)
 		: ER_RHI_DX12_DescriptorHeap(device, heapType, numDescriptors, true)
+		, mAllocator(numDescriptors)
 	{
-		mCurrentDescriptorIndex = 0;
 	}
 
 	ER_RHI_DX12_DescriptorHandle ER_RHI_DX12_GPUDescriptorHeap::GetHandleBlock(UINT count)
 	{
 		UINT newHandleID = 0;
-		UINT blockEnd = mCurrentDescriptorIndex + count;
-
-		if (blockEnd < mMaxNumDescriptors)
-		{
-			newHandleID = mCurrentDescriptorIndex;
-			mCurrentDescriptorIndex = blockEnd;
-		}
-		else
+		if (!mAllocator.Allocate(count, newHandleID))
 			throw ER_CoreException("ER_RHI_DX12: Ran out of GPU descriptor heap handles, need to increase heap size");
 
+		return GetHandle(newHandleID);
+	}
+
+	ER_RHI_DX12_DescriptorHandle ER_RHI_DX12_GPUDescriptorHeap::GetHandle(UINT index)
+	{
+		assert(index < mMaxNumDescriptors);
+
 		ER_RHI_DX12_DescriptorHandle newHandle;
 		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = mDescriptorHeapCPUStart;
-		cpuHandle.ptr += newHandleID * mDescriptorSize;
+		cpuHandle.ptr += index * mDescriptorSize;
 		newHandle.SetCPUHandle(cpuHandle);
 
 		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = mDescriptorHeapGPUStart;
-		gpuHandle.ptr += newHandleID * mDescriptorSize;
+		gpuHandle.ptr += index * mDescriptorSize;
 		newHandle.SetGPUHandle(gpuHandle);
 
-		newHandle.SetHeapIndex(newHandleID);
+		newHandle.SetHeapIndex(index);
 
 		return newHandle;
 	}
 
 	void ER_RHI_DX12_GPUDescriptorHeap::Reset()
 	{
-		mCurrentDescriptorIndex = 0;
+		mAllocator.Reset();
 	}
 
 	ER_RHI_DX12_GPUDescriptorHeapManager::ER_RHI_DX12_GPUDescriptorHeapManager(ID3D12Device* device)
@@ -88,10 +88,14 @@ namespace EveryRay_Core
 		~ER_RHI_DX12_GPUDescriptorHeap() final {};
 
 		void Reset();
-		ER_RHI_DX12_DescriptorHandle GetHandleBlock(UINT count);
+		ER_RHI_DX12_DescriptorHandle GetHandleBlock(UINT count); // can be called from any thread (recording contexts)
+		ER_RHI_DX12_DescriptorHandle GetHandle(UINT index);
+
+		// recording contexts take chunks from it (see ER_RHI_LinearSuballocator)
+		ER_RHI_SharedLinearAllocator& GetAllocator() { return mAllocator; }
 
 	private:
-		UINT mCurrentDescriptorIndex;
+		ER_RHI_SharedLinearAllocator mAllocator;
 	};
 
 	class ER_RHI_DX12_GPUDescriptorHeapManager
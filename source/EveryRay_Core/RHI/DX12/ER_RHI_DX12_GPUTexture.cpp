@@ -20,6 +20,7 @@ namespace EveryRay_Core
 	{
 		assert(aRHI);
 		ER_RHI_DX12* aRHIDX12 = static_cast<ER_RHI_DX12*>(aRHI);
+		const std::lock_guard<std::recursive_mutex> lock(aRHIDX12->GetResourceCreationMutex());
 		ID3D12Device* device = aRHIDX12->GetDevice();
 		assert(device);
 
@@ -309,6 +310,7 @@ namespace EveryRay_Core
 	{
 		assert(aRHI);
 		ER_RHI_DX12* aRHIDX12 = static_cast<ER_RHI_DX12*>(aRHI);
+		const std::lock_guard<std::recursive_mutex> lock(aRHIDX12->GetResourceCreationMutex());
 		ID3D12Device* device = aRHIDX12->GetDevice();
 		assert(device);
 
@@ -343,57 +345,7 @@ namespace EveryRay_Core
 				return;
 			}
 
-			// Create the GPU upload buffer and update subresources
-			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(mResource.Get(), 0, static_cast<UINT>(subresources.size()));
-			if (FAILED(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mResourceUpload))))
-				throw ER_CoreException("ER_RHI_DX12: Could not create a committed resource for the GPU texture resource (upload)");
-
-			{
-				int cmdIndex = aRHIDX12->GetCurrentGraphicsCommandListIndex();
-				auto commandList = aRHIDX12->GetGraphicsCommandList(cmdIndex);
-				UpdateSubresources(commandList, mResource.Get(), mResourceUpload.Get(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
-
-				auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				commandList->ResourceBarrier(1, &barrier);
-
-				mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			}
-
-			mSRVHandle = descriptorHeapManager->CreateCPUHandle(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-			D3D12_RESOURCE_DESC desc = mResource->GetDesc();
-			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			srvDesc.Format = desc.Format;
-			if (isCubemap)
-			{
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-				srvDesc.TextureCube.MipLevels = desc.MipLevels;
-			}
-			else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D)
-			{
-				if (desc.DepthOrArraySize > 1)
-				{
-					srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-					srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
-					srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
-				}
-				else
-				{
-					srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-					srvDesc.Texture2D.MipLevels = desc.MipLevels;
-				}
-			}
-			else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
-			{
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
-				srvDesc.Texture3D.MipLevels = desc.MipLevels;
-			}
-			device->CreateShaderResourceView(mResource.Get(), &srvDesc, mSRVHandle.GetCPUHandle());
-			
-			mMipLevels = desc.MipLevels;
-			mFormat = desc.Format;
-			mWidth = static_cast<UINT>(desc.Width);
-			mHeight = static_cast<UINT>(desc.Height);
+			UploadDDSSubresources(aRHIDX12, subresources, isCubemap);
 
 			if (statusFlag)
 				*statusFlag = true;
@@ -452,6 +404,101 @@ namespace EveryRay_Core
 		}
 	}
 
+	// Uploads already loaded DDS subresources to mResource and creates its SRV
+	void ER_RHI_DX12_GPUTexture::UploadDDSSubresources(ER_RHI_DX12* aRHIDX12, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources, bool isCubemap)
+	{
+		ID3D12Device* device = aRHIDX12->GetDevice();
+		assert(device);
+		ER_RHI_DX12_GPUDescriptorHeapManager* descriptorHeapManager = aRHIDX12->GetDescriptorHeapManager();
+		assert(descriptorHeapManager);
+
+		// Create the GPU upload buffer and update subresources
+		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(mResource.Get(), 0, static_cast<UINT>(subresources.size()));
+		if (FAILED(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mResourceUpload))))
+			throw ER_CoreException("ER_RHI_DX12: Could not create a committed resource for the GPU texture resource (upload)");
+
+		{
+			int cmdIndex = aRHIDX12->GetCurrentGraphicsCommandListIndex();
+			auto commandList = aRHIDX12->GetGraphicsCommandList(cmdIndex);
+			UpdateSubresources(commandList, mResource.Get(), mResourceUpload.Get(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
+
+			auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			commandList->ResourceBarrier(1, &barrier);
+
+			mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		}
+
+		mSRVHandle = descriptorHeapManager->CreateCPUHandle(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		D3D12_RESOURCE_DESC desc = mResource->GetDesc();
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = desc.Format;
+		if (isCubemap)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+			srvDesc.TextureCube.MipLevels = desc.MipLevels;
+		}
+		else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+		{
+			if (desc.DepthOrArraySize > 1)
+			{
+				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+				srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+				srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+			}
+			else
+			{
+				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+				srvDesc.Texture2D.MipLevels = desc.MipLevels;
+			}
+		}
+		else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+			srvDesc.Texture3D.MipLevels = desc.MipLevels;
+		}
+		device->CreateShaderResourceView(mResource.Get(), &srvDesc, mSRVHandle.GetCPUHandle());
+		
+		mMipLevels = desc.MipLevels;
+		mFormat = desc.Format;
+		mWidth = static_cast<UINT>(desc.Width);
+		mHeight = static_cast<UINT>(desc.Height);
+	}
+
+	void ER_RHI_DX12_GPUTexture::CreateGPUTextureResourceFromDDSMemory(ER_RHI* aRHI, const void* aData, UINT64 aDataSize, bool* statusFlag, bool isSilent)
+	{
+		assert(aRHI);
+		assert(aData);
+		ER_RHI_DX12* aRHIDX12 = static_cast<ER_RHI_DX12*>(aRHI);
+		const std::lock_guard<std::recursive_mutex> lock(aRHIDX12->GetResourceCreationMutex());
+		ID3D12Device* device = aRHIDX12->GetDevice();
+		assert(device);
+
+		mIsLoadedFromFile = true;
+		mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_DEST;
+
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+		bool isCubemap = false;
+		if (FAILED(DirectX::LoadDDSTextureFromMemory(device, static_cast<const uint8_t*>(aData), static_cast<size_t>(aDataSize), &mResource, subresources, 0, nullptr, &isCubemap)))
+		{
+			if (!isSilent)
+			{
+				std::wstring msg = L"[ER Logger][ER_RHI_DX12_GPUTexture] Failed to create texture from DDS data in memory: " + mDebugName + L"\n";
+				ER_OUTPUT_LOG(msg.c_str());
+			}
+			if (statusFlag)
+				*statusFlag = false;
+			return;
+		}
+
+		// subresources point into aData, which only has to stay valid until the upload buffer is filled
+		UploadDDSSubresources(aRHIDX12, subresources, isCubemap);
+		mResource->SetName(mDebugName.c_str());
+
+		if (statusFlag)
+			*statusFlag = true;
+	}
+
 	void ER_RHI_DX12_GPUTexture::CreateSimpleGPUTexture2DResource(ER_RHI* aRHI, UINT width, UINT height, DXGI_FORMAT format, ER_RHI_BIND_FLAG bindFlags /*= ER_BIND_NONE*/, int mip)
 	{
 		assert(aRHI);
@@ -1,5 +1,7 @@
 #pragma once
 #include "..\Common.h"
+#include "ER_RHI_PSORegistry.h"
+#include "ER_RHI_Span.h"
 
 #define ER_RHI_MAX_GRAPHICS_COMMAND_LISTS 8
 #define ER_RHI_MAX_COMPUTE_COMMAND_LISTS 2
@@ -13,7 +15,8 @@ namespace EveryRay_Core
 	enum ER_GRAPHICS_API
 	{
 		DX11,
-		DX12
+		DX12,
+		NULL_RHI // no device, only records commands (see ER_RHI_Null)
 	};
 
 	enum ER_RHI_SHADER_TYPE
@@ -279,6 +282,18 @@ namespace EveryRay_Core
 		virtual void BeginCopyCommandList(int index = 0) = 0;
 		virtual void EndCopyCommandList(int index = 0) = 0;
 
+		// Parallel recording of graphics commands (see ER_RHI_RecordingContext). Between Begin/EndParallelRecording() (main thread, the main command list is open)
+		// any thread can bind a recording context with BeginRecordingContext() and all graphics commands of that thread go to it until EndRecordingContext()
+		// ("cmdListIndex" arguments are ignored then). A context starts with the main list's states, viewport, rect and topology but without a PSO;
+		// render targets, root signature and bound resources are not inherited, so every context sets them and the main list sets them again after EndParallelRecording().
+		// Contexts are submitted after the main list's commands in the order of their keys, not in the order they were recorded in; PSOs have to be ready before.
+		// Without support, contexts are no-ops and commands go to the current command list: callers have to record serially on the main thread then.
+		virtual bool IsParallelRecordingSupported() { return false; }
+		virtual void BeginParallelRecording() {}
+		virtual void EndParallelRecording() {}
+		virtual void BeginRecordingContext(UINT aOrder) {}
+		virtual void EndRecordingContext() {}
+
 		virtual void ClearMainRenderTarget(float colors[4]) = 0;
 		virtual void ClearMainDepthStencilTarget(float depth, UINT stencil = 0) = 0;
 		virtual void ClearRenderTarget(ER_RHI_GPUTexture* aRenderTarget, float colors[4], int rtvArrayIndex = -1) = 0;
@@ -328,9 +343,9 @@ namespace EveryRay_Core
 		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) = 0; //WARNING: only works on DX11 for now
 
 		virtual void SetMainRenderTargets(int cmdListIndex = 0) = 0;
-		virtual void SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) = 0;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) = 0;
 		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) = 0;
-		virtual void SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) = 0;
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) = 0;
 		virtual void SetMainRenderTargetFormats() = 0;
 
 		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) = 0;
@@ -350,19 +365,20 @@ namespace EveryRay_Core
 
 		virtual void SetShader(ER_RHI_GPUShader* aShader) = 0;
 		
-		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot = 0,
+		// Binding lists are spans, so call sites can pass brace lists ("{ a, b }"), vectors or ER_RHI_InlineArray without allocating
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) = 0;
-		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot = 0,
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) = 0;
-		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot = 0,
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) = 0;
-		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) = 0;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) = 0;
 		
 		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) = 0;
 		virtual void SetRootConstant(UINT aConstant, UINT aRootIndex, UINT anOffset = 0, bool isCompute = false) = 0;
 
 		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) = 0;
-		virtual void SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers) = 0;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) = 0;
 		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) = 0;
 		virtual void SetEmptyInputLayout() = 0;
 
@@ -372,22 +388,51 @@ namespace EveryRay_Core
 		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) = 0;
 		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex) = 0;
 
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
 		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) = 0;
 
-		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) = 0;
-		virtual void InitializePSO(const std::string& aName, bool isCompute = false) = 0;
-		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) = 0;
-		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) = 0;
-		virtual void FinalizePSO(const std::string& aName, bool isCompute = false) = 0;
-		virtual void SetPSO(const std::string& aName, bool isCompute = false) = 0;
+		// PSOs are identified by handles from the registry: get one once (i.e., on init) and keep it, the handle versions below don't touch strings
+		ER_RHI_PSO_HANDLE GetPSOHandle(const std::string& aName, bool isCompute = false) { return mPSORegistry.GetHandle(aName, isCompute); }
+		const ER_RHI_PSORegistry& GetPSORegistry() const { return mPSORegistry; }
+
+		virtual bool IsPSOReady(ER_RHI_PSO_HANDLE aHandle) = 0;
+		virtual void InitializePSO(ER_RHI_PSO_HANDLE aHandle) = 0;
+		virtual void SetRootSignatureToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_GPURootSignature* rs) = 0;
+		virtual void SetTopologyTypeToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_PRIMITIVE_TYPE aType) = 0;
+		virtual void FinalizePSO(ER_RHI_PSO_HANDLE aHandle) = 0;
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle) = 0; // skipped if the same PSO is set already
 		virtual void UnsetPSO() = 0;
 
+		// compatibility layer: one registry lookup per call, prefer the handle versions in per-draw/dispatch code
+		bool IsPSOReady(const std::string& aName, bool isCompute = false) { return IsPSOReady(GetPSOHandle(aName, isCompute)); }
+		void InitializePSO(const std::string& aName, bool isCompute = false) { InitializePSO(GetPSOHandle(aName, isCompute)); }
+		void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) { SetRootSignatureToPSO(GetPSOHandle(aName, isCompute), rs); }
+		void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) { SetTopologyTypeToPSO(GetPSOHandle(aName, false), aType); }
+		void FinalizePSO(const std::string& aName, bool isCompute = false) { FinalizePSO(GetPSOHandle(aName, isCompute)); }
+		void SetPSO(const std::string& aName, bool isCompute = false) { SetPSO(GetPSOHandle(aName, isCompute)); }
+
+		// counters of the last frame (see EndPSOStatsFrame())
+		const ER_RHI_PSOStats& GetPSOStats() const { return mLastFramePSOStats; }
+		void EndPSOStatsFrame()
+		{
+			const UINT64 lookups = mPSORegistry.GetLookupsCount(); // handles can be requested from other threads, so the registry counts them
+			mPSOStats.lookups = static_cast<UINT>(lookups - mPSOLookupsCount);
+			mPSOLookupsCount = lookups;
+			mLastFramePSOStats = mPSOStats;
+			mPSOStats = {};
+		}
+
 		virtual void UnbindRenderTargets() = 0;
 		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) = 0;
 
 		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) = 0;
+		// Writes [aOffset, aOffset + dataSize) bytes of a dynamic buffer.
+		// With one copy (GetDynamicBufferCopiesCount() == 1, renamed by the driver) the first write of a frame discards the buffer, so it has to cover everything that is drawn
+		// and later writes of the frame keep the rest. With several copies the rest is kept, but only the copy of the current frame is written,
+		// so the same range has to be updated GetDynamicBufferCopiesCount() frames in a row.
+		virtual void UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize) = 0;
+		virtual int GetDynamicBufferCopiesCount() = 0;
 
 		virtual bool IsHardwareRaytracingSupported() = 0;
 		virtual bool IsRootConstantSupported() = 0;
@@ -428,6 +473,11 @@ namespace EveryRay_Core
 		ER_RHI_Viewport mCurrentViewport;
 		ER_RHI_Rect mCurrentRect;
 
+		ER_RHI_PSORegistry mPSORegistry;
+		ER_RHI_PSOStats mPSOStats;
+		ER_RHI_PSOStats mLastFramePSOStats;
+		UINT64 mPSOLookupsCount = 0; // at the end of the last frame
+
 		const int mPrepareGraphicsCommandListIndex = ER_RHI_MAX_GRAPHICS_COMMAND_LISTS - 1; // command list for prepare commands (on init)
 		int mCurrentGraphicsCommandListIndex = -1;
 		int mCurrentComputeCommandListIndex = -1;
@@ -478,6 +528,8 @@ namespace EveryRay_Core
 			int mip = 1, int depth = -1, int arraySize = 1, bool isCubemap = false, int cubemapArraySize = -1) { AbstractRHIMethodAssert();	}
 		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::string& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) { AbstractRHIMethodAssert(); }
 		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::wstring& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) { AbstractRHIMethodAssert(); }
+		// DDS file that is already in memory (i.e., a part of a memory-mapped file); no fallback texture
+		virtual void CreateGPUTextureResourceFromDDSMemory(ER_RHI* aRHI, const void* aData, UINT64 aDataSize, bool* statusFlag = nullptr, bool isSilent = false) { AbstractRHIMethodAssert(); }
 
 		virtual void* GetRTV(void* aEmpty = nullptr) { AbstractRHIMethodAssert(); return nullptr; }
 		virtual void* GetRTV(int index) { AbstractRHIMethodAssert(); return nullptr; }
@@ -0,0 +1,162 @@
+#include "ER_RHI_PSORegistry.h"
+#include "..\ER_CoreException.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_PSO_HANDLE ER_RHI_PSORegistry::GetHandle(const std::string& aName, bool isCompute)
+	{
+		return GetHandle(aName, isCompute, GetDescriptionHash(aName, isCompute));
+	}
+
+	ER_RHI_PSO_HANDLE ER_RHI_PSORegistry::GetHandle(const std::string& aName, bool isCompute, UINT64 aHash)
+	{
+		mLookupsCount++;
+		const std::lock_guard<std::mutex> lock(mMutex);
+		const ER_RHI_PSO_HANDLE existingHandle = FindHandle(aName, isCompute, aHash);
+		if (existingHandle != ER_RHI_INVALID_PSO_HANDLE)
+			return existingHandle;
+
+		if (mEntries.size() >= ER_RHI_MAX_PSO_HANDLES)
+			throw ER_CoreException("ER_RHI_PSORegistry: Too many PSOs! Increase ER_RHI_MAX_PSO_HANDLES.");
+
+		const ER_RHI_PSO_HANDLE handle = static_cast<ER_RHI_PSO_HANDLE>(mEntries.size());
+		mEntries.push_back({ aName, isCompute });
+		mHandles.insert(std::make_pair(aHash, handle)); // chained after the other descriptions with the same hash (if any)
+		mHandlesCount = handle + 1;
+		return handle;
+	}
+
+	ER_RHI_PSO_HANDLE ER_RHI_PSORegistry::FindHandle(const std::string& aName, bool isCompute) const
+	{
+		const std::lock_guard<std::mutex> lock(mMutex);
+		return FindHandle(aName, isCompute, GetDescriptionHash(aName, isCompute));
+	}
+
+	ER_RHI_PSO_HANDLE ER_RHI_PSORegistry::FindHandle(const std::string& aName, bool isCompute, UINT64 aHash) const
+	{
+		auto range = mHandles.equal_range(aHash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			const Entry& entry = mEntries[it->second];
+			if (entry.isCompute == isCompute && entry.name == aName)
+				return it->second;
+		}
+		return ER_RHI_INVALID_PSO_HANDLE;
+	}
+
+	UINT64 ER_RHI_PSORegistry::GetDescriptionHash(const std::string& aName, bool isCompute)
+	{
+		UINT64 hash = 14695981039346656037ull;
+		for (char c : aName)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		hash ^= isCompute ? 1u : 0u;
+		hash *= 1099511628211ull;
+		return hash;
+	}
+
+	bool ER_RHI_PSORegistry::RunTests()
+	{
+		bool isPassed = true;
+
+		// names like the ones in the engine (long common prefix)
+		std::vector<std::string> names;
+		for (int i = 0; i < 100; i++)
+			names.push_back("ER_RHI_GPUPipelineStateObject: Test Pass " + std::to_string(i));
+
+		ER_RHI_PSORegistry registry;
+		isPassed &= registry.FindHandle(names[0], false) == ER_RHI_INVALID_PSO_HANDLE;
+		for (int i = 0; i < static_cast<int>(names.size()); i++)
+			isPassed &= registry.GetHandle(names[i], false) == i; // dense, in registration order
+		for (int i = 0; i < static_cast<int>(names.size()); i++)
+		{
+			isPassed &= registry.GetHandle(names[i], false) == i;
+			isPassed &= registry.FindHandle(names[i], false) == i;
+			isPassed &= registry.GetName(i) == names[i] && !registry.IsCompute(i);
+		}
+
+		// same name as a compute pipeline is another description
+		const ER_RHI_PSO_HANDLE computeHandle = registry.GetHandle(names[0], true);
+		isPassed &= computeHandle == static_cast<int>(names.size()) && registry.IsCompute(computeHandle);
+		isPassed &= GetDescriptionHash(names[0], true) != GetDescriptionHash(names[0], false);
+		isPassed &= GetDescriptionHash(names[0], false) == GetDescriptionHash(std::string(names[0]), false);
+		isPassed &= registry.GetHandlesCount() == static_cast<int>(names.size()) + 1;
+		isPassed &= !registry.IsValid(ER_RHI_INVALID_PSO_HANDLE) && !registry.IsValid(registry.GetHandlesCount());
+
+		// descriptions with the same hash get their own handles
+		const UINT64 collidingHash = GetDescriptionHash(names[1], false);
+		const ER_RHI_PSO_HANDLE collidingHandle = registry.GetHandle("ER_RHI_GPUPipelineStateObject: Colliding Pass", false, collidingHash);
+		isPassed &= collidingHandle == registry.GetHandlesCount() - 1 && collidingHandle != registry.FindHandle(names[1], false);
+		isPassed &= registry.GetHandle("ER_RHI_GPUPipelineStateObject: Colliding Pass", false, collidingHash) == collidingHandle;
+		isPassed &= registry.GetHandle(names[1], false, collidingHash) == 1;
+		isPassed &= registry.FindHandle("ER_RHI_GPUPipelineStateObject: Colliding Pass", false, collidingHash) == collidingHandle;
+
+		std::wstring msg = L"[ER Logger][ER_RHI_PSORegistry] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_RHI_PSORegistry::Benchmark()
+	{
+		std::vector<std::string> names;
+		for (int i = 0; i < 100; i++)
+			names.push_back("ER_RHI_GPUPipelineStateObject: Test Pass " + std::to_string(i));
+
+		ER_RHI_PSORegistry registry;
+		for (const std::string& name : names)
+			registry.GetHandle(name, false);
+
+		// with redundant sets skipped, by name (map lookup + name compare) vs. by handle
+		const int drawsCount = 200000;
+		std::vector<int> drawPSOs(drawsCount);
+		for (int i = 0; i < drawsCount; i++)
+			drawPSOs[i] = (i / 4) % static_cast<int>(names.size()); // 4 draws in a row with the same PSO
+
+		std::map<std::string, int> psosByName;
+		for (int i = 0; i < static_cast<int>(names.size()); i++)
+			psosByName.insert(std::make_pair(names[i], i));
+
+		UINT switchesByName = 0, switchesByHandle = 0;
+		auto startTimer = std::chrono::high_resolution_clock::now();
+		{
+			std::string currentName;
+			for (int i = 0; i < drawsCount; i++)
+			{
+				const std::string& name = names[drawPSOs[i]];
+				auto it = psosByName.find(name);
+				if (it != psosByName.end() && currentName != name)
+				{
+					currentName = it->first;
+					switchesByName++;
+				}
+			}
+		}
+		std::chrono::duration<double> byNameTime = std::chrono::high_resolution_clock::now() - startTimer;
+
+		std::vector<ER_RHI_PSO_HANDLE> handles(names.size());
+		for (int i = 0; i < static_cast<int>(names.size()); i++)
+			handles[i] = registry.GetHandle(names[i], false);
+		startTimer = std::chrono::high_resolution_clock::now();
+		{
+			ER_RHI_PSO_HANDLE currentHandle = ER_RHI_INVALID_PSO_HANDLE;
+			for (int i = 0; i < drawsCount; i++)
+			{
+				const ER_RHI_PSO_HANDLE handle = handles[drawPSOs[i]];
+				if (registry.IsValid(handle) && currentHandle != handle)
+				{
+					currentHandle = handle;
+					switchesByHandle++;
+				}
+			}
+		}
+		std::chrono::duration<double> byHandleTime = std::chrono::high_resolution_clock::now() - startTimer;
+		assert(switchesByName == switchesByHandle && switchesByHandle == drawsCount / 4);
+
+		std::wstring msg = L"[ER Logger][ER_RHI_PSORegistry] Benchmark, " + std::to_wstring(drawsCount) +
+			L" PSO sets: by name " + std::to_wstring(byNameTime.count() * 1000.0) + L"ms, by handle " + std::to_wstring(byHandleTime.count() * 1000.0) + L"ms\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+}
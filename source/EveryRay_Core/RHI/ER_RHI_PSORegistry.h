@@ -0,0 +1,65 @@
+#pragma once
+#include "..\Common.h"
+
+#include <atomic>
+
+#define ER_RHI_INVALID_PSO_HANDLE -1
+#define ER_RHI_MAX_PSO_HANDLES 4096
+
+namespace EveryRay_Core
+{
+	typedef int ER_RHI_PSO_HANDLE; // index in ER_RHI_PSORegistry, stays the same for the lifetime of the RHI
+
+	// Per-frame PSO counters (see ER_RHI::GetPSOStats())
+	struct ER_RHI_PSOStats
+	{
+		UINT lookups = 0; // name -> handle lookups (string API or GetPSOHandle())
+		UINT sets = 0; // SetPSO() calls
+		UINT switches = 0; // pipeline states actually set to the command list
+		UINT redundantSets = 0; // SetPSO() calls skipped because the same handle was set already
+	};
+
+	// Hands out compact handles (0, 1, 2...) for pipeline descriptions (name + graphics/compute), so backends can keep their PSOs in arrays
+	// and compare integers instead of strings on every draw/dispatch. Callers should get a handle once and keep it.
+	// Handles can be requested from any thread (i.e., materials are created by loading jobs); entries never move, so reading them by handle needs no lock.
+	class ER_RHI_PSORegistry
+	{
+	public:
+		ER_RHI_PSORegistry() { mEntries.reserve(ER_RHI_MAX_PSO_HANDLES); }
+
+		// Registers the description if it is new
+		ER_RHI_PSO_HANDLE GetHandle(const std::string& aName, bool isCompute);
+		// ER_RHI_INVALID_PSO_HANDLE if the description was never registered
+		ER_RHI_PSO_HANDLE FindHandle(const std::string& aName, bool isCompute) const;
+
+		bool IsCompute(ER_RHI_PSO_HANDLE aHandle) const { assert(IsValid(aHandle)); return mEntries[aHandle].isCompute; }
+		const std::string& GetName(ER_RHI_PSO_HANDLE aHandle) const { assert(IsValid(aHandle)); return mEntries[aHandle].name; }
+		bool IsValid(ER_RHI_PSO_HANDLE aHandle) const { return aHandle >= 0 && aHandle < mHandlesCount; }
+		int GetHandlesCount() const { return mHandlesCount; }
+		UINT64 GetLookupsCount() const { return mLookupsCount; } // GetHandle() calls
+
+		// FNV-1a of the name and the pipeline type (different descriptions with the same hash are told apart by their names)
+		static UINT64 GetDescriptionHash(const std::string& aName, bool isCompute);
+
+		// Handles and hashing (see ER_Tests)
+		static bool RunTests();
+		// Per-draw cost of setting a PSO by name vs. by handle
+		static void Benchmark();
+	private:
+		struct Entry
+		{
+			std::string name;
+			bool isCompute;
+		};
+
+		// with a given hash (tests use it to force collisions)
+		ER_RHI_PSO_HANDLE GetHandle(const std::string& aName, bool isCompute, UINT64 aHash);
+		ER_RHI_PSO_HANDLE FindHandle(const std::string& aName, bool isCompute, UINT64 aHash) const; // under the lock
+
+		std::unordered_multimap<UINT64, ER_RHI_PSO_HANDLE> mHandles; // description hash -> handles (more than one on collisions)
+		std::vector<Entry> mEntries; // per handle, reserved for ER_RHI_MAX_PSO_HANDLES
+		std::atomic<int> mHandlesCount{ 0 };
+		std::atomic<UINT64> mLookupsCount{ 0 };
+		mutable std::mutex mMutex;
+	};
+}
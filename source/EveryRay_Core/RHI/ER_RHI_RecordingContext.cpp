@@ -0,0 +1,409 @@
+#include "ER_RHI_RecordingContext.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace EveryRay_Core
+{
+	bool ER_RHI_SharedLinearAllocator::Allocate(UINT aCount, UINT& aOutOffset)
+	{
+		UINT offset = mOffset.load();
+		do
+		{
+			if (aCount > mCapacity - offset)
+				return false;
+		} while (!mOffset.compare_exchange_weak(offset, offset + aCount));
+
+		aOutOffset = offset;
+		return true;
+	}
+
+	void ER_RHI_LinearSuballocator::Reset(ER_RHI_SharedLinearAllocator* aParent, UINT aChunkSize)
+	{
+		assert(aChunkSize > 0);
+		mParent = aParent;
+		mChunkSize = aChunkSize;
+		mChunkOffset = 0;
+		mChunkEnd = 0;
+		mChunksCount = 0;
+	}
+
+	bool ER_RHI_LinearSuballocator::Allocate(UINT aCount, UINT& aOutOffset)
+	{
+		if (aCount > mChunkEnd - mChunkOffset)
+		{
+			// the rest of the current chunk is left unused
+			const UINT chunkSize = std::max(aCount, mChunkSize);
+			UINT chunkStart = 0;
+			if (!mParent || !mParent->Allocate(chunkSize, chunkStart))
+				return false;
+
+			mChunkOffset = chunkStart;
+			mChunkEnd = chunkStart + chunkSize;
+			mChunksCount++;
+		}
+
+		aOutOffset = mChunkOffset;
+		mChunkOffset += aCount;
+		return true;
+	}
+
+	void ER_RHI_RecordingContextState::Inherit(const ER_RHI_RecordingContextState& aState)
+	{
+		RasterizerState = aState.RasterizerState;
+		BlendState = aState.BlendState;
+		DepthStencilState = aState.DepthStencilState;
+		Viewport = aState.Viewport;
+		Rect = aState.Rect;
+		Topology = aState.Topology;
+
+		GraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		ComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+		SetGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		SetComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+	}
+
+	void ER_RHI_RecordingContext::Begin(UINT aOrder, ER_RHI_SharedLinearAllocator* aDescriptors)
+	{
+		assert(!mIsRecording);
+		mIsRecording = true;
+		mOrder = aOrder;
+		mPSOStats = {};
+		mDescriptors.Reset(aDescriptors);
+
+		mResources.clear();
+		std::fill(mResourceSlots.begin(), mResourceSlots.end(), -1);
+	}
+
+	bool ER_RHI_RecordingContext::Transition(ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aState, ER_RHI_RESOURCE_STATE& aOutBefore)
+	{
+		assert(mIsRecording);
+		assert(aResource);
+
+		bool isAdded = false;
+		ResourceEntry* entry = FindOrAddResource(aResource, isAdded);
+		if (isAdded)
+		{
+			entry->EntryState = aState;
+			entry->CurrentState = aState;
+			entry->IsTransitioned = false;
+			return false;
+		}
+
+		if (aState == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE && entry->CurrentState == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+			return false;
+
+		if (entry->CurrentState == aState)
+			return false;
+
+		aOutBefore = entry->CurrentState;
+		entry->CurrentState = aState;
+		entry->IsTransitioned = true;
+		return true;
+	}
+
+	ER_RHI_RecordingContext::ResourceEntry* ER_RHI_RecordingContext::FindOrAddResource(ER_RHI_GPUResource* aResource, bool& aOutIsAdded)
+	{
+		// at most half full
+		if ((mResources.size() + 1) * 2 > mResourceSlots.size())
+			RebuildResourceSlots(std::max(64u, static_cast<UINT>(mResourceSlots.size()) * 2));
+
+		const UINT mask = static_cast<UINT>(mResourceSlots.size()) - 1;
+		const UINT64 address = static_cast<UINT64>(reinterpret_cast<uintptr_t>(aResource)) >> 4;
+		UINT slot = (static_cast<UINT>(address ^ (address >> 32)) * 2654435761u) & mask;
+		while (mResourceSlots[slot] >= 0)
+		{
+			ResourceEntry& entry = mResources[mResourceSlots[slot]];
+			if (entry.Resource == aResource)
+			{
+				aOutIsAdded = false;
+				return &entry;
+			}
+			slot = (slot + 1) & mask;
+		}
+
+		mResourceSlots[slot] = static_cast<int>(mResources.size());
+		mResources.push_back({ aResource, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON, false });
+		aOutIsAdded = true;
+		return &mResources.back();
+	}
+
+	void ER_RHI_RecordingContext::RebuildResourceSlots(UINT aSlotsCount)
+	{
+		assert((aSlotsCount & (aSlotsCount - 1)) == 0);
+		mResourceSlots.assign(aSlotsCount, -1);
+
+		const UINT mask = aSlotsCount - 1;
+		for (int i = 0; i < static_cast<int>(mResources.size()); i++)
+		{
+			const UINT64 address = static_cast<UINT64>(reinterpret_cast<uintptr_t>(mResources[i].Resource)) >> 4;
+			UINT slot = (static_cast<UINT>(address ^ (address >> 32)) * 2654435761u) & mask;
+			while (mResourceSlots[slot] >= 0)
+				slot = (slot + 1) & mask;
+			mResourceSlots[slot] = i;
+		}
+	}
+
+	bool ER_RHI_RecordingContext::SortForSubmission(ER_RHI_RecordingContext** aContexts, UINT aCount)
+	{
+		std::sort(aContexts, aContexts + aCount, [](const ER_RHI_RecordingContext* a, const ER_RHI_RecordingContext* b) { return a->GetOrder() < b->GetOrder(); });
+		for (UINT i = 1; i < aCount; i++)
+		{
+			if (aContexts[i - 1]->GetOrder() == aContexts[i]->GetOrder())
+				return false;
+		}
+		return true;
+	}
+
+	void ER_RHI_RecordingContext::ResolveResourceStates(ER_RHI_Span<ER_RHI_RecordingContext*> aContexts, const BarrierCallback& aCallback)
+	{
+		for (UINT i = 0; i < aContexts.size(); i++)
+		{
+			ER_RHI_RecordingContext* context = aContexts[i];
+			assert(context && !context->IsRecording());
+			assert(i == 0 || aContexts[i - 1]->GetOrder() < context->GetOrder());
+
+			for (const ResourceEntry& entry : context->mResources)
+			{
+				const ER_RHI_RESOURCE_STATE state = entry.Resource->GetCurrentState();
+
+				// read by pixel shaders only: keep it readable by all shaders, unless the context recorded barriers from the pixel shader state
+				if (entry.EntryState == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE &&
+					state == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE && !entry.IsTransitioned)
+					continue;
+
+				if (state != entry.EntryState)
+					aCallback(static_cast<int>(i) - 1, entry.Resource, state, entry.EntryState);
+				entry.Resource->SetCurrentState(entry.CurrentState);
+			}
+		}
+	}
+
+	namespace
+	{
+		class ER_RHI_FakeGPUResource : public ER_RHI_GPUResource
+		{
+		public:
+			ER_RHI_FakeGPUResource(ER_RHI_RESOURCE_STATE aState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON) : mState(aState) {}
+
+			virtual void* GetSRV() override { return this; }
+			virtual void* GetUAV() override { return this; }
+			virtual void* GetResource() override { return this; }
+
+			virtual ER_RHI_RESOURCE_STATE GetCurrentState() override { return mState; }
+			virtual void SetCurrentState(ER_RHI_RESOURCE_STATE aState) override { mState = aState; }
+
+			inline virtual bool IsBuffer() override { return false; }
+		private:
+			ER_RHI_RESOURCE_STATE mState;
+		};
+
+		struct ER_RHI_FakeBarrier
+		{
+			int ListIndex;
+			ER_RHI_GPUResource* Resource;
+			ER_RHI_RESOURCE_STATE Before;
+			ER_RHI_RESOURCE_STATE After;
+		};
+	}
+
+	bool ER_RHI_RecordingContext::RunTests()
+	{
+		bool isPassed = true;
+
+		std::vector<ER_RHI_FakeBarrier> barriers;
+		auto recordBarrier = [&barriers](int aListIndex, ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aBefore, ER_RHI_RESOURCE_STATE aAfter)
+		{
+			barriers.push_back({ aListIndex, aResource, aBefore, aAfter });
+		};
+		ER_RHI_SharedLinearAllocator descriptors(4096);
+		ER_RHI_RESOURCE_STATE before = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON;
+
+		// submission order comes from the keys, not from the order contexts were begun/finished in (threads)
+		{
+			ER_RHI_RecordingContext contexts[4];
+			const UINT orders[4] = { 2, 0, 3, 1 };
+			std::vector<std::thread> threads;
+			for (int i = 0; i < 4; i++)
+				threads.emplace_back([&contexts, &orders, &descriptors, i]() { contexts[i].Begin(orders[i], &descriptors); contexts[i].End(); });
+			for (auto& thread : threads)
+				thread.join();
+
+			ER_RHI_RecordingContext* sorted[] = { &contexts[0], &contexts[1], &contexts[2], &contexts[3] };
+			isPassed &= SortForSubmission(sorted, 4);
+			for (UINT i = 0; i < 4; i++)
+				isPassed &= sorted[i]->GetOrder() == i;
+
+			contexts[3].Begin(2, &descriptors);
+			contexts[3].End();
+			isPassed &= !SortForSubmission(sorted, 4);
+		}
+
+		// render target shared by two contexts: one barrier at the end of the main list, none between the contexts
+		{
+			ER_RHI_FakeGPUResource rt(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			ER_RHI_FakeGPUResource depth(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE);
+			ER_RHI_RecordingContext first, second;
+			second.Begin(1, &descriptors);
+			first.Begin(0, &descriptors);
+			isPassed &= !second.Transition(&rt, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET, before);
+			isPassed &= !second.Transition(&depth, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE, before);
+			isPassed &= !first.Transition(&rt, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET, before);
+			isPassed &= !first.Transition(&rt, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET, before);
+			isPassed &= first.GetUsedResourcesCount() == 1 && second.GetUsedResourcesCount() == 2;
+			isPassed &= rt.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE; // untouched while recording
+			first.End();
+			second.End();
+
+			barriers.clear();
+			ResolveResourceStates({ &first, &second }, recordBarrier);
+			isPassed &= barriers.size() == 1 && barriers[0].ListIndex == -1 && barriers[0].Resource == &rt &&
+				barriers[0].Before == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE && barriers[0].After == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET;
+			isPassed &= rt.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET;
+			isPassed &= depth.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+		}
+
+		// states changed inside a context: barriers are recorded by the context, the next one starts from its last state
+		{
+			ER_RHI_FakeGPUResource shadowMap(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			ER_RHI_RecordingContext first, second;
+			first.Begin(0, &descriptors);
+			isPassed &= !first.Transition(&shadowMap, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE, before);
+			isPassed &= first.Transition(&shadowMap, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, before) && before == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+			first.End();
+			second.Begin(1, &descriptors);
+			isPassed &= !second.Transition(&shadowMap, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE, before);
+			second.End();
+
+			barriers.clear();
+			ResolveResourceStates({ &first, &second }, recordBarrier);
+			isPassed &= barriers.size() == 2;
+			isPassed &= barriers[0].ListIndex == -1 && barriers[0].After == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+			isPassed &= barriers[1].ListIndex == 0 && barriers[1].Before == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE && barriers[1].After == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+			isPassed &= shadowMap.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+		}
+
+		// non-pixel shader resources are not transitioned for pixel shader reads (same rule as the main command list)
+		{
+			ER_RHI_FakeGPUResource readOnly(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			ER_RHI_FakeGPUResource rewritten(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			ER_RHI_FakeGPUResource local(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON);
+			ER_RHI_RecordingContext context;
+			context.Begin(0, &descriptors);
+			isPassed &= !context.Transition(&readOnly, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, before);
+			isPassed &= !context.Transition(&rewritten, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, before);
+			isPassed &= context.Transition(&rewritten, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET, before) && before == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+			isPassed &= !context.Transition(&local, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, before);
+			isPassed &= !context.Transition(&local, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, before);
+			context.End();
+
+			barriers.clear();
+			ResolveResourceStates({ &context }, recordBarrier);
+			isPassed &= readOnly.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+			isPassed &= barriers.size() == 2;
+			isPassed &= barriers[0].Resource == &rewritten && barriers[0].After == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE; // the context's barrier starts from it
+			isPassed &= barriers[1].Resource == &local && barriers[1].After == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+			isPassed &= rewritten.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET;
+			isPassed &= local.GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+		}
+
+		// a context reused on the next frame starts with an empty cache (and more resources than the table had slots)
+		{
+			std::vector<ER_RHI_FakeGPUResource> resources(300, ER_RHI_FakeGPUResource(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON));
+			ER_RHI_RecordingContext context;
+			for (int frame = 0; frame < 2; frame++)
+			{
+				context.Begin(0, &descriptors);
+				for (auto& resource : resources)
+					context.Transition(&resource, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, before);
+				for (auto& resource : resources)
+					isPassed &= !context.Transition(&resource, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, before);
+				isPassed &= context.GetUsedResourcesCount() == static_cast<UINT>(resources.size());
+				context.End();
+
+				barriers.clear();
+				ResolveResourceStates({ &context }, recordBarrier);
+				isPassed &= barriers.size() == (frame == 0 ? resources.size() : 0);
+			}
+		}
+
+		// recorded state: a context starts from the main one without its PSOs, changes stay in the context
+		{
+			ER_RHI_RecordingContextState mainState;
+			mainState.RasterizerState = ER_RHI_RASTERIZER_STATE::ER_WIREFRAME;
+			mainState.Viewport.Width = 1920.0f;
+			mainState.Rect.right = 1920;
+			mainState.Topology = ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_CONTROL_POINT_PATCHLIST;
+			mainState.GraphicsPSO = 3;
+			mainState.SetGraphicsPSO = 3;
+			mainState.SetComputePSO = 7;
+
+			ER_RHI_RecordingContextState first, second;
+			first.Inherit(mainState);
+			isPassed &= first.RasterizerState == ER_RHI_RASTERIZER_STATE::ER_WIREFRAME && first.Viewport.Width == 1920.0f && first.Rect.right == 1920;
+			isPassed &= first.Topology == ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_CONTROL_POINT_PATCHLIST;
+			isPassed &= first.GraphicsPSO == ER_RHI_INVALID_PSO_HANDLE && first.SetGraphicsPSO == ER_RHI_INVALID_PSO_HANDLE && first.SetComputePSO == ER_RHI_INVALID_PSO_HANDLE;
+
+			first.RasterizerState = ER_RHI_RASTERIZER_STATE::ER_SHADOW_RS;
+			first.Viewport.Width = 4096.0f;
+			first.SetGraphicsPSO = 11;
+			second.Inherit(mainState);
+			isPassed &= mainState.RasterizerState == ER_RHI_RASTERIZER_STATE::ER_WIREFRAME && mainState.Viewport.Width == 1920.0f && mainState.SetGraphicsPSO == 3;
+			isPassed &= second.RasterizerState == ER_RHI_RASTERIZER_STATE::ER_WIREFRAME && second.Viewport.Width == 1920.0f && second.SetGraphicsPSO == ER_RHI_INVALID_PSO_HANDLE;
+		}
+
+		// descriptors: contexts on different threads never get overlapping blocks of the shared heap, the heap does not grow past its capacity
+		const int threadsCount = ER_RHI_MAX_RECORDING_CONTEXTS;
+		const int blocksPerThread = 2000;
+		ER_RHI_SharedLinearAllocator sharedDescriptors(threadsCount * blocksPerThread * 8);
+		std::vector<UINT> owners(sharedDescriptors.GetCapacity(), 0);
+		std::atomic<UINT> failedCount{ 0 };
+		{
+			ER_RHI_RecordingContext contexts[threadsCount];
+			std::vector<std::thread> threads;
+			for (int t = 0; t < threadsCount; t++)
+			{
+				threads.emplace_back([&, t]()
+				{
+					ER_RHI_RecordingContext& context = contexts[t];
+					context.Begin(t, &sharedDescriptors);
+					for (int i = 0; i < blocksPerThread; i++)
+					{
+						const UINT count = 1 + (i * 7 + t) % 8;
+						UINT offset = 0;
+						if (!context.AllocateDescriptors(count, offset) || offset + count > sharedDescriptors.GetCapacity())
+						{
+							failedCount++;
+							continue;
+						}
+						for (UINT j = offset; j < offset + count; j++)
+							owners[j] = owners[j] ? UINT_MAX : t + 1; // UINT_MAX if two contexts got the same descriptor (each descriptor is written by its owner only)
+					}
+					context.End();
+				});
+			}
+			for (auto& thread : threads)
+				thread.join();
+		}
+		isPassed &= std::find(owners.begin(), owners.end(), UINT_MAX) == owners.end();
+		isPassed &= failedCount == 0 && sharedDescriptors.GetAllocatedCount() <= sharedDescriptors.GetCapacity();
+
+		UINT offset = 0;
+		ER_RHI_SharedLinearAllocator smallHeap(100);
+		isPassed &= smallHeap.Allocate(60, offset) && offset == 0;
+		isPassed &= !smallHeap.Allocate(41, offset) && smallHeap.GetAllocatedCount() == 60;
+		isPassed &= smallHeap.Allocate(40, offset) && offset == 60 && smallHeap.GetAllocatedCount() == 100;
+		smallHeap.Reset();
+		ER_RHI_LinearSuballocator suballocator;
+		suballocator.Reset(&smallHeap, 32);
+		isPassed &= suballocator.Allocate(10, offset) && offset == 0 && suballocator.Allocate(22, offset) && offset == 10;
+		isPassed &= suballocator.Allocate(50, offset) && offset == 32 && suballocator.GetChunksCount() == 2; // bigger than a chunk
+		isPassed &= !suballocator.Allocate(20, offset) && smallHeap.GetAllocatedCount() == 82;
+
+		std::wstring msg = L"[ER Logger][ER_RHI_RecordingContext] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L". " + std::to_wstring(threadsCount * blocksPerThread) +
+			L" descriptor blocks from " + std::to_wstring(threadsCount) + L" threads (" + std::to_wstring(failedCount.load()) + L" failed)\n";
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "ER_RHI.h"
+
+#include <atomic>
+
+
+#define ER_RHI_MAX_RECORDING_CONTEXTS 8
+#define ER_RHI_RECORDING_CONTEXT_DESCRIPTORS_CHUNK 256 // descriptors a context takes from the shared frame heap at once
+
+namespace EveryRay_Core
+{
+	// Thread-safe bump allocator over [0, capacity): i.e., the frame's GPU descriptor heap shared by the main command list and the recording contexts
+	class ER_RHI_SharedLinearAllocator
+	{
+	public:
+		ER_RHI_SharedLinearAllocator(UINT aCapacity = 0) : mCapacity(aCapacity) {}
+
+		// false if there is no room left (nothing is allocated then)
+		bool Allocate(UINT aCount, UINT& aOutOffset);
+		void Reset() { mOffset = 0; }
+
+		UINT GetCapacity() const { return mCapacity; }
+		UINT GetAllocatedCount() const { return mOffset; }
+	private:
+		std::atomic<UINT> mOffset{ 0 };
+		UINT mCapacity;
+	};
+
+	// Allocates from chunks of a shared allocator without synchronization (one per recording context, so only one thread uses it)
+	class ER_RHI_LinearSuballocator
+	{
+	public:
+		void Reset(ER_RHI_SharedLinearAllocator* aParent, UINT aChunkSize = ER_RHI_RECORDING_CONTEXT_DESCRIPTORS_CHUNK);
+		bool Allocate(UINT aCount, UINT& aOutOffset);
+
+		UINT GetChunksCount() const { return mChunksCount; }
+	private:
+		ER_RHI_SharedLinearAllocator* mParent = nullptr;
+		UINT mChunkSize = ER_RHI_RECORDING_CONTEXT_DESCRIPTORS_CHUNK;
+		UINT mChunkOffset = 0;
+		UINT mChunkEnd = 0;
+		UINT mChunksCount = 0;
+	};
+
+	// What a command list has set: the main one has its own and every recording context gets a copy of it (see Inherit()) that it changes on its own
+	struct ER_RHI_RecordingContextState
+	{
+		ER_RHI_RASTERIZER_STATE RasterizerState = ER_RHI_RASTERIZER_STATE::ER_BACK_CULLING;
+		ER_RHI_BLEND_STATE BlendState = ER_RHI_BLEND_STATE::ER_NO_BLEND;
+		ER_RHI_DEPTH_STENCIL_STATE DepthStencilState = ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL;
+		ER_RHI_Viewport Viewport = {};
+		ER_RHI_Rect Rect = {};
+		ER_RHI_PRIMITIVE_TYPE Topology = ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+		ER_RHI_PSO_HANDLE GraphicsPSO = ER_RHI_INVALID_PSO_HANDLE; // last initialized/set one (Set*State() calls go to it)
+		ER_RHI_PSO_HANDLE ComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE SetGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE; // set to the command list already
+		ER_RHI_PSO_HANDLE SetComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+
+		// States, viewport, scissor rect and topology are kept (the backend sets them to the new command list), PSOs are not: a new command list has no pipeline state
+		void Inherit(const ER_RHI_RecordingContextState& aState);
+	};
+
+	// Device-independent part of a recording context (see ER_RHI::BeginRecordingContext()): order key, PSO counters, descriptors suballocator and resource states cache.
+	// While recording, resources are transitioned against the context's cache only (recording threads never read or write the global resource states):
+	// the first state the context needs for every resource is kept and becomes a barrier in ResolveResourceStates(), once all contexts are recorded.
+	class ER_RHI_RecordingContext
+	{
+	public:
+		ER_RHI_RecordingContext() {}
+		virtual ~ER_RHI_RecordingContext() {}
+
+		void Begin(UINT aOrder, ER_RHI_SharedLinearAllocator* aDescriptors);
+		void End() { mIsRecording = false; }
+		bool IsRecording() const { return mIsRecording; }
+		UINT GetOrder() const { return mOrder; }
+
+		// true if the context has to record the barrier (aOutBefore -> aState) itself, the first use of a resource only sets the state the context starts with.
+		// Same rule as the main command list: a non-pixel shader resource is not transitioned for pixel shader reads.
+		bool Transition(ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aState, ER_RHI_RESOURCE_STATE& aOutBefore);
+		UINT GetUsedResourcesCount() const { return static_cast<UINT>(mResources.size()); }
+
+		bool AllocateDescriptors(UINT aCount, UINT& aOutOffset) { return mDescriptors.Allocate(aCount, aOutOffset); }
+		ER_RHI_PSOStats& GetPSOStats() { return mPSOStats; }
+
+		// By order key, so the submission does not depend on which thread finished first; false if two contexts have the same key
+		static bool SortForSubmission(ER_RHI_RecordingContext** aContexts, UINT aCount);
+
+		// Main thread, contexts sorted for submission and done recording: every state a context starts with that differs from the resource's state at that point
+		// becomes a barrier at the end of the previous command list (aListIndex is the index in aContexts, -1 for the main list), then the resource gets the context's last state.
+		typedef std::function<void(int aListIndex, ER_RHI_GPUResource* aResource, ER_RHI_RESOURCE_STATE aBefore, ER_RHI_RESOURCE_STATE aAfter)> BarrierCallback;
+		static void ResolveResourceStates(ER_RHI_Span<ER_RHI_RecordingContext*> aContexts, const BarrierCallback& aCallback);
+
+		// Submission order, state isolation, resource states resolve and descriptors suballocation (see ER_Tests)
+		static bool RunTests();
+	private:
+		struct ResourceEntry
+		{
+			ER_RHI_GPUResource* Resource;
+			ER_RHI_RESOURCE_STATE EntryState; // the context needs it before its first command
+			ER_RHI_RESOURCE_STATE CurrentState;
+			bool IsTransitioned; // by the context itself
+		};
+
+		ResourceEntry* FindOrAddResource(ER_RHI_GPUResource* aResource, bool& aOutIsAdded);
+		void RebuildResourceSlots(UINT aSlotsCount);
+
+		std::vector<ResourceEntry> mResources; // in order of first use, capacity is kept between frames
+		std::vector<int> mResourceSlots; // open addressing table (power of 2 size): index in mResources or -1
+		ER_RHI_LinearSuballocator mDescriptors;
+		ER_RHI_PSOStats mPSOStats;
+		UINT mOrder = 0;
+		bool mIsRecording = false;
+	};
+}
@@ -0,0 +1,186 @@
+#include "ER_RHI_Span.h"
+
+#if ER_RHI_ALLOCATIONS_COUNTER
+#include <new>
+#include <malloc.h>
+
+static thread_local UINT64 sAllocationsCount = 0;
+
+void* operator new(size_t aSize)
+{
+	sAllocationsCount++;
+	if (void* ptr = std::malloc(aSize ? aSize : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t aSize) { return operator new(aSize); }
+void* operator new(size_t aSize, const std::nothrow_t&) noexcept { sAllocationsCount++; return std::malloc(aSize ? aSize : 1); }
+void* operator new[](size_t aSize, const std::nothrow_t&) noexcept { sAllocationsCount++; return std::malloc(aSize ? aSize : 1); }
+void operator delete(void* aPtr) noexcept { std::free(aPtr); }
+void operator delete[](void* aPtr) noexcept { std::free(aPtr); }
+void operator delete(void* aPtr, size_t) noexcept { std::free(aPtr); }
+void operator delete[](void* aPtr, size_t) noexcept { std::free(aPtr); }
+void operator delete(void* aPtr, const std::nothrow_t&) noexcept { std::free(aPtr); }
+void operator delete[](void* aPtr, const std::nothrow_t&) noexcept { std::free(aPtr); }
+
+#ifdef __cpp_aligned_new
+// over-aligned types (alignas > 16) use these in C++17; blocks from _aligned_malloc() have to be freed with _aligned_free()
+void* operator new(size_t aSize, std::align_val_t aAlignment)
+{
+	sAllocationsCount++;
+	if (void* ptr = _aligned_malloc(aSize ? aSize : 1, static_cast<size_t>(aAlignment)))
+		return ptr;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t aSize, std::align_val_t aAlignment) { return operator new(aSize, aAlignment); }
+void* operator new(size_t aSize, std::align_val_t aAlignment, const std::nothrow_t&) noexcept { sAllocationsCount++; return _aligned_malloc(aSize ? aSize : 1, static_cast<size_t>(aAlignment)); }
+void* operator new[](size_t aSize, std::align_val_t aAlignment, const std::nothrow_t&) noexcept { sAllocationsCount++; return _aligned_malloc(aSize ? aSize : 1, static_cast<size_t>(aAlignment)); }
+void operator delete(void* aPtr, std::align_val_t) noexcept { _aligned_free(aPtr); }
+void operator delete[](void* aPtr, std::align_val_t) noexcept { _aligned_free(aPtr); }
+void operator delete(void* aPtr, size_t, std::align_val_t) noexcept { _aligned_free(aPtr); }
+void operator delete[](void* aPtr, size_t, std::align_val_t) noexcept { _aligned_free(aPtr); }
+void operator delete(void* aPtr, std::align_val_t, const std::nothrow_t&) noexcept { _aligned_free(aPtr); }
+void operator delete[](void* aPtr, std::align_val_t, const std::nothrow_t&) noexcept { _aligned_free(aPtr); }
+#endif
+#endif
+
+namespace EveryRay_Core
+{
+	UINT64 ER_RHI_AllocationsCounter::GetCount()
+	{
+#if ER_RHI_ALLOCATIONS_COUNTER
+		return sAllocationsCount;
+#else
+		return 0;
+#endif
+	}
+
+	namespace
+	{
+		struct ER_RHI_FakeResource { UINT mSlot; };
+
+		// same shape as the old and the new binding methods; called through volatile pointers so the calls (and the vectors) are not optimized away
+		UINT BindByVector(const std::vector<ER_RHI_FakeResource*>& aResources)
+		{
+			UINT sum = 0;
+			for (UINT i = 0; i < static_cast<UINT>(aResources.size()); i++)
+				sum += aResources[i] ? aResources[i]->mSlot : 0;
+			return sum;
+		}
+		UINT BindBySpan(ER_RHI_Span<ER_RHI_FakeResource*> aResources)
+		{
+			UINT sum = 0;
+			for (UINT i = 0; i < aResources.size(); i++)
+				sum += aResources[i] ? aResources[i]->mSlot : 0;
+			return sum;
+		}
+	}
+
+	bool ER_RHI_AllocationsCounter::RunTests()
+	{
+		bool isPassed = true;
+
+		ER_RHI_FakeResource resources[4] = { { 1 }, { 2 }, { 3 }, { 4 } };
+		ER_RHI_FakeResource* a = &resources[0];
+		ER_RHI_FakeResource* b = &resources[1];
+		ER_RHI_FakeResource* c = &resources[2];
+
+		// spans from all sources see the same elements
+		{
+			std::vector<ER_RHI_FakeResource*> vec = { a, b, c };
+			ER_RHI_FakeResource* arr[3] = { a, b, c };
+			ER_RHI_InlineArray<ER_RHI_FakeResource*, 8> inl;
+			inl.push_back(a); inl.push_back(b); inl.push_back(c);
+
+			isPassed &= BindBySpan({ a, b, c }) == 6;
+			isPassed &= BindBySpan(vec) == 6 && BindBySpan(arr) == 6 && BindBySpan(inl) == 6;
+			isPassed &= BindBySpan(ER_RHI_Span<ER_RHI_FakeResource*>(arr + 1, 2)) == 5;
+			isPassed &= BindBySpan({ a, nullptr, c }) == 4 && BindBySpan({}) == 0;
+			isPassed &= ER_RHI_Span<ER_RHI_FakeResource*>(vec).data() == vec.data();
+		}
+
+		// inline array
+		{
+			ER_RHI_InlineArray<ER_RHI_FakeResource*, 8> inl(3);
+			isPassed &= inl.size() == 3 && inl[0] == nullptr && inl[2] == nullptr;
+			inl[1] = b;
+			inl.resize(5, c);
+			isPassed &= inl.size() == 5 && inl[1] == b && inl[3] == c && inl[4] == c;
+			inl.resize(2);
+			isPassed &= inl.size() == 2 && !inl.empty() && !inl.full();
+			inl.clear();
+			isPassed &= inl.empty() && inl.capacity() == 8;
+		}
+
+		// binds with brace lists: a vector allocates every time, a span never
+		if (IsEnabled())
+		{
+			UINT (*volatile bindByVector)(const std::vector<ER_RHI_FakeResource*>&) = &BindByVector;
+			UINT (*volatile bindBySpan)(ER_RHI_Span<ER_RHI_FakeResource*>) = &BindBySpan;
+
+			UINT64 allocationsCount = GetCount();
+			for (int i = 0; i < 100; i++)
+				bindBySpan({ a, b, c, &resources[i % 4] });
+			isPassed &= GetCount() == allocationsCount;
+
+			for (int i = 0; i < 100; i++)
+				bindByVector({ a, b, c, &resources[i % 4] });
+			isPassed &= GetCount() >= allocationsCount + 100;
+
+#ifdef __cpp_aligned_new
+			// over-aligned allocations are counted (and aligned) too
+			struct alignas(64) ER_RHI_FakeAlignedData { float mData[16]; };
+			allocationsCount = GetCount();
+			ER_RHI_FakeAlignedData* alignedData = new ER_RHI_FakeAlignedData[2];
+			isPassed &= GetCount() == allocationsCount + 1 && reinterpret_cast<uintptr_t>(alignedData) % 64 == 0;
+			delete[] alignedData;
+#endif
+		}
+
+		std::wstring msg = L"[ER Logger][ER_RHI_AllocationsCounter] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") +
+			(IsEnabled() ? L"" : L" (heap allocations not checked: ER_RHI_ALLOCATIONS_COUNTER is 0)") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_RHI_AllocationsCounter::Benchmark()
+	{
+		ER_RHI_FakeResource resources[4] = { { 1 }, { 2 }, { 3 }, { 4 } };
+		ER_RHI_FakeResource* a = &resources[0];
+		ER_RHI_FakeResource* b = &resources[1];
+		ER_RHI_FakeResource* c = &resources[2];
+
+		UINT (*volatile bindByVector)(const std::vector<ER_RHI_FakeResource*>&) = &BindByVector;
+		UINT (*volatile bindBySpan)(ER_RHI_Span<ER_RHI_FakeResource*>) = &BindBySpan;
+
+		const int drawsCount = 100000;
+		UINT sumByVector = 0, sumBySpan = 0;
+		UINT64 allocationsByVector = GetCount();
+		auto startTimer = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < drawsCount; i++)
+		{
+			sumByVector += bindByVector({ a, b });
+			sumByVector += bindByVector({ a, b, c, &resources[i % 4] });
+		}
+		std::chrono::duration<double> byVectorTime = std::chrono::high_resolution_clock::now() - startTimer;
+		allocationsByVector = GetCount() - allocationsByVector;
+
+		UINT64 allocationsBySpan = GetCount();
+		startTimer = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < drawsCount; i++)
+		{
+			sumBySpan += bindBySpan({ a, b });
+			sumBySpan += bindBySpan({ a, b, c, &resources[i % 4] });
+		}
+		std::chrono::duration<double> bySpanTime = std::chrono::high_resolution_clock::now() - startTimer;
+		allocationsBySpan = GetCount() - allocationsBySpan;
+
+		assert(sumByVector == sumBySpan);
+
+		std::wstring msg = L"[ER Logger][ER_RHI_AllocationsCounter] Benchmark, " + std::to_wstring(drawsCount * 2) +
+			L" binds: by vector " + std::to_wstring(byVectorTime.count() * 1000.0) + L"ms, by span " + std::to_wstring(bySpanTime.count() * 1000.0) + L"ms; heap allocations: " +
+			(IsEnabled() ? (std::to_wstring(allocationsByVector) + L" by vector, " + std::to_wstring(allocationsBySpan) + L" by span") : std::wstring(L"not counted (ER_RHI_ALLOCATIONS_COUNTER is 0)")) + L"\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+}
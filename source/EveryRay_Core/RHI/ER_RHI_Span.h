@@ -0,0 +1,70 @@
+#pragma once
+#include "..\Common.h"
+#include "..\ER_Span.h"
+
+#define ER_RHI_ALLOCATIONS_COUNTER 0 // set to 1 to replace the global operator new and count heap allocations per thread (see ER_RHI_AllocationsCounter), i.e. to check that binding does not allocate
+
+namespace EveryRay_Core
+{
+	// Fixed-capacity array on the stack with a vector-like interface: for lists of bindings (resources, barriers...) that are built per draw/dispatch
+	template <typename T, UINT N>
+	class ER_RHI_InlineArray
+	{
+	public:
+		ER_RHI_InlineArray() {}
+		explicit ER_RHI_InlineArray(UINT aSize, const T& aValue = T()) { resize(aSize, aValue); }
+
+		void push_back(const T& aValue) { assert(mSize < N); mData[mSize++] = aValue; }
+		void resize(UINT aSize, const T& aValue = T())
+		{
+			assert(aSize <= N);
+			for (UINT i = mSize; i < aSize; i++)
+				mData[i] = aValue;
+			mSize = aSize;
+		}
+		void clear() { mSize = 0; }
+
+		UINT size() const { return mSize; }
+		UINT capacity() const { return N; }
+		bool empty() const { return mSize == 0; }
+		bool full() const { return mSize == N; }
+
+		T& operator[](UINT aIndex) { assert(aIndex < mSize); return mData[aIndex]; }
+		const T& operator[](UINT aIndex) const { assert(aIndex < mSize); return mData[aIndex]; }
+		T* data() { return mData; }
+		const T* data() const { return mData; }
+		T* begin() { return mData; }
+		T* end() { return mData + mSize; }
+		const T* begin() const { return mData; }
+		const T* end() const { return mData + mSize; }
+	private:
+		T mData[N];
+		UINT mSize = 0;
+	};
+
+	// Read-only view of a list of bindings (see ER_Span), used by the ER_RHI binding methods instead of "const std::vector<T>&".
+	// Brace lists at call sites ("{ a, b }") become a std::initializer_list on the stack instead of a heap allocated vector;
+	// vectors, C arrays and ER_RHI_InlineArray convert implicitly. Only use it as a parameter: the array of a brace list is destroyed at the end of the call's full-expression.
+	template <typename T>
+	class ER_RHI_Span : public ER_Span<T>
+	{
+	public:
+		using ER_Span<T>::ER_Span;
+		ER_RHI_Span() {}
+		template <UINT N> ER_RHI_Span(const ER_RHI_InlineArray<T, N>& aArray) : ER_Span<T>(aArray.data(), aArray.size()) {}
+	};
+
+	// Heap allocations made by the calling thread; only counts when ER_RHI_ALLOCATIONS_COUNTER is 1 (otherwise always 0).
+	// Take the difference around the code you want to check, i.e. the draw calls of a frame.
+	class ER_RHI_AllocationsCounter
+	{
+	public:
+		static UINT64 GetCount();
+		static bool IsEnabled() { return ER_RHI_ALLOCATIONS_COUNTER != 0; }
+
+		// Spans from all sources, inline arrays and (if enabled) binding without allocations (see ER_Tests)
+		static bool RunTests();
+		// Per-draw binds with brace lists: the old way (vector) vs. the new one (span)
+		static void Benchmark();
+	};
+}
@@ -0,0 +1,746 @@
+#include "ER_RHI_Null.h"
+#include "ER_RHI_Null_GPUBuffer.h"
+#include "ER_RHI_Null_GPUTexture.h"
+#include "ER_RHI_Null_GPUShader.h"
+#include "..\..\ER_Utility.h"
+
+#include <atomic>
+
+namespace EveryRay_Core
+{
+	static std::atomic<UINT> sNullResourcesCount{ 0 };
+
+	ER_RHI_Null::ER_RHI_Null()
+	{
+		mAPI = ER_GRAPHICS_API::NULL_RHI;
+	}
+
+	ER_RHI_Null::~ER_RHI_Null()
+	{
+	}
+
+	bool ER_RHI_Null::Initialize(HWND windowHandle, UINT width, UINT height, bool isFullscreen, bool isReset)
+	{
+		mWindowHandle = windowHandle;
+		mIsFullScreen = isFullscreen;
+
+		mMainViewport.TopLeftX = 0.0f;
+		mMainViewport.TopLeftY = 0.0f;
+		mMainViewport.Width = static_cast<float>(width);
+		mMainViewport.Height = static_cast<float>(height);
+		mMainViewport.MinDepth = 0.0f;
+		mMainViewport.MaxDepth = 1.0f;
+		mCurrentViewport = mMainViewport;
+		mCurrentRect = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+
+		mCurrentRS = ER_RHI_RASTERIZER_STATE::ER_BACK_CULLING;
+		mCurrentBS = ER_RHI_BLEND_STATE::ER_NO_BLEND;
+		mCurrentDS = ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL;
+
+		ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_Null] Initialized null RHI: no device, commands are only recorded. \n");
+		return true;
+	}
+
+	UINT ER_RHI_Null::GenerateResourceId()
+	{
+		return ++sNullResourcesCount;
+	}
+
+	UINT ER_RHI_Null::GetResourceId(ER_RHI_GPUResource* aResource)
+	{
+		if (!aResource)
+			return 0;
+		return aResource->IsBuffer() ? static_cast<ER_RHI_Null_GPUBuffer*>(aResource)->GetId() : static_cast<ER_RHI_Null_GPUTexture*>(aResource)->GetId();
+	}
+
+	UINT* ER_RHI_Null::RecordCommand(ER_RHI_NULL_COMMAND aType, UINT aPayloadWordsCount)
+	{
+		assert(aPayloadWordsCount < (1 << 24));
+
+		const size_t offset = mCommandStream.size();
+		mCommandStream.resize(offset + 1 + aPayloadWordsCount);
+		mCommandStream[offset] = (static_cast<UINT>(aType) << 24) | aPayloadWordsCount;
+		mFrameStats.commands[aType]++;
+		return mCommandStream.data() + offset + 1;
+	}
+
+	void ER_RHI_Null::RecordState(ER_RHI_NULL_STATE aState, UINT aValue)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_STATE, 2);
+		payload[0] = static_cast<UINT>(aState);
+		payload[1] = aValue;
+		mFrameStats.stateChanges++;
+	}
+
+	void ER_RHI_Null::RecordBufferUpdate(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int aDataSize)
+	{
+		assert(aBuffer);
+		static_cast<ER_RHI_Null_GPUBuffer*>(aBuffer)->Update(aData, aOffset, aDataSize);
+
+		UINT* payload = RecordCommand(ER_NULL_CMD_UPDATE_BUFFER, 3);
+		payload[0] = GetResourceId(aBuffer);
+		payload[1] = static_cast<UINT>(aOffset);
+		payload[2] = static_cast<UINT>(aDataSize);
+		mFrameStats.bufferUpdates++;
+		mFrameStats.bufferUpdateBytes += aDataSize;
+	}
+
+	void ER_RHI_Null::ForEachCommand(const std::vector<UINT>& aCommandStream, const std::function<void(ER_RHI_NULL_COMMAND, const UINT*, UINT)>& aCallback)
+	{
+		size_t offset = 0;
+		while (offset < aCommandStream.size())
+		{
+			const UINT header = aCommandStream[offset];
+			const UINT payloadWordsCount = header & 0xffffff;
+			assert(offset + 1 + payloadWordsCount <= aCommandStream.size());
+
+			aCallback(static_cast<ER_RHI_NULL_COMMAND>(header >> 24), aCommandStream.data() + offset + 1, payloadWordsCount);
+			offset += 1 + payloadWordsCount;
+		}
+	}
+
+	void ER_RHI_Null::ClearMainRenderTarget(float colors[4])
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_CLEAR, 2);
+		payload[0] = ER_RHI_NULL_MAIN_TARGET_ID;
+		payload[1] = 0;
+	}
+
+	void ER_RHI_Null::ClearMainDepthStencilTarget(float depth, UINT stencil)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_CLEAR, 2);
+		payload[0] = ER_RHI_NULL_MAIN_TARGET_ID;
+		payload[1] = 0;
+	}
+
+	void ER_RHI_Null::ClearRenderTarget(ER_RHI_GPUTexture* aRenderTarget, float colors[4], int rtvArrayIndex)
+	{
+		assert(aRenderTarget);
+		UINT* payload = RecordCommand(ER_NULL_CMD_CLEAR, 2);
+		payload[0] = GetResourceId(aRenderTarget);
+		payload[1] = static_cast<UINT>(rtvArrayIndex);
+	}
+
+	void ER_RHI_Null::ClearDepthStencilTarget(ER_RHI_GPUTexture* aDepthTarget, float depth, UINT stencil)
+	{
+		assert(aDepthTarget);
+		UINT* payload = RecordCommand(ER_NULL_CMD_CLEAR, 2);
+		payload[0] = GetResourceId(aDepthTarget);
+		payload[1] = 0;
+	}
+
+	void ER_RHI_Null::ClearUAV(ER_RHI_GPUResource* aRenderTarget, float colors[4])
+	{
+		assert(aRenderTarget);
+		UINT* payload = RecordCommand(ER_NULL_CMD_CLEAR, 2);
+		payload[0] = GetResourceId(aRenderTarget);
+		payload[1] = 0;
+	}
+
+	void ER_RHI_Null::ClearUAV(ER_RHI_GPUBuffer* aBuffer, UINT clear)
+	{
+		assert(aBuffer);
+		UINT* payload = RecordCommand(ER_NULL_CMD_CLEAR, 2);
+		payload[0] = GetResourceId(aBuffer);
+		payload[1] = 0;
+	}
+
+	ER_RHI_GPUShader* ER_RHI_Null::CreateGPUShader()
+	{
+		return new ER_RHI_Null_GPUShader();
+	}
+
+	ER_RHI_GPUBuffer* ER_RHI_Null::CreateGPUBuffer(const std::string& aDebugName)
+	{
+		return new ER_RHI_Null_GPUBuffer(aDebugName);
+	}
+
+	ER_RHI_GPUTexture* ER_RHI_Null::CreateGPUTexture(const std::wstring& aDebugName)
+	{
+		return new ER_RHI_Null_GPUTexture(aDebugName);
+	}
+
+	ER_RHI_InputLayout* ER_RHI_Null::CreateInputLayout(ER_RHI_INPUT_ELEMENT_DESC* inputElementDescriptions, UINT inputElementDescriptionCount)
+	{
+		return new ER_RHI_InputLayout(inputElementDescriptions, inputElementDescriptionCount);
+	}
+
+	void ER_RHI_Null::CreateTexture(ER_RHI_GPUTexture* aOutTexture, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags, int mip, int depth, int arraySize, bool isCubemap, int cubemapArraySize)
+	{
+		assert(aOutTexture);
+		aOutTexture->CreateGPUTextureResource(this, width, height, samples, format, bindFlags, mip, depth, arraySize, isCubemap, cubemapArraySize);
+	}
+
+	void ER_RHI_Null::CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::string& aPath, bool isFullPath)
+	{
+		assert(aOutTexture);
+		aOutTexture->CreateGPUTextureResource(this, aPath, isFullPath);
+	}
+
+	void ER_RHI_Null::CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::wstring& aPath, bool isFullPath)
+	{
+		assert(aOutTexture);
+		aOutTexture->CreateGPUTextureResource(this, aPath, isFullPath);
+	}
+
+	void ER_RHI_Null::CreateBuffer(ER_RHI_GPUBuffer* aOutBuffer, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic, ER_RHI_BIND_FLAG bindFlags, UINT cpuAccessFlags, ER_RHI_RESOURCE_MISC_FLAG miscFlags, ER_RHI_FORMAT format)
+	{
+		assert(aOutBuffer);
+		aOutBuffer->CreateGPUBufferResource(this, aData, objectsCount, byteStride, isDynamic, bindFlags, cpuAccessFlags, miscFlags, format);
+	}
+
+	void ER_RHI_Null::CopyBuffer(ER_RHI_GPUBuffer* aDestBuffer, ER_RHI_GPUBuffer* aSrcBuffer, int cmdListIndex, bool isInCopyQueue)
+	{
+		assert(aDestBuffer && aSrcBuffer);
+		UINT* payload = RecordCommand(ER_NULL_CMD_COPY, 2);
+		payload[0] = GetResourceId(aDestBuffer);
+		payload[1] = GetResourceId(aSrcBuffer);
+	}
+
+	// returns the CPU memory of the buffer: what was uploaded, GPU writes are not executed
+	void ER_RHI_Null::BeginBufferRead(ER_RHI_GPUBuffer* aBuffer, void** output)
+	{
+		assert(aBuffer);
+		assert(output);
+		*output = static_cast<ER_RHI_Null_GPUBuffer*>(aBuffer)->GetData();
+	}
+
+	void ER_RHI_Null::CopyGPUTextureSubresourceRegion(ER_RHI_GPUResource* aDestBuffer, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ER_RHI_GPUResource* aSrcBuffer, UINT SrcSubresource, bool isInCopyQueueOrSkipTransitions)
+	{
+		assert(aDestBuffer && aSrcBuffer);
+		UINT* payload = RecordCommand(ER_NULL_CMD_COPY, 2);
+		payload[0] = GetResourceId(aDestBuffer);
+		payload[1] = GetResourceId(aSrcBuffer);
+	}
+
+	void ER_RHI_Null::Draw(UINT VertexCount)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_DRAW, 1);
+		payload[0] = VertexCount;
+		mFrameStats.draws++;
+	}
+
+	void ER_RHI_Null::DrawIndexed(UINT IndexCount)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_DRAW_INDEXED, 1);
+		payload[0] = IndexCount;
+		mFrameStats.draws++;
+	}
+
+	void ER_RHI_Null::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_DRAW_INSTANCED, 4);
+		payload[0] = VertexCountPerInstance;
+		payload[1] = InstanceCount;
+		payload[2] = StartVertexLocation;
+		payload[3] = StartInstanceLocation;
+		mFrameStats.draws++;
+	}
+
+	void ER_RHI_Null::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_DRAW_INDEXED_INSTANCED, 5);
+		payload[0] = IndexCountPerInstance;
+		payload[1] = InstanceCount;
+		payload[2] = StartIndexLocation;
+		payload[3] = static_cast<UINT>(BaseVertexLocation);
+		payload[4] = StartInstanceLocation;
+		mFrameStats.draws++;
+	}
+
+	void ER_RHI_Null::DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* anArgsBuffer, UINT alignedByteOffset)
+	{
+		assert(anArgsBuffer);
+		UINT* payload = RecordCommand(ER_NULL_CMD_DRAW_INDEXED_INSTANCED_INDIRECT, 2);
+		payload[0] = GetResourceId(anArgsBuffer);
+		payload[1] = alignedByteOffset;
+		mFrameStats.draws++;
+	}
+
+	void ER_RHI_Null::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_DISPATCH, 3);
+		payload[0] = ThreadGroupCountX;
+		payload[1] = ThreadGroupCountY;
+		payload[2] = ThreadGroupCountZ;
+		mFrameStats.dispatches++;
+	}
+
+	void ER_RHI_Null::GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture)
+	{
+		assert(aTexture);
+		UINT* payload = RecordCommand(ER_NULL_CMD_GENERATE_MIPS, 1);
+		payload[0] = GetResourceId(aTexture);
+	}
+
+	// End of the frame: keeps its commands and counters for GetLastFrame...() and starts a new stream in the memory of the frame before
+	void ER_RHI_Null::PresentGraphics()
+	{
+		assert(mEventTagsDepth == 0);
+
+		mFrameStats.commandStreamBytes = mCommandStream.size() * sizeof(UINT);
+		mLastFrameStats = mFrameStats;
+		mFrameStats = {};
+
+		std::swap(mCommandStream, mLastFrameCommandStream);
+		mCommandStream.clear();
+	}
+
+	void ER_RHI_Null::SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName)
+	{
+		std::wstring msg = L"[ER Logger][ER_RHI_Null] Could not save a texture to file (no texel data in null RHI): " + aPathName + L"\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+
+	void ER_RHI_Null::SetMainRenderTargets(int cmdListIndex)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_RENDER_TARGETS, 4);
+		payload[0] = ER_RHI_NULL_MAIN_TARGET_ID;
+		payload[1] = 0;
+		payload[2] = static_cast<UINT>(-1);
+		payload[3] = ER_RHI_NULL_MAIN_TARGET_ID;
+		mFrameStats.bindCalls++;
+		mFrameStats.boundObjects += 2;
+	}
+
+	void ER_RHI_Null::SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, ER_RHI_GPUTexture* aUAV, int rtvArrayIndex)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_RENDER_TARGETS, 3 + aRenderTargets.size());
+		payload[0] = GetResourceId(aDepthTarget);
+		payload[1] = GetResourceId(aUAV);
+		payload[2] = static_cast<UINT>(rtvArrayIndex);
+		for (UINT i = 0; i < aRenderTargets.size(); i++)
+			payload[3 + i] = GetResourceId(aRenderTargets[i]);
+		mFrameStats.bindCalls++;
+		mFrameStats.boundObjects += aRenderTargets.size() + (aDepthTarget ? 1 : 0) + (aUAV ? 1 : 0);
+
+		for (UINT i = 0; i < aRenderTargets.size(); i++)
+			TransitionResources({ static_cast<ER_RHI_GPUResource*>(aRenderTargets[i]) }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET);
+		if (aDepthTarget)
+			TransitionResources({ static_cast<ER_RHI_GPUResource*>(aDepthTarget) }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE);
+	}
+
+	void ER_RHI_Null::SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget)
+	{
+		SetRenderTargets({}, aDepthTarget);
+	}
+
+	void ER_RHI_Null::SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef)
+	{
+		mCurrentDS = aDS;
+		RecordState(ER_NULL_STATE_DEPTH_STENCIL, static_cast<UINT>(aDS));
+	}
+
+	void ER_RHI_Null::SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4], UINT SampleMask)
+	{
+		mCurrentBS = aBS;
+		RecordState(ER_NULL_STATE_BLEND, static_cast<UINT>(aBS));
+	}
+
+	void ER_RHI_Null::SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS)
+	{
+		mCurrentRS = aRS;
+		RecordState(ER_NULL_STATE_RASTERIZER, static_cast<UINT>(aRS));
+	}
+
+	void ER_RHI_Null::SetViewport(const ER_RHI_Viewport& aViewport)
+	{
+		mCurrentViewport = aViewport;
+		RecordState(ER_NULL_STATE_VIEWPORT, static_cast<UINT>(aViewport.Width) << 16 | static_cast<UINT>(aViewport.Height));
+	}
+
+	void ER_RHI_Null::SetRect(const ER_RHI_Rect& rect)
+	{
+		mCurrentRect = rect;
+		RecordState(ER_NULL_STATE_RECT, static_cast<UINT>(rect.right - rect.left) << 16 | static_cast<UINT>(rect.bottom - rect.top));
+	}
+
+	// automatic transitions are the same as on DX12, so the counters are comparable
+	void ER_RHI_Null::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot,
+		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
+	{
+		RecordBinding(ER_NULL_CMD_SET_SHADER_RESOURCES, aShaderType, startSlot, aSRVs);
+		if (!skipAutomaticTransition && aSRVs.size() > 0)
+			TransitionResources(aSRVs, aShaderType == ER_RHI_SHADER_TYPE::ER_PIXEL ? ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE : ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	}
+
+	void ER_RHI_Null::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot,
+		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
+	{
+		RecordBinding(ER_NULL_CMD_SET_UNORDERED_ACCESS_RESOURCES, aShaderType, startSlot, aUAVs);
+		if (!skipAutomaticTransition && aUAVs.size() > 0)
+			TransitionResources(aUAVs, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_UNORDERED_ACCESS);
+	}
+
+	void ER_RHI_Null::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot,
+		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS)
+	{
+		RecordBinding(ER_NULL_CMD_SET_CONSTANT_BUFFERS, aShaderType, startSlot, aCBs);
+	}
+
+	void ER_RHI_Null::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot, ER_RHI_GPURootSignature* rs)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_SAMPLERS, 2 + aSamplers.size());
+		payload[0] = static_cast<UINT>(aShaderType);
+		payload[1] = startSlot;
+		for (UINT i = 0; i < aSamplers.size(); i++)
+			payload[2 + i] = static_cast<UINT>(aSamplers[i]);
+		mFrameStats.bindCalls++;
+		mFrameStats.boundObjects += aSamplers.size();
+	}
+
+	void ER_RHI_Null::SetShader(ER_RHI_GPUShader* aShader)
+	{
+		assert(aShader);
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_SHADER, 1);
+		payload[0] = static_cast<UINT>(aShader->mShaderType);
+	}
+
+	void ER_RHI_Null::SetInputLayout(ER_RHI_InputLayout* aIL)
+	{
+		assert(aIL);
+		RecordState(ER_NULL_STATE_INPUT_LAYOUT, aIL->mInputElementDescriptionCount);
+	}
+
+	void ER_RHI_Null::SetEmptyInputLayout()
+	{
+		RecordState(ER_NULL_STATE_INPUT_LAYOUT, 0);
+	}
+
+	void ER_RHI_Null::SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset)
+	{
+		assert(aBuffer);
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_INDEX_BUFFER, 2);
+		payload[0] = GetResourceId(aBuffer);
+		payload[1] = offset;
+		mFrameStats.bindCalls++;
+		mFrameStats.boundObjects++;
+	}
+
+	void ER_RHI_Null::SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers)
+	{
+		assert(aVertexBuffers.size() > 0 && aVertexBuffers.size() <= ER_RHI_MAX_BOUND_VERTEX_BUFFERS);
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_VERTEX_BUFFERS, aVertexBuffers.size());
+		for (UINT i = 0; i < aVertexBuffers.size(); i++)
+			payload[i] = GetResourceId(aVertexBuffers[i]);
+		mFrameStats.bindCalls++;
+		mFrameStats.boundObjects += aVertexBuffers.size();
+	}
+
+	void ER_RHI_Null::SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType)
+	{
+		mCurrentTopologyType = aType;
+		RecordState(ER_NULL_STATE_TOPOLOGY, static_cast<UINT>(aType));
+	}
+
+	void ER_RHI_Null::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
+	{
+		assert(aResources.size() > 0 && aResources.size() == aStates.size());
+		for (UINT i = 0; i < aResources.size(); i++)
+			TransitionResources({ aResources[i] }, aStates[i], cmdListIndex, isCopyQueue, subresourceIndex);
+	}
+
+	// like on DX12: resources already in the state are skipped and "non pixel shader resource" is good enough for pixel shaders
+	void ER_RHI_Null::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
+	{
+		UINT transitionsCount = 0;
+		for (UINT i = 0; i < aResources.size(); i++)
+		{
+			ER_RHI_GPUResource* resource = aResources[i];
+			if (!resource || resource->GetCurrentState() == aState)
+				continue;
+			if (aState == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE && resource->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+				continue;
+
+			if (transitionsCount == 0)
+			{
+				UINT* payload = RecordCommand(ER_NULL_CMD_TRANSITION, 2);
+				payload[0] = static_cast<UINT>(aState);
+				payload[1] = static_cast<UINT>(subresourceIndex);
+			}
+			// resource ids are appended to the transition command that was just recorded
+			mCommandStream.push_back(GetResourceId(resource));
+			transitionsCount++;
+
+			resource->SetCurrentState(aState);
+		}
+
+		if (transitionsCount > 0)
+		{
+			UINT& header = mCommandStream[mCommandStream.size() - 3 - transitionsCount];
+			header += transitionsCount;
+			mFrameStats.transitions += transitionsCount;
+		}
+	}
+
+	bool ER_RHI_Null::IsPSOReady(ER_RHI_PSO_HANDLE aHandle)
+	{
+		assert(mPSORegistry.IsValid(aHandle));
+		return aHandle < static_cast<int>(mReadyPSOs.size()) && mReadyPSOs[aHandle];
+	}
+
+	void ER_RHI_Null::InitializePSO(ER_RHI_PSO_HANDLE aHandle)
+	{
+		assert(mPSORegistry.IsValid(aHandle));
+		if (aHandle >= static_cast<int>(mReadyPSOs.size()))
+			mReadyPSOs.resize(mPSORegistry.GetHandlesCount(), false);
+		mReadyPSOs[aHandle] = true;
+	}
+
+	void ER_RHI_Null::SetPSO(ER_RHI_PSO_HANDLE aHandle)
+	{
+		mPSOStats.sets++;
+		if (!IsPSOReady(aHandle))
+			InitializePSO(aHandle);
+
+		ER_RHI_PSO_HANDLE& currentPSO = mPSORegistry.IsCompute(aHandle) ? mCurrentComputePSO : mCurrentGraphicsPSO;
+		if (currentPSO == aHandle)
+		{
+			mPSOStats.redundantSets++;
+			return;
+		}
+
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_PSO, 1);
+		payload[0] = static_cast<UINT>(aHandle);
+		currentPSO = aHandle;
+		mPSOStats.switches++;
+	}
+
+	void ER_RHI_Null::UnsetPSO()
+	{
+		mCurrentGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		mCurrentComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+	}
+
+	void ER_RHI_Null::UnbindRenderTargets()
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_SET_RENDER_TARGETS, 3);
+		payload[2] = static_cast<UINT>(-1);
+		mFrameStats.bindCalls++;
+	}
+
+	void ER_RHI_Null::UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_UNBIND_RESOURCES, 2);
+		payload[0] = static_cast<UINT>(aShaderType);
+		payload[1] = unbindShader ? 1 : 0;
+		mFrameStats.bindCalls++;
+	}
+
+	void ER_RHI_Null::UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers)
+	{
+		RecordBufferUpdate(aBuffer, aData, 0, dataSize);
+	}
+
+	void ER_RHI_Null::UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize)
+	{
+		RecordBufferUpdate(aBuffer, aData, aOffset, dataSize);
+	}
+
+	// there is no renderer backend for ImGui: the font atlas is only built on CPU (ImGui::NewFrame() needs it) and the draw commands are recorded as indexed draws
+	void ER_RHI_Null::InitImGui()
+	{
+		ImGuiIO& io = ImGui::GetIO();
+		io.BackendRendererName = "imgui_impl_null";
+
+		unsigned char* pixels = nullptr;
+		int width = 0, height = 0;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	}
+
+	void ER_RHI_Null::RenderDrawDataImGui(int cmdListIndex)
+	{
+		ImDrawData* drawData = ImGui::GetDrawData();
+		if (!drawData)
+			return;
+
+		for (int i = 0; i < drawData->CmdListsCount; i++)
+		{
+			const ImDrawList* cmdList = drawData->CmdLists[i];
+			for (int j = 0; j < cmdList->CmdBuffer.Size; j++)
+				if (!cmdList->CmdBuffer[j].UserCallback)
+					DrawIndexed(cmdList->CmdBuffer[j].ElemCount);
+		}
+	}
+
+	void ER_RHI_Null::BeginEventTag(const std::string& aName, bool isComputeQueue)
+	{
+		UINT* payload = RecordCommand(ER_NULL_CMD_EVENT_TAG, 1);
+		payload[0] = 1;
+		mEventTagsDepth++;
+	}
+
+	void ER_RHI_Null::EndEventTag(bool isComputeQueue)
+	{
+		assert(mEventTagsDepth > 0);
+		UINT* payload = RecordCommand(ER_NULL_CMD_EVENT_TAG, 1);
+		payload[0] = 0;
+		mEventTagsDepth--;
+	}
+
+	bool ER_RHI_Null::RunTests()
+	{
+		bool isPassed = true;
+
+		ER_RHI_Null rhi;
+		isPassed &= rhi.Initialize(nullptr, 1920, 1080, false) && rhi.GetAPI() == ER_GRAPHICS_API::NULL_RHI;
+
+		// CPU buffers: creation data, updates of the whole buffer and of a range
+		UINT initData[4] = { 1, 2, 3, 4 };
+		ER_RHI_GPUBuffer* buffer = rhi.CreateGPUBuffer("ER_RHI_Null test buffer");
+		buffer->CreateGPUBufferResource(&rhi, initData, 4, sizeof(UINT), true, ER_BIND_CONSTANT_BUFFER | ER_BIND_SHADER_RESOURCE);
+		ER_RHI_GPUBuffer* emptyBuffer = rhi.CreateGPUBuffer("ER_RHI_Null test empty buffer");
+		emptyBuffer->CreateGPUBufferResource(&rhi, nullptr, 2, sizeof(UINT), false, ER_BIND_VERTEX_BUFFER);
+		{
+			UINT* data = nullptr;
+			rhi.BeginBufferRead(buffer, (void**)&data);
+			isPassed &= buffer->GetSize() == 16 && data && data[0] == 1 && data[3] == 4;
+			rhi.EndBufferRead(buffer);
+
+			rhi.BeginBufferRead(emptyBuffer, (void**)&data);
+			isPassed &= data && data[0] == 0 && data[1] == 0;
+			rhi.EndBufferRead(emptyBuffer);
+
+			isPassed &= buffer->GetSRV() != nullptr && buffer->GetUAV() == nullptr && GetResourceId(buffer) != 0 && GetResourceId(buffer) != GetResourceId(emptyBuffer);
+		}
+
+		ER_RHI_GPUTexture* renderTarget = rhi.CreateGPUTexture(L"ER_RHI_Null test render target");
+		renderTarget->CreateGPUTextureResource(&rhi, 64, 32, 1, ER_FORMAT_R8G8B8A8_UNORM, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 3);
+		ER_RHI_GPUTexture* depthTarget = rhi.CreateGPUTexture(L"ER_RHI_Null test depth target");
+		depthTarget->CreateGPUTextureResource(&rhi, 64, 32, 1, ER_FORMAT_D24_UNORM_S8_UINT, ER_BIND_DEPTH_STENCIL);
+		isPassed &= renderTarget->GetWidth() == 64 && renderTarget->GetHeight() == 32 && renderTarget->GetMips() == 3;
+		isPassed &= renderTarget->GetRTV() != nullptr && renderTarget->GetUAV() == nullptr && depthTarget->GetDSV() != nullptr && depthTarget->GetSRV() == nullptr;
+
+		ER_RHI_GPUShader* shader = rhi.CreateGPUShader();
+		shader->CompileShader(&rhi, "content\\shaders\\Test.hlsl", "PSMain", ER_PIXEL);
+		isPassed &= shader->GetShaderObject() != nullptr;
+
+		const ER_RHI_PSO_HANDLE psoHandle = rhi.GetPSOHandle("ER_RHI_Null test PSO");
+		isPassed &= !rhi.IsPSOReady(psoHandle);
+		rhi.InitializePSO(psoHandle);
+		isPassed &= rhi.IsPSOReady(psoHandle);
+
+		// a frame: states, targets, bindings (with automatic transitions), updates and draws
+		UINT newData[2] = { 7, 8 };
+		auto recordFrame = [&]()
+		{
+			rhi.BeginGraphicsCommandList();
+			rhi.BeginEventTag("Test pass"); // short enough for the small string buffer, a longer name would be a heap allocation on the caller's side
+			rhi.SetPSO(psoHandle);
+			rhi.SetPSO(psoHandle);
+			rhi.SetRenderTargets({ renderTarget }, depthTarget);
+			rhi.SetShader(shader);
+			rhi.SetShaderResources(ER_PIXEL, { buffer, nullptr, emptyBuffer });
+			rhi.SetConstantBuffers(ER_PIXEL, { buffer }, 1);
+			rhi.SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS });
+			rhi.SetVertexBuffers({ emptyBuffer });
+			rhi.SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			rhi.UpdateBufferRange(buffer, newData, sizeof(UINT), sizeof(newData));
+			rhi.DrawIndexedInstanced(36, 10, 0, 0, 0);
+			rhi.Draw(3);
+			rhi.UnbindRenderTargets();
+			rhi.SetShaderResources(ER_PIXEL, { renderTarget });
+			rhi.Dispatch(8, 8, 1);
+			rhi.EndEventTag();
+			rhi.EndGraphicsCommandList();
+			rhi.PresentGraphics();
+		};
+		recordFrame();
+
+		{
+			const ER_RHI_NullFrameStats& stats = rhi.GetLastFrameStats();
+			isPassed &= stats.draws == 2 && stats.dispatches == 1;
+			isPassed &= stats.bindCalls == 7 && stats.boundObjects == 10; // targets (2), srvs (3), cb (1), samplers (2), vb (1), unbind (0), srv (1)
+			isPassed &= stats.transitions == 5; // rt, depth, 2 buffers to ps resource, rt to ps resource
+			isPassed &= stats.bufferUpdates == 1 && stats.bufferUpdateBytes == sizeof(newData);
+			isPassed &= stats.commands[ER_NULL_CMD_SET_PSO] == 1;
+			rhi.EndPSOStatsFrame();
+			isPassed &= rhi.GetPSOStats().sets == 2 && rhi.GetPSOStats().switches == 1 && rhi.GetPSOStats().redundantSets == 1;
+			isPassed &= renderTarget->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+			isPassed &= depthTarget->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+			isPassed &= stats.commandStreamBytes == rhi.GetLastFrameCommandStream().size() * sizeof(UINT);
+
+			UINT* data = nullptr;
+			rhi.BeginBufferRead(buffer, (void**)&data);
+			isPassed &= data[0] == 1 && data[1] == 7 && data[2] == 8 && data[3] == 4;
+			rhi.EndBufferRead(buffer);
+
+			// the stream decodes back to the commands in the order they were recorded
+			std::vector<ER_RHI_NULL_COMMAND> commands;
+			UINT drawnInstances = 0;
+			UINT transitionedResources = 0;
+			ForEachCommand(rhi.GetLastFrameCommandStream(), [&](ER_RHI_NULL_COMMAND aType, const UINT* aPayload, UINT aPayloadWordsCount)
+			{
+				commands.push_back(aType);
+				if (aType == ER_NULL_CMD_DRAW_INDEXED_INSTANCED)
+					drawnInstances += aPayload[1];
+				else if (aType == ER_NULL_CMD_TRANSITION)
+					transitionedResources += aPayloadWordsCount - 2;
+				else if (aType == ER_NULL_CMD_SET_SHADER_RESOURCES && aPayloadWordsCount == 5)
+					isPassed &= aPayload[0] == ER_PIXEL && aPayload[2] == GetResourceId(buffer) && aPayload[3] == 0 && aPayload[4] == GetResourceId(emptyBuffer);
+			});
+			isPassed &= commands.size() > 2 && commands.front() == ER_NULL_CMD_EVENT_TAG && commands[1] == ER_NULL_CMD_SET_PSO && commands.back() == ER_NULL_CMD_EVENT_TAG;
+			isPassed &= drawnInstances == 10 && transitionedResources == stats.transitions;
+		}
+
+		// the next frame is recorded without heap allocations (the streams are reused) and resources in their states are not transitioned again
+		{
+			recordFrame();
+			const UINT64 startAllocationsCount = ER_RHI_AllocationsCounter::GetCount();
+			recordFrame();
+			const UINT64 allocationsCount = ER_RHI_AllocationsCounter::GetCount() - startAllocationsCount;
+			isPassed &= allocationsCount == 0;
+
+			const ER_RHI_NullFrameStats& stats = rhi.GetLastFrameStats();
+			isPassed &= stats.draws == 2 && stats.transitions == 2; // rt back to render target and then to ps resource
+			isPassed &= stats.commands[ER_NULL_CMD_SET_PSO] == 0; // still set from the previous frame
+		}
+
+		DeleteObject(shader);
+		DeleteObject(depthTarget);
+		DeleteObject(renderTarget);
+		DeleteObject(emptyBuffer);
+		DeleteObject(buffer);
+
+		std::wstring msg = L"[ER Logger][ER_RHI_Null] Tests " + std::wstring(isPassed ? L"passed" : L"FAILED!") + L'\n';
+		ER_OUTPUT_LOG(msg.c_str());
+		assert(isPassed);
+		return isPassed;
+	}
+
+	void ER_RHI_Null::Benchmark()
+	{
+		ER_RHI_Null rhi;
+		rhi.Initialize(nullptr, 1920, 1080, false);
+
+		UINT initData[4] = { 1, 2, 3, 4 };
+		ER_RHI_GPUBuffer* buffer = rhi.CreateGPUBuffer("ER_RHI_Null benchmark buffer");
+		buffer->CreateGPUBufferResource(&rhi, initData, 4, sizeof(UINT), true, ER_BIND_CONSTANT_BUFFER | ER_BIND_SHADER_RESOURCE);
+		ER_RHI_GPUBuffer* vertexBuffer = rhi.CreateGPUBuffer("ER_RHI_Null benchmark vertex buffer");
+		vertexBuffer->CreateGPUBufferResource(&rhi, nullptr, 2, sizeof(UINT), false, ER_BIND_VERTEX_BUFFER);
+		const ER_RHI_PSO_HANDLE psoHandle = rhi.GetPSOHandle("ER_RHI_Null benchmark PSO");
+		rhi.InitializePSO(psoHandle);
+
+		const int drawsCount = 100000;
+		auto startTimer = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < drawsCount; i++)
+		{
+			rhi.SetPSO(psoHandle);
+			rhi.SetVertexBuffers({ vertexBuffer });
+			rhi.SetShaderResources(ER_PIXEL, { buffer, vertexBuffer });
+			rhi.SetConstantBuffers(ER_PIXEL, { buffer });
+			rhi.UpdateBuffer(buffer, initData, sizeof(initData));
+			rhi.DrawIndexedInstanced(36, 1, 0, 0, 0);
+		}
+		rhi.PresentGraphics();
+		std::chrono::duration<double> recordingTime = std::chrono::high_resolution_clock::now() - startTimer;
+		assert(rhi.GetLastFrameStats().draws == drawsCount);
+
+		DeleteObject(vertexBuffer);
+		DeleteObject(buffer);
+
+		std::wstring msg = L"[ER Logger][ER_RHI_Null] Benchmark, recording " + std::to_wstring(drawsCount) +
+			L" draws: " + std::to_wstring(recordingTime.count() * 1000.0) + L"ms, " + std::to_wstring(rhi.GetLastFrameStats().commandStreamBytes / 1024) + L"KB of commands\n";
+		ER_OUTPUT_LOG(msg.c_str());
+	}
+}
@@ -0,0 +1,248 @@
+#pragma once
+#include "..\ER_RHI.h"
+
+#define ER_RHI_NULL_MAIN_TARGET_ID 0xffffffff // id of the main render target and depth target in the command stream (they are not ER_RHI_GPUTextures)
+
+namespace EveryRay_Core
+{
+	// Commands of the null RHI stream: every command is a header word ("type << 24 | payload words count") followed by its payload words.
+	// Resources are written as their ids (see ER_RHI_Null::GetResourceId()), 0 is "null".
+	enum ER_RHI_NULL_COMMAND
+	{
+		ER_NULL_CMD_CLEAR, // resource, array index
+		ER_NULL_CMD_DRAW, // vertex count
+		ER_NULL_CMD_DRAW_INDEXED, // index count
+		ER_NULL_CMD_DRAW_INSTANCED, // vertex count per instance, instance count, start vertex, start instance
+		ER_NULL_CMD_DRAW_INDEXED_INSTANCED, // index count per instance, instance count, start index, base vertex, start instance
+		ER_NULL_CMD_DRAW_INDEXED_INSTANCED_INDIRECT, // args buffer, offset
+		ER_NULL_CMD_DISPATCH, // thread groups x, y, z
+		ER_NULL_CMD_SET_RENDER_TARGETS, // depth target, uav, array index, render targets...
+		ER_NULL_CMD_SET_SHADER_RESOURCES, // shader type, start slot, resources...
+		ER_NULL_CMD_SET_UNORDERED_ACCESS_RESOURCES, // shader type, start slot, resources...
+		ER_NULL_CMD_SET_CONSTANT_BUFFERS, // shader type, start slot, buffers...
+		ER_NULL_CMD_SET_SAMPLERS, // shader type, start slot, sampler states...
+		ER_NULL_CMD_SET_VERTEX_BUFFERS, // buffers...
+		ER_NULL_CMD_SET_INDEX_BUFFER, // buffer, offset
+		ER_NULL_CMD_SET_SHADER, // shader type
+		ER_NULL_CMD_UNBIND_RESOURCES, // shader type, 1 if the shader is unbound too
+		ER_NULL_CMD_SET_PSO, // handle
+		ER_NULL_CMD_SET_STATE, // ER_RHI_NULL_STATE, value
+		ER_NULL_CMD_TRANSITION, // state, subresource, resources...
+		ER_NULL_CMD_UPDATE_BUFFER, // buffer, offset, size
+		ER_NULL_CMD_COPY, // destination, source
+		ER_NULL_CMD_GENERATE_MIPS, // texture
+		ER_NULL_CMD_EVENT_TAG, // 1 for begin, 0 for end
+		ER_NULL_CMD_COUNT
+	};
+
+	enum ER_RHI_NULL_STATE
+	{
+		ER_NULL_STATE_DEPTH_STENCIL,
+		ER_NULL_STATE_BLEND,
+		ER_NULL_STATE_RASTERIZER,
+		ER_NULL_STATE_TOPOLOGY,
+		ER_NULL_STATE_INPUT_LAYOUT,
+		ER_NULL_STATE_VIEWPORT,
+		ER_NULL_STATE_RECT
+	};
+
+	// Counters of one frame (between two PresentGraphics() calls)
+	struct ER_RHI_NullFrameStats
+	{
+		UINT commands[ER_NULL_CMD_COUNT] = {};
+		UINT draws = 0;
+		UINT dispatches = 0;
+		UINT bindCalls = 0; // render targets, resources, buffers and samplers
+		UINT boundObjects = 0; // the same, but every element of the lists
+		UINT stateChanges = 0;
+		UINT transitions = 0; // resources that changed their state
+		UINT bufferUpdates = 0;
+		UINT64 bufferUpdateBytes = 0;
+		UINT64 commandStreamBytes = 0;
+	};
+
+	// Backend without a device for headless runs (build machines, CPU benchmarks): buffers are kept in CPU memory, textures and shaders only keep
+	// their descriptions. Commands are not executed, only recorded into a compact stream and counted, so the CPU cost of a frame can be measured
+	// without the GPU and the driver. See ER_RuntimeCore::RunHeadless().
+	class ER_RHI_Null : public ER_RHI
+	{
+	public:
+		ER_RHI_Null();
+		virtual ~ER_RHI_Null();
+
+		virtual bool Initialize(HWND windowHandle, UINT width, UINT height, bool isFullscreen, bool isReset = false) override;
+
+		virtual void BeginGraphicsCommandList(int index = 0) override { mCurrentGraphicsCommandListIndex = index; }
+		virtual void EndGraphicsCommandList(int index = 0) override { mCurrentGraphicsCommandListIndex = -1; }
+
+		virtual void BeginComputeCommandList(int index = 0) override { mCurrentComputeCommandListIndex = index; }
+		virtual void EndComputeCommandList(int index = 0) override { mCurrentComputeCommandListIndex = -1; }
+
+		virtual void BeginCopyCommandList(int index = 0) override {};
+		virtual void EndCopyCommandList(int index = 0) override {};
+
+		virtual void ClearMainRenderTarget(float colors[4]) override;
+		virtual void ClearMainDepthStencilTarget(float depth, UINT stencil = 0) override;
+		virtual void ClearRenderTarget(ER_RHI_GPUTexture* aRenderTarget, float colors[4], int rtvArrayIndex = -1) override;
+		virtual void ClearDepthStencilTarget(ER_RHI_GPUTexture* aDepthTarget, float depth, UINT stencil = 0) override;
+		virtual void ClearUAV(ER_RHI_GPUResource* aRenderTarget, float colors[4]) override;
+		virtual void ClearUAV(ER_RHI_GPUBuffer* aBuffer, UINT clear) override;
+
+		virtual ER_RHI_GPUShader* CreateGPUShader() override;
+		virtual ER_RHI_GPUBuffer* CreateGPUBuffer(const std::string& aDebugName) override;
+		virtual ER_RHI_GPUTexture* CreateGPUTexture(const std::wstring& aDebugName) override;
+		virtual ER_RHI_GPURootSignature* CreateRootSignature(UINT NumRootParams = 0, UINT NumStaticSamplers = 0) override { return nullptr; } // like on DX11, callers skip the root signature setup
+		virtual ER_RHI_InputLayout* CreateInputLayout(ER_RHI_INPUT_ELEMENT_DESC* inputElementDescriptions, UINT inputElementDescriptionCount) override;
+
+		virtual void CreateTexture(ER_RHI_GPUTexture* aOutTexture, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE,
+			int mip = 1, int depth = -1, int arraySize = 1, bool isCubemap = false, int cubemapArraySize = -1) override;
+		virtual void CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::string& aPath, bool isFullPath = false) override;
+		virtual void CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::wstring& aPath, bool isFullPath = false) override;
+
+		virtual void CreateBuffer(ER_RHI_GPUBuffer* aOutBuffer, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic = false, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE, UINT cpuAccessFlags = 0, ER_RHI_RESOURCE_MISC_FLAG miscFlags = ER_RESOURCE_MISC_NONE, ER_RHI_FORMAT format = ER_FORMAT_UNKNOWN) override;
+		virtual void CopyBuffer(ER_RHI_GPUBuffer* aDestBuffer, ER_RHI_GPUBuffer* aSrcBuffer, int cmdListIndex, bool isInCopyQueue = false) override;
+		virtual void BeginBufferRead(ER_RHI_GPUBuffer* aBuffer, void** output) override;
+		virtual void EndBufferRead(ER_RHI_GPUBuffer* aBuffer) override {};
+
+		virtual void CopyGPUTextureSubresourceRegion(ER_RHI_GPUResource* aDestBuffer, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ER_RHI_GPUResource* aSrcBuffer, UINT SrcSubresource, bool isInCopyQueueOrSkipTransitions = false) override;
+
+		virtual void Draw(UINT VertexCount) override;
+		virtual void DrawIndexed(UINT IndexCount) override;
+		virtual void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override;
+		virtual void DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override;
+		virtual void DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* anArgsBuffer, UINT alignedByteOffset) override;
+
+		virtual void Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override;
+
+		virtual void ExecuteCommandLists(int commandListIndex = 0, bool isCompute = false) override {};
+		virtual void ExecuteCopyCommandList() override {};
+
+		virtual void GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture = nullptr) override;
+		virtual void GenerateMipsWithTextureReplacement(ER_RHI_GPUTexture** aTexture, std::function<void(ER_RHI_GPUTexture**)> aReplacementCallback) override {};
+		virtual void ReplaceOriginalTexturesWithMipped() override {};
+
+		virtual void PresentGraphics() override;
+		virtual void PresentCompute() override {};
+
+		virtual bool ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB) override { return false; } // no texel data
+		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) override;
+
+		virtual void SetMainRenderTargets(int cmdListIndex = 0) override;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
+		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) override;
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override {};
+		virtual void SetMainRenderTargetFormats() override {};
+
+		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) override;
+		virtual void SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4] = nullptr, UINT SampleMask = 0xffffffff) override;
+		virtual void SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS) override;
+
+		virtual void SetViewport(const ER_RHI_Viewport& aViewport) override;
+		virtual void SetRect(const ER_RHI_Rect& rect) override;
+
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0,
+			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
+			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
+			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) override;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
+
+		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) override {};
+		virtual void SetRootConstant(UINT aConstant, UINT aRootIndex, UINT anOffset = 0, bool isCompute = false) override {};
+
+		virtual void SetShader(ER_RHI_GPUShader* aShader) override;
+		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) override;
+		virtual void SetEmptyInputLayout() override;
+		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) override;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) override;
+
+		virtual void SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType) override;
+		virtual ER_RHI_PRIMITIVE_TYPE GetCurrentTopologyType() override { return mCurrentTopologyType; }
+
+		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) override {};
+		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex) override {};
+
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) override {};
+
+		virtual bool IsPSOReady(ER_RHI_PSO_HANDLE aHandle) override;
+		virtual void InitializePSO(ER_RHI_PSO_HANDLE aHandle) override;
+		virtual void SetRootSignatureToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_GPURootSignature* rs) override {};
+		virtual void SetTopologyTypeToPSO(ER_RHI_PSO_HANDLE aHandle, ER_RHI_PRIMITIVE_TYPE aType) override {};
+		virtual void FinalizePSO(ER_RHI_PSO_HANDLE aHandle) override {};
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle) override;
+		virtual void UnsetPSO() override;
+
+		virtual void UnbindRenderTargets() override;
+		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) override;
+
+		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) override;
+		virtual void UpdateBufferRange(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int dataSize) override;
+		virtual int GetDynamicBufferCopiesCount() override { return 1; }
+
+		virtual bool IsHardwareRaytracingSupported() override { return false; }
+		virtual bool IsRootConstantSupported() override { return false; }
+
+		virtual void InitImGui() override;
+		virtual void StartNewImGuiFrame() override {};
+		virtual void RenderDrawDataImGui(int cmdListIndex = 0) override;
+		virtual void ShutdownImGui() override {};
+
+		virtual void OnWindowSizeChanged(int width, int height) override {};
+
+		virtual void WaitForGpuOnGraphicsFence() override {};
+		virtual void WaitForGpuOnComputeFence() override {};
+		virtual void WaitForGpuOnCopyFence() override {};
+
+		virtual void ResetReplacementMippedTexturesPool() override {};
+		virtual void ResetDescriptorManager() override {};
+		virtual void ResetRHI(int width, int height, bool isFullscreen) override {};
+
+		virtual void BeginEventTag(const std::string& aName, bool isComputeQueue = false) override;
+		virtual void EndEventTag(bool isComputeQueue = false) override;
+
+		// counters and commands of the last presented frame
+		const ER_RHI_NullFrameStats& GetLastFrameStats() const { return mLastFrameStats; }
+		const std::vector<UINT>& GetLastFrameCommandStream() const { return mLastFrameCommandStream; }
+
+		static UINT GenerateResourceId(); // ids of null textures and buffers, never 0
+		static UINT GetResourceId(ER_RHI_GPUResource* aResource);
+		// Calls aCallback(type, payload, payload words count) for every command of a stream
+		static void ForEachCommand(const std::vector<UINT>& aCommandStream, const std::function<void(ER_RHI_NULL_COMMAND, const UINT*, UINT)>& aCallback);
+
+		// Recording, counters and CPU buffers (see ER_Tests)
+		static bool RunTests();
+		// Recording cost of a typical draw (PSO, bindings, constant buffer update, draw)
+		static void Benchmark();
+	private:
+		UINT* RecordCommand(ER_RHI_NULL_COMMAND aType, UINT aPayloadWordsCount);
+		template <typename T>
+		void RecordBinding(ER_RHI_NULL_COMMAND aType, ER_RHI_SHADER_TYPE aShaderType, UINT aStartSlot, ER_RHI_Span<T*> aResources)
+		{
+			UINT* payload = RecordCommand(aType, 2 + aResources.size());
+			payload[0] = static_cast<UINT>(aShaderType);
+			payload[1] = aStartSlot;
+			for (UINT i = 0; i < aResources.size(); i++)
+				payload[2 + i] = GetResourceId(aResources[i]);
+			mFrameStats.bindCalls++;
+			mFrameStats.boundObjects += aResources.size();
+		}
+		void RecordState(ER_RHI_NULL_STATE aState, UINT aValue);
+		void RecordBufferUpdate(ER_RHI_GPUBuffer* aBuffer, void* aData, int aOffset, int aDataSize);
+
+		std::vector<UINT> mCommandStream; // of the current frame, the capacity is reused
+		std::vector<UINT> mLastFrameCommandStream;
+		ER_RHI_NullFrameStats mFrameStats;
+		ER_RHI_NullFrameStats mLastFrameStats;
+
+		std::vector<bool> mReadyPSOs; // per handle
+		ER_RHI_PSO_HANDLE mCurrentGraphicsPSO = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mCurrentComputePSO = ER_RHI_INVALID_PSO_HANDLE;
+
+		ER_RHI_PRIMITIVE_TYPE mCurrentTopologyType = ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		ER_RHI_Viewport mMainViewport;
+		UINT mEventTagsDepth = 0;
+	};
+}
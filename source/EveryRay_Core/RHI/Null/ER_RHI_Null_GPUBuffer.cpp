@@ -0,0 +1,34 @@
+#include "ER_RHI_Null_GPUBuffer.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_Null_GPUBuffer::ER_RHI_Null_GPUBuffer(const std::string& aDebugName)
+		: mId(ER_RHI_Null::GenerateResourceId())
+	{
+	}
+
+	ER_RHI_Null_GPUBuffer::~ER_RHI_Null_GPUBuffer()
+	{
+	}
+
+	void ER_RHI_Null_GPUBuffer::CreateGPUBufferResource(ER_RHI* aRHI, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic /*= false*/,
+		ER_RHI_BIND_FLAG bindFlags /*= 0*/, UINT cpuAccessFlags /*= 0*/, ER_RHI_RESOURCE_MISC_FLAG miscFlags /*= 0*/, ER_RHI_FORMAT format /*= ER_FORMAT_UNKNOWN*/)
+	{
+		assert(aRHI);
+
+		mFormat = format;
+		mBindFlags = bindFlags;
+		mStride = byteStride;
+
+		mData.assign(static_cast<size_t>(objectsCount) * byteStride, 0);
+		if (aData && !mData.empty())
+			memcpy(mData.data(), aData, mData.size());
+	}
+
+	void ER_RHI_Null_GPUBuffer::Update(const void* aData, int aOffset, int aDataSize)
+	{
+		assert(aData);
+		assert(aOffset >= 0 && aDataSize >= 0 && static_cast<size_t>(aOffset) + aDataSize <= mData.size());
+		memcpy(mData.data() + aOffset, aData, aDataSize);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	// Buffer in CPU memory: updates are written to it and reads (BeginBufferRead()) return it, GPU writes (UAVs, copies) are not executed
+	class ER_RHI_Null_GPUBuffer : public ER_RHI_GPUBuffer
+	{
+	public:
+		ER_RHI_Null_GPUBuffer(const std::string& aDebugName);
+		virtual ~ER_RHI_Null_GPUBuffer();
+
+		virtual void CreateGPUBufferResource(ER_RHI* aRHI, void* aData, UINT objectsCount, UINT byteStride,
+			bool isDynamic = false, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE, UINT cpuAccessFlags = 0,
+			ER_RHI_RESOURCE_MISC_FLAG miscFlags = ER_RESOURCE_MISC_NONE, ER_RHI_FORMAT format = ER_FORMAT_UNKNOWN) override;
+		virtual void* GetBuffer() override { return mData.empty() ? nullptr : this; }
+		virtual void* GetSRV() override { return (mBindFlags & ER_BIND_SHADER_RESOURCE) ? this : nullptr; }
+		virtual void* GetUAV() override { return (mBindFlags & ER_BIND_UNORDERED_ACCESS) ? this : nullptr; }
+		virtual int GetSize() override { return static_cast<int>(mData.size()); }
+		virtual UINT GetStride() override { return mStride; }
+		virtual ER_RHI_FORMAT GetFormatRhi() override { return mFormat; }
+		virtual void* GetResource() override { return GetBuffer(); }
+
+		virtual ER_RHI_RESOURCE_STATE GetCurrentState() override { return mCurrentState; }
+		virtual void SetCurrentState(ER_RHI_RESOURCE_STATE aState) override { mCurrentState = aState; }
+
+		inline virtual bool IsBuffer() override { return true; }
+
+		UINT GetId() { return mId; }
+		BYTE* GetData() { return mData.data(); }
+		void Update(const void* aData, int aOffset, int aDataSize);
+	private:
+		UINT mId;
+		std::vector<BYTE> mData;
+		ER_RHI_FORMAT mFormat = ER_FORMAT_UNKNOWN;
+		ER_RHI_BIND_FLAG mBindFlags = ER_BIND_NONE;
+		ER_RHI_RESOURCE_STATE mCurrentState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON;
+		UINT mStride = 0;
+	};
+}
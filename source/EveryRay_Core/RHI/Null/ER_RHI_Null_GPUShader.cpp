@@ -0,0 +1,22 @@
+#include "ER_RHI_Null_GPUShader.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_Null_GPUShader::ER_RHI_Null_GPUShader()
+	{
+	}
+
+	ER_RHI_Null_GPUShader::~ER_RHI_Null_GPUShader()
+	{
+	}
+
+	void ER_RHI_Null_GPUShader::CompileShader(ER_RHI* aRHI, const std::string& path, const std::string& shaderEntry, ER_RHI_SHADER_TYPE type, ER_RHI_InputLayout* aIL)
+	{
+		assert(aRHI);
+
+		mShaderType = type;
+		mPath = path;
+		mEntry = shaderEntry;
+		mIsCompiled = true;
+	}
+}
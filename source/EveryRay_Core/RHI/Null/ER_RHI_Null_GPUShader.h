@@ -0,0 +1,23 @@
+#pragma once
+#include "ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	// Nothing is compiled: the shader only remembers where it comes from
+	class ER_RHI_Null_GPUShader : public ER_RHI_GPUShader
+	{
+	public:
+		ER_RHI_Null_GPUShader();
+		virtual ~ER_RHI_Null_GPUShader();
+
+		virtual void CompileShader(ER_RHI* aRHI, const std::string& path, const std::string& shaderEntry, ER_RHI_SHADER_TYPE type, ER_RHI_InputLayout* aIL = nullptr) override;
+		virtual void* GetShaderObject() override { return mIsCompiled ? this : nullptr; }
+
+		const std::string& GetPath() { return mPath; }
+		const std::string& GetEntry() { return mEntry; }
+	private:
+		std::string mPath;
+		std::string mEntry;
+		bool mIsCompiled = false;
+	};
+}
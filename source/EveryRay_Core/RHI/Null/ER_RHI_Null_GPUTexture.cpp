@@ -0,0 +1,99 @@
+#include "ER_RHI_Null_GPUTexture.h"
+#include "..\..\ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_Null_GPUTexture::ER_RHI_Null_GPUTexture(const std::wstring& aDebugName)
+		: mId(ER_RHI_Null::GenerateResourceId())
+	{
+		debugName = aDebugName;
+	}
+
+	ER_RHI_Null_GPUTexture::~ER_RHI_Null_GPUTexture()
+	{
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags /*= ER_BIND_NONE*/, int mip /*= 1*/, int depth /*= -1*/, int arraySize /*= 1*/, bool isCubemap /*= false*/, int cubemapArraySize /*= -1*/)
+	{
+		assert(aRHI);
+
+		mFormat = format;
+		mBindFlags = bindFlags;
+		mWidth = width;
+		mHeight = height;
+		mDepth = depth > 0 ? depth : 0;
+		mMipLevels = mip;
+		mIsCubemap = isCubemap;
+		mArraySize = (isCubemap && cubemapArraySize > 0) ? arraySize * cubemapArraySize : arraySize;
+		mIsCreated = true;
+		mIsLoadedFromFile = false;
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const std::string& aPath, bool isFullPath /*= false*/, bool is3D, bool skipFallback, bool* statusFlag, bool isSilent)
+	{
+		CreateGPUTextureResource(aRHI, EveryRay_Core::ER_Utility::ToWideString(aPath), isFullPath, is3D, skipFallback, statusFlag, isSilent);
+	}
+
+	// Reads only the header of the file (same formats as on DX11: DDS or anything WIC can decode), so missing files are still reported
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const std::wstring& aPath, bool isFullPath /*= false*/, bool is3D, bool skipFallback, bool* statusFlag, bool isSilent)
+	{
+		assert(aRHI);
+
+		const std::wstring path = isFullPath ? aPath : EveryRay_Core::ER_Utility::GetFilePath(aPath);
+		const bool isDDS = path.length() > 4 && (path.substr(path.length() - 4) == L".dds" || path.substr(path.length() - 4) == L".DDS");
+
+		DirectX::TexMetadata metadata = {};
+		HRESULT hr = isDDS ? DirectX::GetMetadataFromDDSFile(path.c_str(), DirectX::DDS_FLAGS_NONE, metadata) : DirectX::GetMetadataFromWICFile(path.c_str(), DirectX::WIC_FLAGS_NONE, metadata);
+		const bool isLoaded = SUCCEEDED(hr) && (metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE3D) == is3D;
+		if (isLoaded)
+			SetDescriptionFromMetadata(metadata);
+		else
+		{
+			if (!isSilent)
+			{
+				std::wstring msg = L"[ER Logger][ER_RHI_Null_GPUTexture] Failed to load texture from disk: " + path + L". Loading fallback texture instead unless forced not to. \n";
+				ER_OUTPUT_LOG(msg.c_str());
+			}
+			if (!skipFallback)
+				CreateGPUTextureResource(aRHI, 1, 1, 1, ER_FORMAT_R8G8B8A8_UNORM, ER_BIND_SHADER_RESOURCE);
+		}
+		mIsLoadedFromFile = true;
+
+		if (statusFlag)
+			*statusFlag = isLoaded;
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResourceFromDDSMemory(ER_RHI* aRHI, const void* aData, UINT64 aDataSize, bool* statusFlag, bool isSilent)
+	{
+		assert(aRHI);
+		assert(aData);
+
+		DirectX::TexMetadata metadata = {};
+		const bool isLoaded = SUCCEEDED(DirectX::GetMetadataFromDDSMemory(aData, static_cast<size_t>(aDataSize), DirectX::DDS_FLAGS_NONE, metadata)) &&
+			SetDescriptionFromMetadata(metadata);
+		if (!isLoaded && !isSilent)
+		{
+			std::wstring msg = L"[ER Logger][ER_RHI_Null_GPUTexture] Failed to create texture from DDS data in memory: " + debugName + L"\n";
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+		mIsLoadedFromFile = true;
+
+		if (statusFlag)
+			*statusFlag = isLoaded;
+	}
+
+	bool ER_RHI_Null_GPUTexture::SetDescriptionFromMetadata(const DirectX::TexMetadata& aMetadata)
+	{
+		// loaded textures are only sampled, the format is not needed (and not every DXGI format has an ER_RHI_FORMAT)
+		mFormat = ER_FORMAT_UNKNOWN;
+		mBindFlags = ER_BIND_SHADER_RESOURCE;
+		mWidth = static_cast<UINT>(aMetadata.width);
+		mHeight = static_cast<UINT>(aMetadata.height);
+		mDepth = aMetadata.dimension == DirectX::TEX_DIMENSION_TEXTURE3D ? static_cast<UINT>(aMetadata.depth) : 0;
+		mMipLevels = static_cast<UINT>(aMetadata.mipLevels);
+		mArraySize = static_cast<UINT>(aMetadata.arraySize);
+		mIsCubemap = aMetadata.IsCubemap();
+		mIsCreated = true;
+		return mWidth > 0 && mHeight > 0;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	// Only the description of the texture: there are no texels, views are the texture itself (non-null if the matching bind flag was requested)
+	class ER_RHI_Null_GPUTexture : public ER_RHI_GPUTexture
+	{
+	public:
+		ER_RHI_Null_GPUTexture(const std::wstring& aDebugName);
+		virtual ~ER_RHI_Null_GPUTexture();
+
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE,
+			int mip = 1, int depth = -1, int arraySize = 1, bool isCubemap = false, int cubemapArraySize = -1) override;
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::string& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) override;
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::wstring& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) override;
+		virtual void CreateGPUTextureResourceFromDDSMemory(ER_RHI* aRHI, const void* aData, UINT64 aDataSize, bool* statusFlag = nullptr, bool isSilent = false) override;
+
+		virtual void* GetRTV(void* aEmpty = nullptr) override { return (mBindFlags & ER_BIND_RENDER_TARGET) ? this : nullptr; }
+		virtual void* GetRTV(int index) override { return (mBindFlags & ER_BIND_RENDER_TARGET) ? this : nullptr; }
+		virtual void* GetDSV() override { return (mBindFlags & ER_BIND_DEPTH_STENCIL) ? this : nullptr; }
+		virtual void* GetSRV() override { return (mBindFlags & ER_BIND_SHADER_RESOURCE) ? this : nullptr; }
+		virtual void* GetUAV() override { return (mBindFlags & ER_BIND_UNORDERED_ACCESS) ? this : nullptr; }
+		virtual void* GetResource() override { return mIsCreated ? this : nullptr; }
+
+		virtual UINT GetMips() override { return mMipLevels; }
+		virtual UINT GetWidth() override { return mWidth; }
+		virtual UINT GetHeight() override { return mHeight; }
+		virtual UINT GetDepth() override { return mDepth; }
+
+		virtual ER_RHI_RESOURCE_STATE GetCurrentState() override { return mCurrentState; }
+		virtual void SetCurrentState(ER_RHI_RESOURCE_STATE aState) override { mCurrentState = aState; }
+
+		inline virtual bool IsBuffer() override { return false; }
+
+		UINT GetId() { return mId; }
+		ER_RHI_FORMAT GetFormat() { return mFormat; }
+		UINT GetArraySize() { return mArraySize; }
+		bool IsLoadedFromFile() { return mIsLoadedFromFile; }
+	private:
+		bool SetDescriptionFromMetadata(const DirectX::TexMetadata& aMetadata);
+
+		UINT mId;
+		ER_RHI_FORMAT mFormat = ER_FORMAT_UNKNOWN;
+		ER_RHI_BIND_FLAG mBindFlags = ER_BIND_NONE;
+		ER_RHI_RESOURCE_STATE mCurrentState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON;
+		UINT mMipLevels = 0;
+		UINT mWidth = 0;
+		UINT mHeight = 0;
+		UINT mDepth = 0;
+		UINT mArraySize = 0;
+		bool mIsCubemap = false;
+		bool mIsCreated = false;
+		bool mIsLoadedFromFile = false;
+	};
+}
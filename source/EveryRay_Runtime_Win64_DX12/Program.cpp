@@ -5,6 +5,7 @@
 #include "..\EveryRay_Core\ER_Utility.h"
 #include "..\EveryRay_Core\RHI\ER_RHI.h"
 #include "..\EveryRay_Core\RHI\DX12\ER_RHI_DX12.h"
+#include "..\EveryRay_Core\RHI\Null\ER_RHI_Null.h"
 
 #if defined(DEBUG) || defined(_DEBUG)
 #define _CRTDBG_MAP_ALLOC
@@ -34,13 +35,45 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE previousInstance, LPSTR command
 #else
 	windowMainName += " (Release)";
 #endif
-	std::unique_ptr<ER_RuntimeCore> game(new ER_RuntimeCore(new ER_RHI_DX12(), instance, ER_Utility::ToWideString(windowClassName).c_str(), ER_Utility::ToWideString(windowMainName).c_str(), showCommand, false));
+	// "[-profilestartup]": exports the first frame (with all the initialization before it) to a Chrome trace file (see ER_CPUProfiler::RequestStartupCapture())
+	// "-headless [scene] [frames]": null RHI (no GPU device) and a hidden window, runs the frames and saves a report of their CPU cost (see ER_RuntimeCore::RunHeadless())
+	std::istringstream arguments(commandLine ? commandLine : "");
+	std::string argument;
+	arguments >> argument;
+	const bool isStartupProfiling = (argument == "-profilestartup");
+	if (isStartupProfiling)
+	{
+		argument.clear();
+		arguments >> argument;
+	}
+	const bool isHeadless = (argument == "-headless");
+	std::string headlessSceneName = "testScene";
+	UINT headlessFramesCount = 300;
+	if (isHeadless)
+	{
+		arguments >> headlessSceneName;
+		if (!(arguments >> headlessFramesCount))
+			headlessFramesCount = 300;
+		windowMainName += " (Headless)";
+	}
 
+	ER_RHI* rhi = isHeadless ? static_cast<ER_RHI*>(new ER_RHI_Null()) : static_cast<ER_RHI*>(new ER_RHI_DX12());
+	std::unique_ptr<ER_RuntimeCore> game(new ER_RuntimeCore(rhi, instance, ER_Utility::ToWideString(windowClassName).c_str(), ER_Utility::ToWideString(windowMainName).c_str(), isHeadless ? SW_HIDE : showCommand, false));
+	if (isStartupProfiling)
+		game->CPUProfiler()->RequestStartupCapture();
 	try {
-		game->Run();
+		if (isHeadless)
+			game->RunHeadless(headlessSceneName, headlessFramesCount);
+		else
+			game->Run();
 	}
 	catch (ER_CoreException ex)
 	{
+		if (isHeadless)
+		{
+			ER_OUTPUT_LOG((ex.whatw() + L"\n").c_str());
+			return 1;
+		}
 		MessageBox(game->WindowHandle(), ex.whatw().c_str(), game->WindowTitle().c_str(), MB_ABORTRETRYIGNORE);
 	}
 
@@ -0,0 +1,81 @@
+#define ER_PLATFORM_WIN64_DX11 1
+
+#include "..\EveryRay_Core\ER_RuntimeCore.h"
+#include "..\EveryRay_Core\ER_CoreException.h"
+#include "..\EveryRay_Core\ER_Utility.h"
+#include "..\EveryRay_Core\ER_JobSystem.h"
+#include "..\EveryRay_Core\ER_Tests.h"
+#include "..\EveryRay_Core\RHI\ER_RHI.h"
+#include "..\EveryRay_Core\RHI\Null\ER_RHI_Null.h"
+
+using namespace EveryRay_Core;
+
+// "[-benchmark] [scene]": runs the standalone test suites (and benchmarks) of ER_Tests and, if a scene is provided, loads it with the null RHI and runs the scene suites too.
+// "-meshcache": logs cold (assimp) vs. warm (mesh cache) import times of all the models in content\models instead (see ER_RuntimeCore::RunMeshCacheBenchmark()).
+// "-meshoptimizer": logs vertex counts and ACMR/ATVR before/after the mesh optimization of all the models in content\models instead (see ER_RuntimeCore::RunMeshOptimizerReport()).
+// Returns the number of failed suites (the post-build step runs it without arguments), results are in the debug output.
+int WINAPI WinMain(HINSTANCE instance, HINSTANCE previousInstance, LPSTR commandLine, int showCommand)
+{
+	if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED)))
+		throw ER_CoreException("Failed to call CoInitializeEx");
+
+	std::istringstream arguments(commandLine ? commandLine : "");
+	std::string argument;
+	std::string sceneName;
+	bool isBenchmark = false;
+	bool isMeshCacheBenchmark = false;
+	bool isMeshOptimizerReport = false;
+	while (arguments >> argument)
+	{
+		if (argument == "-benchmark")
+			isBenchmark = true;
+		else if (argument == "-meshcache")
+			isMeshCacheBenchmark = true;
+		else if (argument == "-meshoptimizer")
+			isMeshOptimizerReport = true;
+		else
+			sceneName = argument;
+	}
+
+	const std::string windowName = "EveryRay - Tests " + engineVersionString + " | Win64 DX11";
+	if (isMeshCacheBenchmark || isMeshOptimizerReport)
+	{
+		std::unique_ptr<ER_RuntimeCore> game(new ER_RuntimeCore(new ER_RHI_Null(), instance, L"EveryRay Tests Window Class", ER_Utility::ToWideString(windowName).c_str(), SW_HIDE, false));
+		try {
+			const std::string modelsDirectory = ER_Utility::GetFilePath(std::string("content\\models\\"));
+			if (isMeshCacheBenchmark)
+				game->RunMeshCacheBenchmark(modelsDirectory);
+			else
+				game->RunMeshOptimizerReport(modelsDirectory);
+		}
+		catch (ER_CoreException ex)
+		{
+			ER_OUTPUT_LOG((ex.whatw() + L"\n").c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	int failedCount = 0;
+	{
+		ER_JobSystem jobSystem;
+		failedCount += ER_Tests::Run(&jobSystem);
+		if (isBenchmark)
+			ER_Tests::RunBenchmarks(&jobSystem);
+	}
+
+	if (!sceneName.empty())
+	{
+		std::unique_ptr<ER_RuntimeCore> game(new ER_RuntimeCore(new ER_RHI_Null(), instance, L"EveryRay Tests Window Class", ER_Utility::ToWideString(windowName).c_str(), SW_HIDE, false));
+		try {
+			failedCount += game->RunTests(sceneName, isBenchmark);
+		}
+		catch (ER_CoreException ex)
+		{
+			ER_OUTPUT_LOG((ex.whatw() + L"\n").c_str());
+			failedCount++;
+		}
+	}
+
+	return failedCount;
+}